@@ -22,6 +22,34 @@ AES::AES(int keyLen)
   }
 
   blockBytesLen = 4 * this->Nb * sizeof(unsigned char);
+
+  backend = AESGetBestBackend();
+
+  memset(sessionRoundKeys, 0, AES_MAX_ROUND_KEYS_SIZE);
+  memset(sessionInvRoundKeys, 0, AES_MAX_ROUND_KEYS_SIZE);
+}
+
+bool AES::SetBackend(AESBackend newBackend)
+{
+  if (AESIsBackendSupported(newBackend) == false)
+  {
+    return true;
+  }
+
+  backend = newBackend;
+
+  return false;
+}
+
+AESBackend AES::GetBackend()
+{
+  return backend;
+}
+
+void AES::SetKey(unsigned char key[])
+{
+  KeyExpansion(key, sessionRoundKeys);
+  AESInvKeyExpansion(sessionRoundKeys, sessionInvRoundKeys, Nr);
 }
 
 unsigned char * AES::EncryptECB(unsigned char in[], unsigned int inLen, unsigned  char key[], unsigned int &outLen)
@@ -29,7 +57,7 @@ unsigned char * AES::EncryptECB(unsigned char in[], unsigned int inLen, unsigned
   outLen = GetPaddingLength(inLen);
   unsigned char *alignIn  = PaddingNulls(in, inLen, outLen);
   unsigned char *out = new unsigned char[outLen];
-  unsigned char *roundKeys = new unsigned char[4 * Nb * (Nr + 1)];
+  unsigned char roundKeys[AES_MAX_ROUND_KEYS_SIZE];
   KeyExpansion(key, roundKeys);
   for (unsigned int i = 0; i < outLen; i+= blockBytesLen)
   {
@@ -37,7 +65,6 @@ unsigned char * AES::EncryptECB(unsigned char in[], unsigned int inLen, unsigned
   }
   
   delete[] alignIn;
-  delete[] roundKeys;
   
   return out;
 }
@@ -45,26 +72,77 @@ unsigned char * AES::EncryptECB(unsigned char in[], unsigned int inLen, unsigned
 unsigned char * AES::DecryptECB(unsigned char in[], unsigned int inLen, unsigned  char key[])
 {
   unsigned char *out = new unsigned char[inLen];
-  unsigned char *roundKeys = new unsigned char[4 * Nb * (Nr + 1)];
+  DecryptECB(in, inLen, key, out);
+  
+  return out;
+}
+
+
+unsigned int AES::EncryptECB(unsigned char in[], unsigned int inLen, unsigned  char key[], unsigned char out[])
+{
+  unsigned char roundKeys[AES_MAX_ROUND_KEYS_SIZE];
   KeyExpansion(key, roundKeys);
-  for (unsigned int i = 0; i < inLen; i+= blockBytesLen)
+
+  return EncryptECBWithRoundKeys(in, inLen, roundKeys, out);
+}
+
+void AES::DecryptECB(unsigned char in[], unsigned int inLen, unsigned  char key[], unsigned char out[])
+{
+  unsigned char roundKeys[AES_MAX_ROUND_KEYS_SIZE];
+  unsigned char invRoundKeys[AES_MAX_ROUND_KEYS_SIZE];
+  KeyExpansion(key, roundKeys);
+  AESInvKeyExpansion(roundKeys, invRoundKeys, Nr);
+
+  DecryptECBWithRoundKeys(in, inLen, invRoundKeys, out);
+}
+
+unsigned int AES::EncryptECBWithSetKey(unsigned char in[], unsigned int inLen, unsigned char out[])
+{
+  return EncryptECBWithRoundKeys(in, inLen, sessionRoundKeys, out);
+}
+
+void AES::DecryptECBWithSetKey(unsigned char in[], unsigned int inLen, unsigned char out[])
+{
+  DecryptECBWithRoundKeys(in, inLen, sessionInvRoundKeys, out);
+}
+
+unsigned int AES::EncryptECBWithRoundKeys(unsigned char in[], unsigned int inLen, unsigned char roundKeys[], unsigned char out[])
+{
+  unsigned int outLen = GetPaddingLength(inLen);
+
+  unsigned int fullLen = inLen - inLen % blockBytesLen;
+  for (unsigned int i = 0; i < fullLen; i+= blockBytesLen)
   {
-    DecryptBlock(in + i, out + i, roundKeys);
+    EncryptBlock(in + i, out + i, roundKeys);
   }
 
-  delete[] roundKeys;
-  
-  return out;
+  if (fullLen < outLen)
+  {
+    // Last block is padded with nulls.
+    unsigned char block[AES_BLOCK_SIZE];
+    memcpy(block, in + fullLen, inLen - fullLen);
+    memset(block + (inLen - fullLen), 0x00, outLen - inLen);
+    EncryptBlock(block, out + fullLen, roundKeys);
+  }
+
+  return outLen;
 }
 
+void AES::DecryptECBWithRoundKeys(unsigned char in[], unsigned int inLen, unsigned char invRoundKeys[], unsigned char out[])
+{
+  for (unsigned int i = 0; i < inLen; i+= blockBytesLen)
+  {
+    DecryptBlock(in + i, out + i, invRoundKeys);
+  }
+}
 
 unsigned char *AES::EncryptCBC(unsigned char in[], unsigned int inLen, unsigned  char key[], unsigned char * iv, unsigned int &outLen)
 {
   outLen = GetPaddingLength(inLen);
   unsigned char *alignIn  = PaddingNulls(in, inLen, outLen);
   unsigned char *out = new unsigned char[outLen];
-  unsigned char *block = new unsigned char[blockBytesLen];
-  unsigned char *roundKeys = new unsigned char[4 * Nb * (Nr + 1)];
+  unsigned char block[AES_BLOCK_SIZE];
+  unsigned char roundKeys[AES_MAX_ROUND_KEYS_SIZE];
   KeyExpansion(key, roundKeys);
   memcpy(block, iv, blockBytesLen);
   for (unsigned int i = 0; i < outLen; i+= blockBytesLen)
@@ -74,9 +152,7 @@ unsigned char *AES::EncryptCBC(unsigned char in[], unsigned int inLen, unsigned
     memcpy(block, out + i, blockBytesLen);
   }
   
-  delete[] block;
   delete[] alignIn;
-  delete[] roundKeys;
 
   return out;
 }
@@ -84,19 +160,18 @@ unsigned char *AES::EncryptCBC(unsigned char in[], unsigned int inLen, unsigned
 unsigned char *AES::DecryptCBC(unsigned char in[], unsigned int inLen, unsigned  char key[], unsigned char * iv)
 {
   unsigned char *out = new unsigned char[inLen];
-  unsigned char *block = new unsigned char[blockBytesLen];
-  unsigned char *roundKeys = new unsigned char[4 * Nb * (Nr + 1)];
+  unsigned char block[AES_BLOCK_SIZE];
+  unsigned char roundKeys[AES_MAX_ROUND_KEYS_SIZE];
+  unsigned char invRoundKeys[AES_MAX_ROUND_KEYS_SIZE];
   KeyExpansion(key, roundKeys);
+  AESInvKeyExpansion(roundKeys, invRoundKeys, Nr);
   memcpy(block, iv, blockBytesLen);
   for (unsigned int i = 0; i < inLen; i+= blockBytesLen)
   {
-    DecryptBlock(in + i, out + i, roundKeys);
+    DecryptBlock(in + i, out + i, invRoundKeys);
     XorBlocks(block, out + i, out + i, blockBytesLen);
     memcpy(block, in + i, blockBytesLen);
   }
-  
-  delete[] block;
-  delete[] roundKeys;
 
   return out;
 }
@@ -106,9 +181,9 @@ unsigned char *AES::EncryptCFB(unsigned char in[], unsigned int inLen, unsigned
   outLen = GetPaddingLength(inLen);
   unsigned char *alignIn  = PaddingNulls(in, inLen, outLen);
   unsigned char *out = new unsigned char[outLen];
-  unsigned char *block = new unsigned char[blockBytesLen];
-  unsigned char *encryptedBlock = new unsigned char[blockBytesLen];
-  unsigned char *roundKeys = new unsigned char[4 * Nb * (Nr + 1)];
+  unsigned char block[AES_BLOCK_SIZE];
+  unsigned char encryptedBlock[AES_BLOCK_SIZE];
+  unsigned char roundKeys[AES_MAX_ROUND_KEYS_SIZE];
   KeyExpansion(key, roundKeys);
   memcpy(block, iv, blockBytesLen);
   for (unsigned int i = 0; i < outLen; i+= blockBytesLen)
@@ -118,10 +193,7 @@ unsigned char *AES::EncryptCFB(unsigned char in[], unsigned int inLen, unsigned
     memcpy(block, out + i, blockBytesLen);
   }
   
-  delete[] block;
-  delete[] encryptedBlock;
   delete[] alignIn;
-  delete[] roundKeys;
 
   return out;
 }
@@ -129,9 +201,9 @@ unsigned char *AES::EncryptCFB(unsigned char in[], unsigned int inLen, unsigned
 unsigned char *AES::DecryptCFB(unsigned char in[], unsigned int inLen, unsigned  char key[], unsigned char * iv)
 {
   unsigned char *out = new unsigned char[inLen];
-  unsigned char *block = new unsigned char[blockBytesLen];
-  unsigned char *encryptedBlock = new unsigned char[blockBytesLen];
-  unsigned char *roundKeys = new unsigned char[4 * Nb * (Nr + 1)];
+  unsigned char block[AES_BLOCK_SIZE];
+  unsigned char encryptedBlock[AES_BLOCK_SIZE];
+  unsigned char roundKeys[AES_MAX_ROUND_KEYS_SIZE];
   KeyExpansion(key, roundKeys);
   memcpy(block, iv, blockBytesLen);
   for (unsigned int i = 0; i < inLen; i+= blockBytesLen)
@@ -140,10 +212,6 @@ unsigned char *AES::DecryptCFB(unsigned char in[], unsigned int inLen, unsigned
     XorBlocks(in + i, encryptedBlock, out + i, blockBytesLen);
     memcpy(block, in + i, blockBytesLen);
   }
-  
-  delete[] block;
-  delete[] encryptedBlock;
-  delete[] roundKeys;
 
   return out;
 }
@@ -170,8 +238,20 @@ unsigned int AES::GetPaddingLength(unsigned int len)
 
 void AES::EncryptBlock(unsigned char in[], unsigned char out[], unsigned  char *roundKeys)
 {
-  unsigned char **state = new unsigned char *[4];
-  state[0] = new unsigned  char[4 * Nb];
+  if (backend == AES_BACKEND_AESNI)
+  {
+    AESEncryptBlockNI(in, out, roundKeys, Nr);
+    return;
+  }
+  else if (backend == AES_BACKEND_TTABLE)
+  {
+    AESEncryptBlockTTable(in, out, roundKeys, Nr);
+    return;
+  }
+
+  unsigned char stateData[AES_BLOCK_SIZE];
+  unsigned char *state[4];
+  state[0] = stateData;
   int i, j, round;
   for (i = 0; i < 4; i++)
   {
@@ -208,15 +288,26 @@ void AES::EncryptBlock(unsigned char in[], unsigned char out[], unsigned  char *
       out[i + 4 * j] = state[i][j];
     }
   }
-
-  delete[] state[0];
-  delete[] state;
 }
 
 void AES::DecryptBlock(unsigned char in[], unsigned char out[], unsigned  char *roundKeys)
 {
-  unsigned char **state = new unsigned char *[4];
-  state[0] = new unsigned  char[4 * Nb];
+  if (backend == AES_BACKEND_AESNI)
+  {
+    AESDecryptBlockNI(in, out, roundKeys, Nr);
+    return;
+  }
+  else if (backend == AES_BACKEND_TTABLE)
+  {
+    AESDecryptBlockTTable(in, out, roundKeys, Nr);
+    return;
+  }
+
+  // Equivalent inverse cipher ('roundKeys' are in the reverse order).
+
+  unsigned char stateData[AES_BLOCK_SIZE];
+  unsigned char *state[4];
+  state[0] = stateData;
   int i, j, round;
   for (i = 0; i < 4; i++)
   {
@@ -231,19 +322,19 @@ void AES::DecryptBlock(unsigned char in[], unsigned char out[], unsigned  char *
     }
   }
 
-  AddRoundKey(state, roundKeys + Nr * 4 * Nb);
+  AddRoundKey(state, roundKeys);
 
-  for (round = Nr - 1; round >= 1; round--)
+  for (round = 1; round <= Nr - 1; round++)
   {
     InvSubBytes(state);
     InvShiftRows(state);
-    AddRoundKey(state, roundKeys + round * 4 * Nb);
     InvMixColumns(state);
+    AddRoundKey(state, roundKeys + round * 4 * Nb);
   }
 
   InvSubBytes(state);
   InvShiftRows(state);
-  AddRoundKey(state, roundKeys);
+  AddRoundKey(state, roundKeys + Nr * 4 * Nb);
 
   for (i = 0; i < 4; i++)
   {
@@ -251,9 +342,6 @@ void AES::DecryptBlock(unsigned char in[], unsigned char out[], unsigned  char *
       out[i + 4 * j] = state[i][j];
     }
   }
-
-  delete[] state[0];
-  delete[] state;
 }
 
 
@@ -276,13 +364,11 @@ void AES::ShiftRow(unsigned char **state, int i, int n)    // shift row i on n p
 {
   unsigned char t;
   int k, j, index;
-  unsigned char *tmp = new unsigned char[Nb];
+  unsigned char tmp[AES_BLOCK_SIZE / 4];
   for (j = 0; j < Nb; j++) {
     tmp[j] = state[i][(j + n) % Nb];
   }
   memcpy(state[i], tmp, Nb * sizeof(unsigned char));
-	
-  delete[] tmp;
 }
 
 void AES::ShiftRows(unsigned char **state)
@@ -327,7 +413,7 @@ void AES::MixSingleColumn(unsigned char *r)
 /* Performs the mix columns step. Theory from: https://en.wikipedia.org/wiki/Advanced_Encryption_Standard#The_MixColumns_step */
 void AES::MixColumns(unsigned char** state) 
 {
-  unsigned char *temp = new unsigned char[4];
+  unsigned char temp[4];
 
   for(int i = 0; i < 4; ++i)
   {
@@ -341,7 +427,6 @@ void AES::MixColumns(unsigned char** state)
       state[j][i] = temp[j]; //when the column is mixed, place it back into the state
     }
   }
-  delete temp;
 }
 
 void AES::AddRoundKey(unsigned char **state, unsigned char *key)
@@ -398,8 +483,8 @@ void AES::Rcon(unsigned char * a, int n)
 
 void AES::KeyExpansion(unsigned char key[], unsigned char w[])
 {
-  unsigned char *temp = new unsigned char[4];
-  unsigned char *rcon = new unsigned char[4];
+  unsigned char temp[4];
+  unsigned char rcon[4];
 
   int i = 0;
   while (i < 4 * Nk)
@@ -434,10 +519,6 @@ void AES::KeyExpansion(unsigned char key[], unsigned char w[])
     w[i + 3] = w[i + 3 - 4 * Nk] ^ temp[3];
     i += 4;
   }
-
-  delete []rcon;
-  delete []temp;
-
 }
 
 
@@ -5,8 +5,13 @@
 #include <iostream>
 #include <stdio.h>
 
+#include "AESBackends.h"
+
 using namespace std;
 
+#define AES_BLOCK_SIZE          16
+#define AES_MAX_ROUND_KEYS_SIZE 240 // 4 * Nb * (Nr + 1) for 256 bit key
+
 class AES
 {
 private:
@@ -16,6 +21,11 @@ private:
 
   unsigned int blockBytesLen;
 
+  AESBackend backend;
+
+  unsigned char sessionRoundKeys[AES_MAX_ROUND_KEYS_SIZE];    // expanded once in SetKey()
+  unsigned char sessionInvRoundKeys[AES_MAX_ROUND_KEYS_SIZE]; // expanded once in SetKey()
+
   void SubBytes(unsigned char **state);
 
   void ShiftRow(unsigned char **state, int i, int n);    // shift row i on n positions
@@ -47,24 +57,50 @@ private:
   void InvShiftRows(unsigned char **state);
 
   unsigned char* PaddingNulls(unsigned char in[], unsigned int inLen, unsigned int alignLen);
-  
-  unsigned int GetPaddingLength(unsigned int len);
 
   void KeyExpansion(unsigned char key[], unsigned char w[]);
 
   void EncryptBlock(unsigned char in[], unsigned char out[], unsigned  char key[]);
 
+  // 'key' - result of the AESInvKeyExpansion().
   void DecryptBlock(unsigned char in[], unsigned char out[], unsigned  char key[]);
 
   void XorBlocks(unsigned char *a, unsigned char * b, unsigned char *c, unsigned int len);
 
+  unsigned int EncryptECBWithRoundKeys(unsigned char in[], unsigned int inLen, unsigned char roundKeys[], unsigned char out[]);
+
+  void DecryptECBWithRoundKeys(unsigned char in[], unsigned int inLen, unsigned char invRoundKeys[], unsigned char out[]);
+
 public:
   AES(int keyLen = 256);
 
+  // The fastest supported backend is used by default.
+  // Returns true if the backend is not supported by this CPU (the current one is kept).
+  bool SetBackend(AESBackend newBackend);
+
+  AESBackend GetBackend();
+
   unsigned char *EncryptECB(unsigned char in[], unsigned int inLen, unsigned  char key[], unsigned int &outLen);
 
   unsigned char *DecryptECB(unsigned char in[], unsigned int inLen, unsigned  char key[]);
 
+  // No heap allocations: 'out' should have at least GetPaddingLength(inLen) bytes, returns the written size.
+  unsigned int EncryptECB(unsigned char in[], unsigned int inLen, unsigned  char key[], unsigned char out[]);
+
+  // No heap allocations: 'out' should have at least 'inLen' bytes.
+  void DecryptECB(unsigned char in[], unsigned int inLen, unsigned  char key[], unsigned char out[]);
+
+  // Expands the key once, EncryptECBWithSetKey/DecryptECBWithSetKey use this key schedule.
+  void SetKey(unsigned char key[]);
+
+  // Same as EncryptECB() with 'out' but uses the key from SetKey().
+  unsigned int EncryptECBWithSetKey(unsigned char in[], unsigned int inLen, unsigned char out[]);
+
+  // Same as DecryptECB() with 'out' but uses the key from SetKey().
+  void DecryptECBWithSetKey(unsigned char in[], unsigned int inLen, unsigned char out[]);
+
+  unsigned int GetPaddingLength(unsigned int len);
+
   unsigned char *EncryptCBC(unsigned char in[], unsigned int inLen, unsigned  char key[], unsigned char * iv, unsigned int &outLen);
 
   unsigned char *DecryptCBC(unsigned char in[], unsigned int inLen, unsigned  char key[], unsigned char * iv);
@@ -0,0 +1,352 @@
+#include "AESBackends.h"
+
+#include "AES.h"
+
+#include <stdint.h>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+  #define AES_BACKENDS_X86
+
+  #include <wmmintrin.h>
+  #include <emmintrin.h>
+
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+  #endif
+#endif
+
+// GCC/Clang need the instruction set enabled per function (the rest of the program is built without it).
+#if defined(__GNUC__)
+  #define AES_BACKENDS_TARGET_NI __attribute__((target("aes,sse2")))
+#else
+  #define AES_BACKENDS_TARGET_NI
+#endif
+
+
+// ------------------------------------------------------------------------------------------------
+// Tables
+// ------------------------------------------------------------------------------------------------
+
+static unsigned char gmul(unsigned char a, unsigned char b) // multiplication a and b in galois field
+{
+  unsigned char p = 0;
+  for (int i = 0; i < 8; i++)
+  {
+    if (b & 1)
+    {
+      p ^= a;
+    }
+    unsigned char high_bit = a & 0x80;
+    a <<= 1;
+    if (high_bit)
+    {
+      a ^= 0x1b;
+    }
+    b >>= 1;
+  }
+  return p;
+}
+
+static inline uint32_t rotr8(uint32_t x)
+{
+  return (x >> 8) | (x << 24);
+}
+
+struct AESTables
+{
+  // Te[k] / Td[k] are Te[0] / Td[0] rotated right by 8 * k bits.
+  uint32_t Te[4][256];
+  uint32_t Td[4][256];
+
+  AESTables()
+  {
+    for (int x = 0; x < 256; x++)
+    {
+      unsigned char s = sbox[x / 16][x % 16];
+      Te[0][x] = (static_cast<uint32_t>(gmul(s, 2)) << 24) | (static_cast<uint32_t>(s) << 16)
+               | (static_cast<uint32_t>(s) << 8)          | static_cast<uint32_t>(gmul(s, 3));
+
+      unsigned char is = inv_sbox[x / 16][x % 16];
+      Td[0][x] = (static_cast<uint32_t>(gmul(is, 0x0e)) << 24) | (static_cast<uint32_t>(gmul(is, 0x09)) << 16)
+               | (static_cast<uint32_t>(gmul(is, 0x0d)) << 8)  | static_cast<uint32_t>(gmul(is, 0x0b));
+
+      for (int k = 1; k < 4; k++)
+      {
+        Te[k][x] = rotr8(Te[k - 1][x]);
+        Td[k][x] = rotr8(Td[k - 1][x]);
+      }
+    }
+  }
+};
+
+static const AESTables tables;
+
+static inline uint32_t loadWord(const unsigned char *p)
+{
+  return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16)
+       | (static_cast<uint32_t>(p[2]) << 8)  | static_cast<uint32_t>(p[3]);
+}
+
+static inline void storeWord(unsigned char *p, uint32_t w)
+{
+  p[0] = static_cast<unsigned char>(w >> 24);
+  p[1] = static_cast<unsigned char>(w >> 16);
+  p[2] = static_cast<unsigned char>(w >> 8);
+  p[3] = static_cast<unsigned char>(w);
+}
+
+static inline uint32_t subByte(uint32_t x)
+{
+  return sbox[(x >> 4) & 0x0f][x & 0x0f];
+}
+
+static inline uint32_t invSubByte(uint32_t x)
+{
+  return inv_sbox[(x >> 4) & 0x0f][x & 0x0f];
+}
+
+static inline uint32_t sboxWord(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+  return (subByte(a >> 24)         << 24)
+       | (subByte((b >> 16) & 0xff) << 16)
+       | (subByte((c >> 8)  & 0xff) << 8)
+       |  subByte(d        & 0xff);
+}
+
+static inline uint32_t invSboxWord(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+  return (invSubByte(a >> 24)         << 24)
+       | (invSubByte((b >> 16) & 0xff) << 16)
+       | (invSubByte((c >> 8)  & 0xff) << 8)
+       |  invSubByte(d        & 0xff);
+}
+
+
+// ------------------------------------------------------------------------------------------------
+// CPU check
+// ------------------------------------------------------------------------------------------------
+
+static bool isAESNISupported()
+{
+#if !defined(AES_BACKENDS_X86)
+  return false;
+#elif defined(_MSC_VER)
+  int vInfo[4];
+  __cpuid(vInfo, 1);
+
+  bool bAES  = (vInfo[2] & (1 << 25)) != 0;
+  bool bSSE2 = (vInfo[3] & (1 << 26)) != 0;
+
+  return bAES && bSSE2;
+#else
+  __builtin_cpu_init();
+
+  return __builtin_cpu_supports("aes") && __builtin_cpu_supports("sse2");
+#endif
+}
+
+bool AESIsBackendSupported(AESBackend backend)
+{
+  switch (backend)
+  {
+  case AES_BACKEND_REFERENCE:
+  case AES_BACKEND_TTABLE:
+    return true;
+  case AES_BACKEND_AESNI:
+  {
+    // Checked once.
+    static const bool bSupported = isAESNISupported();
+    return bSupported;
+  }
+  }
+
+  return false;
+}
+
+AESBackend AESGetBestBackend()
+{
+  if (AESIsBackendSupported(AES_BACKEND_AESNI))
+  {
+    return AES_BACKEND_AESNI;
+  }
+
+  return AES_BACKEND_TTABLE;
+}
+
+const char* AESGetBackendName(AESBackend backend)
+{
+  switch (backend)
+  {
+  case AES_BACKEND_REFERENCE:
+    return "reference";
+  case AES_BACKEND_TTABLE:
+    return "t-table";
+  case AES_BACKEND_AESNI:
+    return "aes-ni";
+  }
+
+  return "unknown";
+}
+
+
+// ------------------------------------------------------------------------------------------------
+// Key schedule
+// ------------------------------------------------------------------------------------------------
+
+void AESInvKeyExpansion(const unsigned char w[], unsigned char dw[], int Nr)
+{
+  // Round keys in the reverse order, InvMixColumns applied to all but the first and the last one
+  // (FIPS-197, 5.3.5 "Equivalent Inverse Cipher").
+
+  for (int round = 0; round <= Nr; round++)
+  {
+    const unsigned char *src = w + (Nr - round) * AES_BLOCK_SIZE;
+    unsigned char *dst = dw + round * AES_BLOCK_SIZE;
+
+    if (round == 0 || round == Nr)
+    {
+      for (int i = 0; i < AES_BLOCK_SIZE; i++)
+      {
+        dst[i] = src[i];
+      }
+      continue;
+    }
+
+    for (int c = 0; c < 4; c++)
+    {
+      const unsigned char *s = src + 4 * c;
+      dst[4 * c + 0] = gmul(s[0], 0x0e) ^ gmul(s[1], 0x0b) ^ gmul(s[2], 0x0d) ^ gmul(s[3], 0x09);
+      dst[4 * c + 1] = gmul(s[0], 0x09) ^ gmul(s[1], 0x0e) ^ gmul(s[2], 0x0b) ^ gmul(s[3], 0x0d);
+      dst[4 * c + 2] = gmul(s[0], 0x0d) ^ gmul(s[1], 0x09) ^ gmul(s[2], 0x0e) ^ gmul(s[3], 0x0b);
+      dst[4 * c + 3] = gmul(s[0], 0x0b) ^ gmul(s[1], 0x0d) ^ gmul(s[2], 0x09) ^ gmul(s[3], 0x0e);
+    }
+  }
+}
+
+
+// ------------------------------------------------------------------------------------------------
+// T-table
+// ------------------------------------------------------------------------------------------------
+
+void AESEncryptBlockTTable(const unsigned char in[], unsigned char out[], const unsigned char roundKeys[], int Nr)
+{
+  const uint32_t (*Te)[256] = tables.Te;
+
+  uint32_t s0 = loadWord(in)      ^ loadWord(roundKeys);
+  uint32_t s1 = loadWord(in + 4)  ^ loadWord(roundKeys + 4);
+  uint32_t s2 = loadWord(in + 8)  ^ loadWord(roundKeys + 8);
+  uint32_t s3 = loadWord(in + 12) ^ loadWord(roundKeys + 12);
+
+  for (int round = 1; round < Nr; round++)
+  {
+    const unsigned char *rk = roundKeys + round * AES_BLOCK_SIZE;
+
+    uint32_t t0 = Te[0][s0 >> 24] ^ Te[1][(s1 >> 16) & 0xff] ^ Te[2][(s2 >> 8) & 0xff] ^ Te[3][s3 & 0xff] ^ loadWord(rk);
+    uint32_t t1 = Te[0][s1 >> 24] ^ Te[1][(s2 >> 16) & 0xff] ^ Te[2][(s3 >> 8) & 0xff] ^ Te[3][s0 & 0xff] ^ loadWord(rk + 4);
+    uint32_t t2 = Te[0][s2 >> 24] ^ Te[1][(s3 >> 16) & 0xff] ^ Te[2][(s0 >> 8) & 0xff] ^ Te[3][s1 & 0xff] ^ loadWord(rk + 8);
+    uint32_t t3 = Te[0][s3 >> 24] ^ Te[1][(s0 >> 16) & 0xff] ^ Te[2][(s1 >> 8) & 0xff] ^ Te[3][s2 & 0xff] ^ loadWord(rk + 12);
+
+    s0 = t0;
+    s1 = t1;
+    s2 = t2;
+    s3 = t3;
+  }
+
+  // Last round (no MixColumns).
+  const unsigned char *rk = roundKeys + Nr * AES_BLOCK_SIZE;
+
+  storeWord(out,      sboxWord(s0, s1, s2, s3) ^ loadWord(rk));
+  storeWord(out + 4,  sboxWord(s1, s2, s3, s0) ^ loadWord(rk + 4));
+  storeWord(out + 8,  sboxWord(s2, s3, s0, s1) ^ loadWord(rk + 8));
+  storeWord(out + 12, sboxWord(s3, s0, s1, s2) ^ loadWord(rk + 12));
+}
+
+void AESDecryptBlockTTable(const unsigned char in[], unsigned char out[], const unsigned char invRoundKeys[], int Nr)
+{
+  const uint32_t (*Td)[256] = tables.Td;
+
+  uint32_t s0 = loadWord(in)      ^ loadWord(invRoundKeys);
+  uint32_t s1 = loadWord(in + 4)  ^ loadWord(invRoundKeys + 4);
+  uint32_t s2 = loadWord(in + 8)  ^ loadWord(invRoundKeys + 8);
+  uint32_t s3 = loadWord(in + 12) ^ loadWord(invRoundKeys + 12);
+
+  for (int round = 1; round < Nr; round++)
+  {
+    const unsigned char *rk = invRoundKeys + round * AES_BLOCK_SIZE;
+
+    uint32_t t0 = Td[0][s0 >> 24] ^ Td[1][(s3 >> 16) & 0xff] ^ Td[2][(s2 >> 8) & 0xff] ^ Td[3][s1 & 0xff] ^ loadWord(rk);
+    uint32_t t1 = Td[0][s1 >> 24] ^ Td[1][(s0 >> 16) & 0xff] ^ Td[2][(s3 >> 8) & 0xff] ^ Td[3][s2 & 0xff] ^ loadWord(rk + 4);
+    uint32_t t2 = Td[0][s2 >> 24] ^ Td[1][(s1 >> 16) & 0xff] ^ Td[2][(s0 >> 8) & 0xff] ^ Td[3][s3 & 0xff] ^ loadWord(rk + 8);
+    uint32_t t3 = Td[0][s3 >> 24] ^ Td[1][(s2 >> 16) & 0xff] ^ Td[2][(s1 >> 8) & 0xff] ^ Td[3][s0 & 0xff] ^ loadWord(rk + 12);
+
+    s0 = t0;
+    s1 = t1;
+    s2 = t2;
+    s3 = t3;
+  }
+
+  // Last round (no InvMixColumns).
+  const unsigned char *rk = invRoundKeys + Nr * AES_BLOCK_SIZE;
+
+  storeWord(out,      invSboxWord(s0, s3, s2, s1) ^ loadWord(rk));
+  storeWord(out + 4,  invSboxWord(s1, s0, s3, s2) ^ loadWord(rk + 4));
+  storeWord(out + 8,  invSboxWord(s2, s1, s0, s3) ^ loadWord(rk + 8));
+  storeWord(out + 12, invSboxWord(s3, s2, s1, s0) ^ loadWord(rk + 12));
+}
+
+
+// ------------------------------------------------------------------------------------------------
+// AES-NI
+// ------------------------------------------------------------------------------------------------
+
+#ifdef AES_BACKENDS_X86
+
+AES_BACKENDS_TARGET_NI
+void AESEncryptBlockNI(const unsigned char in[], unsigned char out[], const unsigned char roundKeys[], int Nr)
+{
+  const __m128i *rk = reinterpret_cast<const __m128i*>(roundKeys);
+
+  __m128i state = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in)), _mm_loadu_si128(rk));
+
+  for (int round = 1; round < Nr; round++)
+  {
+    state = _mm_aesenc_si128(state, _mm_loadu_si128(rk + round));
+  }
+
+  state = _mm_aesenclast_si128(state, _mm_loadu_si128(rk + Nr));
+
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), state);
+}
+
+AES_BACKENDS_TARGET_NI
+void AESDecryptBlockNI(const unsigned char in[], unsigned char out[], const unsigned char invRoundKeys[], int Nr)
+{
+  const __m128i *rk = reinterpret_cast<const __m128i*>(invRoundKeys);
+
+  __m128i state = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in)), _mm_loadu_si128(rk));
+
+  for (int round = 1; round < Nr; round++)
+  {
+    state = _mm_aesdec_si128(state, _mm_loadu_si128(rk + round));
+  }
+
+  state = _mm_aesdeclast_si128(state, _mm_loadu_si128(rk + Nr));
+
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), state);
+}
+
+#else
+
+// Never selected (see AESIsBackendSupported()).
+
+void AESEncryptBlockNI(const unsigned char in[], unsigned char out[], const unsigned char roundKeys[], int Nr)
+{
+  AESEncryptBlockTTable(in, out, roundKeys, Nr);
+}
+
+void AESDecryptBlockNI(const unsigned char in[], unsigned char out[], const unsigned char invRoundKeys[], int Nr)
+{
+  AESDecryptBlockTTable(in, out, invRoundKeys, Nr);
+}
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef _AES_BACKENDS_H_
+#define _AES_BACKENDS_H_
+
+// Fast block cipher implementations used by the AES class.
+// All of them take the same key schedule as AES::KeyExpansion() (FIPS-197 byte order),
+// decryption takes the "equivalent inverse cipher" key schedule (see AESInvKeyExpansion()).
+
+enum AESBackend
+{
+  AES_BACKEND_REFERENCE = 0, // original byte-oriented implementation in the AES class
+  AES_BACKEND_TTABLE    = 1, // portable 32-bit lookup tables
+  AES_BACKEND_AESNI     = 2  // x86 AES instructions
+};
+
+bool AESIsBackendSupported(AESBackend backend);
+
+// Fastest supported backend (checked once with CPUID).
+AESBackend AESGetBestBackend();
+
+const char* AESGetBackendName(AESBackend backend);
+
+// 'w' - result of the AES::KeyExpansion(), 'dw' - the same size as 'w'.
+void AESInvKeyExpansion(const unsigned char w[], unsigned char dw[], int Nr);
+
+void AESEncryptBlockTTable(const unsigned char in[], unsigned char out[], const unsigned char roundKeys[], int Nr);
+
+void AESDecryptBlockTTable(const unsigned char in[], unsigned char out[], const unsigned char invRoundKeys[], int Nr);
+
+void AESEncryptBlockNI(const unsigned char in[], unsigned char out[], const unsigned char roundKeys[], int Nr);
+
+void AESDecryptBlockNI(const unsigned char in[], unsigned char out[], const unsigned char invRoundKeys[], int Nr);
+
+#endif
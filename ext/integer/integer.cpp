@@ -81,6 +81,12 @@ integer::integer(const std::string & str, const integer & base) : integer()
             index++;
         }
 
+        // digits are collected into 'chunk' (as many as fit into one INTEGER_DIGIT_T)
+        // so there is only one multiplication per chunk instead of per character
+        const INTEGER_DOUBLE_DIGIT_T b = static_cast <uint8_t> (base);
+        INTEGER_DOUBLE_DIGIT_T chunk       = 0;
+        INTEGER_DOUBLE_DIGIT_T chunk_scale = 1;
+
         // process characters
         for(; index < str.size(); index++){
             uint8_t d = tolower(str[index]);
@@ -100,7 +106,18 @@ integer::integer(const std::string & str, const integer & base) : integer()
                 throw std::runtime_error(std::string("Error: Not a digit in base ") + base.str(10) + ": '"+ str[index] + "'");
             }
 
-            *this = (*this * base) + d;
+            if (chunk_scale * b > integer::NEG1){
+                *this = (*this * integer(static_cast <INTEGER_DIGIT_T> (chunk_scale))) + integer(static_cast <INTEGER_DIGIT_T> (chunk));
+                chunk       = 0;
+                chunk_scale = 1;
+            }
+
+            chunk        = chunk * b + d;
+            chunk_scale *= b;
+        }
+
+        if (chunk_scale > 1){
+            *this = (*this * integer(static_cast <INTEGER_DIGIT_T> (chunk_scale))) + integer(static_cast <INTEGER_DIGIT_T> (chunk));
         }
 
         _sign = sign;
@@ -366,7 +383,7 @@ integer integer::operator<<(const integer & shift) const {
     // do this part first to avoid shifting zeros
     for(integer::REP_SIZE_T i = 0; i < (out.size() - 1); i++){
         INTEGER_DOUBLE_DIGIT_T d = out[i];
-        d = (d << push) | (out[i + 1] >> pull);
+        d = (d << push) | (static_cast <INTEGER_DOUBLE_DIGIT_T> (out[i + 1]) >> pull); // 'pull' can be the whole digit width
         out[i] = d & NEG1;
         // out[i] = (out[i] << push) | (out[i + 1] >> pull);
     }
@@ -817,157 +834,32 @@ integer & integer::operator-=(const integer & rhs){
   // return peasant(peasant(peasant(peasant(r4, B) + r3, B) + r2, B) + r1, B) + r0;
 // }
 
-// // Long multiplication
-// integer integer::long_mult(const integer & lhs, const integer & rhs) const {
-   // unsigned int zeros = 0;
-   // integer row, out = 0;
-   // for(integer::REP::const_reverse_iterator i = lhs._value.rbegin(); i != lhs._value.rend(); i++){
-       // row._value = integer::REP(zeros++, 0); // zeros on the right hand side
-       // INTEGER_DIGIT_T carry = 0;
-       // for(integer::REP::const_reverse_iterator j = rhs._value.rbegin(); j != rhs._value.rend(); j++){
-           // INTEGER_DOUBLE_DIGIT_T prod = (INTEGER_DOUBLE_DIGIT_T) *i * (INTEGER_DOUBLE_DIGIT_T) *j + carry;// multiply through
-           // row._value.push_front(prod & integer::NEG1);
-           // carry = prod >> integer::BITS;
-       // }
-       // if (carry){
-           // row._value.push_front(carry);
-       // }
-       // out = add(out, row);
-   // }
-   // return out;
-// }
+// Long multiplication
+integer integer::long_mult(const integer & lhs, const integer & rhs) const {
+    const integer::REP_SIZE_T lsize = lhs._value.size();
+    const integer::REP_SIZE_T rsize = rhs._value.size();
 
-//Private FFT helper function
-int integer::fft(std::deque<double>& data, bool dir) const
-{
-     //Verify size is a power of two
-     std::size_t n = data.size()/2;
-     if ((n == 0) || (n & (n-1))) return 1;
-
-     //rearrange data for signal flow chart
-     std::size_t bitr_j = 1;
-     for (std::size_t i = 3; i < 2*n-1; i += 2)
-     {
-          std::size_t msz = n;
-          while (bitr_j >= msz)
-          {
-               bitr_j -= msz;
-               msz >>= 1;
-          }
-          bitr_j += msz;
-
-          if (bitr_j > i)
-          {
-               double swap = data[bitr_j-1];
-               data[bitr_j-1] = data[i-1];
-               data[i-1] = swap;
-               swap = data[bitr_j];
-               data[bitr_j] = data[i];
-               data[i] = swap;
-          }
-     }
-
-     //Perform "butterfly" calculations
-     std::size_t lmax = 2;
-     while (lmax <= n)
-     {
-          double wr = 1;
-          double wi = 0;
-
-          double theta = (2*M_PI)/double(lmax*(dir?1.0:-1.0));
-          double wpr = cos(theta);
-          double wpi = sin(theta);
-
-          int pstep = 2*lmax;
-          for (std::size_t l = 1; l < lmax; l += 2)
-          {
-               for (std::size_t p = l; p < 2*n; p += pstep)
-               {
-                    std::size_t q = p + lmax;
-                    double tempr = wr*data[q-1] - wi*data[q];
-                    double tempi = wr*data[q] + wi*data[q-1];
-                    data[q-1] = data[p-1] - tempr;
-                    data[q] = data[p] - tempi;
-                    data[p-1] = data[p-1] + tempr;
-                    data[p] = data[p] + tempi;
-               }
-
-               //Find the next power of W
-               double wtemp = wr;
-               wr = wr*wpr - wi*wpi;
-               wi = wi*wpr + wtemp*wpi;
-          }
-
-          lmax = pstep;
-     }
-
-     //All is good
-     return 0;
-}
-
-// FFT-based multiplication
-//Based on the convolution theorem which states that the Fourier
-//transform of a convolution is the pointwise product of their
-//Fourier transforms.
-integer integer::fft_mult(const integer& lhs, const integer& rhs) const {
-     //Convert each integer to input wanted by fft()
-     size_t size = 1;
-     while (size < lhs._value.size()*2){
-          size <<= 1;
-     }
-     while (size < rhs._value.size()*2){
-          size <<= 1;
-     }
-
-     std::deque<double> lhs_fft;
-     lhs_fft.resize(size*2, 0);
-     for (size_t i = 0; i < lhs._value.size(); i++){
-          lhs_fft[i*2] = double(lhs._value[lhs._value.size()-1-i]);
-     }
-
-     std::deque<double> rhs_fft;
-     rhs_fft.resize(size*2, 0);
-     for (size_t i = 0; i < rhs._value.size(); i++){
-          rhs_fft[i*2] = double(rhs._value[rhs._value.size()-1-i]);
-     }
-
-     //Compute the FFT of each
-     fft(lhs_fft);
-     fft(rhs_fft);
-
-     //Perform pointwise multiplication (numbers are complex)
-     std::deque<double> out_fft(2*size);
-     for (size_t i = 0; i < 2*size; i+=2){
-          out_fft[i] = lhs_fft[i]*rhs_fft[i] - lhs_fft[i+1]*rhs_fft[i+1];
-          out_fft[i+1] = lhs_fft[i]*rhs_fft[i+1] + lhs_fft[i+1]*rhs_fft[i];
-     }
-
-     //Compute the inverse FFT of this number
-     //remember to properly scale afterwards!
-     fft(out_fft, false);
-     for (size_t i = 0; i < 2*size; i++){
-          out_fft[i] /= size;
-     }
-
-     //Convert back to integer, carrying along the way
-     double carry = 0;
-     integer out;
-     for (size_t i = 0; i < 2*size; i+=2){
-          double current = out_fft[i]+carry;
-          if (current > double(integer::NEG1)){
-               carry = current / (double(integer::NEG1)+1);
-               carry = double(floor(carry+0.0001));
-               current = current - (carry*(integer::NEG1+1));
-
-          }
-          else {
-               carry = 0;
-          }
-          out._value.push_front(INTEGER_DIGIT_T(current+0.0001));
-     }
-
-     //Finish up
-     return out;
+    // digits are stored most significant first, out[k] gets the products of digits with (i + j + 1 == k)
+    integer out;
+    out._value = integer::REP(lsize + rsize, 0);
+
+    for(integer::REP_SIZE_T i = lsize; i > 0; i--){
+        const INTEGER_DOUBLE_DIGIT_T l = lhs._value[i - 1];
+        if (!l){
+            continue;
+        }
+
+        INTEGER_DOUBLE_DIGIT_T carry = 0;
+        for(integer::REP_SIZE_T j = rsize; j > 0; j--){
+            const integer::REP_SIZE_T k = i + j - 1;
+            const INTEGER_DOUBLE_DIGIT_T prod = l * rhs._value[j - 1] + out._value[k] + carry;
+            out._value[k] = static_cast <INTEGER_DIGIT_T> (prod & integer::NEG1);
+            carry = prod >> integer::BITS;
+        }
+        out._value[i - 1] = static_cast <INTEGER_DIGIT_T> (carry);
+    }
+
+    return out.trim();
 }
 
 integer integer::operator*(const integer & rhs) const {
@@ -987,8 +879,8 @@ integer integer::operator*(const integer & rhs) const {
     // integer out = recursive_mult(*this, rhs);
     // integer out = karatsuba(*this, rhs);
     // integer out = toom_cook_3(*this, rhs);
-    // integer out = long_mult(*this, rhs);
-    integer out = fft_mult(*this, rhs);
+    // integer out = fft_mult(*this, rhs);
+    integer out = long_mult(*this, rhs);
     out._sign = _sign ^ rhs._sign;
     out.trim();
     return out;
@@ -1071,6 +963,114 @@ std::pair <integer, integer> integer::non_recursive_divmod(const integer & lhs,
     return qr;
 }
 
+// Division by whole digits (Knuth, TAOCP vol. 2, 4.3.1, Algorithm D)
+// Written after divmnu64() from "Hacker's Delight" (2nd ed.), 9-2
+std::pair <integer, integer> integer::knuth_divmod(const integer & lhs, const integer & rhs) const {
+    const integer::REP_SIZE_T m = lhs._value.size();
+    const integer::REP_SIZE_T n = rhs._value.size();
+
+    std::pair <integer, integer> qr (0, 0);
+
+    // single digit divisor: short division
+    if (n == 1){
+        const INTEGER_DOUBLE_DIGIT_T d = rhs._value[0];
+        INTEGER_DOUBLE_DIGIT_T rem = 0;
+
+        qr.first._value = integer::REP(m, 0);
+        for(integer::REP_SIZE_T i = 0; i < m; i++){
+            const INTEGER_DOUBLE_DIGIT_T cur = (rem << integer::BITS) | lhs._value[i];
+            qr.first._value[i] = static_cast <INTEGER_DIGIT_T> (cur / d);
+            rem = cur % d;
+        }
+
+        qr.first.trim();
+        qr.second = integer(static_cast <INTEGER_DIGIT_T> (rem));
+        return qr;
+    }
+
+    const INTEGER_DOUBLE_DIGIT_T base = static_cast <INTEGER_DOUBLE_DIGIT_T> (1) << integer::BITS;
+
+    // little endian copies: u[i] and v[i] are digits of weight base^i
+    // normalize so that the top digit of the divisor has its high bit set
+    unsigned int s = 0;
+    while (!((rhs._value[0] << s) & integer::HIGH_BIT)){
+        s++;
+    }
+
+    integer::REP vn(n, 0);
+    integer::REP un(m + 1, 0);
+
+    for(integer::REP_SIZE_T i = 0; i < n; i++){
+        const INTEGER_DOUBLE_DIGIT_T hi = rhs._value[n - 1 - i];
+        const INTEGER_DOUBLE_DIGIT_T lo = (i >= 1)?rhs._value[n - i]:0;
+        vn[i] = static_cast <INTEGER_DIGIT_T> (((hi << s) | (lo >> (integer::BITS - s))) & integer::NEG1);
+    }
+
+    for(integer::REP_SIZE_T i = 0; i <= m; i++){
+        const INTEGER_DOUBLE_DIGIT_T hi = (i < m)?lhs._value[m - 1 - i]:0;
+        const INTEGER_DOUBLE_DIGIT_T lo = ((i >= 1) && (i - 1 < m))?lhs._value[m - i]:0;
+        un[i] = static_cast <INTEGER_DIGIT_T> (((hi << s) | (lo >> (integer::BITS - s))) & integer::NEG1);
+    }
+
+    // quotient digits, most significant first
+    qr.first._value = integer::REP(m - n + 1, 0);
+
+    for(integer::REP_SIZE_T jj = m - n + 1; jj > 0; jj--){
+        const integer::REP_SIZE_T j = jj - 1;
+
+        // estimate the quotient digit
+        const INTEGER_DOUBLE_DIGIT_T num = (static_cast <INTEGER_DOUBLE_DIGIT_T> (un[j + n]) << integer::BITS) | un[j + n - 1];
+        INTEGER_DOUBLE_DIGIT_T qhat = num / vn[n - 1];
+        INTEGER_DOUBLE_DIGIT_T rhat = num % vn[n - 1];
+
+        while ((qhat >= base) || (qhat * vn[n - 2] > ((rhat << integer::BITS) | un[j + n - 2]))){
+            qhat--;
+            rhat += vn[n - 1];
+            if (rhat >= base){
+                break;
+            }
+        }
+
+        // multiply and subtract
+        int64_t k = 0;
+        int64_t t = 0;
+        for(integer::REP_SIZE_T i = 0; i < n; i++){
+            const INTEGER_DOUBLE_DIGIT_T p = qhat * vn[i];
+            t = static_cast <int64_t> (un[i + j]) - k - static_cast <int64_t> (p & integer::NEG1);
+            un[i + j] = static_cast <INTEGER_DIGIT_T> (t & integer::NEG1);
+            k = static_cast <int64_t> (p >> integer::BITS) - (t >> integer::BITS);
+        }
+        t = static_cast <int64_t> (un[j + n]) - k;
+        un[j + n] = static_cast <INTEGER_DIGIT_T> (t & integer::NEG1);
+
+        // subtracted too much: add back
+        if (t < 0){
+            qhat--;
+            INTEGER_DOUBLE_DIGIT_T carry = 0;
+            for(integer::REP_SIZE_T i = 0; i < n; i++){
+                const INTEGER_DOUBLE_DIGIT_T sum = static_cast <INTEGER_DOUBLE_DIGIT_T> (un[i + j]) + vn[i] + carry;
+                un[i + j] = static_cast <INTEGER_DIGIT_T> (sum & integer::NEG1);
+                carry = sum >> integer::BITS;
+            }
+            un[j + n] = static_cast <INTEGER_DIGIT_T> ((un[j + n] + carry) & integer::NEG1);
+        }
+
+        qr.first._value[m - n - j] = static_cast <INTEGER_DIGIT_T> (qhat);
+    }
+
+    // unnormalize the remainder
+    qr.second._value = integer::REP(n, 0);
+    for(integer::REP_SIZE_T i = 0; i < n; i++){
+        const INTEGER_DOUBLE_DIGIT_T lo = un[i];
+        const INTEGER_DOUBLE_DIGIT_T hi = un[i + 1];
+        qr.second._value[n - 1 - i] = static_cast <INTEGER_DIGIT_T> (((lo >> s) | (hi << (integer::BITS - s))) & integer::NEG1);
+    }
+
+    qr.first.trim();
+    qr.second.trim();
+    return qr;
+}
+
 // division and modulus ignoring signs
 std::pair <integer, integer> integer::dm(const integer & lhs, const integer & rhs) const {
     if (!rhs){              // divide by 0 error
@@ -1093,7 +1093,8 @@ std::pair <integer, integer> integer::dm(const integer & lhs, const integer & rh
     // return naive_divmod(lhs, rhs);
     // return long_divmod(lhs, rhs);
     // return recursive_divmod(lhs, rhs);
-    return non_recursive_divmod(lhs, rhs);
+    // return non_recursive_divmod(lhs, rhs);
+    return knuth_divmod(lhs, rhs);
 }
 
 // division and modulus with signs
@@ -1231,7 +1232,7 @@ integer integer::twos_complement(const integer::REP_SIZE_T & b) const {
 integer & integer::fill(const integer::REP_SIZE_T & b){
     _value = integer::REP(b / integer::BITS, integer::NEG1);
     if (b % integer::BITS){
-        _value.push_front((1 << (b % integer::BITS)) - 1);
+        _value.push_front((static_cast <INTEGER_DIGIT_T> (1) << (b % integer::BITS)) - 1);
     }
     return *this;
 }
@@ -1254,12 +1255,34 @@ std::string integer::str(const integer & base, const std::string::size_type & le
             out = "0";
         }
         else{
+            // divide by the largest power of base that fits into one digit
+            // and write out all characters of the remainder at once
+            const INTEGER_DOUBLE_DIGIT_T b = static_cast <uint8_t> (base);
+            INTEGER_DOUBLE_DIGIT_T chunk_scale = b;
+            std::size_t            chunk_chars = 1;
+            while (chunk_scale * b <= integer::NEG1){
+                chunk_scale *= b;
+                chunk_chars++;
+            }
+            const integer divisor(static_cast <INTEGER_DIGIT_T> (chunk_scale));
+
+            std::string reversed;
             std::pair <integer, integer> qr;
             do{
-                qr = dm(rhs, base);
-                out = digits[qr.second] + out;
+                qr = dm(rhs, divisor);
                 rhs = qr.first;
+
+                INTEGER_DOUBLE_DIGIT_T r = qr.second._value.empty()?0:qr.second._value.back();
+                for(std::size_t i = 0; i < chunk_chars; i++){
+                    if (!rhs && !r){    // no leading zeros
+                        break;
+                    }
+                    reversed += digits[r % b];
+                    r /= b;
+                }
             } while (rhs);
+
+            out.assign(reversed.rbegin(), reversed.rend());
         }
 
         // pad with '0's
@@ -1434,3 +1457,26 @@ std::string makeascii(const integer & value, const unsigned int & size){
 integer abs(const integer & value){
     return (value.sign() == integer::POSITIVE)?value:-value;
 }
+
+uint64_t powmod(uint64_t base, uint64_t exponent, const uint64_t modulus){
+    if (!modulus){
+        throw std::domain_error("Error: modulus by 0");
+    }
+
+    if (modulus > 0xffffffffULL){
+        // the products would not fit
+        return static_cast <uint64_t> (pow(integer(base), exponent, modulus));
+    }
+
+    uint64_t result = 1 % modulus;
+    base %= modulus;
+    while (exponent){
+        if (exponent & 1){
+            result = (result * base) % modulus;
+        }
+        exponent >>= 1;
+        base = (base * base) % modulus;
+    }
+
+    return result;
+}
@@ -22,9 +22,8 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 THE SOFTWARE.
 */
 
-#include <cmath> //For fft sin, cos, M_PI, and floor
+#include <cmath>
 #include <cstdint>
-#include <deque>
 #include <iostream>
 #include <limits>
 #include <stdexcept>
@@ -46,8 +45,10 @@ THE SOFTWARE.
 #ifndef __INTEGER__
 #define __INTEGER__
 
+#include "limb_vector.h"
+
 #ifndef INTEGER_DIGIT_T
-#define INTEGER_DIGIT_T        uint8_t
+#define INTEGER_DIGIT_T        uint32_t
 #endif
 
 #ifndef INTEGER_DOUBLE_DIGIT_T
@@ -64,16 +65,20 @@ static_assert(std::is_unsigned <INTEGER_DIGIT_T>::value &&
 static_assert((2 * sizeof(INTEGER_DIGIT_T)) <= sizeof(INTEGER_DOUBLE_DIGIT_T)
               , "INTEGER_DOUBLE_DIGIT_T should be at least twice the size of INTEGER_DIGIT_T");
 
+// division keeps signed intermediates in int64_t
+static_assert(sizeof(INTEGER_DIGIT_T) <= 4
+              , "INTEGER_DIGIT_T can be at most 32 bits");
+
 class integer{
     public:
-        typedef std::deque <INTEGER_DIGIT_T> REP;                                                 // internal representation of values
+        typedef limb_vector <INTEGER_DIGIT_T> REP;                                                // internal representation of values (most significant digit first)
         typedef REP::size_type               REP_SIZE_T;                                          // size type of internal representation
 
     private:
         static constexpr INTEGER_DIGIT_T NEG1     = std::numeric_limits <INTEGER_DIGIT_T>::max(); // value with all bits ON - will only work for unsigned integer types
         static constexpr std::size_t     OCTETS   = sizeof(INTEGER_DIGIT_T);                      // number of octets per INTEGER_DIGIT_T
         static constexpr std::size_t     BITS     = OCTETS << 3;                                  // number of bits per INTEGER_DIGIT_T; hardcode this if INTEGER_DIGIT_T is not standard int type
-        static constexpr INTEGER_DIGIT_T HIGH_BIT = 1 << (BITS - 1);                              // highest bit of INTEGER_DIGIT_T (uint8_t -> 128)
+        static constexpr INTEGER_DIGIT_T HIGH_BIT = static_cast <INTEGER_DIGIT_T> (1) << (BITS - 1); // highest bit of INTEGER_DIGIT_T (uint8_t -> 128)
 
     public:
         typedef bool Sign;
@@ -102,13 +107,18 @@ class integer{
             // keep this here just in case value is sign extended
             for(std::size_t d = std::max(sizeof(Z) / OCTETS, (std::size_t) 1); d > 0; d--){
                 _value.push_front(val & NEG1);
-                val >>= BITS;
+                if ((sizeof(Z) << 3) > BITS){   // shifting by the whole width of Z is undefined
+                    val >>= (BITS % (sizeof(Z) << 3));
+                }
+                else{
+                    val = 0;
+                }
             }
 
             return trim();
         }
 
-        // remove 0 digits from top of deque to save memory
+        // remove 0 digits from the top to save memory
         integer & trim();
 
     public:
@@ -396,17 +406,9 @@ class integer{
         // // // It's also kind of slow.
         // // integer toom_cook_3(integer m, integer n, integer bm = 0x1000000U);
 
-        // // Long multiplication
-        // integer long_mult(const integer & lhs, const integer & rhs) const;
-
-        //Private FFT helper function
-        int fft(std::deque<double>& data, bool dir = true) const;
-
-        // FFT-based multiplication
-        //Based on the convolution theorem which states that the Fourier
-        //transform of a convolution is the pointwise product of their
-        //Fourier transforms.
-        integer fft_mult(const integer& lhs, const integer& rhs) const;
+        // Long multiplication
+        // (the FFT multiplication was removed: doubles lose precision with digits wider than 8 bits)
+        integer long_mult(const integer & lhs, const integer & rhs) const;
 
     public:
         integer operator*(const integer & rhs) const;
@@ -439,6 +441,10 @@ class integer{
         // Non-Recursive version of above algorithm
         std::pair <integer, integer> non_recursive_divmod(const integer & lhs, const integer & rhs) const;
 
+        // Division by whole digits (Knuth, TAOCP vol. 2, 4.3.1, Algorithm D)
+        // lhs must be larger than rhs
+        std::pair <integer, integer> knuth_divmod(const integer & lhs, const integer & rhs) const;
+
         // division and modulus ignoring signs
         std::pair <integer, integer> dm(const integer & lhs, const integer & rhs) const;
 
@@ -815,4 +821,8 @@ integer pow(integer base, Z_e exponent, const Z_m modulus){
     return result;
 }
 
+// pow(base, exponent, modulus) on 64 bit words (no integer is built while the modulus is below 2^32:
+// the products fit into 64 bits), used by the Diffie-Hellman key exchange of the client.
+uint64_t powmod(uint64_t base, uint64_t exponent, const uint64_t modulus);
+
 #endif // INTEGER_H
@@ -0,0 +1,244 @@
+﻿/*
+limb_vector.h
+
+Contiguous storage for the digits (limbs) of integer.
+
+Digits are stored most significant first (same order as the old std::deque
+representation), so the buffer keeps free space on both sides: push_front()
+and push_back() are amortized O(1) and small values (up to INLINE_LIMBS
+digits) never touch the heap.
+*/
+
+#ifndef __LIMB_VECTOR__
+#define __LIMB_VECTOR__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <type_traits>
+
+template <typename T, std::size_t INLINE_LIMBS = 8>
+class limb_vector{
+    static_assert(std::is_trivially_copyable <T>::value
+                  , "limb_vector only stores trivially copyable digits");
+
+    public:
+        typedef T                                      value_type;
+        typedef std::size_t                            size_type;
+        typedef std::ptrdiff_t                         difference_type;
+        typedef T &                                    reference;
+        typedef const T &                              const_reference;
+        typedef T *                                    iterator;
+        typedef const T *                              const_iterator;
+        typedef std::reverse_iterator <iterator>       reverse_iterator;
+        typedef std::reverse_iterator <const_iterator> const_reverse_iterator;
+
+    private:
+        T *       _data;            // _inline or heap buffer
+        size_type _capacity;
+        size_type _begin;           // index of the first (most significant) digit
+        size_type _size;
+        T         _inline[INLINE_LIMBS];
+
+        bool on_heap() const {
+            return _data != _inline;
+        }
+
+        // make room for at least 'front' more digits before and 'back' more digits after the current ones
+        void grow(const size_type front, const size_type back){
+            size_type capacity = std::max(_capacity * 2, _size + front + back);
+            T * data = new T[capacity];
+
+            // split the free space between both sides (values grow in both directions)
+            size_type begin = front + (capacity - _size - front - back) / 2;
+            if (_size){
+                std::memcpy(data + begin, _data + _begin, _size * sizeof(T));
+            }
+
+            if (on_heap()){
+                delete[] _data;
+            }
+
+            _data     = data;
+            _capacity = capacity;
+            _begin    = begin;
+        }
+
+        void assign_from(const limb_vector & rhs){
+            if (rhs._size > _capacity){
+                if (on_heap()){
+                    delete[] _data;
+                }
+                _data     = new T[rhs._size];
+                _capacity = rhs._size;
+            }
+            _begin = 0;
+            _size  = rhs._size;
+            if (_size){
+                std::memcpy(_data, rhs._data + rhs._begin, _size * sizeof(T));
+            }
+        }
+
+    public:
+        limb_vector() :
+            _data(_inline),
+            _capacity(INLINE_LIMBS),
+            _begin(INLINE_LIMBS / 2),
+            _size(0)
+        {}
+
+        limb_vector(const size_type count, const T & value) : limb_vector()
+        {
+            insert(end(), count, value);
+        }
+
+        limb_vector(const limb_vector & rhs) : limb_vector()
+        {
+            assign_from(rhs);
+        }
+
+        limb_vector(limb_vector && rhs) : limb_vector()
+        {
+            *this = std::move(rhs);
+        }
+
+        ~limb_vector(){
+            if (on_heap()){
+                delete[] _data;
+            }
+        }
+
+        limb_vector & operator=(const limb_vector & rhs){
+            if (this != &rhs){
+                assign_from(rhs);
+            }
+            return *this;
+        }
+
+        limb_vector & operator=(limb_vector && rhs){
+            if (this == &rhs){
+                return *this;
+            }
+
+            if (rhs.on_heap()){
+                // steal the buffer
+                if (on_heap()){
+                    delete[] _data;
+                }
+                _data     = rhs._data;
+                _capacity = rhs._capacity;
+                _begin    = rhs._begin;
+                _size     = rhs._size;
+
+                rhs._data     = rhs._inline;
+                rhs._capacity = INLINE_LIMBS;
+                rhs._begin    = INLINE_LIMBS / 2;
+                rhs._size     = 0;
+            }
+            else{
+                assign_from(rhs);
+                rhs.clear();
+            }
+            return *this;
+        }
+
+        // Iterators
+        iterator               begin()        { return _data + _begin; }
+        const_iterator         begin()  const { return _data + _begin; }
+        iterator               end()          { return _data + _begin + _size; }
+        const_iterator         end()    const { return _data + _begin + _size; }
+        reverse_iterator       rbegin()       { return reverse_iterator(end()); }
+        const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+        reverse_iterator       rend()         { return reverse_iterator(begin()); }
+        const_reverse_iterator rend()   const { return const_reverse_iterator(begin()); }
+
+        // Capacity
+        size_type size()  const { return _size; }
+        bool      empty() const { return _size == 0; }
+
+        void reserve(const size_type count){
+            if (count > _capacity){
+                grow(0, count - _size);
+            }
+        }
+
+        // Element access
+        reference       operator[](const size_type i)       { return _data[_begin + i]; }
+        const_reference operator[](const size_type i) const { return _data[_begin + i]; }
+        reference       front()                             { return _data[_begin]; }
+        const_reference front()                       const { return _data[_begin]; }
+        reference       back()                              { return _data[_begin + _size - 1]; }
+        const_reference back()                        const { return _data[_begin + _size - 1]; }
+
+        // Modifiers
+        void clear(){
+            _begin = _capacity / 2;
+            _size  = 0;
+        }
+
+        void push_front(const T & value){
+            if (_begin == 0){
+                grow(1, 0);
+            }
+            _begin--;
+            _size++;
+            _data[_begin] = value;
+        }
+
+        void pop_front(){
+            _begin++;
+            _size--;
+        }
+
+        void push_back(const T & value){
+            if (_begin + _size == _capacity){
+                grow(0, 1);
+            }
+            _data[_begin + _size] = value;
+            _size++;
+        }
+
+        void pop_back(){
+            _size--;
+        }
+
+        iterator insert(const_iterator pos, const size_type count, const T & value){
+            const size_type index = pos - begin();
+            if (_begin + _size + count > _capacity){
+                grow(0, count);
+            }
+
+            T * at = _data + _begin + index;
+            std::memmove(at + count, at, (_size - index) * sizeof(T));
+            std::fill(at, at + count, value);
+            _size += count;
+
+            return at;
+        }
+
+        void resize(const size_type count, const T & value = T()){
+            if (count > _size){
+                insert(end(), count - _size, value);
+            }
+            else{
+                _size = count;
+            }
+        }
+
+        void swap(limb_vector & rhs){
+            limb_vector temp = std::move(rhs);
+            rhs   = std::move(*this);
+            *this = std::move(temp);
+        }
+
+        bool operator==(const limb_vector & rhs) const {
+            return (_size == rhs._size) && std::equal(begin(), end(), rhs.begin());
+        }
+
+        bool operator!=(const limb_vector & rhs) const {
+            return !(*this == rhs);
+        }
+};
+
+#endif
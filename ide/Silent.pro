@@ -39,16 +39,41 @@ FORMS += \
 
 HEADERS += \
     ../ext/AES/AES.h \
+    ../ext/AES/AESBackends.h \
     ../ext/integer/integer.h \
+    ../ext/integer/limb_vector.h \
+    ../src/Model/AudioBackend/audiobackend.h \
+    ../src/Model/AudioBackend/fileaudiobackend.h \
+    ../src/Model/AudioBackend/winmmaudiobackend.h \
+    ../src/Model/AudioCaptureRing/audiocapturering.h \
+    ../src/Model/AudioDSP/audiodsp.h \
+    ../src/Model/AudioMixer/audiomixer.h \
+    ../src/Model/AudioTimer/audiotimer.h \
     ../src/Controller/controller.h \
     ../src/Model/AudioService/audioservice.h \
+    ../src/Model/ChatLog/chatlog.h \
+    ../src/Model/DatagramBatch/datagrambatch.h \
+    ../src/Model/JitterBuffer/jitterbuffer.h \
+    ../src/Model/LatencyHistogram/latencyhistogram.h \
+    ../src/Model/ModelEventSink/modeleventsink.h \
+    ../src/Model/ModelEventSink/recordingeventsink.h \
     ../src/Model/NetworkService/networkservice.h \
     ../src/Model/OutputTextType.h \
     ../src/Model/SettingsManager/SettingsFile.h \
     ../src/Model/SettingsManager/settingsmanager.h \
+    ../src/Model/SocketReactor/socketreactor.h \
+    ../src/Model/TCPFrameReader/tcpframereader.h \
     ../src/Model/User.h \
+    ../src/Model/UserDirectory/userdirectory.h \
+    ../src/Model/VoiceActivityDetector/voiceactivitydetector.h \
+    ../src/Model/VoiceCipher/voicecipher.h \
+    ../src/Model/VoiceCodec/voicecodec.h \
+    ../src/Model/VoiceDatagram/voicedatagram.h \
+    ../src/Model/VoicePacketQueue/voicepacketqueue.h \
+    ../src/Model/VoicePathStats/voicepathstats.h \
     ../src/View/AboutQtWindow/aboutqtwindow.h \
     ../src/View/AboutWindow/aboutwindow.h \
+    ../src/View/ChatLogView/chatlogview.h \
     ../src/View/ConnectWindow/connectwindow.h \
     ../src/View/CustomList/SListItem/slistitem.h \
     ../src/View/CustomList/SListItemRoom/slistitemroom.h \
@@ -61,19 +86,43 @@ HEADERS += \
     ../src/View/SVoiceMeterWidget/svoicemeterwidget.h \
     ../src/View/SettingsWindow/settingswindow.h \
     ../src/View/SingleUserSettings/singleusersettings.h \
+    ../src/Model/net_messages.h \
     ../src/Model/net_params.h \
     ../src/View/StyleAndInfoPaths.h \
+    ../src/View/UserStateSnapshot/userstatesnapshot.h \
     ../src/View/WindowControlWidget/windowcontrolwidget.h
 
 SOURCES += \
     ../ext/AES/AES.cpp \
+    ../ext/AES/AESBackends.cpp \
     ../ext/integer/integer.cpp \
+    ../src/Model/AudioBackend/fileaudiobackend.cpp \
+    ../src/Model/AudioBackend/winmmaudiobackend.cpp \
+    ../src/Model/AudioCaptureRing/audiocapturering.cpp \
+    ../src/Model/AudioDSP/audiodsp.cpp \
+    ../src/Model/AudioMixer/audiomixer.cpp \
+    ../src/Model/AudioTimer/audiotimer.cpp \
     ../src/Controller/controller.cpp \
     ../src/Model/AudioService/audioservice.cpp \
+    ../src/Model/ChatLog/chatlog.cpp \
+    ../src/Model/DatagramBatch/datagrambatch.cpp \
+    ../src/Model/JitterBuffer/jitterbuffer.cpp \
+    ../src/Model/LatencyHistogram/latencyhistogram.cpp \
+    ../src/Model/ModelEventSink/recordingeventsink.cpp \
     ../src/Model/NetworkService/networkservice.cpp \
     ../src/Model/SettingsManager/settingsmanager.cpp \
+    ../src/Model/SocketReactor/socketreactor.cpp \
+    ../src/Model/TCPFrameReader/tcpframereader.cpp \
+    ../src/Model/UserDirectory/userdirectory.cpp \
+    ../src/Model/VoiceActivityDetector/voiceactivitydetector.cpp \
+    ../src/Model/VoiceCipher/voicecipher.cpp \
+    ../src/Model/VoiceCodec/voicecodec.cpp \
+    ../src/Model/VoiceDatagram/voicedatagram.cpp \
+    ../src/Model/VoicePacketQueue/voicepacketqueue.cpp \
+    ../src/Model/VoicePathStats/voicepathstats.cpp \
     ../src/View/AboutQtWindow/aboutqtwindow.cpp \
     ../src/View/AboutWindow/aboutwindow.cpp \
+    ../src/View/ChatLogView/chatlogview.cpp \
     ../src/View/ConnectWindow/connectwindow.cpp \
     ../src/View/CustomList/SListItem/slistitem.cpp \
     ../src/View/CustomList/SListItemRoom/slistitemroom.cpp \
@@ -85,6 +134,7 @@ SOURCES += \
     ../src/View/RoomPassInputWindow/roompassinputwindow.cpp \
     ../src/View/SVoiceMeterWidget/svoicemeterwidget.cpp \
     ../src/View/SingleUserSettings/singleusersettings.cpp \
+    ../src/View/UserStateSnapshot/userstatesnapshot.cpp \
     ../src/View/WindowControlWidget/windowcontrolwidget.cpp \
     ../src/main.cpp \
     ../src/View/SettingsWindow/settingswindow.cpp \
@@ -0,0 +1,48 @@
+#-------------------------------------------------
+#
+# Checks that the voice send path does not allocate memory per frame (no Qt, also builds on Linux).
+#
+#-------------------------------------------------
+
+TARGET = SilentAllocCheck
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += \
+    ../src \
+    ../ext
+
+unix: LIBS += -lpthread
+
+
+HEADERS += \
+    ../ext/AES/AES.h \
+    ../ext/AES/AESBackends.h \
+    ../src/Model/AudioBackend/audiobackend.h \
+    ../src/Model/AudioBackend/fileaudiobackend.h \
+    ../src/Model/AudioCaptureRing/audiocapturering.h \
+    ../src/Model/AudioDSP/audiodsp.h \
+    ../src/Model/VoiceActivityDetector/voiceactivitydetector.h \
+    ../src/Model/VoiceCipher/voicecipher.h \
+    ../src/Model/VoiceCodec/voicecodec.h \
+    ../src/Model/VoiceDatagram/voicedatagram.h \
+    ../src/Model/net_messages.h \
+    ../src/Model/net_params.h \
+    ../src/Tools/AllocCheck/alloccounter.h \
+    ../src/Tools/LoopbackServer/loopbacknet.h
+
+SOURCES += \
+    ../ext/AES/AES.cpp \
+    ../ext/AES/AESBackends.cpp \
+    ../src/Model/AudioBackend/fileaudiobackend.cpp \
+    ../src/Model/AudioCaptureRing/audiocapturering.cpp \
+    ../src/Model/AudioDSP/audiodsp.cpp \
+    ../src/Model/VoiceActivityDetector/voiceactivitydetector.cpp \
+    ../src/Model/VoiceCipher/voicecipher.cpp \
+    ../src/Model/VoiceCodec/voicecodec.cpp \
+    ../src/Model/VoiceDatagram/voicedatagram.cpp \
+    ../src/Tools/AllocCheck/alloccounter.cpp \
+    ../src/Tools/AllocCheck/main.cpp \
+    ../src/Tools/LoopbackServer/loopbacknet.cpp
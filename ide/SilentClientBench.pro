@@ -0,0 +1,88 @@
+#-------------------------------------------------
+#
+# Benchmarks of the client model (NetworkService and AudioService)
+# without the view and the audio devices (no Qt, Windows like the client).
+#
+#-------------------------------------------------
+
+TARGET = SilentClientBench
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += \
+    ../src \
+    ../ext
+
+win32: LIBS += -lws2_32 -lwinmm -luser32 -lshell32
+
+
+HEADERS += \
+    ../ext/AES/AES.h \
+    ../ext/AES/AESBackends.h \
+    ../ext/integer/integer.h \
+    ../ext/integer/limb_vector.h \
+    ../src/Model/AudioBackend/audiobackend.h \
+    ../src/Model/AudioBackend/fileaudiobackend.h \
+    ../src/Model/AudioBackend/winmmaudiobackend.h \
+    ../src/Model/AudioCaptureRing/audiocapturering.h \
+    ../src/Model/AudioDSP/audiodsp.h \
+    ../src/Model/AudioMixer/audiomixer.h \
+    ../src/Model/AudioService/audioservice.h \
+    ../src/Model/AudioTimer/audiotimer.h \
+    ../src/Model/DatagramBatch/datagrambatch.h \
+    ../src/Model/JitterBuffer/jitterbuffer.h \
+    ../src/Model/LatencyHistogram/latencyhistogram.h \
+    ../src/Model/ModelEventSink/modeleventsink.h \
+    ../src/Model/ModelEventSink/recordingeventsink.h \
+    ../src/Model/NetworkService/networkservice.h \
+    ../src/Model/OutputTextType.h \
+    ../src/Model/SettingsManager/SettingsFile.h \
+    ../src/Model/SettingsManager/settingsmanager.h \
+    ../src/Model/SocketReactor/socketreactor.h \
+    ../src/Model/TCPFrameReader/tcpframereader.h \
+    ../src/Model/User.h \
+    ../src/Model/UserDirectory/userdirectory.h \
+    ../src/Model/VoiceActivityDetector/voiceactivitydetector.h \
+    ../src/Model/VoiceCipher/voicecipher.h \
+    ../src/Model/VoiceCodec/voicecodec.h \
+    ../src/Model/VoiceDatagram/voicedatagram.h \
+    ../src/Model/VoicePacketQueue/voicepacketqueue.h \
+    ../src/Model/VoicePathStats/voicepathstats.h \
+    ../src/Model/net_messages.h \
+    ../src/Model/net_params.h \
+    ../src/Tools/ClientBench/benchclient.h \
+    ../src/Tools/LoopbackServer/loopbacknet.h \
+    ../src/Tools/LoopbackServer/loopbackserver.h
+
+SOURCES += \
+    ../ext/AES/AES.cpp \
+    ../ext/AES/AESBackends.cpp \
+    ../ext/integer/integer.cpp \
+    ../src/Model/AudioBackend/fileaudiobackend.cpp \
+    ../src/Model/AudioBackend/winmmaudiobackend.cpp \
+    ../src/Model/AudioCaptureRing/audiocapturering.cpp \
+    ../src/Model/AudioDSP/audiodsp.cpp \
+    ../src/Model/AudioMixer/audiomixer.cpp \
+    ../src/Model/AudioService/audioservice.cpp \
+    ../src/Model/AudioTimer/audiotimer.cpp \
+    ../src/Model/DatagramBatch/datagrambatch.cpp \
+    ../src/Model/JitterBuffer/jitterbuffer.cpp \
+    ../src/Model/LatencyHistogram/latencyhistogram.cpp \
+    ../src/Model/ModelEventSink/recordingeventsink.cpp \
+    ../src/Model/NetworkService/networkservice.cpp \
+    ../src/Model/SettingsManager/settingsmanager.cpp \
+    ../src/Model/SocketReactor/socketreactor.cpp \
+    ../src/Model/TCPFrameReader/tcpframereader.cpp \
+    ../src/Model/UserDirectory/userdirectory.cpp \
+    ../src/Model/VoiceActivityDetector/voiceactivitydetector.cpp \
+    ../src/Model/VoiceCipher/voicecipher.cpp \
+    ../src/Model/VoiceCodec/voicecodec.cpp \
+    ../src/Model/VoiceDatagram/voicedatagram.cpp \
+    ../src/Model/VoicePacketQueue/voicepacketqueue.cpp \
+    ../src/Model/VoicePathStats/voicepathstats.cpp \
+    ../src/Tools/ClientBench/benchclient.cpp \
+    ../src/Tools/ClientBench/main.cpp \
+    ../src/Tools/LoopbackServer/loopbacknet.cpp \
+    ../src/Tools/LoopbackServer/loopbackserver.cpp
@@ -0,0 +1,49 @@
+#-------------------------------------------------
+#
+# Stand-in Silent server and headless benchmark clients (no Qt).
+#
+#-------------------------------------------------
+
+TARGET = SilentLoopbackServer
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += \
+    ../src \
+    ../ext
+
+unix: LIBS += -lpthread
+
+
+HEADERS += \
+    ../ext/AES/AES.h \
+    ../ext/AES/AESBackends.h \
+    ../src/Model/AudioTimer/audiotimer.h \
+    ../src/Model/LatencyHistogram/latencyhistogram.h \
+    ../src/Model/VoiceCipher/voicecipher.h \
+    ../src/Model/VoiceCodec/voicecodec.h \
+    ../src/Model/VoiceDatagram/voicedatagram.h \
+    ../src/Model/net_messages.h \
+    ../src/Model/net_params.h \
+    ../src/Tools/LoopbackServer/loopbackcheck.h \
+    ../src/Tools/LoopbackServer/loopbackclient.h \
+    ../src/Tools/LoopbackServer/loopbacknet.h \
+    ../src/Tools/LoopbackServer/loopbackserver.h \
+    ../src/Tools/ModelChecks/modelchecks.h
+
+SOURCES += \
+    ../ext/AES/AES.cpp \
+    ../ext/AES/AESBackends.cpp \
+    ../src/Model/AudioTimer/audiotimer.cpp \
+    ../src/Model/LatencyHistogram/latencyhistogram.cpp \
+    ../src/Model/VoiceCipher/voicecipher.cpp \
+    ../src/Model/VoiceCodec/voicecodec.cpp \
+    ../src/Model/VoiceDatagram/voicedatagram.cpp \
+    ../src/Tools/LoopbackServer/loopbackcheck.cpp \
+    ../src/Tools/LoopbackServer/loopbackclient.cpp \
+    ../src/Tools/LoopbackServer/loopbacknet.cpp \
+    ../src/Tools/LoopbackServer/loopbackserver.cpp \
+    ../src/Tools/LoopbackServer/main.cpp \
+    ../src/Tools/ModelChecks/modelchecks.cpp
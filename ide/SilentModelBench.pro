@@ -0,0 +1,67 @@
+#-------------------------------------------------
+#
+# Benchmarks of the portable model parts (no Qt, also builds on Linux).
+#
+#-------------------------------------------------
+
+TARGET = SilentModelBench
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += \
+    ../src \
+    ../ext
+
+unix: LIBS += -lpthread
+
+
+HEADERS += \
+    ../ext/AES/AES.h \
+    ../ext/AES/AESBackends.h \
+    ../ext/integer/integer.h \
+    ../ext/integer/limb_vector.h \
+    ../src/Model/AudioBackend/audiobackend.h \
+    ../src/Model/AudioBackend/fileaudiobackend.h \
+    ../src/Model/AudioDSP/audiodsp.h \
+    ../src/Model/AudioMixer/audiomixer.h \
+    ../src/Model/ChatLog/chatlog.h \
+    ../src/Model/JitterBuffer/jitterbuffer.h \
+    ../src/Model/LatencyHistogram/latencyhistogram.h \
+    ../src/Model/User.h \
+    ../src/Model/UserDirectory/userdirectory.h \
+    ../src/Model/VoiceActivityDetector/voiceactivitydetector.h \
+    ../src/Model/VoiceCipher/voicecipher.h \
+    ../src/Model/VoiceCodec/voicecodec.h \
+    ../src/Model/VoicePacketQueue/voicepacketqueue.h \
+    ../src/Model/VoiceDatagram/voicedatagram.h \
+    ../src/Tools/ModelBench/modelbench.h \
+    ../src/Tools/VoiceFixtures/voicefixtures.h
+
+SOURCES += \
+    ../ext/AES/AES.cpp \
+    ../ext/AES/AESBackends.cpp \
+    ../ext/integer/integer.cpp \
+    ../src/Model/AudioBackend/fileaudiobackend.cpp \
+    ../src/Model/AudioDSP/audiodsp.cpp \
+    ../src/Model/AudioMixer/audiomixer.cpp \
+    ../src/Model/ChatLog/chatlog.cpp \
+    ../src/Model/JitterBuffer/jitterbuffer.cpp \
+    ../src/Model/LatencyHistogram/latencyhistogram.cpp \
+    ../src/Model/UserDirectory/userdirectory.cpp \
+    ../src/Model/VoiceActivityDetector/voiceactivitydetector.cpp \
+    ../src/Model/VoiceCipher/voicecipher.cpp \
+    ../src/Model/VoiceCodec/voicecodec.cpp \
+    ../src/Model/VoiceDatagram/voicedatagram.cpp \
+    ../src/Model/VoicePacketQueue/voicepacketqueue.cpp \
+    ../src/Tools/ModelBench/chatlogbench.cpp \
+    ../src/Tools/ModelBench/codecbench.cpp \
+    ../src/Tools/ModelBench/dspbench.cpp \
+    ../src/Tools/ModelBench/handshakebench.cpp \
+    ../src/Tools/ModelBench/integerbench.cpp \
+    ../src/Tools/ModelBench/main.cpp \
+    ../src/Tools/ModelBench/mixerbench.cpp \
+    ../src/Tools/ModelBench/userdirectorybench.cpp \
+    ../src/Tools/ModelBench/vadbench.cpp \
+    ../src/Tools/VoiceFixtures/voicefixtures.cpp
@@ -0,0 +1,61 @@
+#-------------------------------------------------
+#
+# Regression checks of the portable model parts (no Qt, also builds on Linux).
+#
+#-------------------------------------------------
+
+TARGET = SilentModelChecks
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += \
+    ../src \
+    ../ext
+
+unix: LIBS += -lpthread
+
+
+HEADERS += \
+    ../ext/AES/AES.h \
+    ../ext/AES/AESBackends.h \
+    ../ext/integer/integer.h \
+    ../ext/integer/limb_vector.h \
+    ../src/Model/AudioDSP/audiodsp.h \
+    ../src/Model/AudioTimer/audiotimer.h \
+    ../src/Model/ChatLog/chatlog.h \
+    ../src/Model/JitterBuffer/jitterbuffer.h \
+    ../src/Model/TCPFrameReader/tcpframereader.h \
+    ../src/Model/User.h \
+    ../src/Model/UserDirectory/userdirectory.h \
+    ../src/Model/VoiceActivityDetector/voiceactivitydetector.h \
+    ../src/Model/VoicePacketQueue/voicepacketqueue.h \
+    ../src/Model/net_messages.h \
+    ../src/Tools/ModelChecks/modelchecks.h \
+    ../src/Tools/VoiceFixtures/voicefixtures.h
+
+SOURCES += \
+    ../ext/AES/AES.cpp \
+    ../ext/AES/AESBackends.cpp \
+    ../ext/integer/integer.cpp \
+    ../src/Model/AudioDSP/audiodsp.cpp \
+    ../src/Model/AudioTimer/audiotimer.cpp \
+    ../src/Model/ChatLog/chatlog.cpp \
+    ../src/Model/JitterBuffer/jitterbuffer.cpp \
+    ../src/Model/TCPFrameReader/tcpframereader.cpp \
+    ../src/Model/UserDirectory/userdirectory.cpp \
+    ../src/Model/VoiceActivityDetector/voiceactivitydetector.cpp \
+    ../src/Model/VoicePacketQueue/voicepacketqueue.cpp \
+    ../src/Tools/ModelChecks/aeschecks.cpp \
+    ../src/Tools/ModelChecks/audiotimerchecks.cpp \
+    ../src/Tools/ModelChecks/chatlogchecks.cpp \
+    ../src/Tools/ModelChecks/dspchecks.cpp \
+    ../src/Tools/ModelChecks/integerchecks.cpp \
+    ../src/Tools/ModelChecks/jitterbufferchecks.cpp \
+    ../src/Tools/ModelChecks/main.cpp \
+    ../src/Tools/ModelChecks/modelchecks.cpp \
+    ../src/Tools/ModelChecks/tcpframechecks.cpp \
+    ../src/Tools/ModelChecks/userdirectorychecks.cpp \
+    ../src/Tools/ModelChecks/vadchecks.cpp \
+    ../src/Tools/VoiceFixtures/voicefixtures.cpp
@@ -0,0 +1,31 @@
+#-------------------------------------------------
+#
+# libFuzzer target of the TCP message framing (TCPFrameReader), needs clang (no Qt, also builds on Linux).
+#
+#-------------------------------------------------
+
+TARGET = SilentTCPFrameFuzz
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= qt app_bundle
+
+QMAKE_CC   = clang
+QMAKE_CXX  = clang++
+QMAKE_LINK = clang++
+
+QMAKE_CXXFLAGS += -g -fsanitize=fuzzer,address,undefined
+QMAKE_LFLAGS   += -fsanitize=fuzzer,address,undefined
+
+INCLUDEPATH += \
+    ../src \
+    ../ext
+
+
+HEADERS += \
+    ../src/Model/TCPFrameReader/tcpframereader.h \
+    ../src/Model/net_messages.h
+
+SOURCES += \
+    ../src/Model/TCPFrameReader/tcpframereader.cpp \
+    ../src/Tools/TCPFrameFuzz/tcpframefuzz.cpp
@@ -7,7 +7,7 @@
 
 
 // Custom
-#include "View/MainWindow/mainwindow.h"
+#include "Model/ModelEventSink/modeleventsink.h"
 #include "Model/NetworkService/networkservice.h"
 #include "Model/AudioService/audioservice.h"
 #include "Model/SettingsManager/settingsmanager.h"
@@ -19,7 +19,7 @@
 // ------------------------------------------------------------------------------------------------
 
 
-Controller::Controller(MainWindow* pMainWindow)
+Controller::Controller(ModelEventSink* pEventSink)
 {
     pAudioService    = nullptr;
     pNetworkService  = nullptr;
@@ -28,14 +28,14 @@ Controller::Controller(MainWindow* pMainWindow)
 
     mtxSettings.lock();
 
-    pSettingsManager = new SettingsManager (pMainWindow);
+    pSettingsManager = new SettingsManager (pEventSink);
 
     mtxSettings.unlock();
 
     if (pSettingsManager->getCurrentSettings())
     {
-        pAudioService    = new AudioService    (pMainWindow, pSettingsManager);
-        pNetworkService  = new NetworkService  (pMainWindow, pAudioService, pSettingsManager);
+        pAudioService    = new AudioService    (pEventSink, pSettingsManager);
+        pNetworkService  = new NetworkService  (pEventSink, pAudioService, pSettingsManager);
 
         pAudioService   ->setNetworkService   (pNetworkService);
     }
@@ -45,9 +45,9 @@ Controller::Controller(MainWindow* pMainWindow)
         // If the SettingsManager returns nullptr then AudioService will crash
         // because it's not checking if the settings is nullptr.
 
-        pMainWindow->showMessageBox(true, "The application cannot continue execution.\n"
-                                           "Please, tell the developers about this problem.\n"
-                                           "You still can use menu item \"Help\" - \"About\" to get in touch with the devs.");
+        pEventSink->showMessageBox(true, "The application cannot continue execution.\n"
+                                          "Please, tell the developers about this problem.\n"
+                                          "You still can use menu item \"Help\" - \"About\" to get in touch with the devs.");
     }
 }
 
@@ -90,9 +90,9 @@ bool Controller::isSettingsFileInOldFormat()
     return pSettingsManager->isSettingsFileInOldFormat();
 }
 
-SListItemRoom *Controller::getCurrentUserRoom()
+std::string Controller::getCurrentUserRoomName()
 {
-    return pNetworkService->getUserRoom();
+    return pNetworkService->getUserRoomName();
 }
 
 std::vector<std::wstring> Controller::getInputDevices()
@@ -137,6 +137,11 @@ bool Controller::getMuteMic()
     return pAudioService->getMuteMic();
 }
 
+void Controller::saveVoiceLatencyStats()
+{
+    pAudioService->saveVoicePathStats();
+}
+
 SettingsManager *Controller::getSettingsManager()
 {
     mtxSettings.lock();
@@ -191,6 +196,14 @@ void Controller::applyVoiceStartValue(int iValue)
     }
 }
 
+void Controller::applyVoiceNoiseGating(bool bEnable)
+{
+    if (pAudioService)
+    {
+        pAudioService->setVoiceNoiseGating(bEnable);
+    }
+}
+
 void Controller::applyShouldHearTestVoice(bool bHear)
 {
     if (pAudioService)
@@ -14,10 +14,9 @@
 
 class NetworkService;
 class AudioService;
-class MainWindow;
+class ModelEventSink;
 class SettingsManager;
 class SettingsFile;
-class SListItemRoom;
 
 
 // ------------------------------------------------------------------------------------------------
@@ -29,7 +28,8 @@ class Controller
 {
 public:
 
-    Controller(MainWindow* pMainWindow);
+    // 'pEventSink' gets everything the model shows (MainWindow or a RecordingEventSink for the headless runs).
+    Controller(ModelEventSink* pEventSink);
 
 
 
@@ -54,6 +54,7 @@ public:
         void           applyNewMasterVolumeFromSettings       ();
         void           applyAudioInputVolume      (int iVolume);
         void           applyVoiceStartValue       (int iValue);
+        void           applyVoiceNoiseGating      (bool bEnable);
         void           applyShouldHearTestVoice   (bool bHear);
         void           setNewUserVolume           (std::string sUserName,  float fVolume);
 
@@ -63,6 +64,7 @@ public:
         void           playMuteMicSound           (bool bMuteSound);
         void           setMuteMic                 (bool bMute);
         bool           getMuteMic                 ();
+        void           saveVoiceLatencyStats      ();
 
 
     // GET functions
@@ -74,7 +76,7 @@ public:
         SettingsFile*  getCurrentSettingsFile     ();
         bool           isSettingsCreatedFirstTime ();
         bool           isSettingsFileInOldFormat  ();
-        SListItemRoom* getCurrentUserRoom         ();
+        std::string    getCurrentUserRoomName     ();
         std::vector<std::wstring> getInputDevices ();
 
 
@@ -0,0 +1,139 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <string>
+#include <vector>
+#include <cstddef>
+
+
+// Mono PCM16.
+struct AudioStreamFormat
+{
+    unsigned int  iSampleRate;
+
+    // Samples in one frame (read() / write() work with whole frames).
+    size_t        iFrameSamples;
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Opened by AudioBackend::openCapture(), closed when deleted.
+// All functions return true if failed (see getLastError()).
+class AudioCaptureStream
+{
+
+public:
+
+    // Starts recording (also after stop()).
+
+        virtual bool                 start              () = 0;
+
+
+    // Blocks until the next frame is recorded and copies it to 'pFrameOut' ('iFrameSamples' samples).
+    // Returns true if there is nothing more to read: not started, stopped and drained or failed.
+
+        virtual bool                 read               (short int* pFrameOut) = 0;
+
+
+    // Stops recording new frames, the frames that are already being recorded can still be read()
+    // (so the end of the speech is not cut off).
+
+        virtual void                 stop               () = 0;
+
+
+    // Empty if there were no errors.
+
+        virtual const std::string&   getLastError       () const = 0;
+
+
+    virtual ~AudioCaptureStream() {}
+};
+
+
+
+// Opened by AudioBackend::openPlayback(), closed when deleted.
+// Frames are played in the order they were written, write() copies the frame.
+class AudioPlaybackStream
+{
+
+public:
+
+    // 0 - 0xFFFF.
+
+        virtual void                 setVolume          (unsigned short int iVolume) = 0;
+
+
+    // How many frames can be written right now without waiting.
+
+        virtual size_t               getFreeFrameCount  () = 0;
+
+
+    // Should be called only if getFreeFrameCount() is not 0. Returns true if failed (see getLastError()).
+
+        virtual bool                 write              (const short int* pFrame) = 0;
+
+
+    // Blocks until a written frame is played (its buffer is free again) or wakeUp() is called.
+    // Can return earlier, so the caller checks getFreeFrameCount() (and its own state) after it.
+
+        virtual void                 waitForFreeFrame   () = 0;
+
+
+    // Makes the current (or the next) waitForFreeFrame() return right away. Can be called from any thread.
+
+        virtual void                 wakeUp             () = 0;
+
+
+    // Stops playing and drops all written frames.
+
+        virtual void                 reset              () = 0;
+
+
+        virtual const std::string&   getLastError       () const = 0;
+
+
+    virtual ~AudioPlaybackStream() {}
+};
+
+
+
+// The audio device layer of the AudioService: capture, playback, device list, push-to-talk key and notification sounds.
+// WinMMAudioBackend is used by the client, FileAudioBackend runs the AudioService without any audio devices.
+class AudioBackend
+{
+
+public:
+
+    // Names for openCapture().
+
+        virtual std::vector<std::wstring>  getInputDevices  () = 0;
+
+
+    // Return nullptr if failed (the error is written to 'sErrorOut').
+    // An empty or not found 'sDeviceName' opens the default device.
+
+        virtual AudioCaptureStream*   openCapture        (const std::wstring& sDeviceName, const AudioStreamFormat& format, std::string& sErrorOut) = 0;
+        virtual AudioPlaybackStream*  openPlayback       (const AudioStreamFormat& format, size_t iFrameCount, std::string& sErrorOut) = 0;
+
+
+    // Other
+
+        virtual bool                  isKeyPressed       (int iVirtualKey) = 0;
+
+        // Plays the sound file on the default output device. Blocks until played if 'bWait' is true.
+        virtual void                  playSoundFile      (const std::wstring& sPath, bool bWait) = 0;
+
+
+    virtual ~AudioBackend() {}
+};
@@ -0,0 +1,587 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "fileaudiobackend.h"
+
+
+// STL
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <deque>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+
+#define  WAV_HEADER_SIZE  44
+
+
+
+typedef std::chrono::steady_clock  AudioClock;
+
+
+// Zero if 'fClockSpeed' is 0 (no waiting).
+static AudioClock::duration getFrameDuration(const AudioStreamFormat& format, float fClockSpeed)
+{
+    if (fClockSpeed <= 0.0f)
+    {
+        return AudioClock::duration::zero();
+    }
+
+    double dSeconds = static_cast<double>(format.iFrameSamples) / format.iSampleRate / static_cast<double>(fClockSpeed);
+
+    return std::chrono::duration_cast<AudioClock::duration>( std::chrono::duration<double>(dSeconds) );
+}
+
+static void writeWavHeader(std::ofstream& file, unsigned int iSampleRate, unsigned int iDataSize)
+{
+    // Mono PCM16.
+
+    unsigned int   iChunkSize     = 36 + iDataSize;
+    unsigned int   iFmtSize       = 16;
+    unsigned short iAudioFormat   = 1;
+    unsigned short iChannels      = 1;
+    unsigned int   iByteRate      = iSampleRate * 2;
+    unsigned short iBlockAlign    = 2;
+    unsigned short iBitsPerSample = 16;
+
+    file.write("RIFF", 4);
+    file.write(reinterpret_cast<const char*>(&iChunkSize),     sizeof(iChunkSize));
+    file.write("WAVE", 4);
+
+    file.write("fmt ", 4);
+    file.write(reinterpret_cast<const char*>(&iFmtSize),       sizeof(iFmtSize));
+    file.write(reinterpret_cast<const char*>(&iAudioFormat),   sizeof(iAudioFormat));
+    file.write(reinterpret_cast<const char*>(&iChannels),      sizeof(iChannels));
+    file.write(reinterpret_cast<const char*>(&iSampleRate),    sizeof(iSampleRate));
+    file.write(reinterpret_cast<const char*>(&iByteRate),      sizeof(iByteRate));
+    file.write(reinterpret_cast<const char*>(&iBlockAlign),    sizeof(iBlockAlign));
+    file.write(reinterpret_cast<const char*>(&iBitsPerSample), sizeof(iBitsPerSample));
+
+    file.write("data", 4);
+    file.write(reinterpret_cast<const char*>(&iDataSize),      sizeof(iDataSize));
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// A frame is "recorded" every frame duration (by the clock), the fixture is looped.
+class FileCaptureStream : public AudioCaptureStream
+{
+
+public:
+
+    FileCaptureStream(const std::vector<short int>& vSamples, const AudioStreamFormat& format, float fClockSpeed)
+    {
+        this->vSamples = vSamples;
+
+        iFrameSamples  = format.iFrameSamples;
+        frameDuration  = getFrameDuration(format, fClockSpeed);
+
+        iReadPos       = 0;
+        bStarted       = false;
+        bStopping      = false;
+    }
+
+    bool start() override
+    {
+        sLastError.clear();
+
+        bStopping      = false;
+        bStarted       = true;
+
+        // The first frame is ready after one frame duration like on a real device.
+        nextFrameTime  = AudioClock::now() + frameDuration;
+
+        return false;
+    }
+
+    bool read(short int* pFrameOut) override
+    {
+        if (bStarted == false)
+        {
+            return true;
+        }
+
+
+        std::this_thread::sleep_until(nextFrameTime);
+
+        nextFrameTime += frameDuration;
+
+
+        if (vSamples.empty())
+        {
+            std::memset( pFrameOut, 0, iFrameSamples * sizeof(short int) );
+        }
+        else
+        {
+            for (size_t i = 0;  i < iFrameSamples;  i++)
+            {
+                pFrameOut[i] = vSamples[iReadPos];
+
+                iReadPos = (iReadPos + 1) % vSamples.size();
+            }
+        }
+
+
+        if (bStopping)
+        {
+            // That was the frame that was being recorded when stop() was called.
+            bStarted = false;
+        }
+
+
+        return false;
+    }
+
+    void stop() override
+    {
+        bStopping = true;
+    }
+
+    const std::string& getLastError() const override
+    {
+        return sLastError;
+    }
+
+private:
+
+    std::vector<short int>  vSamples;
+
+    size_t                  iFrameSamples;
+    size_t                  iReadPos;
+
+    AudioClock::duration    frameDuration;
+    AudioClock::time_point  nextFrameTime;
+
+    std::atomic<bool>       bStarted;
+    std::atomic<bool>       bStopping;
+
+    std::string             sLastError;
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Written frames are queued one after another (by the clock) and take a buffer until "played".
+// The frames are written to the file (with the volume applied) right away, the pauses between them are not.
+class FilePlaybackStream : public AudioPlaybackStream
+{
+
+public:
+
+    FilePlaybackStream(const std::string& sOutputWavPath, const AudioStreamFormat& format, size_t iFrameCount, float fClockSpeed)
+    {
+        iSampleRate    = format.iSampleRate;
+        iFrameSamples  = format.iFrameSamples;
+        this->iFrameCount = iFrameCount;
+
+        frameDuration  = getFrameDuration(format, fClockSpeed);
+        lastFrameEnd   = AudioClock::now();
+
+        iVolume        = 0xFFFF;
+        iWrittenBytes  = 0;
+        bWakeUp        = false;
+
+        vScaledFrame.resize(iFrameSamples);
+
+
+        pFile = nullptr;
+
+        if (sOutputWavPath.empty() == false)
+        {
+            pFile = new std::ofstream(sOutputWavPath, std::ios::binary | std::ios::trunc);
+
+            if (pFile->is_open() == false)
+            {
+                sLastError = "can't open the file \"" + sOutputWavPath + "\" for writing.";
+
+                delete pFile;
+                pFile = nullptr;
+            }
+            else
+            {
+                // The sizes are written when closed.
+                writeWavHeader(*pFile, iSampleRate, 0);
+            }
+        }
+    }
+
+    void setVolume(unsigned short int iVolume) override
+    {
+        this->iVolume = iVolume;
+    }
+
+    size_t getFreeFrameCount() override
+    {
+        AudioClock::time_point now = AudioClock::now();
+
+        while ( (vQueuedFrameEnds.empty() == false) && (vQueuedFrameEnds.front() <= now) )
+        {
+            vQueuedFrameEnds.pop_front();
+        }
+
+        return iFrameCount - vQueuedFrameEnds.size();
+    }
+
+    bool write(const short int* pFrame) override
+    {
+        if (getFreeFrameCount() == 0)
+        {
+            sLastError = "no free output buffers.";
+
+            return true;
+        }
+
+
+        // Starts after the previous frame or right now if the output was idle.
+
+        AudioClock::time_point now = AudioClock::now();
+
+        if (lastFrameEnd < now)
+        {
+            lastFrameEnd = now;
+        }
+
+        lastFrameEnd += frameDuration;
+
+        vQueuedFrameEnds.push_back(lastFrameEnd);
+
+
+        if (pFile)
+        {
+            unsigned int iCurrentVolume = iVolume;
+
+            for (size_t i = 0;  i < iFrameSamples;  i++)
+            {
+                vScaledFrame[i] = static_cast<short int>( static_cast<int>(pFrame[i]) * static_cast<int>(iCurrentVolume) / 0xFFFF );
+            }
+
+            pFile->write( reinterpret_cast<const char*>(vScaledFrame.data()), static_cast<std::streamsize>(iFrameSamples * sizeof(short int)) );
+
+            iWrittenBytes += static_cast<unsigned int>(iFrameSamples * sizeof(short int));
+        }
+
+
+        return false;
+    }
+
+    void waitForFreeFrame() override
+    {
+        std::unique_lock<std::mutex> lock(mtxWakeUp);
+
+        if (vQueuedFrameEnds.empty())
+        {
+            // Nothing is playing, only wakeUp() can change that.
+            cvWakeUp.wait(lock, [this]{ return bWakeUp; });
+        }
+        else
+        {
+            cvWakeUp.wait_until(lock, vQueuedFrameEnds.front(), [this]{ return bWakeUp; });
+        }
+
+        bWakeUp = false;
+    }
+
+    void wakeUp() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtxWakeUp);
+
+            bWakeUp = true;
+        }
+
+        cvWakeUp.notify_one();
+    }
+
+    void reset() override
+    {
+        vQueuedFrameEnds.clear();
+
+        lastFrameEnd = AudioClock::now();
+    }
+
+    const std::string& getLastError() const override
+    {
+        return sLastError;
+    }
+
+    ~FilePlaybackStream() override
+    {
+        if (pFile)
+        {
+            pFile->seekp(0);
+
+            writeWavHeader(*pFile, iSampleRate, iWrittenBytes);
+
+            pFile->close();
+
+            delete pFile;
+        }
+    }
+
+private:
+
+    std::ofstream*                      pFile;
+
+    std::deque<AudioClock::time_point>  vQueuedFrameEnds;
+    AudioClock::time_point              lastFrameEnd;
+    AudioClock::duration                frameDuration;
+
+    std::vector<short int>              vScaledFrame;
+
+    unsigned int                        iSampleRate;
+    size_t                              iFrameSamples;
+    size_t                              iFrameCount;
+    unsigned int                        iWrittenBytes;
+
+    std::atomic<unsigned short int>     iVolume;
+
+    // Like the "buffer done" event of a device: set by wakeUp(), reset by waitForFreeFrame().
+    std::mutex                          mtxWakeUp;
+    std::condition_variable             cvWakeUp;
+    bool                                bWakeUp;
+
+    std::string                         sLastError;
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+FileAudioBackend::FileAudioBackend(const std::string& sInputWavPath, const std::string& sOutputWavPathPrefix, float fClockSpeed)
+{
+    this->sInputWavPath        = sInputWavPath;
+    this->sOutputWavPathPrefix = sOutputWavPathPrefix;
+    this->fClockSpeed          = fClockSpeed;
+
+    iOpenedPlaybackCount       = 0;
+    bPushToTalkPressed         = false;
+}
+
+std::vector<std::wstring> FileAudioBackend::getInputDevices()
+{
+    std::vector<std::wstring> vDevices;
+    vDevices.push_back(L"File");
+
+    return vDevices;
+}
+
+AudioCaptureStream* FileAudioBackend::openCapture(const std::wstring& sDeviceName, const AudioStreamFormat& format, std::string& sErrorOut)
+{
+    (void)sDeviceName;
+
+
+    std::vector<short int> vSamples;
+
+    if ( sInputWavPath.empty() == false )
+    {
+        if ( readWavFile(sInputWavPath, format.iSampleRate, vSamples, sErrorOut) )
+        {
+            return nullptr;
+        }
+    }
+
+
+    return new FileCaptureStream(vSamples, format, fClockSpeed);
+}
+
+AudioPlaybackStream* FileAudioBackend::openPlayback(const AudioStreamFormat& format, size_t iFrameCount, std::string& sErrorOut)
+{
+    std::string sOutputWavPath;
+
+    if ( sOutputWavPathPrefix.empty() == false )
+    {
+        sOutputWavPath = sOutputWavPathPrefix + std::to_string(iOpenedPlaybackCount) + ".wav";
+    }
+
+    iOpenedPlaybackCount++;
+
+
+    FilePlaybackStream* pStream = new FilePlaybackStream(sOutputWavPath, format, iFrameCount, fClockSpeed);
+
+    if (pStream->getLastError().empty() == false)
+    {
+        sErrorOut = pStream->getLastError();
+
+        delete pStream;
+
+        return nullptr;
+    }
+
+
+    return pStream;
+}
+
+bool FileAudioBackend::isKeyPressed(int iVirtualKey)
+{
+    (void)iVirtualKey;
+
+    return bPushToTalkPressed;
+}
+
+void FileAudioBackend::playSoundFile(const std::wstring& sPath, bool bWait)
+{
+    (void)sPath;
+    (void)bWait;
+}
+
+void FileAudioBackend::setPushToTalkPressed(bool bPressed)
+{
+    bPushToTalkPressed = bPressed;
+}
+
+bool FileAudioBackend::readWavFile(const std::string& sPath, unsigned int iSampleRate, std::vector<short int>& vSamplesOut, std::string& sErrorOut)
+{
+    std::ifstream file(sPath, std::ios::binary);
+
+    if (file.is_open() == false)
+    {
+        sErrorOut = "can't open the file \"" + sPath + "\".";
+
+        return true;
+    }
+
+    std::vector<char> vFile( (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>() );
+
+
+    if ( (vFile.size() < 12) || (std::memcmp(vFile.data(), "RIFF", 4) != 0) || (std::memcmp(vFile.data() + 8, "WAVE", 4) != 0) )
+    {
+        sErrorOut = "\"" + sPath + "\" is not a WAV file.";
+
+        return true;
+    }
+
+
+
+    // Find the format and the data chunks.
+
+    unsigned short iAudioFormat   = 0;
+    unsigned short iChannels      = 0;
+    unsigned int   iFileRate      = 0;
+    unsigned short iBitsPerSample = 0;
+
+    const char*    pData          = nullptr;
+    size_t         iDataSize      = 0;
+
+    size_t iPos = 12;
+
+    while (iPos + 8 <= vFile.size())
+    {
+        unsigned int iChunkSize = 0;
+        std::memcpy(&iChunkSize, vFile.data() + iPos + 4, sizeof(iChunkSize));
+
+        const char* pChunk     = vFile.data() + iPos + 8;
+        size_t      iAvailable = vFile.size() - iPos - 8;
+
+        if ( (std::memcmp(vFile.data() + iPos, "fmt ", 4) == 0) && (iAvailable >= 16) )
+        {
+            std::memcpy(&iAudioFormat,   pChunk,      sizeof(iAudioFormat));
+            std::memcpy(&iChannels,      pChunk + 2,  sizeof(iChannels));
+            std::memcpy(&iFileRate,      pChunk + 4,  sizeof(iFileRate));
+            std::memcpy(&iBitsPerSample, pChunk + 14, sizeof(iBitsPerSample));
+        }
+        else if (std::memcmp(vFile.data() + iPos, "data", 4) == 0)
+        {
+            pData     = pChunk;
+            iDataSize = std::min(static_cast<size_t>(iChunkSize), iAvailable);
+        }
+
+        // Chunks are aligned to 2 bytes.
+        iPos += 8 + static_cast<size_t>(iChunkSize) + (iChunkSize % 2);
+    }
+
+
+    // 0xFFFE - WAVE_FORMAT_EXTENSIBLE (PCM is the common case).
+    if ( ((iAudioFormat != 1) && (iAudioFormat != 0xFFFE)) || (iChannels == 0) || (iFileRate == 0)
+         || ((iBitsPerSample != 8) && (iBitsPerSample != 16)) || (pData == nullptr) )
+    {
+        sErrorOut = "\"" + sPath + "\" is not a PCM 8/16 bit WAV file.";
+
+        return true;
+    }
+
+
+
+    // Mix to mono.
+
+    size_t iBytesPerSample = iBitsPerSample / 8;
+    size_t iFileFrameCount = iDataSize / (iBytesPerSample * iChannels);
+
+    std::vector<int> vMono(iFileFrameCount);
+
+    for (size_t i = 0;  i < iFileFrameCount;  i++)
+    {
+        int iSum = 0;
+
+        for (size_t c = 0;  c < iChannels;  c++)
+        {
+            const char* pSample = pData + (i * iChannels + c) * iBytesPerSample;
+
+            if (iBitsPerSample == 8)
+            {
+                // Unsigned.
+                iSum += (static_cast<int>(static_cast<unsigned char>(*pSample)) - 128) * 256;
+            }
+            else
+            {
+                short int iSample = 0;
+                std::memcpy(&iSample, pSample, sizeof(iSample));
+
+                iSum += iSample;
+            }
+        }
+
+        vMono[i] = iSum / static_cast<int>(iChannels);
+    }
+
+
+
+    // Resample (linear).
+
+    vSamplesOut.clear();
+
+    if (iFileRate == iSampleRate)
+    {
+        vSamplesOut.assign(vMono.begin(), vMono.end());
+
+        return false;
+    }
+
+    size_t iOutCount = static_cast<size_t>( static_cast<unsigned long long>(iFileFrameCount) * iSampleRate / iFileRate );
+
+    vSamplesOut.resize(iOutCount);
+
+    double dStep = static_cast<double>(iFileRate) / iSampleRate;
+
+    for (size_t i = 0;  i < iOutCount;  i++)
+    {
+        double dPos   = i * dStep;
+        size_t iIndex = static_cast<size_t>(dPos);
+        double dFrac  = dPos - static_cast<double>(iIndex);
+
+        int iFirst    = vMono[iIndex];
+        int iSecond   = (iIndex + 1 < iFileFrameCount) ? vMono[iIndex + 1] : iFirst;
+
+        vSamplesOut[i] = static_cast<short int>( iFirst + (iSecond - iFirst) * dFrac );
+    }
+
+
+    return false;
+}
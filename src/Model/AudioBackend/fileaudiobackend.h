@@ -0,0 +1,70 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <atomic>
+
+// Custom
+#include "Model/AudioBackend/audiobackend.h"
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Runs the AudioService without audio devices (and without Windows) so the capture, voice activation
+// and playback paths can be run and profiled on any machine.
+// Capture streams loop a WAV fixture (PCM 8/16 bit, any channel count and sample rate: it's converted
+// to the stream format once when the stream is opened), playback streams write the played frames to WAV files.
+// Both are paced by a clock: 'fClockSpeed' 1.0 is real time, 2.0 is twice as fast, 0.0 is as fast as possible.
+class FileAudioBackend : public AudioBackend
+{
+
+public:
+
+    // Empty 'sInputWavPath' - capture the silence.
+    // Playback streams write to 'sOutputWavPathPrefix' + <number of the stream in the open order> + ".wav"
+    // (the first opened stream is 0), empty 'sOutputWavPathPrefix' - the played audio is discarded.
+    FileAudioBackend(const std::string& sInputWavPath, const std::string& sOutputWavPathPrefix, float fClockSpeed = 1.0f);
+
+
+        std::vector<std::wstring>  getInputDevices  () override;
+
+        AudioCaptureStream*   openCapture        (const std::wstring& sDeviceName, const AudioStreamFormat& format, std::string& sErrorOut) override;
+        AudioPlaybackStream*  openPlayback       (const AudioStreamFormat& format, size_t iFrameCount, std::string& sErrorOut) override;
+
+        // Returns the value set in setPushToTalkPressed() for any key.
+        bool                  isKeyPressed       (int iVirtualKey) override;
+
+        // Does nothing.
+        void                  playSoundFile      (const std::wstring& sPath, bool bWait) override;
+
+
+    // Scripted push-to-talk button.
+
+        void                  setPushToTalkPressed (bool bPressed);
+
+
+    // Reads a PCM WAV file, mixes all channels to mono and resamples it to 'iSampleRate'.
+    // Returns true if failed (the error is written to 'sErrorOut').
+
+        static bool           readWavFile        (const std::string& sPath, unsigned int iSampleRate, std::vector<short int>& vSamplesOut, std::string& sErrorOut);
+
+private:
+
+    std::string        sInputWavPath;
+    std::string        sOutputWavPathPrefix;
+
+    float              fClockSpeed;
+
+    size_t             iOpenedPlaybackCount;
+
+    std::atomic<bool>  bPushToTalkPressed;
+};
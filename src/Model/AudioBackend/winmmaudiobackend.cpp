@@ -0,0 +1,591 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "winmmaudiobackend.h"
+
+
+// STL
+#include <cstring>
+
+// Other
+#define _WINSOCKAPI_    // stops windows.h from including winsock.h
+#include <Windows.h>
+#include "Mmsystem.h"
+
+
+// for mmsystem
+#pragma comment(lib,"Winmm.lib")
+// for GetAsyncKeyState
+#pragma comment(lib, "user32.lib")
+
+
+
+static std::string getWaveErrorText(const char* pFunctionName, MMRESULT result)
+{
+    char fault [256];
+    memset (fault, 0, 256);
+
+    waveInGetErrorTextA (result, fault, 256);
+
+    return std::string(pFunctionName) + "() error (" + std::to_string(result) + "): " + std::string(fault) + ".";
+}
+
+static void fillWaveFormat(WAVEFORMATEX& format, const AudioStreamFormat& streamFormat)
+{
+    format.wFormatTag      = WAVE_FORMAT_PCM;
+    format.nChannels       = 1;    //  '1' - mono, '2' - stereo
+    format.cbSize          = 0;
+    format.wBitsPerSample  = 16;
+    format.nSamplesPerSec  = streamFormat.iSampleRate;
+    format.nBlockAlign     = format.nChannels      * format.wBitsPerSample / 8;
+    format.nAvgBytesPerSec = format.nSamplesPerSec * format.nChannels           * format.wBitsPerSample / 8;
+}
+
+static bool isWaveBufferDone(const WAVEHDR* pHeader)
+{
+    // Changed by the driver.
+    return ( *reinterpret_cast<const volatile DWORD*>(&pHeader->dwFlags) & WHDR_DONE ) != 0;
+}
+
+static void fillWaveHeader(WAVEHDR& header, short int* pBuffer, size_t iFrameSamples)
+{
+    header.lpData          = reinterpret_cast <LPSTR>         (pBuffer);
+    header.dwBufferLength  = static_cast      <unsigned long> (iFrameSamples * 2);
+    header.dwBytesRecorded = 0;
+    header.dwUser          = 0L;
+    header.dwFlags         = 0L;
+    header.dwLoops         = 0L;
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Buffers of WINMM_CAPTURE_QUEUE_MS in total are queued to the device, read() waits for the oldest one,
+// copies it and queues it again (so the other buffers are recording meanwhile).
+// The device signals the event every time it finishes a buffer so read() sleeps until then.
+class WinMMCaptureStream : public AudioCaptureStream
+{
+
+public:
+
+    WinMMCaptureStream(HWAVEIN hWaveIn, HANDLE hBufferDoneEvent, const AudioStreamFormat& format)
+    {
+        this->hWaveIn          = hWaveIn;
+        this->hBufferDoneEvent = hBufferDoneEvent;
+        iFrameSamples          = format.iFrameSamples;
+
+
+        // Smaller frames - more buffers (but not less than 4).
+
+        size_t iFrameMS    = iFrameSamples * 1000 / format.iSampleRate;
+        size_t iBufferCount = (iFrameMS == 0) ? WINMM_CAPTURE_MIN_BUFFER_COUNT : (WINMM_CAPTURE_QUEUE_MS + iFrameMS - 1) / iFrameMS;
+
+        if (iBufferCount < WINMM_CAPTURE_MIN_BUFFER_COUNT)
+        {
+            iBufferCount = WINMM_CAPTURE_MIN_BUFFER_COUNT;
+        }
+
+        vHeaders.resize(iBufferCount);
+        vBuffers.resize(iBufferCount);
+
+        for (size_t i = 0;  i < iBufferCount;  i++)
+        {
+            vBuffers[i] = new short int [iFrameSamples];
+            fillWaveHeader(vHeaders[i], vBuffers[i], iFrameSamples);
+        }
+
+        iNextBuffer  = 0;
+        iQueuedCount = 0;
+        bStopping    = false;
+    }
+
+    bool start() override
+    {
+        if (iQueuedCount != 0)
+        {
+            // Already started.
+            return false;
+        }
+
+        sLastError.clear();
+
+        bStopping   = false;
+        iNextBuffer = 0;
+
+
+        // Current buffers queue: 1 (recording) - 2 - 3 - ...
+
+        for (size_t i = 0;  i < vHeaders.size();  i++)
+        {
+            if ( addBuffer(i) )
+            {
+                waveInReset(hWaveIn);
+                waitForAllBuffers();
+
+                return true;
+            }
+        }
+
+
+        MMRESULT result = waveInStart(hWaveIn);
+
+        if (result)
+        {
+            sLastError = getWaveErrorText("waveInStart", result);
+
+            waveInReset(hWaveIn);
+            waitForAllBuffers();
+
+            return true;
+        }
+
+
+        return false;
+    }
+
+    bool read(short int* pFrameOut) override
+    {
+        if (iQueuedCount == 0)
+        {
+            return true;
+        }
+
+
+        // Wait until the oldest buffer finished recording.
+
+        WAVEHDR* pHeader = &vHeaders[iNextBuffer];
+
+        while ( isWaveBufferDone(pHeader) == false )
+        {
+            // The timeout is only a safety net (the event is signaled for every buffer).
+            WaitForSingleObject(hBufferDoneEvent, WINMM_BUFFER_WAIT_TIMEOUT_MS);
+        }
+
+        waveInUnprepareHeader(hWaveIn, pHeader, sizeof(WAVEHDR));
+
+        iQueuedCount--;
+
+
+        // Copy (so this buffer can record again).
+
+        std::memcpy( pFrameOut, vBuffers[iNextBuffer], iFrameSamples * 2 );
+
+
+        if (bStopping == false)
+        {
+            if ( addBuffer(iNextBuffer) )
+            {
+                // Read what is already queued and stop.
+                bStopping = true;
+            }
+        }
+
+        iNextBuffer = (iNextBuffer + 1) % vHeaders.size();
+
+
+        if (iQueuedCount == 0)
+        {
+            waveInStop(hWaveIn);
+        }
+
+
+        return false;
+    }
+
+    void stop() override
+    {
+        bStopping = true;
+    }
+
+    const std::string& getLastError() const override
+    {
+        return sLastError;
+    }
+
+    ~WinMMCaptureStream() override
+    {
+        waveInReset(hWaveIn);
+
+        waitForAllBuffers();
+
+        waveInClose(hWaveIn);
+
+        CloseHandle(hBufferDoneEvent);
+
+
+        for (size_t i = 0;  i < vBuffers.size();  i++)
+        {
+            delete[] vBuffers[i];
+        }
+    }
+
+private:
+
+    bool addBuffer(size_t i)
+    {
+        MMRESULT result = waveInPrepareHeader(hWaveIn, &vHeaders[i], sizeof(WAVEHDR));
+
+        if (result)
+        {
+            sLastError = getWaveErrorText("waveInPrepareHeader", result);
+
+            return true;
+        }
+
+
+        // Insert a wave input buffer to waveform-audio input device
+        result = waveInAddBuffer(hWaveIn, &vHeaders[i], sizeof(WAVEHDR));
+
+        if (result)
+        {
+            sLastError = getWaveErrorText("waveInAddBuffer", result);
+
+            waveInUnprepareHeader(hWaveIn, &vHeaders[i], sizeof(WAVEHDR));
+
+            return true;
+        }
+
+
+        iQueuedCount++;
+
+        return false;
+    }
+
+    void waitForAllBuffers()
+    {
+        // After waveInReset() all buffers are returned right away.
+
+        for (size_t i = 0;  i < vHeaders.size();  i++)
+        {
+            while (waveInUnprepareHeader(hWaveIn, &vHeaders[i], sizeof(WAVEHDR)) == WAVERR_STILLPLAYING)
+            {
+                WaitForSingleObject(hBufferDoneEvent, WINMM_BUFFER_WAIT_TIMEOUT_MS);
+            }
+        }
+
+        iQueuedCount = 0;
+    }
+
+
+    HWAVEIN                  hWaveIn;
+    HANDLE                   hBufferDoneEvent;
+
+    std::vector<WAVEHDR>     vHeaders;
+    std::vector<short int*>  vBuffers;
+
+    size_t                   iFrameSamples;
+    size_t                   iNextBuffer;
+    size_t                   iQueuedCount;
+    bool                     bStopping;
+
+    std::string              sLastError;
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Output buffers are prepared once and reused for every frame.
+// The device signals the event every time it finishes a buffer so the playback thread sleeps until then
+// (wakeUp() signals the same event).
+class WinMMPlaybackStream : public AudioPlaybackStream
+{
+
+public:
+
+    WinMMPlaybackStream(HWAVEOUT hWaveOut, HANDLE hBufferDoneEvent, size_t iFrameSamples, size_t iFrameCount)
+    {
+        this->hWaveOut         = hWaveOut;
+        this->hBufferDoneEvent = hBufferDoneEvent;
+        this->iFrameSamples    = iFrameSamples;
+
+        vHeaders.resize(iFrameCount);
+        vBuffers.resize(iFrameCount);
+        vQueued .resize(iFrameCount, false);
+
+        for (size_t i = 0;  i < iFrameCount;  i++)
+        {
+            vBuffers[i] = new short int [iFrameSamples];
+            fillWaveHeader(vHeaders[i], vBuffers[i], iFrameSamples);
+
+            MMRESULT result = waveOutPrepareHeader(hWaveOut, &vHeaders[i], sizeof(WAVEHDR));
+
+            if (result)
+            {
+                sLastError = getWaveErrorText("waveOutPrepareHeader", result);
+            }
+        }
+    }
+
+    void setVolume(unsigned short int iVolume) override
+    {
+        waveOutSetVolume( hWaveOut, MAKELONG(iVolume, iVolume) );
+    }
+
+    size_t getFreeFrameCount() override
+    {
+        size_t iFreeCount = 0;
+
+        for (size_t i = 0;  i < vHeaders.size();  i++)
+        {
+            if ( isFree(i) )
+            {
+                iFreeCount++;
+            }
+        }
+
+        return iFreeCount;
+    }
+
+    bool write(const short int* pFrame) override
+    {
+        for (size_t i = 0;  i < vHeaders.size();  i++)
+        {
+            if ( isFree(i) == false )
+            {
+                continue;
+            }
+
+
+            std::memcpy( vBuffers[i], pFrame, iFrameSamples * 2 );
+
+            MMRESULT result = waveOutWrite(hWaveOut, &vHeaders[i], sizeof(WAVEHDR));
+
+            if (result)
+            {
+                sLastError = getWaveErrorText("waveOutWrite", result);
+
+                return true;
+            }
+
+            vQueued[i] = true;
+
+            return false;
+        }
+
+
+        sLastError = "no free output buffers.";
+
+        return true;
+    }
+
+    void waitForFreeFrame() override
+    {
+        // The timeout is only a safety net (the event is signaled for every buffer).
+        WaitForSingleObject(hBufferDoneEvent, WINMM_BUFFER_WAIT_TIMEOUT_MS);
+    }
+
+    void wakeUp() override
+    {
+        SetEvent(hBufferDoneEvent);
+    }
+
+    void reset() override
+    {
+        // Mark all buffers as done.
+        waveOutReset(hWaveOut);
+
+        for (size_t i = 0;  i < vQueued.size();  i++)
+        {
+            vQueued[i] = false;
+        }
+    }
+
+    const std::string& getLastError() const override
+    {
+        return sLastError;
+    }
+
+    ~WinMMPlaybackStream() override
+    {
+        waveOutReset(hWaveOut);
+
+        for (size_t i = 0;  i < vHeaders.size();  i++)
+        {
+            waveOutUnprepareHeader(hWaveOut, &vHeaders[i], sizeof(WAVEHDR));
+
+            delete[] vBuffers[i];
+        }
+
+        waveOutClose(hWaveOut);
+
+        CloseHandle(hBufferDoneEvent);
+    }
+
+private:
+
+    bool isFree(size_t i) const
+    {
+        return (vQueued[i] == false) || isWaveBufferDone(&vHeaders[i]);
+    }
+
+
+    HWAVEOUT                 hWaveOut;
+    HANDLE                   hBufferDoneEvent;
+
+    std::vector<WAVEHDR>     vHeaders;
+    std::vector<short int*>  vBuffers;
+    std::vector<bool>        vQueued;
+
+    size_t                   iFrameSamples;
+
+    std::string              sLastError;
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+WinMMAudioBackend::WinMMAudioBackend()
+{
+}
+
+std::vector<std::wstring> WinMMAudioBackend::getInputDevices()
+{
+    UINT iInDeviceCount = waveInGetNumDevs();
+
+    std::vector<std::wstring> vSupportedDevices;
+
+    for (UINT i = 0; i < iInDeviceCount; i++)
+    {
+        WAVEINCAPS deviceInfo;
+
+        if ( waveInGetDevCaps(i, &deviceInfo, sizeof(deviceInfo)) == MMSYSERR_NOERROR )
+        {
+            vSupportedDevices.push_back(deviceInfo.szPname);
+        }
+    }
+
+    return vSupportedDevices;
+}
+
+AudioCaptureStream* WinMMAudioBackend::openCapture(const std::wstring& sDeviceName, const AudioStreamFormat& format, std::string& sErrorOut)
+{
+    WAVEFORMATEX waveFormat;
+    fillWaveFormat(waveFormat, format);
+
+
+    UINT iDeviceID = WAVE_MAPPER;
+
+    int iPreferredDeviceID = getInputDeviceID(sDeviceName);
+    if (iPreferredDeviceID != -1)
+    {
+        iDeviceID = static_cast<UINT>(iPreferredDeviceID);
+    }
+
+
+    // Auto-reset, signaled by the device when a buffer is done.
+    HANDLE hBufferDoneEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+
+    if (hBufferDoneEvent == nullptr)
+    {
+        sErrorOut = "CreateEvent() error: " + std::to_string(GetLastError()) + ".";
+
+        return nullptr;
+    }
+
+
+    HWAVEIN hWaveIn;
+
+    MMRESULT result = waveInOpen (&hWaveIn,  iDeviceID,  &waveFormat,  reinterpret_cast<DWORD_PTR>(hBufferDoneEvent),  0L,  CALLBACK_EVENT | WAVE_FORMAT_DIRECT);
+
+    if (result)
+    {
+        sErrorOut = getWaveErrorText("waveInOpen", result);
+
+        CloseHandle(hBufferDoneEvent);
+
+        return nullptr;
+    }
+
+
+    return new WinMMCaptureStream(hWaveIn, hBufferDoneEvent, format);
+}
+
+AudioPlaybackStream* WinMMAudioBackend::openPlayback(const AudioStreamFormat& format, size_t iFrameCount, std::string& sErrorOut)
+{
+    WAVEFORMATEX waveFormat;
+    fillWaveFormat(waveFormat, format);
+
+
+    // Auto-reset, signaled by the device when a buffer is played.
+    HANDLE hBufferDoneEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+
+    if (hBufferDoneEvent == nullptr)
+    {
+        sErrorOut = "CreateEvent() error: " + std::to_string(GetLastError()) + ".";
+
+        return nullptr;
+    }
+
+
+    HWAVEOUT hWaveOut;
+
+    MMRESULT result = waveOutOpen( &hWaveOut,  WAVE_MAPPER,  &waveFormat,  reinterpret_cast<DWORD_PTR>(hBufferDoneEvent),  0L,  CALLBACK_EVENT | WAVE_FORMAT_DIRECT );
+
+    if (result)
+    {
+        sErrorOut = getWaveErrorText("waveOutOpen", result);
+
+        CloseHandle(hBufferDoneEvent);
+
+        return nullptr;
+    }
+
+
+    WinMMPlaybackStream* pStream = new WinMMPlaybackStream(hWaveOut, hBufferDoneEvent, format.iFrameSamples, iFrameCount);
+
+    if (pStream->getLastError().empty() == false)
+    {
+        sErrorOut = pStream->getLastError();
+
+        delete pStream;
+
+        return nullptr;
+    }
+
+
+    return pStream;
+}
+
+bool WinMMAudioBackend::isKeyPressed(int iVirtualKey)
+{
+    return (GetAsyncKeyState(iVirtualKey) & 0x8000) != 0;
+}
+
+void WinMMAudioBackend::playSoundFile(const std::wstring& sPath, bool bWait)
+{
+    PlaySoundW( sPath.c_str(), nullptr, bWait ? SND_FILENAME : (SND_FILENAME | SND_ASYNC) );
+}
+
+int WinMMAudioBackend::getInputDeviceID(const std::wstring& sDeviceName)
+{
+    UINT iInDeviceCount = waveInGetNumDevs();
+
+    for (UINT i = 0; i < iInDeviceCount; i++)
+    {
+        WAVEINCAPS deviceInfo;
+
+        if ( waveInGetDevCaps(i, &deviceInfo, sizeof(deviceInfo)) == MMSYSERR_NOERROR )
+        {
+            if (sDeviceName == std::wstring(deviceInfo.szPname))
+            {
+                return static_cast<int>(i);
+            }
+        }
+    }
+
+    return -1;
+}
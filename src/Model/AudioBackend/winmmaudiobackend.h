@@ -0,0 +1,49 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// Custom
+#include "Model/AudioBackend/audiobackend.h"
+
+
+// Audio queued to the input device (split into the buffers of the frame size).
+#define  WINMM_CAPTURE_QUEUE_MS          140
+#define  WINMM_CAPTURE_MIN_BUFFER_COUNT  4
+
+// Wait for the "buffer done" event no longer than that (in case it's lost).
+#define  WINMM_BUFFER_WAIT_TIMEOUT_MS    200
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Waveform-audio (waveIn/waveOut) devices, GetAsyncKeyState() and PlaySound().
+class WinMMAudioBackend : public AudioBackend
+{
+
+public:
+
+    WinMMAudioBackend();
+
+
+        std::vector<std::wstring>  getInputDevices  () override;
+
+        AudioCaptureStream*   openCapture        (const std::wstring& sDeviceName, const AudioStreamFormat& format, std::string& sErrorOut) override;
+        AudioPlaybackStream*  openPlayback       (const AudioStreamFormat& format, size_t iFrameCount, std::string& sErrorOut) override;
+
+        bool                  isKeyPressed       (int iVirtualKey) override;
+        void                  playSoundFile      (const std::wstring& sPath, bool bWait) override;
+
+private:
+
+    // Returns -1 if not found.
+
+        int                   getInputDeviceID   (const std::wstring& sDeviceName);
+};
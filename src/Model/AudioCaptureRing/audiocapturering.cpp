@@ -0,0 +1,168 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "audiocapturering.h"
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+AudioCaptureRing::AudioCaptureRing(size_t iFrameSamples, size_t iCapacity)
+{
+    this->iFrameSamples = iFrameSamples;
+    this->iCapacity     = iCapacity;
+
+
+    pSamples = new short int [iFrameSamples * iCapacity];
+
+    vFrames.resize(iCapacity);
+
+    for (size_t i = 0;  i < iCapacity;  i++)
+    {
+        vFrames[i].pSamples   = pSamples + i * iFrameSamples;
+        vFrames[i].bEndOfTalk = false;
+    }
+
+
+    iReadPos         = 0;
+    iWritePos        = 0;
+    iDroppedCount    = 0;
+
+    bConsumerWaiting = false;
+    bWakeUp          = false;
+}
+
+short int* AudioCaptureRing::getWriteFrame()
+{
+    size_t iWrite = iWritePos.load(std::memory_order_relaxed);
+
+    if ( iWrite - iReadPos.load(std::memory_order_acquire) >= iCapacity - 1 )
+    {
+        iDroppedCount.fetch_add(1, std::memory_order_relaxed);
+
+        return nullptr;
+    }
+
+
+    return vFrames[iWrite & (iCapacity - 1)].pSamples;
+}
+
+void AudioCaptureRing::pushFrame()
+{
+    size_t iWrite = iWritePos.load(std::memory_order_relaxed);
+
+    AudioCaptureRingFrame& frame = vFrames[iWrite & (iCapacity - 1)];
+    frame.captureTime = std::chrono::steady_clock::now();
+    frame.bEndOfTalk  = false;
+
+    iWritePos.store(iWrite + 1);
+
+
+    notifyConsumer();
+}
+
+bool AudioCaptureRing::pushEndOfTalk()
+{
+    size_t iWrite = iWritePos.load(std::memory_order_relaxed);
+
+    if ( iWrite - iReadPos.load(std::memory_order_acquire) >= iCapacity )
+    {
+        return true;
+    }
+
+
+    AudioCaptureRingFrame& frame = vFrames[iWrite & (iCapacity - 1)];
+    frame.captureTime = std::chrono::steady_clock::now();
+    frame.bEndOfTalk  = true;
+
+    iWritePos.store(iWrite + 1);
+
+
+    notifyConsumer();
+
+
+    return false;
+}
+
+const AudioCaptureRingFrame* AudioCaptureRing::waitFrame()
+{
+    size_t iRead = iReadPos.load(std::memory_order_relaxed);
+
+    if (iWritePos.load() == iRead)
+    {
+        std::unique_lock<std::mutex> lock(mtxWait);
+
+        // The producer checks this flag after the new write position is stored
+        // so either it sees the flag or we see the new frame here.
+        bConsumerWaiting = true;
+
+        cvWait.wait(lock, [&]{ return (iWritePos.load() != iRead) || bWakeUp; });
+
+        // bWakeUp stays set (until clear()): a frame may have come together with the wake up
+        // and the next call should not block after it.
+        bConsumerWaiting = false;
+
+
+        if (iWritePos.load() == iRead)
+        {
+            return nullptr;
+        }
+    }
+
+
+    return &vFrames[iRead & (iCapacity - 1)];
+}
+
+void AudioCaptureRing::popFrame()
+{
+    iReadPos.store( iReadPos.load(std::memory_order_relaxed) + 1, std::memory_order_release );
+}
+
+void AudioCaptureRing::wakeUp()
+{
+    std::lock_guard<std::mutex> lock(mtxWait);
+
+    bWakeUp = true;
+
+    cvWait.notify_one();
+}
+
+void AudioCaptureRing::clear()
+{
+    iReadPos      = 0;
+    iWritePos     = 0;
+    iDroppedCount = 0;
+
+    bWakeUp       = false;
+}
+
+unsigned long long AudioCaptureRing::getDroppedCount() const
+{
+    return iDroppedCount.load(std::memory_order_relaxed);
+}
+
+size_t AudioCaptureRing::getFrameSamples() const
+{
+    return iFrameSamples;
+}
+
+void AudioCaptureRing::notifyConsumer()
+{
+    if (bConsumerWaiting.load())
+    {
+        // Taking the mutex guarantees that the consumer is already waiting (and not between the check and the wait).
+        std::lock_guard<std::mutex> lock(mtxWait);
+
+        cvWait.notify_one();
+    }
+}
+
+AudioCaptureRing::~AudioCaptureRing()
+{
+    delete[] pSamples;
+}
@@ -0,0 +1,116 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+
+
+// Should be a power of 2 (~1 second of 35 ms frames).
+#define  AUDIO_CAPTURE_RING_SIZE     32
+
+
+
+struct AudioCaptureRingFrame
+{
+    short int*                             pSamples;
+
+    // When the frame was pushed (the device finished recording it).
+    std::chrono::steady_clock::time_point  captureTime;
+
+    // No samples: the user stopped talking after the previous frame.
+    bool                                   bEndOfTalk;
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Captured frames on their way from the capture thread (producer) to the encoder thread (consumer).
+// Single producer, single consumer: the frames are passed without locks, the frame memory is allocated once.
+// The consumer can sleep in waitFrame() (the producer takes the mutex only to wake up a sleeping consumer).
+class AudioCaptureRing
+{
+
+public:
+
+    AudioCaptureRing(size_t iFrameSamples, size_t iCapacity = AUDIO_CAPTURE_RING_SIZE);
+
+
+    // Producer
+
+        // Returns nullptr if the ring is full (the frame should be dropped).
+        // One place is kept for the end of talk so it's not lost because of the full ring.
+        short int*                    getWriteFrame     ();
+
+        // Publishes the frame returned from getWriteFrame().
+        void                          pushFrame         ();
+
+        // Returns true if the ring is full (there were no frames since the last end of talk then).
+        bool                          pushEndOfTalk     ();
+
+
+    // Consumer
+
+        // Blocks until there is a frame or wakeUp() is called.
+        // Returns nullptr if woken up and there is nothing to read.
+        // The frame stays valid until popFrame().
+        const AudioCaptureRingFrame*  waitFrame         ();
+        void                          popFrame          ();
+
+        // Releases waitFrame() (from any thread), waitFrame() does not block after this until clear().
+        void                          wakeUp            ();
+
+
+    // Should be called when there is no producer and consumer.
+
+        void                          clear             ();
+
+
+    // GET functions
+
+        // Frames that did not fit.
+        unsigned long long            getDroppedCount   () const;
+        size_t                        getFrameSamples   () const;
+
+
+    ~AudioCaptureRing();
+
+private:
+
+    void notifyConsumer();
+
+
+    std::vector<AudioCaptureRingFrame>  vFrames;
+
+    // All frames in one allocation.
+    short int*                       pSamples;
+
+    size_t                           iFrameSamples;
+    size_t                           iCapacity;
+
+
+    // Not wrapped (the index is 'iPos & (iCapacity - 1)').
+    std::atomic<size_t>              iReadPos;
+    std::atomic<size_t>              iWritePos;
+
+    std::atomic<unsigned long long>  iDroppedCount;
+
+
+    // Sleep / wake up.
+    std::mutex                       mtxWait;
+    std::condition_variable          cvWait;
+    std::atomic<bool>                bConsumerWaiting;
+    bool                             bWakeUp;
+};
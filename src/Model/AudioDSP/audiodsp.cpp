@@ -0,0 +1,544 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "audiodsp.h"
+
+
+// STL
+#include <atomic>
+#include <climits>
+#include <cmath>
+
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+    #define AUDIO_DSP_X86
+
+    #include <immintrin.h>
+
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+#endif
+
+
+// GCC/Clang need the instruction set enabled per function (the rest of the program is built without it).
+#if defined(__GNUC__)
+    #define AUDIO_DSP_TARGET_SSE2  __attribute__((target("sse2")))
+    #define AUDIO_DSP_TARGET_AVX2  __attribute__((target("avx2")))
+#else
+    #define AUDIO_DSP_TARGET_SSE2
+    #define AUDIO_DSP_TARGET_AVX2
+#endif
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// 'pOut' may be nullptr (measure only), 'pOut' may be equal to 'pIn'.
+typedef void (*GainKernel) (const short int* pIn, short int* pOut, size_t iSampleCount, float fGain,
+                            int& iPeak, float& fSumOfSquares);
+
+typedef void (*MixKernel)  (int* pMix, const short int* pSamples, size_t iSampleCount, float fGain);
+
+typedef void (*SaturateKernel) (const int* pMix, short int* pSamples, size_t iSampleCount);
+
+
+struct AudioDSPKernels
+{
+    AUDIO_DSP_KERNEL  kernel;
+
+    GainKernel        pGain;
+    MixKernel         pMix;
+    SaturateKernel    pSaturate;
+    const char*       pName;
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// Scalar
+// ------------------------------------------------------------------------------------------------
+
+
+static void gainScalar(const short int* pIn, short int* pOut, size_t iSampleCount, float fGain,
+                       int& iPeak, float& fSumOfSquares)
+{
+    for (size_t i = 0;  i < iSampleCount;  i++)
+    {
+        int iNewValue = static_cast <int> (pIn[i] * fGain);
+
+        if      (iNewValue > SHRT_MAX)
+        {
+            iNewValue = SHRT_MAX;
+        }
+        else if (iNewValue < SHRT_MIN)
+        {
+            iNewValue = SHRT_MIN;
+        }
+
+        if (pOut)
+        {
+            pOut[i] = static_cast <short> (iNewValue);
+        }
+
+
+        int iAbs = iNewValue < 0 ? -iNewValue : iNewValue;
+
+        if (iAbs > iPeak)
+        {
+            iPeak = iAbs;
+        }
+
+        fSumOfSquares += static_cast<float>(iNewValue) * static_cast<float>(iNewValue);
+    }
+}
+
+static void mixScalar(int* pMix, const short int* pSamples, size_t iSampleCount, float fGain)
+{
+    for (size_t i = 0;  i < iSampleCount;  i++)
+    {
+        pMix[i] += static_cast<int>(pSamples[i] * fGain);
+    }
+}
+
+static void saturateScalar(const int* pMix, short int* pSamples, size_t iSampleCount)
+{
+    for (size_t i = 0;  i < iSampleCount;  i++)
+    {
+        int iValue = pMix[i];
+
+        if      (iValue > SHRT_MAX)
+        {
+            pSamples[i] = SHRT_MAX;
+        }
+        else if (iValue < SHRT_MIN)
+        {
+            pSamples[i] = SHRT_MIN;
+        }
+        else
+        {
+            pSamples[i] = static_cast<short int>(iValue);
+        }
+    }
+}
+
+
+
+#ifdef AUDIO_DSP_X86
+
+// ------------------------------------------------------------------------------------------------
+// SSE2 (8 samples per iteration)
+// ------------------------------------------------------------------------------------------------
+
+
+AUDIO_DSP_TARGET_SSE2
+static void gainSSE2(const short int* pIn, short int* pOut, size_t iSampleCount, float fGain,
+                     int& iPeak, float& fSumOfSquares)
+{
+    const __m128 vGain = _mm_set1_ps(fGain);
+
+    __m128i vMax = _mm_setzero_si128();
+    __m128i vMin = _mm_setzero_si128();
+    __m128  vSum = _mm_setzero_ps();
+
+    size_t i = 0;
+
+    for ( ;  i + 8 <= iSampleCount;  i += 8)
+    {
+        __m128i vIn = _mm_loadu_si128( reinterpret_cast<const __m128i*>(pIn + i) );
+
+        // Sign extend to 32 bit.
+        __m128i vLow  = _mm_srai_epi32( _mm_unpacklo_epi16(vIn, vIn), 16 );
+        __m128i vHigh = _mm_srai_epi32( _mm_unpackhi_epi16(vIn, vIn), 16 );
+
+        // Truncate like static_cast<int>().
+        vLow  = _mm_cvttps_epi32( _mm_mul_ps(_mm_cvtepi32_ps(vLow),  vGain) );
+        vHigh = _mm_cvttps_epi32( _mm_mul_ps(_mm_cvtepi32_ps(vHigh), vGain) );
+
+        // Saturate to SHRT_MIN..SHRT_MAX.
+        __m128i vOut = _mm_packs_epi32(vLow, vHigh);
+
+        if (pOut)
+        {
+            _mm_storeu_si128( reinterpret_cast<__m128i*>(pOut + i), vOut );
+        }
+
+
+        vMax = _mm_max_epi16(vMax, vOut);
+        vMin = _mm_min_epi16(vMin, vOut);
+
+        __m128 vOutLow  = _mm_cvtepi32_ps( _mm_srai_epi32(_mm_unpacklo_epi16(vOut, vOut), 16) );
+        __m128 vOutHigh = _mm_cvtepi32_ps( _mm_srai_epi32(_mm_unpackhi_epi16(vOut, vOut), 16) );
+
+        vSum = _mm_add_ps( vSum, _mm_mul_ps(vOutLow,  vOutLow)  );
+        vSum = _mm_add_ps( vSum, _mm_mul_ps(vOutHigh, vOutHigh) );
+    }
+
+
+    short int vMaxValues[8];
+    short int vMinValues[8];
+    float     vSumValues[4];
+
+    _mm_storeu_si128( reinterpret_cast<__m128i*>(vMaxValues), vMax );
+    _mm_storeu_si128( reinterpret_cast<__m128i*>(vMinValues), vMin );
+    _mm_storeu_ps   ( vSumValues, vSum );
+
+    for (size_t j = 0;  j < 8;  j++)
+    {
+        if (vMaxValues[j] > iPeak)
+        {
+            iPeak = vMaxValues[j];
+        }
+
+        if (-vMinValues[j] > iPeak)
+        {
+            iPeak = -vMinValues[j];
+        }
+    }
+
+    fSumOfSquares += vSumValues[0] + vSumValues[1] + vSumValues[2] + vSumValues[3];
+
+
+    gainScalar(pIn + i, pOut ? pOut + i : nullptr, iSampleCount - i, fGain, iPeak, fSumOfSquares);
+}
+
+AUDIO_DSP_TARGET_SSE2
+static void mixSSE2(int* pMix, const short int* pSamples, size_t iSampleCount, float fGain)
+{
+    const __m128 vGain = _mm_set1_ps(fGain);
+
+    size_t i = 0;
+
+    for ( ;  i + 8 <= iSampleCount;  i += 8)
+    {
+        __m128i vIn = _mm_loadu_si128( reinterpret_cast<const __m128i*>(pSamples + i) );
+
+        __m128i vLow  = _mm_srai_epi32( _mm_unpacklo_epi16(vIn, vIn), 16 );
+        __m128i vHigh = _mm_srai_epi32( _mm_unpackhi_epi16(vIn, vIn), 16 );
+
+        vLow  = _mm_cvttps_epi32( _mm_mul_ps(_mm_cvtepi32_ps(vLow),  vGain) );
+        vHigh = _mm_cvttps_epi32( _mm_mul_ps(_mm_cvtepi32_ps(vHigh), vGain) );
+
+        __m128i* pMixLow  = reinterpret_cast<__m128i*>(pMix + i);
+        __m128i* pMixHigh = reinterpret_cast<__m128i*>(pMix + i + 4);
+
+        _mm_storeu_si128( pMixLow,  _mm_add_epi32(_mm_loadu_si128(pMixLow),  vLow)  );
+        _mm_storeu_si128( pMixHigh, _mm_add_epi32(_mm_loadu_si128(pMixHigh), vHigh) );
+    }
+
+    mixScalar(pMix + i, pSamples + i, iSampleCount - i, fGain);
+}
+
+AUDIO_DSP_TARGET_SSE2
+static void saturateSSE2(const int* pMix, short int* pSamples, size_t iSampleCount)
+{
+    size_t i = 0;
+
+    for ( ;  i + 8 <= iSampleCount;  i += 8)
+    {
+        __m128i vLow  = _mm_loadu_si128( reinterpret_cast<const __m128i*>(pMix + i) );
+        __m128i vHigh = _mm_loadu_si128( reinterpret_cast<const __m128i*>(pMix + i + 4) );
+
+        _mm_storeu_si128( reinterpret_cast<__m128i*>(pSamples + i), _mm_packs_epi32(vLow, vHigh) );
+    }
+
+    saturateScalar(pMix + i, pSamples + i, iSampleCount - i);
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// AVX2 (16 samples per iteration)
+// ------------------------------------------------------------------------------------------------
+
+
+AUDIO_DSP_TARGET_AVX2
+static void gainAVX2(const short int* pIn, short int* pOut, size_t iSampleCount, float fGain,
+                     int& iPeak, float& fSumOfSquares)
+{
+    const __m256 vGain = _mm256_set1_ps(fGain);
+
+    __m256i vMax = _mm256_setzero_si256();
+    __m256i vMin = _mm256_setzero_si256();
+    __m256  vSum = _mm256_setzero_ps();
+
+    size_t i = 0;
+
+    for ( ;  i + 16 <= iSampleCount;  i += 16)
+    {
+        __m256i vIn = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(pIn + i) );
+
+        __m256i vLow  = _mm256_cvtepi16_epi32( _mm256_castsi256_si128(vIn) );
+        __m256i vHigh = _mm256_cvtepi16_epi32( _mm256_extracti128_si256(vIn, 1) );
+
+        vLow  = _mm256_cvttps_epi32( _mm256_mul_ps(_mm256_cvtepi32_ps(vLow),  vGain) );
+        vHigh = _mm256_cvttps_epi32( _mm256_mul_ps(_mm256_cvtepi32_ps(vHigh), vGain) );
+
+        // packs works per 128 bit lane, put the 64 bit blocks back in order.
+        __m256i vOut = _mm256_permute4x64_epi64( _mm256_packs_epi32(vLow, vHigh), 0xD8 );
+
+        if (pOut)
+        {
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>(pOut + i), vOut );
+        }
+
+
+        vMax = _mm256_max_epi16(vMax, vOut);
+        vMin = _mm256_min_epi16(vMin, vOut);
+
+        __m256 vOutLow  = _mm256_cvtepi32_ps( _mm256_cvtepi16_epi32(_mm256_castsi256_si128(vOut)) );
+        __m256 vOutHigh = _mm256_cvtepi32_ps( _mm256_cvtepi16_epi32(_mm256_extracti128_si256(vOut, 1)) );
+
+        vSum = _mm256_add_ps( vSum, _mm256_mul_ps(vOutLow,  vOutLow)  );
+        vSum = _mm256_add_ps( vSum, _mm256_mul_ps(vOutHigh, vOutHigh) );
+    }
+
+
+    short int vMaxValues[16];
+    short int vMinValues[16];
+    float     vSumValues[8];
+
+    _mm256_storeu_si256( reinterpret_cast<__m256i*>(vMaxValues), vMax );
+    _mm256_storeu_si256( reinterpret_cast<__m256i*>(vMinValues), vMin );
+    _mm256_storeu_ps   ( vSumValues, vSum );
+
+    for (size_t j = 0;  j < 16;  j++)
+    {
+        if (vMaxValues[j] > iPeak)
+        {
+            iPeak = vMaxValues[j];
+        }
+
+        if (-vMinValues[j] > iPeak)
+        {
+            iPeak = -vMinValues[j];
+        }
+    }
+
+    for (size_t j = 0;  j < 8;  j++)
+    {
+        fSumOfSquares += vSumValues[j];
+    }
+
+
+    // The upper halves of the YMM registers stay dirty otherwise (GCC does not clear them before the tail call),
+    // every following SSE instruction of the program (the math library too) then pays the AVX-SSE transition.
+    _mm256_zeroupper();
+
+    // Rest (less than 16 samples).
+    gainSSE2(pIn + i, pOut ? pOut + i : nullptr, iSampleCount - i, fGain, iPeak, fSumOfSquares);
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// CPU check
+// ------------------------------------------------------------------------------------------------
+
+
+static bool isSSE2Supported()
+{
+#if defined(_M_X64) || defined(__x86_64__)
+    return true;
+#elif defined(_MSC_VER)
+    int vInfo[4];
+    __cpuid(vInfo, 1);
+
+    return (vInfo[3] & (1 << 26)) != 0;
+#else
+    __builtin_cpu_init();
+
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+
+static bool isAVX2Supported()
+{
+#if defined(_MSC_VER)
+    int vInfo[4];
+
+    __cpuid(vInfo, 0);
+    if (vInfo[0] < 7)
+    {
+        return false;
+    }
+
+
+    // OS should save the YMM registers.
+
+    __cpuid(vInfo, 1);
+
+    bool bOSXSAVE = (vInfo[2] & (1 << 27)) != 0;
+    bool bAVX     = (vInfo[2] & (1 << 28)) != 0;
+
+    if ( (bOSXSAVE == false) || (bAVX == false) || ((_xgetbv(0) & 6) != 6) )
+    {
+        return false;
+    }
+
+
+    __cpuidex(vInfo, 7, 0);
+
+    return (vInfo[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // AUDIO_DSP_X86
+
+
+
+static const AudioDSPKernels vKernels[] =
+{
+    { ADK_SCALAR,  &gainScalar,  &mixScalar,  &saturateScalar,  "scalar" },
+#ifdef AUDIO_DSP_X86
+    { ADK_SSE2,    &gainSSE2,    &mixSSE2,    &saturateSSE2,    "SSE2"   },
+    { ADK_AVX2,    &gainAVX2,    &mixSSE2,    &saturateSSE2,    "AVX2"   },
+#endif
+};
+
+static std::atomic<const AudioDSPKernels*>& getSelectedKernels()
+{
+    // The best one, selected once.
+    static std::atomic<const AudioDSPKernels*> pSelected( &vKernels[AudioDSP::getBestKernel()] );
+
+    return pSelected;
+}
+
+static const AudioDSPKernels& getKernels()
+{
+    return *getSelectedKernels().load(std::memory_order_relaxed);
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+AudioFrameLevel AudioDSP::applyGain(short int *pSamples, size_t iSampleCount, float fGain)
+{
+    int   iPeak         = 0;
+    float fSumOfSquares = 0.0f;
+
+    getKernels().pGain(pSamples, pSamples, iSampleCount, fGain, iPeak, fSumOfSquares);
+
+
+    AudioFrameLevel level;
+    level.iPeak = iPeak;
+    level.fRMS  = iSampleCount ? std::sqrt(fSumOfSquares / static_cast<float>(iSampleCount)) : 0.0f;
+
+    return level;
+}
+
+AudioFrameLevel AudioDSP::measureWithGain(const short int *pSamples, size_t iSampleCount, float fGain)
+{
+    int   iPeak         = 0;
+    float fSumOfSquares = 0.0f;
+
+    getKernels().pGain(pSamples, nullptr, iSampleCount, fGain, iPeak, fSumOfSquares);
+
+
+    AudioFrameLevel level;
+    level.iPeak = iPeak;
+    level.fRMS  = iSampleCount ? std::sqrt(fSumOfSquares / static_cast<float>(iSampleCount)) : 0.0f;
+
+    return level;
+}
+
+void AudioDSP::mixWithGain(int *pMix, const short int *pSamples, size_t iSampleCount, float fGain)
+{
+    getKernels().pMix(pMix, pSamples, iSampleCount, fGain);
+}
+
+void AudioDSP::saturate(const int *pMix, short int *pSamples, size_t iSampleCount)
+{
+    getKernels().pSaturate(pMix, pSamples, iSampleCount);
+}
+
+bool AudioDSP::setKernel(AUDIO_DSP_KERNEL kernel)
+{
+    if ( isKernelSupported(kernel) == false )
+    {
+        return true;
+    }
+
+    getSelectedKernels().store(&vKernels[kernel]);
+
+    return false;
+}
+
+bool AudioDSP::isKernelSupported(AUDIO_DSP_KERNEL kernel)
+{
+#ifdef AUDIO_DSP_X86
+    // Checked once.
+    static const bool bSSE2 = isSSE2Supported();
+    static const bool bAVX2 = bSSE2 && isAVX2Supported();
+
+    switch (kernel)
+    {
+    case(ADK_SCALAR): return true;
+    case(ADK_SSE2):   return bSSE2;
+    case(ADK_AVX2):   return bAVX2;
+    default:          return false;
+    }
+#else
+    return kernel == ADK_SCALAR;
+#endif
+}
+
+AUDIO_DSP_KERNEL AudioDSP::getBestKernel()
+{
+    if ( isKernelSupported(ADK_AVX2) )
+    {
+        return ADK_AVX2;
+    }
+    else if ( isKernelSupported(ADK_SSE2) )
+    {
+        return ADK_SSE2;
+    }
+    else
+    {
+        return ADK_SCALAR;
+    }
+}
+
+AUDIO_DSP_KERNEL AudioDSP::getKernel()
+{
+    return getKernels().kernel;
+}
+
+double AudioDSP::peakToDBFS(int iPeak)
+{
+    if (iPeak == 0)
+    {
+        // Silence (log10(0)).
+        return -1000.0;
+    }
+
+    return 20.0 * std::log10( static_cast<double>(iPeak) / SHRT_MAX );
+}
+
+const char* AudioDSP::getKernelName()
+{
+    return getKernels().pName;
+}
+
+const char* AudioDSP::getKernelName(AUDIO_DSP_KERNEL kernel)
+{
+    switch (kernel)
+    {
+    case(ADK_SCALAR): return "scalar";
+    case(ADK_SSE2):   return "SSE2";
+    case(ADK_AVX2):   return "AVX2";
+    default:          return "unknown";
+    }
+}
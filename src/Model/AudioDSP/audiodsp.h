@@ -0,0 +1,77 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <cstddef>
+
+
+enum AUDIO_DSP_KERNEL
+{
+    ADK_SCALAR  = 0,
+    ADK_SSE2    = 1,
+    ADK_AVX2    = 2,  // the gain kernel (the mix ones are SSE2)
+
+    ADK_COUNT   = 3
+};
+
+
+struct AudioFrameLevel
+{
+    // Max absolute sample value (0..32768).
+    int    iPeak;
+
+    float  fRMS;
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Sample loops used by the AudioService (PCM16).
+// Uses AVX2 or SSE2 if the CPU supports it (checked once at runtime), otherwise plain C++.
+// The samples and the peak of every kernel are the same as the scalar ones, the RMS differs
+// in the float rounding (the sum of squares is added up in a different order).
+class AudioDSP
+{
+
+public:
+
+    // Multiplies the samples by 'fGain' (with saturation) and returns the level of the result.
+
+        static AudioFrameLevel  applyGain        (short int* pSamples, size_t iSampleCount, float fGain);
+
+
+    // Same as applyGain() but does not change the samples.
+
+        static AudioFrameLevel  measureWithGain  (const short int* pSamples, size_t iSampleCount, float fGain);
+
+
+    // Mixing: pMix[i] += pSamples[i] * fGain, then saturate the mix back to PCM16.
+
+        static void             mixWithGain      (int* pMix, const short int* pSamples, size_t iSampleCount, float fGain);
+        static void             saturate         (const int* pMix, short int* pSamples, size_t iSampleCount);
+
+
+    // Kernels. The fastest supported one is used by default, setKernel() is for the checks and the benchmarks
+    // (call it when no other thread uses AudioDSP). Returns true if the kernel is not supported by this CPU (the current one is kept).
+
+        static bool             setKernel        (AUDIO_DSP_KERNEL kernel);
+        static bool             isKernelSupported(AUDIO_DSP_KERNEL kernel);
+        static AUDIO_DSP_KERNEL getBestKernel    ();
+        static AUDIO_DSP_KERNEL getKernel        ();
+
+
+    // Other
+
+        static double           peakToDBFS       (int iPeak);
+        static const char*      getKernelName    ();
+        static const char*      getKernelName    (AUDIO_DSP_KERNEL kernel);
+};
@@ -0,0 +1,62 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "audiomixer.h"
+
+
+// STL
+#include <cstring>
+
+// Custom
+#include "Model/AudioDSP/audiodsp.h"
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+AudioMixer::AudioMixer(size_t iFrameSampleCount)
+{
+    this->iFrameSampleCount = iFrameSampleCount;
+
+    pMixBuffer   = new int[iFrameSampleCount];
+    iFramesInMix = 0;
+
+    beginFrame();
+}
+
+void AudioMixer::beginFrame()
+{
+    std::memset(pMixBuffer, 0, iFrameSampleCount * sizeof(int));
+
+    iFramesInMix = 0;
+}
+
+void AudioMixer::addFrame(const short int *pFrame, float fGain)
+{
+    AudioDSP::mixWithGain(pMixBuffer, pFrame, iFrameSampleCount, fGain);
+
+    iFramesInMix++;
+}
+
+bool AudioMixer::finishFrame(short int *pOutFrame)
+{
+    if (iFramesInMix == 0)
+    {
+        return false;
+    }
+
+
+    AudioDSP::saturate(pMixBuffer, pOutFrame, iFrameSampleCount);
+
+
+    return true;
+}
+
+AudioMixer::~AudioMixer()
+{
+    delete[] pMixBuffer;
+}
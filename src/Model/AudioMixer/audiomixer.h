@@ -0,0 +1,44 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <cstddef>
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Sums the PCM16 frames of all speakers into one frame for the output device.
+class AudioMixer
+{
+
+public:
+
+    AudioMixer(size_t iFrameSampleCount);
+
+
+    void   beginFrame   ();
+    void   addFrame     (const short int* pFrame, float fGain);
+
+    // Writes the mix to 'pOutFrame' (with saturation).
+    // Returns false if no frames were added (nothing to play).
+    bool   finishFrame  (short int* pOutFrame);
+
+
+    ~AudioMixer();
+
+private:
+
+    // 32 bit so the sum of many loud speakers won't overflow before the saturation.
+    int*     pMixBuffer;
+
+    size_t   iFrameSampleCount;
+    size_t   iFramesInMix;
+};
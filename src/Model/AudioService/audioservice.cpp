@@ -8,13 +8,28 @@
 
 // STL
 #include <thread>
+#include <cstdio>
+#include <climits>
+#include <cstring>
+#include <algorithm>
+
+// Other
+#include <shlobj.h>
 
 // Custom
-#include "View/MainWindow/mainwindow.h"
+#include "Model/AudioBackend/winmmaudiobackend.h"
+#include "Model/ModelEventSink/modeleventsink.h"
 #include "Model/NetworkService/networkservice.h"
 #include "Model/SettingsManager/settingsmanager.h"
 #include "Model/SettingsManager/SettingsFile.h"
 #include "Model/User.h"
+#include "Model/JitterBuffer/jitterbuffer.h"
+#include "Model/AudioMixer/audiomixer.h"
+#include "Model/AudioDSP/audiodsp.h"
+#include "Model/AudioCaptureRing/audiocapturering.h"
+#include "Model/AudioTimer/audiotimer.h"
+#include "Model/VoicePathStats/voicepathstats.h"
+#include "Model/VoiceActivityDetector/voiceactivitydetector.h"
 #include "Model/net_params.h"
 
 
@@ -23,30 +38,66 @@
 // ------------------------------------------------------------------------------------------------
 
 
-AudioService::AudioService(MainWindow* pMainWindow, SettingsManager* pSettingsManager)
+AudioService::AudioService(ModelEventSink* pEventSink, SettingsManager* pSettingsManager, AudioBackend* pAudioBackend)
 {
-    this->pMainWindow      = pMainWindow;
+    this->pEventSink       = pEventSink;
     this->pSettingsManager = pSettingsManager;
 
 
+    if (pAudioBackend)
+    {
+        this->pAudioBackend = pAudioBackend;
+    }
+    else
+    {
+        this->pAudioBackend = new WinMMAudioBackend();
+    }
+
+    streamFormat.iSampleRate   = static_cast<unsigned int>(sampleRate);
+    streamFormat.iFrameSamples = static_cast<size_t>(sampleCount);
+
+
     // Do not record audio now
     bInputReady             = false;
     bTestInputReady         = false;
     bPauseTestInput         = true;
-    bRecordTalk             = false;
+    bRecordedSome           = false;
     bMuteMic                = false;
 
 
-    // "In" (record) buffers
-    pWaveIn1                = nullptr;
-    pWaveIn2                = nullptr;
-    pWaveIn3                = nullptr;
-    pWaveIn4                = nullptr;
+    // Input
+    pCaptureStream          = nullptr;
+    pTestCaptureStream      = nullptr;
+
+    pCaptureRing            = nullptr;
+    pOverrunFrame           = nullptr;
+    pTestCaptureRing        = nullptr;
+    pTestOverrunFrame       = nullptr;
+    iCapturePeriodMS        = AUDIO_CAPTURE_PERIOD_MS;
+
+    pPacket                 = new short int [ static_cast<size_t>(sampleCount) ];
+    iPacketFill             = 0;
+
+    pVoicePathStats         = new VoicePathStats();
+
+
+    // Voice activation (decides on the whole packets).
+    unsigned int iPacketMS  = static_cast<unsigned int>( sampleCount * 1000 / static_cast<int>(sampleRate) );
+
+    pVoiceDetector          = new VoiceActivityDetector(iPacketMS);
+    pTestVoiceDetector      = new VoiceActivityDetector(iPacketMS);
+
 
-    pTestWaveIn1                = nullptr;
-    pTestWaveIn2                = nullptr;
-    pTestWaveIn3                = nullptr;
-    pTestWaveIn4                = nullptr;
+    // Deferred actions.
+    pAudioTimer             = new AudioTimer();
+    iLastMessageTask        = AUDIO_TIMER_NO_TASK;
+
+
+    // Output
+    pPlaybackStream         = nullptr;
+    pTestPlaybackStream     = nullptr;
+    pAudioMixer             = nullptr;
+    pMixFrame               = nullptr;
 
 
     // All audio will be x1.45 volume
@@ -54,7 +105,8 @@ AudioService::AudioService(MainWindow* pMainWindow, SettingsManager* pSettingsMa
     fMasterVolumeMult       = 1.45f;
 
     iAudioInputVolume = pSettingsManager->getCurrentSettings()->iInputVolumeMultiplier;
-    iLowerVoiceStartRecValueInDBFS = pSettingsManager->getCurrentSettings()->iVoiceStartRecValueInDBFS;
+    setVoiceStartValue( pSettingsManager->getCurrentSettings()->iVoiceStartRecValueInDBFS );
+    setVoiceNoiseGating( pSettingsManager->getCurrentSettings()->bVoiceNoiseGating );
     bOutputTestVoice = !pSettingsManager->getCurrentSettings()->bPushToTalkVoiceMode;
 
     startTestWaveOut();
@@ -78,6 +130,14 @@ bool AudioService::getMuteMic()
     return bMuteMic;
 }
 
+void AudioService::setCapturePeriod(unsigned int iPeriodMS)
+{
+    // Not longer than the voice packet.
+    unsigned int iPacketMS = static_cast<unsigned int>( sampleCount * 1000 / static_cast<int>(sampleRate) ) + 1;
+
+    iCapturePeriodMS = std::max( static_cast<unsigned int>(AUDIO_CAPTURE_MIN_PERIOD_MS), std::min(iPeriodMS, iPacketMS) );
+}
+
 float AudioService::getUserCurrentVolume(const std::string &sUserName)
 {
     pNetworkService->getOtherUsersMutex()->lock();
@@ -85,14 +145,11 @@ float AudioService::getUserCurrentVolume(const std::string &sUserName)
 
     float fUserVolume = 0.0f;
 
-    for (size_t i = 0;   i < pNetworkService->getOtherUsersVectorSize();   i++)
-    {
-        if ( pNetworkService->getOtherUser(i)->sUserName == sUserName )
-        {
-            fUserVolume = pNetworkService->getOtherUser(i)->fUserDefinedVolume;
+    User* pUser = pNetworkService->findOtherUser(sUserName);
 
-            break;
-        }
+    if (pUser)
+    {
+        fUserVolume = pUser->fUserDefinedVolume;
     }
 
 
@@ -105,33 +162,7 @@ float AudioService::getUserCurrentVolume(const std::string &sUserName)
 
 std::vector<std::wstring> AudioService::getInputDevices()
 {
-    UINT iInDeviceCount = waveInGetNumDevs();
-
-    std::vector<std::wstring> vSupportedDevices;
-
-    for (UINT i = 0; i < iInDeviceCount; i++)
-    {
-        WAVEINCAPS deviceInfo;
-
-        MMRESULT result = waveInGetDevCaps(i, &deviceInfo, sizeof(deviceInfo));
-        if (result)
-        {
-            char fault [256];
-            memset (fault, 0, 256);
-
-            waveInGetErrorTextA (result, fault, 256);
-            pMainWindow->printOutput (std::string("AudioService::getInputDevices::waveInGetDevCaps() error: " + std::string(fault) + "."),
-                                      SilentMessage(false),
-                                      true);
-           continue;
-        }
-        else
-        {
-            vSupportedDevices.push_back(deviceInfo.szPname);
-        }
-    }
-
-    return vSupportedDevices;
+    return pAudioBackend->getInputDevices();
 }
 
 int AudioService::getAudioPacketSizeInSamples() const
@@ -139,150 +170,182 @@ int AudioService::getAudioPacketSizeInSamples() const
     return sampleCount;
 }
 
-void AudioService::setNewMasterVolume(unsigned short int iVolume)
+VoicePathStats* AudioService::getVoicePathStats()
 {
-    pNetworkService->getOtherUsersMutex()->lock();
+    return pVoicePathStats;
+}
+
+void AudioService::saveVoicePathStats()
+{
+    // Next to the settings (Documents folder).
 
+    TCHAR   my_documents[MAX_PATH];
+    HRESULT result = SHGetFolderPathW( nullptr, CSIDL_PERSONAL, nullptr, SHGFP_TYPE_CURRENT, my_documents );
 
-    for (size_t i = 0;  i < pNetworkService->getOtherUsersVectorSize();  i++)
+    if (result != S_OK)
+    {
+        pEventSink->printOutput("AudioService::saveVoicePathStats() error: can't get the path to the Documents folder.",
+                                SilentMessage(false),
+                                true);
+
+        return;
+    }
+
+
+    std::wstring sPath = std::wstring(my_documents) + L"\\" + VOICE_PATH_STATS_FILE_NAME;
+
+    std::string sJitterBufferStats = formatJitterBufferStats();
+
+    if ( pVoicePathStats->saveToFile(sPath, sJitterBufferStats) )
     {
-        waveOutSetVolume( pNetworkService->getOtherUser(i)->hWaveOut, MAKELONG(iVolume, iVolume) );
+        pEventSink->printOutput("AudioService::saveVoicePathStats() error: can't write the file.",
+                                SilentMessage(false),
+                                true);
+
+        return;
     }
 
-    waveOutSetVolume( hTestWaveOut, MAKELONG(iVolume, iVolume) );
 
+    std::wstring sFileName = VOICE_PATH_STATS_FILE_NAME;
 
-    pNetworkService->getOtherUsersMutex()->unlock();
+    pEventSink->printOutput(pVoicePathStats->format() + sJitterBufferStats + "Added to " + std::string(sFileName.begin(), sFileName.end()) + " in the Documents folder.",
+                            SilentMessage(false));
 }
 
-void AudioService::setNewUserVolume(std::string sUserName, float fVolume)
+std::string AudioService::formatJitterBufferStats()
 {
-    User* pUser = nullptr;
+    std::string sText = "Jitter buffers (depth in frames, jitter in ms, packets / frames since the user connected):\n";
 
-    pNetworkService->getOtherUsersMutex()->lock();
+    char vLine[256];
 
+    std::snprintf(vLine, sizeof(vLine), "%-20s %6s %6s %7s %9s %9s %10s %9s\n",
+                  "user", "depth", "target", "jitter", "late", "lost", "concealed", "dropped");
 
+    sText += vLine;
 
-    for (size_t i = 0;   i < pNetworkService->getOtherUsersVectorSize();   i++)
+
+    pNetworkService->getOtherUsersMutex()->lock();
+
+    for (size_t i = 0;  i < pNetworkService->getOtherUsersVectorSize();  i++)
     {
-        if (pNetworkService->getOtherUser(i)->sUserName == sUserName)
+        User* pUser = pNetworkService->getOtherUser(i);
+
+        if (pUser->pJitterBuffer == nullptr)
         {
-            pUser = pNetworkService->getOtherUser(i);
-            break;
+            continue;
         }
-    }
 
-    if (pUser)
-    {
-       pUser->fUserDefinedVolume = fVolume;
-    }
 
+        // The playback thread changes the jitter buffers only under this mutex.
 
+        JitterBufferStats stats = pUser->pJitterBuffer->getStats();
+
+        std::snprintf(vLine, sizeof(vLine), "%-20s %6zu %6zu %7.1f %9llu %9llu %10llu %9llu\n",
+                      pUser->sUserName.c_str(), stats.iCurrentDepth, stats.iTargetDepth, static_cast<double>(stats.fJitterInMS),
+                      stats.iLatePackets, stats.iLostPackets, stats.iConcealedFrames, stats.iDroppedFrames);
+
+        sText += vLine;
+    }
 
     pNetworkService->getOtherUsersMutex()->unlock();
+
+
+    return sText;
 }
 
-void AudioService::prepareForStart()
+void AudioService::setNewMasterVolume(unsigned short int iVolume)
 {
-    pWaveIn1  = new short int [ static_cast<size_t>(sampleCount) ];
-    pWaveIn2  = new short int [ static_cast<size_t>(sampleCount) ];
-    pWaveIn3  = new short int [ static_cast<size_t>(sampleCount) ];
-    pWaveIn4  = new short int [ static_cast<size_t>(sampleCount) ];
+    pNetworkService->getOtherUsersMutex()->lock();
+
 
+    if (pPlaybackStream)
+    {
+        // Output is started.
+        pPlaybackStream->setVolume(iVolume);
+    }
+
+    if (pTestPlaybackStream)
+    {
+        pTestPlaybackStream->setVolume(iVolume);
+    }
 
-    // Format
-    Format.wFormatTag      = WAVE_FORMAT_PCM;
-    Format.nChannels       = 1;    //  '1' - mono, '2' - stereo
-    Format.cbSize          = 0;
-    Format.wBitsPerSample  = 16;
-    Format.nSamplesPerSec  = sampleRate;
-    Format.nBlockAlign     = Format.nChannels      * Format.wBitsPerSample / 8;
-    Format.nAvgBytesPerSec = Format.nSamplesPerSec * Format.nChannels           * Format.wBitsPerSample / 8;
 
+    pNetworkService->getOtherUsersMutex()->unlock();
+}
 
-    // "In" buffers
+void AudioService::setNewUserVolume(std::string sUserName, float fVolume)
+{
+    pNetworkService->getOtherUsersMutex()->lock();
 
-    // Audio buffer 1
-    WaveInHdr1.lpData          = reinterpret_cast <LPSTR>         (pWaveIn1);
-    WaveInHdr1.dwBufferLength  = static_cast      <unsigned long> (sampleCount * 2);
-    WaveInHdr1.dwBytesRecorded = 0;
-    WaveInHdr1.dwUser          = 0L;
-    WaveInHdr1.dwFlags         = 0L;
-    WaveInHdr1.dwLoops         = 0L;
 
 
-    // Audio buffer 2
-    WaveInHdr2 = WaveInHdr1;
-    WaveInHdr2.lpData = reinterpret_cast <LPSTR> (pWaveIn2);
+    User* pUser = pNetworkService->findOtherUser(sUserName);
 
+    if (pUser)
+    {
+       pUser->fUserDefinedVolume = fVolume;
+    }
 
-    // Audio buffer 3
-    WaveInHdr3 = WaveInHdr1;
-    WaveInHdr3.lpData = reinterpret_cast <LPSTR> (pWaveIn3);
 
 
-    // Audio buffer 4
-    WaveInHdr4 = WaveInHdr1;
-    WaveInHdr4.lpData = reinterpret_cast <LPSTR> (pWaveIn4);
+    pNetworkService->getOtherUsersMutex()->unlock();
 }
 
 bool AudioService::start()
 {
-    MMRESULT result;
+    // Start input device
 
-    UINT iDeviceID = WAVE_MAPPER;
+    AudioStreamFormat captureFormat;
+    captureFormat.iSampleRate   = static_cast<unsigned int>(sampleRate);
+    captureFormat.iFrameSamples = std::min( static_cast<size_t>(sampleRate * iCapturePeriodMS / 1000), static_cast<size_t>(sampleCount) );
 
-    int iPreferredDeviceID = getInputDeviceID( pSettingsManager->getCurrentSettings()->sInputDeviceName );
-    if (iPreferredDeviceID != -1)
+    std::string sError;
+
+    pCaptureStream = pAudioBackend->openCapture( pSettingsManager->getCurrentSettings()->sInputDeviceName, captureFormat, sError );
+
+    if (pCaptureStream == nullptr)
     {
-        iDeviceID = static_cast<UINT>(iPreferredDeviceID);
+        pEventSink->printOutput (std::string("AudioService::start::openCapture() error: " + sError),
+                                  SilentMessage(false),
+                                  true);
+
+        return false;
     }
 
-    // Start input device
-    result = waveInOpen (&hWaveIn,  iDeviceID,  &Format,  0L,  0L,  WAVE_FORMAT_DIRECT);
 
-    if (result)
+    // Start output device
+    if ( startOutput() == false )
     {
-        char fault [256];
-        memset (fault, 0, 256);
+        delete pCaptureStream;
+        pCaptureStream = nullptr;
 
+        return false;
+    }
 
-        waveInGetErrorTextA (result, fault, 256);
-        pMainWindow->printOutput (std::string("AudioService::start::waveInOpen() error: " + std::string(fault) + "."),
-                                   SilentMessage(false),
-                                   true);
 
+    pCaptureRing  = new AudioCaptureRing(captureFormat.iFrameSamples);
+    pOverrunFrame = new short int [captureFormat.iFrameSamples];
 
-        delete[] pWaveIn1;
-        pWaveIn1 = nullptr;
+    pVoicePathStats->reset();
 
-        delete[] pWaveIn2;
-        pWaveIn2 = nullptr;
 
-        delete[] pWaveIn3;
-        pWaveIn3 = nullptr;
+    bInputReady = true;
 
-        delete[] pWaveIn4;
-        pWaveIn4 = nullptr;
 
+    playbackThread = std::thread(&AudioService::playbackLoop, this);
 
-        return false;
-    }
-    else
-    {
-        bInputReady = true;
-    }
 
+    bool bPushToTalk = pSettingsManager->getCurrentSettings()->bPushToTalkVoiceMode;
+
+    encoderThread = std::thread(&AudioService::encodeLoop, this, bPushToTalk == false);
 
-    if (pSettingsManager->getCurrentSettings()->bPushToTalkVoiceMode)
+    if (bPushToTalk)
     {
-        std::thread recordThread (&AudioService::recordOnPush, this);
-        recordThread.detach ();
+        recordThread = std::thread(&AudioService::recordOnPush, this);
     }
     else
     {
-        std::thread recordThread (&AudioService::recordOnTalk, this);
-        recordThread.detach ();
+        recordThread = std::thread(&AudioService::recordOnTalk, this);
     }
 
     return true;
@@ -290,94 +353,44 @@ bool AudioService::start()
 
 void AudioService::startTestWaveOut()
 {
-    pTestWaveIn1  = new short int [ static_cast<size_t>(sampleCount) ];
-    pTestWaveIn2  = new short int [ static_cast<size_t>(sampleCount) ];
-    pTestWaveIn3  = new short int [ static_cast<size_t>(sampleCount) ];
-    pTestWaveIn4  = new short int [ static_cast<size_t>(sampleCount) ];
-
-
-    // Format
-    Format.wFormatTag      = WAVE_FORMAT_PCM;
-    Format.nChannels       = 1;    //  '1' - mono, '2' - stereo
-    Format.cbSize          = 0;
-    Format.wBitsPerSample  = 16;
-    Format.nSamplesPerSec  = sampleRate;
-    Format.nBlockAlign     = Format.nChannels      * Format.wBitsPerSample / 8;
-    Format.nAvgBytesPerSec = Format.nSamplesPerSec * Format.nChannels           * Format.wBitsPerSample / 8;
-
-
-    // "In" buffers
-
-    // Audio buffer 1
-    TestWaveInHdr1.lpData          = reinterpret_cast <LPSTR>         (pTestWaveIn1);
-    TestWaveInHdr1.dwBufferLength  = static_cast      <unsigned long> (sampleCount * 2);
-    TestWaveInHdr1.dwBytesRecorded = 0;
-    TestWaveInHdr1.dwUser          = 0L;
-    TestWaveInHdr1.dwFlags         = 0L;
-    TestWaveInHdr1.dwLoops         = 0L;
-
-
-    // Audio buffer 2
-    TestWaveInHdr2 = TestWaveInHdr1;
-    TestWaveInHdr2.lpData = reinterpret_cast <LPSTR> (pTestWaveIn2);
-
-
-    // Audio buffer 3
-    TestWaveInHdr3 = TestWaveInHdr1;
-    TestWaveInHdr3.lpData = reinterpret_cast <LPSTR> (pTestWaveIn3);
-
-
-    // Audio buffer 4
-    TestWaveInHdr4 = TestWaveInHdr1;
-    TestWaveInHdr4.lpData = reinterpret_cast <LPSTR> (pTestWaveIn4);
-
-    MMRESULT result;
-
-    UINT iDeviceID = WAVE_MAPPER;
-
-    int iPreferredDeviceID = getInputDeviceID( pSettingsManager->getCurrentSettings()->sInputDeviceName );
-    if (iPreferredDeviceID != -1)
-    {
-        iDeviceID = static_cast<UINT>(iPreferredDeviceID);
-    }
+    std::string sError;
 
     // Start input device
-    result = waveInOpen (&hTestWaveIn,  iDeviceID,  &Format,  0L,  0L,  WAVE_FORMAT_DIRECT);
+    pTestCaptureStream = pAudioBackend->openCapture( pSettingsManager->getCurrentSettings()->sInputDeviceName, streamFormat, sError );
 
-    if (result)
+    if (pTestCaptureStream == nullptr)
     {
-        char fault [256];
-        memset (fault, 0, 256);
-
-
-        waveInGetErrorTextA (result, fault, 256);
-        pMainWindow->printOutput (std::string("AudioService::startTestWaveOut::waveInOpen() error: " + std::string(fault) + "."),
-                                   SilentMessage(false),
-                                   true);
-
+        pEventSink->printOutput (std::string("AudioService::startTestWaveOut::openCapture() error: " + sError),
+                                  SilentMessage(false),
+                                  true);
 
-        delete[] pTestWaveIn1;
-        pTestWaveIn1 = nullptr;
+        return;
+    }
 
-        delete[] pTestWaveIn2;
-        pTestWaveIn2 = nullptr;
+    pTestCaptureRing  = new AudioCaptureRing( static_cast<size_t>(sampleCount) );
+    pTestOverrunFrame = new short int [ static_cast<size_t>(sampleCount) ];
 
-        delete[] pTestWaveIn3;
-        pTestWaveIn3 = nullptr;
 
-        delete[] pTestWaveIn4;
-        pTestWaveIn4 = nullptr;
+    // Start output device
+    pTestPlaybackStream = pAudioBackend->openPlayback( streamFormat, AUDIO_TEST_OUT_BUFFER_COUNT, sError );
 
-        return;
+    if (pTestPlaybackStream == nullptr)
+    {
+        pEventSink->printOutput (std::string("AudioService::startTestWaveOut::openPlayback() error: " + sError),
+                                  SilentMessage(false),
+                                  true);
     }
     else
     {
-        bTestInputReady = true;
+        pTestPlaybackStream->setVolume( pSettingsManager->getCurrentSettings()->iMasterVolume );
     }
 
 
-    std::thread recordThread (&AudioService::testRecord, this);
-    recordThread.detach ();
+    bTestInputReady = true;
+
+
+    std::thread testRecordThread (&AudioService::testRecord, this);
+    testRecordThread.detach ();
 }
 
 void AudioService::playConnectDisconnectSound(bool bConnectSound)
@@ -386,11 +399,11 @@ void AudioService::playConnectDisconnectSound(bool bConnectSound)
     {
         if (bConnectSound)
         {
-            PlaySoundW( AUDIO_CONNECT_PATH,    nullptr, SND_FILENAME | SND_ASYNC );
+            pAudioBackend->playSoundFile( AUDIO_CONNECT_PATH,    false );
         }
         else
         {
-            PlaySoundW( AUDIO_DISCONNECT_PATH, nullptr, SND_FILENAME | SND_ASYNC );
+            pAudioBackend->playSoundFile( AUDIO_DISCONNECT_PATH, false );
         }
     }
 }
@@ -399,87 +412,48 @@ void AudioService::playMuteMicSound(bool bMuteSound)
 {
     if (bMuteSound)
     {
-        PlaySoundW( AUDIO_MUTE_MIC_PATH,   nullptr, SND_FILENAME | SND_ASYNC );
+        pAudioBackend->playSoundFile( AUDIO_MUTE_MIC_PATH,   false );
     }
     else
     {
-        PlaySoundW( AUDIO_UNMUTE_MIC_PATH, nullptr, SND_FILENAME | SND_ASYNC );
+        pAudioBackend->playSoundFile( AUDIO_UNMUTE_MIC_PATH, false );
     }
 }
 
 void AudioService::playServerMessageSound()
 {
-    PlaySoundW( AUDIO_SERVER_MESSAGE_PATH, nullptr, SND_FILENAME | SND_ASYNC );
+    pAudioBackend->playSoundFile( AUDIO_SERVER_MESSAGE_PATH, false );
 }
 
 void AudioService::playNewMessageSound()
 {
     if (pSettingsManager->getCurrentSettings()->bPlayTextMessageSound)
     {
-       PlaySoundW( AUDIO_NEW_MESSAGE_PATH, nullptr, SND_FILENAME | SND_ASYNC );
+       pAudioBackend->playSoundFile( AUDIO_NEW_MESSAGE_PATH, false );
     }
 }
 
 void AudioService::playLostConnectionSound()
 {
-    PlaySoundW( AUDIO_LOST_CONNECTION_PATH, nullptr, SND_FILENAME );
+    pAudioBackend->playSoundFile( AUDIO_LOST_CONNECTION_PATH, true );
 }
 
 void AudioService::setupUserAudio(User *pUser)
 {
     pUser->bPacketsArePlaying   = false;
-    pUser->bDeletePacketsAtLast = false;
-    pUser->bLastPacketCame      = false;
     pUser->fUserDefinedVolume   = 1.0f;
-
-
-    // Audio buffer1
-    pUser->WaveOutHdr1.dwBufferLength  = static_cast <unsigned long> (sampleCount * 2);
-    pUser->WaveOutHdr1.dwBytesRecorded = 0;
-    pUser->WaveOutHdr1.dwUser          = 0L;
-    pUser->WaveOutHdr1.dwFlags         = 0L;
-    pUser->WaveOutHdr1.dwLoops         = 0L;
-
-    // Audio buffer2
-    pUser->WaveOutHdr2 = pUser->WaveOutHdr1;
-
-
-
-    // Start output device
-    MMRESULT result = waveOutOpen( &pUser->hWaveOut,  WAVE_MAPPER,  &Format,  0L,  0L,  WAVE_FORMAT_DIRECT );
-
-    if (result)
-    {
-        char fault [256];
-        memset (fault, 0, 256);
-
-        waveInGetErrorTextA (result, fault, 256);
-        pMainWindow->printOutput(std::string("AudioService::addNewUser::waveOutOpen() error: " + std::string(fault) + "."),
-                                  SilentMessage(false),
-                                  true);
-    }
-
-    waveOutSetVolume( pUser->hWaveOut, MAKELONG(pSettingsManager->getCurrentSettings()->iMasterVolume,
-                                                 pSettingsManager->getCurrentSettings()->iMasterVolume) );
+    pUser->pJitterBuffer        = new JitterBuffer( static_cast<size_t>(sampleCount), sampleRate );
 }
 
 void AudioService::deleteUserAudio(User *pUser)
 {
-    pUser->mtxUser. lock();
+    pUser->voicePackets.clear();
 
-
-    for (size_t j = 0;  j < pUser->vAudioPackets.size();  j++)
+    if (pUser->pJitterBuffer)
     {
-        if (pUser->vAudioPackets[j])
-        {
-            delete[] pUser->vAudioPackets[j];
-        }
+        delete pUser->pJitterBuffer;
+        pUser->pJitterBuffer = nullptr;
     }
-
-    waveOutClose (pUser->hWaveOut);
-
-
-    pUser->mtxUser. unlock();
 }
 
 void AudioService::setTestRecordingPause(bool bPause)
@@ -489,843 +463,348 @@ void AudioService::setTestRecordingPause(bool bPause)
 
 void AudioService::recordOnPush()
 {
-    MMRESULT result;
-
-
-    bool bError               = false;
-    bool bButtonPressed       = false;
-    bool bWaitForFourthBuffer = false;
-
     while(bInputReady)
     {
-        while ( (GetAsyncKeyState(pSettingsManager->getCurrentSettings()->iPushToTalkButton) & 0x8000)
-                && bInputReady
-                && bMuteMic == false)
+        if ( pAudioBackend->isKeyPressed(pSettingsManager->getCurrentSettings()->iPushToTalkButton)
+             && bMuteMic == false )
         {
             // Button pressed
-            if ( (bButtonPressed == false) && (pSettingsManager->getCurrentSettings()->bPlayPushToTalkSound) )
+            if (pSettingsManager->getCurrentSettings()->bPlayPushToTalkSound)
             {
-                PlaySoundW( AUDIO_PRESS_PATH, nullptr, SND_FILENAME | SND_ASYNC );
+                pAudioBackend->playSoundFile( AUDIO_PRESS_PATH, false );
             }
 
-            bButtonPressed = true;
 
-            if (bWaitForFourthBuffer == false)
+            if ( pCaptureStream->start() == false )
             {
-                // Add 1st buffer
-                if ( addInBuffer(&WaveInHdr1) )
-                {
-                    bError = true;
-                    break;
-                }
+                // Record and send until the button is unpressed,
+                // the frames that are already being recorded at that moment are sent too.
 
-                // Add 2nd buffer
-                if ( addInBuffer(&WaveInHdr2) )
+                do
                 {
-                    bError = true;
-                    break;
-                }
+                    if ( (bInputReady == false)
+                         || (pAudioBackend->isKeyPressed(pSettingsManager->getCurrentSettings()->iPushToTalkButton) == false)
+                         || bMuteMic )
+                    {
+                        pCaptureStream->stop();
+                    }
+                }while ( captureFrame(pCaptureStream, pCaptureRing, pOverrunFrame) == false );
+            }
 
-                // Add 3rd buffer
-                if ( addInBuffer(&WaveInHdr3) )
-                {
-                    bError = true;
-                    break;
-                }
 
-                // Add 4th buffer
-                if ( addInBuffer(&WaveInHdr4) )
-                {
-                    bError = true;
-                    break;
-                }
+            if (pCaptureStream->getLastError().empty() == false)
+            {
+                pEventSink->printOutput(std::string("AudioService::recordOnPush() error: " + pCaptureStream->getLastError()),
+                                         SilentMessage(false),
+                                         true);
+            }
 
-                // Start recording for ('sampleCount/sampleRate' * 4) seconds
-                // Current buffers queue: 1 (recording) - 2 - 3 - 4.
-                result = waveInStart(hWaveIn);
 
-                if (result)
-                {
-                    char fault [256];
-                    memset (fault, 0, 256);
+            if (bInputReady)
+            {
+                // Button unpressed (the encoder thread sends the end of talk after the last frame).
 
-                    waveInGetErrorTextA (result, fault, 256);
-                    pMainWindow->printOutput(std::string("AudioService::recordOnPress::waveInStart() error: " + std::string(fault) + "."),
-                                              SilentMessage(false),
-                                              true);
+                pCaptureRing->pushEndOfTalk();
 
-                    bError = true;
-                    break;
+                if ( pSettingsManager->getCurrentSettings()->bPushToTalkVoiceMode
+                     && pSettingsManager->getCurrentSettings()->bPlayPushToTalkSound )
+                {
+                    pAudioBackend->playSoundFile( AUDIO_UNPRESS_PATH, false );
                 }
             }
-            else
+        }
+
+        if (bInputReady) std::this_thread::sleep_for( std::chrono::milliseconds(INTERVAL_AUDIO_RECORD_MS) );
+    }
+}
+
+void AudioService::recordOnTalk()
+{
+    if ( pCaptureStream->start() == false )
+    {
+        do
+        {
+            if (bInputReady == false)
             {
-                // Wait until 4th buffer finished recording.
-                // 4-1-2-3.
-                waitAndSendBuffer(&WaveInHdr4, pWaveIn4);
-
-                ///////////////////////////////
-                // Add 4th buffer
-                // 1-2-3-(4).
-                ///////////////////////////////
-                if ( addInBuffer(&WaveInHdr4) )
-                {
-                    bError = true;
-                    break;
-                }
+                pCaptureStream->stop();
             }
+        }while ( captureFrame(pCaptureStream, pCaptureRing, pOverrunFrame) == false );
+    }
 
 
-            // Wait until 1st buffer finished recording.
-            // 1-2-3-4.
-            waitAndSendBuffer (&WaveInHdr1, pWaveIn1);
+    if (bInputReady)
+    {
+        // Stopped not by stop().
 
+        pEventSink->printOutput(std::string("AudioService::recordOnTalk() error: " + pCaptureStream->getLastError()),
+                                 SilentMessage(false),
+                                 true);
 
-            ///////////////////////////////
-            // Add 1st buffer
-            // 2-3-4-(1).
-            ///////////////////////////////
-            if ( addInBuffer(&WaveInHdr1) )
-            {
-                bError = true;
-                break;
-            }
+        pEventSink->showMessageBox(true, "The voice recording won't work.");
+    }
+}
 
+void AudioService::testRecord()
+{
+    bool bError = false;
 
-            // Wait until 2nd buffer finished recording.
-            // 2-3-4-1.
-            waitAndSendBuffer (&WaveInHdr2, pWaveIn2);
+    pTestVoiceDetector->reset();
 
+    std::thread tOutputThread(&AudioService::testOutputAudio, this);
+    tOutputThread.detach();
 
-            ///////////////////
-            // Add 2nd buffer.
-            // 3-4-1-(2).
-            ///////////////////
+    // One thread processes all captured frames.
+    testVolumeThread = std::thread(&AudioService::testVolumeLoop, this);
 
-            if ( addInBuffer(&WaveInHdr2) )
-            {
-                bError = true;
-                break;
-            }
 
+    while(bTestInputReady)
+    {
+        while (bPauseTestInput)
+        {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
 
-            // Wait until 3rd buffer finished recording.
-            // 3-4-1-2.
-            waitAndSendBuffer (&WaveInHdr3, pWaveIn3);
+            if (bTestInputReady == false) break;
+        }
 
+        if (bTestInputReady == false) break;
 
-            ///////////////////
-            // Add 3rd buffer.
-            // 4-1-2-(3).
-            ///////////////////
 
-            if ( (GetAsyncKeyState(pSettingsManager->getCurrentSettings()->iPushToTalkButton) & 0x8000)
-                 && bMuteMic == false)
+        if ( pTestCaptureStream->start() == false )
+        {
+            do
             {
-                if ( addInBuffer(&WaveInHdr3) )
+                if (bPauseTestInput || (bTestInputReady == false))
                 {
-                    bError = true;
-                    break;
+                    pTestCaptureStream->stop();
                 }
-
-                bWaitForFourthBuffer = true;
-            }
-            else break;
+            }while ( captureFrame(pTestCaptureStream, pTestCaptureRing, pTestOverrunFrame) == false );
         }
 
 
-
-        if (bButtonPressed && bInputReady)
+        if (pTestCaptureStream->getLastError().empty() == false)
         {
-            // Button unpressed
-            bButtonPressed = false;
-            bWaitForFourthBuffer = false;
+            pEventSink->printOutput(std::string("AudioService::testRecord() error: " + pTestCaptureStream->getLastError()),
+                                     SilentMessage(false),
+                                     true);
 
-            if (bError)
-            {
-                waitForAllInBuffers();
+            bError = true;
+            break;
+        }
+    }
 
-                bError = false;
-            }
+    if (bError)
+    {
+        pEventSink->showMessageBox(true, "The voice volume meter in the settings window will not work.");
+    }
 
-            // Wait until 4th buffer finished recording.
-            // 4-1-2.
-            waitAndSendBuffer (&WaveInHdr4, pWaveIn4);
 
+    // testVolumeLoop() processes what is left in the ring and ends.
+    pTestCaptureRing->wakeUp();
 
-            // Wait until 1st buffer finished recording.
-            waitAndSendBuffer (&WaveInHdr1, pWaveIn1);
+    testVolumeThread.join();
 
 
-            // Wait until 2nd buffer finished recording.
-            waitAndSendBuffer (&WaveInHdr2, pWaveIn2);
+    promiseFinishTestRecord.set_value(false);
+}
 
+bool AudioService::captureFrame(AudioCaptureStream* pStream, AudioCaptureRing* pRing, short int* pOverrunBuffer)
+{
+    short int* pFrame = pRing->getWriteFrame();
 
-            waveInStop(hWaveIn);
+    if (pFrame == nullptr)
+    {
+        // The consumer thread can't keep up, drop this frame (but keep reading the device).
+        return pStream->read(pOverrunBuffer);
+    }
 
 
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    if ( pStream->read(pFrame) )
+    {
+        return true;
+    }
 
+    pRing->pushFrame();
 
-            pNetworkService->sendVoiceMessage(nullptr, 1, true);
 
-            if ( pSettingsManager->getCurrentSettings()->bPushToTalkVoiceMode
-                 && pSettingsManager->getCurrentSettings()->bPlayPushToTalkSound )
-            {
-                PlaySoundW( AUDIO_UNPRESS_PATH, nullptr, SND_FILENAME | SND_ASYNC );
-            }
-        }
-
-        if (bInputReady) std::this_thread::sleep_for( std::chrono::milliseconds(INTERVAL_AUDIO_RECORD_MS) );
-    }
+    return false;
 }
 
-void AudioService::recordOnTalk()
+void AudioService::encodeLoop(bool bOnTalk)
 {
-    MMRESULT result;
+    iPacketFill = 0;
 
-    bool bError = false;
-    bool bWaitForFourthBuffer = false;
-
-    iPacketsNeedToRecordLeft = 4;
-
-    bRecordedSome = false;
-
-    while(bInputReady)
+    if (bOnTalk)
     {
-        if (bWaitForFourthBuffer == false)
-        {
-            // Add 1st buffer
-            if ( addInBuffer(&WaveInHdr1) )
-            {
-                break;
-            }
-
-            // Add 2nd buffer
-            if ( addInBuffer(&WaveInHdr2) )
-            {
-                bError = true;
-                break;
-            }
-
-            // Add 3rd buffer
-            if ( addInBuffer(&WaveInHdr3) )
-            {
-                bError = true;
-                break;
-            }
-
-            // Add 4th buffer
-            if ( addInBuffer(&WaveInHdr4) )
-            {
-                bError = true;
-                break;
-            }
-
-            // Start recording for ('sampleCount/sampleRate' * 4) seconds
-            // Current buffers queue: 1 (recording) - 2 - 3 - 4.
-            result = waveInStart(hWaveIn);
-
-            if (result)
-            {
-                char fault [256];
-                memset (fault, 0, 256);
-
-                waveInGetErrorTextA (result, fault, 256);
-                pMainWindow->printOutput(std::string("AudioService::recordOnTalk::waveInStart() error: " + std::string(fault) + "."),
-                                          SilentMessage(false),
-                                          true);
-
-                bError = true;
-                break;
-            }
-        }
-        else
-        {
-            // Wait until 4th buffer finished recording.
-            // 4-1-2-3.
-            waitAndSendBuffer(&WaveInHdr4, pWaveIn4, true);
-
-            ///////////////////////////////
-            // Add 4th buffer
-            // 1-2-3-(4).
-            ///////////////////////////////
-            if ( addInBuffer(&WaveInHdr4) )
-            {
-                bError = true;
-                break;
-            }
-        }
+        pVoiceDetector->reset();
 
+        bRecordedSome = false;
+    }
 
-        // Wait until 1st buffer finished recording.
-        // 1-2-3-4.
-        waitAndSendBuffer (&WaveInHdr1, pWaveIn1, true);
 
+    while (true)
+    {
+        const AudioCaptureRingFrame* pFrame = pCaptureRing->waitFrame();
 
-        ///////////////////////////////
-        // Add 1st buffer
-        // 2-3-4-(1).
-        ///////////////////////////////
-        if ( addInBuffer(&WaveInHdr1) )
+        if (pFrame == nullptr)
         {
-            bError = true;
+            // Woken up by stop() (the capture is finished and everything is sent).
             break;
         }
 
 
-        // Wait until 2nd buffer finished recording.
-        // 2-3-4-1.
-        waitAndSendBuffer (&WaveInHdr2, pWaveIn2, true);
-
-
-        ///////////////////
-        // Add 2nd buffer.
-        // 3-4-1-(2).
-        ///////////////////
-
-        if ( addInBuffer(&WaveInHdr2) )
+        if (pFrame->bEndOfTalk)
         {
-            bError = true;
-            break;
+            finishTalk();
         }
-
-
-        // Wait until 3rd buffer finished recording.
-        // 3-4-1-2.
-        waitAndSendBuffer (&WaveInHdr3, pWaveIn3, true);
-
-
-        ///////////////////
-        // Add 3rd buffer.
-        // 4-1-2-(3).
-        ///////////////////
-
-        if ( addInBuffer(&WaveInHdr3) )
+        else
         {
-            bError = true;
-            break;
+            pVoicePathStats->recordSince(VPS_CAPTURE_RING, pFrame->captureTime);
+
+            encodeFrame(pFrame, bOnTalk);
         }
 
-        bWaitForFourthBuffer = true;
-    }
 
-    if (bError)
-    {
-        pMainWindow->showMessageBox(true, "The voice recording won't work.");
+        pCaptureRing->popFrame();
     }
 }
 
-void AudioService::testRecord()
+void AudioService::encodeFrame(const AudioCaptureRingFrame* pFrame, bool bOnTalk)
 {
-    MMRESULT result;
-
-    bool bError = false;
-    bool bWasStarted = false;
-    bool bWaitForFourthBuffer = false;
-
-    iTestPacketsNeedToRecordLeft = 4;
-
-    std::thread tOutputThread(&AudioService::testOutputAudio, this);
-    tOutputThread.detach();
+    // Add the frame to the packet, send the packet when it's full.
 
+    size_t iFrameSamples = pCaptureRing->getFrameSamples();
+    size_t iCopied       = 0;
 
-    while(bTestInputReady)
+    while (iCopied < iFrameSamples)
     {
-        while (bPauseTestInput)
-        {
-            if (bWasStarted)
-            {
-                waitForAllTestInBuffers();
+        size_t iCount = std::min( iFrameSamples - iCopied, static_cast<size_t>(sampleCount) - iPacketFill );
 
-                waveInStop(hTestWaveIn);
+        std::memcpy( pPacket + iPacketFill, pFrame->pSamples + iCopied, iCount * sizeof(short int) );
 
-                bWaitForFourthBuffer = false;
+        iPacketFill += iCount;
+        iCopied     += iCount;
 
-                bWasStarted = false;
-            }
-
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-
-            if (bTestInputReady == false) break;
-        }
 
-        if (bTestInputReady == false) break;
-
-        bWasStarted = true;
-
-        if (bWaitForFourthBuffer == false)
+        if ( iPacketFill == static_cast<size_t>(sampleCount) )
         {
-            // Add 1st buffer
-            if ( addInBuffer(&TestWaveInHdr1, true) )
-            {
-                break;
-            }
-
-            // Add 2nd buffer
-            if ( addInBuffer(&TestWaveInHdr2, true) )
+            if (bOnTalk)
             {
-                bError = true;
-                break;
+                sendAudioDataOnTalk(pPacket);
             }
-
-            // Add 3rd buffer
-            if ( addInBuffer(&TestWaveInHdr3, true) )
-            {
-                bError = true;
-                break;
-            }
-
-            // Add 4th buffer
-            if ( addInBuffer(&TestWaveInHdr4, true) )
+            else
             {
-                bError = true;
-                break;
+                sendAudioData(pPacket);
             }
 
-            // Start recording for ('sampleCount/sampleRate' * 4) seconds
-            // Current buffers queue: 1 (recording) - 2 - 3 - 4.
-            result = waveInStart(hTestWaveIn);
+            iPacketFill = 0;
 
-            if (result)
-            {
-                char fault [256];
-                memset (fault, 0, 256);
 
-                waveInGetErrorTextA (result, fault, 256);
-                pMainWindow->printOutput(std::string("AudioService::testRecord::waveInStart() error: " + std::string(fault) + "."),
-                                          SilentMessage(false),
-                                          true);
-
-                bError = true;
-                break;
-            }
-        }
-        else
-        {
-            // Wait until 4th buffer finished recording.
-            // 4-1-2-3.
-            waitAndShowBufferVolume(&TestWaveInHdr4, pTestWaveIn4);
-
-            ///////////////////////////////
-            // Add 4th buffer
-            // 1-2-3-(4).
-            ///////////////////////////////
-            if ( addInBuffer(&TestWaveInHdr4, true) )
-            {
-                bError = true;
-                break;
-            }
+            pVoicePathStats->recordSince(VPS_CAPTURE_TO_SEND, pFrame->captureTime);
         }
-
-
-        // Wait until 1st buffer finished recording.
-        // 1-2-3-4.
-        waitAndShowBufferVolume (&TestWaveInHdr1, pTestWaveIn1);
-
-
-        ///////////////////////////////
-        // Add 1st buffer
-        // 2-3-4-(1).
-        ///////////////////////////////
-        if ( addInBuffer(&TestWaveInHdr1, true) )
-        {
-            bError = true;
-            break;
-        }
-
-
-        // Wait until 2nd buffer finished recording.
-        // 2-3-4-1.
-        waitAndShowBufferVolume (&TestWaveInHdr2, pTestWaveIn2);
-
-
-        ///////////////////
-        // Add 2nd buffer.
-        // 3-4-1-(2).
-        ///////////////////
-
-        if ( addInBuffer(&TestWaveInHdr2, true) )
-        {
-            bError = true;
-            break;
-        }
-
-
-        // Wait until 3rd buffer finished recording.
-        // 3-4-1-2.
-        waitAndShowBufferVolume (&TestWaveInHdr3, pTestWaveIn3);
-
-
-        ///////////////////
-        // Add 3rd buffer.
-        // 4-1-2-(3).
-        ///////////////////
-
-        if ( addInBuffer(&TestWaveInHdr3, true) )
-        {
-            bError = true;
-            break;
-        }
-
-        bWaitForFourthBuffer = true;
-    }
-
-    if (bError)
-    {
-        pMainWindow->showMessageBox(true, "The voice volume meter in the settings window will not work.");
     }
-
-    promiseFinishTestRecord.set_value(false);
 }
 
-bool AudioService::addInBuffer(LPWAVEHDR buffer, bool bTestDevice)
+void AudioService::finishTalk()
 {
-    MMRESULT result;
-
-
-    if (bTestDevice)
-    {
-        result = waveInPrepareHeader(hTestWaveIn, buffer, sizeof(WAVEHDR));
-    }
-    else
+    if (iPacketFill != 0)
     {
-        result = waveInPrepareHeader(hWaveIn, buffer, sizeof(WAVEHDR));
-    }
+        // Send the end of the talk (with silence at the end) so it's not cut off.
 
-    if (result)
-    {
-        char fault[256];
-        memset(fault, 0, 256);
+        std::memset( pPacket + iPacketFill, 0, (static_cast<size_t>(sampleCount) - iPacketFill) * sizeof(short int) );
 
-        waveInGetErrorTextA(result, fault, 256);
-        pMainWindow->printOutput(std::string("AudioService::addInBuffer::waveInPrepareHeader() error: " + std::string(fault) + "."),
-                                 SilentMessage(false), true);
+        sendAudioData(pPacket);
 
-        return true;
+        iPacketFill = 0;
     }
 
 
-    // Insert a wave input buffer to waveform-audio input device
-    if (bTestDevice)
-    {
-        result = waveInAddBuffer (hTestWaveIn, buffer, sizeof(WAVEHDR));
-    }
-    else
-    {
-        result = waveInAddBuffer (hWaveIn, buffer, sizeof(WAVEHDR));
-    }
-
-    if (result)
-    {
-        char fault[256];
-        memset(fault, 0, 256);
-
-        waveInGetErrorTextA(result, fault, 256);
-        pMainWindow->printOutput(std::string("AudioService::addInBuffer::waveInAddBuffer() error: " + std::string(fault) + "."),
-                                 SilentMessage(false), true);
-
-        if (bTestDevice)
-        {
-            waveInUnprepareHeader(hTestWaveIn, buffer, sizeof(WAVEHDR));
-        }
-        else
-        {
-            waveInUnprepareHeader(hWaveIn, buffer, sizeof(WAVEHDR));
-        }
-
-        return true;
-    }
-
-
-    return false;
-}
-
-bool AudioService::addOutBuffer(HWAVEOUT hWaveOut, LPWAVEHDR buffer)
-{
-    MMRESULT result;
-
-    result = waveOutPrepareHeader (hWaveOut, buffer, sizeof(WAVEHDR));
-
-    if (result)
-    {
-        char fault [256];
-        memset (fault, 0, 256);
-
-        waveInGetErrorTextA (result, fault, 256);
-        pMainWindow->printOutput(std::string("AudioService::addOutBuffer::waveOutPrepareHeader() error (" + std::to_string(result) + "): " + std::string(fault) + "."),
-                                  SilentMessage(false),
-                                  true);
-
-        return true;
-    }
-
-
-    return false;
-}
-
-void AudioService::waitAndSendBuffer(WAVEHDR *WaveInHdr, short *pWaveIn, bool bOnTalk)
-{
-    // Wait until buffer finished recording.
-
-    while (waveInUnprepareHeader(hWaveIn, WaveInHdr, sizeof(WAVEHDR)) == WAVERR_STILLPLAYING)
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds(BUFFER_UPDATE_CHECK_MS));
-    }
-
-
-    // Make a copy
-    short* pAudioCopy = new short [ static_cast <unsigned long long> (sampleCount) ];
-    std::memcpy ( pAudioCopy, pWaveIn, static_cast <unsigned long long> (sampleCount * 2) );
-
-
-    // Compress and send in other thread
-    if (bOnTalk)
-    {
-        std::thread compressThread (&AudioService::sendAudioDataOnTalk, this, pAudioCopy);
-        compressThread.detach();
-    }
-    else
-    {
-        std::thread compressThread (&AudioService::sendAudioData, this, pAudioCopy);
-        compressThread.detach();
-    }
+    sendLastMessageLater();
 }
 
-void AudioService::waitAndShowBufferVolume(WAVEHDR *WaveInHdr, short *pWaveIn)
+void AudioService::sendLastMessageLater()
 {
-    // Wait until buffer finished recording.
+    // Let the last voice packet go first, without stalling the encoder thread.
 
-    while (waveInUnprepareHeader(hWaveIn, WaveInHdr, sizeof(WAVEHDR)) == WAVERR_STILLPLAYING)
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds(BUFFER_UPDATE_CHECK_MS));
-    }
-
-
-    // Make a copy
-    short* pAudioCopy = new short [ static_cast <unsigned long long> (sampleCount) ];
-    std::memcpy ( pAudioCopy, pWaveIn, static_cast <unsigned long long> (sampleCount * 2) );
-
-
-    // Compress and send in other thread
-    std::thread compressThread (&AudioService::sendAudioDataVolume, this, pAudioCopy);
-    compressThread.detach();
-}
-
-void AudioService::waitForAllInBuffers()
-{
-    while (waveInUnprepareHeader(hWaveIn, &WaveInHdr1, sizeof(WAVEHDR)) == WAVERR_STILLPLAYING)
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds(BUFFER_UPDATE_CHECK_MS));
-    }
-    while (waveInUnprepareHeader(hWaveIn, &WaveInHdr2, sizeof(WAVEHDR)) == WAVERR_STILLPLAYING)
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds(BUFFER_UPDATE_CHECK_MS));
-    }
-    while (waveInUnprepareHeader(hWaveIn, &WaveInHdr3, sizeof(WAVEHDR)) == WAVERR_STILLPLAYING)
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds(BUFFER_UPDATE_CHECK_MS));
-    }
-    while (waveInUnprepareHeader(hWaveIn, &WaveInHdr4, sizeof(WAVEHDR)) == WAVERR_STILLPLAYING)
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds(BUFFER_UPDATE_CHECK_MS));
-    }
-}
+    NetworkService* pNetworkService = this->pNetworkService;
 
-void AudioService::waitForAllTestInBuffers()
-{
-    while (waveInUnprepareHeader(hTestWaveIn, &TestWaveInHdr1, sizeof(WAVEHDR)) == WAVERR_STILLPLAYING)
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds(BUFFER_UPDATE_CHECK_MS));
-    }
-    while (waveInUnprepareHeader(hTestWaveIn, &TestWaveInHdr2, sizeof(WAVEHDR)) == WAVERR_STILLPLAYING)
+    iLastMessageTask = pAudioTimer->schedule( AUDIO_LAST_MESSAGE_DELAY_MS, [pNetworkService]()
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(BUFFER_UPDATE_CHECK_MS));
-    }
-    while (waveInUnprepareHeader(hTestWaveIn, &TestWaveInHdr3, sizeof(WAVEHDR)) == WAVERR_STILLPLAYING)
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds(BUFFER_UPDATE_CHECK_MS));
-    }
-    while (waveInUnprepareHeader(hTestWaveIn, &TestWaveInHdr4, sizeof(WAVEHDR)) == WAVERR_STILLPLAYING)
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds(BUFFER_UPDATE_CHECK_MS));
-    }
+        pNetworkService->sendVoiceMessage(nullptr, 1, true);
+    });
 }
 
-void AudioService::waitForAllTestOutBuffers()
+void AudioService::flushLastMessage()
 {
-    // Wait until finished playing 1
-    while ( waveOutUnprepareHeader(hTestWaveOut, &TestWaveOutHdr1, sizeof(WAVEHDR)) == WAVERR_STILLPLAYING )
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds(BUFFER_UPDATE_CHECK_MS));
-    }
+    // A new talk started (or stop()) before the end of the previous one was sent, send it now
+    // so it doesn't come after the new voice packets.
 
-    // Wait until finished playing 2
-    while ( waveOutUnprepareHeader(hTestWaveOut, &TestWaveOutHdr2, sizeof(WAVEHDR)) == WAVERR_STILLPLAYING )
+    if (iLastMessageTask != AUDIO_TIMER_NO_TASK)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(BUFFER_UPDATE_CHECK_MS));
-    }
-}
+        // Sent by this call (true) or by the timer thread (false, runNow() waits if it's being sent right now),
+        // either way it's out before the new voice packets.
+        pAudioTimer->runNow(iLastMessageTask);
 
-void AudioService::waitForPlayToEnd(User *pUser, WAVEHDR* pWaveOutHdr, size_t& iLastPlayingPacketIndex)
-{
-    // Wait until finished playing buffer
-    while (waveOutUnprepareHeader(pUser->hWaveOut, pWaveOutHdr, sizeof(WAVEHDR)) == WAVERR_STILLPLAYING)
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds(BUFFER_UPDATE_CHECK_MS));
+        iLastMessageTask = AUDIO_TIMER_NO_TASK;
     }
-
-    delete[] pUser->vAudioPackets[iLastPlayingPacketIndex];
-    pUser->vAudioPackets[iLastPlayingPacketIndex] = nullptr;
-
-    iLastPlayingPacketIndex++;
 }
 
-void AudioService::waitForPlayOnTestToEnd(WAVEHDR *pWaveOutHdr)
-{
-    // Wait until finished playing buffer
-    while (waveOutUnprepareHeader(hTestWaveOut, pWaveOutHdr, sizeof(WAVEHDR)) == WAVERR_STILLPLAYING)
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds(BUFFER_UPDATE_CHECK_MS));
-    }
-}
-
-
 void AudioService::sendAudioData(short *pAudio)
 {
     if (iAudioInputVolume != 100)
     {
-        float fInputMult = iAudioInputVolume / 100.0f;
-
-        for (int t = 0;  t < sampleCount;  t++)
-        {
-            int iNewValue = static_cast <int> (pAudio[t] * fInputMult);
-
-            if      (iNewValue > SHRT_MAX)
-            {
-                pAudio[t] = SHRT_MAX;
-            }
-            else if (iNewValue < SHRT_MIN)
-            {
-                pAudio[t] = SHRT_MIN;
-            }
-            else
-            {
-                pAudio[t] = static_cast <short> (iNewValue);
-            }
-        }
+        AudioDSP::applyGain( pAudio, static_cast<size_t>(sampleCount), iAudioInputVolume / 100.0f );
     }
 
 
-    char* pAudioSamples = new char     [ static_cast <size_t> (sampleCount * 2) ];
-    std::memcpy ( pAudioSamples, pAudio, static_cast <size_t> (sampleCount * 2) );
-
-
-    delete[] pAudio;
+    flushLastMessage();
 
-
-    pNetworkService->sendVoiceMessage( pAudioSamples, sampleCount * 2, false );
+    pNetworkService->sendVoiceMessage( reinterpret_cast<char*>(pAudio), sampleCount * 2, false );
 }
 
 void AudioService::sendAudioDataOnTalk(short *pAudio)
 {
     if (iAudioInputVolume != 100)
     {
-        float fInputMult = iAudioInputVolume / 100.0f;
-
-        for (int t = 0;  t < sampleCount;  t++)
-        {
-            int iNewValue = static_cast <int> (pAudio[t] * fInputMult);
-
-            if      (iNewValue > SHRT_MAX)
-            {
-                pAudio[t] = SHRT_MAX;
-            }
-            else if (iNewValue < SHRT_MIN)
-            {
-                pAudio[t] = SHRT_MIN;
-            }
-            else
-            {
-                pAudio[t] = static_cast <short> (iNewValue);
-            }
-        }
+        AudioDSP::applyGain( pAudio, static_cast<size_t>(sampleCount), iAudioInputVolume / 100.0f );
     }
 
-    double maxDBFS = -1000.0;
+    // Decide on the level as it will be heard, silent packets are not encoded and sent.
+    // Muted: keep the detector going (noise floor) but send nothing.
+    bool bTalk = pVoiceDetector->process( pAudio, static_cast<size_t>(sampleCount), fMasterVolumeMult );
 
-    for (int t = 0;  t < sampleCount;  t++)
+    if (bTalk && (bMuteMic == false))
     {
-        int iNewValue = static_cast <int> (pAudio[t] * fMasterVolumeMult);
-
-        if      (iNewValue > SHRT_MAX)
-        {
-            pAudio[t] = SHRT_MAX;
-        }
-        else if (iNewValue < SHRT_MIN)
-        {
-            pAudio[t] = SHRT_MIN;
-        }
-        else
-        {
-            double sampleInRange = static_cast<double>(iNewValue) / SHRT_MAX;
+        bRecordedSome = true;
 
-            double sampleInDBFS = 20 * log10(abs(sampleInRange));
+        flushLastMessage();
 
-            if (sampleInDBFS > maxDBFS)
-            {
-                maxDBFS = sampleInDBFS;
-            }
-        }
+        pNetworkService->sendVoiceMessage( reinterpret_cast<char*>(pAudio), sampleCount * 2, false );
     }
-
-
-    if (iPacketsNeedToRecordLeft == 0)
+    else if (bRecordedSome)
     {
-        iPacketsNeedToRecordLeft = 4;
-    }
+        bRecordedSome = false;
 
-    if ( iPacketsNeedToRecordLeft != 4 )
-    {
-        bRecordTalk = true;
-        bRecordedSome = true;
-        iPacketsNeedToRecordLeft--;
+        sendLastMessageLater();
     }
-    else if ( (static_cast<int>(maxDBFS) >= iLowerVoiceStartRecValueInDBFS) && bMuteMic == false )
-    {
-        bRecordTalk = true;
-        bRecordedSome = true;
-        iPacketsNeedToRecordLeft--;
-    }
-    else
+}
+
+void AudioService::testVolumeLoop()
+{
+    while (true)
     {
-        bRecordTalk = false;
+        const AudioCaptureRingFrame* pFrame = pTestCaptureRing->waitFrame();
 
-        if (bRecordedSome)
+        if (pFrame == nullptr)
         {
-            bRecordedSome = false;
-
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-
-            pNetworkService->sendVoiceMessage(nullptr, 1, true);
+            // Woken up by testRecord() (the capture is finished).
+            break;
         }
-    }
-
-
-    if (bRecordTalk)
-    {
-        char* pAudioSamples = new char     [ static_cast <size_t> (sampleCount * 2) ];
-        std::memcpy ( pAudioSamples, pAudio, static_cast <size_t> (sampleCount * 2) );
 
 
-        delete[] pAudio;
+        sendAudioDataVolume(pFrame->pSamples);
 
 
-        pNetworkService->sendVoiceMessage( pAudioSamples, sampleCount * 2, false );
-    }
-    else
-    {
-        delete[] pAudio;
+        pTestCaptureRing->popFrame();
     }
 }
 
@@ -1333,7 +812,7 @@ void AudioService::sendAudioDataVolume(short *pAudio)
 {
     bool bInDBFS = true; //do not change this thing please
 
-    // Set volume.
+    // Set volume (master and input volume in one pass) and find max volume.
     float fInputMult = fMasterVolumeMult;
 
     if (bInDBFS == false)
@@ -1341,366 +820,145 @@ void AudioService::sendAudioDataVolume(short *pAudio)
         fInputMult += 3.0f;
     }
 
-    for (int t = 0;  t < sampleCount;  t++)
-    {
-        int iNewValue = static_cast <int> (pAudio[t] * fInputMult);
-
-        if      (iNewValue > SHRT_MAX)
-        {
-            pAudio[t] = SHRT_MAX;
-        }
-        else if (iNewValue < SHRT_MIN)
-        {
-            pAudio[t] = SHRT_MIN;
-        }
-        else
-        {
-            pAudio[t] = static_cast <short> (iNewValue);
-        }
-    }
-
     if (iAudioInputVolume != 100)
     {
-        float fInputMult = iAudioInputVolume / 100.0f;
-
-        for (int t = 0;  t < sampleCount;  t++)
-        {
-            int iNewValue = static_cast <int> (pAudio[t] * fInputMult);
-
-            if      (iNewValue > SHRT_MAX)
-            {
-                pAudio[t] = SHRT_MAX;
-            }
-            else if (iNewValue < SHRT_MIN)
-            {
-                pAudio[t] = SHRT_MIN;
-            }
-            else
-            {
-                pAudio[t] = static_cast <short> (iNewValue);
-            }
-        }
+        fInputMult *= iAudioInputVolume / 100.0f;
     }
 
-    // Find max volume.
+    AudioFrameLevel level = AudioDSP::applyGain( pAudio, static_cast<size_t>(sampleCount), fInputMult );
 
-    short maxVolume = 0;
-    double maxDBFS = -1000.0;
-
-    for (int i = 0; i < sampleCount; i++)
-    {
-        if (bInDBFS)
-        {
-            double sampleInRange = static_cast<double>(pAudio[i]) / SHRT_MAX;
-
-            double sampleInDBFS = 20 * log10(abs(sampleInRange));
-
-            if (sampleInDBFS > maxDBFS)
-            {
-                maxDBFS = sampleInDBFS;
-            }
-        }
-        else
-        {
-            if (abs(pAudio[i]) > abs(maxVolume))
-            {
-                maxVolume = static_cast<short>(abs(pAudio[i]));
-            }
-        }
-    }
+    short maxVolume = static_cast<short>( level.iPeak > SHRT_MAX ? SHRT_MAX : level.iPeak );
+    double maxDBFS  = AudioDSP::peakToDBFS(level.iPeak);
 
     if (bInDBFS)
     {
-        pMainWindow->showVoiceVolumeValueInSettings(static_cast<int>(maxDBFS));
+        pEventSink->showVoiceVolumeValueInSettings(static_cast<int>(maxDBFS));
     }
     else
     {
-        pMainWindow->showVoiceVolumeValueInSettings(static_cast<int>(static_cast<float>(maxVolume) / SHRT_MAX * 100));
+        pEventSink->showVoiceVolumeValueInSettings(static_cast<int>(static_cast<float>(maxVolume) / SHRT_MAX * 100));
     }
 
 
     if (pSettingsManager->getCurrentSettings()->bHearVoiceInSettings && bOutputTestVoice)
     {
-        if (iTestPacketsNeedToRecordLeft == 0)
+        // The gain is already applied.
+        if ( pTestVoiceDetector->process( pAudio, static_cast<size_t>(sampleCount) ) )
         {
-            iTestPacketsNeedToRecordLeft = 4;
-        }
+            // 'pAudio' is the frame of the ring, keep a copy for testOutputAudio().
 
-        if ( (static_cast<int>(maxDBFS) >= iLowerVoiceStartRecValueInDBFS)
-             ||
-             (iTestPacketsNeedToRecordLeft != 4) )
-        {
-            mtxAudioPacketsForTest.lock();
+            short int* pPacketCopy = new short int [ static_cast<size_t>(sampleCount) ];
+
+            std::memcpy( pPacketCopy, pAudio, static_cast<size_t>(sampleCount) * sizeof(short int) );
 
-            vAudioPacketsForTest.push_back(pAudio);
+            mtxAudioPacketsForTest.lock();
 
-            iTestPacketsNeedToRecordLeft--;
+            vAudioPacketsForTest.push_back(pPacketCopy);
 
             mtxAudioPacketsForTest.unlock();
         }
-        else
-        {
-            delete[] pAudio;
-        }
-    }
-    else
-    {
-        delete[] pAudio;
     }
 }
 
 void AudioService::testOutputAudio()
 {
-    // Audio buffer1
-    TestWaveOutHdr1.dwBufferLength  = static_cast <unsigned long> (sampleCount * 2);
-    TestWaveOutHdr1.dwBytesRecorded = 0;
-    TestWaveOutHdr1.dwUser          = 0L;
-    TestWaveOutHdr1.dwFlags         = 0L;
-    TestWaveOutHdr1.dwLoops         = 0L;
-
-    // Audio buffer2
-    TestWaveOutHdr2 = TestWaveOutHdr1;
-
-    // Start output device
-    MMRESULT result = waveOutOpen( &hTestWaveOut,  WAVE_MAPPER,  &Format,  0L,  0L,  WAVE_FORMAT_DIRECT );
-
-    if (result)
-    {
-        char fault [256];
-        memset (fault, 0, 256);
-
-        waveInGetErrorTextA (result, fault, 256);
-        pMainWindow->printOutput(std::string("AudioService::testOutputAudio::waveOutOpen() error: " + std::string(fault) + "."),
-                                  SilentMessage(false),
-                                  true);
-    }
-
-    waveOutSetVolume( hTestWaveOut, MAKELONG(pSettingsManager->getCurrentSettings()->iMasterVolume,
-                                             pSettingsManager->getCurrentSettings()->iMasterVolume) );
-
-
-
     bool bWasStarted = false;
     size_t iCurrentAudioPacketIndex = 0;
 
     while (bTestInputReady)
     {
-        while (bPauseTestInput || bOutputTestVoice == false)
+        if (bPauseTestInput || (bOutputTestVoice == false) || (pTestPlaybackStream == nullptr))
         {
             if (bWasStarted)
             {
-                waitForAllTestOutBuffers();
-
-                waveOutReset(hTestWaveOut);
-
-                mtxAudioPacketsForTest.lock();
-
-                for (size_t i = 0; i < vAudioPacketsForTest.size(); i++)
-                {
-                    delete[] vAudioPacketsForTest[i];
-                }
-
-                vAudioPacketsForTest.clear();
+                clearTestOutput();
 
                 iCurrentAudioPacketIndex = 0;
 
-                mtxAudioPacketsForTest.unlock();
-
-                bWasStarted = false;
-
-                waveOutSetVolume( hTestWaveOut, MAKELONG(pSettingsManager->getCurrentSettings()->iMasterVolume,
-                                                         pSettingsManager->getCurrentSettings()->iMasterVolume) );
-            }
-
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-
-            if (bTestInputReady == false) break;
-        }
-
-        if (bTestInputReady == false) break;
-
-
-        while (iCurrentAudioPacketIndex + 3 >= vAudioPacketsForTest.size())
-        {
-            if (vAudioPacketsForTest.size() >= 4)
-            {
-                waitForAllTestOutBuffers();
-
-                waveOutReset(hTestWaveOut);
-
-                mtxAudioPacketsForTest.lock();
-
-                for (size_t i = 0; i < vAudioPacketsForTest.size(); i++)
-                {
-                    delete[] vAudioPacketsForTest[i];
-                }
-
-                vAudioPacketsForTest.clear();
-
-                iCurrentAudioPacketIndex = 0;
-
-                mtxAudioPacketsForTest.unlock();
-
-                waveOutSetVolume( hTestWaveOut, MAKELONG(pSettingsManager->getCurrentSettings()->iMasterVolume,
-                                                         pSettingsManager->getCurrentSettings()->iMasterVolume) );
-            }
-
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        }
-
-        bWasStarted = true;
-
-
-        // Add buffer1
-        TestWaveOutHdr1.lpData = reinterpret_cast<LPSTR>( vAudioPacketsForTest[iCurrentAudioPacketIndex] );
-        if ( addOutBuffer(hTestWaveOut, &TestWaveOutHdr1) ) {break;}
-        iCurrentAudioPacketIndex++;
-
-
-
-        // Add buffer2
-        TestWaveOutHdr2.lpData = reinterpret_cast<LPSTR>( vAudioPacketsForTest[iCurrentAudioPacketIndex] );
-        if ( addOutBuffer(hTestWaveOut, &TestWaveOutHdr2) ) {break;}
-        iCurrentAudioPacketIndex++;
-
-
-        // Play buffer1
-        result = waveOutWrite(hTestWaveOut, &TestWaveOutHdr1, sizeof(WAVEHDR));
-        if (result)
-        {
-            char fault[256];
-            memset(fault, 0, 256);
-
-            waveInGetErrorTextA(result, fault, 256);
-            pMainWindow->printOutput(std::string("AudioService::testOutputAudio::waveOutWrite() error (" + std::to_string(result) + "): " + std::string(fault) + "."),
-                                     SilentMessage(false),
-                                     true);
-
-            waveOutUnprepareHeader(hTestWaveOut, &TestWaveOutHdr1, sizeof(WAVEHDR));
-
-            break;
-        }
-
-
-        // Play buffer2
-        result = waveOutWrite(hTestWaveOut, &TestWaveOutHdr2, sizeof(WAVEHDR));
-        if (result)
-        {
-            char fault[256];
-            memset(fault, 0, 256);
-
-            waveInGetErrorTextA(result, fault, 256);
-            pMainWindow->printOutput(std::string("AudioService::testOutputAudio::waveOutWrite() error (" + std::to_string(result) + "): " + std::string(fault) + "."),
-                                     SilentMessage(false),
-                                     true);
+                bWasStarted = false;
+            }
 
-            waveOutUnprepareHeader(hTestWaveOut, &TestWaveOutHdr2, sizeof(WAVEHDR));
+            std::this_thread::sleep_for(std::chrono::seconds(1));
 
-            break;
+            continue;
         }
 
 
+        // Wait until 4 packets are recorded (so the next ones are recorded while these are playing).
 
-        // Wait until finished playing 1st buffer
-        waitForPlayOnTestToEnd(&TestWaveOutHdr1);
+        mtxAudioPacketsForTest.lock();
 
+        size_t iPacketCount = vAudioPacketsForTest.size();
 
-        bool bWaitForSecondBuffer = true;
-        bool bError = false;
+        mtxAudioPacketsForTest.unlock();
 
-        do
+        if (iCurrentAudioPacketIndex + 3 >= iPacketCount)
         {
-            if (bWaitForSecondBuffer)
-            {
-                // Wait until finished playing 2st buffer
-                while ( (waveOutUnprepareHeader(hTestWaveOut, &TestWaveOutHdr2, sizeof(WAVEHDR)) == WAVERR_STILLPLAYING)
-                        &&
-                        !(iCurrentAudioPacketIndex < vAudioPacketsForTest.size()) )
-                {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(BUFFER_UPDATE_CHECK_MS / 2));
-                }
-            }
-            else
+            if (iPacketCount >= 4)
             {
-                // Wait until finished playing 1st buffer
-                while ( (waveOutUnprepareHeader(hTestWaveOut, &TestWaveOutHdr1, sizeof(WAVEHDR)) == WAVERR_STILLPLAYING)
-                        &&
-                        !(iCurrentAudioPacketIndex < vAudioPacketsForTest.size()) )
-                {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(BUFFER_UPDATE_CHECK_MS / 2));
-                }
-            }
+                // The rest of the previous talk.
 
+                clearTestOutput();
 
-            if ( iCurrentAudioPacketIndex < vAudioPacketsForTest.size() )
-            {
-                if (bWaitForSecondBuffer)
-                {
-                    // Add 1st buffer
-                    TestWaveOutHdr1.lpData = reinterpret_cast<LPSTR>( vAudioPacketsForTest[iCurrentAudioPacketIndex] );
-                    if ( addOutBuffer(hTestWaveOut, &TestWaveOutHdr1) ) {bError = true; break;}
-                    iCurrentAudioPacketIndex++;
-
+                iCurrentAudioPacketIndex = 0;
+            }
 
-                    // Play 1.
-                    result = waveOutWrite(hTestWaveOut, &TestWaveOutHdr1, sizeof(WAVEHDR));
-                    if (result)
-                    {
-                        char fault[256];
-                        memset(fault, 0, 256);
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-                        waveInGetErrorTextA(result, fault, 256);
-                        pMainWindow->printOutput(std::string("AudioService::testOutputAudio::waveOutWrite() error (" + std::to_string(result) + "): " + std::string(fault) + "."),
-                                                 SilentMessage(false),
-                                                 true);
+            continue;
+        }
 
-                        waveOutUnprepareHeader(hTestWaveOut, &TestWaveOutHdr1, sizeof(WAVEHDR));
+        bWasStarted = true;
 
-                        bError = true;
 
-                        break;
-                    }
 
+        // Play while new packets keep coming.
 
-                    // Wait until finished playing 2st buffer
-                    waitForPlayOnTestToEnd(&TestWaveOutHdr2);
-                }
-                else
-                {
-                    // Add 2st buffer
-                    TestWaveOutHdr2.lpData = reinterpret_cast<LPSTR>( vAudioPacketsForTest[iCurrentAudioPacketIndex] );
-                    if ( addOutBuffer(hTestWaveOut, &TestWaveOutHdr2) ) {bError = true; break;}
-                    iCurrentAudioPacketIndex++;
+        bool bError = false;
 
+        while (bTestInputReady && (bPauseTestInput == false) && bOutputTestVoice)
+        {
+            short int* pPacket = nullptr;
 
-                    // Play 2.
-                    result = waveOutWrite(hTestWaveOut, &TestWaveOutHdr2, sizeof(WAVEHDR));
-                    if (result)
-                    {
-                        char fault[256];
-                        memset(fault, 0, 256);
+            mtxAudioPacketsForTest.lock();
 
-                        waveInGetErrorTextA(result, fault, 256);
-                        pMainWindow->printOutput(std::string("AudioService::testOutputAudio::waveOutWrite() error (" + std::to_string(result) + "): " + std::string(fault) + "."),
-                                                 SilentMessage(false),
-                                                 true);
+            if (iCurrentAudioPacketIndex < vAudioPacketsForTest.size())
+            {
+                pPacket = vAudioPacketsForTest[iCurrentAudioPacketIndex];
+            }
 
-                        waveOutUnprepareHeader(hTestWaveOut, &TestWaveOutHdr2, sizeof(WAVEHDR));
+            mtxAudioPacketsForTest.unlock();
 
-                        bError = true;
 
-                        break;
-                    }
+            size_t iFreeFrameCount = pTestPlaybackStream->getFreeFrameCount();
 
+            if (pPacket == nullptr)
+            {
+                if (iFreeFrameCount == AUDIO_TEST_OUT_BUFFER_COUNT)
+                {
+                    // Everything is played.
+                    break;
+                }
+            }
+            else if (iFreeFrameCount != 0)
+            {
+                if ( pTestPlaybackStream->write(pPacket) )
+                {
+                    pEventSink->printOutput(std::string("AudioService::testOutputAudio::write() error: " + pTestPlaybackStream->getLastError()),
+                                            SilentMessage(false),
+                                            true);
 
-                    // Wait until finished playing 1st buffer
-                    waitForPlayOnTestToEnd(&TestWaveOutHdr1);
+                    bError = true;
+                    break;
                 }
 
-                bWaitForSecondBuffer = !bWaitForSecondBuffer;
+                iCurrentAudioPacketIndex++;
+
+                continue;
             }
 
-        }while ( iCurrentAudioPacketIndex < vAudioPacketsForTest.size() );
+            std::this_thread::sleep_for(std::chrono::milliseconds(BUFFER_UPDATE_CHECK_MS / 2));
+        }
 
         if (bError)
         {
@@ -1708,7 +966,21 @@ void AudioService::testOutputAudio()
         }
     }
 
-    waitForAllTestOutBuffers();
+    clearTestOutput();
+
+
+    promiseFinishTestOutputAudio.set_value(false);
+}
+
+void AudioService::clearTestOutput()
+{
+    if (pTestPlaybackStream)
+    {
+        pTestPlaybackStream->reset();
+
+        pTestPlaybackStream->setVolume( pSettingsManager->getCurrentSettings()->iMasterVolume );
+    }
+
 
     mtxAudioPacketsForTest.lock();
 
@@ -1720,465 +992,377 @@ void AudioService::testOutputAudio()
     vAudioPacketsForTest.clear();
 
     mtxAudioPacketsForTest.unlock();
-
-
-    promiseFinishTestOutputAudio.set_value(false);
 }
 
-void AudioService::playAudioData(short int *pAudio, std::string sUserName, bool bLast)
+void AudioService::playAudioData(short int *pAudio, int iSpeakerId, int iSpeakerSequence, const std::string& sUserName, bool bLast)
 {
+    // We hold this mutex until the packet is in the user's queue
+    // so the user can't be deleted (and 'bInputReady' can't change) meanwhile.
+    pNetworkService->getOtherUsersMutex()->lock();
+
+
     if (bInputReady == false)
     {
-        delete[] pAudio;
+        pNetworkService->getOtherUsersMutex()->unlock();
+
+        if (pAudio)
+        {
+            delete[] pAudio;
+        }
+
         return;
     }
 
-    pNetworkService->getOtherUsersMutex()->lock();
 
     User* pUser = nullptr;
 
-    for (size_t i = 0;   i < pNetworkService->getOtherUsersVectorSize();   i++)
+    if (iSpeakerId >= 0)
     {
-        if (pNetworkService->getOtherUser(i)->sUserName == sUserName)
-        {
-            pUser = pNetworkService->getOtherUser(i);
-        }
+        pUser = pNetworkService->findOtherUserBySpeakerId( static_cast<unsigned short>(iSpeakerId) );
+    }
+    else
+    {
+        pUser = pNetworkService->findOtherUser(sUserName);
     }
-
-    pNetworkService->getOtherUsersMutex()->unlock();
 
     if (pUser == nullptr)
     {
-        delete[] pAudio;
+        pNetworkService->getOtherUsersMutex()->unlock();
+
+        if (pAudio)
+        {
+            delete[] pAudio;
+        }
 
         return;
     }
 
 
 
-    if (bLast)
-    {
-        if (pUser->bDeletePacketsAtLast)
-        {
-            // Something went wrong, delete all packets
+    // Pass the packet to the playbackLoop().
+    // (the volume will be applied in the mix)
 
-            for (size_t j = 0;  j < pUser->vAudioPackets.size();  j++)
-            {
-                if (pUser->vAudioPackets[j])
-                {
-                    delete[] pUser->vAudioPackets[j];
-                }
-            }
+    unsigned int iSequence = pUser->iNextVoicePacketSequence;
 
-            pUser->vAudioPackets.clear();
+    if (iSpeakerSequence >= 0)
+    {
+        // The sequence of the server: 16 bits, extended around the next expected packet
+        // (so the jitter buffer sees the lost, reordered and late packets across the wrap).
 
-            pUser->bDeletePacketsAtLast = false;
-            pUser->bPacketsArePlaying   = false;
+        iSequence = JitterBuffer::extendSequence( static_cast<unsigned short>(iSpeakerSequence), pUser->iNextVoicePacketSequence );
 
-            // Wait until finished playing
-            waitForAllBuffers (pUser, false, nullptr);
+        if ( (bLast == false) && (static_cast<int>(iSequence - pUser->iNextVoicePacketSequence) >= 0) )
+        {
+            pUser->iNextVoicePacketSequence = iSequence + 1;
         }
-
-        pUser->bLastPacketCame = true;
     }
-    else
+    else if (bLast == false)
+    {
+        pUser->iNextVoicePacketSequence++;
+    }
+
+    if ( pUser->voicePackets.push(pAudio, bLast, iSequence, iSpeakerSequence >= 0) == false )
     {
-        // Set volume multiplier
-        float fVolumeMult  = fMasterVolumeMult;
+        // The queue is full (the playback can't keep up with this user), drop the packet.
 
-        if (pUser->fUserDefinedVolume != 1.0f)
+        if (pAudio)
         {
-            fVolumeMult += ( pUser->fUserDefinedVolume - 1.0f );
+            delete[] pAudio;
         }
+    }
+    else
+    {
+        // The playback thread may be waiting with nothing to play.
+        pPlaybackStream->wakeUp();
+    }
 
 
-        // Set volume
-        for (int t = 0;  t < sampleCount;  t++)
-        {
-            int iNewValue = static_cast <int> (pAudio[t] * fVolumeMult);
-
-            if      (iNewValue > SHRT_MAX)
-            {
-                pAudio[t] = SHRT_MAX;
-            }
-            else if (iNewValue < SHRT_MIN)
-            {
-                pAudio[t] = SHRT_MIN;
-            }
-            else
-            {
-                pAudio[t] = static_cast <short> (iNewValue);
-            }
-        }
+    pNetworkService->getOtherUsersMutex()->unlock();
+}
 
+bool AudioService::startOutput()
+{
+    // One output device for all users.
 
+    std::string sError;
 
+    pPlaybackStream = pAudioBackend->openPlayback( streamFormat, AUDIO_OUT_BUFFER_COUNT, sError );
 
-        pUser->vAudioPackets.push_back(pAudio);
+    if (pPlaybackStream == nullptr)
+    {
+        pEventSink->printOutput(std::string("AudioService::startOutput::openPlayback() error: " + sError),
+                                 SilentMessage(false),
+                                 true);
 
+        return false;
+    }
 
+    pPlaybackStream->setVolume( pSettingsManager->getCurrentSettings()->iMasterVolume );
 
-        if ( (pUser->vAudioPackets.size() > 1)
-             &&
-             (pUser->bPacketsArePlaying == false) )
-        {
-            pUser->bPacketsArePlaying = true;
 
-            std::thread playThread (&AudioService::play, this, pUser);
-            playThread.detach();
-        }
-        else if (pUser->vAudioPackets.size() == 1)
-        {
-            pUser->bLastPacketCame = false;
-        }
-    }
-}
+    pMixFrame   = new short int [ static_cast<size_t>(sampleCount) ];
 
-void AudioService::play(User* pUser)
-{
-    pUser->mtxUser.lock();
+    pAudioMixer = new AudioMixer( static_cast<size_t>(sampleCount) );
 
+    vPlaybackFrames.reserve(AUDIO_OUT_BUFFER_COUNT * 16);
 
-    MMRESULT result;
 
-    size_t i = 0;
-    size_t iLastPlayingPacketIndex = 0;
+    return true;
+}
 
+void AudioService::stopOutput()
+{
+    if (pAudioMixer == nullptr)
+    {
+        return;
+    }
 
-    // Wait a little so when we finished playing the first buffer
-    // we will almost 100% have a new audio packet came.
-    std::this_thread::sleep_for(std::chrono::milliseconds(30));
 
+    delete pPlaybackStream;
+    pPlaybackStream = nullptr;
 
-    pUser      ->bTalking = true;
-    pMainWindow->setPingAndTalkingToUser(pUser->pListWidgetItem, pUser->iPing, pUser->bTalking);
+    delete[] pMixFrame;
+    pMixFrame = nullptr;
 
 
+    delete pAudioMixer;
+    pAudioMixer = nullptr;
+}
 
-    // Add buffer1
-    pUser->WaveOutHdr1.lpData = reinterpret_cast<LPSTR>( pUser->vAudioPackets[i] );
-    if ( addOutBuffer(pUser->hWaveOut, &pUser->WaveOutHdr1) ) {pUser->bDeletePacketsAtLast = true;}
-    i++;
+void AudioService::playbackLoop()
+{
+    // One thread plays the audio of all users.
+    // It sleeps until the output device finishes a frame or a new voice packet comes (see playAudioData()).
 
+    while (bInputReady)
+    {
+        size_t iFreeFrameCount = pPlaybackStream->getFreeFrameCount();
 
 
-    // Add buffer2
-    pUser->WaveOutHdr2.lpData = reinterpret_cast<LPSTR>( pUser->vAudioPackets[i] );
-    if ( addOutBuffer(pUser->hWaveOut, &pUser->WaveOutHdr2) ) {pUser->bDeletePacketsAtLast = true;}
-    i++;
+        // Only the jitter buffers are touched under the mutex, the mix and the output device are not
+        // (so the UDP thread is never waiting for them).
 
+        pNetworkService->getOtherUsersMutex()->lock();
 
-    // Play buffer1
-    result = waveOutWrite(pUser->hWaveOut, &pUser->WaveOutHdr1, sizeof(WAVEHDR));
-    if (result)
-    {
-        char fault[256];
-        memset(fault, 0, 256);
 
-        waveInGetErrorTextA(result, fault, 256);
-        pMainWindow->printOutput(std::string("AudioService::play::waveOutWrite() error (" + std::to_string(result) + "): " + std::string(fault) + "."),
-                                 SilentMessage(false),
-                                 true);
+        for (size_t i = 0;   i < pNetworkService->getOtherUsersVectorSize();   i++)
+        {
+            updateUserPlayback( pNetworkService->getOtherUser(i) );
+        }
 
-        waveOutUnprepareHeader(pUser->hWaveOut, &pUser->WaveOutHdr1, sizeof(WAVEHDR));
+        // Keep all output buffers busy.
+        size_t iFrameCount = takeFramesToPlay(iFreeFrameCount);
 
-        pUser->bDeletePacketsAtLast = true;
-    }
 
+        pNetworkService->getOtherUsersMutex()->unlock();
 
-    // Play buffer2
-    result = waveOutWrite(pUser->hWaveOut, &pUser->WaveOutHdr2, sizeof(WAVEHDR));
-    if (result)
-    {
-        char fault[256];
-        memset(fault, 0, 256);
 
-        waveInGetErrorTextA(result, fault, 256);
-        pMainWindow->printOutput(std::string("AudioService::play::waveOutWrite() error (" + std::to_string(result) + "): " + std::string(fault) + "."),
-                                 SilentMessage(false),
-                                 true);
+        playFrames(iFrameCount, iFreeFrameCount);
 
-        waveOutUnprepareHeader(pUser->hWaveOut, &pUser->WaveOutHdr2, sizeof(WAVEHDR));
 
-        pUser->bDeletePacketsAtLast = true;
+        pPlaybackStream->waitForFreeFrame();
     }
+}
+
+void AudioService::updateUserPlayback(User *pUser)
+{
+    // Move new packets to the jitter buffer.
 
+    VoicePacket packet;
 
+    while ( pUser->voicePackets.pop(packet) )
+    {
+        pUser->pJitterBuffer->insert(packet);
+    }
 
-    // Wait until finished playing 1st buffer
-    waitForPlayToEnd(pUser, &pUser->WaveOutHdr1, iLastPlayingPacketIndex);
 
+    if ( (pUser->pJitterBuffer->isPlaying() == false) && pUser->pJitterBuffer->isReadyToPlay() )
+    {
+        pUser->pJitterBuffer->startPlayout();
+    }
 
-    bool bWaitForSecondBuffer = true;
 
+    updateUserTalking(pUser);
+}
 
-    do
+void AudioService::updateUserTalking(User *pUser)
+{
+    if ( pUser->bPacketsArePlaying == pUser->pJitterBuffer->isPlaying() )
     {
-        if (bWaitForSecondBuffer)
-        {
-            // Wait until finished playing 2st buffer
-            while ( (waveOutUnprepareHeader(pUser->hWaveOut, &pUser->WaveOutHdr2, sizeof(WAVEHDR)) == WAVERR_STILLPLAYING)
-                    &&
-                    !(i < pUser->vAudioPackets.size()) )
-            {
-                std::this_thread::sleep_for(std::chrono::milliseconds(BUFFER_UPDATE_CHECK_MS / 2));
-            }
-        }
-        else
-        {
-            // Wait until finished playing 1st buffer
-            while ( (waveOutUnprepareHeader(pUser->hWaveOut, &pUser->WaveOutHdr1, sizeof(WAVEHDR)) == WAVERR_STILLPLAYING)
-                    &&
-                    !(i < pUser->vAudioPackets.size()) )
-            {
-                std::this_thread::sleep_for(std::chrono::milliseconds(BUFFER_UPDATE_CHECK_MS / 2));
-            }
-        }
+        return;
+    }
 
 
-        if ( i < pUser->vAudioPackets.size() )
-        {
-            if (bWaitForSecondBuffer)
-            {
-                // Add 1st buffer
-                pUser->WaveOutHdr1.lpData = reinterpret_cast<LPSTR>( pUser->vAudioPackets[i] );
-                if ( addOutBuffer(pUser->hWaveOut, &pUser->WaveOutHdr1) ) {pUser->bDeletePacketsAtLast = true;}
-                i++;
+    pUser->bPacketsArePlaying = pUser->pJitterBuffer->isPlaying();
 
+    pUser      ->bTalking = pUser->bPacketsArePlaying;
+    pEventSink->setPingAndTalkingToUser(pUser->pListWidgetItem, pUser->iPing, pUser->bTalking);
+}
 
-                // Play 1.
-                result = waveOutWrite(pUser->hWaveOut, &pUser->WaveOutHdr1, sizeof(WAVEHDR));
-                if (result)
-                {
-                    char fault[256];
-                    memset(fault, 0, 256);
+size_t AudioService::takeFramesToPlay(size_t iMaxFrameCount)
+{
+    vPlaybackFrames.clear();
 
-                    waveInGetErrorTextA(result, fault, 256);
-                    pMainWindow->printOutput(std::string("AudioService::uncompressAndPlay::waveOutWrite() error (" + std::to_string(result) + "): " + std::string(fault) + "."),
-                                             SilentMessage(false),
-                                             true);
 
-                    waveOutUnprepareHeader(pUser->hWaveOut, &pUser->WaveOutHdr1, sizeof(WAVEHDR));
+    size_t iFrameCount = 0;
 
-                    pUser->bDeletePacketsAtLast = true;
+    for ( ;  iFrameCount < iMaxFrameCount;  iFrameCount++)
+    {
+        size_t iTakenBefore = vPlaybackFrames.size();
 
-                    break;
-                }
 
+        for (size_t i = 0;   i < pNetworkService->getOtherUsersVectorSize();   i++)
+        {
+            User* pUser = pNetworkService->getOtherUser(i);
 
-                // Wait until finished playing 2st buffer
-                waitForPlayToEnd(pUser, &pUser->WaveOutHdr2, iLastPlayingPacketIndex);
-            }
-            else
+            if (pUser->pJitterBuffer->isPlaying() == false)
             {
-                // Add 2st buffer
-                pUser->WaveOutHdr2.lpData = reinterpret_cast<LPSTR>( pUser->vAudioPackets[i] );
-                if ( addOutBuffer(pUser->hWaveOut, &pUser->WaveOutHdr2) ) {pUser->bDeletePacketsAtLast = true;}
-                i++;
-
+                continue;
+            }
 
-                // Play 2.
-                result = waveOutWrite(pUser->hWaveOut, &pUser->WaveOutHdr2, sizeof(WAVEHDR));
-                if (result)
-                {
-                    char fault[256];
-                    memset(fault, 0, 256);
 
-                    waveInGetErrorTextA(result, fault, 256);
-                    pMainWindow->printOutput(std::string("AudioService::uncompressAndPlay::waveOutWrite() error (" + std::to_string(result) + "): " + std::string(fault) + "."),
-                                             SilentMessage(false),
-                                             true);
+            AudioPlaybackFrame frame;
 
-                    waveOutUnprepareHeader(pUser->hWaveOut, &pUser->WaveOutHdr2, sizeof(WAVEHDR));
+            frame.pFrame = pUser->pJitterBuffer->getNextFrame(&frame.arrivalTime);
 
-                    pUser->bDeletePacketsAtLast = true;
+            if (frame.pFrame)
+            {
+                // Set volume multiplier
+                frame.fVolumeMult = fMasterVolumeMult;
 
-                    break;
+                if (pUser->fUserDefinedVolume != 1.0f)
+                {
+                    frame.fVolumeMult += ( pUser->fUserDefinedVolume - 1.0f );
                 }
 
+                frame.iMixIndex = iFrameCount;
 
-                // Wait until finished playing 1st buffer
-                waitForPlayToEnd(pUser, &pUser->WaveOutHdr1, iLastPlayingPacketIndex);
+                vPlaybackFrames.push_back(frame);
             }
 
 
-            bWaitForSecondBuffer = !bWaitForSecondBuffer;
+            updateUserTalking(pUser);
         }
-        else
-        {
-            delete[] pUser->vAudioPackets[iLastPlayingPacketIndex];
-            pUser->vAudioPackets[iLastPlayingPacketIndex] = nullptr;
 
-            iLastPlayingPacketIndex++;
 
+        if (vPlaybackFrames.size() == iTakenBefore)
+        {
+            // Nobody is talking.
             break;
         }
+    }
 
-    }while ( bInputReady );
-
-
-    if (bInputReady)
-    {
-        // Wait until finished playing
-        waitForAllBuffers (pUser, true, &iLastPlayingPacketIndex);
 
+    return iFrameCount;
+}
 
-        pUser      ->bTalking = false;
-        pMainWindow->setPingAndTalkingToUser(pUser->pListWidgetItem, pUser->iPing, pUser->bTalking);
+void AudioService::playFrames(size_t iFrameCount, size_t iFreeFrameCount)
+{
+    size_t iNextTaken   = 0;
+    bool   bWriteFailed = false;
 
+    for (size_t i = 0;  i < iFrameCount;  i++)
+    {
+        pAudioMixer->beginFrame();
 
-        if (pUser->bDeletePacketsAtLast == false)
+        for ( ;  (iNextTaken < vPlaybackFrames.size()) && (vPlaybackFrames[iNextTaken].iMixIndex == i);  iNextTaken++)
         {
-            // No errors, delete here.
+            const AudioPlaybackFrame& frame = vPlaybackFrames[iNextTaken];
 
-            for (size_t i = 0;  i < pUser->vAudioPackets.size();  i++)
+            if (frame.arrivalTime != VoiceClock::time_point())
             {
-                if (pUser->vAudioPackets[i])
-                {
-                    delete[] pUser->vAudioPackets[i];
-                }
+                // Not concealed.
+                pVoicePathStats->recordSince(VPS_JITTER_BUFFER, frame.arrivalTime);
             }
 
-            pUser->vAudioPackets.clear ();
-            pUser->bPacketsArePlaying = false;
+            pAudioMixer->addFrame(frame.pFrame, frame.fVolumeMult);
+
+            delete[] frame.pFrame;
         }
-        else if (pUser->bLastPacketCame)
-        {
-            // An error occured but last packet already came-> delete here and not in playAudioData().
 
-            for (size_t i = 0;  i < pUser->vAudioPackets.size();  i++)
-            {
-                if (pUser->vAudioPackets[i])
-                {
-                    delete[] pUser->vAudioPackets[i];
-                }
-            }
+        pAudioMixer->finishFrame(pMixFrame);
 
-            pUser->vAudioPackets.clear ();
-            pUser->bPacketsArePlaying   = false;
-            pUser->bDeletePacketsAtLast = false;
-        }
-    }
-    else
-    {
-        for (size_t i = 0;  i < pUser->vAudioPackets.size();  i++)
+
+        if (bWriteFailed)
         {
-            if (pUser->vAudioPackets[i])
-            {
-                delete[] pUser->vAudioPackets[i];
-            }
+            // Only free the rest of the frames.
+            continue;
         }
 
-        pUser->vAudioPackets.clear ();
-        pUser->bPacketsArePlaying   = false;
-        pUser->bDeletePacketsAtLast = false;
-    }
-
-
 
-    pUser->mtxUser.unlock();
-}
+        // The busy buffers play before this one.
+        size_t iQueuedFrames = AUDIO_OUT_BUFFER_COUNT - iFreeFrameCount + i;
 
-void AudioService::waitForAllBuffers(User* pUser, bool bClearPackets, size_t* iLastPlayingPacketIndex)
-{
-    // Wait until finished playing 1
-    while ( waveOutUnprepareHeader(pUser->hWaveOut, &pUser->WaveOutHdr1, sizeof(WAVEHDR)) == WAVERR_STILLPLAYING )
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds(BUFFER_UPDATE_CHECK_MS));
-    }
+        pVoicePathStats->record( VPS_OUTPUT_QUEUE, iQueuedFrames * static_cast<unsigned long long>(sampleCount) * 1000000 / sampleRate );
 
-    // Wait until finished playing 2
-    while ( waveOutUnprepareHeader(pUser->hWaveOut, &pUser->WaveOutHdr2, sizeof(WAVEHDR)) == WAVERR_STILLPLAYING )
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds(BUFFER_UPDATE_CHECK_MS));
-    }
 
-    if (bClearPackets)
-    {
-        for (size_t i = *iLastPlayingPacketIndex;   i < pUser->vAudioPackets.size();   i++)
+        if ( pPlaybackStream->write(pMixFrame) )
         {
-            delete[] pUser->vAudioPackets[i];
-            pUser->vAudioPackets[i] = nullptr;
+            pEventSink->printOutput(std::string("AudioService::playbackLoop::write() error: " + pPlaybackStream->getLastError()),
+                                    SilentMessage(false),
+                                    true);
+
+            bWriteFailed = true;
         }
     }
+
+
+    vPlaybackFrames.clear();
 }
 
-int AudioService::getInputDeviceID(std::wstring sDeviceName)
+void AudioService::stop()
 {
-    UINT iInDeviceCount = waveInGetNumDevs();
-
-    for (UINT i = 0; i < iInDeviceCount; i++)
+    if (bInputReady)
     {
-        WAVEINCAPS deviceInfo;
+        bInputReady = false;
 
-        MMRESULT result = waveInGetDevCaps(i, &deviceInfo, sizeof(deviceInfo));
-        if (result)
+        // Wait for record to stop (it captures the frames that are already recorded).
+        if (recordThread.joinable())
         {
-            char fault [256];
-            memset (fault, 0, 256);
-
-            waveInGetErrorTextA (result, fault, 256);
-            pMainWindow->printOutput (std::string("AudioService::getInputDevices::waveInGetDevCaps() error: " + std::string(fault) + "."),
-                                       SilentMessage(false),
-                                       true);
-           continue;
+            recordThread.join();
         }
-        else
+
+        // The encoder sends what is left in the ring and ends.
+        pCaptureRing->wakeUp();
+
+        if (encoderThread.joinable())
         {
-            if (sDeviceName == std::wstring(deviceInfo.szPname))
-            {
-                return static_cast<int>(i);
-            }
+            encoderThread.join();
         }
-    }
 
-    return -1;
-}
+        flushLastMessage();
 
-void AudioService::stop()
-{
-    if (bInputReady)
-    {
-        bInputReady = false;
 
-        // Wait for record to stop.
-        std::this_thread::sleep_for( std::chrono::milliseconds(INTERVAL_AUDIO_RECORD_MS * 2) );
+        delete pCaptureStream;
+        pCaptureStream = nullptr;
 
-        waitForAllInBuffers();
+        delete pCaptureRing;
+        pCaptureRing = nullptr;
 
-        waveInClose(hWaveIn);
+        delete[] pOverrunFrame;
+        pOverrunFrame = nullptr;
     }
 
 
-    if (pWaveIn1 != nullptr)
+    // Wait for playbackLoop() to end.
+    if (playbackThread.joinable())
     {
-        delete[] pWaveIn1;
-        pWaveIn1 = nullptr;
-    }
-
-    if (pWaveIn2 != nullptr)
-    {
-        delete[] pWaveIn2;
-        pWaveIn2 = nullptr;
-    }
+        pPlaybackStream->wakeUp();
 
-    if (pWaveIn3 != nullptr)
-    {
-        delete[] pWaveIn3;
-        pWaveIn3 = nullptr;
+        playbackThread.join();
     }
 
-    if (pWaveIn4 != nullptr)
-    {
-        delete[] pWaveIn4;
-        pWaveIn4 = nullptr;
-    }
 
+    pNetworkService->getOtherUsersMutex()->lock();
 
     for (size_t i = 0;   i < pNetworkService->getOtherUsersVectorSize();   i++)
     {
         deleteUserAudio( pNetworkService->getOtherUser(i) );
     }
+
+    stopOutput();
+
+    pNetworkService->getOtherUsersMutex()->unlock();
 }
 
 void AudioService::setInputAudioVolume(int iVolume)
@@ -2188,7 +1372,14 @@ void AudioService::setInputAudioVolume(int iVolume)
 
 void AudioService::setVoiceStartValue(int iValue)
 {
-    iLowerVoiceStartRecValueInDBFS = iValue;
+    pVoiceDetector->setStartLevel(iValue);
+    pTestVoiceDetector->setStartLevel(iValue);
+}
+
+void AudioService::setVoiceNoiseGating(bool bEnable)
+{
+    pVoiceDetector->setNoiseGating(bEnable);
+    pTestVoiceDetector->setNoiseGating(bEnable);
 }
 
 void AudioService::setShouldHearTestVoice(bool bHear)
@@ -2213,45 +1404,34 @@ AudioService::~AudioService()
 
         f1.get(); // wait for testRecord() to finish.
         f2.get(); // wait for testOutputAudio() to finish.
-
-
-        waitForAllTestInBuffers();
-
-        waveInStop(hTestWaveIn);
-
-        waveOutReset(hTestWaveOut);
     }
 
     bTestInputReady = false;
     bPauseTestInput = false;
 
-    if (pTestWaveIn1 != nullptr)
-    {
-        delete[] pTestWaveIn1;
-        pTestWaveIn1 = nullptr;
-    }
 
-    if (pTestWaveIn2 != nullptr)
+    if (pTestCaptureStream)
     {
-        delete[] pTestWaveIn2;
-        pTestWaveIn2 = nullptr;
-    }
+        delete pTestCaptureStream;
 
-    if (pTestWaveIn3 != nullptr)
-    {
-        delete[] pTestWaveIn3;
-        pTestWaveIn3 = nullptr;
+        delete   pTestCaptureRing;
+        delete[] pTestOverrunFrame;
     }
 
-    if (pTestWaveIn4 != nullptr)
+    if (pTestPlaybackStream)
     {
-        delete[] pTestWaveIn4;
-        pTestWaveIn4 = nullptr;
+        delete pTestPlaybackStream;
     }
 
-    waitForAllTestInBuffers();
 
-    waveInClose(hTestWaveIn);
+    // Stop the deferred actions first (they use the other members).
+    delete   pAudioTimer;
 
-    waveOutClose(hTestWaveOut);
+    delete[] pPacket;
+    delete   pVoicePathStats;
+    delete   pVoiceDetector;
+    delete   pTestVoiceDetector;
+
+    delete pAudioBackend;
 }
+
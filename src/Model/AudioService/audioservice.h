@@ -11,30 +11,45 @@
 #include <vector>
 #include <mutex>
 #include <future>
+#include <thread>
+#include <chrono>
+#include <atomic>
 
-// Other
-#define _WINSOCKAPI_    // stops windows.h from including winsock.h
-#include <Windows.h>
-#include "Mmsystem.h"
+// Custom
+#include "Model/AudioBackend/audiobackend.h"
 
 
-// for mmsystem
-#pragma comment(lib,"Winmm.lib")
-// for GetAsyncKeyState
-#pragma comment(lib, "user32.lib")
 
-
-
-class MainWindow;
+class ModelEventSink;
 class NetworkService;
 class SettingsManager;
 
 class User;
+class AudioMixer;
+class AudioCaptureRing;
+class VoicePathStats;
+class VoiceActivityDetector;
+class AudioTimer;
+struct AudioCaptureRingFrame;
 
 
 
+// The "hear my voice" test in the settings checks its output buffers this often.
 #define  BUFFER_UPDATE_CHECK_MS      2
 
+// Default size of the frames read from the input device (see setCapturePeriod()).
+#define  AUDIO_CAPTURE_PERIOD_MS     35
+#define  AUDIO_CAPTURE_MIN_PERIOD_MS 5
+
+// The end of talk message is sent this long after the last voice packet.
+#define  AUDIO_LAST_MESSAGE_DELAY_MS 10
+
+// Output buffers queued to the (single) output device.
+#define  AUDIO_OUT_BUFFER_COUNT      2
+
+// Output buffers of the "hear my voice" test in the settings.
+#define  AUDIO_TEST_OUT_BUFFER_COUNT 2
+
 #define  AUDIO_CONNECT_PATH          L"sounds/connect.wav"
 #define  AUDIO_DISCONNECT_PATH       L"sounds/disconnect.wav"
 #define  AUDIO_LOST_CONNECTION_PATH  L"sounds/lostconnection.wav"
@@ -47,6 +62,21 @@ class User;
 
 
 
+// Frame of one user taken from its jitter buffer (under the users mutex) to be mixed (without it).
+struct AudioPlaybackFrame
+{
+    short int*             pFrame;
+    float                  fVolumeMult;
+
+    // Output frame (of the ones taken at once) it's mixed into.
+    size_t                 iMixIndex;
+
+    // Empty if the frame is concealed.
+    std::chrono::steady_clock::time_point arrivalTime;
+};
+
+
+
 // ------------------------------------------------------------------------------------------------
 // ------------------------------------------------------------------------------------------------
 // ------------------------------------------------------------------------------------------------
@@ -57,14 +87,14 @@ class AudioService
 
 public:
 
-    AudioService(MainWindow* pMainWindow, SettingsManager* pSettingsManager);
+    // Takes the ownership of 'pAudioBackend', nullptr - WinMMAudioBackend.
+    AudioService(ModelEventSink* pEventSink, SettingsManager* pSettingsManager, AudioBackend* pAudioBackend = nullptr);
 
 
 
 
     // Start
 
-        void   prepareForStart               ();
         bool   start                         ();
         void   startTestWaveOut              ();
 
@@ -87,8 +117,11 @@ public:
     // Audio data record/play
 
         void   setTestRecordingPause         (bool bPause);
-        void   playAudioData                 (short int* pAudio,  std::string sUserName,  bool bLast);
-        void   play                          (User* pUser);
+
+        // The user is found by 'iSpeakerId' (UDP_SM_VOICE_BY_ID packets) or by 'sUserName' if 'iSpeakerId' is -1.
+        // 'iSpeakerSequence' - the 16-bit packet number of the speaker (UDP_SM_VOICE_BY_ID packets) or -1,
+        // without it the packets are numbered as they come.
+        void   playAudioData                 (short int* pAudio,  int iSpeakerId,  int iSpeakerSequence,  const std::string& sUserName,  bool bLast);
 
 
     // Stop
@@ -96,10 +129,21 @@ public:
         void   stop                          ();
 
 
+    // Stats
+
+        // Appends the voice path latency and the jitter buffer stats to VOICE_PATH_STATS_FILE_NAME
+        // in the Documents folder and prints them.
+        void   saveVoicePathStats            ();
+
+        // One line per user: depth, target depth, jitter, late, lost, concealed and dropped frames of the jitter buffer.
+        std::string formatJitterBufferStats  ();
+
+
     // SET functions
 
         void   setInputAudioVolume           (int iVolume);
         void   setVoiceStartValue            (int iValue);
+        void   setVoiceNoiseGating           (bool bEnable);
         void   setShouldHearTestVoice        (bool bHear);
         void   setNewUserVolume              (std::string sUserName,  float fVolume);
         void   setNewMasterVolume            (unsigned short int iVolume);
@@ -107,6 +151,11 @@ public:
         void   setMuteMic                    (bool bMute);
         bool   getMuteMic                    ();
 
+        // Size of the frames read from the input device (e.g. 10, 20 or 35 ms), used on the next start().
+        // The frames are joined into the voice packets of 'sampleCount' samples anyway,
+        // smaller frames are delivered (and checked for the voice) sooner.
+        void   setCapturePeriod              (unsigned int iPeriodMS);
+
 
     // GET functions
 
@@ -114,6 +163,9 @@ public:
         std::vector<std::wstring> getInputDevices();
         int    getAudioPacketSizeInSamples   () const;
 
+        // Latency of the voice path stages (reset on start()).
+        VoicePathStats* getVoicePathStats    ();
+
 
 
 
@@ -131,69 +183,108 @@ private:
 
     // Used in recordOnPress()/recordOnTalk()/testRecord()
 
-        bool  addInBuffer              (LPWAVEHDR buffer, bool bTestDevice = false);
-        bool  addOutBuffer             (HWAVEOUT  hWaveOut, LPWAVEHDR buffer);
-        void  waitAndSendBuffer        (WAVEHDR* WaveInHdr, short int* pWaveIn, bool bOnTalk = false);
-        void  waitAndShowBufferVolume  (WAVEHDR* WaveInHdr, short int* pWaveIn);
-        void  waitForAllInBuffers      ();
-        void  waitForAllTestInBuffers  ();
-        void  waitForAllTestOutBuffers ();
+        // Reads the next frame of 'pStream' into 'pRing' ('pOverrunBuffer' if the ring is full).
+        // Returns true if the capture stream has nothing more to read.
+        bool  captureFrame             (AudioCaptureStream* pStream, AudioCaptureRing* pRing, short int* pOverrunBuffer);
+
+
+    // Encoder thread (sends what recordOnPush()/recordOnTalk() captured)
+
+        void  encodeLoop               (bool bOnTalk);
+        void  encodeFrame              (const AudioCaptureRingFrame* pFrame, bool bOnTalk);
+        void  finishTalk               ();
+        void  sendLastMessageLater     ();
+        void  flushLastMessage         ();
         void  sendAudioData            (short* pAudio);
         void  sendAudioDataOnTalk      (short* pAudio);
-        void  sendAudioDataVolume      (short* pAudio);
         void  testOutputAudio          ();
+        void  clearTestOutput          ();
+
+
+    // Test volume thread (shows the volume of what testRecord() captured)
 
-    // Used in play()
+        void  testVolumeLoop           ();
+        void  sendAudioDataVolume      (short* pAudio);
+
+    // Playback
 
-        void  waitForPlayToEnd         (User* pUser, WAVEHDR* pWaveOutHdr, size_t& iLastPlayingPacketIndex);
-        void  waitForPlayOnTestToEnd   (WAVEHDR* pWaveOutHdr);
-        void  waitForAllBuffers        (User* pUser, bool bClearPackets, size_t* iLastPlayingPacketIndex);
+        bool  startOutput              ();
+        void  stopOutput               ();
+        void  playbackLoop             ();
+        void  updateUserPlayback       (User* pUser);
+        void  updateUserTalking        (User* pUser);
 
-    // Used in start()
+        // Under the users mutex. Takes the frames of the talking users for up to 'iMaxFrameCount' output frames
+        // to 'vPlaybackFrames', returns the number of output frames (less if nobody is talking anymore).
+        size_t takeFramesToPlay        (size_t iMaxFrameCount);
 
-        int  getInputDeviceID          (std::wstring sDeviceName);
+        // Without the users mutex. Mixes the taken frames and writes them to the output device.
+        void  playFrames               (size_t iFrameCount, size_t iFreeFrameCount);
 
     // -------------------------------------------------------------
 
 
-    MainWindow*      pMainWindow;
+    ModelEventSink*  pEventSink;
     NetworkService*  pNetworkService;
     SettingsManager* pSettingsManager;
 
 
-    // Waveform-audio input device
-    HWAVEIN          hWaveIn;
-    HWAVEIN          hTestWaveIn; // Used to show the voice meter in the Settings window.
+    // Audio devices.
+    AudioBackend*    pAudioBackend;
+    AudioStreamFormat streamFormat;
+
+
+    // Drains the voice packets of all users (see playbackLoop()).
+    std::thread      playbackThread;
+
+    // recordOnPush() or recordOnTalk().
+    std::thread      recordThread;
 
+    // encodeLoop().
+    std::thread      encoderThread;
 
-    // Audio format
-    WAVEFORMATEX     Format;
 
+    // Output device (plays the mix of all users)
+    AudioPlaybackStream* pPlaybackStream;
+    AudioMixer*      pAudioMixer;
+    short int*       pMixFrame;
+    std::vector<AudioPlaybackFrame> vPlaybackFrames; // playback thread
 
-    // Audio buffers
-    WAVEHDR          WaveInHdr1;
-    WAVEHDR          WaveInHdr2;
-    WAVEHDR          WaveInHdr3;
-    WAVEHDR          WaveInHdr4;
-    WAVEHDR          TestWaveInHdr1;
-    WAVEHDR          TestWaveInHdr2;
-    WAVEHDR          TestWaveInHdr3;
-    WAVEHDR          TestWaveInHdr4;
+
+    // Input device
+    AudioCaptureStream*  pCaptureStream;
+    AudioCaptureStream*  pTestCaptureStream; // Used to show the voice meter in the Settings window.
 
 
     std::promise<bool> promiseFinishTestRecord;
+
+    // Captured frames of the test (testRecord() -> testVolumeLoop()).
+    AudioCaptureRing* pTestCaptureRing;
+    short int*       pTestOverrunFrame;
+    std::thread      testVolumeThread;
     std::promise<bool> promiseFinishTestOutputAudio;
 
 
-    // "In" buffers
-    short int*       pWaveIn1;
-    short int*       pWaveIn2;
-    short int*       pWaveIn3;
-    short int*       pWaveIn4;
-    short int*       pTestWaveIn1;
-    short int*       pTestWaveIn2;
-    short int*       pTestWaveIn3;
-    short int*       pTestWaveIn4;
+    // Captured frames (capture thread -> encoder thread).
+    AudioCaptureRing* pCaptureRing;
+    short int*       pOverrunFrame;  // the frame is read here if the ring is full
+    unsigned int     iCapturePeriodMS;
+
+    // Voice packet assembled from the captured frames (encoder thread).
+    short int*       pPacket;
+    size_t           iPacketFill;
+
+    VoicePathStats*  pVoicePathStats;
+
+
+    // Voice activation mode (encoder thread) and the voice test in the settings (test record thread).
+    VoiceActivityDetector* pVoiceDetector;
+    VoiceActivityDetector* pTestVoiceDetector;
+
+
+    // Deferred actions (so the audio threads don't sleep).
+    AudioTimer*      pAudioTimer;
+    unsigned long long iLastMessageTask; // encoder thread (or when it's not running)
 
 
     // Audio packets
@@ -201,13 +292,8 @@ private:
     std::mutex          mtxAudioPacketsForTest;
 
 
-    // Waveform-audio output device
-    HWAVEOUT            hTestWaveOut;
-
-
-    // Audio buffers
-    WAVEHDR             TestWaveOutHdr1;
-    WAVEHDR             TestWaveOutHdr2;
+    // Output device of the test
+    AudioPlaybackStream* pTestPlaybackStream;
 
 
     // Record quality
@@ -221,15 +307,11 @@ private:
 
     // Voice.
     int              iAudioInputVolume;
-    int              iLowerVoiceStartRecValueInDBFS;
-    int              iTestPacketsNeedToRecordLeft;
-    int              iPacketsNeedToRecordLeft;
     float            fMasterVolumeMult;
-    bool             bInputReady;
+    std::atomic<bool> bInputReady;   // the audio threads run while it's set
     bool             bTestInputReady;
     bool             bPauseTestInput;
     bool             bOutputTestVoice;
-    bool             bRecordTalk;
     bool             bRecordedSome;
 
     bool             bMuteMic;
@@ -0,0 +1,168 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "audiotimer.h"
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+AudioTimer::AudioTimer()
+{
+    iNextTaskId      = AUDIO_TIMER_NO_TASK + 1;
+    iExecutingTaskId = AUDIO_TIMER_NO_TASK;
+    bStop            = false;
+
+    timerThread = std::thread(&AudioTimer::timerLoop, this);
+}
+
+unsigned long long AudioTimer::schedule(unsigned int iDelayMS, std::function<void()> task)
+{
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(iDelayMS);
+
+
+    std::unique_lock<std::mutex> lock(mtxTasks);
+
+    AudioTimerTask timerTask;
+    timerTask.iId  = iNextTaskId++;
+    timerTask.task = std::move(task);
+
+    unsigned long long iId = timerTask.iId;
+
+    bool bNearest = mTasks.empty() || (deadline < mTasks.begin()->first);
+
+    mTasks.insert( std::make_pair(deadline, std::move(timerTask)) );
+
+    lock.unlock();
+
+
+    if (bNearest)
+    {
+        // The timer thread sleeps until the old (later) deadline.
+        cvTasks.notify_one();
+    }
+
+
+    return iId;
+}
+
+bool AudioTimer::cancel(unsigned long long iTaskId)
+{
+    std::lock_guard<std::mutex> lock(mtxTasks);
+
+    return static_cast<bool>( takeTask(iTaskId) );
+}
+
+bool AudioTimer::runNow(unsigned long long iTaskId)
+{
+    std::unique_lock<std::mutex> lock(mtxTasks);
+
+    std::function<void()> task = takeTask(iTaskId);
+
+    if (task)
+    {
+        lock.unlock();
+
+        task();
+
+        return true;
+    }
+
+
+    // Already taken by the timer thread: the caller expects it done (like the end of talk before the new talk).
+    // Don't wait for itself (runNow() from the task).
+
+    if ( (iTaskId != AUDIO_TIMER_NO_TASK) && (std::this_thread::get_id() != timerThread.get_id()) )
+    {
+        while (iExecutingTaskId == iTaskId)
+        {
+            cvTaskDone.wait(lock);
+        }
+    }
+
+    return false;
+}
+
+void AudioTimer::timerLoop()
+{
+    std::unique_lock<std::mutex> lock(mtxTasks);
+
+    while (bStop == false)
+    {
+        if (mTasks.empty())
+        {
+            cvTasks.wait(lock);
+
+            continue;
+        }
+
+
+        std::chrono::steady_clock::time_point deadline = mTasks.begin()->first;
+
+        if (std::chrono::steady_clock::now() < deadline)
+        {
+            // Woken up earlier if a nearer task is scheduled.
+            cvTasks.wait_until(lock, deadline);
+
+            continue;
+        }
+
+
+        std::function<void()> task = std::move(mTasks.begin()->second.task);
+        iExecutingTaskId = mTasks.begin()->second.iId;
+        mTasks.erase(mTasks.begin());
+
+
+        // The task may schedule or cancel other tasks.
+
+        lock.unlock();
+
+        task();
+
+        lock.lock();
+
+
+        iExecutingTaskId = AUDIO_TIMER_NO_TASK;
+
+        cvTaskDone.notify_all();
+    }
+}
+
+std::function<void()> AudioTimer::takeTask(unsigned long long iTaskId)
+{
+    // There are only a few tasks at a time.
+
+    for (auto it = mTasks.begin();  it != mTasks.end();  ++it)
+    {
+        if (it->second.iId == iTaskId)
+        {
+            std::function<void()> task = std::move(it->second.task);
+
+            mTasks.erase(it);
+
+            return task;
+        }
+    }
+
+
+    return std::function<void()>();
+}
+
+AudioTimer::~AudioTimer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtxTasks);
+
+        bStop = true;
+    }
+
+    cvTasks.notify_one();
+
+
+    timerThread.join();
+}
@@ -0,0 +1,96 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <map>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+
+
+// Returned by schedule(), never a valid task id.
+#define  AUDIO_TIMER_NO_TASK     0
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Deferred actions of the audio threads (like the end of talk message that should go a bit after the last voice packet)
+// so the capture, encoder and playback threads never sleep for them.
+// One thread sleeps until the nearest deadline and runs the due tasks in the order of their deadlines.
+// Tasks run on the timer thread and should be short (no waiting on the audio threads).
+// All functions can be called from any thread (including the tasks).
+class AudioTimer
+{
+
+public:
+
+    AudioTimer();
+
+
+    // Runs 'task' in 'iDelayMS' (or later). Returns the id of the task for cancel().
+
+        unsigned long long  schedule       (unsigned int iDelayMS, std::function<void()> task);
+
+
+    // Removes the task if it did not start yet (does nothing otherwise).
+    // Returns true if the task was removed.
+
+        bool                cancel         (unsigned long long iTaskId);
+
+
+    // Runs the task now (on the calling thread) if it did not start yet,
+    // waits for it to finish if it's running on the timer thread (unless called from that task).
+    // When this returns the task is done (or it was cancelled / never existed).
+    // Returns true if the task was run by this call.
+
+        bool                runNow         (unsigned long long iTaskId);
+
+
+    // Pending tasks are not run.
+
+    ~AudioTimer();
+
+private:
+
+    void                timerLoop      ();
+
+    // Should be called under 'mtxTasks'. Returns the task (empty if not found) and removes it.
+    std::function<void()>  takeTask    (unsigned long long iTaskId);
+
+
+    struct AudioTimerTask
+    {
+        unsigned long long     iId;
+        std::function<void()>  task;
+    };
+
+
+    std::thread              timerThread;
+
+
+    // The task running on the timer thread (AUDIO_TIMER_NO_TASK if none), 'cvTaskDone' is notified when it ends.
+    unsigned long long       iExecutingTaskId;
+    std::condition_variable  cvTaskDone;
+
+
+    // Deadline -> task (the first one is the nearest).
+    std::multimap<std::chrono::steady_clock::time_point, AudioTimerTask>  mTasks;
+    std::mutex               mtxTasks;
+    std::condition_variable  cvTasks;
+
+
+    unsigned long long       iNextTaskId;
+
+    bool                     bStop;
+};
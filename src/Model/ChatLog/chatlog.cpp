@@ -0,0 +1,272 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "chatlog.h"
+
+
+// STL
+#include <utility>
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+ChatLog::ChatLog(size_t iCapacity)
+{
+    if (iCapacity == 0)
+    {
+        iCapacity = 1;
+    }
+
+    // All slots are allocated now: the strings of the overwritten entries keep their buffers.
+    vEntries.resize(iCapacity);
+
+    iFirst         = 0;
+    iSize          = 0;
+
+    iFirstSequence = 0;
+}
+
+void ChatLog::addOutput(const std::wstring& sText, const std::string& sColor, CHAT_LOG_ENTRY_TYPE type)
+{
+    ChatLogEntry& entry = pushBack();
+
+    entry.sText        = sText;
+    entry.sTime.clear();
+    entry.addTime      = std::time(nullptr);
+    entry.iNameId      = CHAT_LOG_NO_NAME;
+    entry.iTimeColorId = internColor(sColor);
+    entry.iTextColorId = entry.iTimeColorId;
+    entry.type         = type;
+}
+
+void ChatLog::addUserMessage(const std::string& sTime, const std::string& sUserName, const std::wstring& sMessage,
+                             const std::string& sTimeColor, const std::string& sTextColor)
+{
+    ChatLogEntry& entry = pushBack();
+
+    entry.sText        = sMessage;
+    entry.sTime        = sTime;
+    entry.addTime      = std::time(nullptr);
+    entry.iNameId      = internName(sUserName);
+    entry.iTimeColorId = internColor(sTimeColor);
+    entry.iTextColorId = internColor(sTextColor);
+    entry.type         = CLET_USER_MESSAGE;
+}
+
+bool ChatLog::addOldOutput(const std::wstring& sText, const std::string& sColor)
+{
+    if (iSize == vEntries.size())
+    {
+        return false;
+    }
+
+
+    iFirst = (iFirst + vEntries.size() - 1) % vEntries.size();
+    iSize++;
+
+    iFirstSequence--;
+
+    ChatLogEntry& entry = vEntries[iFirst];
+
+    entry.sText        = sText;
+    entry.sTime.clear();
+    entry.addTime      = std::time(nullptr);
+    entry.iNameId      = CHAT_LOG_NO_NAME;
+    entry.iTimeColorId = internColor(sColor);
+    entry.iTextColorId = entry.iTimeColorId;
+    entry.type         = CLET_OUTPUT;
+
+
+    return true;
+}
+
+void ChatLog::setCapacity(size_t iCapacity)
+{
+    if (iCapacity == 0)
+    {
+        iCapacity = 1;
+    }
+
+    if (iCapacity == vEntries.size())
+    {
+        return;
+    }
+
+
+    size_t iKeep = (iSize < iCapacity) ? iSize : iCapacity;
+
+    std::vector<ChatLogEntry> vNewEntries(iCapacity);
+
+    for (size_t i = 0;  i < iSize - iKeep;  i++)
+    {
+        releaseName( vEntries[(iFirst + i) % vEntries.size()].iNameId );
+    }
+
+    for (size_t i = 0;  i < iKeep;  i++)
+    {
+        vNewEntries[i] = std::move( vEntries[(iFirst + iSize - iKeep + i) % vEntries.size()] );
+    }
+
+    iFirstSequence += static_cast<long long>(iSize - iKeep);
+
+    vEntries.swap(vNewEntries);
+    iFirst = 0;
+    iSize  = iKeep;
+}
+
+void ChatLog::clear()
+{
+    // No entries - no names.
+    vNames        .clear();
+    vNameRefCounts.clear();
+    vFreeNameIds  .clear();
+    mapNameIds    .clear();
+
+    iFirstSequence += static_cast<long long>(iSize);
+
+    iFirst = 0;
+    iSize  = 0;
+}
+
+size_t ChatLog::getSize() const
+{
+    return iSize;
+}
+
+size_t ChatLog::getCapacity() const
+{
+    return vEntries.size();
+}
+
+const ChatLogEntry& ChatLog::getEntry(size_t i) const
+{
+    return vEntries[(iFirst + i) % vEntries.size()];
+}
+
+const std::string& ChatLog::getName(unsigned int iNameId) const
+{
+    return vNames[iNameId];
+}
+
+size_t ChatLog::getNameCount() const
+{
+    return mapNameIds.size();
+}
+
+const std::string& ChatLog::getColor(unsigned char iColorId) const
+{
+    return vColors[iColorId];
+}
+
+size_t ChatLog::getColorCount() const
+{
+    return vColors.size();
+}
+
+long long ChatLog::getFirstSequence() const
+{
+    return iFirstSequence;
+}
+
+ChatLogEntry& ChatLog::pushBack()
+{
+    if (iSize == vEntries.size())
+    {
+        // Overwrite the oldest.
+
+        ChatLogEntry& entry = vEntries[iFirst];
+
+        releaseName(entry.iNameId);
+        entry.iNameId = CHAT_LOG_NO_NAME;
+
+        iFirst = (iFirst + 1) % vEntries.size();
+        iFirstSequence++;
+
+        return entry;
+    }
+
+
+    iSize++;
+
+    return vEntries[(iFirst + iSize - 1) % vEntries.size()];
+}
+
+unsigned int ChatLog::internName(const std::string& sName)
+{
+    std::unordered_map<std::string, unsigned int>::const_iterator it = mapNameIds.find(sName);
+
+    if (it != mapNameIds.end())
+    {
+        vNameRefCounts[it->second]++;
+
+        return it->second;
+    }
+
+
+    unsigned int iNameId = 0;
+
+    if (vFreeNameIds.empty())
+    {
+        iNameId = static_cast<unsigned int>(vNames.size());
+
+        vNames        .push_back(sName);
+        vNameRefCounts.push_back(1);
+    }
+    else
+    {
+        iNameId = vFreeNameIds.back();
+        vFreeNameIds.pop_back();
+
+        vNames[iNameId]         = sName;
+        vNameRefCounts[iNameId] = 1;
+    }
+
+    mapNameIds[sName] = iNameId;
+
+    return iNameId;
+}
+
+void ChatLog::releaseName(unsigned int iNameId)
+{
+    if (iNameId == CHAT_LOG_NO_NAME)
+    {
+        return;
+    }
+
+
+    vNameRefCounts[iNameId]--;
+
+    if (vNameRefCounts[iNameId] == 0)
+    {
+        mapNameIds.erase(vNames[iNameId]);
+
+        vFreeNameIds.push_back(iNameId);
+    }
+}
+
+unsigned char ChatLog::internColor(const std::string& sColor)
+{
+    for (size_t i = 0;  i < vColors.size();  i++)
+    {
+        if (vColors[i] == sColor)
+        {
+            return static_cast<unsigned char>(i);
+        }
+    }
+
+    if (vColors.size() == 256)
+    {
+        return 255;
+    }
+
+
+    vColors.push_back(sColor);
+
+    return static_cast<unsigned char>(vColors.size() - 1);
+}
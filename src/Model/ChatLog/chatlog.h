@@ -0,0 +1,136 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <ctime>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+
+// Messages kept in the chat (older ones are dropped).
+#define  CHAT_LOG_DEFAULT_CAPACITY   5000
+
+// ChatLogEntry::iNameId of the entries without a user name.
+#define  CHAT_LOG_NO_NAME            0xFFFFFFFFu
+
+
+enum CHAT_LOG_ENTRY_TYPE
+{
+    CLET_OUTPUT        = 0,  // info and error messages, room messages
+    CLET_NOTICE        = 1,  // user connected / disconnected
+    CLET_USER_MESSAGE  = 2   // "time. name: message"
+};
+
+
+struct ChatLogEntry
+{
+    // Text without the time and name (no HTML).
+    std::wstring         sText;
+
+    // Time of the message as the server sent it ("18:58.", short enough to not allocate).
+    std::string          sTime;
+
+    // When the entry was added.
+    std::time_t          addTime;
+
+    unsigned int         iNameId;      // ChatLog::getName() or CHAT_LOG_NO_NAME
+    unsigned char        iTimeColorId; // ChatLog::getColor()
+    unsigned char        iTextColorId;
+
+    CHAT_LOG_ENTRY_TYPE  type;
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Chat messages in a ring buffer of 'iCapacity' entries: adding is O(1) and the memory is bounded
+// (when full the oldest entry is overwritten). User names and colors are interned, the entries keep their ids.
+// Names are counted by the entries that use them: the name of the last dropped entry is removed and its id is reused
+// (so there are never more names than entries).
+// Not thread-safe: used from the GUI thread only (ChatLogView shows it).
+class ChatLog
+{
+
+public:
+
+    ChatLog(size_t iCapacity = CHAT_LOG_DEFAULT_CAPACITY);
+
+
+    // Add (the newest entry)
+
+        void         addOutput           (const std::wstring& sText, const std::string& sColor, CHAT_LOG_ENTRY_TYPE type = CLET_OUTPUT);
+        void         addUserMessage      (const std::string& sTime,  const std::string& sUserName, const std::wstring& sMessage,
+                                          const std::string& sTimeColor, const std::string& sTextColor);
+
+
+    // Add before the oldest entry (history). Returns false if the log is full (the entry would be dropped at once).
+
+        bool         addOldOutput        (const std::wstring& sText, const std::string& sColor);
+
+
+    // Keeps the newest entries if the new capacity is smaller.
+
+        void         setCapacity         (size_t iCapacity);
+
+        void         clear               ();
+
+
+    // GET
+
+        size_t       getSize             () const;
+        size_t       getCapacity         () const;
+
+        // 0 - the oldest kept entry, getSize() - 1 - the newest.
+        const ChatLogEntry&  getEntry    (size_t i) const;
+
+        const std::string&   getName     (unsigned int iNameId) const;
+        size_t               getNameCount() const;
+        const std::string&   getColor    (unsigned char iColorId) const;
+        size_t               getColorCount() const;
+
+        // Sequence number of the oldest entry: +1 for each dropped entry, -1 for each addOldOutput().
+        // The entry 'i' has the number getFirstSequence() + i for all its life, the view keeps its position with it.
+        long long            getFirstSequence() const;
+
+private:
+
+    // Returns the slot of the new newest entry.
+    ChatLogEntry&  pushBack              ();
+
+    // Adds a reference to the name (interns it if it's new).
+    unsigned int   internName            (const std::string& sName);
+
+    // The entry with this name was dropped.
+    void           releaseName           (unsigned int iNameId);
+    unsigned char  internColor           (const std::string& sColor);
+
+
+    // ---------------------------------------
+
+
+    std::vector<ChatLogEntry>  vEntries;
+    size_t                     iFirst;   // index of the oldest entry in 'vEntries'
+    size_t                     iSize;
+
+
+    std::vector<std::string>   vNames;
+    std::vector<size_t>        vNameRefCounts;
+    std::vector<unsigned int>  vFreeNameIds;
+    std::unordered_map<std::string, unsigned int>  mapNameIds;
+
+    // Colors are few (see SilentMessage), the last one is reused when the table is full.
+    std::vector<std::string>   vColors;
+
+
+    long long                  iFirstSequence;
+};
@@ -0,0 +1,85 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "datagrambatch.h"
+
+
+// Sockets and stuff
+#include <winsock2.h>
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+DatagramBatch::DatagramBatch()
+{
+    pSlots = new char[DATAGRAM_BATCH_MAX_COUNT * DATAGRAM_BATCH_SLOT_SIZE];
+    iCount = 0;
+
+    iReceives  = 0;
+    iRecvCalls = 0;
+    iDatagrams = 0;
+}
+
+size_t DatagramBatch::receive(UINT_PTR sock)
+{
+    iCount = 0;
+
+    unsigned long long iCalls = 0;
+
+    while (iCount < DATAGRAM_BATCH_MAX_COUNT)
+    {
+        int iSize = recv(sock, pSlots + iCount * DATAGRAM_BATCH_SLOT_SIZE, DATAGRAM_BATCH_SLOT_SIZE, 0);
+
+        iCalls++;
+
+        if (iSize <= 0)
+        {
+            // WSAEWOULDBLOCK (drained) or an error.
+            break;
+        }
+
+        vSizes[iCount] = iSize;
+        iCount++;
+    }
+
+
+    iReceives .store(iReceives .load(std::memory_order_relaxed) + 1,      std::memory_order_relaxed);
+    iRecvCalls.store(iRecvCalls.load(std::memory_order_relaxed) + iCalls, std::memory_order_relaxed);
+    iDatagrams.store(iDatagrams.load(std::memory_order_relaxed) + iCount, std::memory_order_relaxed);
+
+
+    return iCount;
+}
+
+size_t DatagramBatch::getCount() const
+{
+    return iCount;
+}
+
+char* DatagramBatch::getDatagram(size_t i, int& iSizeOut)
+{
+    iSizeOut = vSizes[i];
+
+    return pSlots + i * DATAGRAM_BATCH_SLOT_SIZE;
+}
+
+DatagramBatchCounters DatagramBatch::getCounters() const
+{
+    DatagramBatchCounters counters;
+
+    counters.iReceives  = iReceives .load(std::memory_order_relaxed);
+    counters.iRecvCalls = iRecvCalls.load(std::memory_order_relaxed);
+    counters.iDatagrams = iDatagrams.load(std::memory_order_relaxed);
+
+    return counters;
+}
+
+DatagramBatch::~DatagramBatch()
+{
+    delete[] pSlots;
+}
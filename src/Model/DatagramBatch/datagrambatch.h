@@ -0,0 +1,82 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <atomic>
+#include <cstddef>
+
+// Other
+#include "basetsd.h"
+
+
+// How many datagrams are received at once (more stay in the socket until the next receive()).
+#define  DATAGRAM_BATCH_MAX_COUNT     32
+
+// Should hold the largest voice packet.
+#define  DATAGRAM_BATCH_SLOT_SIZE     1500
+
+
+// Totals since the DatagramBatch was created (see DatagramBatch::getCounters()).
+struct DatagramBatchCounters
+{
+    unsigned long long  iReceives;      // receive() calls (wake-ups of the listening thread)
+    unsigned long long  iRecvCalls;     // recv() calls (with the last one that would block)
+    unsigned long long  iDatagrams;
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Receives all datagrams waiting in the non-blocking socket into preallocated slots
+// so they are handled together after one wake-up (see SocketReactor) instead of one recv() and a sleep per datagram.
+// WinSock has no recvmmsg(), receive() drains the socket with recv() until it would block.
+// Used by the UDP listening thread only.
+class DatagramBatch
+{
+
+public:
+
+    DatagramBatch();
+
+
+    // Returns the number of received datagrams (0 if the socket had nothing).
+    // Stops at the first recv() error, the next receive() tries again
+    // (for UDP it's usually WSAECONNRESET: ICMP "port unreachable" for one of the previous sends).
+
+        size_t       receive        (UINT_PTR sock);
+
+
+    // Datagrams from the last receive() (valid until the next one).
+
+        size_t       getCount       () const;
+        char*        getDatagram    (size_t i, int& iSizeOut);
+
+
+    // Can be called from any thread (the benchmarks read the syscalls per datagram).
+
+        DatagramBatchCounters  getCounters () const;
+
+
+    ~DatagramBatch();
+
+private:
+
+    char*        pSlots;
+    int          vSizes[DATAGRAM_BATCH_MAX_COUNT];
+    size_t       iCount;
+
+
+    // Written by receive() only (a load and a store, no locked add on the receive path).
+    std::atomic<unsigned long long>  iReceives;
+    std::atomic<unsigned long long>  iRecvCalls;
+    std::atomic<unsigned long long>  iDatagrams;
+};
@@ -0,0 +1,396 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "jitterbuffer.h"
+
+
+// STL
+#include <cstring>
+
+// Custom
+#include "Model/VoicePacketQueue/voicepacketqueue.h"
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+JitterBuffer::JitterBuffer(size_t iFrameSampleCount, unsigned long iSampleRate)
+{
+    this->iFrameSampleCount = iFrameSampleCount;
+    fFrameDurationInMS      = static_cast<float>(iFrameSampleCount) * 1000.0f / static_cast<float>(iSampleRate);
+
+
+    for (size_t i = 0;  i < JITTER_BUFFER_CAPACITY;  i++)
+    {
+        vSlots[i] = nullptr;
+    }
+
+    pLastFrame = new short int[iFrameSampleCount];
+    memset(pLastFrame, 0, iFrameSampleCount * sizeof(short int));
+
+
+    memset(&stats, 0, sizeof(stats));
+    stats.iTargetDepth   = JITTER_BUFFER_MIN_DEPTH;
+
+
+    iLastArrivalSequence = 0;
+    bHasLastArrival      = false;
+
+    iPlayoutSequence     = 0;
+    iHighestSequence     = 0;
+    iConcealedInARow     = 0;
+
+    bHaveFrames          = false;
+    bPlaying             = false;
+    bLastPacketCame      = false;
+    bSequenceFromServer  = false;
+}
+
+void JitterBuffer::insert(const VoicePacket &packet)
+{
+    if (packet.bLast)
+    {
+        if (bHaveFrames)
+        {
+            bLastPacketCame = true;
+        }
+
+        // Don't count the silence between talk spurts as a jitter.
+        bHasLastArrival = false;
+
+        return;
+    }
+
+
+    bSequenceFromServer = packet.bSequenceFromServer;
+
+    updateJitter(packet);
+
+
+    if (bHaveFrames == false)
+    {
+        // First packet of the talk spurt.
+
+        iPlayoutSequence = packet.iSequence;
+        iHighestSequence = packet.iSequence;
+        bHaveFrames      = true;
+        bLastPacketCame  = false;
+    }
+
+
+    int iOffset = static_cast<int>(packet.iSequence - iPlayoutSequence);
+
+    if (iOffset < 0)
+    {
+        if ( (bPlaying == false)
+             &&
+             (static_cast<int>(iHighestSequence - packet.iSequence) < JITTER_BUFFER_CAPACITY) )
+        {
+            // Reordered packet came before we started to play, it's still in time.
+            iPlayoutSequence = packet.iSequence;
+        }
+        else
+        {
+            // Too late, we already played (or concealed) this one.
+
+            stats.iLatePackets++;
+
+            delete[] packet.pAudio;
+
+            return;
+        }
+    }
+    else if (iOffset >= JITTER_BUFFER_CAPACITY)
+    {
+        // Way too far ahead (the speaker restarted the sequence or we lost a lot), resync.
+
+        clear();
+
+        iPlayoutSequence = packet.iSequence;
+        iHighestSequence = packet.iSequence;
+    }
+
+
+    size_t iSlot = packet.iSequence % JITTER_BUFFER_CAPACITY;
+
+    if (vSlots[iSlot])
+    {
+        // Duplicate.
+        delete[] vSlots[iSlot];
+    }
+
+    vSlots[iSlot]            = packet.pAudio;
+    vSlotArrivalTimes[iSlot] = packet.arrivalTime;
+
+
+    if (static_cast<int>(packet.iSequence - iHighestSequence) > 0)
+    {
+        iHighestSequence = packet.iSequence;
+
+        // The speaker is talking again.
+        bLastPacketCame  = false;
+    }
+}
+
+bool JitterBuffer::isReadyToPlay() const
+{
+    if ( (bHaveFrames == false) || bPlaying )
+    {
+        return false;
+    }
+
+
+    size_t iDepth = getDepth();
+
+    if (bLastPacketCame)
+    {
+        // Short talk spurt, no need to wait.
+        return iDepth > 0;
+    }
+    else
+    {
+        return iDepth >= stats.iTargetDepth;
+    }
+}
+
+bool JitterBuffer::isPlaying() const
+{
+    return bPlaying;
+}
+
+void JitterBuffer::startPlayout()
+{
+    bPlaying         = true;
+    iConcealedInARow = 0;
+}
+
+short int* JitterBuffer::getNextFrame(std::chrono::steady_clock::time_point* pArrivalTime)
+{
+    if (bPlaying == false)
+    {
+        return nullptr;
+    }
+
+
+    if (getDepth() > stats.iTargetDepth + JITTER_BUFFER_DEPTH_SLACK)
+    {
+        // The delay grew (the path got better or a burst came), drop the oldest frame.
+
+        size_t iSlot = iPlayoutSequence % JITTER_BUFFER_CAPACITY;
+
+        if (vSlots[iSlot])
+        {
+            delete[] vSlots[iSlot];
+            vSlots[iSlot] = nullptr;
+        }
+
+        iPlayoutSequence++;
+
+        stats.iDroppedFrames++;
+    }
+
+
+    if (getDepth() == 0)
+    {
+        // Nothing to play.
+
+        if ( bLastPacketCame || (iConcealedInARow >= JITTER_BUFFER_MAX_CONCEALED_FRAMES) )
+        {
+            stopPlayout();
+
+            return nullptr;
+        }
+
+
+        // The next packet is late, play something instead of it.
+
+        if (bSequenceFromServer)
+        {
+            // If it will come it will be discarded.
+            iPlayoutSequence++;
+        }
+
+        // Otherwise the next packet that comes gets this sequence (it's not late, it's the one after the concealed frame).
+
+        return concealFrame();
+    }
+
+
+    size_t iSlot = iPlayoutSequence % JITTER_BUFFER_CAPACITY;
+
+    short int* pFrame = vSlots[iSlot];
+    vSlots[iSlot]     = nullptr;
+
+    iPlayoutSequence++;
+
+
+    if (pFrame == nullptr)
+    {
+        // We have the packets after this one, so this one is lost.
+
+        stats.iLostPackets++;
+
+        return concealFrame();
+    }
+
+
+    iConcealedInARow = 0;
+
+    std::memcpy(pLastFrame, pFrame, iFrameSampleCount * sizeof(short int));
+
+    if (pArrivalTime)
+    {
+        *pArrivalTime = vSlotArrivalTimes[iSlot];
+    }
+
+
+    return pFrame;
+}
+
+JitterBufferStats JitterBuffer::getStats() const
+{
+    JitterBufferStats currentStats = stats;
+    currentStats.iCurrentDepth     = getDepth();
+
+    return currentStats;
+}
+
+unsigned int JitterBuffer::extendSequence(unsigned short iSequence16, unsigned int iExpected)
+{
+    short int iOffset = static_cast<short int>( iSequence16 - static_cast<unsigned short>(iExpected) );
+
+    return iExpected + static_cast<unsigned int>( static_cast<int>(iOffset) );
+}
+
+void JitterBuffer::updateJitter(const VoicePacket &packet)
+{
+    if (bHasLastArrival == false)
+    {
+        lastArrivalTime      = packet.arrivalTime;
+        iLastArrivalSequence = packet.iSequence;
+        bHasLastArrival      = true;
+
+        return;
+    }
+
+
+    int iSequenceDiff = static_cast<int>(packet.iSequence - iLastArrivalSequence);
+
+    if (iSequenceDiff <= 0)
+    {
+        // Reordered or duplicate, keep the newest packet as the reference.
+        return;
+    }
+
+
+    // D(i-1, i) from RFC 3550, the "sender timestamp" is the sequence * frame duration.
+
+    float fArrivalDiffInMS = std::chrono::duration<float, std::milli>(packet.arrivalTime - lastArrivalTime).count();
+    float fTransitDiffInMS = fArrivalDiffInMS - static_cast<float>(iSequenceDiff) * fFrameDurationInMS;
+
+    if (fTransitDiffInMS < 0.0f)
+    {
+        fTransitDiffInMS = -fTransitDiffInMS;
+    }
+
+    stats.fJitterInMS += (fTransitDiffInMS - stats.fJitterInMS) / 16.0f;
+
+
+    lastArrivalTime      = packet.arrivalTime;
+    iLastArrivalSequence = packet.iSequence;
+
+
+    updateTarget();
+}
+
+void JitterBuffer::updateTarget()
+{
+    // Be ready for the packet that is ~2 jitters late.
+
+    size_t iTarget = JITTER_BUFFER_MIN_DEPTH
+                     + static_cast<size_t>( 2.0f * stats.fJitterInMS / fFrameDurationInMS + 0.5f );
+
+    if (iTarget > JITTER_BUFFER_MAX_DEPTH)
+    {
+        iTarget = JITTER_BUFFER_MAX_DEPTH;
+    }
+
+    stats.iTargetDepth = iTarget;
+}
+
+short int* JitterBuffer::concealFrame()
+{
+    // Repeat the last frame, each time 2 times quieter.
+
+    iConcealedInARow++;
+    stats.iConcealedFrames++;
+
+
+    short int* pFrame = new short int[iFrameSampleCount];
+
+    int iShift = static_cast<int>(iConcealedInARow);
+
+    for (size_t i = 0;  i < iFrameSampleCount;  i++)
+    {
+        pFrame[i] = static_cast<short int>(pLastFrame[i] >> iShift);
+    }
+
+
+    return pFrame;
+}
+
+void JitterBuffer::stopPlayout()
+{
+    clear();
+
+    memset(pLastFrame, 0, iFrameSampleCount * sizeof(short int));
+
+    bPlaying         = false;
+    bHaveFrames      = false;
+    bLastPacketCame  = false;
+    bHasLastArrival  = false;
+    iConcealedInARow = 0;
+}
+
+size_t JitterBuffer::getDepth() const
+{
+    if (bHaveFrames == false)
+    {
+        return 0;
+    }
+
+
+    int iDepth = static_cast<int>(iHighestSequence - iPlayoutSequence) + 1;
+
+    if (iDepth < 0)
+    {
+        return 0;
+    }
+    else
+    {
+        return static_cast<size_t>(iDepth);
+    }
+}
+
+void JitterBuffer::clear()
+{
+    for (size_t i = 0;  i < JITTER_BUFFER_CAPACITY;  i++)
+    {
+        if (vSlots[i])
+        {
+            delete[] vSlots[i];
+            vSlots[i] = nullptr;
+        }
+    }
+}
+
+JitterBuffer::~JitterBuffer()
+{
+    clear();
+
+    delete[] pLastFrame;
+}
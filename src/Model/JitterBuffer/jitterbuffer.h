@@ -0,0 +1,134 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <chrono>
+#include <cstddef>
+
+
+struct VoicePacket;
+
+
+// Max packets (by sequence number) that can be stored ahead of the playout point.
+#define  JITTER_BUFFER_CAPACITY             32
+
+// Limits for the target playout delay (in packets).
+#define  JITTER_BUFFER_MIN_DEPTH            1
+#define  JITTER_BUFFER_MAX_DEPTH            8
+
+// If we have more than 'target + slack' packets buffered we drop one to reduce the delay.
+#define  JITTER_BUFFER_DEPTH_SLACK          2
+
+// How much missing packets in a row we conceal before stopping the playout.
+#define  JITTER_BUFFER_MAX_CONCEALED_FRAMES 3
+
+
+
+struct JitterBufferStats
+{
+    size_t              iCurrentDepth;
+    size_t              iTargetDepth;
+    float               fJitterInMS;
+
+    unsigned long long  iLatePackets;
+    unsigned long long  iLostPackets;
+    unsigned long long  iConcealedFrames;
+    unsigned long long  iDroppedFrames;
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Adaptive jitter buffer of one speaker.
+// Estimates the inter-arrival jitter (as in RFC 3550), picks the playout delay from it,
+// puts reordered packets back in order, discards late ones and conceals lost ones.
+// The lost, reordered and late packets are seen only if the sequence numbers come from the server
+// (VoicePacket::bSequenceFromServer), otherwise the packets are numbered as they arrive and an underrun
+// only delays the next packet.
+// Used only by the AudioService's playback thread.
+class JitterBuffer
+{
+
+public:
+
+    JitterBuffer(size_t iFrameSampleCount, unsigned long iSampleRate);
+
+
+    // Takes the ownership of 'packet.pAudio'.
+
+        void               insert          (const VoicePacket& packet);
+
+
+    // Playout
+
+        bool               isReadyToPlay   () const;
+        bool               isPlaying       () const;
+        void               startPlayout    ();
+
+        // Returns the next frame to play (caller should delete[] it)
+        // or nullptr if the playout is finished.
+        // 'pArrivalTime' (if not nullptr) is set to the arrival time of the returned frame
+        // and is not changed if the frame is concealed.
+        short int*         getNextFrame    (std::chrono::steady_clock::time_point* pArrivalTime = nullptr);
+
+
+    // Stats
+
+        JitterBufferStats  getStats        () const;
+
+
+    // Returns the 32-bit sequence with the low 16 bits 'iSequence16' that is nearest to 'iExpected'
+    // (for the 16-bit speaker sequence of the UDP_SM_VOICE_BY_ID packets).
+
+        static unsigned int extendSequence (unsigned short iSequence16, unsigned int iExpected);
+
+
+    ~JitterBuffer();
+
+private:
+
+    void                   updateJitter    (const VoicePacket& packet);
+    void                   updateTarget    ();
+    short int*             concealFrame    ();
+    void                   stopPlayout     ();
+    size_t                 getDepth        () const;
+    void                   clear           ();
+
+
+    // ---------------------------------------
+
+
+    short int*             vSlots[JITTER_BUFFER_CAPACITY]; // indexed by 'sequence % capacity'
+    std::chrono::steady_clock::time_point vSlotArrivalTimes[JITTER_BUFFER_CAPACITY];
+
+    short int*             pLastFrame;       // copy of the last played frame (for concealment)
+
+
+    std::chrono::steady_clock::time_point lastArrivalTime;
+    unsigned int           iLastArrivalSequence;
+    bool                   bHasLastArrival;
+
+
+    JitterBufferStats      stats;
+    size_t                 iFrameSampleCount;
+    float                  fFrameDurationInMS;
+
+
+    unsigned int           iPlayoutSequence; // sequence of the next frame to play
+    unsigned int           iHighestSequence; // highest sequence we have in 'vSlots'
+    size_t                 iConcealedInARow;
+
+    bool                   bHaveFrames;
+    bool                   bPlaying;
+    bool                   bLastPacketCame;
+    bool                   bSequenceFromServer; // of the last inserted packet
+};
@@ -0,0 +1,171 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "latencyhistogram.h"
+
+
+// STL
+#include <climits>
+
+
+#define  LATENCY_HISTOGRAM_SUB_BUCKET_BITS  5
+#define  LATENCY_HISTOGRAM_MAX_VALUE        0xFFFFFFFFULL
+
+
+static_assert( (1 << LATENCY_HISTOGRAM_SUB_BUCKET_BITS) == LATENCY_HISTOGRAM_SUB_BUCKETS,      "LATENCY_HISTOGRAM_SUB_BUCKET_BITS does not match LATENCY_HISTOGRAM_SUB_BUCKETS" );
+static_assert( LATENCY_HISTOGRAM_LINEAR_LIMIT == 2 * LATENCY_HISTOGRAM_SUB_BUCKETS,                 "the first log bucket should start right after the linear part" );
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void LatencyHistogram::record(unsigned long long iMicroseconds)
+{
+    vBuckets[ getBucketIndex(iMicroseconds) ].fetch_add(1, std::memory_order_relaxed);
+
+    iCount.fetch_add(1,             std::memory_order_relaxed);
+    iSum  .fetch_add(iMicroseconds, std::memory_order_relaxed);
+
+
+    unsigned long long iCurrent = iMin.load(std::memory_order_relaxed);
+
+    while ( (iMicroseconds < iCurrent) && (iMin.compare_exchange_weak(iCurrent, iMicroseconds, std::memory_order_relaxed) == false) )
+    {
+    }
+
+
+    iCurrent = iMax.load(std::memory_order_relaxed);
+
+    while ( (iMicroseconds > iCurrent) && (iMax.compare_exchange_weak(iCurrent, iMicroseconds, std::memory_order_relaxed) == false) )
+    {
+    }
+}
+
+void LatencyHistogram::reset()
+{
+    for (size_t i = 0;  i < LATENCY_HISTOGRAM_BUCKET_COUNT;  i++)
+    {
+        vBuckets[i] = 0;
+    }
+
+    iCount = 0;
+    iSum   = 0;
+    iMin   = ULLONG_MAX;
+    iMax   = 0;
+}
+
+bool LatencyHistogram::getStats(LatencyStats* pStats) const
+{
+    // Copy the buckets so the percentiles are taken from one set of values.
+
+    unsigned long long vCounts[LATENCY_HISTOGRAM_BUCKET_COUNT];
+    unsigned long long iTotalCount = 0;
+
+    for (size_t i = 0;  i < LATENCY_HISTOGRAM_BUCKET_COUNT;  i++)
+    {
+        vCounts[i]   = vBuckets[i].load(std::memory_order_relaxed);
+        iTotalCount += vCounts[i];
+    }
+
+    if (iTotalCount == 0)
+    {
+        return false;
+    }
+
+
+    pStats->iCount  = iTotalCount;
+    pStats->iMinUS  = iMin.load(std::memory_order_relaxed);
+    pStats->iMaxUS  = iMax.load(std::memory_order_relaxed);
+    pStats->dMeanUS = static_cast<double>( iSum.load(std::memory_order_relaxed) ) / iTotalCount;
+
+    pStats->iP50US  = getPercentile(vCounts, iTotalCount, 0.50f);
+    pStats->iP90US  = getPercentile(vCounts, iTotalCount, 0.90f);
+    pStats->iP99US  = getPercentile(vCounts, iTotalCount, 0.99f);
+
+
+    return true;
+}
+
+size_t LatencyHistogram::getBucketIndex(unsigned long long iMicroseconds)
+{
+    if (iMicroseconds < LATENCY_HISTOGRAM_LINEAR_LIMIT)
+    {
+        return static_cast<size_t>(iMicroseconds);
+    }
+
+    if (iMicroseconds > LATENCY_HISTOGRAM_MAX_VALUE)
+    {
+        iMicroseconds = LATENCY_HISTOGRAM_MAX_VALUE;
+    }
+
+
+    // Position of the highest set bit (6 or more here).
+
+    size_t iHighestBit = 6;
+
+    while ( (iMicroseconds >> (iHighestBit + 1)) != 0 )
+    {
+        iHighestBit++;
+    }
+
+
+    // The top LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1 bits select the sub bucket.
+
+    size_t iShift     = iHighestBit - LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+    size_t iSubBucket = static_cast<size_t>(iMicroseconds >> iShift) - LATENCY_HISTOGRAM_SUB_BUCKETS;
+
+    return LATENCY_HISTOGRAM_LINEAR_LIMIT + (iHighestBit - 6) * LATENCY_HISTOGRAM_SUB_BUCKETS + iSubBucket;
+}
+
+unsigned long long LatencyHistogram::getBucketValue(size_t iBucketIndex)
+{
+    if (iBucketIndex < LATENCY_HISTOGRAM_LINEAR_LIMIT)
+    {
+        return iBucketIndex;
+    }
+
+
+    size_t iLogIndex   = iBucketIndex - LATENCY_HISTOGRAM_LINEAR_LIMIT;
+
+    size_t iHighestBit = 6 + iLogIndex / LATENCY_HISTOGRAM_SUB_BUCKETS;
+    size_t iSubBucket  = iLogIndex % LATENCY_HISTOGRAM_SUB_BUCKETS;
+
+    return static_cast<unsigned long long>(LATENCY_HISTOGRAM_SUB_BUCKETS + iSubBucket) << (iHighestBit - LATENCY_HISTOGRAM_SUB_BUCKET_BITS);
+}
+
+unsigned long long LatencyHistogram::getPercentile(const unsigned long long* pCounts, unsigned long long iTotalCount, float fPercentile) const
+{
+    // Rank of the value (1-based).
+    unsigned long long iRank = static_cast<unsigned long long>( static_cast<double>(fPercentile) * iTotalCount + 0.5 );
+
+    if (iRank == 0)
+    {
+        iRank = 1;
+    }
+
+
+    unsigned long long iSeen = 0;
+
+    for (size_t i = 0;  i < LATENCY_HISTOGRAM_BUCKET_COUNT;  i++)
+    {
+        iSeen += pCounts[i];
+
+        if (iSeen >= iRank)
+        {
+            return getBucketValue(i);
+        }
+    }
+
+
+    return getBucketValue(LATENCY_HISTOGRAM_BUCKET_COUNT - 1);
+}
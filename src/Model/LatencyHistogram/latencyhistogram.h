@@ -0,0 +1,85 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <atomic>
+#include <cstddef>
+
+
+// Values below are exact, values above have 5 bits of precision (~3%).
+#define  LATENCY_HISTOGRAM_LINEAR_LIMIT   64
+#define  LATENCY_HISTOGRAM_SUB_BUCKETS    32
+
+// Up to 2^32 microseconds (larger values go to the last bucket).
+#define  LATENCY_HISTOGRAM_BUCKET_COUNT   (LATENCY_HISTOGRAM_LINEAR_LIMIT + (32 - 6) * LATENCY_HISTOGRAM_SUB_BUCKETS)
+
+
+
+struct LatencyStats
+{
+    unsigned long long  iCount;
+
+    // In microseconds.
+    unsigned long long  iMinUS;
+    unsigned long long  iP50US;
+    unsigned long long  iP90US;
+    unsigned long long  iP99US;
+    unsigned long long  iMaxUS;
+    double              dMeanUS;
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Distribution of a latency (in microseconds) in log-linear buckets (like HdrHistogram).
+// record() is lock-free and does not allocate so it can be called on the audio threads,
+// getStats() and reset() can be called from any thread (the stats may be off by the values recorded meanwhile).
+class LatencyHistogram
+{
+
+public:
+
+    LatencyHistogram();
+
+
+    // Record
+
+        void    record                 (unsigned long long iMicroseconds);
+        void    reset                  ();
+
+
+    // Returns false if nothing was recorded.
+    // The percentiles are rounded down to the smallest value of their bucket.
+
+        bool    getStats               (LatencyStats* pStats) const;
+
+
+    // Buckets
+
+        static size_t              getBucketIndex       (unsigned long long iMicroseconds);
+
+        // Smallest value of the bucket.
+        static unsigned long long  getBucketValue       (size_t iBucketIndex);
+
+private:
+
+    // Returns the value below which 'fPercentile' of the recorded values are.
+    unsigned long long  getPercentile  (const unsigned long long* pCounts, unsigned long long iTotalCount, float fPercentile) const;
+
+
+    std::atomic<unsigned long long>  vBuckets [LATENCY_HISTOGRAM_BUCKET_COUNT];
+
+    std::atomic<unsigned long long>  iCount;
+    std::atomic<unsigned long long>  iSum;
+    std::atomic<unsigned long long>  iMin;
+    std::atomic<unsigned long long>  iMax;
+};
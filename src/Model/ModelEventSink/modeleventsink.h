@@ -0,0 +1,75 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <string>
+
+// Custom
+#include "Model/OutputTextType.h"
+
+
+// Handle of the user in the view. The model never looks inside it, it only gets it from
+// addNewUserToList() / addUserToRoomIndex() and passes it back (it can be nullptr for the sinks without a user list).
+class SListItemUser;
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Everything the model (NetworkService, AudioService, SettingsManager, Controller) tells the view.
+// The functions are called from the network and audio threads, an implementation does its own thread hopping
+// (MainWindow queues them to the GUI thread), RecordingEventSink runs the model without Qt.
+class ModelEventSink
+{
+
+public:
+
+    // Print on Chat Room
+
+        virtual void            printUserMessage           (std::string timeInfo,  std::wstring message,  SilentMessage messageColor, bool bEmitSignal = false) = 0;
+        virtual void            printOutput                (std::string text,      SilentMessage messageColor,  bool bEmitSignal = false) = 0;
+        virtual void            printOutputW               (std::wstring text,     SilentMessage messageColor,  bool bEmitSignal = false) = 0;
+        virtual void            showUserDisconnectNotice   (std::string name,      SilentMessage messageColor,  char cUserLost) = 0;
+        virtual void            showUserConnectNotice      (std::string name,      SilentMessage messageColor) = 0;
+
+
+    // Users and rooms
+
+        virtual void            setPingAndTalkingToUser    (SListItemUser* pListWidgetItem, int iPing, bool bTalking) = 0;
+        virtual void            deleteUserFromList         (SListItemUser* pListWidgetItem, bool bDeleteAll = false) = 0;
+        virtual void            setOnlineUsersCount        (int onlineCount) = 0;
+        virtual SListItemUser*  addNewUserToList           (std::string name) = 0;
+        virtual void            addRoom                    (std::string sRoomName, std::wstring sPassword = L"", size_t iMaxUsers = 0, bool bFirstRoom = false) = 0;
+        virtual SListItemUser*  addUserToRoomIndex         (std::string sName, size_t iRoomIndex) = 0;
+        virtual void            moveUserToRoom             (SListItemUser* pUser, std::string sRoomName) = 0;
+        virtual void            moveRoom                   (std::string sRoomName, bool bMoveUp) = 0;
+        virtual void            deleteRoom                 (std::string sRoomName) = 0;
+        virtual void            createRoom                 (std::string sName, std::u16string sPassword, size_t iMaxUsers) = 0;
+        virtual void            changeRoomSettings         (std::string sOldName, std::string sNewName, size_t iMaxUsers) = 0;
+
+
+    // Controls
+
+        virtual void            enableInteractiveElements  (bool bMenu, bool bTypeAndSend) = 0;
+        virtual void            setConnectDisconnectButton (bool bConnect) = 0;
+        virtual void            clearTextEdit              () = 0;
+
+
+    // Other
+
+        virtual void            showVoiceVolumeValueInSettings(int iVolume) = 0;
+        virtual void            showMessageBox             (bool bWarningBox, std::string message) = 0;
+        virtual void            showPasswordInputWindow    (std::string sRoomName) = 0;
+        virtual void            showServerMessage          (std::string sMessage) = 0;
+        virtual void            applyTheme                 () = 0;
+
+
+    virtual ~ModelEventSink() {}
+};
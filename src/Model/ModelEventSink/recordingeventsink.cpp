@@ -0,0 +1,354 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "recordingeventsink.h"
+
+
+// STL
+#include <cstdio>
+
+
+
+// Non-ASCII characters become '?' (the lines are only for the logs).
+static std::string toNarrow(const std::wstring& sText)
+{
+    std::string sResult;
+    sResult.reserve(sText.size());
+
+    for (size_t i = 0;  i < sText.size();  i++)
+    {
+        sResult += (sText[i] < 128) ? static_cast<char>(sText[i]) : '?';
+    }
+
+    return sResult;
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+RecordingEventSink::RecordingEventSink(size_t iKeepLines, bool bEcho)
+{
+    this->iKeepLines = iKeepLines;
+    this->bEcho      = bEcho;
+
+    for (size_t i = 0;  i < ME_COUNT;  i++)
+    {
+        vCounts[i] = 0;
+    }
+
+    iOnlineCount = 0;
+}
+
+void RecordingEventSink::printUserMessage(std::string timeInfo, std::wstring message, SilentMessage messageColor, bool bEmitSignal)
+{
+    (void)messageColor;
+    (void)bEmitSignal;
+
+
+    count(ME_USER_MESSAGE);
+
+    addLine(timeInfo + " " + toNarrow(message));
+}
+
+void RecordingEventSink::printOutput(std::string text, SilentMessage messageColor, bool bEmitSignal)
+{
+    (void)messageColor;
+    (void)bEmitSignal;
+
+
+    count(ME_OUTPUT);
+
+    addLine(text);
+}
+
+void RecordingEventSink::printOutputW(std::wstring text, SilentMessage messageColor, bool bEmitSignal)
+{
+    (void)messageColor;
+    (void)bEmitSignal;
+
+
+    count(ME_OUTPUT);
+
+    addLine(toNarrow(text));
+}
+
+void RecordingEventSink::showUserDisconnectNotice(std::string name, SilentMessage messageColor, char cUserLost)
+{
+    (void)messageColor;
+
+
+    count(ME_USER_NOTICE);
+
+    addLine(name + ((cUserLost != 0) ? " lost connection." : " disconnected."));
+}
+
+void RecordingEventSink::showUserConnectNotice(std::string name, SilentMessage messageColor)
+{
+    (void)messageColor;
+
+
+    count(ME_USER_NOTICE);
+
+    addLine(name + " connected.");
+}
+
+void RecordingEventSink::setPingAndTalkingToUser(SListItemUser* pListWidgetItem, int iPing, bool bTalking)
+{
+    (void)pListWidgetItem;
+    (void)iPing;
+    (void)bTalking;
+
+
+    count(ME_PING_AND_TALKING);
+}
+
+void RecordingEventSink::deleteUserFromList(SListItemUser* pListWidgetItem, bool bDeleteAll)
+{
+    (void)pListWidgetItem;
+    (void)bDeleteAll;
+
+
+    count(ME_USER_LIST);
+}
+
+void RecordingEventSink::setOnlineUsersCount(int onlineCount)
+{
+    count(ME_USER_LIST);
+
+    iOnlineCount = onlineCount;
+}
+
+SListItemUser* RecordingEventSink::addNewUserToList(std::string name)
+{
+    (void)name;
+
+
+    count(ME_USER_LIST);
+
+    return nullptr;
+}
+
+void RecordingEventSink::addRoom(std::string sRoomName, std::wstring sPassword, size_t iMaxUsers, bool bFirstRoom)
+{
+    (void)sRoomName;
+    (void)sPassword;
+    (void)iMaxUsers;
+    (void)bFirstRoom;
+
+
+    count(ME_ROOMS);
+}
+
+SListItemUser* RecordingEventSink::addUserToRoomIndex(std::string sName, size_t iRoomIndex)
+{
+    (void)sName;
+    (void)iRoomIndex;
+
+
+    count(ME_USER_LIST);
+
+    return nullptr;
+}
+
+void RecordingEventSink::moveUserToRoom(SListItemUser* pUser, std::string sRoomName)
+{
+    (void)pUser;
+    (void)sRoomName;
+
+
+    count(ME_USER_LIST);
+}
+
+void RecordingEventSink::moveRoom(std::string sRoomName, bool bMoveUp)
+{
+    (void)sRoomName;
+    (void)bMoveUp;
+
+
+    count(ME_ROOMS);
+}
+
+void RecordingEventSink::deleteRoom(std::string sRoomName)
+{
+    (void)sRoomName;
+
+
+    count(ME_ROOMS);
+}
+
+void RecordingEventSink::createRoom(std::string sName, std::u16string sPassword, size_t iMaxUsers)
+{
+    (void)sName;
+    (void)sPassword;
+    (void)iMaxUsers;
+
+
+    count(ME_ROOMS);
+}
+
+void RecordingEventSink::changeRoomSettings(std::string sOldName, std::string sNewName, size_t iMaxUsers)
+{
+    (void)sOldName;
+    (void)sNewName;
+    (void)iMaxUsers;
+
+
+    count(ME_ROOMS);
+}
+
+void RecordingEventSink::enableInteractiveElements(bool bMenu, bool bTypeAndSend)
+{
+    (void)bMenu;
+    (void)bTypeAndSend;
+
+
+    count(ME_CONTROLS);
+}
+
+void RecordingEventSink::setConnectDisconnectButton(bool bConnect)
+{
+    (void)bConnect;
+
+
+    count(ME_CONTROLS);
+}
+
+void RecordingEventSink::clearTextEdit()
+{
+    count(ME_CONTROLS);
+}
+
+void RecordingEventSink::showVoiceVolumeValueInSettings(int iVolume)
+{
+    (void)iVolume;
+
+
+    count(ME_OTHER);
+}
+
+void RecordingEventSink::showMessageBox(bool bWarningBox, std::string message)
+{
+    count(ME_MESSAGE_BOX);
+
+    addLine(std::string(bWarningBox ? "Warning: " : "Information: ") + message);
+}
+
+void RecordingEventSink::showPasswordInputWindow(std::string sRoomName)
+{
+    count(ME_MESSAGE_BOX);
+
+    addLine("Password for the room \"" + sRoomName + "\" is requested.");
+}
+
+void RecordingEventSink::showServerMessage(std::string sMessage)
+{
+    count(ME_OUTPUT);
+
+    addLine("Server message: " + sMessage);
+}
+
+void RecordingEventSink::applyTheme()
+{
+    count(ME_OTHER);
+}
+
+unsigned long long RecordingEventSink::getCount(MODEL_EVENT event) const
+{
+    return vCounts[event];
+}
+
+int RecordingEventSink::getOnlineCount() const
+{
+    return iOnlineCount;
+}
+
+std::vector<std::string> RecordingEventSink::getLines() const
+{
+    std::lock_guard<std::mutex> lock(mtxLines);
+
+    return std::vector<std::string>(qLines.begin(), qLines.end());
+}
+
+void RecordingEventSink::reset()
+{
+    for (size_t i = 0;  i < ME_COUNT;  i++)
+    {
+        vCounts[i] = 0;
+    }
+
+    std::lock_guard<std::mutex> lock(mtxLines);
+
+    qLines.clear();
+}
+
+std::string RecordingEventSink::format() const
+{
+    std::string sText = "Model events:\n";
+
+    char vLine[128];
+
+    for (size_t i = 0;  i < ME_COUNT;  i++)
+    {
+        MODEL_EVENT event = static_cast<MODEL_EVENT>(i);
+
+        std::snprintf(vLine, sizeof(vLine), "%-16s %10llu\n", getEventName(event), getCount(event));
+
+        sText += vLine;
+    }
+
+    return sText;
+}
+
+const char* RecordingEventSink::getEventName(MODEL_EVENT event)
+{
+    switch (event)
+    {
+    case(ME_OUTPUT):           return "output";
+    case(ME_USER_MESSAGE):     return "user_message";
+    case(ME_USER_NOTICE):      return "user_notice";
+    case(ME_PING_AND_TALKING): return "ping_and_talking";
+    case(ME_USER_LIST):        return "user_list";
+    case(ME_ROOMS):            return "rooms";
+    case(ME_CONTROLS):         return "controls";
+    case(ME_MESSAGE_BOX):      return "message_box";
+    case(ME_OTHER):            return "other";
+    default:                   return "unknown";
+    }
+}
+
+RecordingEventSink::~RecordingEventSink()
+{
+}
+
+void RecordingEventSink::count(MODEL_EVENT event)
+{
+    vCounts[event].fetch_add(1, std::memory_order_relaxed);
+}
+
+void RecordingEventSink::addLine(const std::string& sLine)
+{
+    if (bEcho)
+    {
+        std::printf("%s\n", sLine.c_str());
+    }
+
+    if (iKeepLines == 0)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mtxLines);
+
+    qLines.push_back(sLine);
+
+    if (qLines.size() > iKeepLines)
+    {
+        qLines.pop_front();
+    }
+}
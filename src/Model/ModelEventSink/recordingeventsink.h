@@ -0,0 +1,130 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Custom
+#include "Model/ModelEventSink/modeleventsink.h"
+
+
+enum MODEL_EVENT
+{
+    ME_OUTPUT               = 0,  // printOutput(), printOutputW(), showServerMessage()
+    ME_USER_MESSAGE         = 1,  // printUserMessage()
+    ME_USER_NOTICE          = 2,  // showUserConnectNotice(), showUserDisconnectNotice()
+    ME_PING_AND_TALKING     = 3,  // setPingAndTalkingToUser()
+    ME_USER_LIST            = 4,  // add / move / delete a user, setOnlineUsersCount()
+    ME_ROOMS                = 5,  // add / create / move / delete / change a room
+    ME_CONTROLS             = 6,  // enableInteractiveElements(), setConnectDisconnectButton(), clearTextEdit()
+    ME_MESSAGE_BOX          = 7,  // showMessageBox(), showPasswordInputWindow()
+    ME_OTHER                = 8,  // showVoiceVolumeValueInSettings(), applyTheme()
+
+    ME_COUNT                = 9
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// ModelEventSink without a view: counts the events (lock-free) and keeps the last 'iKeepLines' lines of the text
+// (chat output, notices and message boxes) so the model can run headless (load generators, soak tests, profiling).
+// With 'iKeepLines' 0 it only counts (no-op sink). The user list handles it returns are nullptr.
+class RecordingEventSink : public ModelEventSink
+{
+
+public:
+
+    // 'bEcho' - also print the text lines to stdout.
+    RecordingEventSink(size_t iKeepLines = 0, bool bEcho = false);
+
+
+    // Print on Chat Room
+
+        void            printUserMessage           (std::string timeInfo,  std::wstring message,  SilentMessage messageColor, bool bEmitSignal = false) override;
+        void            printOutput                (std::string text,      SilentMessage messageColor,  bool bEmitSignal = false) override;
+        void            printOutputW               (std::wstring text,     SilentMessage messageColor,  bool bEmitSignal = false) override;
+        void            showUserDisconnectNotice   (std::string name,      SilentMessage messageColor,  char cUserLost) override;
+        void            showUserConnectNotice      (std::string name,      SilentMessage messageColor) override;
+
+
+    // Users and rooms
+
+        void            setPingAndTalkingToUser    (SListItemUser* pListWidgetItem, int iPing, bool bTalking) override;
+        void            deleteUserFromList         (SListItemUser* pListWidgetItem, bool bDeleteAll = false) override;
+        void            setOnlineUsersCount        (int onlineCount) override;
+        SListItemUser*  addNewUserToList           (std::string name) override;
+        void            addRoom                    (std::string sRoomName, std::wstring sPassword = L"", size_t iMaxUsers = 0, bool bFirstRoom = false) override;
+        SListItemUser*  addUserToRoomIndex         (std::string sName, size_t iRoomIndex) override;
+        void            moveUserToRoom             (SListItemUser* pUser, std::string sRoomName) override;
+        void            moveRoom                   (std::string sRoomName, bool bMoveUp) override;
+        void            deleteRoom                 (std::string sRoomName) override;
+        void            createRoom                 (std::string sName, std::u16string sPassword, size_t iMaxUsers) override;
+        void            changeRoomSettings         (std::string sOldName, std::string sNewName, size_t iMaxUsers) override;
+
+
+    // Controls
+
+        void            enableInteractiveElements  (bool bMenu, bool bTypeAndSend) override;
+        void            setConnectDisconnectButton (bool bConnect) override;
+        void            clearTextEdit              () override;
+
+
+    // Other
+
+        void            showVoiceVolumeValueInSettings(int iVolume) override;
+        void            showMessageBox             (bool bWarningBox, std::string message) override;
+        void            showPasswordInputWindow    (std::string sRoomName) override;
+        void            showServerMessage          (std::string sMessage) override;
+        void            applyTheme                 () override;
+
+
+    // Results (any thread)
+
+        unsigned long long        getCount         (MODEL_EVENT event) const;
+        int                       getOnlineCount   () const;
+
+        // The last (up to 'iKeepLines') text lines, oldest first.
+        std::vector<std::string>  getLines         () const;
+
+        void                      reset            ();
+
+        // One line per event type (count).
+        std::string               format           () const;
+
+        static const char*        getEventName     (MODEL_EVENT event);
+
+
+    ~RecordingEventSink() override;
+
+private:
+
+    void            count                      (MODEL_EVENT event);
+    void            addLine                    (const std::string& sLine);
+
+
+    // ---------------------------------------
+
+
+    std::atomic<unsigned long long>  vCounts[ME_COUNT];
+    std::atomic<int>                 iOnlineCount;
+
+
+    std::deque<std::string>          qLines;
+    mutable std::mutex               mtxLines;
+
+    size_t                           iKeepLines;
+    bool                             bEcho;
+};
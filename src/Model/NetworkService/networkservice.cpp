@@ -8,6 +8,9 @@
 
 // STL
 #include <thread>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
 
 
 // Sockets and stuff
@@ -18,15 +21,21 @@
 
 
 // Custom
-#include "View/MainWindow/mainwindow.h"
+#include "Model/ModelEventSink/modeleventsink.h"
 #include "Model/AudioService/audioservice.h"
 #include "Model/SettingsManager/settingsmanager.h"
 #include "Model/SettingsManager/SettingsFile.h"
 #include "Model/net_params.h"
+#include "Model/net_messages.h"
+#include "Model/VoiceDatagram/voicedatagram.h"
 #include "Model/OutputTextType.h"
-#include "View/CustomList/SListItemUser/slistitemuser.h"
-#include "View/CustomList/SListItemRoom/slistitemroom.h"
 #include "Model/User.h"
+#include "Model/VoiceCipher/voicecipher.h"
+#include "Model/VoiceCodec/voicecodec.h"
+#include "Model/SocketReactor/socketreactor.h"
+#include "Model/DatagramBatch/datagrambatch.h"
+#include "Model/TCPFrameReader/tcpframereader.h"
+#include "Model/UserDirectory/userdirectory.h"
 
 
 // External
@@ -34,81 +43,26 @@
 #include "integer/integer.h"
 
 
-enum CONNECT_MESSAGE
-{
-    CM_USERNAME_INUSE       = 0,
-    CM_SERVER_FULL          = 2,
-    CM_WRONG_CLIENT         = 3,
-    CM_SERVER_INFO          = 4,
-    CM_NEED_PASSWORD        = 5
-};
-
-enum ROOM_COMMAND
-{
-    RC_ENTER_ROOM           = 15,
-    RC_ENTER_ROOM_WITH_PASS = 16,
-
-    RC_CAN_ENTER_ROOM       = 20,
-    RC_ROOM_IS_FULL         = 21,
-    RC_PASSWORD_REQ         = 22,
-    RC_WRONG_PASSWORD       = 23,
-
-    RC_USER_ENTERS_ROOM     = 25,
-    RC_SERVER_MOVED_ROOM    = 26,
-    RC_SERVER_DELETES_ROOM  = 27,
-    RC_SERVER_CREATES_ROOM  = 28,
-    RC_SERVER_CHANGES_ROOM  = 29
-};
-
-enum SERVER_MESSAGE
-{
-    SM_NEW_USER             = 0,
-    SM_SOMEONE_DISCONNECTED = 1,
-    SM_CAN_START_UDP        = 2,
-    SM_SPAM_NOTICE          = 3,
-    SM_PING                 = 8,
-    SM_KEEPALIVE            = 9,
-    SM_USERMESSAGE          = 10,
-    SM_KICKED               = 11,
-    SM_WRONG_PASSWORD_WAIT  = 12,
-    SM_GLOBAL_MESSAGE       = 13
-};
-
-enum VOICE_MESSAGE
-{
-    VM_DEFAULT_MESSAGE      = 1,
-    VM_LAST_MESSAGE         = 2
-};
-
-enum USER_DISCONNECT_REASON
-{
-    UDR_DISCONNECT          = 0,
-    UDR_LOST                = 1,
-    UDR_KICKED              = 2
-};
-
-enum UDP_SERVER_MESSAGE
-{
-    UDP_SM_PREPARE          = -1,
-    UDP_SM_PING             =  0,
-    UDP_SM_FIRST_PING       = -2,
-    UDP_SM_USER_READY       = -3
-};
-
-
 // ------------------------------------------------------------------------------------------------
 // ------------------------------------------------------------------------------------------------
 // ------------------------------------------------------------------------------------------------
 
 
-NetworkService::NetworkService(MainWindow* pMainWindow, AudioService* pAudioService, SettingsManager* pSettingsManager)
+NetworkService::NetworkService(ModelEventSink* pEventSink, AudioService* pAudioService, SettingsManager* pSettingsManager)
 {
-    this->pMainWindow      = pMainWindow;
+    this->pEventSink       = pEventSink;
     this->pAudioService    = pAudioService;
     this->pSettingsManager = pSettingsManager;
     pThisUser              = nullptr;
 
-    pAES    = new AES(128);
+    pAES         = new AES(128);
+    pVoiceCipher = new VoiceCipher();
+    pVoiceCodec  = new VoiceCodec();
+    pTCPReactor  = new SocketReactor();
+    pUDPReactor  = new SocketReactor();
+    pUDPBatch    = new DatagramBatch();
+    pTCPReader   = new TCPFrameReader();
+    pOtherUsers  = new UserDirectory();
     pRndGen = new std::mt19937_64( std::random_device{}() );
 
     clientVersion = CLIENT_VERSION;
@@ -121,6 +75,13 @@ NetworkService::NetworkService(MainWindow* pMainWindow, AudioService* pAudioServ
 NetworkService::~NetworkService()
 {
     delete pAES;
+    delete pVoiceCipher;
+    delete pVoiceCodec;
+    delete pTCPReactor;
+    delete pUDPReactor;
+    delete pUDPBatch;
+    delete pTCPReader;
+    delete pOtherUsers;
     delete pRndGen;
 }
 
@@ -144,26 +105,38 @@ std::string NetworkService::getUserName() const
     }
 }
 
-SListItemRoom *NetworkService::getUserRoom() const
+std::string NetworkService::getUserRoomName() const
 {
+    std::lock_guard<std::mutex> lock(mtxThisUserRoom);
+
     if (pThisUser)
     {
-        return dynamic_cast<SListItemUser*>(pThisUser->pListWidgetItem)->getRoom();
+        return pThisUser->sRoomName;
     }
     else
     {
-        return nullptr;
+        return "";
     }
 }
 
 size_t NetworkService::getOtherUsersVectorSize() const
 {
-    return vOtherUsers.size();
+    return pOtherUsers->size();
 }
 
 User *NetworkService::getOtherUser(size_t i) const
 {
-    return vOtherUsers[i];
+    return pOtherUsers->get(i);
+}
+
+User *NetworkService::findOtherUser(const std::string &sUserName) const
+{
+    return pOtherUsers->find(sUserName);
+}
+
+User *NetworkService::findOtherUserBySpeakerId(unsigned short iSpeakerId) const
+{
+    return pOtherUsers->findBySpeakerId(iSpeakerId);
 }
 
 std::mutex *NetworkService::getOtherUsersMutex()
@@ -171,6 +144,16 @@ std::mutex *NetworkService::getOtherUsersMutex()
     return &mtxOtherUsers;
 }
 
+DatagramBatchCounters NetworkService::getUDPReceiveCounters() const
+{
+    return pUDPBatch->getCounters();
+}
+
+SocketReactorCounters NetworkService::getTCPReactorCounters() const
+{
+    return pTCPReactor->getCounters();
+}
+
 void NetworkService::setupChatConnection(std::string address, std::string port, std::string userName, wstring sPass)
 {
     // Disable Nagle algorithm for connected socket.
@@ -182,11 +165,11 @@ void NetworkService::setupChatConnection(std::string address, std::string port,
 
     if (returnCode == SOCKET_ERROR)
     {
-        pMainWindow->printOutput("NetworkService::connectTo()::setsockopt (Nagle algorithm) failed and returned: "
-                                 + std::to_string(WSAGetLastError())
-                                 + ".\nTry again.\n",
-                                 SilentMessage(false),
-                                 true);
+        pEventSink->printOutput("NetworkService::connectTo()::setsockopt (Nagle algorithm) failed and returned: "
+                                + std::to_string(WSAGetLastError())
+                                + ".\nTry again.\n",
+                                SilentMessage(false),
+                                true);
 
         forceStop(pThisUser->sockUserTCP);
         return;
@@ -265,9 +248,9 @@ void NetworkService::setupChatConnection(std::string address, std::string port,
             shutdown(pThisUser->sockUserTCP, SD_SEND);
         }
 
-        pMainWindow->printOutput("\nA user with this name is already present on the server. Choose another name.",
-                                 SilentMessage(false),
-                                 true);
+        pEventSink->printOutput("\nA user with this name is already present on the server. Choose another name.",
+                                SilentMessage(false),
+                                true);
 
         forceStop(pThisUser->sockUserTCP);
         return;
@@ -281,9 +264,9 @@ void NetworkService::setupChatConnection(std::string address, std::string port,
             shutdown(pThisUser->sockUserTCP, SD_SEND);
         }
 
-        pMainWindow->printOutput("\nThe server is full.",
-                                  SilentMessage(false),
-                                  true);
+        pEventSink->printOutput("\nThe server is full.",
+                                 SilentMessage(false),
+                                 true);
 
         forceStop(pThisUser->sockUserTCP);
         return;
@@ -308,11 +291,11 @@ void NetworkService::setupChatConnection(std::string address, std::string port,
             shutdown(pThisUser->sockUserTCP,SD_SEND);
         }
 
-        pMainWindow->printOutput("\nYour Silent version (" + clientVersion + ") does not match the server's "
-                                 "supported client version (" + std::string(vVersionBuffer) + ").\n"
-                                 "Please change your Silent version to " + std::string(vVersionBuffer)
-                                 + " if you want to connect to this server.",
-                                 SilentMessage(false), true);
+        pEventSink->printOutput("\nYour Silent version (" + clientVersion + ") does not match the server's "
+                                "supported client version (" + std::string(vVersionBuffer) + ").\n"
+                                "Please change your Silent version to " + std::string(vVersionBuffer)
+                                + " if you want to connect to this server.",
+                                SilentMessage(false), true);
 
         forceStop(pThisUser->sockUserTCP);
         return;
@@ -327,10 +310,10 @@ void NetworkService::setupChatConnection(std::string address, std::string port,
             shutdown(pThisUser->sockUserTCP, SD_SEND);
         }
 
-        pMainWindow->printOutput("\nThe server has a password.\n"
-                                  "You either not entered a password or it was wrong.",
-                                  SilentMessage(false),
-                                  true);
+        pEventSink->printOutput("\nThe server has a password.\n"
+                                 "You either not entered a password or it was wrong.",
+                                 SilentMessage(false),
+                                 true);
 
         forceStop(pThisUser->sockUserTCP);
         return;
@@ -352,18 +335,18 @@ void NetworkService::setupChatConnection(std::string address, std::string port,
 
         if (pWelcomeRoomMessage != nullptr)
         {
-            pMainWindow->printOutput("\n-----------------------------------------------------------------------------\n",
-                                     SilentMessage(false),
-                                     true);
-            pMainWindow->printOutput("Room Message:\n",
-                                     SilentMessage(false),
-                                     true);
-            pMainWindow->printOutputW(pWelcomeRoomMessage,
-                                      SilentMessage(false),
-                                      true);
-            pMainWindow->printOutput("\n-----------------------------------------------------------------------------\n",
+            pEventSink->printOutput("\n-----------------------------------------------------------------------------\n",
+                                    SilentMessage(false),
+                                    true);
+            pEventSink->printOutput("Room Message:\n",
+                                    SilentMessage(false),
+                                    true);
+            pEventSink->printOutputW(pWelcomeRoomMessage,
                                      SilentMessage(false),
                                      true);
+            pEventSink->printOutput("\n-----------------------------------------------------------------------------\n",
+                                    SilentMessage(false),
+                                    true);
 
             delete[] pWelcomeRoomMessage;
         }
@@ -372,7 +355,11 @@ void NetworkService::setupChatConnection(std::string address, std::string port,
         // Save this user.
 
         pThisUser->sUserName = userName;
-        pThisUser->pListWidgetItem = pMainWindow->addUserToRoomIndex(userName, 0);
+        pThisUser->pListWidgetItem = pEventSink->addUserToRoomIndex(userName, 0);
+
+        mtxThisUserRoom.lock();
+        pThisUser->sRoomName = sWelcomeRoomName;
+        mtxThisUserRoom.unlock();
 
         pAudioService->setupUserAudio( pThisUser );
 
@@ -380,13 +367,13 @@ void NetworkService::setupChatConnection(std::string address, std::string port,
 
         // Start listen thread.
 
-        pMainWindow->printOutput("Connected to the text chat.\n"
-                                 "Waiting to connect to the voice chat. Please wait...\n",
-                                 SilentMessage(false),
-                                 true);
+        pEventSink->printOutput("Connected to the text chat.\n"
+                                "Waiting to connect to the voice chat. Please wait...\n",
+                                SilentMessage(false),
+                                true);
 
-        pMainWindow->enableInteractiveElements(true, true);
-        pMainWindow->setConnectDisconnectButton(false);
+        pEventSink->enableInteractiveElements(true, true);
+        pEventSink->setConnectDisconnectButton(false);
 
         bTextListen = true;
 
@@ -430,16 +417,43 @@ bool NetworkService::processChatInfo(char* pReadBuffer, int iPacketSize, wchar_t
 
 
 
-    // Receive chat info.
+    // Receive chat info (it may come in parts).
+
+    if (iPacketSize > MAX_TCP_BUFFER_SIZE)
+    {
+        pEventSink->printOutput("NetworkService::processChatInfo(): the chat info is too big ("
+                                + std::to_string(iPacketSize) + " bytes).\n",
+                                SilentMessage(false), true);
+
+        forceStop(pThisUser->sockUserTCP);
+        return true;
+    }
+
+    int iReceivedSize = 0;
+
+    while (iReceivedSize < iPacketSize)
+    {
+        int iResult = recv(pThisUser->sockUserTCP, pReadBuffer + iReceivedSize, iPacketSize - iReceivedSize, 0);
+
+        if (iResult <= 0)
+        {
+            pEventSink->printOutput("NetworkService::processChatInfo()::recv() failed and returned: "
+                                    + std::to_string(WSAGetLastError()) + ".\n",
+                                    SilentMessage(false), true);
+
+            forceStop(pThisUser->sockUserTCP);
+            return true;
+        }
 
-    int iReceivedSize = recv(pThisUser->sockUserTCP, pReadBuffer, iPacketSize, 0);
+        iReceivedSize += iResult;
+    }
 
     // Don't process this data now.
 
-    pMainWindow->printOutput("Connected.\n"
-                             "You are queued to enter the server, first, the server will process everyone who entered before you.\n"
-                             "Waiting to establish a secure connection, please wait...\n",
-                             SilentMessage(false), true);
+    pEventSink->printOutput("Connected.\n"
+                            "You are queued to enter the server, first, the server will process everyone who entered before you.\n"
+                            "Waiting to establish a secure connection, please wait...\n",
+                            SilentMessage(false), true);
 
 
     // Establish a secure connection.
@@ -451,10 +465,10 @@ bool NetworkService::processChatInfo(char* pReadBuffer, int iPacketSize, wchar_t
     }
     else
     {
-        pMainWindow->printOutput("A secure connection has been established, the data transmitted over the network is encrypted.\n"
-                                 "Received " + std::to_string(iReceivedSize + 3) + " bytes of data from the server.\n"
-                                 "Waiting to connect to the text chat...\n",
-                                 SilentMessage(false), true);
+        pEventSink->printOutput("A secure connection has been established, the data transmitted over the network is encrypted.\n"
+                                "Received " + std::to_string(iReceivedSize + 3) + " bytes of data from the server.\n"
+                                "Waiting to connect to the text chat...\n",
+                                SilentMessage(false), true);
     }
 
 
@@ -465,9 +479,9 @@ bool NetworkService::processChatInfo(char* pReadBuffer, int iPacketSize, wchar_t
 
     if ( ioctlsocket(pThisUser->sockUserTCP, static_cast <long> (FIONBIO), &arg) == SOCKET_ERROR )
     {
-        pMainWindow->printOutput("NetworkService::connectTo()::ioctsocket() (non-blocking mode) failed and returned: "
-                                 + std::to_string(WSAGetLastError()) + ".\n",
-                                 SilentMessage(false), true);
+        pEventSink->printOutput("NetworkService::connectTo()::ioctsocket() (non-blocking mode) failed and returned: "
+                                + std::to_string(WSAGetLastError()) + ".\n",
+                                SilentMessage(false), true);
 
         forceStop(pThisUser->sockUserTCP);
         return true;
@@ -475,77 +489,75 @@ bool NetworkService::processChatInfo(char* pReadBuffer, int iPacketSize, wchar_t
 
 
 
-    // Prepare AudioService.
-
-    pAudioService->prepareForStart();
-
-
-
     // Read online info.
 
-    int iReadBytes = 0;
+    TCPFrameCursor chatInfo(pReadBuffer, iPacketSize);
+
     int iOnline    = 1; // '1' for 'this' user.
 
 
-    char roomCount = 0;
-    std::memcpy(&roomCount, pReadBuffer + iReadBytes, 1);
-    iReadBytes++;
+    unsigned char roomCount = 0;
+    bool bDamaged = chatInfo.readU8(roomCount);
 
 
-    for (char i = 0;   i < roomCount;   i++)
+    for (unsigned char i = 0;   (i < roomCount) && (bDamaged == false);   i++)
     {
         std::string  sRoomName   = "";
         std::wstring sRoomPass   = L"";
         unsigned short iMaxUsers = 0;
 
 
-        char roomNameSize = 0;
-        std::memcpy(&roomNameSize, pReadBuffer + iReadBytes, 1);
-        iReadBytes++;
+        unsigned char roomNameSize = 0;
 
         char bufferForNames[MAX_NAME_LENGTH + 1];
         memset(bufferForNames, 0, MAX_NAME_LENGTH + 1);
 
-        std::memcpy(bufferForNames, pReadBuffer + iReadBytes, roomNameSize);
-        iReadBytes += roomNameSize;
+        if ( chatInfo.readU8(roomNameSize) || chatInfo.readString(bufferForNames, sizeof(bufferForNames), roomNameSize)
+             || chatInfo.readU16(iMaxUsers) )
+        {
+            bDamaged = true;
+            break;
+        }
 
         sRoomName = bufferForNames;
 
 
-
-        std::memcpy(&iMaxUsers, pReadBuffer + iReadBytes, 2);
-        iReadBytes += 2;
-
-
         bool bFirstRoom = false;
 
         if (i == 0)
         {
             bFirstRoom = true;
+
+            sWelcomeRoomName = sRoomName;
         }
 
-        pMainWindow->addRoom(sRoomName, sRoomPass, iMaxUsers, bFirstRoom);
+        pEventSink->addRoom(sRoomName, sRoomPass, iMaxUsers, bFirstRoom);
 
 
 
 
         unsigned short iUsersInRoom = 0;
-        std::memcpy(&iUsersInRoom, pReadBuffer + iReadBytes, 2);
-        iReadBytes += 2;
+
+        if ( chatInfo.readU16(iUsersInRoom) )
+        {
+            bDamaged = true;
+            break;
+        }
 
         iOnline += iUsersInRoom;
 
         for (unsigned short j = 0; j < iUsersInRoom; j++)
         {
             unsigned char currentItemSize = 0;
-            std::memcpy(&currentItemSize, pReadBuffer + iReadBytes, 1);
-            iReadBytes++;
 
             char rowText[MAX_NAME_LENGTH + 1];
             memset(rowText, 0, MAX_NAME_LENGTH + 1);
 
-            std::memcpy(rowText, pReadBuffer + iReadBytes, currentItemSize);
-            iReadBytes += currentItemSize;
+            if ( chatInfo.readU8(currentItemSize) || chatInfo.readString(rowText, sizeof(rowText), currentItemSize) )
+            {
+                bDamaged = true;
+                break;
+            }
 
 
 
@@ -553,17 +565,38 @@ bool NetworkService::processChatInfo(char* pReadBuffer, int iPacketSize, wchar_t
 
             std::string sNewUserName = std::string(rowText);
 
-            User* pNewUser = new User( sNewUserName, 0, pMainWindow->addUserToRoomIndex(sNewUserName, i) );
+            if ( pOtherUsers->find(sNewUserName) )
+            {
+                // The names are unique on the server, keep the user we already have.
+                continue;
+            }
+
+            User* pNewUser = new User( sNewUserName, 0, pEventSink->addUserToRoomIndex(sNewUserName, i) );
+            pNewUser->sRoomName = sRoomName;
 
-            vOtherUsers.push_back( pNewUser );
+            pOtherUsers->add( pNewUser );
 
             pAudioService->setupUserAudio( pNewUser );
         }
     }
 
     unsigned short roomMessageSize = 0;
-    std::memcpy(&roomMessageSize, pReadBuffer + iReadBytes, sizeof(roomMessageSize));
-    iReadBytes += sizeof(roomMessageSize);
+
+    const char* pRoomMessage = nullptr;
+
+    if ( (bDamaged == false) && (chatInfo.readU16(roomMessageSize) == false) )
+    {
+        pRoomMessage = chatInfo.readSpan(roomMessageSize);
+    }
+
+    if (pRoomMessage == nullptr)
+    {
+        pEventSink->printOutput("NetworkService::processChatInfo(): the chat info is damaged.\n",
+                                SilentMessage(false), true);
+
+        forceStop(pThisUser->sockUserTCP);
+        return true;
+    }
 
     wchar_t* pRoomMessageString = nullptr;
 
@@ -572,14 +605,15 @@ bool NetworkService::processChatInfo(char* pReadBuffer, int iPacketSize, wchar_t
         pRoomMessageString = new wchar_t [MAX_MESSAGE_LENGTH];
         memset(pRoomMessageString, 0, MAX_MESSAGE_LENGTH * sizeof(wchar_t));
 
-        std::memcpy(pRoomMessageString, pReadBuffer + iReadBytes, roomMessageSize);
-        iReadBytes += roomMessageSize;
+        // Keep the last wchar_t zero.
+        std::memcpy(pRoomMessageString, pRoomMessage,
+                    std::min(static_cast<size_t>(roomMessageSize), (MAX_MESSAGE_LENGTH - 1) * sizeof(wchar_t)));
     }
 
     pWelcomeRoomMessage = pRoomMessageString;
 
 
-    pMainWindow->setOnlineUsersCount(iOnline);
+    pEventSink->setOnlineUsersCount(iOnline);
 
 
     return false;
@@ -610,11 +644,25 @@ bool NetworkService::establishSecureConnection(char* pReadBuffer)
     std::memcpy(&p, vKeyPGBuffer, sizeof(p));
     std::memcpy(&g, vKeyPGBuffer + sizeof(p), sizeof(g));
 
+    if ( (p <= 1) || (g <= 0) )
+    {
+        pEventSink->printOutput("Failed to establish a secure connection (wrong key parameters received).\nTry again.\n",
+                                SilentMessage(false),
+                                true);
+
+        forceStop(pThisUser->sockUserTCP);
+
+        return true;
+    }
+
 
 
     // Calculate the open key B.
+    // p and g are 32 bit values so we don't need the big integers here.
 
-    integer B = pow(integer(g), b) % p;
+    std::string sOpenKeyB = std::to_string( powmod(static_cast<uint64_t>(g),
+                                                   static_cast<uint64_t>(b),
+                                                   static_cast<uint64_t>(p)) );
 
 
 
@@ -641,10 +689,10 @@ bool NetworkService::establishSecureConnection(char* pReadBuffer)
             shutdown(pThisUser->sockUserTCP, SD_SEND);
         }
 
-        pMainWindow->printOutput("\nSomething went wrong on the server side.\n"
-                                  "Try connecting again.",
-                                  SilentMessage(false),
-                                  true);
+        pEventSink->printOutput("\nSomething went wrong on the server side.\n"
+                                 "Try connecting again.",
+                                 SilentMessage(false),
+                                 true);
 
         forceStop(pThisUser->sockUserTCP);
 
@@ -660,16 +708,18 @@ bool NetworkService::establishSecureConnection(char* pReadBuffer)
     recv(pThisUser->sockUserTCP, pOpenKeyString, iStringSize, 0);
 
 
-    integer A(pOpenKeyString, 10);
+    // A may be longer than 64 bits (if the server sends garbage) so it's parsed as the big integer.
+
+    unsigned long long iOpenKeyA = static_cast<uint64_t>( integer(pOpenKeyString, 10) % p );
 
 
     // Prepare to send open key B.
 
-    if (B.str().size() > iMaxKeyLength) // should not happen
+    if (sOpenKeyB.size() > iMaxKeyLength) // should not happen
     {
-        pMainWindow->printOutput("Failed to establish a secure connection (client error).\nTry again.\n",
-                                 SilentMessage(false),
-                                 true);
+        pEventSink->printOutput("Failed to establish a secure connection (client error).\nTry again.\n",
+                                SilentMessage(false),
+                                true);
 
         forceStop(pThisUser->sockUserTCP);
 
@@ -682,34 +732,32 @@ bool NetworkService::establishSecureConnection(char* pReadBuffer)
 
     // Send open key B.
 
-    iStringSize = static_cast<short>(B.str().size());
+    iStringSize = static_cast<short>(sOpenKeyB.size());
 
     memset(pOpenKeyString, 0, sizeof(iStringSize) + iMaxKeyLength + 1);
 
     std::memcpy(pOpenKeyString, &iStringSize, sizeof(iStringSize));
-    std::memcpy(pOpenKeyString + sizeof(iStringSize), B.str().c_str(), B.str().size());
+    std::memcpy(pOpenKeyString + sizeof(iStringSize), sOpenKeyB.c_str(), sOpenKeyB.size());
 
-    send(pThisUser->sockUserTCP, pOpenKeyString, sizeof(iStringSize) + B.str().size(), 0);
+    send(pThisUser->sockUserTCP, pOpenKeyString, sizeof(iStringSize) + sOpenKeyB.size(), 0);
 
 
 
     // Calculate the secret key.
     // Save the key to vSecretAESKey[16] array.
 
-    integer secret = pow(integer(A), b) % p;
+    std::string sSecret = std::to_string( powmod(iOpenKeyA, static_cast<uint64_t>(b), static_cast<uint64_t>(p)) );
 
-    if (secret.str().size() >= 16)
+    if (sSecret.size() >= 16)
     {
         // Save only first 16 numbers.
 
-        std::memcpy(vSecretAESKey, secret.str().c_str(), 16);
+        std::memcpy(vSecretAESKey, sSecret.c_str(), 16);
     }
     else
     {
         // Repeat the key until vSecretAESKey is full.
 
-        std::string sSecret = secret.str();
-
         size_t iFilledCount = 0;
         size_t iCurrentIndex = 0;
 
@@ -733,6 +781,20 @@ bool NetworkService::establishSecureConnection(char* pReadBuffer)
     delete[] pOpenKeyString;
 
 
+    // Expand the key once for the whole session.
+
+    pAES->SetKey(reinterpret_cast<unsigned char*>(vSecretAESKey));
+
+
+    // Voice packets use ECB until the server advertises the authenticated mode (SM_VOICE_FEATURES).
+
+    pVoiceCipher->setEnabled(false);
+    pVoiceCipher->reset();
+    pVoiceCipher->deriveKeys(pAES);
+
+    pVoiceCodec->setCodec(VC_PCM);
+
+
 
     // Sync with the server.
 
@@ -745,9 +807,9 @@ bool NetworkService::establishSecureConnection(char* pReadBuffer)
     char message = 99;
     if (send(pThisUser->sockUserTCP, &message, sizeof(message), 0) <= 0)
     {
-        pMainWindow->printOutput("NetworkService::connectTo()::ioctsocket() (non-blocking mode) failed and returned: "
-                                  + std::to_string(WSAGetLastError()) + ".\n",
-                                  SilentMessage(false), true);
+        pEventSink->printOutput("NetworkService::connectTo()::ioctsocket() (non-blocking mode) failed and returned: "
+                                 + std::to_string(WSAGetLastError()) + ".\n",
+                                 SilentMessage(false), true);
 
         forceStop(pThisUser->sockUserTCP);
         return true;
@@ -756,9 +818,9 @@ bool NetworkService::establishSecureConnection(char* pReadBuffer)
     // Receive "finished connecting" message.
     if (recv(pThisUser->sockUserTCP, &message, sizeof(message), 0) == 0)
     {
-        pMainWindow->printOutput("NetworkService::connectTo()::recv(): "
-                                  "the server waits too long for our response and therefore closes the connection.\n",
-                                  SilentMessage(false), true);
+        pEventSink->printOutput("NetworkService::connectTo()::recv(): "
+                                 "the server waits too long for our response and therefore closes the connection.\n",
+                                 SilentMessage(false), true);
 
         forceStop(pThisUser->sockUserTCP);
         return true;
@@ -770,24 +832,12 @@ bool NetworkService::establishSecureConnection(char* pReadBuffer)
 
 void NetworkService::eraseDisconnectedUser(std::string sUserName, char cDisconnectType)
 {
-    // Find this user in the vOtherUsers vector.
-
-    User*  pDisconnectedUser = nullptr;
-    size_t iUserPosInVector  = 0;
+    // Find this user.
 
     mtxOtherUsers.lock();
 
 
-    for (size_t i = 0;   i < vOtherUsers.size();   i++)
-    {
-        if ( vOtherUsers[i]->sUserName == sUserName )
-        {
-            pDisconnectedUser = vOtherUsers[i];
-            iUserPosInVector  = i;
-
-            break;
-        }
-    }
+    User* pDisconnectedUser = pOtherUsers->find(sUserName);
 
 
     // Delete user from screen, AudioService & play audio sound.
@@ -796,7 +846,7 @@ void NetworkService::eraseDisconnectedUser(std::string sUserName, char cDisconne
     {
         SListItemUser* pItem = pDisconnectedUser->pListWidgetItem;
 
-        if (pItem->getRoom() == pThisUser->pListWidgetItem->getRoom())
+        if (pDisconnectedUser->sRoomName == pThisUser->sRoomName)
         {
             pAudioService->playConnectDisconnectSound(false);
         }
@@ -805,16 +855,16 @@ void NetworkService::eraseDisconnectedUser(std::string sUserName, char cDisconne
         pAudioService->deleteUserAudio(pDisconnectedUser);
 
 
+        pOtherUsers->remove(sUserName);
         delete pDisconnectedUser;
-        vOtherUsers.erase( vOtherUsers.begin() + iUserPosInVector );
 
 
-        pMainWindow->deleteUserFromList(pItem);
+        pEventSink->deleteUserFromList(pItem);
 
 
         if (pSettingsManager->getCurrentSettings()->bShowConnectDisconnectMessage)
         {
-            pMainWindow->showUserDisconnectNotice(sUserName, SilentMessage(true), cDisconnectType);
+            pEventSink->showUserDisconnectNotice(sUserName, SilentMessage(true), cDisconnectType);
         }
     }
 
@@ -848,7 +898,7 @@ void NetworkService::start(std::string address, std::string port, std::string us
 
     // Disable UI.
 
-    pMainWindow->enableInteractiveElements(false, false);
+    pEventSink->enableInteractiveElements(false, false);
 
 
 
@@ -861,9 +911,9 @@ void NetworkService::start(std::string address, std::string port, std::string us
 
     if (returnCode != 0)
     {
-        pMainWindow->printOutput(std::string("NetworkService::start()::WSAStartup() function failed and returned: "
-                                             + std::to_string(WSAGetLastError())
-                                             + ".\nTry again.\n"), SilentMessage(false));
+        pEventSink->printOutput(std::string("NetworkService::start()::WSAStartup() function failed and returned: "
+                                            + std::to_string(WSAGetLastError())
+                                            + ".\nTry again.\n"), SilentMessage(false));
     }
     else
     {
@@ -875,9 +925,9 @@ void NetworkService::start(std::string address, std::string port, std::string us
 
         if (pThisUser->sockUserTCP == INVALID_SOCKET)
         {
-            pMainWindow->printOutput("NetworkService::start()::socket() function failed and returned: "
-                                     + std::to_string(WSAGetLastError())
-                                     + ".\nTry again.\n", SilentMessage(false));
+            pEventSink->printOutput("NetworkService::start()::socket() function failed and returned: "
+                                    + std::to_string(WSAGetLastError())
+                                    + ".\nTry again.\n", SilentMessage(false));
 
             forceStop();
         }
@@ -912,9 +962,9 @@ void NetworkService::connectTo(std::string address, std::string port, std::strin
     INT dResult = getaddrinfo(address.c_str(), port.c_str(), &hints, &result);
     if ( dResult != 0 )
     {
-        pMainWindow->printOutput("NetworkService::connectTo::getaddrinfo() failed. Error code: "
-                                 + std::to_string(WSAGetLastError())
-                                 + ".\n", SilentMessage(false), true);
+        pEventSink->printOutput("NetworkService::connectTo::getaddrinfo() failed. Error code: "
+                                + std::to_string(WSAGetLastError())
+                                + ".\n", SilentMessage(false), true);
 
         forceStop();
 
@@ -930,9 +980,9 @@ void NetworkService::connectTo(std::string address, std::string port, std::strin
 
 
 
-    pMainWindow->printOutput(std::string("Connecting...\n"
-                             "Please wait, the server might be busy if a lot of people is entering the server right now.\n"),
-                             SilentMessage(false), true);
+    pEventSink->printOutput(std::string("Connecting...\n"
+                            "Please wait, the server might be busy if a lot of people is entering the server right now.\n"),
+                            SilentMessage(false), true);
 
 
     // Connect.
@@ -947,27 +997,27 @@ void NetworkService::connectTo(std::string address, std::string port, std::strin
 
         if (returnCode == 10060)
         {
-            pMainWindow->printOutput("Time out.\nTry again.\n",
-                                     SilentMessage(false), true);
+            pEventSink->printOutput("Time out.\nTry again.\n",
+                                    SilentMessage(false), true);
         }
         else if (returnCode == 10061)
         {
-            pMainWindow->printOutput("The server is offline.\n",
-                                     SilentMessage(false), true);
+            pEventSink->printOutput("The server is offline.\n",
+                                    SilentMessage(false), true);
         }
         else if (returnCode == 10051)
         {
-            pMainWindow->printOutput("NetworkService::connectTo()::connect() function failed and returned: "
-                                     + std::to_string(returnCode)
-                                     + ".\nPossible cause: no internet.\nTry again.\n",
-                                     SilentMessage(false), true);
+            pEventSink->printOutput("NetworkService::connectTo()::connect() function failed and returned: "
+                                    + std::to_string(returnCode)
+                                    + ".\nPossible cause: no internet.\nTry again.\n",
+                                    SilentMessage(false), true);
         }
         else
         {
-            pMainWindow->printOutput("NetworkService::connectTo()::connect() function failed and returned: "
-                                     + std::to_string(returnCode)
-                                     + ".\nTry again.\n",
-                                     SilentMessage(false), true);
+            pEventSink->printOutput("NetworkService::connectTo()::connect() function failed and returned: "
+                                    + std::to_string(returnCode)
+                                    + ".\nTry again.\n",
+                                    SilentMessage(false), true);
         }
 
         forceStop();
@@ -986,11 +1036,11 @@ void NetworkService::setupVoiceConnection()
 
     if (pThisUser->sockUserUDP == INVALID_SOCKET)
     {
-        pMainWindow->printOutput( "Cannot start voice connection.\n"
-                                  "NetworkService::setupVoiceConnection::socket() error: "
-                                  + std::to_string(WSAGetLastError()),
-                                  SilentMessage(false),
-                                  true );
+        pEventSink->printOutput( "Cannot start voice connection.\n"
+                                 "NetworkService::setupVoiceConnection::socket() error: "
+                                 + std::to_string(WSAGetLastError()),
+                                 SilentMessage(false),
+                                 true );
         return;
     }
     else
@@ -1002,11 +1052,11 @@ void NetworkService::setupVoiceConnection()
 
         if ( connect( pThisUser->sockUserUDP, reinterpret_cast <sockaddr*> (&pThisUser->addrServer), sizeof(pThisUser->addrServer) ) == SOCKET_ERROR )
         {
-            pMainWindow->printOutput( "Cannot start voice connection.\n"
-                                      "NetworkService::setupVoiceConnection::connect() error: "
-                                      + std::to_string(WSAGetLastError()),
-                                      SilentMessage(false),
-                                      true );
+            pEventSink->printOutput( "Cannot start voice connection.\n"
+                                     "NetworkService::setupVoiceConnection::connect() error: "
+                                     + std::to_string(WSAGetLastError()),
+                                     SilentMessage(false),
+                                     true );
 
             closesocket(pThisUser->sockUserUDP);
 
@@ -1022,11 +1072,11 @@ void NetworkService::setupVoiceConnection()
 
             if ( ioctlsocket(pThisUser->sockUserUDP, static_cast <long> (FIONBIO), &arg) == SOCKET_ERROR )
             {
-                pMainWindow->printOutput( "Cannot start voice connection.\n"
-                                          "NetworkService::setupVoiceConnection::ioctlsocket() error: "
-                                          + std::to_string(WSAGetLastError()),
-                                          SilentMessage(false),
-                                          true );
+                pEventSink->printOutput( "Cannot start voice connection.\n"
+                                         "NetworkService::setupVoiceConnection::ioctlsocket() error: "
+                                         + std::to_string(WSAGetLastError()),
+                                         SilentMessage(false),
+                                         true );
 
                 closesocket(pThisUser->sockUserUDP);
 
@@ -1114,11 +1164,11 @@ bool NetworkService::sendVOIPReadyPacket()
     {
         if (iSentSize == SOCKET_ERROR)
         {
-            pMainWindow->printOutput( "Cannot start voice connection.\n"
-                                      "NetworkService::setupVoiceConnection::sendto() error: "
-                                      + std::to_string(WSAGetLastError()),
-                                      SilentMessage(false),
-                                      true );
+            pEventSink->printOutput( "Cannot start voice connection.\n"
+                                     "NetworkService::setupVoiceConnection::sendto() error: "
+                                     + std::to_string(WSAGetLastError()),
+                                     SilentMessage(false),
+                                     true );
 
             closesocket(pThisUser->sockUserUDP);
 
@@ -1126,11 +1176,11 @@ bool NetworkService::sendVOIPReadyPacket()
         }
         else
         {
-            pMainWindow->printOutput( "Cannot start voice connection.\n"
-                                      "NetworkService::setupVoiceConnection::sendto() sent only: "
-                                      + std::to_string(iSentSize) + " out of "
-                                      + std::to_string(sizeof(firstMessage[0]) * 2 + pThisUser->sUserName.size()),
-                                      SilentMessage(false), true );
+            pEventSink->printOutput( "Cannot start voice connection.\n"
+                                     "NetworkService::setupVoiceConnection::sendto() sent only: "
+                                     + std::to_string(iSentSize) + " out of "
+                                     + std::to_string(sizeof(firstMessage[0]) * 2 + pThisUser->sUserName.size()),
+                                     SilentMessage(false), true );
 
             closesocket(pThisUser->sockUserUDP);
 
@@ -1143,179 +1193,223 @@ bool NetworkService::sendVOIPReadyPacket()
 
 void NetworkService::listenTCPFromServer()
 {
-    char readBuffer[1];
+    pTCPReader->reset();
+
+
+    // Sleep until the server sends something instead of polling the socket.
+
+    bool bEventDriven = ( pTCPReactor->attach(pThisUser->sockUserTCP) == false );
+
+    if (bEventDriven == false)
+    {
+        pEventSink->printOutput("NetworkService::listenTCPFromServer()::WSAEventSelect() failed and returned: "
+                                + std::to_string(WSAGetLastError()) + ".\n"
+                                "Falling back to polling the socket.\n",
+                                SilentMessage(false), true);
+    }
+
 
     while(bTextListen)
     {
-        while ( bTextListen && ( recv(pThisUser->sockUserTCP, readBuffer, 0, 0) == 0 ) )
+        mtxTCPRead.lock();
+
+
+        // Read everything that came (in one call) and process whole messages.
+        // The rest of the last message (if it came partially) will be read on the next iteration.
+
+        int iReceivedAmount = pTCPReader->receive(pThisUser->sockUserTCP);
+
+        TCPFrameCursor frame;
+
+        while ( bTextListen && pTCPReader->getFrame(frame) )
         {
-            // There are some data to read.
+            processTCPMessage(frame);
 
-            mtxTCPRead.lock();
+            pTCPReader->popFrame();
 
-            // There are some data to receive.
-            int receivedAmount = recv(pThisUser->sockUserTCP, readBuffer, 1, 0);
-            if (receivedAmount == 0)
-            {
-                // Server sent FIN.
+            lastTimeServerKeepAliveCame = clock();
+        }
 
-                answerToFIN();
-            }
-            else
-            {
-                switch(readBuffer[0])
-                {
-                case(SM_NEW_USER):
-                {
-                    // We received info about the new user.
+        if (bTextListen && (iReceivedAmount == 0))
+        {
+            // Server sent FIN.
 
-                    receiveInfoAboutNewUser();
+            answerToFIN();
+        }
 
-                    break;
-                }
-                case(SM_SOMEONE_DISCONNECTED):
-                {
-                    // Someone disconnected.
 
-                    deleteDisconnectedUserFromList();
+        mtxTCPRead.unlock();
 
-                    break;
-                }
-                case(SM_CAN_START_UDP):
-                {
-                    std::thread listenVoiceThread (&NetworkService::listenUDPFromServer, this);
-                    listenVoiceThread.detach();
 
-                    break;
-                }
-                case(SM_SPAM_NOTICE):
-                {
-                    pMainWindow->showMessageBox(true, "You can't send messages that quick.");
+        if (bTextListen == false)
+        {
+            break;
+        }
 
-                    break;
-                }
-                case(SM_PING):
-                {
-                    // It's ping info.
-                    receivePing();
+        // Wait for more.
+        // disconnect() and lostConnection() wake us up.
 
-                    break;
-                }
-                case(SM_KEEPALIVE):
-                {
-                    // This is keep-alive message.
-                    // We've been idle for INTERVAL_KEEPALIVE_SEC seconds.
-                    // We should answer in 10 seconds or we will be disconnected.
+        pTCPReactor->wait( bEventDriven ? SOCKET_REACTOR_INFINITE : INTERVAL_TCP_MESSAGE_MS );
+    }
+}
 
-                    char keepAliveChar = 9;
-                    send(pThisUser->sockUserTCP, &keepAliveChar, 1, 0);
+void NetworkService::processTCPMessage(TCPFrameCursor& frame)
+{
+    unsigned char cMessageType = 0;
+    frame.readU8(cMessageType);
 
-                    break;
-                }
-                case(SM_USERMESSAGE):
-                {
-                    // It's a text message.
-                    receiveMessage();
+    switch(cMessageType)
+    {
+    case(SM_NEW_USER):
+    {
+        // We received info about the new user.
 
-                    break;
-                }
-                case(SM_KICKED):
-                {
-                    // We were kicked.
-                    pMainWindow->printOutput("You were kicked by the server.", SilentMessage(false), true);
+        receiveInfoAboutNewUser(frame);
 
-                    // Next message will be FIN.
-                    break;
-                }
-                case(SM_WRONG_PASSWORD_WAIT):
-                {
-                    pMainWindow->showMessageBox(true, "You must wait a few seconds after each incorrect password entry.");
+        break;
+    }
+    case(SM_SOMEONE_DISCONNECTED):
+    {
+        // Someone disconnected.
 
-                    break;
-                }
-                case(SM_GLOBAL_MESSAGE):
-                {
-                    receiveServerMessage();
+        deleteDisconnectedUserFromList(frame);
 
-                    break;
-                }
-                case(RC_CAN_ENTER_ROOM):
-                {
-                    canMoveToRoom();
+        break;
+    }
+    case(SM_CAN_START_UDP):
+    {
+        std::thread listenVoiceThread (&NetworkService::listenUDPFromServer, this);
+        listenVoiceThread.detach();
 
-                    break;
-                }
-                case(RC_USER_ENTERS_ROOM):
-                {
-                    userEntersRoom();
+        break;
+    }
+    case(SM_SPAM_NOTICE):
+    {
+        pEventSink->showMessageBox(true, "You can't send messages that quick.");
 
-                    break;
-                }
-                case(RC_ROOM_IS_FULL):
-                {
-                    pMainWindow->showMessageBox(true, "The room is full.");
+        break;
+    }
+    case(SM_PING):
+    {
+        // It's ping info.
+        receivePing(frame);
 
-                    break;
-                }
-                case(RC_PASSWORD_REQ):
-                {
-                    char cRoomNameSize = 0;
+        break;
+    }
+    case(SM_KEEPALIVE):
+    {
+        // This is keep-alive message.
+        // We've been idle for INTERVAL_KEEPALIVE_SEC seconds.
+        // We should answer in 10 seconds or we will be disconnected.
 
-                    recv(pThisUser->sockUserTCP, &cRoomNameSize, 1, 0);
+        char keepAliveChar = 9;
+        send(pThisUser->sockUserTCP, &keepAliveChar, 1, 0);
 
-                    char vNameBuffer[MAX_NAME_LENGTH + 1];
-                    memset(vNameBuffer, 0, MAX_NAME_LENGTH + 1);
+        break;
+    }
+    case(SM_USERMESSAGE):
+    {
+        // It's a text message.
+        receiveMessage(frame);
 
-                    recv(pThisUser->sockUserTCP, vNameBuffer, cRoomNameSize, 0);
+        break;
+    }
+    case(SM_KICKED):
+    {
+        // We were kicked.
+        pEventSink->printOutput("You were kicked by the server.", SilentMessage(false), true);
 
-                    pMainWindow->showPasswordInputWindow(vNameBuffer);
+        // Next message will be FIN.
+        break;
+    }
+    case(SM_WRONG_PASSWORD_WAIT):
+    {
+        pEventSink->showMessageBox(true, "You must wait a few seconds after each incorrect password entry.");
 
-                    break;
-                }
-                case(RC_WRONG_PASSWORD):
-                {
-                    pMainWindow->showMessageBox(true, "Wrong password.");
+        break;
+    }
+    case(SM_GLOBAL_MESSAGE):
+    {
+        receiveServerMessage(frame);
 
-                    break;
-                }
-                case(RC_SERVER_MOVED_ROOM):
-                {
-                    serverMovedRoom();
+        break;
+    }
+    case(SM_VOICE_FEATURES):
+    {
+        receiveVoiceFeatures(frame);
 
-                    break;
-                }
-                case(RC_SERVER_DELETES_ROOM):
-                {
-                    serverDeletesRoom();
+        break;
+    }
+    case(SM_SPEAKER_IDS):
+    {
+        receiveSpeakerIds(frame);
 
-                    break;
-                }
-                case(RC_SERVER_CREATES_ROOM):
-                {
-                    serverCreatesRoom();
+        break;
+    }
+    case(RC_CAN_ENTER_ROOM):
+    {
+        canMoveToRoom(frame);
 
-                    break;
-                }
-                case(RC_SERVER_CHANGES_ROOM):
-                {
-                    serverChangesRoom();
+        break;
+    }
+    case(RC_USER_ENTERS_ROOM):
+    {
+        userEntersRoom(frame);
 
-                    break;
-                }
-                }
+        break;
+    }
+    case(RC_ROOM_IS_FULL):
+    {
+        pEventSink->showMessageBox(true, "The room is full.");
 
-                lastTimeServerKeepAliveCame = clock();
-            }
+        break;
+    }
+    case(RC_PASSWORD_REQ):
+    {
+        unsigned char cRoomNameSize = 0;
 
-            mtxTCPRead.unlock();
-        }
+        char vNameBuffer[MAX_NAME_LENGTH + 1];
+        memset(vNameBuffer, 0, MAX_NAME_LENGTH + 1);
 
-        if (bTextListen == false)
+        if ( frame.readU8(cRoomNameSize) || frame.readString(vNameBuffer, sizeof(vNameBuffer), cRoomNameSize) )
         {
             break;
         }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(INTERVAL_TCP_MESSAGE_MS));
+        pEventSink->showPasswordInputWindow(vNameBuffer);
+
+        break;
+    }
+    case(RC_WRONG_PASSWORD):
+    {
+        pEventSink->showMessageBox(true, "Wrong password.");
+
+        break;
+    }
+    case(RC_SERVER_MOVED_ROOM):
+    {
+        serverMovedRoom(frame);
+
+        break;
+    }
+    case(RC_SERVER_DELETES_ROOM):
+    {
+        serverDeletesRoom(frame);
+
+        break;
+    }
+    case(RC_SERVER_CREATES_ROOM):
+    {
+        serverCreatesRoom(frame);
+
+        break;
+    }
+    case(RC_SERVER_CHANGES_ROOM):
+    {
+        serverChangesRoom(frame);
+
+        break;
+    }
     }
 }
 
@@ -1325,16 +1419,16 @@ void NetworkService::listenUDPFromServer()
 
     if ( pAudioService->start() )
     {
-        pMainWindow->printOutput( "Connected to the voice chat.\n",
-                                  SilentMessage(false),
-                                  true );
+        pEventSink->printOutput( "Connected to the voice chat.\n",
+                                 SilentMessage(false),
+                                 true );
         bVoiceListen = true;
     }
     else
     {
-        pMainWindow->printOutput( "An error occurred while starting the voice chat.\n",
-                                  SilentMessage(false),
-                                  true );
+        pEventSink->printOutput( "An error occurred while starting the voice chat.\n",
+                                 SilentMessage(false),
+                                 true );
         return;
     }
 
@@ -1348,11 +1442,11 @@ void NetworkService::listenUDPFromServer()
     int iReturnCode = getsockopt(pThisUser->sockUserUDP, SOL_SOCKET, SO_SNDBUF, reinterpret_cast <char*> (&iOptVal), &iOptLen);
     if (iReturnCode == SOCKET_ERROR)
     {
-        pMainWindow->printOutput("NetworkService::listenUDPFromServer()::getsockopt (increase the send buffer size by 2) failed: "
-                                 + std::to_string(WSAGetLastError())
-                                 + ".\nSkipping this step.\n",
-                                 SilentMessage(false),
-                                 true);
+        pEventSink->printOutput("NetworkService::listenUDPFromServer()::getsockopt (increase the send buffer size by 2) failed: "
+                                + std::to_string(WSAGetLastError())
+                                + ".\nSkipping this step.\n",
+                                SilentMessage(false),
+                                true);
     }
     else
     {
@@ -1361,11 +1455,11 @@ void NetworkService::listenUDPFromServer()
         iReturnCode = setsockopt(pThisUser->sockUserUDP, SOL_SOCKET, SO_SNDBUF, reinterpret_cast <char*> (&iOptVal), iOptLen);
         if (iReturnCode == SOCKET_ERROR)
         {
-            pMainWindow->printOutput("NetworkService::listenUDPFromServer()::setsockopt (increase the send buffer size by 2) failed: "
-                                     + std::to_string(WSAGetLastError())
-                                     + ".\nSkipping this step.\n",
-                                     SilentMessage(false),
-                                     true);
+            pEventSink->printOutput("NetworkService::listenUDPFromServer()::setsockopt (increase the send buffer size by 2) failed: "
+                                    + std::to_string(WSAGetLastError())
+                                    + ".\nSkipping this step.\n",
+                                    SilentMessage(false),
+                                    true);
         }
     }
 
@@ -1376,146 +1470,166 @@ void NetworkService::listenUDPFromServer()
     int iSendSize = send(pThisUser->sockUserUDP, &cReadyForPing, sizeof(cReadyForPing), 0);
     if (iSendSize != sizeof(cReadyForPing))
     {
-        pMainWindow->printOutput( "\nWARNING:\nNetworkService::listenUDPFromServer::sendto() (READY packet) failed and returned: "
-                                   + std::to_string(WSAGetLastError()) + ".\n",
-                                   SilentMessage(false),
-                                   true);
+        pEventSink->printOutput( "\nWARNING:\nNetworkService::listenUDPFromServer::sendto() (READY packet) failed and returned: "
+                                  + std::to_string(WSAGetLastError()) + ".\n",
+                                  SilentMessage(false),
+                                  true);
     }
 
 
     // Listen to the server.
+    // Sleep until datagrams come instead of polling the socket, then handle everything that came at once.
+
+    bool bEventDriven = ( pUDPReactor->attach(pThisUser->sockUserUDP) == false );
+
+    if (bEventDriven == false)
+    {
+        pEventSink->printOutput("NetworkService::listenUDPFromServer()::WSAEventSelect() failed and returned: "
+                                + std::to_string(WSAGetLastError()) + ".\n"
+                                "Falling back to polling the socket.\n",
+                                SilentMessage(false), true);
+    }
 
-    char readBuffer[MAX_BUFFER_SIZE + 60];
 
     while (bVoiceListen)
     {
-        int iSize = recv(pThisUser->sockUserUDP, readBuffer, MAX_BUFFER_SIZE + 60, 0);
+        size_t iDatagramCount = pUDPBatch->receive(pThisUser->sockUserUDP);
 
-        while (iSize > 0)
+        if (iDatagramCount > 0)
         {
+            udpBatchReceiveTime = VoiceClock::now();
+
             mtxUDPRead.lock();
 
-            if ( (readBuffer[0] == UDP_SM_PING || readBuffer[0] == UDP_SM_FIRST_PING) && (bVoiceListen) )
+            for (size_t i = 0; (i < iDatagramCount) && bVoiceListen; i++)
             {
-                // it's ping check
-                int iSentSize = send(pThisUser->sockUserUDP, readBuffer, iSize, 0);
-                if (iSentSize != iSize)
-                {
-                    if (iSize == SOCKET_ERROR)
-                    {
-                        pMainWindow->printOutput( "\nWARNING:\nNetworkService::listenUDPFromServer::sendto() failed and returned: "
-                                                   + std::to_string(WSAGetLastError()) + ".\n",
-                                                   SilentMessage(false),
-                                                   true);
-                    }
-                    else
-                    {
-                        pMainWindow->printOutput( "\nWARNING:\nSomething went wrong and your ping check wasn't sent fully.\n",
-                                                   SilentMessage(false),
-                                                   true);
-                    }
-                }
-            }
-            else if (bVoiceListen)
-            {
-                // Copy user name.
-                char userNameBuffer[MAX_NAME_LENGTH + 1];
-                memset(userNameBuffer, 0, MAX_NAME_LENGTH + 1);
-
-                std::memcpy(userNameBuffer, readBuffer + 1, static_cast <size_t> (readBuffer[0]));
-
-                if ( readBuffer[ 1 + readBuffer[0] ] == VM_LAST_MESSAGE )
-                {
-                    // Last audio packet.
-
-                    std::thread lastVoiceThread(&AudioService::playAudioData, pAudioService, nullptr,
-                                                std::string(userNameBuffer), true);
-                    lastVoiceThread.detach();
-                }
-                else
-                {
-                    // Not the last audio packet.
-
-
-                    // Decrypt message.
-
-                    unsigned short iEncryptedMessageSize = 0;
-
-                    int iCurrentReadIndex = 1 + readBuffer[0] + 1;
-
-                    std::memcpy(&iEncryptedMessageSize, readBuffer + iCurrentReadIndex, sizeof(iEncryptedMessageSize));
-                    iCurrentReadIndex += sizeof(iEncryptedMessageSize);
+                int   iSize     = 0;
+                char* pDatagram = pUDPBatch->getDatagram(i, iSize);
 
+                processUDPDatagram(pDatagram, iSize);
+            }
 
-                    char* pEncryptedMessageBytes = new char[iEncryptedMessageSize];
-                    memset(pEncryptedMessageBytes, 0, iEncryptedMessageSize);
+            mtxUDPRead.unlock();
+        }
 
-                    std::memcpy(pEncryptedMessageBytes, readBuffer + iCurrentReadIndex, iEncryptedMessageSize);
 
-                    unsigned char* pDecryptedMessageBytes = pAES->DecryptECB(reinterpret_cast<unsigned char*>(pEncryptedMessageBytes), iEncryptedMessageSize,
-                                                                             reinterpret_cast<unsigned char*>(vSecretAESKey));
+        if (bVoiceListen == false)
+        {
+            break;
+        }
 
 
-                    short int* pAudio = new short int[ static_cast<size_t>(pAudioService->getAudioPacketSizeInSamples()) ];
-                    std::memcpy( pAudio, pDecryptedMessageBytes, static_cast<size_t>(pAudioService->getAudioPacketSizeInSamples()) * 2 );
+        if (iDatagramCount < DATAGRAM_BATCH_MAX_COUNT)
+        {
+            // The socket is drained, wait for more.
+            // disconnect(), lostConnection() and answerToFIN() wake us up.
 
-                    std::thread voiceThread(&AudioService::playAudioData, pAudioService, pAudio,
-                                            std::string(userNameBuffer), false);
-                    voiceThread.detach();
+            pUDPReactor->wait( bEventDriven ? SOCKET_REACTOR_INFINITE : INTERVAL_UDP_MESSAGE_MS );
+        }
+    }
 
-                    delete[] pEncryptedMessageBytes;
-                    delete[] pDecryptedMessageBytes;
-                }
-            }
 
-            mtxUDPRead.unlock();
+    pUDPReactor->detach();
+}
 
-            if (bVoiceListen)
+void NetworkService::processUDPDatagram(char *pDatagram, int iSize)
+{
+    if ( (pDatagram[0] == UDP_SM_PING) || (pDatagram[0] == UDP_SM_FIRST_PING) )
+    {
+        // it's ping check
+        int iSentSize = send(pThisUser->sockUserUDP, pDatagram, iSize, 0);
+        if (iSentSize != iSize)
+        {
+            if (iSentSize == SOCKET_ERROR)
             {
-                iSize = recv(pThisUser->sockUserUDP, readBuffer, MAX_BUFFER_SIZE, 0);
+                pEventSink->printOutput( "\nWARNING:\nNetworkService::listenUDPFromServer::sendto() failed and returned: "
+                                          + std::to_string(WSAGetLastError()) + ".\n",
+                                          SilentMessage(false),
+                                          true);
             }
             else
             {
-                return;
+                pEventSink->printOutput( "\nWARNING:\nSomething went wrong and your ping check wasn't sent fully.\n",
+                                          SilentMessage(false),
+                                          true);
             }
         }
+    }
+    else
+    {
+        receiveVoicePacket(pDatagram, iSize);
+    }
+}
 
+void NetworkService::receiveVoicePacket(char *pPacket, int iPacketSize)
+{
+    unsigned char vDecrypted[VOICE_DATAGRAM_MAX_SIZE];
 
-        if (bVoiceListen)
-        {
-            std::this_thread::sleep_for(std::chrono::milliseconds(INTERVAL_UDP_MESSAGE_MS));
-        }
-        else
+    VoiceDatagramContent packet;
+
+    if ( VoiceDatagram::openServerPacket(reinterpret_cast<unsigned char*>(pPacket), static_cast<size_t>(iPacketSize),
+                                         static_cast<size_t>(pAudioService->getAudioPacketSizeInSamples()),
+                                         pVoiceCipher, pAES, vDecrypted, packet) )
+    {
+        // Damaged, forged or replayed packet, it never reaches the AudioService.
+        return;
+    }
+
+
+    if (packet.bLast)
+    {
+        pAudioService->playAudioData(nullptr, packet.iSpeakerId, packet.iSpeakerSequence, packet.sUserName, true);
+    }
+    else
+    {
+        short int* pAudio = decodeVoicePayload(packet.codec, packet.pPayload, packet.iPayloadSize);
+
+        if (pAudio)
         {
-            return;
+            // Only queues the packet, the AudioService's playback thread will play it.
+            pAudioService->playAudioData(pAudio, packet.iSpeakerId, packet.iSpeakerSequence, packet.sUserName, false);
+
+            pAudioService->getVoicePathStats()->recordSince(VPS_RECEIVE, udpBatchReceiveTime);
         }
     }
 }
 
-void NetworkService::receiveInfoAboutNewUser()
+short int* NetworkService::decodeVoicePayload(VOICE_CODEC codec, const unsigned char* pPayload, size_t iPayloadSize)
 {
-    // Prepare buffer.
+    size_t iSampleCount = static_cast<size_t>(pAudioService->getAudioPacketSizeInSamples());
 
-    char readBuffer[MAX_NAME_LENGTH + 11];
-    memset(readBuffer, 0, MAX_NAME_LENGTH + 11);
+    short int* pAudio = new short int[iSampleCount];
 
+    if ( VoiceCodec::decode(codec, pPayload, iPayloadSize, pAudio, iSampleCount) )
+    {
+        delete[] pAudio;
 
+        return nullptr;
+    }
 
+    return pAudio;
+}
 
-    // Read packet size.
+void NetworkService::receiveInfoAboutNewUser(TCPFrameCursor& frame)
+{
+    // Read packet: new online count (4 bytes), 1 byte, user name.
 
     unsigned char iPacketSize = 0;
-    recv(pThisUser->sockUserTCP, readBuffer, 1, 0);
-    std::memcpy(&iPacketSize, readBuffer, 1);
-
+    frame.readU8(iPacketSize);
 
+    const char* pPacket = frame.readSpan(iPacketSize);
 
+    if ( (pPacket == nullptr) || (iPacketSize < 5) )
+    {
+        return;
+    }
 
-    // Read new online count.
-
-    recv(pThisUser->sockUserTCP, readBuffer, iPacketSize, 0);
     int iOnline = 0;
-    std::memcpy(&iOnline, readBuffer, 4);
+    std::memcpy(&iOnline, pPacket, 4);
+
+    char vUserName[MAX_NAME_LENGTH + 1];
+    memset(vUserName, 0, MAX_NAME_LENGTH + 1);
+    std::memcpy(vUserName, pPacket + 5, std::min(static_cast<size_t>(iPacketSize - 5), static_cast<size_t>(MAX_NAME_LENGTH)));
 
 
 
@@ -1524,7 +1638,7 @@ void NetworkService::receiveInfoAboutNewUser()
 
     // Show on screen.
 
-    pMainWindow->setOnlineUsersCount (iOnline);
+    pEventSink->setOnlineUsersCount (iOnline);
 
 
 
@@ -1532,18 +1646,28 @@ void NetworkService::receiveInfoAboutNewUser()
 
     // Add new user.
 
-    std::string sNewUserName = std::string(readBuffer + 5);
+    std::string sNewUserName = std::string(vUserName);
 
-    User* pNewUser = new User( sNewUserName, 0, pMainWindow->addNewUserToList(sNewUserName) );
+    if ( pOtherUsers->find(sNewUserName) )
+    {
+        // The names are unique on the server, keep the user we already have.
+
+        mtxOtherUsers.unlock();
+
+        return;
+    }
+
+    User* pNewUser = new User( sNewUserName, 0, pEventSink->addNewUserToList(sNewUserName) );
+    pNewUser->sRoomName = sWelcomeRoomName;
 
     pAudioService->setupUserAudio( pNewUser );
 
-    if (pThisUser->pListWidgetItem->getRoom()->getIsWelcomeRoom())
+    if (pThisUser->sRoomName == sWelcomeRoomName)
     {
         pAudioService->playConnectDisconnectSound(true);
     }
 
-    vOtherUsers.push_back( pNewUser );
+    pOtherUsers->add( pNewUser );
 
 
 
@@ -1555,26 +1679,25 @@ void NetworkService::receiveInfoAboutNewUser()
 
     if (pSettingsManager->getCurrentSettings()->bShowConnectDisconnectMessage)
     {
-        pMainWindow->showUserConnectNotice(std::string(readBuffer + 5), SilentMessage(true));
+        pEventSink->showUserConnectNotice(sNewUserName, SilentMessage(true));
     }
 }
 
-void NetworkService::receiveMessage()
+void NetworkService::receiveMessage(TCPFrameCursor& frame)
 {
-    // Read packet size
+    // Read packet.
 
     unsigned short int iPacketSize = 0;
-    recv(pThisUser->sockUserTCP, reinterpret_cast<char*>(&iPacketSize), 2, 0);
-
-    char* pReadBuffer = new char[iPacketSize + 2];
-    memset(pReadBuffer, 0, iPacketSize + 2);
+    frame.readU16(iPacketSize);
 
+    const char* pReadBuffer = frame.readSpan(iPacketSize);
 
+    if (pReadBuffer == nullptr)
+    {
+        return;
+    }
 
-
-    // Receive message
-
-    int receivedAmount = recv(pThisUser->sockUserTCP, pReadBuffer, iPacketSize, 0);
+    int receivedAmount = iPacketSize;
 
     // Message structure: "Hour:Minute. UserName: Message (message in wchar_t)".
 
@@ -1595,6 +1718,12 @@ void NetworkService::receiveMessage()
         }
     }
 
+    if ( (iMessagePos > MAX_NAME_LENGTH + 10) || (iMessagePos + static_cast<int>(sizeof(unsigned short)) > receivedAmount) )
+    {
+        // Damaged message.
+        return;
+    }
+
     // Copy time info to 'timeText'.
     // timeText = time info + user name
     // Max user name size = 20 + ~ max 7 chars before user name
@@ -1608,23 +1737,28 @@ void NetworkService::receiveMessage()
     unsigned short iEncryptedMessageSize = 0;
     std::memcpy(&iEncryptedMessageSize, pReadBuffer + iMessagePos, sizeof(iEncryptedMessageSize));
 
+    if (iMessagePos + static_cast<int>(sizeof(iEncryptedMessageSize)) + iEncryptedMessageSize > receivedAmount)
+    {
+        // Damaged message.
+        return;
+    }
 
-    // Decrypt message.
 
-    char* pEncryptedMessageBytes = new char[iEncryptedMessageSize + 2];
-    memset(pEncryptedMessageBytes, 0, iEncryptedMessageSize + 2);
+    // Decrypt message.
 
-    std::memcpy(pEncryptedMessageBytes, pReadBuffer + iMessagePos + sizeof(iEncryptedMessageSize), iEncryptedMessageSize);
+    unsigned char* pDecryptedMessageBytes = new unsigned char[iEncryptedMessageSize + 2];
+    memset(pDecryptedMessageBytes, 0, iEncryptedMessageSize + 2);
 
-    unsigned char* pDecryptedMessageBytes = pAES->DecryptECB(reinterpret_cast<unsigned char*>(pEncryptedMessageBytes), iEncryptedMessageSize,
-                                                             reinterpret_cast<unsigned char*>(vSecretAESKey));
+    // (AES does not take const input but does not change it.)
+    pAES->DecryptECBWithSetKey(reinterpret_cast<unsigned char*>(const_cast<char*>(pReadBuffer + iMessagePos + sizeof(iEncryptedMessageSize))),
+                               iEncryptedMessageSize, pDecryptedMessageBytes);
 
 
 
     // Show data on screen & play audio sound.
 
-    pMainWindow->printUserMessage    (std::string(timeText),
-                                     std::wstring(reinterpret_cast<wchar_t*>(pDecryptedMessageBytes)), SilentMessage(true), true);
+    pEventSink->printUserMessage    (std::string(timeText),
+                                    std::wstring(reinterpret_cast<wchar_t*>(pDecryptedMessageBytes)), SilentMessage(true), true);
 
     pAudioService->playNewMessageSound ();
 
@@ -1632,90 +1766,85 @@ void NetworkService::receiveMessage()
 
     // Clear buffers.
 
-    delete[] pReadBuffer;
-    delete[] pEncryptedMessageBytes;
     delete[] pDecryptedMessageBytes;
 }
 
-void NetworkService::deleteDisconnectedUserFromList()
+void NetworkService::deleteDisconnectedUserFromList(TCPFrameCursor& frame)
 {
-    // Prepare buffer.
-
-    char readBuffer[MAX_NAME_LENGTH + 15];
-    memset(readBuffer, 0, MAX_NAME_LENGTH + 15);
-
-
-
-
     // Read disconnect type (lost or closed connection).
 
-    char iDisconnectType = 0;
-    recv(pThisUser->sockUserTCP, &iDisconnectType, 1, 0);
+    unsigned char iDisconnectType = 0;
+    frame.readU8(iDisconnectType);
 
 
 
 
-    // Read packet size
+    // Read packet: new online count (4 bytes), user name.
 
-    recv(pThisUser->sockUserTCP, readBuffer, 1, 0);
     unsigned char iPacketSize = 0;
-    std::memcpy(&iPacketSize, readBuffer, 1);
-
-
+    frame.readU8(iPacketSize);
 
+    const char* pPacket = frame.readSpan(iPacketSize);
 
-    // Read new online count
+    if ( (pPacket == nullptr) || (iPacketSize < 4) )
+    {
+        return;
+    }
 
-    recv(pThisUser->sockUserTCP, readBuffer, iPacketSize, 0);
     int iOnline = 0;
 
-    std::memcpy(&iOnline, readBuffer, 4);
+    std::memcpy(&iOnline, pPacket, 4);
 
-    pMainWindow->setOnlineUsersCount (iOnline);
+    pEventSink->setOnlineUsersCount (iOnline);
 
 
 
+    char vUserName[MAX_NAME_LENGTH + 1];
+    memset(vUserName, 0, MAX_NAME_LENGTH + 1);
+    std::memcpy(vUserName, pPacket + 4, std::min(static_cast<size_t>(iPacketSize - 4), static_cast<size_t>(MAX_NAME_LENGTH)));
 
-    std::string sDisconnectedUserName = std::string(readBuffer + 4);
+    std::string sDisconnectedUserName = std::string(vUserName);
 
-    std::thread tEraseDisconnectedUser (&NetworkService::eraseDisconnectedUser, this, sDisconnectedUserName, iDisconnectType);
+    std::thread tEraseDisconnectedUser (&NetworkService::eraseDisconnectedUser, this, sDisconnectedUserName, static_cast<char>(iDisconnectType));
     tEraseDisconnectedUser.detach();
 }
 
-void NetworkService::receivePing()
+void NetworkService::receivePing(TCPFrameCursor& frame)
 {
-    // Read packet size.
+    // Read packet.
 
     unsigned short iPacketSize = 0;
-    unsigned short iCurrentPos = 0;
+    frame.readU16(iPacketSize);
 
-    recv(pThisUser->sockUserTCP, reinterpret_cast<char*>(&iPacketSize), sizeof(unsigned short), 0);
+    const char* pPacket = frame.readSpan(iPacketSize);
 
-    do
+    if (pPacket == nullptr)
     {
-        // Read username size.
-
-        char nameSize = 0;
-        recv(pThisUser->sockUserTCP, &nameSize, 1, 0);
-        iCurrentPos++;
+        return;
+    }
 
+    TCPFrameCursor packet(pPacket, iPacketSize);
 
+    while (packet.getRemaining() > 0)
+    {
+        // Read username.
 
-        // Read name.
+        unsigned char nameSize = 0;
 
         char nameBuffer[MAX_NAME_LENGTH + 1];
         memset(nameBuffer, 0, MAX_NAME_LENGTH + 1);
 
-        recv(pThisUser->sockUserTCP, nameBuffer, nameSize, 0);
-        iCurrentPos += nameSize;
-
 
 
         // Read ping.
 
         unsigned short ping = 0;
-        recv(pThisUser->sockUserTCP, reinterpret_cast<char*>(&ping), sizeof(unsigned short), 0);
-        iCurrentPos += sizeof(unsigned short);
+
+        if ( packet.readU8(nameSize) || packet.readString(nameBuffer, sizeof(nameBuffer), nameSize) || packet.readU16(ping) )
+        {
+            // Damaged packet.
+            break;
+        }
 
 
 
@@ -1732,15 +1861,7 @@ void NetworkService::receivePing()
         }
         else
         {
-            for (size_t i = 0;   i < vOtherUsers.size();   i++)
-            {
-                if (vOtherUsers[i]->sUserName == sUserName)
-                {
-                    pUser = vOtherUsers[i];
-
-                    break;
-                }
-            }
+            pUser = pOtherUsers->find(sUserName);
         }
 
 
@@ -1753,32 +1874,98 @@ void NetworkService::receivePing()
 
             pUser->iPing = ping;
 
-            pMainWindow->setPingAndTalkingToUser(pUser->pListWidgetItem, pUser->iPing, pUser->bTalking);
+            pEventSink->setPingAndTalkingToUser(pUser->pListWidgetItem, pUser->iPing, pUser->bTalking);
         }
-
-    }while(iCurrentPos < iPacketSize);
+    }
 }
 
-void NetworkService::receiveServerMessage()
+void NetworkService::receiveServerMessage(TCPFrameCursor& frame)
 {
     unsigned short int iMessageSize = 0;
-    recv(pThisUser->sockUserTCP, reinterpret_cast<char*>(&iMessageSize), sizeof(unsigned short), 0);
 
     char vMessageBuffer[MAX_BUFFER_SIZE];
     memset(vMessageBuffer, 0, MAX_BUFFER_SIZE);
 
-    recv(pThisUser->sockUserTCP, vMessageBuffer, iMessageSize, 0);
+    if ( frame.readU16(iMessageSize) || frame.readString(vMessageBuffer, MAX_BUFFER_SIZE, iMessageSize) )
+    {
+        return;
+    }
 
 
-    pMainWindow->showServerMessage(vMessageBuffer);
+    pEventSink->showServerMessage(vMessageBuffer);
     pAudioService->playServerMessageSound();
 }
 
+void NetworkService::receiveVoiceFeatures(TCPFrameCursor& frame)
+{
+    unsigned char cFeatures = 0;
+    frame.readU8(cFeatures);
+
+    unsigned char cAnswer = 0;
+
+    if ( VoiceDatagram::applyVoiceFeatures(cFeatures, pVoiceCipher, pVoiceCodec, cAnswer) )
+    {
+        // Tell the server which of the new features we understand.
+
+        char vAnswer[2];
+        vAnswer[0] = SM_VOICE_FEATURES;
+        vAnswer[1] = static_cast<char>(cAnswer);
+
+        send(pThisUser->sockUserTCP, vAnswer, sizeof(vAnswer), 0);
+    }
+}
+
+void NetworkService::receiveSpeakerIds(TCPFrameCursor& frame)
+{
+    // Read packet: ([name size (1)][name][speaker id (2)]) for every user that got an id.
+
+    unsigned short iPacketSize = 0;
+    frame.readU16(iPacketSize);
+
+    const char* pPacket = frame.readSpan(iPacketSize);
+
+    if (pPacket == nullptr)
+    {
+        return;
+    }
+
+    TCPFrameCursor packet(pPacket, iPacketSize);
+
+
+    mtxOtherUsers.lock();
+
+    while (packet.getRemaining() > 0)
+    {
+        unsigned char nameSize = 0;
+
+        char nameBuffer[MAX_NAME_LENGTH + 1];
+        memset(nameBuffer, 0, MAX_NAME_LENGTH + 1);
+
+        unsigned short iSpeakerId = 0;
+
+        if ( packet.readU8(nameSize) || packet.readString(nameBuffer, sizeof(nameBuffer), nameSize) || packet.readU16(iSpeakerId) )
+        {
+            // Damaged packet.
+            break;
+        }
+
+
+        User* pUser = pOtherUsers->find(std::string(nameBuffer));
+
+        if (pUser)
+        {
+            pOtherUsers->setSpeakerId(pUser, iSpeakerId);
+        }
+    }
+
+    mtxOtherUsers.unlock();
+}
+
 void NetworkService::sendMessage(std::wstring message)
 {
     if (message.length() * 2 > MAX_MESSAGE_LENGTH)
     {
-        pMainWindow->showMessageBox(true, "Your message is too big!");
+        pEventSink->showMessageBox(true, "Your message is too big!");
 
         return;
     }
@@ -1792,11 +1979,8 @@ void NetworkService::sendMessage(std::wstring message)
 
     std::memcpy(pRawMessage, message.c_str(), message.length() * 2);
 
-    unsigned int iEncryptedMessageSize = 0;
-    unsigned char* pEncryptedMessageBytes = pAES->EncryptECB(reinterpret_cast<unsigned char*>(pRawMessage),
-                                                             static_cast<unsigned int>(message.length() * 2 + 1),
-                                                             reinterpret_cast<unsigned char*>(vSecretAESKey),
-                                                             iEncryptedMessageSize);
+    unsigned int iRawMessageSize       = static_cast<unsigned int>(message.length() * 2 + 1);
+    unsigned int iEncryptedMessageSize = pAES->GetPaddingLength(iRawMessageSize);
 
 
 
@@ -1805,6 +1989,9 @@ void NetworkService::sendMessage(std::wstring message)
     char* pSendBuffer = new char[ 3 + iEncryptedMessageSize + 2 ];
     memset(pSendBuffer, 0, 3 + iEncryptedMessageSize + 2);
 
+    pAES->EncryptECBWithSetKey(reinterpret_cast<unsigned char*>(pRawMessage), iRawMessageSize,
+                               reinterpret_cast<unsigned char*>(pSendBuffer + 3));
+
     unsigned short int iPacketSize = static_cast <unsigned short> ( iEncryptedMessageSize );
 
 
@@ -1816,7 +2003,6 @@ void NetworkService::sendMessage(std::wstring message)
 
     std::memcpy( pSendBuffer,      &commandType,            sizeof(commandType)   );
     std::memcpy( pSendBuffer + 1,  &iPacketSize,            sizeof(iPacketSize)   );
-    std::memcpy( pSendBuffer + 3,  pEncryptedMessageBytes,  iEncryptedMessageSize );
 
 
 
@@ -1835,37 +2021,36 @@ void NetworkService::sendMessage(std::wstring message)
 
             if (error == 10054)
             {
-                pMainWindow->printOutput("\nWARNING:\nYour message has not been sent!\n"
-                                         "NetworkService::sendMessage()::send() failed and returned: "
-                                         + std::to_string(error) + ".",
-                                         SilentMessage(false));
+                pEventSink->printOutput("\nWARNING:\nYour message has not been sent!\n"
+                                        "NetworkService::sendMessage()::send() failed and returned: "
+                                        + std::to_string(error) + ".",
+                                        SilentMessage(false));
                 lostConnection();
-                pMainWindow->clearTextEdit();
+                pEventSink->clearTextEdit();
             }
             else
             {
-                pMainWindow->printOutput("\nWARNING:\nYour message has not been sent!\n"
-                                         "NetworkService::sendMessage()::send() failed and returned: "
-                                         + std::to_string(error) + ".\n",
-                                         SilentMessage(false));
+                pEventSink->printOutput("\nWARNING:\nYour message has not been sent!\n"
+                                        "NetworkService::sendMessage()::send() failed and returned: "
+                                        + std::to_string(error) + ".\n",
+                                        SilentMessage(false));
             }
         }
         else
         {
-            pMainWindow->printOutput("\nWARNING:\nWe could not send the whole message, because not enough "
-                                     "space in the outgoing socket buffer.\n",
-                                     SilentMessage(false));
+            pEventSink->printOutput("\nWARNING:\nWe could not send the whole message, because not enough "
+                                    "space in the outgoing socket buffer.\n",
+                                    SilentMessage(false));
 
-            pMainWindow->clearTextEdit();
+            pEventSink->clearTextEdit();
         }
     }
     else
     {
-        pMainWindow->clearTextEdit();
+        pEventSink->clearTextEdit();
     }
 
     delete[] pSendBuffer;
-    delete[] pEncryptedMessageBytes;
     delete[] pRawMessage;
 }
 
@@ -1915,47 +2100,25 @@ void NetworkService::sendVoiceMessage(char *pVoiceMessage, int iMessageSize, boo
 {
     if (bVoiceListen)
     {
-        int iSize = 0;
-
-        if (bLast)
-        {
-            char lastVoice = VM_LAST_MESSAGE;
-
-            iSize = sendto( pThisUser->sockUserUDP, &lastVoice, iMessageSize, 0,
-                            reinterpret_cast <sockaddr*> (&pThisUser->addrServer), sizeof(pThisUser->addrServer) );
-        }
-        else
-        {
-            char vSend[MAX_BUFFER_SIZE + 70];
-            memset(vSend, 0, MAX_BUFFER_SIZE + 70);
-
-            vSend[0] = VM_DEFAULT_MESSAGE;
+        VoiceClock::time_point sendStartTime = VoiceClock::now();
 
+        // Compress and encrypt.
 
+        unsigned char vSend[VOICE_DATAGRAM_MAX_SIZE];
 
-            // Encrypt voice message.
+        iMessageSize = static_cast<int>( VoiceDatagram::buildClientPacket(reinterpret_cast<short int*>(pVoiceMessage),
+                                                                          static_cast<size_t>(iMessageSize) / sizeof(short int),
+                                                                          bLast, pVoiceCodec, pVoiceCipher, pAES, vSend) );
 
-            unsigned int iEncryptedMessageSize = 0;
-            unsigned char* pEncryptedMessageBytes = pAES->EncryptECB(reinterpret_cast<unsigned char*>(pVoiceMessage),
-                                                                     static_cast<unsigned int>(iMessageSize),
-                                                                     reinterpret_cast<unsigned char*>(vSecretAESKey),
-                                                                     iEncryptedMessageSize);
 
-            unsigned short iEncryptedDataSize = static_cast<unsigned short>(iEncryptedMessageSize);
+        // Send to the server.
 
-
-
-            // Send to the server.
-
-            std::memcpy(vSend + 1, &iEncryptedDataSize, sizeof(iEncryptedDataSize));
-            std::memcpy(vSend + 1 + sizeof(iEncryptedDataSize), pEncryptedMessageBytes, iEncryptedDataSize);
-
-            iMessageSize = 1 + sizeof(iEncryptedDataSize) + iEncryptedDataSize;
-
-            iSize = sendto(pThisUser->sockUserUDP, vSend, iMessageSize, 0,
+        int iSize = sendto(pThisUser->sockUserUDP, reinterpret_cast<char*>(vSend), iMessageSize, 0,
                            reinterpret_cast<sockaddr*>(&pThisUser->addrServer), sizeof(pThisUser->addrServer));
 
-            delete[] pEncryptedMessageBytes;
+        if (bLast == false)
+        {
+            pAudioService->getVoicePathStats()->recordSince(VPS_SEND, sendStartTime);
         }
 
         if (iSize != iMessageSize)
@@ -1966,34 +2129,29 @@ void NetworkService::sendVoiceMessage(char *pVoiceMessage, int iMessageSize, boo
 
                 if (iError == 10035)
                 {
-                    pMainWindow->printOutput("\nWARNING:\nYour voice message has not been sent!\n"
-                                             "NetworkService::sendVoiceMessage()::sendto() failed and returned: "
-                                             + std::to_string(iError) + " (send buffer is full).\n",
-                                             SilentMessage(false),
-                                             true);
+                    pEventSink->printOutput("\nWARNING:\nYour voice message has not been sent!\n"
+                                            "NetworkService::sendVoiceMessage()::sendto() failed and returned: "
+                                            + std::to_string(iError) + " (send buffer is full).\n",
+                                            SilentMessage(false),
+                                            true);
                 }
                 else
                 {
-                    pMainWindow->printOutput("\nWARNING:\nYour voice message has not been sent!\n"
-                                             "NetworkService::sendVoiceMessage()::sendto() failed and returned: "
-                                             + std::to_string(iError) + ".\n",
-                                             SilentMessage(false),
-                                             true);
+                    pEventSink->printOutput("\nWARNING:\nYour voice message has not been sent!\n"
+                                            "NetworkService::sendVoiceMessage()::sendto() failed and returned: "
+                                            + std::to_string(iError) + ".\n",
+                                            SilentMessage(false),
+                                            true);
                 }
             }
             else
             {
-                pMainWindow->printOutput("\nWARNING:\nSomething went wrong and your voice message wasn't sent fully.\n",
-                                         SilentMessage(false),
-                                         true);
+                pEventSink->printOutput("\nWARNING:\nSomething went wrong and your voice message wasn't sent fully.\n",
+                                        SilentMessage(false),
+                                        true);
             }
         }
     }
-
-    if (pVoiceMessage)
-    {
-        delete[] pVoiceMessage;
-    }
 }
 
 void NetworkService::disconnect()
@@ -2008,6 +2166,7 @@ void NetworkService::disconnect()
             bVoiceListen = false;
 
             // Wait for listenUDPFromServer() to end.
+            pUDPReactor->wakeUp();
             mtxUDPRead.lock();
             mtxUDPRead.unlock();
             std::this_thread::sleep_for(std::chrono::milliseconds(INTERVAL_UDP_MESSAGE_MS));
@@ -2021,19 +2180,23 @@ void NetworkService::disconnect()
 
 
         // Wait for listenTCPFromServer() to end.
+        pTCPReactor->wakeUp();
         mtxTCPRead.lock();
         mtxTCPRead.unlock();
         std::this_thread::sleep_for(std::chrono::milliseconds(INTERVAL_TCP_MESSAGE_MS));
 
+        // ioctlsocket() fails while WSAEventSelect() is active.
+        pTCPReactor->detach();
+
 
         // Translate socket to blocking mode
 
         u_long arg = false;
         if ( ioctlsocket(pThisUser->sockUserTCP, static_cast <long> (FIONBIO), &arg) == SOCKET_ERROR )
         {
-            pMainWindow->printOutput("NetworkService::disconnect()::ioctsocket() (blocking mode) failed and returned: "
-                                     + std::to_string(WSAGetLastError()) + ".\n",
-                                     SilentMessage(false), true);
+            pEventSink->printOutput("NetworkService::disconnect()::ioctsocket() (blocking mode) failed and returned: "
+                                    + std::to_string(WSAGetLastError()) + ".\n",
+                                    SilentMessage(false), true);
         }
 
 
@@ -2045,9 +2208,9 @@ void NetworkService::disconnect()
 
         if (returnCode == SOCKET_ERROR)
         {
-            pMainWindow->printOutput("NetworkService::disconnect()::shutdown() function failed and returned: "
-                                     + std::to_string(WSAGetLastError()) + ".\n",
-                                     SilentMessage(false), true);
+            pEventSink->printOutput("NetworkService::disconnect()::shutdown() function failed and returned: "
+                                    + std::to_string(WSAGetLastError()) + ".\n",
+                                    SilentMessage(false), true);
             closesocket(pThisUser->sockUserTCP);
             closesocket(pThisUser->sockUserUDP);
             WSACleanup();
@@ -2070,37 +2233,37 @@ void NetworkService::disconnect()
                 returnCode = closesocket(pThisUser->sockUserTCP);
                 if (returnCode == SOCKET_ERROR)
                 {
-                    pMainWindow->printOutput("NetworkService::disconnect()::closesocket() function failed and returned: "
-                                             + std::to_string(WSAGetLastError()) + ".\n",
-                                             SilentMessage(false), true);
+                    pEventSink->printOutput("NetworkService::disconnect()::closesocket() function failed and returned: "
+                                            + std::to_string(WSAGetLastError()) + ".\n",
+                                            SilentMessage(false), true);
                     WSACleanup();
                     bWinSockLaunched = false;
                 }
                 else
                 {
-                    pMainWindow->printOutput("Connection closed successfully.\n",
-                                             SilentMessage(false), true);
+                    pEventSink->printOutput("Connection closed successfully.\n",
+                                            SilentMessage(false), true);
 
                     if (WSACleanup() == SOCKET_ERROR)
                     {
-                        pMainWindow->printOutput("NetworkService::disconnect()::WSACleanup() function failed and returned: "
-                                                 + std::to_string(WSAGetLastError()) + ".\n",
-                                                 SilentMessage(false), true);
+                        pEventSink->printOutput("NetworkService::disconnect()::WSACleanup() function failed and returned: "
+                                                + std::to_string(WSAGetLastError()) + ".\n",
+                                                SilentMessage(false), true);
                     }
 
                     // Delete user from UI.
 
-                    pMainWindow->deleteUserFromList        (nullptr, true);
-                    pMainWindow->setOnlineUsersCount       (0);
-                    pMainWindow->enableInteractiveElements (true, false);
-                    pMainWindow->setConnectDisconnectButton(true);
+                    pEventSink->deleteUserFromList        (nullptr, true);
+                    pEventSink->setOnlineUsersCount       (0);
+                    pEventSink->enableInteractiveElements (true, false);
+                    pEventSink->setConnectDisconnectButton(true);
 
                     bWinSockLaunched = false;
                 }
             }
             else
             {
-                pMainWindow->printOutput("Server has not responded.\n", SilentMessage(false), true);
+                pEventSink->printOutput("Server has not responded.\n", SilentMessage(false), true);
 
                 closesocket(pThisUser->sockUserTCP);
                 closesocket(pThisUser->sockUserUDP);
@@ -2111,10 +2274,10 @@ void NetworkService::disconnect()
 
                 // Delete user from UI.
 
-                pMainWindow->deleteUserFromList        (nullptr,true);
-                pMainWindow->setOnlineUsersCount       (0);
-                pMainWindow->enableInteractiveElements (true,false);
-                pMainWindow->setConnectDisconnectButton(true);
+                pEventSink->deleteUserFromList        (nullptr,true);
+                pEventSink->setOnlineUsersCount       (0);
+                pEventSink->enableInteractiveElements (true,false);
+                pEventSink->setConnectDisconnectButton(true);
             }
         }
 
@@ -2122,23 +2285,25 @@ void NetworkService::disconnect()
         cleanUp();
 
 
-        pMainWindow->clearTextEdit();
+        pEventSink->clearTextEdit();
     }
     else
     {
-        pMainWindow->showMessageBox(true, "You are not connected." );
+        pEventSink->showMessageBox(true, "You are not connected." );
     }
 }
 
 void NetworkService::lostConnection()
 {
-    pMainWindow->printOutput( "\nThe server is not responding...\n", SilentMessage(false), true );
+    pEventSink->printOutput( "\nThe server is not responding...\n", SilentMessage(false), true );
 
     bTextListen  = false;
+    pTCPReactor->wakeUp();
 
     if (bVoiceListen)
     {
         bVoiceListen = false;
+        pUDPReactor->wakeUp();
         closesocket(pThisUser->sockUserUDP);
         pAudioService->playLostConnectionSound();
         pAudioService->stop();
@@ -2155,10 +2320,10 @@ void NetworkService::lostConnection()
 
     // Delete user from UI.
 
-    pMainWindow->deleteUserFromList(nullptr, true);
-    pMainWindow->setOnlineUsersCount(0);
-    pMainWindow->enableInteractiveElements(true, false);
-    pMainWindow->setConnectDisconnectButton(true);
+    pEventSink->deleteUserFromList(nullptr, true);
+    pEventSink->setOnlineUsersCount(0);
+    pEventSink->enableInteractiveElements(true, false);
+    pEventSink->setConnectDisconnectButton(true);
 }
 
 void NetworkService::answerToFIN()
@@ -2170,6 +2335,7 @@ void NetworkService::answerToFIN()
         pAudioService->stop();
 
         bVoiceListen = false;
+        pUDPReactor->wakeUp();
 
         std::this_thread::sleep_for( std::chrono::milliseconds(INTERVAL_UDP_MESSAGE_MS) );
 
@@ -2180,16 +2346,16 @@ void NetworkService::answerToFIN()
     std::this_thread::sleep_for(std::chrono::milliseconds(CHECK_IF_SERVER_DIED_EVERY_MS));
 
 
-    pMainWindow->printOutput("Server is closing connection.\n", SilentMessage(false), true);
+    pEventSink->printOutput("Server is closing connection.\n", SilentMessage(false), true);
 
     int returnCode = shutdown(pThisUser->sockUserTCP, SD_SEND);
 
     if (returnCode == SOCKET_ERROR)
     {
-         pMainWindow->printOutput("NetworkService::listenForServer()::shutdown() function failed and returned: "
-                                  + std::to_string(WSAGetLastError()) + ".\n",
-                                  SilentMessage(false),
-                                  true);
+         pEventSink->printOutput("NetworkService::listenForServer()::shutdown() function failed and returned: "
+                                 + std::to_string(WSAGetLastError()) + ".\n",
+                                 SilentMessage(false),
+                                 true);
 
          closesocket(pThisUser->sockUserTCP);
          WSACleanup();
@@ -2200,10 +2366,10 @@ void NetworkService::answerToFIN()
         returnCode = closesocket(pThisUser->sockUserTCP);
         if (returnCode == SOCKET_ERROR)
         {
-            pMainWindow->printOutput("NetworkService::listenForServer()::closesocket() function failed and returned: "
-                                     + std::to_string(WSAGetLastError()) + ".\n",
-                                     SilentMessage(false),
-                                     true);
+            pEventSink->printOutput("NetworkService::listenForServer()::closesocket() function failed and returned: "
+                                    + std::to_string(WSAGetLastError()) + ".\n",
+                                    SilentMessage(false),
+                                    true);
 
             WSACleanup();
             bWinSockLaunched = false;
@@ -2212,23 +2378,23 @@ void NetworkService::answerToFIN()
         {
             if (WSACleanup() == SOCKET_ERROR)
             {
-                pMainWindow->printOutput("NetworkService::listenForServer()::WSACleanup() function failed and returned: "
-                                         + std::to_string(WSAGetLastError()) + ".\n",
-                                         SilentMessage(false),
-                                         true);
+                pEventSink->printOutput("NetworkService::listenForServer()::WSACleanup() function failed and returned: "
+                                        + std::to_string(WSAGetLastError()) + ".\n",
+                                        SilentMessage(false),
+                                        true);
             }
             else
             {
-                pMainWindow->setOnlineUsersCount(0);
-                pMainWindow->enableInteractiveElements(true, false);
-                pMainWindow->setConnectDisconnectButton(true);
+                pEventSink->setOnlineUsersCount(0);
+                pEventSink->enableInteractiveElements(true, false);
+                pEventSink->setConnectDisconnectButton(true);
 
                 bWinSockLaunched = false;
 
-                pMainWindow->printOutput("Connection closed successfully.\n",
-                                         SilentMessage(false), true);
+                pEventSink->printOutput("Connection closed successfully.\n",
+                                        SilentMessage(false), true);
 
-                pMainWindow->deleteUserFromList(nullptr, true);
+                pEventSink->deleteUserFromList(nullptr, true);
             }
         }
     }
@@ -2237,7 +2403,7 @@ void NetworkService::answerToFIN()
     cleanUp();
 
 
-    pMainWindow->clearTextEdit();
+    pEventSink->clearTextEdit();
 }
 
 
@@ -2257,16 +2423,12 @@ void NetworkService::cleanUp()
     mtxOtherUsers.lock();
 
 
-    for (size_t i = 0;   i < vOtherUsers.size();   i++)
+    for (size_t i = 0;   i < pOtherUsers->size();   i++)
     {
-        vOtherUsers[i]->mtxUser.lock();
-        vOtherUsers[i]->mtxUser.unlock();
-
-        delete vOtherUsers[i];
-        vOtherUsers[i] = nullptr;
+        delete pOtherUsers->get(i);
     }
 
-    vOtherUsers.clear();
+    pOtherUsers->clear();
 
 
     if (pThisUser)
@@ -2288,73 +2450,86 @@ void NetworkService::forceStop(UINT_PTR socketToStop)
 
     clearWinsockAndThisUser();
 
-    pMainWindow->enableInteractiveElements(true, false);
+    pEventSink->enableInteractiveElements(true, false);
 }
 
-void NetworkService::canMoveToRoom()
+void NetworkService::canMoveToRoom(TCPFrameCursor& frame)
 {
     wchar_t vBuffer[MAX_TCP_BUFFER_SIZE / 2];
-    memset(vBuffer, 0, MAX_TCP_BUFFER_SIZE / 2);
-
-    char cRoomNameSize = 0;
+    memset(vBuffer, 0, sizeof(vBuffer));
 
-    recv(pThisUser->sockUserTCP, &cRoomNameSize, 1, 0);
+    unsigned char cRoomNameSize = 0;
 
     char vRoomName[MAX_NAME_LENGTH + 10];
     memset(vRoomName, 0, MAX_NAME_LENGTH + 10);
 
-    recv(pThisUser->sockUserTCP, vRoomName, cRoomNameSize, 0);
-
 
     // Room message.
 
     unsigned short iRoomMessageSize = 0;
 
-    recv(pThisUser->sockUserTCP, reinterpret_cast<char*>(&iRoomMessageSize), sizeof(iRoomMessageSize), 0);
+    if ( frame.readU8(cRoomNameSize) || frame.readString(vRoomName, sizeof(vRoomName), cRoomNameSize) || frame.readU16(iRoomMessageSize) )
+    {
+        return;
+    }
 
-    recv(pThisUser->sockUserTCP, reinterpret_cast<char*>(vBuffer), iRoomMessageSize, 0);
+    const char* pRoomMessage = frame.readSpan(iRoomMessageSize);
+
+    if (pRoomMessage == nullptr)
+    {
+        return;
+    }
+
+    // Keep the last wchar_t zero.
+    std::memcpy(vBuffer, pRoomMessage, std::min(static_cast<size_t>(iRoomMessageSize), sizeof(vBuffer) - sizeof(wchar_t)));
 
 
     mtxRooms.lock();
 
-    pMainWindow->moveUserToRoom(pThisUser->pListWidgetItem, vRoomName);
+    mtxThisUserRoom.lock();
+    pThisUser->sRoomName = vRoomName;
+    mtxThisUserRoom.unlock();
+
+    pEventSink->moveUserToRoom(pThisUser->pListWidgetItem, vRoomName);
 
     if (iRoomMessageSize != 0)
     {
-        pMainWindow->printOutput("-----------------------------------------------------------------------------\n",
-                                 SilentMessage(false),
-                                 true);
-        pMainWindow->printOutput("Room Message:\n",
-                                 SilentMessage(false),
-                                 true);
-        pMainWindow->printOutputW(vBuffer, SilentMessage(false), true);
-        pMainWindow->printOutput("\n-----------------------------------------------------------------------------\n",
-                                 SilentMessage(false),
-                                 true);
+        pEventSink->printOutput("-----------------------------------------------------------------------------\n",
+                                SilentMessage(false),
+                                true);
+        pEventSink->printOutput("Room Message:\n",
+                                SilentMessage(false),
+                                true);
+        pEventSink->printOutputW(vBuffer, SilentMessage(false), true);
+        pEventSink->printOutput("\n-----------------------------------------------------------------------------\n",
+                                SilentMessage(false),
+                                true);
     }
 
     mtxRooms.unlock();
 }
 
-void NetworkService::userEntersRoom()
+void NetworkService::userEntersRoom(TCPFrameCursor& frame)
 {
     char vBuffer[MAX_NAME_LENGTH + 1];
     memset(vBuffer, 0, MAX_NAME_LENGTH + 1);
 
-    char cNameSize = 0;
-
-    recv(pThisUser->sockUserTCP, &cNameSize, 1, 0);
+    unsigned char cNameSize = 0;
 
-    recv(pThisUser->sockUserTCP, vBuffer, cNameSize, 0);
+    if ( frame.readU8(cNameSize) || frame.readString(vBuffer, sizeof(vBuffer), cNameSize) )
+    {
+        return;
+    }
 
     std::string sUserName(vBuffer);
     memset(vBuffer, 0, MAX_NAME_LENGTH + 1);
 
-    char cRoomNameSize = 0;
-
-    recv(pThisUser->sockUserTCP, &cRoomNameSize, 1, 0);
+    unsigned char cRoomNameSize = 0;
 
-    recv(pThisUser->sockUserTCP, vBuffer, cRoomNameSize, 0);
+    if ( frame.readU8(cRoomNameSize) || frame.readString(vBuffer, sizeof(vBuffer), cRoomNameSize) )
+    {
+        return;
+    }
 
     std::string sRoomName(vBuffer);
 
@@ -2363,21 +2538,20 @@ void NetworkService::userEntersRoom()
 
     mtxOtherUsers.lock();
 
-    for (size_t i = 0; i < vOtherUsers.size(); i++)
+    User* pUser = pOtherUsers->find(sUserName);
+
+    if (pUser)
     {
-        if (vOtherUsers[i]->sUserName == sUserName)
-        {
-            mtxRooms.lock();
+        mtxRooms.lock();
 
-            sOurRoom = pThisUser->pListWidgetItem->getRoom()->getRoomName().toStdString();
-            sOldRoom = vOtherUsers[i]->pListWidgetItem->getRoom()->getRoomName().toStdString();
+        sOurRoom = pThisUser->sRoomName;
+        sOldRoom = pUser->sRoomName;
 
-            pMainWindow->moveUserToRoom(vOtherUsers[i]->pListWidgetItem, sRoomName);
+        pUser->sRoomName = sRoomName;
 
-            mtxRooms.unlock();
+        pEventSink->moveUserToRoom(pUser->pListWidgetItem, sRoomName);
 
-            break;
-        }
+        mtxRooms.unlock();
     }
 
     mtxOtherUsers.unlock();
@@ -2392,103 +2566,140 @@ void NetworkService::userEntersRoom()
     }
 }
 
-void NetworkService::serverMovedRoom()
+void NetworkService::serverMovedRoom(TCPFrameCursor& frame)
 {
-    char cRoomNameSize = 0;
-    recv(pThisUser->sockUserTCP, &cRoomNameSize, 1, 0);
+    unsigned char cRoomNameSize = 0;
 
     char vRoomNameBuffer[MAX_NAME_LENGTH + 1];
     memset(vRoomNameBuffer, 0, MAX_NAME_LENGTH + 1);
 
-    recv(pThisUser->sockUserTCP, vRoomNameBuffer, cRoomNameSize, 0);
+    unsigned char cMoveUp = 0;
 
-    char cMoveUp = 0;
-    recv(pThisUser->sockUserTCP, &cMoveUp, 1, 0);
+    if ( frame.readU8(cRoomNameSize) || frame.readString(vRoomNameBuffer, sizeof(vRoomNameBuffer), cRoomNameSize) || frame.readU8(cMoveUp) )
+    {
+        return;
+    }
 
     mtxRooms.lock();
     mtxOtherUsers.lock();
 
-    pMainWindow->moveRoom(vRoomNameBuffer, cMoveUp);
+    pEventSink->moveRoom(vRoomNameBuffer, cMoveUp);
 
     mtxOtherUsers.unlock();
     mtxRooms.unlock();
 }
 
-void NetworkService::serverDeletesRoom()
+void NetworkService::serverDeletesRoom(TCPFrameCursor& frame)
 {
-    char cRoomNameSize = 0;
-    recv(pThisUser->sockUserTCP, &cRoomNameSize, 1, 0);
+    unsigned char cRoomNameSize = 0;
 
     char vRoomNameBuffer[MAX_NAME_LENGTH + 1];
     memset(vRoomNameBuffer, 0, MAX_NAME_LENGTH + 1);
 
-    recv(pThisUser->sockUserTCP, vRoomNameBuffer, cRoomNameSize, 0);
+    if ( frame.readU8(cRoomNameSize) || frame.readString(vRoomNameBuffer, sizeof(vRoomNameBuffer), cRoomNameSize) )
+    {
+        return;
+    }
 
     mtxRooms.lock();
     mtxOtherUsers.lock();
 
-    pMainWindow->deleteRoom(vRoomNameBuffer);
+    pEventSink->deleteRoom(vRoomNameBuffer);
 
     mtxOtherUsers.unlock();
     mtxRooms.unlock();
 }
 
-void NetworkService::serverCreatesRoom()
+void NetworkService::serverCreatesRoom(TCPFrameCursor& frame)
 {
-    char cRoomNameSize = 0;
-    recv(pThisUser->sockUserTCP, &cRoomNameSize, 1, 0);
+    unsigned char cRoomNameSize = 0;
 
     char vRoomNameBuffer[MAX_NAME_LENGTH + 1];
     memset(vRoomNameBuffer, 0, MAX_NAME_LENGTH + 1);
 
-    recv(pThisUser->sockUserTCP, vRoomNameBuffer, cRoomNameSize, 0);
-
 
     unsigned int iMaxUsers = 0;
-    recv(pThisUser->sockUserTCP, reinterpret_cast<char*>(&iMaxUsers), sizeof(unsigned int), 0);
+
+    if ( frame.readU8(cRoomNameSize) || frame.readString(vRoomNameBuffer, sizeof(vRoomNameBuffer), cRoomNameSize) || frame.readU32(iMaxUsers) )
+    {
+        return;
+    }
 
 
 
     mtxRooms.lock();
     mtxOtherUsers.lock();
 
-    pMainWindow->createRoom(vRoomNameBuffer, u"", iMaxUsers);
+    pEventSink->createRoom(vRoomNameBuffer, u"", iMaxUsers);
 
     mtxOtherUsers.unlock();
     mtxRooms.unlock();
 }
 
-void NetworkService::serverChangesRoom()
+void NetworkService::serverChangesRoom(TCPFrameCursor& frame)
 {
-    char cOldRoomName = 0;
-    recv(pThisUser->sockUserTCP, &cOldRoomName, 1, 0);
+    unsigned char cOldRoomName = 0;
 
     char vOldRoomNameBuffer[MAX_NAME_LENGTH + 1];
     memset(vOldRoomNameBuffer, 0, MAX_NAME_LENGTH + 1);
 
-    recv(pThisUser->sockUserTCP, vOldRoomNameBuffer, cOldRoomName, 0);
+    if ( frame.readU8(cOldRoomName) || frame.readString(vOldRoomNameBuffer, sizeof(vOldRoomNameBuffer), cOldRoomName) )
+    {
+        return;
+    }
 
 
 
-    char cRoomName = 0;
-    recv(pThisUser->sockUserTCP, &cRoomName, 1, 0);
+    unsigned char cRoomName = 0;
 
     char vRoomNameBuffer[MAX_NAME_LENGTH + 1];
     memset(vRoomNameBuffer, 0, MAX_NAME_LENGTH + 1);
 
-    recv(pThisUser->sockUserTCP, vRoomNameBuffer, cRoomName, 0);
+    if ( frame.readU8(cRoomName) || frame.readString(vRoomNameBuffer, sizeof(vRoomNameBuffer), cRoomName) )
+    {
+        return;
+    }
 
 
 
     unsigned int iMaxUsers = 0;
-    recv(pThisUser->sockUserTCP, reinterpret_cast<char*>(&iMaxUsers), sizeof(unsigned int), 0);
+
+    if ( frame.readU32(iMaxUsers) )
+    {
+        return;
+    }
 
 
 
     mtxRooms.lock();
     mtxOtherUsers.lock();
 
-    pMainWindow->changeRoomSettings(vOldRoomNameBuffer, vRoomNameBuffer, iMaxUsers);
+    std::string sOldRoomName = vOldRoomNameBuffer;
+
+    if (sOldRoomName != vRoomNameBuffer)
+    {
+        for (size_t i = 0;  i < pOtherUsers->size();  i++)
+        {
+            if (pOtherUsers->get(i)->sRoomName == sOldRoomName)
+            {
+                pOtherUsers->get(i)->sRoomName = vRoomNameBuffer;
+            }
+        }
+
+        if (pThisUser->sRoomName == sOldRoomName)
+        {
+            mtxThisUserRoom.lock();
+            pThisUser->sRoomName = vRoomNameBuffer;
+            mtxThisUserRoom.unlock();
+        }
+
+        if (sWelcomeRoomName == sOldRoomName)
+        {
+            sWelcomeRoomName = vRoomNameBuffer;
+        }
+    }
+
+    pEventSink->changeRoomSettings(vOldRoomNameBuffer, vRoomNameBuffer, iMaxUsers);
 
     mtxOtherUsers.unlock();
     mtxRooms.unlock();
@@ -16,15 +16,25 @@
 // Other
 #include "basetsd.h"
 
+// Custom
+#include "Model/DatagramBatch/datagrambatch.h"
+#include "Model/SocketReactor/socketreactor.h"
+#include "Model/VoiceCodec/voicecodec.h"
+#include "Model/VoicePathStats/voicepathstats.h"
 
-class MainWindow;
+
+class ModelEventSink;
 class AudioService;
 class SettingsManager;
 
 class User;
-class SListItemRoom;
 
 class AES;
+class VoiceCipher;
+class VoiceCodec;
+class TCPFrameReader;
+class TCPFrameCursor;
+class UserDirectory;
 
 
 
@@ -39,7 +49,7 @@ class NetworkService
 {
 public:
 
-    NetworkService(MainWindow* pMainWindow, AudioService* pAudioService, SettingsManager* pSettingsManager);
+    NetworkService(ModelEventSink* pEventSink, AudioService* pAudioService, SettingsManager* pSettingsManager);
     ~NetworkService();
 
 
@@ -58,6 +68,7 @@ public:
 
     // Send
 
+        // Does not take the ownership of 'pVoiceMessage'.
         void  sendVoiceMessage                 (char* pVoiceMessage, int iMessageSize, bool bLast);
         void  sendMessage                      (std::wstring message);
 
@@ -70,7 +81,7 @@ public:
 
     // Stop / Delete / Disconnect
 
-        void  deleteDisconnectedUserFromList   ();
+        void  deleteDisconnectedUserFromList   (TCPFrameCursor& frame);
         void  disconnect                       ();
         void  lostConnection                   ();
         void  answerToFIN                      ();
@@ -80,14 +91,22 @@ public:
 
     // GET functions
 
-        std::string    getClientVersion        () const;
-        std::string    getUserName             () const;
-        SListItemRoom* getUserRoom             () const;
+        std::string    getClientVersion         () const;
+        std::string    getUserName              () const;
+        std::string    getUserRoomName          () const;
+
+        // Should be called under getOtherUsersMutex().
+        // findOtherUser() and findOtherUserBySpeakerId() return nullptr if not found.
+        size_t         getOtherUsersVectorSize  () const;
+        User*          getOtherUser             (size_t i) const;
+        User*          findOtherUser            (const std::string& sUserName) const;
+        User*          findOtherUserBySpeakerId (unsigned short iSpeakerId) const;
 
-        size_t         getOtherUsersVectorSize () const;
-        User*          getOtherUser            (size_t i) const;
+        std::mutex*    getOtherUsersMutex       ();
 
-        std::mutex*    getOtherUsersMutex      ();
+        // Totals of the listening threads (the benchmarks print the syscalls per datagram and the wake-ups), any thread.
+        DatagramBatchCounters  getUDPReceiveCounters () const;
+        SocketReactorCounters  getTCPReactorCounters () const;
 
 
 private:
@@ -101,10 +120,14 @@ private:
 
     // Receive
 
-        void  receiveInfoAboutNewUser          ();
-        void  receiveMessage                   ();
-        void  receivePing                      ();
-        void  receiveServerMessage             ();
+        // processTCPMessage() reads the message type from 'frame' and passes the rest of it to one of the functions below.
+        void  processTCPMessage                (TCPFrameCursor& frame);
+        void  receiveInfoAboutNewUser          (TCPFrameCursor& frame);
+        void  receiveMessage                   (TCPFrameCursor& frame);
+        void  receivePing                      (TCPFrameCursor& frame);
+        void  receiveServerMessage             (TCPFrameCursor& frame);
+        void  receiveVoiceFeatures             (TCPFrameCursor& frame);
+        void  receiveSpeakerIds                (TCPFrameCursor& frame);
 
 
     // User in "Stop / Delete / Disconnect" functions.
@@ -127,33 +150,45 @@ private:
 
     // Rooms
 
-        void  canMoveToRoom                    ();
-        void  userEntersRoom                   ();
-        void  serverMovedRoom                  ();
-        void  serverDeletesRoom                ();
-        void  serverCreatesRoom                ();
-        void  serverChangesRoom                ();
+        void  canMoveToRoom                    (TCPFrameCursor& frame);
+        void  userEntersRoom                   (TCPFrameCursor& frame);
+        void  serverMovedRoom                  (TCPFrameCursor& frame);
+        void  serverDeletesRoom                (TCPFrameCursor& frame);
+        void  serverCreatesRoom                (TCPFrameCursor& frame);
+        void  serverChangesRoom                (TCPFrameCursor& frame);
 
 
     // VOIP
 
         void setupVoiceConnection              ();
         bool sendVOIPReadyPacket               ();
+        void processUDPDatagram                (char* pDatagram, int iSize);
+        void receiveVoicePacket                (char* pPacket, int iPacketSize);
+
+        // Returns nullptr if the payload is damaged.
+        short int* decodeVoicePayload          (VOICE_CODEC codec, const unsigned char* pPayload, size_t iPayloadSize);
 
 
     // ------------------------------------
 
 
 
-    MainWindow*        pMainWindow;
+    ModelEventSink*    pEventSink;
     AudioService*      pAudioService;
     SettingsManager*   pSettingsManager;
     User*              pThisUser;
     AES*               pAES;
+    VoiceCipher*       pVoiceCipher;
+    VoiceCodec*        pVoiceCodec;
+    SocketReactor*     pTCPReactor;
+    SocketReactor*     pUDPReactor;
+    DatagramBatch*     pUDPBatch;
+    VoiceClock::time_point udpBatchReceiveTime; // when the datagrams in 'pUDPBatch' were received
+    TCPFrameReader*    pTCPReader;
     std::mt19937_64*   pRndGen;
 
 
-    std::vector<User*> vOtherUsers;
+    UserDirectory*     pOtherUsers;
 
 
     std::mutex         mtxOtherUsers;
@@ -161,6 +196,14 @@ private:
     std::mutex         mtxUDPRead;
     std::mutex         mtxRooms;
 
+    // Guards the writes of pThisUser->sRoomName and the reads from other threads
+    // (getUserRoomName() is called from the GUI thread that can't wait for 'mtxRooms').
+    mutable std::mutex mtxThisUserRoom;
+
+
+    // Name of the first room in the chat info, new users appear there (TCP thread).
+    std::string        sWelcomeRoomName;
+
 
     clock_t            lastTimeServerKeepAliveCame;
 
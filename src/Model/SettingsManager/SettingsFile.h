@@ -10,7 +10,7 @@
 #include <string>
 
 #define SILENT_MAGIC_NUMBER 51337
-#define SILENT_SETTINGS_FILE_VERSION 2
+#define SILENT_SETTINGS_FILE_VERSION 3
 
 class SettingsFile
 {
@@ -33,7 +33,8 @@ public:
                  bool bPlayTextMessageSound       = true,
                  bool bPlayConnectDisconnectSound = true,
                  bool bShowConnectDisconnectMessage = true,
-                 int iMuteMicrophoneButton = 0)
+                 int iMuteMicrophoneButton = 0,
+                 bool bVoiceNoiseGating = false)
     {
         this->iPushToTalkButton    = iPushToTalkButton;
         this->iMasterVolume        = iMasterVolume;
@@ -52,6 +53,7 @@ public:
         this->bPlayConnectDisconnectSound = bPlayConnectDisconnectSound;
         this->bShowConnectDisconnectMessage = bShowConnectDisconnectMessage;
         this->iMuteMicrophoneButton = iMuteMicrophoneButton;
+        this->bVoiceNoiseGating = bVoiceNoiseGating;
     }
 
 
@@ -146,4 +148,5 @@ public:
     bool               bPlayTextMessageSound;
     bool               bPlayConnectDisconnectSound;
     bool               bShowConnectDisconnectMessage;
+    bool               bVoiceNoiseGating;
 };
@@ -15,7 +15,7 @@
 #include <shlobj.h>
 
 // Custom
-#include "View/MainWindow/mainwindow.h"
+#include "Model/ModelEventSink/modeleventsink.h"
 #include "Model/SettingsManager/SettingsFile.h"
 
 
@@ -24,9 +24,9 @@
 // ------------------------------------------------------------------------------------------------
 
 
-SettingsManager::SettingsManager(MainWindow* pMainWindow)
+SettingsManager::SettingsManager(ModelEventSink* pEventSink)
 {
-    this->pMainWindow   = pMainWindow;
+    this->pEventSink = pEventSink;
 
 
     bSettingsFileCreatedFirstTime = false;
@@ -58,8 +58,8 @@ void SettingsManager::saveCurrentSettings()
 
     if (result != S_OK)
     {
-        pMainWindow->showMessageBox(true, "An error occurred at SettingsManager::saveCurrentSettings(). Error: "
-                                           "can't open the Documents folder to read the settings.");
+        pEventSink->showMessageBox(true, "An error occurred at SettingsManager::saveCurrentSettings(). Error: "
+                                          "can't open the Documents folder to read the settings.");
 
         delete pCurrentSettingsFile;
 
@@ -224,6 +224,10 @@ void SettingsManager::saveCurrentSettings()
     newSettingsFile.write( reinterpret_cast<char*>(&pCurrentSettingsFile->iMuteMicrophoneButton), sizeof(pCurrentSettingsFile->iMuteMicrophoneButton));
 
 
+    // Write voice noise gating.
+    newSettingsFile.write( reinterpret_cast<char*>(&pCurrentSettingsFile->bVoiceNoiseGating), sizeof(pCurrentSettingsFile->bVoiceNoiseGating));
+
+
     // NEW SETTINGS GO HERE
     // Don't forget to update "readSettings()".
 
@@ -251,7 +255,7 @@ void SettingsManager::saveCurrentSettings()
 
     if (bInit == false)
     {
-       pMainWindow->applyTheme();
+       pEventSink->applyTheme();
     }
 }
 
@@ -265,7 +269,7 @@ SettingsFile *SettingsManager::readSettings()
 
     if (result != S_OK)
     {
-        pMainWindow->showMessageBox(true, "Can't open the Documents folder to read the settings.");
+        pEventSink->showMessageBox(true, "Can't open the Documents folder to read the settings.");
 
         return nullptr;
     }
@@ -319,11 +323,11 @@ SettingsFile *SettingsManager::readSettings()
 
             std::string converted_addr_str = converter.to_bytes( addressToSettings );
 
-            pMainWindow->showMessageBox(true, "An error occurred at SettingsManager::readSettings(). Error: "
-                                               "the settings file, located at \"" + converted_addr_str + "\" is not a Silent settings file "
-                                               "(it may have an old format from the older version).\n"
-                                               "\n"
-                                               "This file will be deleted and replaced with the valid Silent settings file. No further actions required.");
+            pEventSink->showMessageBox(true, "An error occurred at SettingsManager::readSettings(). Error: "
+                                              "the settings file, located at \"" + converted_addr_str + "\" is not a Silent settings file "
+                                              "(it may have an old format from the older version).\n"
+                                              "\n"
+                                              "This file will be deleted and replaced with the valid Silent settings file. No further actions required.");
             settingsFile.close();
             _wremove ( addressToSettings.c_str() );
 
@@ -487,6 +491,22 @@ SettingsFile *SettingsManager::readSettings()
         settingsFile.read( reinterpret_cast<char*>(&pSettingsFile->iMuteMicrophoneButton), sizeof(pSettingsFile->iMuteMicrophoneButton));
 
 
+        if (iSettingsVersion == 2)
+        {
+            // End of file.
+            settingsFile.close();
+
+            // Used to show the Settings Window on start.
+            bReadOldSettingsFile = true;
+
+            goto link_read_end;
+        }
+
+
+        // Read voice noise gating.
+        settingsFile.read( reinterpret_cast<char*>(&pSettingsFile->bVoiceNoiseGating), sizeof(pSettingsFile->bVoiceNoiseGating));
+
+
         // ----------------------------------------------------------------
         // Don't forget to handle OLD version using the 'iSettingsVersion'!
         // ----------------------------------------------------------------
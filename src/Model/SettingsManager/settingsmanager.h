@@ -8,7 +8,7 @@
 // STL
 #include <mutex>
 
-class MainWindow;
+class ModelEventSink;
 class SettingsFile;
 
 
@@ -25,7 +25,7 @@ class SettingsManager
 
 public:
 
-    SettingsManager(MainWindow* pMainWindow);
+    SettingsManager(ModelEventSink* pEventSink);
 
 
     void           saveCurrentSettings        ();
@@ -47,7 +47,7 @@ private:
 
 
 
-    MainWindow*        pMainWindow;
+    ModelEventSink*    pEventSink;
     SettingsFile*      pCurrentSettingsFile;
 
 
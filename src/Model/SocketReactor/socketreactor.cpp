@@ -0,0 +1,153 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "socketreactor.h"
+
+
+// Sockets and stuff
+#include <winsock2.h>
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+SocketReactor::SocketReactor()
+{
+    // Created with CreateEvent() (not WSACreateEvent()) so they don't depend on WSAStartup()/WSACleanup().
+
+    // Manual reset: WSAEnumNetworkEvents() resets it.
+    hSocketEvent = CreateEventW(nullptr, TRUE,  FALSE, nullptr);
+
+    // Auto reset: one wakeUp() releases one wait().
+    hWakeUpEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+
+    sockAttached = 0;
+
+    for (size_t i = 0;  i < SRE_COUNT;  i++)
+    {
+        vWaits[i] = 0;
+    }
+}
+
+bool SocketReactor::attach(UINT_PTR sock)
+{
+    sockAttached = 0;
+
+    if ( (hSocketEvent == nullptr) || (hWakeUpEvent == nullptr) )
+    {
+        return true;
+    }
+
+    ResetEvent(hSocketEvent);
+    ResetEvent(hWakeUpEvent);
+
+    // FD_READ is signaled again after each recv() if there is still something to read.
+    if ( WSAEventSelect(sock, hSocketEvent, FD_READ | FD_CLOSE) == SOCKET_ERROR )
+    {
+        return true;
+    }
+
+    sockAttached = sock;
+
+    return false;
+}
+
+void SocketReactor::detach()
+{
+    if (sockAttached == 0)
+    {
+        return;
+    }
+
+    WSAEventSelect(sockAttached, nullptr, 0);
+
+    sockAttached = 0;
+}
+
+SOCKET_REACTOR_EVENT SocketReactor::wait(unsigned int iTimeoutMS)
+{
+    SOCKET_REACTOR_EVENT event = waitForEvent(iTimeoutMS);
+
+    vWaits[event].store(vWaits[event].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    return event;
+}
+
+void SocketReactor::wakeUp()
+{
+    if (hWakeUpEvent)
+    {
+        SetEvent(hWakeUpEvent);
+    }
+}
+
+SocketReactorCounters SocketReactor::getCounters() const
+{
+    SocketReactorCounters counters;
+
+    for (size_t i = 0;  i < SRE_COUNT;  i++)
+    {
+        counters.vWaits[i] = vWaits[i].load(std::memory_order_relaxed);
+    }
+
+    return counters;
+}
+
+SOCKET_REACTOR_EVENT SocketReactor::waitForEvent(unsigned int iTimeoutMS)
+{
+    if (hWakeUpEvent == nullptr)
+    {
+        return SRE_ERROR;
+    }
+
+
+    HANDLE vEvents[2] = {hWakeUpEvent, hSocketEvent};
+    DWORD  iEventCount = (sockAttached != 0) ? 2 : 1;
+
+    DWORD iResult = WaitForMultipleObjects(iEventCount, vEvents, FALSE, iTimeoutMS);
+
+    if (iResult == WAIT_OBJECT_0)
+    {
+        return SRE_WAKE_UP;
+    }
+    else if (iResult == WAIT_OBJECT_0 + 1)
+    {
+        // Reset the event.
+
+        WSANETWORKEVENTS networkEvents;
+
+        if ( WSAEnumNetworkEvents(sockAttached, hSocketEvent, &networkEvents) == SOCKET_ERROR )
+        {
+            return SRE_ERROR;
+        }
+
+        return SRE_READ;
+    }
+    else if (iResult == WAIT_TIMEOUT)
+    {
+        return SRE_TIMEOUT;
+    }
+    else
+    {
+        return SRE_ERROR;
+    }
+}
+
+SocketReactor::~SocketReactor()
+{
+    detach();
+
+    if (hSocketEvent)
+    {
+        CloseHandle(hSocketEvent);
+    }
+
+    if (hWakeUpEvent)
+    {
+        CloseHandle(hWakeUpEvent);
+    }
+}
@@ -0,0 +1,99 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <atomic>
+
+// Other
+#include "basetsd.h"
+
+
+#define  SOCKET_REACTOR_INFINITE     0xFFFFFFFF
+
+
+enum SOCKET_REACTOR_EVENT
+{
+    SRE_READ        = 0,  // data (or FIN) is waiting in the socket
+    SRE_WAKE_UP     = 1,  // wakeUp() was called
+    SRE_TIMEOUT     = 2,
+    SRE_ERROR       = 3,
+
+    SRE_COUNT       = 4
+};
+
+
+// Totals since the SocketReactor was created: the wait() results by SOCKET_REACTOR_EVENT
+// (the benchmarks print the wake-ups of an idle connection).
+struct SocketReactorCounters
+{
+    unsigned long long  vWaits[SRE_COUNT];
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Sleeps until the attached socket becomes readable (or is closed by the other side) instead of polling it.
+// Uses WSAEventSelect(): the socket event and the wake-up event are waited on together,
+// so the thread blocked in wait() can be released by wakeUp() from any other thread.
+// attach(), detach() and wait() should be called from the listening thread (or when it's not running),
+// wakeUp() can be called from any thread.
+class SocketReactor
+{
+
+public:
+
+    SocketReactor();
+
+
+    // Makes the socket non-blocking (WSAEventSelect() does that).
+    // Returns true if failed (wait() will only return on the timeout or wakeUp() then).
+
+        bool                  attach        (UINT_PTR sock);
+
+
+    // Should be called before the socket is translated to blocking mode (ioctlsocket() fails otherwise).
+
+        void                  detach        ();
+
+
+    // Blocks until the socket has something to read, wakeUp() is called or 'iTimeoutMS' passed.
+
+        SOCKET_REACTOR_EVENT  wait          (unsigned int iTimeoutMS = SOCKET_REACTOR_INFINITE);
+        void                  wakeUp        ();
+
+
+    // Can be called from any thread.
+
+        SocketReactorCounters getCounters   () const;
+
+
+    ~SocketReactor();
+
+private:
+
+    // wait() without the counting.
+    SOCKET_REACTOR_EVENT  waitForEvent      (unsigned int iTimeoutMS);
+
+
+    // ---------------------------------------
+
+
+    void*                hSocketEvent;
+    void*                hWakeUpEvent;
+
+
+    UINT_PTR             sockAttached;
+
+
+    // Written by wait() only.
+    std::atomic<unsigned long long>  vWaits[SRE_COUNT];
+};
@@ -0,0 +1,388 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "tcpframereader.h"
+
+
+// STL
+#include <cstring>
+#include <algorithm>
+
+
+// Sockets and stuff
+#if _WIN32
+#include <winsock2.h>
+#endif
+
+
+// Custom
+#include "Model/net_messages.h"
+
+
+#define  TCP_FRAME_READER_MASK    (TCP_FRAME_READER_CAPACITY - 1)
+
+
+static_assert( (TCP_FRAME_READER_CAPACITY & TCP_FRAME_READER_MASK) == 0, "TCP_FRAME_READER_CAPACITY should be a power of 2" );
+static_assert( TCP_FRAME_READER_CAPACITY >= TCP_FRAME_MAX_SIZE,         "TCP_FRAME_READER_CAPACITY should hold the largest message" );
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+TCPFrameCursor::TCPFrameCursor()
+{
+    pData = nullptr;
+    iSize = 0;
+    iPos  = 0;
+}
+
+TCPFrameCursor::TCPFrameCursor(const char* pData, size_t iSize)
+{
+    this->pData = pData;
+    this->iSize = iSize;
+    iPos        = 0;
+}
+
+bool TCPFrameCursor::readU8(unsigned char& cOut)
+{
+    return readBytes(&cOut, sizeof(cOut));
+}
+
+bool TCPFrameCursor::readU16(unsigned short& iOut)
+{
+    return readBytes(&iOut, sizeof(iOut));
+}
+
+bool TCPFrameCursor::readU32(unsigned int& iOut)
+{
+    return readBytes(&iOut, sizeof(iOut));
+}
+
+bool TCPFrameCursor::readBytes(void* pOut, size_t iCount)
+{
+    const char* pSpan = readSpan(iCount);
+
+    if (pSpan == nullptr)
+    {
+        return true;
+    }
+
+    std::memcpy(pOut, pSpan, iCount);
+
+    return false;
+}
+
+bool TCPFrameCursor::skip(size_t iCount)
+{
+    return readSpan(iCount) == nullptr;
+}
+
+bool TCPFrameCursor::readString(char* pOut, size_t iOutSize, size_t iCount)
+{
+    const char* pSpan = readSpan(iCount);
+
+    if (pSpan == nullptr)
+    {
+        return true;
+    }
+
+    size_t iCopySize = std::min(iCount, iOutSize - 1);
+
+    std::memcpy(pOut, pSpan, iCopySize);
+    pOut[iCopySize] = 0;
+
+    return false;
+}
+
+const char* TCPFrameCursor::readSpan(size_t iCount)
+{
+    if (iCount > iSize - iPos)
+    {
+        return nullptr;
+    }
+
+    const char* pSpan = pData + iPos;
+    iPos += iCount;
+
+    return pSpan;
+}
+
+size_t TCPFrameCursor::getRemaining() const
+{
+    return iSize - iPos;
+}
+
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Skips the size (1 or 2 bytes) and the data of this size.
+static bool skipSizedField(TCPFrameCursor& cursor, bool bTwoByteSize)
+{
+    if (bTwoByteSize)
+    {
+        unsigned short iSize = 0;
+
+        return cursor.readU16(iSize) || cursor.skip(iSize);
+    }
+    else
+    {
+        unsigned char iSize = 0;
+
+        return cursor.readU8(iSize) || cursor.skip(iSize);
+    }
+}
+
+TCPFrameReader::TCPFrameReader()
+{
+    // The tail holds the copy of the first TCP_FRAME_MAX_SIZE bytes.
+    pBuffer = new char[TCP_FRAME_READER_CAPACITY + TCP_FRAME_MAX_SIZE];
+
+    reset();
+}
+
+void TCPFrameReader::reset()
+{
+    iReadPos          = 0;
+    iWritePos         = 0;
+    iCurrentFrameSize = 0;
+}
+
+#if _WIN32
+int TCPFrameReader::receive(UINT_PTR sock)
+{
+    char*  pFirst      = nullptr;
+    char*  pSecond     = nullptr;
+    size_t iFirstSize  = 0;
+    size_t iSecondSize = 0;
+
+    getFreeSpace(pFirst, iFirstSize, pSecond, iSecondSize);
+
+    if (iFirstSize == 0)
+    {
+        // Should not happen: the ring holds more than one whole message.
+        return SOCKET_ERROR;
+    }
+
+
+    // Free space may wrap around the end of the ring, receive into both parts at once.
+
+    WSABUF vBuffers[2];
+    vBuffers[0].buf = pFirst;
+    vBuffers[0].len = static_cast<ULONG>(iFirstSize);
+    vBuffers[1].buf = pSecond;
+    vBuffers[1].len = static_cast<ULONG>(iSecondSize);
+
+    DWORD iReceived = 0;
+    DWORD iFlags    = 0;
+
+    if ( WSARecv(sock, vBuffers, (iSecondSize != 0) ? 2 : 1, &iReceived, &iFlags, nullptr, nullptr) == SOCKET_ERROR )
+    {
+        return SOCKET_ERROR;
+    }
+
+
+    commitReceived(iReceived);
+
+
+    return static_cast<int>(iReceived);
+}
+#endif
+
+void TCPFrameReader::getFreeSpace(char*& pFirstOut, size_t& iFirstSizeOut, char*& pSecondOut, size_t& iSecondSizeOut)
+{
+    size_t iFree  = TCP_FRAME_READER_CAPACITY - (iWritePos - iReadPos);
+    size_t iStart = iWritePos & TCP_FRAME_READER_MASK;
+
+    pFirstOut      = pBuffer + iStart;
+    iFirstSizeOut  = std::min(iFree, TCP_FRAME_READER_CAPACITY - iStart);
+    pSecondOut     = pBuffer;
+    iSecondSizeOut = iFree - iFirstSizeOut;
+}
+
+void TCPFrameReader::commitReceived(size_t iWritten)
+{
+    // Update the mirrored part.
+
+    size_t iStart = iWritePos & TCP_FRAME_READER_MASK;
+    size_t iEnd   = iStart + iWritten;
+
+    if (iStart < TCP_FRAME_MAX_SIZE)
+    {
+        size_t iMirrorEnd = std::min(iEnd, static_cast<size_t>(TCP_FRAME_MAX_SIZE));
+
+        std::memcpy(pBuffer + TCP_FRAME_READER_CAPACITY + iStart, pBuffer + iStart, iMirrorEnd - iStart);
+    }
+
+    if (iEnd > TCP_FRAME_READER_CAPACITY)
+    {
+        size_t iWrappedSize = std::min(iEnd - TCP_FRAME_READER_CAPACITY, static_cast<size_t>(TCP_FRAME_MAX_SIZE));
+
+        std::memcpy(pBuffer + TCP_FRAME_READER_CAPACITY, pBuffer, iWrappedSize);
+    }
+
+
+    iWritePos += iWritten;
+}
+
+bool TCPFrameReader::getFrame(TCPFrameCursor& frameOut)
+{
+    size_t iAvailable = iWritePos - iReadPos;
+
+    if (iAvailable == 0)
+    {
+        return false;
+    }
+
+    const char* pFrame = pBuffer + (iReadPos & TCP_FRAME_READER_MASK);
+
+    size_t iFrameSize = getFrameSize(pFrame, iAvailable);
+
+    if (iFrameSize == 0)
+    {
+        return false;
+    }
+
+
+    frameOut          = TCPFrameCursor(pFrame, iFrameSize);
+    iCurrentFrameSize = iFrameSize;
+
+    return true;
+}
+
+void TCPFrameReader::popFrame()
+{
+    iReadPos += iCurrentFrameSize;
+    iCurrentFrameSize = 0;
+
+    if (iReadPos == iWritePos)
+    {
+        // Start from the beginning (the next receive() will not wrap).
+        iReadPos  = 0;
+        iWritePos = 0;
+    }
+}
+
+size_t TCPFrameReader::getFrameSize(const char* pData, size_t iAvailable)
+{
+    // Don't look past the largest message (the mirrored part ends there).
+
+    TCPFrameCursor cursor(pData, std::min(iAvailable, static_cast<size_t>(TCP_FRAME_MAX_SIZE)));
+
+    unsigned char cType = 0;
+
+    if ( cursor.readU8(cType) )
+    {
+        return 0;
+    }
+
+
+    bool bIncomplete = false;
+
+    switch (cType)
+    {
+    case(SM_NEW_USER):
+    case(RC_PASSWORD_REQ):
+    case(RC_SERVER_DELETES_ROOM):
+    {
+        // 1 byte size + data.
+
+        bIncomplete = skipSizedField(cursor, false);
+
+        break;
+    }
+    case(SM_SOMEONE_DISCONNECTED):
+    {
+        // Disconnect type + 1 byte size + data.
+
+        bIncomplete = cursor.skip(1) || skipSizedField(cursor, false);
+
+        break;
+    }
+    case(SM_PING):
+    case(SM_USERMESSAGE):
+    case(SM_GLOBAL_MESSAGE):
+    case(SM_SPEAKER_IDS):
+    {
+        // 2 byte size + data.
+
+        bIncomplete = skipSizedField(cursor, true);
+
+        break;
+    }
+    case(SM_VOICE_FEATURES):
+    {
+        bIncomplete = cursor.skip(1);
+
+        break;
+    }
+    case(RC_CAN_ENTER_ROOM):
+    {
+        // Room name + room message.
+
+        bIncomplete = skipSizedField(cursor, false) || skipSizedField(cursor, true);
+
+        break;
+    }
+    case(RC_USER_ENTERS_ROOM):
+    {
+        // User name + room name.
+
+        bIncomplete = skipSizedField(cursor, false) || skipSizedField(cursor, false);
+
+        break;
+    }
+    case(RC_SERVER_MOVED_ROOM):
+    {
+        // Room name + move up.
+
+        bIncomplete = skipSizedField(cursor, false) || cursor.skip(1);
+
+        break;
+    }
+    case(RC_SERVER_CREATES_ROOM):
+    {
+        // Room name + max users.
+
+        bIncomplete = skipSizedField(cursor, false) || cursor.skip(sizeof(unsigned int));
+
+        break;
+    }
+    case(RC_SERVER_CHANGES_ROOM):
+    {
+        // Old room name + new room name + max users.
+
+        bIncomplete = skipSizedField(cursor, false) || skipSizedField(cursor, false) || cursor.skip(sizeof(unsigned int));
+
+        break;
+    }
+    default:
+    {
+        // Only the type.
+
+        break;
+    }
+    }
+
+
+    if (bIncomplete)
+    {
+        return 0;
+    }
+
+    return std::min(iAvailable, static_cast<size_t>(TCP_FRAME_MAX_SIZE)) - cursor.getRemaining();
+}
+
+TCPFrameReader::~TCPFrameReader()
+{
+    delete[] pBuffer;
+}
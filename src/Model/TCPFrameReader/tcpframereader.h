@@ -0,0 +1,141 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <cstddef>
+
+// Other
+#if _WIN32
+#include "basetsd.h"
+#endif
+
+
+// Largest possible TCP message: RC_CAN_ENTER_ROOM (type, name size, name, message size, message).
+#define  TCP_FRAME_MAX_SIZE           (1 + 1 + 255 + 2 + 65535)
+
+// Should be a power of 2 and hold at least one TCP_FRAME_MAX_SIZE message.
+#define  TCP_FRAME_READER_CAPACITY    (1 << 17)
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Bounds-checked reader over one received message (does not copy or own the data).
+// All read functions return true if there is not enough data left (the output is not changed then).
+class TCPFrameCursor
+{
+
+public:
+
+    TCPFrameCursor();
+    TCPFrameCursor(const char* pData, size_t iSize);
+
+
+    // Read
+
+        bool         readU8           (unsigned char& cOut);
+        bool         readU16          (unsigned short& iOut);
+        bool         readU32          (unsigned int& iOut);
+        bool         readBytes        (void* pOut, size_t iCount);
+        bool         skip             (size_t iCount);
+
+
+    // Reads 'iCount' bytes, copies no more than 'iOutSize - 1' of them to 'pOut' and null-terminates it.
+
+        bool         readString       (char* pOut, size_t iOutSize, size_t iCount);
+
+
+    // Skips 'iCount' bytes and returns a pointer to them (or nullptr if there are not enough bytes).
+
+        const char*  readSpan         (size_t iCount);
+
+
+    // GET functions
+
+        size_t       getRemaining     () const;
+
+private:
+
+    const char*  pData;
+    size_t       iSize;
+    size_t       iPos;
+};
+
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Receives the TCP stream in large chunks into a ring buffer and splits it into whole messages.
+// The first TCP_FRAME_MAX_SIZE bytes of the ring are mirrored past its end
+// so every message is contiguous in memory and can be parsed in place.
+// Used by the TCP listening thread only.
+class TCPFrameReader
+{
+
+public:
+
+    TCPFrameReader();
+
+
+    // Forget everything received (new connection).
+
+        void            reset              ();
+
+
+    // One recv() call that reads as much as fits into the ring.
+    // Returns the same as recv(): received size, 0 if the server sent FIN or SOCKET_ERROR.
+
+#if _WIN32
+        int             receive            (UINT_PTR sock);
+#endif
+
+
+    // Same as receive() without the socket: fill the free space and commit what was written.
+    // The free space may wrap around the end of the ring so it is given in two parts ('iSecondSizeOut' may be 0).
+    // 'iWritten' should not be larger than the free space.
+
+        void            getFreeSpace       (char*& pFirstOut, size_t& iFirstSizeOut, char*& pSecondOut, size_t& iSecondSizeOut);
+        void            commitReceived     (size_t iWritten);
+
+
+    // Returns false if there is no whole message in the buffer.
+    // 'frameOut' starts from the message type and stays valid until popFrame().
+
+        bool            getFrame           (TCPFrameCursor& frameOut);
+        void            popFrame           ();
+
+
+    // Returns the size of the message (with the type byte) that starts at 'pData'
+    // or 0 if 'iAvailable' bytes are not enough to tell or to hold it.
+    // Does not depend on the socket so it can be checked on any input.
+
+        static size_t   getFrameSize       (const char* pData, size_t iAvailable);
+
+
+    ~TCPFrameReader();
+
+private:
+
+    char*        pBuffer;
+
+
+    // Not wrapped (the physical position is 'iPos & (TCP_FRAME_READER_CAPACITY - 1)').
+    size_t       iReadPos;
+    size_t       iWritePos;
+
+
+    // Size of the message returned from getFrame().
+    size_t       iCurrentFrameSize;
+};
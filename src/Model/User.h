@@ -11,6 +11,8 @@
 #include <vector>
 #include <mutex>
 
+#if _WIN32
+
 // ============== Network ==============
 // Sockets and stuff
 #include <winsock2.h>
@@ -32,6 +34,19 @@
 #include <Windows.h>
 #include "Mmsystem.h"
 
+#else
+
+// SilentModelChecks and SilentModelBench use the User (through UserDirectory) on Linux too.
+#include <netinet/in.h>
+
+typedef int SOCKET;
+
+#endif
+
+// Custom
+#include "Model/VoicePacketQueue/voicepacketqueue.h"
+#include "Model/JitterBuffer/jitterbuffer.h"
+
 
 
 class SListItemUser;
@@ -48,14 +63,23 @@ public:
 
     User(const std::string& sUserName, int iPing, SListItemUser* pListWidgetItem)
     {
-        this ->sUserName       = sUserName;
-        this ->iPing           = iPing;
-        this ->pListWidgetItem = pListWidgetItem;
-        bTalking               = false;
+        this ->sUserName         = sUserName;
+        this ->iPing             = iPing;
+        this ->pListWidgetItem   = pListWidgetItem;
+        bTalking                 = false;
+        bPacketsArePlaying       = false;
+        pJitterBuffer            = nullptr;
+        iNextVoicePacketSequence = 0;
+        iSpeakerId               = -1;
     }
 
-
-    std::mutex          mtxUser;
+    ~User()
+    {
+        if (pJitterBuffer)
+        {
+            delete pJitterBuffer;
+        }
+    }
 
 
     /////////////////////////////////////////////
@@ -70,6 +94,15 @@ public:
 
     std::string         sUserName;
 
+    // Room of the user (the view keeps its own in 'pListWidgetItem').
+    // Changed only by the NetworkService's TCP thread.
+    std::string         sRoomName;
+
+
+    // Assigned by the server (SM_SPEAKER_IDS), -1 if the server did not assign one.
+    // Set through UserDirectory::setSpeakerId().
+    int                 iSpeakerId;
+
 
 
     /////////////////////////////////////////////
@@ -79,20 +112,11 @@ public:
     /////////////////////////////////////////////
 
 
-    // Audio packets
-    std::vector<short*> vAudioPackets;
+    // Audio packets (filled by NetworkService::listenUDPFromServer(), played by AudioService::playbackLoop())
+    VoicePacketQueue    voicePackets;
+    unsigned int        iNextVoicePacketSequence; // used only by the UDP listen thread (see AudioService::playAudioData())
+    JitterBuffer*       pJitterBuffer;            // used only by the playback thread
     bool                bPacketsArePlaying;
-    bool                bDeletePacketsAtLast;
-    bool                bLastPacketCame;
-
-
-    // Waveform-audio output device
-    HWAVEOUT            hWaveOut;
-
-
-    // Audio buffers
-    WAVEHDR             WaveOutHdr1;
-    WAVEHDR             WaveOutHdr2;
 
 
     float               fUserDefinedVolume;
@@ -0,0 +1,136 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "userdirectory.h"
+
+
+// STL
+#include <utility>
+
+// Custom
+#include "Model/User.h"
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+UserDirectory::UserDirectory()
+{
+}
+
+bool UserDirectory::add(User* pUser)
+{
+    if ( mIndexByName.insert( std::make_pair(pUser->sUserName, vUsers.size()) ).second == false )
+    {
+        return false;
+    }
+
+    vUsers.push_back(pUser);
+
+
+    return true;
+}
+
+User* UserDirectory::remove(const std::string& sUserName)
+{
+    auto it = mIndexByName.find(sUserName);
+
+    if (it == mIndexByName.end())
+    {
+        return nullptr;
+    }
+
+
+    size_t iIndex = it->second;
+    User*  pUser  = vUsers[iIndex];
+
+    mIndexByName.erase(it);
+
+    if (pUser->iSpeakerId >= 0)
+    {
+        vUsersBySpeakerId[ static_cast<size_t>(pUser->iSpeakerId) ] = nullptr;
+    }
+
+
+    // Move the last user to the freed place.
+
+    if (iIndex != vUsers.size() - 1)
+    {
+        vUsers[iIndex] = vUsers.back();
+
+        mIndexByName[vUsers[iIndex]->sUserName] = iIndex;
+    }
+
+    vUsers.pop_back();
+
+
+    return pUser;
+}
+
+void UserDirectory::clear()
+{
+    vUsers.clear();
+    mIndexByName.clear();
+    vUsersBySpeakerId.clear();
+}
+
+User* UserDirectory::find(const std::string& sUserName) const
+{
+    auto it = mIndexByName.find(sUserName);
+
+    if (it == mIndexByName.end())
+    {
+        return nullptr;
+    }
+
+    return vUsers[it->second];
+}
+
+User* UserDirectory::findBySpeakerId(unsigned short iSpeakerId) const
+{
+    if (iSpeakerId >= vUsersBySpeakerId.size())
+    {
+        return nullptr;
+    }
+
+    return vUsersBySpeakerId[iSpeakerId];
+}
+
+void UserDirectory::setSpeakerId(User* pUser, unsigned short iSpeakerId)
+{
+    if (pUser->iSpeakerId >= 0)
+    {
+        vUsersBySpeakerId[ static_cast<size_t>(pUser->iSpeakerId) ] = nullptr;
+    }
+
+    if (iSpeakerId >= vUsersBySpeakerId.size())
+    {
+        vUsersBySpeakerId.resize(static_cast<size_t>(iSpeakerId) + 1, nullptr);
+    }
+
+
+    User* pPreviousUser = vUsersBySpeakerId[iSpeakerId];
+
+    if (pPreviousUser && (pPreviousUser != pUser))
+    {
+        pPreviousUser->iSpeakerId = -1;
+    }
+
+
+    vUsersBySpeakerId[iSpeakerId] = pUser;
+    pUser->iSpeakerId             = iSpeakerId;
+}
+
+size_t UserDirectory::size() const
+{
+    return vUsers.size();
+}
+
+User* UserDirectory::get(size_t i) const
+{
+    return vUsers[i];
+}
@@ -0,0 +1,77 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+
+class User;
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Other users on the server: a list for iteration, a hash index for the lookups by name
+// (every voice packet, ping update, volume change) and a table indexed by the speaker id
+// for the voice packets that carry the id instead of the name.
+// Not synchronized: guarded by NetworkService::getOtherUsersMutex() like the old vector was.
+// Does not own the users.
+class UserDirectory
+{
+
+public:
+
+    UserDirectory();
+
+
+    // Add / Remove
+
+        // Returns false if a user with this name is already in the directory (the user is not added:
+        // the names are unique, a second User with the same name would be left in the list when the name is removed).
+        bool    add              (User* pUser);
+
+        // Returns the removed user (nullptr if not found), the order of the other users may change.
+        User*   remove           (const std::string& sUserName);
+
+        void    clear            ();
+
+
+    // Find
+
+        // Returns nullptr if not found.
+        User*   find             (const std::string& sUserName) const;
+        User*   findBySpeakerId  (unsigned short iSpeakerId) const;
+
+
+    // Speaker ID
+
+        // The user should be in the directory. Replaces the previous id of this user,
+        // the user that had this id before (if any) loses it.
+        void    setSpeakerId     (User* pUser, unsigned short iSpeakerId);
+
+
+    // Iterate
+
+        size_t  size             () const;
+        User*   get              (size_t i) const;
+
+private:
+
+    std::vector<User*>                       vUsers;
+
+    // User name -> index in vUsers.
+    std::unordered_map<std::string, size_t>  mIndexByName;
+
+    // Speaker id -> user (nullptr if the id is not assigned), grows up to the largest assigned id.
+    std::vector<User*>                       vUsersBySpeakerId;
+};
@@ -0,0 +1,263 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "voiceactivitydetector.h"
+
+
+// STL
+#include <cmath>
+#include <climits>
+#include <algorithm>
+
+
+// How fast the noise floor follows the frame energy (part of the difference per frame).
+// Falls fast (noise went away / we were wrong), rises slow and much slower during the gated talk
+// (don't take the voice for noise, but still catch up with the noise that started with the talk).
+#define  VAD_NOISE_FLOOR_FALL             0.5f
+#define  VAD_NOISE_FLOOR_RISE             0.02f
+#define  VAD_NOISE_FLOOR_RISE_ON_TALK     0.001f
+
+
+
+static float dbToPower(float fDB)
+{
+    return std::pow(10.0f, fDB / 10.0f);
+}
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+VoiceActivityDetector::VoiceActivityDetector(unsigned int iFrameMS)
+{
+    this->iFrameMS = (iFrameMS == 0) ? 1 : iFrameMS;
+
+    setStartLevel(-100);
+    setNoiseGating(false);
+    setAttack(VAD_DEFAULT_ATTACK_MS);
+    setHangover(VAD_DEFAULT_HANGOVER_MS);
+
+
+    fNoiseFloor    = 0.0f;
+    bNoiseFloorSet = false;
+
+    reset();
+}
+
+void VoiceActivityDetector::setStartLevel(int iDBFS)
+{
+    fStartPeak = SHRT_MAX * std::pow(10.0f, iDBFS / 20.0f);
+}
+
+void VoiceActivityDetector::setNoiseGating(bool bEnable)
+{
+    bNoiseGating = bEnable;
+}
+
+void VoiceActivityDetector::setAttack(unsigned int iMS)
+{
+    iAttackFrames = 1 + msToFrames(iMS);
+}
+
+void VoiceActivityDetector::setHangover(unsigned int iMS)
+{
+    iHangoverFrames = msToFrames(iMS);
+}
+
+bool VoiceActivityDetector::process(const short int* pSamples, size_t iSampleCount, float fGain)
+{
+    VoiceFrameFeatures features = analyze(pSamples, iSampleCount);
+
+
+    // Min possible floor, don't let the digital silence make every sound a "voice".
+
+    static const float fMinNoiseFloor = dbToPower(VAD_MIN_NOISE_FLOOR_DBFS) * SHRT_MAX * SHRT_MAX;
+
+    float fEnergy = (features.fMeanSquare < fMinNoiseFloor) ? fMinNoiseFloor : features.fMeanSquare;
+
+    if (bNoiseFloorSet == false)
+    {
+        fNoiseFloor    = fEnergy;
+        bNoiseFloorSet = true;
+    }
+
+
+
+    // Classify.
+
+    bool bGating = bNoiseGating.load(std::memory_order_relaxed);
+
+    bool bVoice = (features.iPeak * fGain >= fStartPeak.load(std::memory_order_relaxed));
+
+    if (bVoice && bGating)
+    {
+        static const float fSpeechToNoise       = dbToPower(VAD_SPEECH_TO_NOISE_DB);
+        static const float fSpeechToNoiseOnTalk = dbToPower(VAD_SPEECH_TO_NOISE_ON_TALK_DB);
+
+        float fVoiceEnergy = fNoiseFloor * (bTalking ? fSpeechToNoiseOnTalk : fSpeechToNoise);
+
+        bVoice = (fEnergy >= fVoiceEnergy);
+
+        if (bVoice)
+        {
+            // Voice lasts, a click has one loud block and a fast decay.
+
+            static const float fBlockSpread = dbToPower(-VAD_BLOCK_SPREAD_DB);
+
+            float fMaxBlock = 0.0f;
+
+            for (size_t i = 0;  i < VAD_BLOCK_COUNT;  i++)
+            {
+                fMaxBlock = std::max(fMaxBlock, features.vBlockMeanSquare[i]);
+            }
+
+            float fBlockEnergy = std::max(fVoiceEnergy, fMaxBlock * fBlockSpread);
+            int   iVoiceBlocks = 0;
+
+            for (size_t i = 0;  i < VAD_BLOCK_COUNT;  i++)
+            {
+                if (features.vBlockMeanSquare[i] >= fBlockEnergy)
+                {
+                    iVoiceBlocks++;
+                }
+            }
+
+            bVoice = (iVoiceBlocks >= VAD_MIN_VOICE_BLOCKS);
+        }
+    }
+
+
+
+    // Track the noise.
+
+    if (fEnergy < fNoiseFloor)
+    {
+        fNoiseFloor += (fEnergy - fNoiseFloor) * VAD_NOISE_FLOOR_FALL;
+    }
+    else
+    {
+        fNoiseFloor += (fEnergy - fNoiseFloor) * ( (bTalking && bGating) ? VAD_NOISE_FLOOR_RISE_ON_TALK : VAD_NOISE_FLOOR_RISE );
+    }
+
+
+
+    // Attack / hangover.
+
+    if (bVoice)
+    {
+        iVoiceFramesInRow++;
+
+        if (iVoiceFramesInRow >= iAttackFrames)
+        {
+            bTalking            = true;
+            iHangoverFramesLeft = iHangoverFrames;
+        }
+    }
+    else
+    {
+        iVoiceFramesInRow = 0;
+
+        if (bTalking)
+        {
+            if (iHangoverFramesLeft == 0)
+            {
+                bTalking = false;
+            }
+            else
+            {
+                iHangoverFramesLeft--;
+            }
+        }
+    }
+
+
+    return bTalking;
+}
+
+void VoiceActivityDetector::reset()
+{
+    iVoiceFramesInRow   = 0;
+    iHangoverFramesLeft = 0;
+    bTalking            = false;
+}
+
+bool VoiceActivityDetector::isTalking() const
+{
+    return bTalking;
+}
+
+float VoiceActivityDetector::getNoiseFloorDBFS() const
+{
+    if (bNoiseFloorSet == false)
+    {
+        return VAD_MIN_NOISE_FLOOR_DBFS;
+    }
+
+    return 10.0f * std::log10( fNoiseFloor / (static_cast<float>(SHRT_MAX) * SHRT_MAX) );
+}
+
+VoiceFrameFeatures VoiceActivityDetector::analyze(const short int* pSamples, size_t iSampleCount)
+{
+    VoiceFrameFeatures features;
+    features.iPeak             = 0;
+    features.fMeanSquare       = 0.0f;
+
+    for (size_t i = 0;  i < VAD_BLOCK_COUNT;  i++)
+    {
+        features.vBlockMeanSquare[i] = 0.0f;
+    }
+
+    if (iSampleCount == 0)
+    {
+        return features;
+    }
+
+
+    long long iSumOfSquares = 0;
+    int       iPeak         = 0;
+
+    // The last block takes the remainder.
+    size_t    iBlockSize    = iSampleCount / VAD_BLOCK_COUNT;
+    size_t    iBlockStart   = 0;
+
+    for (size_t iBlock = 0;  iBlock < VAD_BLOCK_COUNT;  iBlock++)
+    {
+        size_t    iBlockEnd       = (iBlock == VAD_BLOCK_COUNT - 1) ? iSampleCount : iBlockStart + iBlockSize;
+        long long iBlockSumOfSquares = 0;
+
+        for (size_t i = iBlockStart;  i < iBlockEnd;  i++)
+        {
+            int iSample = pSamples[i];
+
+            iBlockSumOfSquares += iSample * iSample;
+
+            int iAbs = (iSample < 0) ? -iSample : iSample;
+            if (iAbs > iPeak)
+            {
+                iPeak = iAbs;
+            }
+        }
+
+        if (iBlockEnd > iBlockStart)
+        {
+            features.vBlockMeanSquare[iBlock] = static_cast<float>(iBlockSumOfSquares) / (iBlockEnd - iBlockStart);
+        }
+
+        iSumOfSquares += iBlockSumOfSquares;
+        iBlockStart    = iBlockEnd;
+    }
+
+
+    features.iPeak             = iPeak;
+    features.fMeanSquare       = static_cast<float>(iSumOfSquares) / iSampleCount;
+
+    return features;
+}
+
+unsigned int VoiceActivityDetector::msToFrames(unsigned int iMS) const
+{
+    return (iMS + iFrameMS - 1) / iFrameMS;
+}
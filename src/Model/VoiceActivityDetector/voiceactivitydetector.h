@@ -0,0 +1,122 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <atomic>
+#include <cstddef>
+
+
+// Frames needed to start the talk and to end it after the last voice frame.
+#define  VAD_DEFAULT_ATTACK_MS            0
+#define  VAD_DEFAULT_HANGOVER_MS          210
+
+// With the noise gating the frame energy should be this much above the noise floor to start the talk
+// and VAD_SPEECH_TO_NOISE_ON_TALK_DB above it to continue the talk (quiet syllables and word ends).
+#define  VAD_SPEECH_TO_NOISE_DB           6.0f
+#define  VAD_SPEECH_TO_NOISE_ON_TALK_DB   3.0f
+
+// The frame is split into this many blocks, at least VAD_MIN_VOICE_BLOCKS of them should be
+// VAD_SPEECH_TO_NOISE_DB above the noise floor and not quieter than the loudest block by more than
+// VAD_BLOCK_SPREAD_DB (so short clicks and knocks are not voice).
+#define  VAD_BLOCK_COUNT                  8
+#define  VAD_MIN_VOICE_BLOCKS             3
+#define  VAD_BLOCK_SPREAD_DB              20.0f
+
+// Noise floor never goes lower than this (digital silence).
+#define  VAD_MIN_NOISE_FLOOR_DBFS         -80.0f
+
+
+
+struct VoiceFrameFeatures
+{
+    // Max absolute sample value (0..32768).
+    int    iPeak;
+
+    // Mean of the squared samples (PCM16 units).
+    float  fMeanSquare;
+
+    // Mean square of each block of the frame.
+    float  vBlockMeanSquare[VAD_BLOCK_COUNT];
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Decides which captured frames are voice (should be sent) in the voice activation mode.
+// A frame is voice if its peak is above the user's start level (the old rule, checked without logarithms).
+// With the noise gating (off by default, it misses a bit more of the quiet word onsets under loud hum)
+// its energy should also be above the tracked noise floor (in the whole frame and in enough of its blocks),
+// so steady noise and clicks louder than the start level are not sent.
+// One integer pass over the frame, no per-sample math library calls.
+// process() and reset() should be called from one thread, setStartLevel() and setNoiseGating() from any.
+class VoiceActivityDetector
+{
+
+public:
+
+    VoiceActivityDetector(unsigned int iFrameMS);
+
+
+    // Setup
+
+        // Peak level (as shown in the settings) below which nothing is voice.
+        void                       setStartLevel      (int iDBFS);
+
+        // Also require the energy above the noise floor.
+        void                       setNoiseGating     (bool bEnable);
+
+        // 0 attack: the first voice frame starts the talk.
+        void                       setAttack          (unsigned int iMS);
+        void                       setHangover        (unsigned int iMS);
+
+
+    // Returns true if the frame should be sent.
+    // 'fGain' is the volume the frame will be heard with (applied to the peak only).
+
+        bool                       process            (const short int* pSamples, size_t iSampleCount, float fGain = 1.0f);
+
+        // New talk: forget the state (the noise floor is kept).
+        void                       reset              ();
+
+
+    // GET functions
+
+        bool                       isTalking          () const;
+        float                      getNoiseFloorDBFS  () const;
+
+
+    // One pass over the frame.
+
+        static VoiceFrameFeatures  analyze            (const short int* pSamples, size_t iSampleCount);
+
+private:
+
+    unsigned int       msToFrames         (unsigned int iMS) const;
+
+
+    std::atomic<float> fStartPeak;
+    std::atomic<bool>  bNoiseGating;
+
+    unsigned int       iFrameMS;
+    unsigned int       iAttackFrames;
+    unsigned int       iHangoverFrames;
+
+
+    // Mean square of the noise.
+    float              fNoiseFloor;
+    bool               bNoiseFloorSet;
+
+
+    unsigned int       iVoiceFramesInRow;
+    unsigned int       iHangoverFramesLeft;
+    bool               bTalking;
+};
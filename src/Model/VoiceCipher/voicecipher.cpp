@@ -0,0 +1,324 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "voicecipher.h"
+
+
+// STL
+#include <cstring>
+
+
+// External
+#include "AES/AES.h"
+
+
+// Counter blocks encrypted at once (keeps the keystream buffer on the stack).
+#define  VOICE_CIPHER_CTR_BATCH_BLOCKS    64
+
+
+// Labels for the key derivation (one AES block each).
+static const unsigned char vEncryptionKeyLabel[AES_BLOCK_SIZE] = {'S','i','l','e','n','t',' ','v','o','i','c','e',' ','e','n','c'};
+static const unsigned char vMacKeyLabel[AES_BLOCK_SIZE]        = {'S','i','l','e','n','t',' ','v','o','i','c','e',' ','m','a','c'};
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Multiplication by x in GF(2^128) (CMAC subkey generation).
+static void doubleBlock(const unsigned char* pIn, unsigned char* pOut)
+{
+    unsigned char cCarry = static_cast<unsigned char>(pIn[0] & 0x80);
+
+    for (int i = 0; i < AES_BLOCK_SIZE - 1; i++)
+    {
+        pOut[i] = static_cast<unsigned char>((pIn[i] << 1) | (pIn[i + 1] >> 7));
+    }
+
+    pOut[AES_BLOCK_SIZE - 1] = static_cast<unsigned char>(pIn[AES_BLOCK_SIZE - 1] << 1);
+
+    if (cCarry)
+    {
+        pOut[AES_BLOCK_SIZE - 1] ^= 0x87;
+    }
+}
+
+VoiceCipher::VoiceCipher(VOICE_CIPHER_DIRECTION sendDirection)
+{
+    pEncryptionAES = new AES(128);
+    pMacAES        = new AES(128);
+
+    this->sendDirection = sendDirection;
+    receiveDirection    = (sendDirection == VCD_CLIENT_TO_SERVER) ? VCD_SERVER_TO_CLIENT : VCD_CLIENT_TO_SERVER;
+
+    memset(vMacSubkey1, 0, sizeof(vMacSubkey1));
+    memset(vMacSubkey2, 0, sizeof(vMacSubkey2));
+
+    bEnabled = false;
+
+    reset();
+}
+
+void VoiceCipher::deriveKeys(AES* pSessionAES)
+{
+    unsigned char vLabel[AES_BLOCK_SIZE];
+    unsigned char vKey[AES_BLOCK_SIZE];
+
+
+    std::memcpy(vLabel, vEncryptionKeyLabel, AES_BLOCK_SIZE);
+    pSessionAES->EncryptECBWithSetKey(vLabel, AES_BLOCK_SIZE, vKey);
+    pEncryptionAES->SetKey(vKey);
+
+    std::memcpy(vLabel, vMacKeyLabel, AES_BLOCK_SIZE);
+    pSessionAES->EncryptECBWithSetKey(vLabel, AES_BLOCK_SIZE, vKey);
+    pMacAES->SetKey(vKey);
+
+    memset(vKey, 0, AES_BLOCK_SIZE);
+
+
+
+    // CMAC subkeys (RFC 4493).
+
+    unsigned char vZero[AES_BLOCK_SIZE];
+    unsigned char vL[AES_BLOCK_SIZE];
+    memset(vZero, 0, AES_BLOCK_SIZE);
+
+    pMacAES->EncryptECBWithSetKey(vZero, AES_BLOCK_SIZE, vL);
+
+    doubleBlock(vL,          vMacSubkey1);
+    doubleBlock(vMacSubkey1, vMacSubkey2);
+}
+
+void VoiceCipher::reset()
+{
+    iNextSendSequence        = 0;
+
+    iHighestReceivedSequence = 0;
+    iReceivedMask            = 0;
+    bReceivedAny             = false;
+}
+
+void VoiceCipher::setEnabled(bool bEnabled)
+{
+    this->bEnabled = bEnabled;
+}
+
+bool VoiceCipher::isEnabled() const
+{
+    return bEnabled;
+}
+
+unsigned int VoiceCipher::getNextSendSequence()
+{
+    return iNextSendSequence++;
+}
+
+size_t VoiceCipher::seal(unsigned char* pPacket, size_t iHeaderSize, size_t iPayloadSize, unsigned int iSequence)
+{
+    cryptPayload(pPacket + iHeaderSize, iPayloadSize, iSequence, static_cast<unsigned char>(sendDirection));
+
+
+    unsigned char vTag[AES_BLOCK_SIZE];
+    computeTag(pPacket, iHeaderSize + iPayloadSize, vTag);
+
+    std::memcpy(pPacket + iHeaderSize + iPayloadSize, vTag, VOICE_CIPHER_TAG_SIZE);
+
+
+    return iHeaderSize + iPayloadSize + VOICE_CIPHER_TAG_SIZE;
+}
+
+bool VoiceCipher::open(unsigned char* pPacket, size_t iHeaderSize, size_t iPayloadSize, unsigned int iSequence)
+{
+    unsigned char vTag[AES_BLOCK_SIZE];
+    computeTag(pPacket, iHeaderSize + iPayloadSize, vTag);
+
+
+    // Compare in constant time.
+
+    const unsigned char* pReceivedTag = pPacket + iHeaderSize + iPayloadSize;
+
+    unsigned char cDiff = 0;
+
+    for (size_t i = 0; i < VOICE_CIPHER_TAG_SIZE; i++)
+    {
+        cDiff |= static_cast<unsigned char>(vTag[i] ^ pReceivedTag[i]);
+    }
+
+    if (cDiff != 0)
+    {
+        return true;
+    }
+
+
+    if ( checkAndUpdateReplay(iSequence) )
+    {
+        return true;
+    }
+
+
+    cryptPayload(pPacket + iHeaderSize, iPayloadSize, iSequence, static_cast<unsigned char>(receiveDirection));
+
+    return false;
+}
+
+VoiceCipher::~VoiceCipher()
+{
+    delete pEncryptionAES;
+    delete pMacAES;
+}
+
+void VoiceCipher::cryptPayload(unsigned char* pPayload, size_t iPayloadSize, unsigned int iSequence, unsigned char cDirection)
+{
+    unsigned char vCounterBlocks[VOICE_CIPHER_CTR_BATCH_BLOCKS * AES_BLOCK_SIZE];
+    unsigned char vKeystream[VOICE_CIPHER_CTR_BATCH_BLOCKS * AES_BLOCK_SIZE];
+
+    size_t iBlockIndex = 0;
+
+    for (size_t iOffset = 0;   iOffset < iPayloadSize;   iOffset += sizeof(vKeystream))
+    {
+        size_t iChunkSize   = iPayloadSize - iOffset;
+        if (iChunkSize > sizeof(vKeystream))
+        {
+            iChunkSize = sizeof(vKeystream);
+        }
+
+        size_t iChunkBlocks = (iChunkSize + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE;
+
+
+        // Prepare counter blocks.
+
+        memset(vCounterBlocks, 0, iChunkBlocks * AES_BLOCK_SIZE);
+
+        for (size_t i = 0;   i < iChunkBlocks;   i++, iBlockIndex++)
+        {
+            unsigned char* pCounter = vCounterBlocks + i * AES_BLOCK_SIZE;
+
+            pCounter[0]  = cDirection;
+            pCounter[1]  = static_cast<unsigned char>(iSequence >> 24);
+            pCounter[2]  = static_cast<unsigned char>(iSequence >> 16);
+            pCounter[3]  = static_cast<unsigned char>(iSequence >> 8);
+            pCounter[4]  = static_cast<unsigned char>(iSequence);
+            pCounter[14] = static_cast<unsigned char>(iBlockIndex >> 8);
+            pCounter[15] = static_cast<unsigned char>(iBlockIndex);
+        }
+
+
+        pEncryptionAES->EncryptECBWithSetKey(vCounterBlocks, static_cast<unsigned int>(iChunkBlocks * AES_BLOCK_SIZE), vKeystream);
+
+
+        for (size_t i = 0;   i < iChunkSize;   i++)
+        {
+            pPayload[iOffset + i] ^= vKeystream[i];
+        }
+    }
+}
+
+void VoiceCipher::computeTag(const unsigned char* pData, size_t iDataSize, unsigned char* pTagOut)
+{
+    // AES-CMAC (RFC 4493).
+
+    unsigned char vX[AES_BLOCK_SIZE];
+    unsigned char vY[AES_BLOCK_SIZE];
+    memset(vX, 0, AES_BLOCK_SIZE);
+
+
+    size_t iBlockCount = (iDataSize + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE;
+    if (iBlockCount == 0)
+    {
+        iBlockCount = 1;
+    }
+
+    bool bLastBlockComplete = (iDataSize != 0) && (iDataSize % AES_BLOCK_SIZE == 0);
+
+
+    for (size_t i = 0;   i < iBlockCount - 1;   i++)
+    {
+        for (int j = 0; j < AES_BLOCK_SIZE; j++)
+        {
+            vY[j] = static_cast<unsigned char>(vX[j] ^ pData[i * AES_BLOCK_SIZE + j]);
+        }
+
+        pMacAES->EncryptECBWithSetKey(vY, AES_BLOCK_SIZE, vX);
+    }
+
+
+    // Last block.
+
+    unsigned char vLast[AES_BLOCK_SIZE];
+    memset(vLast, 0, AES_BLOCK_SIZE);
+
+    size_t iLastOffset = (iBlockCount - 1) * AES_BLOCK_SIZE;
+    size_t iLastSize   = iDataSize - iLastOffset;
+
+    std::memcpy(vLast, pData + iLastOffset, iLastSize);
+
+    const unsigned char* pSubkey = vMacSubkey1;
+
+    if (bLastBlockComplete == false)
+    {
+        vLast[iLastSize] = 0x80;
+        pSubkey = vMacSubkey2;
+    }
+
+    for (int j = 0; j < AES_BLOCK_SIZE; j++)
+    {
+        vY[j] = static_cast<unsigned char>(vX[j] ^ vLast[j] ^ pSubkey[j]);
+    }
+
+    pMacAES->EncryptECBWithSetKey(vY, AES_BLOCK_SIZE, pTagOut);
+}
+
+bool VoiceCipher::checkAndUpdateReplay(unsigned int iSequence)
+{
+    if (bReceivedAny == false)
+    {
+        bReceivedAny             = true;
+        iHighestReceivedSequence = iSequence;
+        iReceivedMask            = 1;
+
+        return false;
+    }
+
+
+    if (iSequence > iHighestReceivedSequence)
+    {
+        unsigned int iShift = iSequence - iHighestReceivedSequence;
+
+        if (iShift >= VOICE_CIPHER_REPLAY_WINDOW)
+        {
+            iReceivedMask = 1;
+        }
+        else
+        {
+            iReceivedMask = (iReceivedMask << iShift) | 1;
+        }
+
+        iHighestReceivedSequence = iSequence;
+
+        return false;
+    }
+
+
+    unsigned int iAge = iHighestReceivedSequence - iSequence;
+
+    if (iAge >= VOICE_CIPHER_REPLAY_WINDOW)
+    {
+        // Too old.
+        return true;
+    }
+
+    unsigned long long iBit = 1ULL << iAge;
+
+    if (iReceivedMask & iBit)
+    {
+        // Already received.
+        return true;
+    }
+
+    iReceivedMask |= iBit;
+
+    return false;
+}
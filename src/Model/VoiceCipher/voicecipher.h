@@ -0,0 +1,116 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <atomic>
+#include <cstddef>
+
+
+class AES;
+
+
+// Size of the authentication tag appended to each voice packet.
+#define  VOICE_CIPHER_TAG_SIZE        8
+
+// How much older (by sequence number) packets we still accept (reordered ones).
+#define  VOICE_CIPHER_REPLAY_WINDOW   64
+
+
+// Used in the counter block so both sides never produce the same keystream.
+enum VOICE_CIPHER_DIRECTION
+{
+    VCD_CLIENT_TO_SERVER    = 0,
+    VCD_SERVER_TO_CLIENT    = 1
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Authenticated counter mode for the UDP voice packets (used if the server advertises it).
+// Payload is encrypted in place with AES-CTR (no padding), the whole packet (header + encrypted payload)
+// is authenticated with the truncated AES-CMAC. Encryption and MAC keys are derived from the session key.
+// The counter block is: direction (1 byte), packet sequence number (4 bytes), zeros, block index (2 bytes).
+// seal() is used by the sending thread and open() by the receiving thread.
+//
+// Relay: the server opens each voice packet of a speaker with the speaker's keys and seals it again
+// for each listener with the listener's keys and the listener's own send sequence. So each side has one
+// sequence space and one replay window for all voice in its direction (whoever is speaking), the relayed
+// packets are never forwarded as is (they would be replays of the same sequence numbers for different speakers).
+class VoiceCipher
+{
+
+public:
+
+    // The client sends VCD_CLIENT_TO_SERVER (and opens VCD_SERVER_TO_CLIENT), the server the other way around.
+    VoiceCipher(VOICE_CIPHER_DIRECTION sendDirection = VCD_CLIENT_TO_SERVER);
+
+
+    // 'pSessionAES' should have the session key set (AES::SetKey()).
+
+        void          deriveKeys            (AES* pSessionAES);
+        void          reset                 ();
+
+
+    // Enabled when the server advertises the mode.
+
+        void          setEnabled            (bool bEnabled);
+        bool          isEnabled             () const;
+
+
+    // Sequence number for the next sent packet.
+
+        unsigned int  getNextSendSequence   ();
+
+
+    // Encrypts the payload (that follows the header) in place and appends the tag right after it.
+    // 'pPacket' should have 'iHeaderSize + iPayloadSize + VOICE_CIPHER_TAG_SIZE' bytes.
+    // Returns the full packet size.
+
+        size_t        seal                  (unsigned char* pPacket, size_t iHeaderSize, size_t iPayloadSize, unsigned int iSequence);
+
+
+    // Checks the tag (that follows the payload) and the sequence number and decrypts the payload in place.
+    // Returns true if the packet is forged, damaged or replayed (the payload is not decrypted then).
+
+        bool          open                  (unsigned char* pPacket, size_t iHeaderSize, size_t iPayloadSize, unsigned int iSequence);
+
+
+    ~VoiceCipher();
+
+private:
+
+        void          cryptPayload          (unsigned char* pPayload, size_t iPayloadSize, unsigned int iSequence, unsigned char cDirection);
+        void          computeTag            (const unsigned char* pData, size_t iDataSize, unsigned char* pTagOut);
+        bool          checkAndUpdateReplay  (unsigned int iSequence);
+
+
+    AES*                       pEncryptionAES;
+    AES*                       pMacAES;
+
+    VOICE_CIPHER_DIRECTION     sendDirection;
+    VOICE_CIPHER_DIRECTION     receiveDirection;
+
+
+    // CMAC subkeys.
+    unsigned char              vMacSubkey1[16];
+    unsigned char              vMacSubkey2[16];
+
+
+    std::atomic<bool>          bEnabled;
+    std::atomic<unsigned int>  iNextSendSequence;
+
+
+    // Replay window (receiving thread only).
+    unsigned int               iHighestReceivedSequence;
+    unsigned long long         iReceivedMask;
+    bool                       bReceivedAny;
+};
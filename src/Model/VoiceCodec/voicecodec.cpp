@@ -0,0 +1,269 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "voicecodec.h"
+
+
+// STL
+#include <cstring>
+
+
+#define  ADPCM_MAX_STEP_INDEX  88
+
+
+static const int vADPCMIndexTable[16] =
+{
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static const int vADPCMStepTable[ADPCM_MAX_STEP_INDEX + 1] =
+{
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,
+    19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
+    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+    130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
+    337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
+    876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+    2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
+    5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+
+
+// Applies the 4-bit code to the decoder state (the encoder does the same to stay in sync).
+static void applyADPCMNibble(unsigned char cNibble, int& iPredictor, int& iStepIndex)
+{
+    int iStep  = vADPCMStepTable[iStepIndex];
+    int iDelta = iStep >> 3;
+
+    if (cNibble & 4)
+    {
+        iDelta += iStep;
+    }
+
+    if (cNibble & 2)
+    {
+        iDelta += iStep >> 1;
+    }
+
+    if (cNibble & 1)
+    {
+        iDelta += iStep >> 2;
+    }
+
+
+    iPredictor += (cNibble & 8) ? -iDelta : iDelta;
+
+    if      (iPredictor > 32767)
+    {
+        iPredictor = 32767;
+    }
+    else if (iPredictor < -32768)
+    {
+        iPredictor = -32768;
+    }
+
+
+    iStepIndex += vADPCMIndexTable[cNibble];
+
+    if      (iStepIndex < 0)
+    {
+        iStepIndex = 0;
+    }
+    else if (iStepIndex > ADPCM_MAX_STEP_INDEX)
+    {
+        iStepIndex = ADPCM_MAX_STEP_INDEX;
+    }
+}
+
+static unsigned char encodeADPCMSample(int iSample, int& iPredictor, int& iStepIndex)
+{
+    int iStep = vADPCMStepTable[iStepIndex];
+    int iDiff = iSample - iPredictor;
+
+    unsigned char cNibble = 0;
+
+    if (iDiff < 0)
+    {
+        cNibble = 8;
+        iDiff   = -iDiff;
+    }
+
+    if (iDiff >= iStep)
+    {
+        cNibble |= 4;
+        iDiff   -= iStep;
+    }
+
+    if (iDiff >= (iStep >> 1))
+    {
+        cNibble |= 2;
+        iDiff   -= iStep >> 1;
+    }
+
+    if (iDiff >= (iStep >> 2))
+    {
+        cNibble |= 1;
+    }
+
+
+    applyADPCMNibble(cNibble, iPredictor, iStepIndex);
+
+    return cNibble;
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+VoiceCodec::VoiceCodec()
+{
+    iCodec            = VC_PCM;
+    iEncoderStepIndex = 0;
+}
+
+void VoiceCodec::setCodec(VOICE_CODEC codec)
+{
+    iCodec = codec;
+}
+
+VOICE_CODEC VoiceCodec::getCodec() const
+{
+    return static_cast<VOICE_CODEC>(iCodec.load());
+}
+
+size_t VoiceCodec::getEncodedSize(VOICE_CODEC codec, size_t iSampleCount)
+{
+    if (codec == VC_IMA_ADPCM)
+    {
+        // The first sample is in the header, the rest are 2 per byte.
+
+        return VOICE_CODEC_ADPCM_HEADER_SIZE + iSampleCount / 2;
+    }
+
+    return iSampleCount * sizeof(short int);
+}
+
+size_t VoiceCodec::encode(const short int* pSamples, size_t iSampleCount, unsigned char* pOut)
+{
+    if (getCodec() == VC_IMA_ADPCM)
+    {
+        return encodeADPCM(pSamples, iSampleCount, pOut);
+    }
+
+    std::memcpy(pOut, pSamples, iSampleCount * sizeof(short int));
+
+    return iSampleCount * sizeof(short int);
+}
+
+bool VoiceCodec::decode(VOICE_CODEC codec, const unsigned char* pData, size_t iDataSize, short int* pSamplesOut, size_t iSampleCount)
+{
+    if (codec == VC_IMA_ADPCM)
+    {
+        return decodeADPCM(pData, iDataSize, pSamplesOut, iSampleCount);
+    }
+
+    if (iDataSize < iSampleCount * sizeof(short int))
+    {
+        return true;
+    }
+
+    std::memcpy(pSamplesOut, pData, iSampleCount * sizeof(short int));
+
+    return false;
+}
+
+size_t VoiceCodec::encodeADPCM(const short int* pSamples, size_t iSampleCount, unsigned char* pOut)
+{
+    if (iSampleCount == 0)
+    {
+        return 0;
+    }
+
+
+    // Header.
+
+    int iPredictor = pSamples[0];
+    int iStepIndex = iEncoderStepIndex;
+
+    short int iFirstSample = pSamples[0];
+    std::memcpy(pOut, &iFirstSample, sizeof(iFirstSample));
+    pOut[2] = static_cast<unsigned char>(iStepIndex);
+    pOut[3] = 0;
+
+
+    // Samples (low nibble first).
+
+    unsigned char* pCodes = pOut + VOICE_CODEC_ADPCM_HEADER_SIZE;
+
+    for (size_t i = 1; i < iSampleCount; i += 2)
+    {
+        unsigned char cByte = encodeADPCMSample(pSamples[i], iPredictor, iStepIndex);
+
+        if (i + 1 < iSampleCount)
+        {
+            cByte |= static_cast<unsigned char>( encodeADPCMSample(pSamples[i + 1], iPredictor, iStepIndex) << 4 );
+        }
+
+        *pCodes = cByte;
+        pCodes++;
+    }
+
+
+    iEncoderStepIndex = iStepIndex;
+
+    return getEncodedSize(VC_IMA_ADPCM, iSampleCount);
+}
+
+bool VoiceCodec::decodeADPCM(const unsigned char* pData, size_t iDataSize, short int* pSamplesOut, size_t iSampleCount)
+{
+    if ( (iSampleCount == 0) || (iDataSize < getEncodedSize(VC_IMA_ADPCM, iSampleCount)) )
+    {
+        return true;
+    }
+
+
+    // Header.
+
+    short int iFirstSample = 0;
+    std::memcpy(&iFirstSample, pData, sizeof(iFirstSample));
+
+    int iPredictor = iFirstSample;
+    int iStepIndex = pData[2];
+
+    if (iStepIndex > ADPCM_MAX_STEP_INDEX)
+    {
+        return true;
+    }
+
+    pSamplesOut[0] = iFirstSample;
+
+
+    // Samples.
+
+    const unsigned char* pCodes = pData + VOICE_CODEC_ADPCM_HEADER_SIZE;
+
+    for (size_t i = 1; i < iSampleCount; i += 2)
+    {
+        applyADPCMNibble(*pCodes & 0x0F, iPredictor, iStepIndex);
+        pSamplesOut[i] = static_cast<short int>(iPredictor);
+
+        if (i + 1 < iSampleCount)
+        {
+            applyADPCMNibble(*pCodes >> 4, iPredictor, iStepIndex);
+            pSamplesOut[i + 1] = static_cast<short int>(iPredictor);
+        }
+
+        pCodes++;
+    }
+
+
+    return false;
+}
@@ -0,0 +1,78 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <atomic>
+#include <cstddef>
+
+
+// IMA ADPCM packet header: first sample (2 bytes), step index (1 byte), reserved (1 byte).
+#define  VOICE_CODEC_ADPCM_HEADER_SIZE  4
+
+
+enum VOICE_CODEC
+{
+    VC_PCM                  = 0,  // raw PCM16 (always supported)
+    VC_IMA_ADPCM            = 1   // 4 bits per sample
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Compresses the voice packets before they are encrypted and sent (and decompresses the received ones).
+// The codec for the sent packets is chosen when the server advertises it, otherwise PCM is used.
+// Every packet is decoded on its own (the ADPCM header has the decoder state)
+// so a lost packet does not damage the next ones.
+// encode() is used by the sending thread only, decode() does not change the object.
+class VoiceCodec
+{
+
+public:
+
+    VoiceCodec();
+
+
+    // Codec for the sent packets.
+
+        void           setCodec         (VOICE_CODEC codec);
+        VOICE_CODEC    getCodec         () const;
+
+
+    // Size of the packet with 'iSampleCount' samples encoded by 'codec'.
+
+        static size_t  getEncodedSize   (VOICE_CODEC codec, size_t iSampleCount);
+
+
+    // Encodes with the current codec. 'pOut' should have getEncodedSize() bytes.
+    // Returns the encoded size.
+
+        size_t         encode           (const short int* pSamples, size_t iSampleCount, unsigned char* pOut);
+
+
+    // 'iDataSize' may be bigger than the encoded size (padding is ignored).
+    // Returns true if the data is too small or damaged ('pSamplesOut' is not fully written then).
+
+        static bool    decode           (VOICE_CODEC codec, const unsigned char* pData, size_t iDataSize,
+                                         short int* pSamplesOut, size_t iSampleCount);
+
+private:
+
+        size_t         encodeADPCM      (const short int* pSamples, size_t iSampleCount, unsigned char* pOut);
+        static bool    decodeADPCM      (const unsigned char* pData, size_t iDataSize, short int* pSamplesOut, size_t iSampleCount);
+
+
+    std::atomic<int>   iCodec;
+
+
+    // The step size of the end of the last sent packet (the next one starts with it).
+    int                iEncoderStepIndex;
+};
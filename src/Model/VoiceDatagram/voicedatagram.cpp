@@ -0,0 +1,332 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "voicedatagram.h"
+
+
+// STL
+#include <cstring>
+
+// Custom
+#include "Model/VoiceCodec/voicecodec.h"
+#include "Model/VoiceCipher/voicecipher.h"
+#include "Model/net_messages.h"
+#include "AES/AES.h"
+
+
+// Returns true if the voice message of this type has no audio.
+static bool getVoiceMessageCodec(unsigned char cMessageType, VOICE_CODEC& codecOut)
+{
+    if (cMessageType == VM_DEFAULT_MESSAGE)
+    {
+        codecOut = VC_PCM;
+    }
+    else if (cMessageType == VM_ADPCM_MESSAGE)
+    {
+        codecOut = VC_IMA_ADPCM;
+    }
+    else
+    {
+        return true;
+    }
+
+    return false;
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+size_t VoiceDatagram::buildClientPacket(const short int* pSamples, size_t iSampleCount, bool bLast,
+                                        VoiceCodec* pCodec, VoiceCipher* pCipher, AES* pAES, unsigned char* pOut)
+{
+    return buildPacket(0, pSamples, iSampleCount, bLast, pCodec, pCipher, pAES, pOut);
+}
+
+bool VoiceDatagram::openServerPacket(unsigned char* pPacket, size_t iPacketSize, size_t iSampleCount,
+                                     VoiceCipher* pCipher, AES* pAES, unsigned char* pDecryptedOut, VoiceDatagramContent& packetOut)
+{
+    size_t iSpeakerSize = readSpeaker(pPacket, iPacketSize, packetOut);
+
+    if (iSpeakerSize == 0)
+    {
+        return true;
+    }
+
+    return openPacket(pPacket, iPacketSize, iSpeakerSize, iSampleCount, pCipher, pAES, pDecryptedOut, packetOut);
+}
+
+bool VoiceDatagram::applyVoiceFeatures(unsigned char cFeatures, VoiceCipher* pCipher, VoiceCodec* pCodec, unsigned char& cAnswerOut)
+{
+    pCipher->setEnabled( (cFeatures & VF_AUTHENTICATED_CTR) != 0 );
+    pCodec->setCodec( (cFeatures & VF_ADPCM_CODEC) ? VC_IMA_ADPCM : VC_PCM );
+
+    cAnswerOut = static_cast<unsigned char>(cFeatures & (VF_AUTHENTICATED_CTR | VF_SPEAKER_IDS | VF_ADPCM_CODEC));
+
+
+    // Older servers don't send the new flags and don't expect the answer.
+
+    return (cFeatures & (VF_SPEAKER_IDS | VF_ADPCM_CODEC)) != 0;
+}
+
+size_t VoiceDatagram::buildServerPacket(int iSpeakerId, unsigned short iSpeakerSequence, const std::string& sUserName,
+                                        const short int* pSamples, size_t iSampleCount,
+                                        bool bLast, VoiceCodec* pCodec, VoiceCipher* pCipher, AES* pAES, unsigned char* pOut)
+{
+    size_t iSpeakerSize = 0;
+
+    if (iSpeakerId >= 0)
+    {
+        unsigned short iId = static_cast<unsigned short>(iSpeakerId);
+
+        pOut[0] = static_cast<unsigned char>(UDP_SM_VOICE_BY_ID);
+        std::memcpy(pOut + 1,               &iId,              sizeof(iId));
+        std::memcpy(pOut + 1 + sizeof(iId), &iSpeakerSequence, sizeof(iSpeakerSequence));
+
+        iSpeakerSize = 1 + sizeof(iId) + sizeof(iSpeakerSequence);
+    }
+    else
+    {
+        pOut[0] = static_cast<unsigned char>(sUserName.size());
+        std::memcpy(pOut + 1, sUserName.c_str(), sUserName.size());
+
+        iSpeakerSize = 1 + sUserName.size();
+    }
+
+    return buildPacket(iSpeakerSize, pSamples, iSampleCount, bLast, pCodec, pCipher, pAES, pOut);
+}
+
+bool VoiceDatagram::openClientPacket(unsigned char* pPacket, size_t iPacketSize, size_t iSampleCount,
+                                     VoiceCipher* pCipher, AES* pAES, unsigned char* pDecryptedOut, VoiceDatagramContent& packetOut)
+{
+    packetOut.iSpeakerId       = -1;
+    packetOut.iSpeakerSequence = -1;
+    packetOut.sUserName.clear();
+
+    return openPacket(pPacket, iPacketSize, 0, iSampleCount, pCipher, pAES, pDecryptedOut, packetOut);
+}
+
+size_t VoiceDatagram::buildPacket(size_t iSpeakerSize, const short int* pSamples, size_t iSampleCount, bool bLast,
+                                  VoiceCodec* pCodec, VoiceCipher* pCipher, AES* pAES, unsigned char* pOut)
+{
+    // Compress the samples (if the server supports it).
+
+    unsigned char vEncodedMessage[MAX_BUFFER_SIZE];
+
+    const unsigned char* pPayload      = reinterpret_cast<const unsigned char*>(pSamples);
+    size_t               iPayloadSize  = iSampleCount * sizeof(short int);
+    unsigned char        cMessageType  = VM_DEFAULT_MESSAGE;
+
+    if (bLast)
+    {
+        cMessageType = VM_LAST_MESSAGE;
+        iPayloadSize = 0;
+    }
+    else if (pCodec->getCodec() == VC_IMA_ADPCM)
+    {
+        iPayloadSize = pCodec->encode(pSamples, iSampleCount, vEncodedMessage);
+        pPayload     = vEncodedMessage;
+        cMessageType = VM_ADPCM_MESSAGE;
+    }
+
+
+    unsigned char* pMessage = pOut + iSpeakerSize;
+
+    pMessage[0] = cMessageType;
+
+    if (pCipher->isEnabled())
+    {
+        // Authenticated counter mode (the speaker is authenticated too).
+
+        unsigned int iSequence = pCipher->getNextSendSequence();
+
+        std::memcpy(pMessage + 1, &iSequence, sizeof(iSequence));
+
+        size_t iHeaderSize = iSpeakerSize + 1 + sizeof(iSequence);
+
+        if (bLast == false)
+        {
+            unsigned short iDataSize = static_cast<unsigned short>(iPayloadSize);
+            std::memcpy(pOut + iHeaderSize, &iDataSize, sizeof(iDataSize));
+            iHeaderSize += sizeof(iDataSize);
+
+            std::memcpy(pOut + iHeaderSize, pPayload, iPayloadSize);
+        }
+
+        return pCipher->seal(pOut, iHeaderSize, iPayloadSize, iSequence);
+    }
+    else if (bLast)
+    {
+        return iSpeakerSize + 1;
+    }
+    else
+    {
+        std::memset(pMessage + 1, 0, VOICE_DATAGRAM_MAX_SIZE - 1);
+
+
+        // Encrypt voice message (right into the send buffer).
+
+        unsigned int iEncryptedMessageSize = pAES->EncryptECBWithSetKey(const_cast<unsigned char*>(pPayload),
+                                                                        static_cast<unsigned int>(iPayloadSize),
+                                                                        pMessage + 1 + sizeof(unsigned short));
+
+        unsigned short iEncryptedDataSize = static_cast<unsigned short>(iEncryptedMessageSize);
+
+        std::memcpy(pMessage + 1, &iEncryptedDataSize, sizeof(iEncryptedDataSize));
+
+        return iSpeakerSize + 1 + sizeof(iEncryptedDataSize) + iEncryptedDataSize;
+    }
+}
+
+bool VoiceDatagram::openPacket(unsigned char* pPacket, size_t iPacketSize, size_t iSpeakerSize, size_t iSampleCount,
+                               VoiceCipher* pCipher, AES* pAES, unsigned char* pDecryptedOut, VoiceDatagramContent& packetOut)
+{
+    if (iPacketSize < iSpeakerSize + 1)
+    {
+        return true;
+    }
+
+
+    unsigned char cMessageType = pPacket[iSpeakerSize];
+
+    packetOut.bLast        = (cMessageType == VM_LAST_MESSAGE);
+    packetOut.codec        = VC_PCM;
+    packetOut.pPayload     = nullptr;
+    packetOut.iPayloadSize = 0;
+
+    if ( (packetOut.bLast == false) && getVoiceMessageCodec(cMessageType, packetOut.codec) )
+    {
+        return true;
+    }
+
+
+    if (pCipher->isEnabled())
+    {
+        // [speaker][type (1)][sequence (4)] + [size (2)][encrypted payload] (not for the last message) + [tag].
+
+        unsigned int iSequence   = 0;
+        size_t       iHeaderSize = iSpeakerSize + 1 + sizeof(iSequence);
+
+        if (iPacketSize < iHeaderSize + VOICE_CIPHER_TAG_SIZE)
+        {
+            return true;
+        }
+
+        std::memcpy(&iSequence, pPacket + iSpeakerSize + 1, sizeof(iSequence));
+
+
+        if (packetOut.bLast == false)
+        {
+            unsigned short iDataSize = 0;
+
+            if (iPacketSize < iHeaderSize + sizeof(iDataSize) + VOICE_CIPHER_TAG_SIZE)
+            {
+                return true;
+            }
+
+            std::memcpy(&iDataSize, pPacket + iHeaderSize, sizeof(iDataSize));
+            iHeaderSize += sizeof(iDataSize);
+
+            packetOut.iPayloadSize = iDataSize;
+
+            if ( packetOut.iPayloadSize != VoiceCodec::getEncodedSize(packetOut.codec, iSampleCount) )
+            {
+                return true;
+            }
+        }
+
+        if (iPacketSize != iHeaderSize + packetOut.iPayloadSize + VOICE_CIPHER_TAG_SIZE)
+        {
+            return true;
+        }
+
+
+        // Check and decrypt.
+
+        if ( pCipher->open(pPacket, iHeaderSize, packetOut.iPayloadSize, iSequence) )
+        {
+            // Forged, damaged or replayed packet.
+            return true;
+        }
+
+        if (packetOut.bLast == false)
+        {
+            packetOut.pPayload = pPacket + iHeaderSize;
+        }
+    }
+    else if (packetOut.bLast == false)
+    {
+        // [speaker][type (1)] + [size (2)][ECB encrypted payload] (not for the last message).
+
+        unsigned short iEncryptedSize = 0;
+        size_t         iHeaderSize    = iSpeakerSize + 1 + sizeof(iEncryptedSize);
+
+        if (iPacketSize < iHeaderSize)
+        {
+            return true;
+        }
+
+        std::memcpy(&iEncryptedSize, pPacket + iSpeakerSize + 1, sizeof(iEncryptedSize));
+
+        if ( (iEncryptedSize > MAX_BUFFER_SIZE) || (iEncryptedSize % AES_BLOCK_SIZE != 0) || (iPacketSize < iHeaderSize + iEncryptedSize) )
+        {
+            return true;
+        }
+
+        pAES->DecryptECBWithSetKey(pPacket + iHeaderSize, iEncryptedSize, pDecryptedOut);
+
+        packetOut.pPayload     = pDecryptedOut;
+        packetOut.iPayloadSize = iEncryptedSize;
+    }
+
+
+    return false;
+}
+
+size_t VoiceDatagram::readSpeaker(const unsigned char* pPacket, size_t iPacketSize, VoiceDatagramContent& packetOut)
+{
+    if (iPacketSize == 0)
+    {
+        return 0;
+    }
+
+
+    if (static_cast<char>(pPacket[0]) == UDP_SM_VOICE_BY_ID)
+    {
+        unsigned short iSpeakerId       = 0;
+        unsigned short iSpeakerSequence = 0;
+
+        if (iPacketSize < 1 + sizeof(iSpeakerId) + sizeof(iSpeakerSequence))
+        {
+            return 0;
+        }
+
+        std::memcpy(&iSpeakerId,       pPacket + 1,                      sizeof(iSpeakerId));
+        std::memcpy(&iSpeakerSequence, pPacket + 1 + sizeof(iSpeakerId), sizeof(iSpeakerSequence));
+
+        packetOut.iSpeakerId       = iSpeakerId;
+        packetOut.iSpeakerSequence = iSpeakerSequence;
+        packetOut.sUserName.clear();
+
+        return 1 + sizeof(iSpeakerId) + sizeof(iSpeakerSequence);
+    }
+
+
+    size_t iNameSize = pPacket[0];
+
+    if ( (iNameSize > MAX_NAME_LENGTH) || (iPacketSize < 1 + iNameSize) )
+    {
+        return 0;
+    }
+
+    packetOut.iSpeakerId       = -1;
+    packetOut.iSpeakerSequence = -1;
+    packetOut.sUserName.assign(reinterpret_cast<const char*>(pPacket) + 1, iNameSize);
+
+    return 1 + iNameSize;
+}
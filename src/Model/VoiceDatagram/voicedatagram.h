@@ -0,0 +1,113 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <string>
+#include <cstddef>
+
+// Custom
+#include "Model/VoiceCodec/voicecodec.h"
+#include "Model/net_params.h"
+
+
+class AES;
+class VoiceCipher;
+
+
+// Size of the buffer for buildClientPacket() (the encrypted samples, the header and the tag or the ECB padding).
+#define  VOICE_DATAGRAM_MAX_SIZE          (MAX_BUFFER_SIZE + 70)
+
+// Size of the buffer for buildServerPacket() (the speaker goes first).
+#define  VOICE_DATAGRAM_MAX_SERVER_SIZE   (VOICE_DATAGRAM_MAX_SIZE + 1 + MAX_NAME_LENGTH)
+
+
+// Opened voice packet (see VoiceDatagram::openServerPacket() and VoiceDatagram::openClientPacket()).
+struct VoiceDatagramContent
+{
+    // The speaker (only the server packets have it): -1 if the packet has the user name.
+    int                   iSpeakerId;
+    std::string           sUserName;
+
+    // Packet number of the speaker (16 bits, only UDP_SM_VOICE_BY_ID packets have it), -1 if there is none.
+    int                   iSpeakerSequence;
+
+    bool                  bLast;
+    VOICE_CODEC           codec;
+
+    // Decrypted payload (not decoded, see VoiceCodec::decode()), nullptr for the last message.
+    const unsigned char*  pPayload;
+    size_t                iPayloadSize;
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// UDP voice packets (no sockets here, so the send path can also be run by the tools without Windows).
+// The client builds the packets with buildClientPacket() and opens them with openServerPacket(),
+// the other two are for the server side (the loopback stand-in).
+class VoiceDatagram
+{
+
+public:
+
+    // Compresses (with the codec of 'pCodec') and encrypts one voice packet into 'pOut'
+    // (should have VOICE_DATAGRAM_MAX_SIZE bytes):
+    // authenticated counter mode (if 'pCipher' is enabled) - [type (1)][sequence (4)] + [size (2)][payload] (not for the last message) + [tag],
+    // otherwise - [type (1)] + [size (2)][ECB encrypted payload] (not for the last message, 'pAES' has the session key set).
+    // 'pSamples' is ignored if 'bLast'. Does not allocate memory.
+    // Returns the size of the packet.
+
+        static size_t  buildClientPacket  (const short int* pSamples, size_t iSampleCount, bool bLast,
+                                           VoiceCodec* pCodec, VoiceCipher* pCipher, AES* pAES, unsigned char* pOut);
+
+
+    // Reads and decrypts a voice packet from the server, it starts with the speaker:
+    // [UDP_SM_VOICE_BY_ID][speaker id (2)][speaker sequence (2)] or [name size (1)][name], then the same layout as buildClientPacket()
+    // (the speaker is authenticated too). The authenticated packets are decrypted in place,
+    // the ECB ones into 'pDecryptedOut' (VOICE_DATAGRAM_MAX_SIZE bytes). 'iSampleCount' - samples in a voice packet.
+    // Returns true if the packet is damaged, forged or replayed ('packetOut' should not be used then).
+
+        static bool    openServerPacket   (unsigned char* pPacket, size_t iPacketSize, size_t iSampleCount,
+                                           VoiceCipher* pCipher, AES* pAES, unsigned char* pDecryptedOut, VoiceDatagramContent& packetOut);
+
+
+    // Applies SM_VOICE_FEATURES of the server: enables 'pCipher' (VF_AUTHENTICATED_CTR) and sets the codec of 'pCodec'.
+    // Returns true if the server expects the answer: SM_VOICE_FEATURES with 'cAnswerOut' (the features we understand).
+
+        static bool    applyVoiceFeatures (unsigned char cFeatures, VoiceCipher* pCipher, VoiceCodec* pCodec, unsigned char& cAnswerOut);
+
+
+    // Same as buildClientPacket() with the speaker in front ('iSpeakerId' and 'iSpeakerSequence' or 'sUserName' if it's -1),
+    // 'pOut' should have VOICE_DATAGRAM_MAX_SERVER_SIZE bytes.
+
+        static size_t  buildServerPacket  (int iSpeakerId, unsigned short iSpeakerSequence, const std::string& sUserName,
+                                           const short int* pSamples, size_t iSampleCount,
+                                           bool bLast, VoiceCodec* pCodec, VoiceCipher* pCipher, AES* pAES, unsigned char* pOut);
+
+
+    // Same as openServerPacket() for the packets of buildClientPacket() (no speaker).
+
+        static bool    openClientPacket   (unsigned char* pPacket, size_t iPacketSize, size_t iSampleCount,
+                                           VoiceCipher* pCipher, AES* pAES, unsigned char* pDecryptedOut, VoiceDatagramContent& packetOut);
+
+
+private:
+
+        // The packet after the speaker ('iSpeakerSize' bytes already written to / read from the packet).
+        static size_t  buildPacket        (size_t iSpeakerSize, const short int* pSamples, size_t iSampleCount, bool bLast,
+                                           VoiceCodec* pCodec, VoiceCipher* pCipher, AES* pAES, unsigned char* pOut);
+        static bool    openPacket         (unsigned char* pPacket, size_t iPacketSize, size_t iSpeakerSize, size_t iSampleCount,
+                                           VoiceCipher* pCipher, AES* pAES, unsigned char* pDecryptedOut, VoiceDatagramContent& packetOut);
+
+        // Returns the size of the speaker part or 0 if the packet is damaged.
+        static size_t  readSpeaker        (const unsigned char* pPacket, size_t iPacketSize, VoiceDatagramContent& packetOut);
+};
@@ -0,0 +1,109 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "voicepacketqueue.h"
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+VoicePacketQueue::VoicePacketQueue()
+{
+    for (size_t i = 0;  i < VOICE_QUEUE_CAPACITY;  i++)
+    {
+        vPackets[i].pAudio              = nullptr;
+        vPackets[i].bLast               = false;
+        vPackets[i].iSequence           = 0;
+        vPackets[i].bSequenceFromServer = false;
+    }
+
+    iReadIndex  = 0;
+    iWriteIndex = 0;
+}
+
+bool VoicePacketQueue::push(short int* pAudio, bool bLast, unsigned int iSequence, bool bSequenceFromServer)
+{
+    size_t iWrite = iWriteIndex .load (std::memory_order_relaxed);
+    size_t iRead  = iReadIndex  .load (std::memory_order_acquire);
+
+    if (iWrite - iRead >= VOICE_QUEUE_CAPACITY)
+    {
+        // Full.
+        return false;
+    }
+
+
+    VoicePacket& packet = vPackets[iWrite % VOICE_QUEUE_CAPACITY];
+
+    packet.pAudio              = pAudio;
+    packet.bLast               = bLast;
+    packet.iSequence           = iSequence;
+    packet.bSequenceFromServer = bSequenceFromServer;
+    packet.arrivalTime         = std::chrono::steady_clock::now();
+
+
+    iWriteIndex.store (iWrite + 1, std::memory_order_release);
+
+    return true;
+}
+
+bool VoicePacketQueue::pop(VoicePacket& packet)
+{
+    VoicePacket* pFront = front();
+
+    if (pFront == nullptr)
+    {
+        return false;
+    }
+
+    packet = *pFront;
+    pFront->pAudio = nullptr;
+
+
+    iReadIndex.store (iReadIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+    return true;
+}
+
+VoicePacket* VoicePacketQueue::front()
+{
+    size_t iRead  = iReadIndex  .load (std::memory_order_relaxed);
+    size_t iWrite = iWriteIndex .load (std::memory_order_acquire);
+
+    if (iRead == iWrite)
+    {
+        return nullptr;
+    }
+
+    return &vPackets[iRead % VOICE_QUEUE_CAPACITY];
+}
+
+size_t VoicePacketQueue::size() const
+{
+    size_t iWrite = iWriteIndex .load (std::memory_order_acquire);
+    size_t iRead  = iReadIndex  .load (std::memory_order_acquire);
+
+    return iWrite - iRead;
+}
+
+void VoicePacketQueue::clear()
+{
+    VoicePacket packet;
+
+    while ( pop(packet) )
+    {
+        if (packet.pAudio)
+        {
+            delete[] packet.pAudio;
+        }
+    }
+}
+
+VoicePacketQueue::~VoicePacketQueue()
+{
+    clear();
+}
@@ -0,0 +1,88 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+
+// Max packets that one speaker may have waiting for the playback (~560 ms of audio).
+// Packets that come when the queue is full are dropped.
+#define  VOICE_QUEUE_CAPACITY        16
+
+// How much packets we wait for before starting the playback of a speaker.
+#define  VOICE_QUEUE_PREBUFFER       2
+
+
+
+struct VoicePacket
+{
+    // nullptr if this packet is the "last packet" marker.
+    short int*                             pAudio;
+
+    std::chrono::steady_clock::time_point  arrivalTime;
+
+    // Packet number in the speaker's stream (not used by the "last packet" marker).
+    unsigned int                           iSequence;
+
+    // 'iSequence' came with the packet (UDP_SM_VOICE_BY_ID): the lost and the reordered packets can be seen.
+    // Otherwise the packets are numbered as they arrive.
+    bool                                   bSequenceFromServer;
+
+    bool                                   bLast;
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Lock-free single-producer/single-consumer queue of the voice packets of one speaker.
+// The producer is the UDP listen thread (NetworkService), the consumer is the playback thread (AudioService).
+class VoicePacketQueue
+{
+
+public:
+
+    VoicePacketQueue();
+
+
+    // Producer
+
+        // Takes the ownership of 'pAudio' only if returned true.
+        bool         push       (short int* pAudio, bool bLast, unsigned int iSequence, bool bSequenceFromServer);
+
+
+    // Consumer
+
+        bool         pop        (VoicePacket& packet);
+        // Returns nullptr if empty.
+        VoicePacket* front      ();
+        size_t       size       () const;
+
+
+    // Should be called only when neither producer nor consumer is running.
+
+        void         clear      ();
+
+
+    ~VoicePacketQueue();
+
+private:
+
+    VoicePacket                      vPackets[VOICE_QUEUE_CAPACITY];
+
+
+    // Written only by the consumer.
+    alignas(64) std::atomic<size_t>  iReadIndex;
+    // Written only by the producer.
+    alignas(64) std::atomic<size_t>  iWriteIndex;
+};
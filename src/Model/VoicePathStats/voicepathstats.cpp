@@ -0,0 +1,135 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "voicepathstats.h"
+
+
+// STL
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+
+// Custom
+#include "Model/LatencyHistogram/latencyhistogram.h"
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+VoicePathStats::VoicePathStats()
+{
+    for (size_t i = 0;  i < VPS_COUNT;  i++)
+    {
+        vStages[i] = new LatencyHistogram();
+    }
+}
+
+void VoicePathStats::record(VOICE_PATH_STAGE stage, unsigned long long iMicroseconds)
+{
+    vStages[stage]->record(iMicroseconds);
+}
+
+void VoicePathStats::recordSince(VOICE_PATH_STAGE stage, VoiceClock::time_point start)
+{
+    long long iMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>( VoiceClock::now() - start ).count();
+
+    vStages[stage]->record( (iMicroseconds > 0) ? static_cast<unsigned long long>(iMicroseconds) : 0 );
+}
+
+void VoicePathStats::reset()
+{
+    for (size_t i = 0;  i < VPS_COUNT;  i++)
+    {
+        vStages[i]->reset();
+    }
+}
+
+bool VoicePathStats::getStats(VOICE_PATH_STAGE stage, LatencyStats* pStats) const
+{
+    return vStages[stage]->getStats(pStats);
+}
+
+std::string VoicePathStats::format() const
+{
+    std::string sText = "Voice path latency (microseconds):\n";
+
+    char vLine[256];
+
+    std::snprintf(vLine, sizeof(vLine), "%-16s %10s %9s %9s %9s %9s %9s %11s\n",
+                  "stage", "count", "min", "p50", "p90", "p99", "max", "mean");
+
+    sText += vLine;
+
+
+    for (size_t i = 0;  i < VPS_COUNT;  i++)
+    {
+        VOICE_PATH_STAGE stage = static_cast<VOICE_PATH_STAGE>(i);
+
+        LatencyStats stats;
+
+        if ( getStats(stage, &stats) == false )
+        {
+            std::snprintf(vLine, sizeof(vLine), "%-16s %10d\n", getStageName(stage), 0);
+        }
+        else
+        {
+            std::snprintf(vLine, sizeof(vLine), "%-16s %10llu %9llu %9llu %9llu %9llu %9llu %11.1f\n",
+                          getStageName(stage), stats.iCount, stats.iMinUS, stats.iP50US, stats.iP90US, stats.iP99US,
+                          stats.iMaxUS, stats.dMeanUS);
+        }
+
+        sText += vLine;
+    }
+
+
+    return sText;
+}
+
+bool VoicePathStats::saveToFile(const std::wstring& sPath, const std::string& sMoreStats) const
+{
+    // Append: keep the stats of the previous sessions (releases) to compare with.
+
+    std::ofstream file(sPath, std::ios::app);
+
+    if ( file.is_open() == false )
+    {
+        return true;
+    }
+
+
+    time_t     now = time(nullptr);
+    char       vTime[64];
+    std::strftime(vTime, sizeof(vTime), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+
+    file << "\n" << vTime << "\n" << format() << sMoreStats;
+
+
+    return file.fail();
+}
+
+const char* VoicePathStats::getStageName(VOICE_PATH_STAGE stage)
+{
+    switch (stage)
+    {
+    case(VPS_CAPTURE_RING):    return "capture_ring";
+    case(VPS_CAPTURE_TO_SEND): return "capture_to_send";
+    case(VPS_SEND):            return "send";
+    case(VPS_RECEIVE):         return "receive";
+    case(VPS_JITTER_BUFFER):   return "jitter_buffer";
+    case(VPS_OUTPUT_QUEUE):    return "output_queue";
+    default:                   return "unknown";
+    }
+}
+
+VoicePathStats::~VoicePathStats()
+{
+    for (size_t i = 0;  i < VPS_COUNT;  i++)
+    {
+        delete vStages[i];
+    }
+}
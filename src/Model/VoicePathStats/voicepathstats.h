@@ -0,0 +1,92 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <chrono>
+#include <string>
+
+
+class LatencyHistogram;
+struct LatencyStats;
+
+
+// File (in the Documents folder) that saveToFile() is called with.
+#define  VOICE_PATH_STATS_FILE_NAME  L"SilentVoiceStats.txt"
+
+
+// All the voice path timestamps are taken from this clock.
+typedef std::chrono::steady_clock  VoiceClock;
+
+
+enum VOICE_PATH_STAGE
+{
+    // Our voice.
+    VPS_CAPTURE_RING     = 0,  // frame read from the input device -> taken by the encoder thread
+    VPS_CAPTURE_TO_SEND  = 1,  // frame read from the input device -> its packet is sent (whole sending side)
+    VPS_SEND             = 2,  // NetworkService::sendVoiceMessage(): codec, encryption, sendto()
+
+    // Voice of the other users.
+    VPS_RECEIVE          = 3,  // datagrams received -> packet queued for the playback: decryption, codec
+    VPS_JITTER_BUFFER    = 4,  // packet queued -> mixed for the playout: the playback thread and the jitter buffer
+    VPS_OUTPUT_QUEUE     = 5,  // audio queued in the output device ahead of the mixed frame (from the busy buffers)
+
+    VPS_COUNT            = 6
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Latency of each stage of the voice path in its own LatencyHistogram.
+// record() is lock-free (the audio and network threads call it), the rest can be called from any thread.
+// Owned by the AudioService, the NetworkService records the network stages.
+class VoicePathStats
+{
+
+public:
+
+    VoicePathStats();
+
+
+    // Record
+
+        void         record         (VOICE_PATH_STAGE stage, unsigned long long iMicroseconds);
+
+        // From 'start' till now.
+        void         recordSince    (VOICE_PATH_STAGE stage, VoiceClock::time_point start);
+
+        void         reset          ();
+
+
+    // Returns false if nothing was recorded for this stage.
+
+        bool         getStats       (VOICE_PATH_STAGE stage, LatencyStats* pStats) const;
+
+
+    // Output
+
+        // One line per stage (count, min, p50, p90, p99, max, mean).
+        std::string  format         () const;
+
+        // 'sMoreStats' is written after the table (e.g. AudioService::formatJitterBufferStats()).
+        // Returns true if failed to write the file.
+        bool         saveToFile     (const std::wstring& sPath, const std::string& sMoreStats = "") const;
+
+
+        static const char*  getStageName   (VOICE_PATH_STAGE stage);
+
+
+    ~VoicePathStats();
+
+private:
+
+    LatencyHistogram*  vStages[VPS_COUNT];
+};
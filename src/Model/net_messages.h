@@ -0,0 +1,95 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// First byte of the TCP messages (after the connection is established).
+// note: also change in the server
+
+
+enum ROOM_COMMAND
+{
+    RC_ENTER_ROOM           = 15,
+    RC_ENTER_ROOM_WITH_PASS = 16,
+
+    RC_CAN_ENTER_ROOM       = 20,
+    RC_ROOM_IS_FULL         = 21,
+    RC_PASSWORD_REQ         = 22,
+    RC_WRONG_PASSWORD       = 23,
+
+    RC_USER_ENTERS_ROOM     = 25,
+    RC_SERVER_MOVED_ROOM    = 26,
+    RC_SERVER_DELETES_ROOM  = 27,
+    RC_SERVER_CREATES_ROOM  = 28,
+    RC_SERVER_CHANGES_ROOM  = 29
+};
+
+enum SERVER_MESSAGE
+{
+    SM_NEW_USER             = 0,
+    SM_SOMEONE_DISCONNECTED = 1,
+    SM_CAN_START_UDP        = 2,
+    SM_SPAM_NOTICE          = 3,
+    SM_PING                 = 8,
+    SM_KEEPALIVE            = 9,
+    SM_USERMESSAGE          = 10,
+    SM_KICKED               = 11,
+    SM_WRONG_PASSWORD_WAIT  = 12,
+    SM_GLOBAL_MESSAGE       = 13,
+    SM_VOICE_FEATURES       = 14,
+    SM_SPEAKER_IDS          = 30
+};
+
+
+// First byte of the answer to the connect request (see NetworkService::setupChatConnection()).
+
+enum CONNECT_MESSAGE
+{
+    CM_USERNAME_INUSE       = 0,
+    CM_SERVER_FULL          = 2,
+    CM_WRONG_CLIENT         = 3,
+    CM_SERVER_INFO          = 4,
+    CM_NEED_PASSWORD        = 5
+};
+
+// VF_AUTHENTICATED_CTR relay: the server opens every voice packet of a speaker and seals it again for each listener
+// with the listener's next send sequence number (never forwards it as is), the client has one replay window
+// (VOICE_CIPHER_REPLAY_WINDOW packets) and one sequence space for all voice from the server.
+
+enum VOICE_FEATURE
+{
+    VF_AUTHENTICATED_CTR    = 1, // voice packets use VoiceCipher instead of ECB
+    VF_SPEAKER_IDS          = 2, // the server can send SM_SPEAKER_IDS and UDP_SM_VOICE_BY_ID voice packets
+                                 // (only after we answer with SM_VOICE_FEATURES that has this flag)
+    VF_ADPCM_CODEC          = 4  // we can send VM_ADPCM_MESSAGE voice packets (VoiceCodec)
+};
+
+enum USER_DISCONNECT_REASON
+{
+    UDR_DISCONNECT          = 0,
+    UDR_LOST                = 1,
+    UDR_KICKED              = 2
+};
+
+
+// First byte of the UDP messages.
+
+enum VOICE_MESSAGE
+{
+    VM_DEFAULT_MESSAGE      = 1, // PCM
+    VM_LAST_MESSAGE         = 2,
+    VM_ADPCM_MESSAGE        = 3  // IMA ADPCM (VC_IMA_ADPCM)
+};
+
+enum UDP_SERVER_MESSAGE
+{
+    UDP_SM_PREPARE          = -1,
+    UDP_SM_PING             =  0,
+    UDP_SM_FIRST_PING       = -2,
+    UDP_SM_USER_READY       = -3,
+    UDP_SM_VOICE_BY_ID      = -4  // voice packet header has the speaker id (2 bytes) and the speaker's packet number (2 bytes)
+                                  // instead of the user name
+};
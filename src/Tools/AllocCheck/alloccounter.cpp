@@ -0,0 +1,83 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "alloccounter.h"
+
+
+// STL
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+
+static std::atomic<unsigned long long> iAllocCount(0);
+
+
+unsigned long long getAllocCount()
+{
+    return iAllocCount;
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+void* operator new(std::size_t iSize)
+{
+    iAllocCount++;
+
+    void* pMemory = std::malloc(iSize != 0 ? iSize : 1);
+
+    if (pMemory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return pMemory;
+}
+
+void* operator new[](std::size_t iSize)
+{
+    return operator new(iSize);
+}
+
+void* operator new(std::size_t iSize, const std::nothrow_t&) noexcept
+{
+    iAllocCount++;
+
+    return std::malloc(iSize != 0 ? iSize : 1);
+}
+
+void* operator new[](std::size_t iSize, const std::nothrow_t& tag) noexcept
+{
+    return operator new(iSize, tag);
+}
+
+void operator delete(void* pMemory) noexcept
+{
+    std::free(pMemory);
+}
+
+void operator delete[](void* pMemory) noexcept
+{
+    std::free(pMemory);
+}
+
+void operator delete(void* pMemory, std::size_t iSize) noexcept
+{
+    (void)iSize;
+
+    std::free(pMemory);
+}
+
+void operator delete[](void* pMemory, std::size_t iSize) noexcept
+{
+    (void)iSize;
+
+    std::free(pMemory);
+}
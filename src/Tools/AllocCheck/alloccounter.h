@@ -0,0 +1,12 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// alloccounter.cpp replaces the global operator new / delete of the program that links it,
+// every allocation of the process (all threads) is counted.
+
+    unsigned long long  getAllocCount  ();
@@ -0,0 +1,355 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+
+// STL
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Custom
+#include "Tools/AllocCheck/alloccounter.h"
+#include "Model/AudioBackend/fileaudiobackend.h"
+#include "Model/AudioCaptureRing/audiocapturering.h"
+#include "Model/AudioDSP/audiodsp.h"
+#include "Model/VoiceActivityDetector/voiceactivitydetector.h"
+#include "Model/VoiceCipher/voicecipher.h"
+#include "Model/VoiceCodec/voicecodec.h"
+#include "Model/VoiceDatagram/voicedatagram.h"
+#include "Tools/LoopbackServer/loopbacknet.h"
+#include "AES/AES.h"
+
+
+// Same as in the AudioService.
+#define  ALLOC_CHECK_SAMPLE_RATE      19400
+#define  ALLOC_CHECK_FRAME_SAMPLES    679
+#define  ALLOC_CHECK_FRAME_MS         35
+
+// The input volume (not 100%) so the gain is applied like in the AudioService.
+#define  ALLOC_CHECK_GAIN             1.45f
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+struct AllocCheckOptions
+{
+    std::string   sInputWavPath;
+
+    unsigned int  iWarmUpFrames;
+    unsigned int  iFrames;
+};
+
+struct AllocCheckCase
+{
+    const char*  pName;
+
+    VOICE_CODEC  codec;
+    bool         bAuthenticatedCTR;
+};
+
+
+static const AllocCheckCase vCases[] =
+{
+    { "pcm + ecb",    VC_PCM,        false },
+    { "pcm + ctr",    VC_PCM,        true  },
+    { "adpcm + ecb",  VC_IMA_ADPCM,  false },
+    { "adpcm + ctr",  VC_IMA_ADPCM,  true  },
+};
+
+
+static void printUsage()
+{
+    std::printf(
+        "Checks that the voice send path (capture -> gain -> encode -> encrypt -> send) does not allocate memory\n"
+        "for each frame. The capture loops a WAV fixture (FileAudioBackend) without waiting for the clock,\n"
+        "the packets are sent to a local UDP socket.\n"
+        "\n"
+        "Usage: SilentAllocCheck [options]\n"
+        "\n"
+        "  --input PATH        WAV fixture to capture (res/sounds/connect.wav)\n"
+        "  --warmup N          frames to send before counting (100)\n"
+        "  --frames N          frames to count the allocations in (2000)\n"
+        "\n"
+        "Exit code: 0 - no allocations after the warm-up, 1 - there were some, 2 - setup failed.\n");
+}
+
+static bool readOption(int argc, char* argv[], int& i, std::string& sValueOut)
+{
+    if (i + 1 >= argc)
+    {
+        std::printf("Option %s needs a value.\n", argv[i]);
+
+        return true;
+    }
+
+    i++;
+    sValueOut = argv[i];
+
+    return false;
+}
+
+// Sends one frame like the AudioService (captureFrame(), encodeFrame(), sendAudioDataOnTalk())
+// and the NetworkService (sendVoiceMessage()). Returns true if failed.
+static bool sendFrame(AudioCaptureStream* pCapture, AudioCaptureRing* pRing, VoiceActivityDetector* pDetector,
+                      VoiceCodec* pCodec, VoiceCipher* pCipher, AES* pAES, LoopbackSocket sock, short int* pPacket)
+{
+    // Capture thread.
+
+    short int* pFrame = pRing->getWriteFrame();
+
+    if ( (pFrame == nullptr) || pCapture->read(pFrame) )
+    {
+        return true;
+    }
+
+    pRing->pushFrame();
+
+
+    // Encoder thread.
+
+    const AudioCaptureRingFrame* pRingFrame = pRing->waitFrame();
+
+    std::memcpy( pPacket, pRingFrame->pSamples, ALLOC_CHECK_FRAME_SAMPLES * sizeof(short int) );
+
+    pRing->popFrame();
+
+
+    AudioDSP::applyGain(pPacket, ALLOC_CHECK_FRAME_SAMPLES, ALLOC_CHECK_GAIN);
+
+    // Every frame is sent (whatever the detector says) so every frame goes through the whole path.
+    pDetector->process(pPacket, ALLOC_CHECK_FRAME_SAMPLES);
+
+
+    unsigned char vSend[VOICE_DATAGRAM_MAX_SIZE];
+
+    size_t iSize = VoiceDatagram::buildClientPacket(pPacket, ALLOC_CHECK_FRAME_SAMPLES, false, pCodec, pCipher, pAES, vSend);
+
+    return send( sock, reinterpret_cast<char*>(vSend), static_cast<int>(iSize), 0 ) != static_cast<int>(iSize);
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+int main(int argc, char* argv[])
+{
+    AllocCheckOptions options;
+    options.sInputWavPath = "res/sounds/connect.wav";
+    options.iWarmUpFrames = 100;
+    options.iFrames       = 2000;
+
+    for (int i = 1;  i < argc;  i++)
+    {
+        std::string sOption = argv[i];
+        std::string sValue;
+
+        if ( (sOption == "--help") || (sOption == "-h") )
+        {
+            printUsage();
+
+            return 0;
+        }
+        else if ( (sOption == "--input") || (sOption == "--warmup") || (sOption == "--frames") )
+        {
+            if ( readOption(argc, argv, i, sValue) )
+            {
+                return 2;
+            }
+
+            if (sOption == "--input")
+            {
+                options.sInputWavPath = sValue;
+            }
+            else if (sOption == "--warmup")
+            {
+                options.iWarmUpFrames = static_cast<unsigned int>( std::atoi(sValue.c_str()) );
+            }
+            else
+            {
+                options.iFrames = static_cast<unsigned int>( std::atoi(sValue.c_str()) );
+            }
+        }
+        else
+        {
+            std::printf("Unknown option: %s\n\n", argv[i]);
+
+            printUsage();
+
+            return 2;
+        }
+    }
+
+    if (options.iFrames == 0)
+    {
+        std::printf("--frames should be at least 1.\n");
+
+        return 2;
+    }
+
+
+
+    // Local UDP "server" (nobody reads it, the packets that don't fit are dropped by the system).
+
+    if ( loopbackStartup() )
+    {
+        std::printf("Socket startup failed: %d\n", getLoopbackError());
+
+        return 2;
+    }
+
+    LoopbackSocket sockServer = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    LoopbackSocket sockClient = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+    sockaddr_in addrServer;
+    std::memset(&addrServer, 0, sizeof(addrServer));
+    addrServer.sin_family      = AF_INET;
+    addrServer.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addrServer.sin_port        = 0;
+
+    LoopbackSockLen iAddrSize = sizeof(addrServer);
+
+    if ( (sockServer == INVALID_SOCKET) || (sockClient == INVALID_SOCKET)
+         || (bind(sockServer, reinterpret_cast<sockaddr*>(&addrServer), sizeof(addrServer)) == SOCKET_ERROR)
+         || (getsockname(sockServer, reinterpret_cast<sockaddr*>(&addrServer), &iAddrSize) == SOCKET_ERROR)
+         || (::connect(sockClient, reinterpret_cast<sockaddr*>(&addrServer), sizeof(addrServer)) == SOCKET_ERROR) )
+    {
+        std::printf("UDP socket failed: %d\n", getLoopbackError());
+
+        return 2;
+    }
+
+
+
+    // Send path (everything is created before the counting like in the client).
+
+    FileAudioBackend backend(options.sInputWavPath, "", 0.0f);
+
+    AudioStreamFormat format;
+    format.iSampleRate   = ALLOC_CHECK_SAMPLE_RATE;
+    format.iFrameSamples = ALLOC_CHECK_FRAME_SAMPLES;
+
+    std::string sError;
+
+    AudioCaptureStream* pCapture = backend.openCapture(L"", format, sError);
+
+    if ( (pCapture == nullptr) || pCapture->start() )
+    {
+        std::printf("Capture failed: %s\n", pCapture ? pCapture->getLastError().c_str() : sError.c_str());
+
+        return 2;
+    }
+
+    AudioCaptureRing*      pRing     = new AudioCaptureRing(ALLOC_CHECK_FRAME_SAMPLES);
+    VoiceActivityDetector* pDetector = new VoiceActivityDetector(ALLOC_CHECK_FRAME_MS);
+    VoiceCodec*            pCodec    = new VoiceCodec();
+    VoiceCipher*           pCipher   = new VoiceCipher();
+    AES*                   pAES      = new AES(128);
+    short int*             pPacket   = new short int[ALLOC_CHECK_FRAME_SAMPLES];
+
+    unsigned char vSessionKey[LOOPBACK_SESSION_KEY_SIZE];
+
+    for (size_t i = 0;  i < sizeof(vSessionKey);  i++)
+    {
+        vSessionKey[i] = static_cast<unsigned char>(std::rand() % 256);
+    }
+
+    pAES->SetKey(vSessionKey);
+    pCipher->deriveKeys(pAES);
+
+
+    if (getAllocCount() == 0)
+    {
+        // The objects above were allocated, the operator new of this tool is not used.
+        std::printf("Allocations are not counted (operator new is not replaced).\n");
+
+        return 2;
+    }
+
+
+
+    // Check.
+
+    std::printf("warm-up: %u frames, counted: %u frames\n\n", options.iWarmUpFrames, options.iFrames);
+    std::printf("%-14s %14s %14s\n", "case", "allocations", "per frame");
+
+    bool bAllocated = false;
+    bool bFailed    = false;
+
+    for (size_t iCase = 0;  (iCase < sizeof(vCases) / sizeof(vCases[0])) && (bFailed == false);  iCase++)
+    {
+        pCodec->setCodec(vCases[iCase].codec);
+
+        pCipher->reset();
+        pCipher->setEnabled(vCases[iCase].bAuthenticatedCTR);
+
+        pDetector->reset();
+
+
+        for (unsigned int i = 0;  (i < options.iWarmUpFrames) && (bFailed == false);  i++)
+        {
+            bFailed = sendFrame(pCapture, pRing, pDetector, pCodec, pCipher, pAES, sockClient, pPacket);
+        }
+
+
+        unsigned long long iAllocsBefore = getAllocCount();
+
+        for (unsigned int i = 0;  (i < options.iFrames) && (bFailed == false);  i++)
+        {
+            bFailed = sendFrame(pCapture, pRing, pDetector, pCodec, pCipher, pAES, sockClient, pPacket);
+        }
+
+        unsigned long long iAllocs = getAllocCount() - iAllocsBefore;
+
+
+        if (bFailed)
+        {
+            std::printf("%-14s failed: %s (socket error %d)\n", vCases[iCase].pName, pCapture->getLastError().c_str(), getLoopbackError());
+
+            break;
+        }
+
+        std::printf("%-14s %14llu %14.3f\n", vCases[iCase].pName, iAllocs, static_cast<double>(iAllocs) / options.iFrames);
+
+        if (iAllocs != 0)
+        {
+            bAllocated = true;
+        }
+    }
+
+
+
+    pCapture->stop();
+
+    delete[] pPacket;
+    delete   pAES;
+    delete   pCipher;
+    delete   pCodec;
+    delete   pDetector;
+    delete   pRing;
+    delete   pCapture;
+
+    closeLoopbackSocket(sockClient);
+    closeLoopbackSocket(sockServer);
+
+    loopbackCleanup();
+
+
+    if (bFailed)
+    {
+        return 2;
+    }
+
+    std::printf( "\n%s\n", bAllocated ? "FAILED: the send path allocates memory." : "OK: no allocations after the warm-up." );
+
+    return bAllocated ? 1 : 0;
+}
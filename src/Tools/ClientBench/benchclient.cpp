@@ -0,0 +1,156 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "benchclient.h"
+
+
+// Custom
+#include "Model/AudioBackend/fileaudiobackend.h"
+#include "Model/AudioService/audioservice.h"
+#include "Model/ModelEventSink/recordingeventsink.h"
+#include "Model/NetworkService/networkservice.h"
+#include "Model/SettingsManager/settingsmanager.h"
+
+// Other
+#define _WINSOCKAPI_    // stops windows.h from including winsock.h
+#include <Windows.h>
+#include <tlhelp32.h>
+
+
+// Lines of the client output kept by the event sink (for the errors).
+#define  BENCH_CLIENT_KEEP_LINES   32
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+BenchClient::BenchClient(const std::string& sUserName, const std::string& sInputWavPath)
+{
+    this->sUserName  = sUserName;
+
+    pEventSink       = new RecordingEventSink(BENCH_CLIENT_KEEP_LINES);
+    pSettingsManager = new SettingsManager(pEventSink);
+
+    // Real time (the jitter buffer and the output queue latency are measured).
+    pAudioBackend    = new FileAudioBackend(sInputWavPath, "", 1.0f);
+
+    pAudioService    = new AudioService(pEventSink, pSettingsManager, pAudioBackend);
+    pNetworkService  = new NetworkService(pEventSink, pAudioService, pSettingsManager);
+
+    pAudioService->setNetworkService(pNetworkService);
+}
+
+void BenchClient::connect(const std::string& sAddress, unsigned short iPort)
+{
+    pNetworkService->start(sAddress, std::to_string(iPort), sUserName);
+}
+
+void BenchClient::disconnect()
+{
+    talk(false);
+
+    pNetworkService->disconnect();
+}
+
+bool BenchClient::isConnected() const
+{
+    return pEventSink->getOnlineCount() > 0;
+}
+
+void BenchClient::talk(bool bTalk)
+{
+    pAudioBackend->setPushToTalkPressed(bTalk);
+}
+
+AudioService* BenchClient::getAudioService()
+{
+    return pAudioService;
+}
+
+NetworkService* BenchClient::getNetworkService()
+{
+    return pNetworkService;
+}
+
+RecordingEventSink* BenchClient::getEventSink()
+{
+    return pEventSink;
+}
+
+BenchClient::~BenchClient()
+{
+    pNetworkService->stop();
+
+    delete pNetworkService;
+    delete pAudioService;
+    delete pSettingsManager;
+    delete pEventSink;
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+bool getBenchProcessStats(BenchProcessStats* pStats)
+{
+    // CPU time.
+
+    FILETIME creationTime;
+    FILETIME exitTime;
+    FILETIME kernelTime;
+    FILETIME userTime;
+
+    if ( GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime) == FALSE )
+    {
+        return true;
+    }
+
+    // In 100 ns.
+    unsigned long long iKernel = (static_cast<unsigned long long>(kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime;
+    unsigned long long iUser   = (static_cast<unsigned long long>(userTime.dwHighDateTime)   << 32) | userTime.dwLowDateTime;
+
+    pStats->iCPUTimeUS = (iKernel + iUser) / 10;
+
+
+
+    // Threads (the snapshot has the threads of all processes).
+
+    HANDLE hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+
+    if (hSnapshot == INVALID_HANDLE_VALUE)
+    {
+        return true;
+    }
+
+    DWORD iProcessId = GetCurrentProcessId();
+
+    THREADENTRY32 entry;
+    entry.dwSize = sizeof(entry);
+
+    pStats->iThreadCount = 0;
+
+    if ( Thread32First(hSnapshot, &entry) )
+    {
+        do
+        {
+            if (entry.th32OwnerProcessID == iProcessId)
+            {
+                pStats->iThreadCount++;
+            }
+
+        } while ( Thread32Next(hSnapshot, &entry) );
+    }
+
+    CloseHandle(hSnapshot);
+
+
+    return false;
+}
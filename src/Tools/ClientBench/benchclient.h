@@ -0,0 +1,89 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <string>
+
+
+class AudioService;
+class NetworkService;
+class SettingsManager;
+class RecordingEventSink;
+class FileAudioBackend;
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// The model of the Silent client without the view: NetworkService and AudioService with a FileAudioBackend
+// (no audio devices) and a RecordingEventSink, so the client code itself is what the benchmarks measure.
+class BenchClient
+{
+
+public:
+
+    // 'sInputWavPath' - the voice of this client (empty - silence), see talk().
+    // The played audio is discarded.
+    BenchClient(const std::string& sUserName, const std::string& sInputWavPath);
+
+
+    // Connection (see NetworkService::start()).
+
+        void                 connect             (const std::string& sAddress, unsigned short iPort);
+        void                 disconnect          ();
+
+        // True after the server sent the user list (other users are online).
+        bool                 isConnected         () const;
+
+
+    // Holds the push-to-talk button (the voice activation mode decides on the WAV itself).
+
+        void                 talk                (bool bTalk);
+
+
+    // GET
+
+        AudioService*        getAudioService     ();
+        NetworkService*      getNetworkService   ();
+        RecordingEventSink*  getEventSink        ();
+
+
+    ~BenchClient();
+
+private:
+
+    std::string              sUserName;
+
+
+    RecordingEventSink*      pEventSink;
+    SettingsManager*         pSettingsManager;
+    FileAudioBackend*        pAudioBackend;     // owned by the AudioService
+    AudioService*            pAudioService;
+    NetworkService*          pNetworkService;
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Threads and CPU time of this process.
+struct BenchProcessStats
+{
+    size_t              iThreadCount;
+
+    unsigned long long  iCPUTimeUS;    // user + kernel
+};
+
+
+// Returns true if failed.
+bool getBenchProcessStats(BenchProcessStats* pStats);
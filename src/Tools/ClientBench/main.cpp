@@ -0,0 +1,390 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+
+// STL
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Custom
+#include "Model/AudioService/audioservice.h"
+#include "Model/LatencyHistogram/latencyhistogram.h"
+#include "Model/NetworkService/networkservice.h"
+#include "Model/net_messages.h"
+#include "Model/net_params.h"
+#include "Model/VoicePathStats/voicepathstats.h"
+#include "Tools/ClientBench/benchclient.h"
+#include "Tools/LoopbackServer/loopbacknet.h"
+#include "Tools/LoopbackServer/loopbackserver.h"
+
+
+// How long to wait for the clients to connect.
+#define  CLIENT_BENCH_CONNECT_TIMEOUT_SEC  10
+
+// The thread count is sampled this often.
+#define  CLIENT_BENCH_SAMPLE_MS            100
+
+
+static void printUsage()
+{
+    std::printf(
+        "Benchmarks of the Silent client code (NetworkService and AudioService without the view and the audio devices)\n"
+        "against the loopback server.\n"
+        "\n"
+        "Usage: SilentClientBench [options]\n"
+        "\n"
+        "  --flood N           synthetic speakers that talk all the time (8)\n"
+        "  --clients N         clients that receive them (1)\n"
+        "  --loss PERCENT      voice packets to the clients that are dropped (0)\n"
+        "  --jitter MS         voice packets to the clients are delayed by [0, MS] (0)\n"
+        "  --reorder PERCENT   voice packets to the clients delayed by one more packet (0)\n"
+        "  --duplicate PERCENT voice packets to the clients sent twice (0)\n"
+        "  --corrupt PERCENT   voice packets to the clients with one byte changed (0)\n"
+        "  --ctr               the server advertises VF_AUTHENTICATED_CTR (the voice is sealed for each client)\n"
+        "  --speaker-ids       the server advertises VF_SPEAKER_IDS (the voice has the speaker id instead of the name)\n"
+        "  --adpcm             the server advertises VF_ADPCM_CODEC (the voice is IMA ADPCM in both directions)\n"
+        "  --keepalive MS      keep-alive interval of the server, its round trip is the TCP dispatch latency (%d)\n"
+        "  --port N            TCP and UDP port (51337)\n"
+        "  --connect ADDRESS   use this server instead of starting one in this process\n"
+        "                      (the impairments and the voice features are then up to that server)\n"
+        "                      (the in-process server adds 4 threads and 1 per client to the thread count)\n"
+        "  --warmup S          not measured (2)\n"
+        "  --duration S        measured (10)\n"
+        "\n"
+        "Prints the thread count, the CPU time, the latency of the receive -> playout stages of each client,\n"
+        "the datagrams per second and the syscalls per datagram of its UDP thread and the wake-ups of its TCP thread\n"
+        "(\"--flood 0\" for an idle connection).\n"
+        "Exits with 1 if any client failed to connect.\n",
+        INTERVAL_KEEPALIVE_SEC * 1000);
+}
+
+// Datagrams per second and syscalls per datagram of the UDP listening thread of a client
+// (the thread waits on the SocketReactor once before each receive() unless the last batch was full).
+static void printUDPReceive(const DatagramBatchCounters& start, const DatagramBatchCounters& end, double dSeconds)
+{
+    double dDatagrams = static_cast<double>(end.iDatagrams - start.iDatagrams);
+    double dReceives  = static_cast<double>(end.iReceives  - start.iReceives);
+    double dRecvCalls = static_cast<double>(end.iRecvCalls - start.iRecvCalls);
+
+    if (dDatagrams == 0.0)
+    {
+        std::printf("UDP receive: no datagrams, %.1f wake-ups/s\n", dReceives / dSeconds);
+
+        return;
+    }
+
+    std::printf("UDP receive: %.0f datagrams/s, %.2f recv() and at most %.2f syscalls (with the waits) per datagram, "
+                "%.1f wake-ups/s (%.1f datagrams each)\n",
+                dDatagrams / dSeconds, dRecvCalls / dDatagrams, (dRecvCalls + dReceives) / dDatagrams,
+                dReceives / dSeconds, dDatagrams / dReceives);
+}
+
+// Wake-ups of the TCP listening thread of a client per minute by the reason (see SocketReactor::wait()).
+static void printTCPWakeUps(const SocketReactorCounters& start, const SocketReactorCounters& end, double dSeconds)
+{
+    double vPerMinute[SRE_COUNT];
+    double dTotal = 0.0;
+
+    for (size_t i = 0;  i < SRE_COUNT;  i++)
+    {
+        vPerMinute[i] = static_cast<double>(end.vWaits[i] - start.vWaits[i]) * 60.0 / dSeconds;
+
+        dTotal += vPerMinute[i];
+    }
+
+    std::printf("TCP wake-ups: %.1f/min (%.1f read, %.1f woken up, %.1f timeout, %.1f error)\n",
+                dTotal, vPerMinute[SRE_READ], vPerMinute[SRE_WAKE_UP], vPerMinute[SRE_TIMEOUT], vPerMinute[SRE_ERROR]);
+}
+
+// Returns true if the option needs a value and there is none.
+static bool readOption(int argc, char* argv[], int& i, std::string& sValueOut)
+{
+    if (i + 1 >= argc)
+    {
+        std::printf("Option %s needs a value.\n", argv[i]);
+
+        return true;
+    }
+
+    i++;
+    sValueOut = argv[i];
+
+    return false;
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+int main(int argc, char* argv[])
+{
+    LoopbackServerConfig serverConfig;
+    serverConfig.iPeerCount  = 8;
+    serverConfig.iSilenceMS  = 0;
+    serverConfig.bEcho       = false;
+
+    std::string  sAddress     = "127.0.0.1";
+    bool         bStartServer = true;
+    size_t       iClientCount = 1;
+    unsigned int iWarmUpSec   = 2;
+    unsigned int iDurationSec = 10;
+
+
+    for (int i = 1;  i < argc;  i++)
+    {
+        std::string sOption = argv[i];
+        std::string sValue;
+
+        if ( (sOption == "--help") || (sOption == "-h") )
+        {
+            printUsage();
+
+            return 0;
+        }
+        else if (sOption == "--ctr")
+        {
+            serverConfig.cVoiceFeatures |= VF_AUTHENTICATED_CTR;
+
+            continue;
+        }
+        else if (sOption == "--speaker-ids")
+        {
+            serverConfig.cVoiceFeatures |= VF_SPEAKER_IDS;
+
+            continue;
+        }
+        else if (sOption == "--adpcm")
+        {
+            serverConfig.cVoiceFeatures |= VF_ADPCM_CODEC;
+
+            continue;
+        }
+
+        if ( readOption(argc, argv, i, sValue) )
+        {
+            return 2;
+        }
+
+        unsigned long iValue = std::strtoul(sValue.c_str(), nullptr, 10);
+        float         fValue = static_cast<float>( std::atof(sValue.c_str()) );
+
+        if      (sOption == "--flood")     serverConfig.iPeerCount        = iValue;
+        else if (sOption == "--clients")   iClientCount                   = iValue;
+        else if (sOption == "--loss")      serverConfig.fLossPercent      = fValue;
+        else if (sOption == "--jitter")    serverConfig.iJitterMS         = static_cast<unsigned int>(iValue);
+        else if (sOption == "--reorder")   serverConfig.fReorderPercent   = fValue;
+        else if (sOption == "--duplicate") serverConfig.fDuplicatePercent = fValue;
+        else if (sOption == "--corrupt")   serverConfig.fCorruptPercent   = fValue;
+        else if (sOption == "--keepalive") serverConfig.iKeepAliveMS      = static_cast<unsigned int>(iValue);
+        else if (sOption == "--port")      serverConfig.iPort             = static_cast<unsigned short>(iValue);
+        else if (sOption == "--connect")   { sAddress = sValue; bStartServer = false; }
+        else if (sOption == "--warmup")    iWarmUpSec                     = static_cast<unsigned int>(iValue);
+        else if (sOption == "--duration")  iDurationSec                   = static_cast<unsigned int>(iValue);
+        else
+        {
+            std::printf("Unknown option: %s\n\n", sOption.c_str());
+
+            printUsage();
+
+            return 2;
+        }
+    }
+
+
+    if ( loopbackStartup() )
+    {
+        std::printf("WSAStartup() failed.\n");
+
+        return 2;
+    }
+
+
+
+    // Server.
+
+    LoopbackServer* pServer = nullptr;
+
+    if (bStartServer)
+    {
+        pServer = new LoopbackServer(serverConfig);
+
+        std::string sError;
+
+        if ( pServer->start(sError) )
+        {
+            std::printf("Failed to start the server: %s.\n", sError.c_str());
+
+            delete pServer;
+            loopbackCleanup();
+
+            return 2;
+        }
+    }
+
+
+
+    // Clients.
+
+    std::vector<BenchClient*> vClients;
+
+    for (size_t i = 0;  i < iClientCount;  i++)
+    {
+        BenchClient* pClient = new BenchClient("bench" + std::to_string(i + 1), "");
+
+        pClient->connect(sAddress, serverConfig.iPort);
+
+        vClients.push_back(pClient);
+    }
+
+
+    size_t iConnectedCount = 0;
+
+    std::chrono::steady_clock::time_point connectStartTime = std::chrono::steady_clock::now();
+
+    while (std::chrono::steady_clock::now() - connectStartTime < std::chrono::seconds(CLIENT_BENCH_CONNECT_TIMEOUT_SEC))
+    {
+        iConnectedCount = 0;
+
+        for (size_t i = 0;  i < vClients.size();  i++)
+        {
+            if ( vClients[i]->isConnected() )
+            {
+                iConnectedCount++;
+            }
+        }
+
+        if (iConnectedCount == vClients.size())
+        {
+            break;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(CLIENT_BENCH_SAMPLE_MS));
+    }
+
+    std::printf("%zu speakers -> %zu clients (%zu connected)", serverConfig.iPeerCount, iClientCount, iConnectedCount);
+
+    if (bStartServer)
+    {
+        std::printf(", voice: %s, %s, %s",
+                    (serverConfig.cVoiceFeatures & VF_AUTHENTICATED_CTR) ? "ctr"   : "ecb",
+                    (serverConfig.cVoiceFeatures & VF_SPEAKER_IDS)       ? "ids"   : "names",
+                    (serverConfig.cVoiceFeatures & VF_ADPCM_CODEC)       ? "adpcm" : "pcm");
+    }
+
+    std::printf(".\n");
+
+
+
+    // Measure.
+
+    std::this_thread::sleep_for(std::chrono::seconds(iWarmUpSec));
+
+    std::vector<DatagramBatchCounters> vStartCounters;
+    std::vector<SocketReactorCounters> vStartTCPCounters;
+
+    for (size_t i = 0;  i < vClients.size();  i++)
+    {
+        vClients[i]->getAudioService()->getVoicePathStats()->reset();
+
+        vStartCounters   .push_back( vClients[i]->getNetworkService()->getUDPReceiveCounters() );
+        vStartTCPCounters.push_back( vClients[i]->getNetworkService()->getTCPReactorCounters() );
+    }
+
+    BenchProcessStats startStats;
+    getBenchProcessStats(&startStats);
+
+    size_t iMaxThreadCount = startStats.iThreadCount;
+
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    while (std::chrono::steady_clock::now() - startTime < std::chrono::seconds(iDurationSec))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(CLIENT_BENCH_SAMPLE_MS));
+
+        BenchProcessStats stats;
+
+        if ( (getBenchProcessStats(&stats) == false) && (stats.iThreadCount > iMaxThreadCount) )
+        {
+            iMaxThreadCount = stats.iThreadCount;
+        }
+    }
+
+    BenchProcessStats endStats;
+    getBenchProcessStats(&endStats);
+
+    std::vector<DatagramBatchCounters> vEndCounters;
+    std::vector<SocketReactorCounters> vEndTCPCounters;
+
+    for (size_t i = 0;  i < vClients.size();  i++)
+    {
+        vEndCounters   .push_back( vClients[i]->getNetworkService()->getUDPReceiveCounters() );
+        vEndTCPCounters.push_back( vClients[i]->getNetworkService()->getTCPReactorCounters() );
+    }
+
+    double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    double dCPUMS   = static_cast<double>(endStats.iCPUTimeUS - startStats.iCPUTimeUS) / 1000.0;
+
+
+
+    // Results.
+
+    std::printf("\nThreads: %zu (max %zu)\n", endStats.iThreadCount, iMaxThreadCount);
+    std::printf("CPU time: %.1f ms in %.1f s (%.1f%% of one core)\n", dCPUMS, dSeconds, dCPUMS / (dSeconds * 10.0));
+
+    for (size_t i = 0;  i < vClients.size();  i++)
+    {
+        AudioService* pAudioService = vClients[i]->getAudioService();
+
+        std::printf("\nClient %zu. %s%s", i + 1, pAudioService->getVoicePathStats()->format().c_str(),
+                    pAudioService->formatJitterBufferStats().c_str());
+
+        printUDPReceive(vStartCounters[i], vEndCounters[i], dSeconds);
+        printTCPWakeUps(vStartTCPCounters[i], vEndTCPCounters[i], dSeconds);
+    }
+
+    if (pServer)
+    {
+        // SM_KEEPALIVE is sent by the server and answered by the handler of the client's TCP thread:
+        // the round trip is the dispatch latency of the SocketReactor path (both ways on the loopback).
+
+        LatencyStats keepAliveStats;
+
+        if ( pServer->getStats(LSS_KEEPALIVE, &keepAliveStats) )
+        {
+            std::printf("\nTCP dispatch (keep-alive round trip, whole run): %llu, p50 %llu us, p99 %llu us, max %llu us\n",
+                        keepAliveStats.iCount, keepAliveStats.iP50US, keepAliveStats.iP99US, keepAliveStats.iMaxUS);
+        }
+
+        std::printf("\n%s", pServer->format().c_str());
+    }
+
+
+
+    // Stop.
+
+    for (size_t i = 0;  i < vClients.size();  i++)
+    {
+        vClients[i]->disconnect();
+
+        delete vClients[i];
+    }
+
+    if (pServer)
+    {
+        delete pServer;
+    }
+
+    loopbackCleanup();
+
+
+    return (iConnectedCount == iClientCount) ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "loopbackcheck.h"
+
+
+// STL
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Custom
+#include "Model/net_messages.h"
+#include "Model/LatencyHistogram/latencyhistogram.h"
+#include "Tools/LoopbackServer/loopbackclient.h"
+#include "Tools/LoopbackServer/loopbackserver.h"
+#include "Tools/ModelChecks/modelchecks.h"
+
+
+#define  LOOPBACK_CHECK_CLIENTS         2
+#define  LOOPBACK_CHECK_DURATION_MS     3000
+
+
+struct LoopbackCheckMode
+{
+    const char*    pName;
+
+    unsigned char  cVoiceFeatures;
+
+    // Duplicated and corrupted voice packets in both directions.
+    bool           bImpaired;
+};
+
+
+static const LoopbackCheckMode vModes[] =
+{
+    { "names, ecb",                          0,                                                        false },
+    { "ids, ecb",                            VF_SPEAKER_IDS,                                           false },
+    { "names, ctr",                          VF_AUTHENTICATED_CTR,                                     false },
+    { "ids, ctr",                            VF_AUTHENTICATED_CTR | VF_SPEAKER_IDS,                    false },
+    { "names, ecb, adpcm",                   VF_ADPCM_CODEC,                                           false },
+    { "ids, ctr, adpcm",                     VF_AUTHENTICATED_CTR | VF_SPEAKER_IDS | VF_ADPCM_CODEC,   false },
+    { "ids, ctr, duplicated and corrupted",  VF_AUTHENTICATED_CTR | VF_SPEAKER_IDS,                    true  },
+};
+
+
+static void runLoopbackMode(ModelCheckReport& report, unsigned short iPort, const LoopbackCheckMode& mode)
+{
+    std::string sMode = std::string(mode.pName) + ": ";
+
+
+    LoopbackServerConfig serverConfig;
+    serverConfig.iPort          = iPort;
+    serverConfig.iPeerCount     = 1;
+    serverConfig.iTalkMS        = 500;
+    serverConfig.iSilenceMS     = 200;
+    serverConfig.cVoiceFeatures = mode.cVoiceFeatures;
+
+    LoopbackClientConfig clientConfig;
+    clientConfig.iPort      = iPort;
+    clientConfig.iMessageMS = 500;
+
+    if (mode.bImpaired)
+    {
+        serverConfig.fDuplicatePercent = 10.0f;
+        serverConfig.fCorruptPercent   = 10.0f;
+
+        clientConfig.fDuplicatePercent = 10.0f;
+        clientConfig.fCorruptPercent   = 10.0f;
+    }
+
+
+    LoopbackServer server(serverConfig);
+
+    std::string sError;
+
+    if ( report.check(server.start(sError) == false, sMode + "the server failed to start: " + sError) )
+    {
+        return;
+    }
+
+
+    LoopbackClientStats clientStats;
+
+    std::vector<LoopbackClient*> vClients;
+
+    for (size_t i = 0;  i < LOOPBACK_CHECK_CLIENTS;  i++)
+    {
+        LoopbackClient* pClient = new LoopbackClient(clientConfig, "check" + std::to_string(i + 1), &clientStats);
+
+        report.check(pClient->connect(sError) == false, sMode + "client " + std::to_string(i + 1) + " failed to connect: " + sError);
+
+        vClients.push_back(pClient);
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(LOOPBACK_CHECK_DURATION_MS));
+
+    for (size_t i = 0;  i < vClients.size();  i++)
+    {
+        delete vClients[i];
+    }
+
+    server.stop();
+
+
+    LoopbackServerCounters counters = server.getCounters();
+
+    LatencyStats echo;
+    bool bEchoReceived = clientStats.getStats(LCS_VOICE_ECHO, &echo);
+
+
+    report.check(clientStats.iConnected == LOOPBACK_CHECK_CLIENTS, sMode + "not all clients got to the voice chat");
+    report.check(counters.iVoicePacketsIn > 0, sMode + "the server accepted no voice");
+    report.check(clientStats.iVoicePacketsReceived > 0, sMode + "the clients accepted no voice");
+    report.check(bEchoReceived, sMode + "no echo of our voice");
+    report.check(clientStats.iVoiceDamaged == 0, sMode + std::to_string(clientStats.iVoiceDamaged) + " damaged echo packets accepted");
+
+    // PCM packets have at least all the samples.
+
+    bool bSmallPackets = (clientStats.iVoicePacketsReceived > 0)
+                         && (clientStats.iVoiceBytesReceived / clientStats.iVoicePacketsReceived < LOOPBACK_FRAME_SAMPLES * sizeof(short));
+
+    if (mode.cVoiceFeatures & VF_ADPCM_CODEC)
+    {
+        report.check(bSmallPackets, sMode + "the voice is not compressed");
+    }
+    else
+    {
+        report.check(bSmallPackets == false, sMode + "the voice is compressed but ADPCM was not negotiated");
+    }
+
+    if (mode.cVoiceFeatures & VF_SPEAKER_IDS)
+    {
+        report.check(clientStats.iVoiceById > 0, sMode + "no voice packets with the speaker id");
+    }
+    else
+    {
+        report.check(clientStats.iVoiceById == 0, sMode + "voice packets with the speaker id were not negotiated");
+    }
+
+    if (mode.bImpaired)
+    {
+        report.check(clientStats.iVoiceRejected > 0, sMode + "the clients rejected nothing");
+        report.check(counters.iVoiceRejected > 0, sMode + "the server rejected nothing");
+    }
+    else
+    {
+        report.check(clientStats.iVoiceRejected == 0, sMode + std::to_string(clientStats.iVoiceRejected) + " packets rejected by the clients");
+        report.check(counters.iVoiceRejected == 0, sMode + std::to_string(counters.iVoiceRejected) + " packets rejected by the server");
+    }
+
+
+    std::printf("    %-36s voice in %llu (%llu rejected), out %llu; clients: %llu received (%llu rejected, %llu by id), echo %llu\n",
+                mode.pName, counters.iVoicePacketsIn, counters.iVoiceRejected, counters.iVoicePacketsOut,
+                clientStats.iVoicePacketsReceived.load(), clientStats.iVoiceRejected.load(), clientStats.iVoiceById.load(),
+                bEchoReceived ? echo.iCount : 0ULL);
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+void runLoopbackChecks(ModelCheckReport& report, unsigned short iPort)
+{
+    for (size_t i = 0;  i < sizeof(vModes) / sizeof(vModes[0]);  i++)
+    {
+        runLoopbackMode(report, iPort, vModes[i]);
+    }
+}
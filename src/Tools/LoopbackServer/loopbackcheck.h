@@ -0,0 +1,16 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+class ModelCheckReport;
+
+
+// Runs a LoopbackServer with two LoopbackClients on 'iPort' (a few seconds) in each voice mode the server can advertise
+// (the speaker names or ids, ECB or VF_AUTHENTICATED_CTR)
+// and checks that they connect, hear the echo and accept only the voice that was sent
+// (with VF_AUTHENTICATED_CTR the duplicated and corrupted packets should be rejected on both sides).
+void runLoopbackChecks(ModelCheckReport& report, unsigned short iPort);
@@ -0,0 +1,1106 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "loopbackclient.h"
+
+
+// STL
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+// Custom
+#include "Model/net_params.h"
+#include "Model/net_messages.h"
+#include "Model/LatencyHistogram/latencyhistogram.h"
+#include "Model/VoiceCipher/voicecipher.h"
+#include "Model/VoiceCodec/voicecodec.h"
+#include "Model/VoiceDatagram/voicedatagram.h"
+#include "Tools/LoopbackServer/loopbackserver.h"
+
+// External
+#include "AES/AES.h"
+
+
+// The UDP thread checks if the client is disconnected this often.
+#define  LOOPBACK_CLIENT_UDP_TIMEOUT_MS    100
+
+// Marks our voice packets (in the first samples) to find them among the echo peer's packets.
+#define  LOOPBACK_VOICE_MAGIC              0x534Cu
+
+// The stamp (the magic (16 bits) and the sequence number (32 bits)) in the first samples of each sent voice packet.
+// A bit is LOOPBACK_STAMP_BIT_SAMPLES samples: +amplitude then -amplitude for 1, the other way around for 0,
+// so it survives the ADPCM (the server decodes and encodes it again for the echo).
+#define  LOOPBACK_STAMP_BITS               48
+#define  LOOPBACK_STAMP_BIT_SAMPLES        8
+#define  LOOPBACK_STAMP_AMPLITUDE          8000
+
+
+static unsigned long long getLoopbackTimeUS()
+{
+    return static_cast<unsigned long long>( std::chrono::duration_cast<std::chrono::microseconds>(
+                                                std::chrono::steady_clock::now().time_since_epoch() ).count() );
+}
+
+static void writeVoiceStamp(short* pSamples, unsigned int iSequence)
+{
+    unsigned long long iStamp = (static_cast<unsigned long long>(LOOPBACK_VOICE_MAGIC) << 32) | iSequence;
+
+    for (size_t i = 0;  i < LOOPBACK_STAMP_BITS;  i++)
+    {
+        short iFirst = ((iStamp >> i) & 1) ? LOOPBACK_STAMP_AMPLITUDE : -LOOPBACK_STAMP_AMPLITUDE;
+
+        for (size_t k = 0;  k < LOOPBACK_STAMP_BIT_SAMPLES / 2;  k++)
+        {
+            pSamples[i * LOOPBACK_STAMP_BIT_SAMPLES + k]                                  = iFirst;
+            pSamples[i * LOOPBACK_STAMP_BIT_SAMPLES + LOOPBACK_STAMP_BIT_SAMPLES / 2 + k] = static_cast<short>(-iFirst);
+        }
+    }
+}
+
+// Returns true if there is no stamp.
+static bool readVoiceStamp(const short* pSamples, unsigned int& iSequenceOut)
+{
+    unsigned long long iStamp = 0;
+
+    for (size_t i = 0;  i < LOOPBACK_STAMP_BITS;  i++)
+    {
+        long long iDifference = 0;
+
+        for (size_t k = 0;  k < LOOPBACK_STAMP_BIT_SAMPLES / 2;  k++)
+        {
+            iDifference += pSamples[i * LOOPBACK_STAMP_BIT_SAMPLES + k] - pSamples[i * LOOPBACK_STAMP_BIT_SAMPLES + LOOPBACK_STAMP_BIT_SAMPLES / 2 + k];
+        }
+
+        if (iDifference > 0)
+        {
+            iStamp |= 1ULL << i;
+        }
+    }
+
+    iSequenceOut = static_cast<unsigned int>(iStamp & 0xFFFFFFFFu);
+
+    return (iStamp >> 32) != LOOPBACK_VOICE_MAGIC;
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+LoopbackClientConfig::LoopbackClientConfig()
+{
+    sAddress       = "127.0.0.1";
+    iPort          = 51337;
+    sClientVersion = CLIENT_VERSION;
+
+    bTalk          = true;
+    iMessageMS     = 1000;
+    iRoomChangeMS  = 0;
+
+    fDuplicatePercent = 0.0f;
+    fCorruptPercent   = 0.0f;
+}
+
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+LoopbackClientStats::LoopbackClientStats()
+{
+    for (size_t i = 0;  i < LCS_COUNT;  i++)
+    {
+        vStats[i] = new LatencyHistogram();
+    }
+
+    iConnected            = 0;
+    iFailed               = 0;
+    iVoicePacketsSent     = 0;
+    iVoicePacketsReceived = 0;
+    iVoiceBytesReceived   = 0;
+    iVoiceLastReceived    = 0;
+    iVoiceDamaged         = 0;
+    iVoiceRejected        = 0;
+    iVoiceById            = 0;
+    iVoiceUnknownSpeaker  = 0;
+    iPings                = 0;
+    iKeepAlives           = 0;
+    iUserEvents           = 0;
+    iUDPDatagrams         = 0;
+    iUDPRecvCalls         = 0;
+}
+
+void LoopbackClientStats::record(LOOPBACK_CLIENT_STAT stat, unsigned long long iMicroseconds)
+{
+    vStats[stat]->record(iMicroseconds);
+}
+
+bool LoopbackClientStats::getStats(LOOPBACK_CLIENT_STAT stat, LatencyStats* pStats) const
+{
+    return vStats[stat]->getStats(pStats);
+}
+
+std::string LoopbackClientStats::format(double dSeconds) const
+{
+    if (dSeconds <= 0.0)
+    {
+        dSeconds = 1.0;
+    }
+
+
+    char vLine[256];
+
+    std::string sText = "Loopback clients:\n";
+
+    std::snprintf(vLine, sizeof(vLine), "clients: %llu connected, %llu failed; pings: %llu; keep-alives: %llu; user events: %llu\n",
+                  iConnected.load(), iFailed.load(), iPings.load(), iKeepAlives.load(), iUserEvents.load());
+    sText += vLine;
+
+    std::snprintf(vLine, sizeof(vLine), "voice sent: %llu packets (%.1f/s)\n", iVoicePacketsSent.load(), iVoicePacketsSent / dSeconds);
+    sText += vLine;
+
+    std::snprintf(vLine, sizeof(vLine), "voice received: %llu packets (%.1f/s, %.1f kbit/s), %llu last, %llu damaged, %llu rejected\n",
+                  iVoicePacketsReceived.load(), iVoicePacketsReceived / dSeconds, iVoiceBytesReceived * 8 / dSeconds / 1000,
+                  iVoiceLastReceived.load(), iVoiceDamaged.load(), iVoiceRejected.load());
+    sText += vLine;
+
+    std::snprintf(vLine, sizeof(vLine), "speaker ids: %llu packets, %llu unknown\n", iVoiceById.load(), iVoiceUnknownSpeaker.load());
+    sText += vLine;
+
+    std::snprintf(vLine, sizeof(vLine), "udp receive: %llu datagrams (%.1f/s), %llu recv() calls (%.2f per datagram)\n",
+                  iUDPDatagrams.load(), iUDPDatagrams / dSeconds, iUDPRecvCalls.load(),
+                  (iUDPDatagrams > 0) ? static_cast<double>(iUDPRecvCalls) / iUDPDatagrams : 0.0);
+    sText += vLine;
+
+
+
+    std::snprintf(vLine, sizeof(vLine), "%-16s %10s %9s %9s %9s %9s %9s %11s\n",
+                  "latency (us)", "count", "min", "p50", "p90", "p99", "max", "mean");
+    sText += vLine;
+
+    for (size_t i = 0;  i < LCS_COUNT;  i++)
+    {
+        LOOPBACK_CLIENT_STAT stat = static_cast<LOOPBACK_CLIENT_STAT>(i);
+
+        LatencyStats stats;
+
+        if ( getStats(stat, &stats) == false )
+        {
+            std::snprintf(vLine, sizeof(vLine), "%-16s %10d\n", getStatName(stat), 0);
+        }
+        else
+        {
+            std::snprintf(vLine, sizeof(vLine), "%-16s %10llu %9llu %9llu %9llu %9llu %9llu %11.1f\n",
+                          getStatName(stat), stats.iCount, stats.iMinUS, stats.iP50US, stats.iP90US, stats.iP99US,
+                          stats.iMaxUS, stats.dMeanUS);
+        }
+
+        sText += vLine;
+    }
+
+
+    return sText;
+}
+
+const char* LoopbackClientStats::getStatName(LOOPBACK_CLIENT_STAT stat)
+{
+    switch (stat)
+    {
+    case(LCS_CONNECT):     return "connect";
+    case(LCS_VOICE_ECHO):  return "voice_echo";
+    case(LCS_MESSAGE):     return "message";
+    case(LCS_ROOM_CHANGE): return "room_change";
+    default:               return "unknown";
+    }
+}
+
+LoopbackClientStats::~LoopbackClientStats()
+{
+    for (size_t i = 0;  i < LCS_COUNT;  i++)
+    {
+        delete vStats[i];
+    }
+}
+
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+LoopbackClient::LoopbackClient(const LoopbackClientConfig& config, const std::string& sUserName, LoopbackClientStats* pStats)
+    : config(config)
+{
+    this->sUserName = sUserName;
+    this->pStats    = pStats;
+
+    sockTCP = INVALID_SOCKET;
+    sockUDP = INVALID_SOCKET;
+
+    pAES         = new AES(128);
+    pVoiceCipher = new VoiceCipher();
+    pVoiceCodec  = new VoiceCodec();
+
+    iRoom              = 0;
+    bRoomChangePending = false;
+    iVoiceSequence     = 0;
+
+    bConnected  = false;
+    bVoiceReady = false;
+
+    rndGen.seed( std::random_device{}() );
+
+    for (size_t i = 0;  i < LOOPBACK_CLIENT_SEND_TIMES;  i++)
+    {
+        vSentSequences[i] = 0;
+        vSendTimesUS[i]   = 0;
+    }
+
+
+    // Something to talk with (the echo peer plays it back).
+
+    vTone.resize(LOOPBACK_FRAME_SAMPLES);
+
+    for (size_t i = 0;  i < LOOPBACK_FRAME_SAMPLES;  i++)
+    {
+        vTone[i] = static_cast<short>( 2000.0 * std::sin(2.0 * 3.14159265358979323846 * 440.0 * static_cast<double>(i) / 19400.0) );
+    }
+}
+
+bool LoopbackClient::connect(std::string& sErrorOut)
+{
+    connectStartTime = std::chrono::steady_clock::now();
+
+
+    // Connect (see NetworkService::connectTo()).
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+
+    addrinfo* pResult = nullptr;
+
+    if ( getaddrinfo(config.sAddress.c_str(), std::to_string(config.iPort).c_str(), &hints, &pResult) != 0 )
+    {
+        sErrorOut = "getaddrinfo() failed";
+
+        pStats->iFailed++;
+
+        return true;
+    }
+
+    sockaddr_in addrServer;
+    std::memcpy(&addrServer, pResult->ai_addr, sizeof(addrServer));
+
+    freeaddrinfo(pResult);
+
+
+    sockTCP = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+    if ( (sockTCP == INVALID_SOCKET)
+         || (::connect(sockTCP, reinterpret_cast<sockaddr*>(&addrServer), sizeof(addrServer)) == SOCKET_ERROR) )
+    {
+        sErrorOut = "connect() failed and returned: " + std::to_string(getLoopbackError());
+
+        if (sockTCP != INVALID_SOCKET)
+        {
+            closeLoopbackSocket(sockTCP);
+            sockTCP = INVALID_SOCKET;
+        }
+
+        pStats->iFailed++;
+
+        return true;
+    }
+
+    setLoopbackNoDelay(sockTCP);
+
+
+
+    // Version, user name and password (see NetworkService::setupChatConnection()).
+
+    LoopbackPacket request;
+    request.writeString8(config.sClientVersion).writeString8(sUserName).writeU8(0);
+
+    unsigned char cAnswer = 0;
+
+    if ( sendAll(sockTCP, request.getData(), request.getSize())
+         || recvAll(sockTCP, reinterpret_cast<char*>(&cAnswer), sizeof(cAnswer)) )
+    {
+        sErrorOut = "the server closed the connection";
+    }
+    else if (cAnswer != CM_SERVER_INFO)
+    {
+        sErrorOut = "the server answered with " + std::to_string(cAnswer) + " (see CONNECT_MESSAGE)";
+    }
+    else if ( (receiveChatInfo(sErrorOut) == false) && (exchangeKeys(sErrorOut) == false) )
+    {
+        sErrorOut.clear();
+    }
+    else if (sErrorOut.empty())
+    {
+        sErrorOut = "the server closed the connection";
+    }
+
+    if (sErrorOut.empty() == false)
+    {
+        closeLoopbackSocket(sockTCP);
+        sockTCP = INVALID_SOCKET;
+
+        pStats->iFailed++;
+
+        return true;
+    }
+
+
+
+    // Voice connection (see NetworkService::setupVoiceConnection()).
+
+    sockUDP = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+    if ( (sockUDP == INVALID_SOCKET)
+         || (::connect(sockUDP, reinterpret_cast<sockaddr*>(&addrServer), sizeof(addrServer)) == SOCKET_ERROR)
+         || setLoopbackRecvTimeout(sockUDP, LOOPBACK_CLIENT_UDP_TIMEOUT_MS) )
+    {
+        sErrorOut = "UDP socket failed: " + std::to_string(getLoopbackError());
+
+        if (sockUDP != INVALID_SOCKET)
+        {
+            closeLoopbackSocket(sockUDP);
+            sockUDP = INVALID_SOCKET;
+        }
+
+        closeLoopbackSocket(sockTCP);
+        sockTCP = INVALID_SOCKET;
+
+        pStats->iFailed++;
+
+        return true;
+    }
+
+    LoopbackPacket prepare;
+    prepare.writeU8(static_cast<unsigned char>(UDP_SM_PREPARE)).writeString8(sUserName);
+
+    send(sockUDP, prepare.getData(), static_cast<int>(prepare.getSize()), 0);
+
+
+
+    bConnected         = true;
+    lastMessageTime    = std::chrono::steady_clock::now();
+    lastRoomChangeTime = lastMessageTime;
+
+    tcpThread  = std::thread(&LoopbackClient::tcpLoop, this);
+    udpThread  = std::thread(&LoopbackClient::udpLoop, this);
+    tickThread = std::thread(&LoopbackClient::tickLoop, this);
+
+
+    return false;
+}
+
+void LoopbackClient::disconnect()
+{
+    if (tcpThread.joinable() == false)
+    {
+        return;
+    }
+
+    bConnected = false;
+
+    tickThread.join();
+    udpThread.join();
+
+
+    // The server answers our FIN with its FIN, tcpLoop() ends then.
+
+    shutdown(sockTCP, LOOPBACK_SHUTDOWN_SEND);
+
+    tcpThread.join();
+
+
+    closeLoopbackSocket(sockTCP);
+    closeLoopbackSocket(sockUDP);
+}
+
+bool LoopbackClient::isConnected() const
+{
+    return bConnected;
+}
+
+void LoopbackClient::tcpLoop()
+{
+    while (true)
+    {
+        unsigned char cType = 0;
+
+        if ( recvAll(sockTCP, reinterpret_cast<char*>(&cType), sizeof(cType)) || receiveTCPMessage(cType) )
+        {
+            break;
+        }
+    }
+
+    bConnected = false;
+}
+
+void LoopbackClient::udpLoop()
+{
+    char vDatagram[MAX_BUFFER_SIZE + 100];
+
+    while (bConnected)
+    {
+        int iSize = recv(sockUDP, vDatagram, sizeof(vDatagram), 0);
+
+        pStats->iUDPRecvCalls++;
+
+        if (iSize <= 0)
+        {
+            continue;
+        }
+
+        pStats->iUDPDatagrams++;
+
+
+        if ( (vDatagram[0] == UDP_SM_PING) || (vDatagram[0] == UDP_SM_FIRST_PING) )
+        {
+            // Send it back as is (see NetworkService::processUDPDatagram()).
+
+            send(sockUDP, vDatagram, iSize, 0);
+
+            pStats->iPings++;
+
+            if (bVoiceReady == false)
+            {
+                bVoiceReady = true;
+
+                pStats->record(LCS_CONNECT, static_cast<unsigned long long>( std::chrono::duration_cast<std::chrono::microseconds>(
+                                                std::chrono::steady_clock::now() - connectStartTime ).count() ));
+                pStats->iConnected++;
+            }
+        }
+        else
+        {
+            receiveVoice(vDatagram, static_cast<size_t>(iSize));
+        }
+    }
+}
+
+void LoopbackClient::tickLoop()
+{
+    std::chrono::steady_clock::time_point nextFrameTime = std::chrono::steady_clock::now();
+
+    while (bConnected)
+    {
+        nextFrameTime += std::chrono::milliseconds(LOOPBACK_FRAME_MS);
+
+        std::this_thread::sleep_until(nextFrameTime);
+
+        if (bVoiceReady == false)
+        {
+            continue;
+        }
+
+
+        if (config.bTalk)
+        {
+            sendVoice();
+        }
+
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+        if ( (config.iMessageMS != 0) && (now - lastMessageTime >= std::chrono::milliseconds(config.iMessageMS)) )
+        {
+            lastMessageTime = now;
+
+            sendMessage();
+        }
+
+        if ( (config.iRoomChangeMS != 0) && (now - lastRoomChangeTime >= std::chrono::milliseconds(config.iRoomChangeMS)) )
+        {
+            lastRoomChangeTime = now;
+
+            sendRoomChange();
+        }
+    }
+}
+
+bool LoopbackClient::receiveChatInfo(std::string& sErrorOut)
+{
+    // See NetworkService::processChatInfo().
+
+    unsigned short iPacketSize = 0;
+
+    if ( recvAll(sockTCP, reinterpret_cast<char*>(&iPacketSize), sizeof(iPacketSize)) )
+    {
+        return true;
+    }
+
+    std::string sInfo(iPacketSize, '\0');
+
+    if ( (iPacketSize > 0) && recvAll(sockTCP, &sInfo[0], iPacketSize) )
+    {
+        return true;
+    }
+
+
+    // Room names (to move between them).
+
+    size_t iPos = 0;
+
+    unsigned char cRoomCount = (sInfo.size() > 0) ? static_cast<unsigned char>(sInfo[iPos++]) : 0;
+
+    for (unsigned char i = 0;  i < cRoomCount;  i++)
+    {
+        if (iPos + 1 > sInfo.size())
+        {
+            sErrorOut = "the chat info is damaged";
+
+            return true;
+        }
+
+        size_t iNameSize = static_cast<unsigned char>(sInfo[iPos++]);
+
+        if (iPos + iNameSize + 2 * sizeof(unsigned short) > sInfo.size())
+        {
+            sErrorOut = "the chat info is damaged";
+
+            return true;
+        }
+
+        vRoomNames.push_back(sInfo.substr(iPos, iNameSize));
+        iPos += iNameSize + sizeof(unsigned short);
+
+        unsigned short iUserCount = 0;
+        std::memcpy(&iUserCount, &sInfo[iPos], sizeof(iUserCount));
+        iPos += sizeof(iUserCount);
+
+        for (unsigned short j = 0;  j < iUserCount;  j++)
+        {
+            if (iPos + 1 > sInfo.size())
+            {
+                sErrorOut = "the chat info is damaged";
+
+                return true;
+            }
+
+            iPos += 1 + static_cast<unsigned char>(sInfo[iPos]);
+        }
+    }
+
+
+    return false;
+}
+
+bool LoopbackClient::exchangeKeys(std::string& sErrorOut)
+{
+    // See NetworkService::establishSecureConnection().
+
+    int vPG[2];
+
+    if ( recvAll(sockTCP, reinterpret_cast<char*>(vPG), sizeof(vPG)) )
+    {
+        return true;
+    }
+
+    if ( (vPG[0] <= 1) || (vPG[1] <= 0) )
+    {
+        sErrorOut = "wrong key parameters received";
+
+        return true;
+    }
+
+    unsigned long long p = static_cast<unsigned long long>(vPG[0]);
+    unsigned long long g = static_cast<unsigned long long>(vPG[1]);
+
+
+    std::mt19937_64 rndGen( std::random_device{}() );
+    std::uniform_int_distribution<> uid(500, 1000);
+
+    unsigned long long b = static_cast<unsigned long long>( uid(rndGen) );
+
+
+
+    // Open key A.
+
+    short iStringSize = 0;
+
+    char vOpenKey[LOOPBACK_MAX_OPEN_KEY_LENGTH + 1];
+    memset(vOpenKey, 0, sizeof(vOpenKey));
+
+    if ( recvAll(sockTCP, reinterpret_cast<char*>(&iStringSize), sizeof(iStringSize))
+         || (iStringSize <= 0) || (iStringSize > LOOPBACK_MAX_OPEN_KEY_LENGTH)
+         || recvAll(sockTCP, vOpenKey, static_cast<size_t>(iStringSize)) )
+    {
+        return true;
+    }
+
+    unsigned long long iOpenKeyA = std::strtoull(vOpenKey, nullptr, 10) % p;
+
+
+
+    // Open key B.
+
+    std::string sOpenKeyB = std::to_string( loopbackPowMod(g, b, p) );
+
+    LoopbackPacket answer;
+    answer.writeU16(static_cast<unsigned short>(sOpenKeyB.size())).writeBytes(sOpenKeyB.c_str(), sOpenKeyB.size());
+
+    // "Finished connecting".
+    answer.writeU8(99);
+
+    if ( sendAll(sockTCP, answer.getData(), answer.getSize()) )
+    {
+        return true;
+    }
+
+
+    unsigned char vKey[LOOPBACK_SESSION_KEY_SIZE];
+    makeLoopbackSessionKey(loopbackPowMod(iOpenKeyA, b, p), vKey);
+
+    pAES->SetKey(vKey);
+    pVoiceCipher->deriveKeys(pAES);
+
+
+
+    char cMessage = 0;
+
+    return recvAll(sockTCP, &cMessage, sizeof(cMessage));
+}
+
+bool LoopbackClient::receiveTCPMessage(unsigned char cType)
+{
+    // Same layout as TCPFrameReader::getFrameSize().
+
+    switch (cType)
+    {
+    case(SM_NEW_USER):
+    case(RC_PASSWORD_REQ):
+    case(RC_SERVER_DELETES_ROOM):
+    {
+        if (cType == SM_NEW_USER)
+        {
+            pStats->iUserEvents++;
+        }
+
+        return skipSized(false);
+    }
+    case(SM_SOMEONE_DISCONNECTED):
+    {
+        pStats->iUserEvents++;
+
+        char cReason = 0;
+
+        return recvAll(sockTCP, &cReason, sizeof(cReason)) || skipSized(false);
+    }
+    case(SM_CAN_START_UDP):
+    {
+        // See NetworkService::listenUDPFromServer().
+
+        char cReady = UDP_SM_USER_READY;
+
+        send(sockUDP, &cReady, sizeof(cReady), 0);
+
+        return false;
+    }
+    case(SM_KEEPALIVE):
+    {
+        pStats->iKeepAlives++;
+
+        LoopbackPacket answer;
+        answer.writeU8(SM_KEEPALIVE);
+
+        sendTCP(answer);
+
+        return false;
+    }
+    case(SM_USERMESSAGE):
+    {
+        // "Hour:Minute. UserName: " + [size (2)][encrypted message].
+
+        std::string sMessage;
+
+        if ( skipSized(true, &sMessage) )
+        {
+            return true;
+        }
+
+        std::string sPrefix = ". " + sUserName + ": ";
+
+        size_t iPrefixPos = sMessage.find(sPrefix);
+
+        if ( (iPrefixPos != std::string::npos) && (iPrefixPos <= 5) )
+        {
+            std::lock_guard<std::mutex> lock(mtxPending);
+
+            if (qMessageSendTimes.empty() == false)
+            {
+                pStats->record(LCS_MESSAGE, static_cast<unsigned long long>( std::chrono::duration_cast<std::chrono::microseconds>(
+                                                std::chrono::steady_clock::now() - qMessageSendTimes.front() ).count() ));
+
+                qMessageSendTimes.pop_front();
+            }
+        }
+
+        return false;
+    }
+    case(SM_PING):
+    case(SM_GLOBAL_MESSAGE):
+    {
+        return skipSized(true);
+    }
+    case(SM_SPEAKER_IDS):
+    {
+        return receiveSpeakerIds();
+    }
+    case(SM_VOICE_FEATURES):
+    {
+        // See NetworkService::receiveVoiceFeatures() (comes before SM_CAN_START_UDP, so before any voice packet).
+
+        unsigned char cFeatures = 0;
+
+        if ( recvAll(sockTCP, reinterpret_cast<char*>(&cFeatures), sizeof(cFeatures)) )
+        {
+            return true;
+        }
+
+        unsigned char cAnswer = 0;
+
+        if ( VoiceDatagram::applyVoiceFeatures(cFeatures, pVoiceCipher, pVoiceCodec, cAnswer) )
+        {
+            LoopbackPacket answer;
+            answer.writeU8(SM_VOICE_FEATURES).writeU8(cAnswer);
+
+            sendTCP(answer);
+        }
+
+        return false;
+    }
+    case(RC_CAN_ENTER_ROOM):
+    {
+        if ( skipSized(false) || skipSized(true) )
+        {
+            return true;
+        }
+
+        std::lock_guard<std::mutex> lock(mtxPending);
+
+        if (bRoomChangePending)
+        {
+            bRoomChangePending = false;
+
+            pStats->record(LCS_ROOM_CHANGE, static_cast<unsigned long long>( std::chrono::duration_cast<std::chrono::microseconds>(
+                                                std::chrono::steady_clock::now() - roomChangeSendTime ).count() ));
+        }
+
+        return false;
+    }
+    case(RC_USER_ENTERS_ROOM):
+    {
+        pStats->iUserEvents++;
+
+        return skipSized(false) || skipSized(false);
+    }
+    case(RC_ROOM_IS_FULL):
+    {
+        std::lock_guard<std::mutex> lock(mtxPending);
+
+        bRoomChangePending = false;
+
+        return false;
+    }
+    case(RC_SERVER_MOVED_ROOM):
+    {
+        char cMoveUp = 0;
+
+        return skipSized(false) || recvAll(sockTCP, &cMoveUp, sizeof(cMoveUp));
+    }
+    case(RC_SERVER_CREATES_ROOM):
+    case(RC_SERVER_CHANGES_ROOM):
+    {
+        unsigned int iMaxUsers = 0;
+
+        return skipSized(false) || ( (cType == RC_SERVER_CHANGES_ROOM) && skipSized(false) )
+               || recvAll(sockTCP, reinterpret_cast<char*>(&iMaxUsers), sizeof(iMaxUsers));
+    }
+    default:
+    {
+        // Only the type.
+
+        return false;
+    }
+    }
+}
+
+bool LoopbackClient::skipSized(bool bTwoBytes, std::string* pDataOut)
+{
+    unsigned short iSize = 0;
+
+    if (bTwoBytes)
+    {
+        if ( recvAll(sockTCP, reinterpret_cast<char*>(&iSize), sizeof(iSize)) )
+        {
+            return true;
+        }
+    }
+    else
+    {
+        unsigned char cSize = 0;
+
+        if ( recvAll(sockTCP, reinterpret_cast<char*>(&cSize), sizeof(cSize)) )
+        {
+            return true;
+        }
+
+        iSize = cSize;
+    }
+
+    std::string sData(iSize, '\0');
+
+    if ( (iSize > 0) && recvAll(sockTCP, &sData[0], iSize) )
+    {
+        return true;
+    }
+
+    if (pDataOut)
+    {
+        *pDataOut = sData;
+    }
+
+    return false;
+}
+
+bool LoopbackClient::receiveSpeakerIds()
+{
+    // [size (2)] + ([name size (1)][name][speaker id (2)]) (see NetworkService::receiveSpeakerIds()).
+
+    std::string sPacket;
+
+    if ( skipSized(true, &sPacket) )
+    {
+        return true;
+    }
+
+
+    std::lock_guard<std::mutex> lock(mtxSpeakerNames);
+
+    size_t iPos = 0;
+
+    while (iPos < sPacket.size())
+    {
+        size_t iNameSize = static_cast<unsigned char>(sPacket[iPos]);
+
+        unsigned short iSpeakerId = 0;
+
+        if (iPos + 1 + iNameSize + sizeof(iSpeakerId) > sPacket.size())
+        {
+            // Damaged packet.
+            break;
+        }
+
+        std::memcpy(&iSpeakerId, &sPacket[iPos + 1 + iNameSize], sizeof(iSpeakerId));
+
+        mSpeakerNames[iSpeakerId] = sPacket.substr(iPos + 1, iNameSize);
+
+        iPos += 1 + iNameSize + sizeof(iSpeakerId);
+    }
+
+
+    return false;
+}
+
+void LoopbackClient::receiveVoice(char* pPacket, size_t iSize)
+{
+    // See NetworkService::receiveVoicePacket().
+
+    unsigned char vDecrypted[VOICE_DATAGRAM_MAX_SIZE];
+
+    VoiceDatagramContent packet;
+
+    if ( VoiceDatagram::openServerPacket(reinterpret_cast<unsigned char*>(pPacket), iSize, LOOPBACK_FRAME_SAMPLES,
+                                         pVoiceCipher, pAES, vDecrypted, packet) )
+    {
+        pStats->iVoiceRejected++;
+
+        return;
+    }
+
+    if (packet.bLast)
+    {
+        pStats->iVoiceLastReceived++;
+
+        return;
+    }
+
+
+    short vSamples[LOOPBACK_FRAME_SAMPLES];
+
+    if ( VoiceCodec::decode(packet.codec, packet.pPayload, packet.iPayloadSize, vSamples, LOOPBACK_FRAME_SAMPLES) )
+    {
+        pStats->iVoiceRejected++;
+
+        return;
+    }
+
+
+    pStats->iVoicePacketsReceived++;
+    pStats->iVoiceBytesReceived += iSize;
+
+
+    if (packet.iSpeakerId >= 0)
+    {
+        pStats->iVoiceById++;
+
+        std::lock_guard<std::mutex> lock(mtxSpeakerNames);
+
+        std::unordered_map<unsigned short, std::string>::const_iterator it =
+                mSpeakerNames.find(static_cast<unsigned short>(packet.iSpeakerId));
+
+        if (it == mSpeakerNames.end())
+        {
+            pStats->iVoiceUnknownSpeaker++;
+
+            return;
+        }
+
+        packet.sUserName = it->second;
+    }
+
+    if (packet.sUserName != LOOPBACK_ECHO_PEER_NAME)
+    {
+        return;
+    }
+
+
+    // Our packet came back.
+
+    unsigned int iSequence = 0;
+
+    unsigned long long iNow = getLoopbackTimeUS();
+
+    if ( (readVoiceStamp(vSamples, iSequence) == false) && (vSentSequences[iSequence % LOOPBACK_CLIENT_SEND_TIMES] == iSequence) )
+    {
+        unsigned long long iSendTimeUS = vSendTimesUS[iSequence % LOOPBACK_CLIENT_SEND_TIMES];
+
+        pStats->record(LCS_VOICE_ECHO, (iNow >= iSendTimeUS) ? (iNow - iSendTimeUS) : 0);
+    }
+    else
+    {
+        pStats->iVoiceDamaged++;
+    }
+}
+
+void LoopbackClient::sendVoice()
+{
+    // See NetworkService::sendVoiceMessage().
+
+    std::vector<short> vSamples = vTone;
+
+    unsigned int iSequence = iVoiceSequence++;
+
+    writeVoiceStamp(vSamples.data(), iSequence);
+
+    vSendTimesUS[iSequence % LOOPBACK_CLIENT_SEND_TIMES]   = getLoopbackTimeUS();
+    vSentSequences[iSequence % LOOPBACK_CLIENT_SEND_TIMES] = iSequence;
+
+
+    unsigned char vPacket[VOICE_DATAGRAM_MAX_SIZE];
+
+    size_t iSize = VoiceDatagram::buildClientPacket(vSamples.data(), LOOPBACK_FRAME_SAMPLES, false, pVoiceCodec, pVoiceCipher, pAES, vPacket);
+
+
+    // Impairments.
+
+    std::uniform_real_distribution<float> urd(0.0f, 100.0f);
+
+    if ( (config.fCorruptPercent > 0.0f) && (urd(rndGen) < config.fCorruptPercent) )
+    {
+        std::uniform_int_distribution<size_t> uidByte(0, iSize - 1);
+        std::uniform_int_distribution<int>    uidBit(0, 7);
+
+        vPacket[uidByte(rndGen)] ^= static_cast<unsigned char>(1 << uidBit(rndGen));
+    }
+
+    size_t iCopies = ( (config.fDuplicatePercent > 0.0f) && (urd(rndGen) < config.fDuplicatePercent) ) ? 2 : 1;
+
+
+    for (size_t i = 0;  i < iCopies;  i++)
+    {
+        if ( send(sockUDP, reinterpret_cast<char*>(vPacket), static_cast<int>(iSize), 0) > 0 )
+        {
+            pStats->iVoicePacketsSent++;
+        }
+    }
+}
+
+void LoopbackClient::sendMessage()
+{
+    // [size (2)][ECB encrypted wchar_t string with the null] (see NetworkService::sendMessage()).
+
+    std::string sText = toLoopbackWideBytes("loopback " + std::to_string(iVoiceSequence));
+    sText.push_back('\0');
+
+    std::string sEncrypted(pAES->GetPaddingLength(static_cast<unsigned int>(sText.size())), '\0');
+
+    pAES->EncryptECBWithSetKey(reinterpret_cast<unsigned char*>(&sText[0]), static_cast<unsigned int>(sText.size()),
+                               reinterpret_cast<unsigned char*>(&sEncrypted[0]));
+
+    LoopbackPacket packet;
+    packet.writeU8(SM_USERMESSAGE).writeU16(static_cast<unsigned short>(sEncrypted.size())).writeBytes(sEncrypted.c_str(), sEncrypted.size());
+
+
+    mtxPending.lock();
+    qMessageSendTimes.push_back(std::chrono::steady_clock::now());
+    mtxPending.unlock();
+
+    sendTCP(packet);
+}
+
+void LoopbackClient::sendRoomChange()
+{
+    if (vRoomNames.size() < 2)
+    {
+        return;
+    }
+
+    iRoom = (iRoom == 0) ? 1 : 0;
+
+    LoopbackPacket packet;
+    packet.writeU8(RC_ENTER_ROOM).writeString8(vRoomNames[iRoom]);
+
+
+    mtxPending.lock();
+    bRoomChangePending = true;
+    roomChangeSendTime = std::chrono::steady_clock::now();
+    mtxPending.unlock();
+
+    sendTCP(packet);
+}
+
+void LoopbackClient::sendTCP(const LoopbackPacket& packet)
+{
+    std::lock_guard<std::mutex> lock(mtxSendTCP);
+
+    sendAll(sockTCP, packet.getData(), packet.getSize());
+}
+
+LoopbackClient::~LoopbackClient()
+{
+    disconnect();
+
+    delete pAES;
+    delete pVoiceCipher;
+    delete pVoiceCodec;
+}
@@ -0,0 +1,240 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Custom
+#include "Tools/LoopbackServer/loopbacknet.h"
+
+
+// Send times of the last sent voice packets (by the sequence number) for the echo.
+#define  LOOPBACK_CLIENT_SEND_TIMES     256
+
+
+class AES;
+class LatencyHistogram;
+class VoiceCipher;
+class VoiceCodec;
+struct LatencyStats;
+
+
+enum LOOPBACK_CLIENT_STAT
+{
+    LCS_CONNECT             = 0,  // connect() -> first UDP ping (the voice chat is ready)
+    LCS_VOICE_ECHO          = 1,  // voice packet sent -> the same packet received from the echo peer
+    LCS_MESSAGE             = 2,  // SM_USERMESSAGE sent -> our message received back
+    LCS_ROOM_CHANGE         = 3,  // RC_ENTER_ROOM sent -> RC_CAN_ENTER_ROOM
+
+    LCS_COUNT               = 4
+};
+
+
+struct LoopbackClientConfig
+{
+    LoopbackClientConfig();
+
+
+    std::string     sAddress;
+    unsigned short  iPort;
+    std::string     sClientVersion;
+
+
+    bool            bTalk;              // voice packets with the client's packet rate
+    unsigned int    iMessageMS;         // text message every 'iMessageMS' (0 - never)
+    unsigned int    iRoomChangeMS;      // moves between the first two rooms every 'iRoomChangeMS' (0 - never)
+
+
+    // Impairments of the sent voice packets (in percent), to check that the server rejects them.
+    float           fDuplicatePercent;  // sent twice (a replay for VF_AUTHENTICATED_CTR)
+    float           fCorruptPercent;    // one byte is changed
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Results of all LoopbackClients, the clients record into it from their threads.
+class LoopbackClientStats
+{
+
+public:
+
+    LoopbackClientStats();
+
+
+    // Record
+
+        void         record              (LOOPBACK_CLIENT_STAT stat, unsigned long long iMicroseconds);
+
+
+    // Returns false if nothing was recorded.
+
+        bool         getStats            (LOOPBACK_CLIENT_STAT stat, LatencyStats* pStats) const;
+
+
+    // Output
+
+        // Counters and one line per stat (count, min, p50, p90, p99, max, mean) over 'dSeconds'.
+        std::string  format              (double dSeconds) const;
+
+        static const char*  getStatName  (LOOPBACK_CLIENT_STAT stat);
+
+
+    ~LoopbackClientStats();
+
+
+    std::atomic<unsigned long long>  iConnected;
+    std::atomic<unsigned long long>  iFailed;
+
+    std::atomic<unsigned long long>  iVoicePacketsSent;
+    std::atomic<unsigned long long>  iVoicePacketsReceived;
+    std::atomic<unsigned long long>  iVoiceBytesReceived;
+    std::atomic<unsigned long long>  iVoiceLastReceived;
+    std::atomic<unsigned long long>  iVoiceDamaged;   // accepted but not what was sent (the echo)
+    std::atomic<unsigned long long>  iVoiceRejected;  // damaged, forged or replayed (see VoiceDatagram::openServerPacket())
+    std::atomic<unsigned long long>  iVoiceById;      // with the speaker id instead of the name (VF_SPEAKER_IDS)
+    std::atomic<unsigned long long>  iVoiceUnknownSpeaker;  // the id came before its SM_SPEAKER_IDS
+
+    std::atomic<unsigned long long>  iPings;
+    std::atomic<unsigned long long>  iKeepAlives;
+    std::atomic<unsigned long long>  iUserEvents;    // users connected, disconnected or moved
+
+    std::atomic<unsigned long long>  iUDPDatagrams;  // received (voice, pings, damaged)
+    std::atomic<unsigned long long>  iUDPRecvCalls;  // recv() calls of the UDP threads (with the ones that timed out)
+
+private:
+
+    LatencyHistogram*  vStats[LCS_COUNT];
+};
+
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Headless client that speaks the same protocol as NetworkService (the real one needs the UI and the audio devices)
+// to put load on the LoopbackServer (or a real server) and to measure it.
+// The voice packets are made and opened by the client code (VoiceDatagram, VoiceCipher, VoiceCodec).
+// Voice packets carry a sequence number in the first samples (coded to survive the ADPCM)
+// so the echo peer's packets give the voice round trip.
+class LoopbackClient
+{
+
+public:
+
+    LoopbackClient(const LoopbackClientConfig& config, const std::string& sUserName, LoopbackClientStats* pStats);
+
+
+    // Connects and waits for the key exchange (not for the voice chat, see LCS_CONNECT).
+    // Returns true if failed ('sErrorOut' has the reason).
+
+        bool         connect             (std::string& sErrorOut);
+
+
+    // Sends FIN and waits for the server's FIN.
+
+        void         disconnect          ();
+
+
+        bool         isConnected         () const;
+
+
+    ~LoopbackClient();
+
+private:
+
+    // Threads
+
+        void         tcpLoop             ();
+        void         udpLoop             ();
+        void         tickLoop            ();
+
+
+    // Return true if the connection is closed.
+
+        bool         exchangeKeys        (std::string& sErrorOut);
+        bool         receiveChatInfo     (std::string& sErrorOut);
+        bool         receiveTCPMessage   (unsigned char cType);
+        bool         skipSized           (bool bTwoBytes, std::string* pDataOut = nullptr);
+        bool         receiveSpeakerIds   ();
+
+
+        void         receiveVoice        (char* pPacket, size_t iSize);
+        void         sendVoice           ();
+        void         sendMessage         ();
+        void         sendRoomChange      ();
+        void         sendTCP             (const LoopbackPacket& packet);
+
+
+    LoopbackClientConfig     config;
+    std::string              sUserName;
+    LoopbackClientStats*     pStats;
+
+
+    LoopbackSocket           sockTCP;
+    LoopbackSocket           sockUDP;
+    std::mutex               mtxSendTCP;
+
+    AES*                     pAES;
+    VoiceCipher*             pVoiceCipher;
+    VoiceCodec*              pVoiceCodec;
+
+
+    std::thread              tcpThread;
+    std::thread              udpThread;
+    std::thread              tickThread;
+
+
+    std::vector<std::string> vRoomNames;
+    size_t                   iRoom;
+
+
+    // Speaker id -> user name (SM_SPEAKER_IDS).
+    std::unordered_map<unsigned short, std::string>  mSpeakerNames;
+    std::mutex               mtxSpeakerNames;
+
+
+    std::chrono::steady_clock::time_point  connectStartTime;
+    std::chrono::steady_clock::time_point  lastMessageTime;
+    std::chrono::steady_clock::time_point  lastRoomChangeTime;
+
+
+    // Send times of our messages that did not come back yet (TCP keeps the order).
+    std::deque<std::chrono::steady_clock::time_point>  qMessageSendTimes;
+    std::chrono::steady_clock::time_point  roomChangeSendTime;
+    bool                     bRoomChangePending;
+    std::mutex               mtxPending;
+
+
+    unsigned int             iVoiceSequence;
+    std::vector<short>       vTone;
+
+    // Written by the tick thread, read by the UDP thread.
+    std::atomic<unsigned int>        vSentSequences[LOOPBACK_CLIENT_SEND_TIMES];
+    std::atomic<unsigned long long>  vSendTimesUS[LOOPBACK_CLIENT_SEND_TIMES];
+    std::mt19937             rndGen;  // impairments (tick thread)
+
+
+    std::atomic<bool>        bConnected;
+    std::atomic<bool>        bVoiceReady;
+};
@@ -0,0 +1,215 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "loopbacknet.h"
+
+
+// STL
+#include <cstring>
+
+#if _WIN32
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <cerrno>
+#endif
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+LoopbackPacket& LoopbackPacket::writeU8(unsigned char cValue)
+{
+    sData.push_back(static_cast<char>(cValue));
+
+    return *this;
+}
+
+LoopbackPacket& LoopbackPacket::writeU16(unsigned short iValue)
+{
+    return writeBytes(&iValue, sizeof(iValue));
+}
+
+LoopbackPacket& LoopbackPacket::writeU32(unsigned int iValue)
+{
+    return writeBytes(&iValue, sizeof(iValue));
+}
+
+LoopbackPacket& LoopbackPacket::writeBytes(const void* pData, size_t iSize)
+{
+    sData.append(static_cast<const char*>(pData), iSize);
+
+    return *this;
+}
+
+LoopbackPacket& LoopbackPacket::writeString8(const std::string& sText)
+{
+    writeU8(static_cast<unsigned char>(sText.size()));
+
+    return writeBytes(sText.c_str(), sText.size());
+}
+
+void LoopbackPacket::patchU16(size_t iPos, unsigned short iValue)
+{
+    std::memcpy(&sData[iPos], &iValue, sizeof(iValue));
+}
+
+const char* LoopbackPacket::getData() const
+{
+    return sData.c_str();
+}
+
+size_t LoopbackPacket::getSize() const
+{
+    return sData.size();
+}
+
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+bool loopbackStartup()
+{
+#if _WIN32
+    WSADATA WSAData;
+
+    return WSAStartup(MAKEWORD(2, 2), &WSAData) != 0;
+#else
+    return false;
+#endif
+}
+
+void loopbackCleanup()
+{
+#if _WIN32
+    WSACleanup();
+#endif
+}
+
+void closeLoopbackSocket(LoopbackSocket sock)
+{
+#if _WIN32
+    closesocket(sock);
+#else
+    close(sock);
+#endif
+}
+
+int getLoopbackError()
+{
+#if _WIN32
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+bool setLoopbackNoDelay(LoopbackSocket sock)
+{
+    int iOptVal = 1;
+
+    return setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<char*>(&iOptVal), sizeof(iOptVal)) == SOCKET_ERROR;
+}
+
+bool setLoopbackRecvTimeout(LoopbackSocket sock, unsigned int iTimeoutMS)
+{
+#if _WIN32
+    DWORD iTimeout = iTimeoutMS;
+#else
+    timeval iTimeout;
+    iTimeout.tv_sec  = static_cast<long>(iTimeoutMS / 1000);
+    iTimeout.tv_usec = static_cast<long>(iTimeoutMS % 1000) * 1000;
+#endif
+
+    return setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<char*>(&iTimeout), sizeof(iTimeout)) == SOCKET_ERROR;
+}
+
+bool sendAll(LoopbackSocket sock, const char* pData, size_t iSize)
+{
+    size_t iSentSize = 0;
+
+    while (iSentSize < iSize)
+    {
+        int iResult = send(sock, pData + iSentSize, static_cast<int>(iSize - iSentSize), 0);
+
+        if (iResult <= 0)
+        {
+            return true;
+        }
+
+        iSentSize += static_cast<size_t>(iResult);
+    }
+
+    return false;
+}
+
+bool recvAll(LoopbackSocket sock, char* pData, size_t iSize)
+{
+    size_t iReceivedSize = 0;
+
+    while (iReceivedSize < iSize)
+    {
+        int iResult = recv(sock, pData + iReceivedSize, static_cast<int>(iSize - iReceivedSize), 0);
+
+        if (iResult <= 0)
+        {
+            return true;
+        }
+
+        iReceivedSize += static_cast<size_t>(iResult);
+    }
+
+    return false;
+}
+
+unsigned long long loopbackPowMod(unsigned long long base, unsigned long long exp, unsigned long long mod)
+{
+    unsigned long long result = 1 % mod;
+
+    base %= mod;
+
+    while (exp)
+    {
+        if (exp & 1)
+        {
+            result = (result * base) % mod;
+        }
+
+        exp >>= 1;
+        base = (base * base) % mod;
+    }
+
+    return result;
+}
+
+void makeLoopbackSessionKey(unsigned long long iSharedSecret, unsigned char* pKeyOut)
+{
+    std::string sSecret = std::to_string(iSharedSecret);
+
+    for (size_t i = 0;  i < LOOPBACK_SESSION_KEY_SIZE;  i++)
+    {
+        pKeyOut[i] = static_cast<unsigned char>( sSecret[i % sSecret.size()] );
+    }
+}
+
+std::string toLoopbackWideBytes(const std::string& sASCII)
+{
+    std::string sWide;
+
+    for (size_t i = 0;  i < sASCII.size();  i++)
+    {
+        // Little-endian UTF-16 (the client is x86).
+        sWide.push_back(sASCII[i]);
+        sWide.push_back('\0');
+    }
+
+    return sWide;
+}
@@ -0,0 +1,132 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <string>
+#include <cstddef>
+
+// Sockets and stuff
+#if _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#endif
+
+
+// The loopback tools run on Windows (next to the client) and on Linux (CI) so the sockets are wrapped here.
+
+#if _WIN32
+typedef SOCKET  LoopbackSocket;
+typedef int     LoopbackSockLen;
+#define  LOOPBACK_SHUTDOWN_SEND  SD_SEND
+#define  LOOPBACK_SHUTDOWN_BOTH  SD_BOTH
+#else
+typedef int        LoopbackSocket;
+typedef socklen_t  LoopbackSockLen;
+#define  INVALID_SOCKET          (-1)
+#define  SOCKET_ERROR            (-1)
+#define  LOOPBACK_SHUTDOWN_SEND  SHUT_WR
+#define  LOOPBACK_SHUTDOWN_BOTH  SHUT_RDWR
+#endif
+
+
+// Size of the session key (see NetworkService::establishSecureConnection()).
+#define  LOOPBACK_SESSION_KEY_SIZE    16
+
+// Max size of the open key string (also in NetworkService::establishSecureConnection()).
+#define  LOOPBACK_MAX_OPEN_KEY_LENGTH 1000
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Appends the fields of a message in the same layout the client uses (native byte order, like memcpy in NetworkService).
+class LoopbackPacket
+{
+
+public:
+
+    LoopbackPacket() = default;
+
+
+    // Write
+
+        LoopbackPacket&  writeU8        (unsigned char cValue);
+        LoopbackPacket&  writeU16       (unsigned short iValue);
+        LoopbackPacket&  writeU32       (unsigned int iValue);
+        LoopbackPacket&  writeBytes     (const void* pData, size_t iSize);
+
+        // [size (1)][string]
+        LoopbackPacket&  writeString8   (const std::string& sText);
+
+        // Overwrites 2 bytes at 'iPos' (for the size fields that are known after the data is written).
+        void             patchU16       (size_t iPos, unsigned short iValue);
+
+
+    // GET functions
+
+        const char*      getData        () const;
+        size_t           getSize        () const;
+
+private:
+
+    std::string  sData;
+};
+
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// WSAStartup() / WSACleanup() on Windows, nothing on Linux. Returns true if failed.
+
+    bool         loopbackStartup        ();
+    void         loopbackCleanup        ();
+
+    void         closeLoopbackSocket    (LoopbackSocket sock);
+    int          getLoopbackError       ();
+
+
+// Socket options. Return true if failed.
+
+    bool         setLoopbackNoDelay     (LoopbackSocket sock);
+    bool         setLoopbackRecvTimeout (LoopbackSocket sock, unsigned int iTimeoutMS);
+
+
+// Blocking send() / recv() of the whole buffer. Return true if the connection is closed or failed.
+
+    bool         sendAll                (LoopbackSocket sock, const char* pData, size_t iSize);
+    bool         recvAll                (LoopbackSocket sock, char* pData, size_t iSize);
+
+
+// Session key (the same math as in NetworkService::establishSecureConnection()).
+
+    // 'base ^ exp % mod', 'mod' should be less than 2^32.
+    unsigned long long  loopbackPowMod  (unsigned long long base, unsigned long long exp, unsigned long long mod);
+
+    // The decimal string of the shared secret repeated (or cut) to LOOPBACK_SESSION_KEY_SIZE bytes.
+    void         makeLoopbackSessionKey (unsigned long long iSharedSecret, unsigned char* pKeyOut);
+
+
+// The client keeps wchar_t (2 bytes on Windows) strings on the wire.
+
+    std::string  toLoopbackWideBytes    (const std::string& sASCII);
@@ -0,0 +1,1702 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "loopbackserver.h"
+
+
+// STL
+#include <cmath>
+#include <cstdio>
+#include <climits>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+// Custom
+#include "Model/net_params.h"
+#include "Model/net_messages.h"
+#include "Model/AudioTimer/audiotimer.h"
+#include "Model/LatencyHistogram/latencyhistogram.h"
+#include "Model/VoiceCipher/voicecipher.h"
+#include "Model/VoiceCodec/voicecodec.h"
+#include "Model/VoiceDatagram/voicedatagram.h"
+
+// External
+#include "AES/AES.h"
+
+
+// Key exchange parameters: 2^31 - 1 and its primitive root (the client only needs p and g to fit in an int).
+#define  LOOPBACK_KEY_P                 2147483647ULL
+#define  LOOPBACK_KEY_G                 7ULL
+
+// The UDP thread checks if the server is stopped this often.
+#define  LOOPBACK_UDP_TIMEOUT_MS        100
+
+// Time to send the connect request and to answer the key exchange.
+#define  LOOPBACK_HANDSHAKE_TIMEOUT_MS  10000
+
+// Ping datagram: [UDP_SM_PING or UDP_SM_FIRST_PING][send time in microseconds (8)] (the client sends it back as is).
+#define  LOOPBACK_PING_SIZE             (1 + sizeof(unsigned long long))
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+LoopbackServerConfig::LoopbackServerConfig()
+{
+    iPort            = 51337;
+    sClientVersion   = CLIENT_VERSION;
+    iMaxUsers        = 100;
+
+    iRoomCount       = 3;
+    iMaxUsersInRoom  = 0;
+    sRoomMessage     = "Silent loopback server.";
+
+    iPeerCount       = 4;
+    iTalkMS          = 3000;
+    iSilenceMS       = 2000;
+    bEcho            = true;
+
+    cVoiceFeatures   = 0;
+
+    fLossPercent      = 0.0f;
+    iJitterMS         = 0;
+    fReorderPercent   = 0.0f;
+    fDuplicatePercent = 0.0f;
+    fCorruptPercent   = 0.0f;
+
+    iChurnMS         = 0;
+
+    iKeepAliveMS     = INTERVAL_KEEPALIVE_SEC * 1000;
+    iPingMS          = PING_CHECK_INTERVAL_SEC * 1000;
+}
+
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+LoopbackServer::LoopbackServer(const LoopbackServerConfig& config) : config(config)
+{
+    sockListen  = INVALID_SOCKET;
+    sockUDP     = INVALID_SOCKET;
+
+    iConnectionThreads = 0;
+
+    pDelayTimer = new AudioTimer();
+
+    for (size_t i = 0;  i < LSS_COUNT;  i++)
+    {
+        vStats[i] = new LatencyHistogram();
+    }
+
+    memset(&counters, 0, sizeof(counters));
+
+    rndGen.seed( std::random_device{}() );
+
+    pEchoPeer      = nullptr;
+    iNextSpeakerId = 0;
+
+    bRunning = false;
+
+
+
+    // Synthetic peers.
+
+    const double dPi = 3.14159265358979323846;
+
+    for (size_t i = 0;  i < config.iPeerCount + (config.bEcho ? 1 : 0);  i++)
+    {
+        LoopbackUser* pPeer = new LoopbackUser();
+
+        pPeer->bSynthetic         = true;
+        pPeer->bOnline            = true;
+        pPeer->iSpeakerId         = iNextSpeakerId++;
+        pPeer->iVoiceSequence     = 0;
+        pPeer->sockTCP            = INVALID_SOCKET;
+        pPeer->pAES               = nullptr;
+        pPeer->pVoiceCipher       = nullptr;
+        pPeer->pVoiceCodec        = nullptr;
+        pPeer->cVoiceFeatures     = 0;
+        pPeer->bUDPKnown          = false;
+        pPeer->bVoiceReady        = false;
+        pPeer->bKeepAlivePending  = false;
+        pPeer->iTalkFramesLeft    = 0;
+        pPeer->iSilenceFramesLeft = 0;
+        pPeer->iPing              = static_cast<unsigned short>(config.iJitterMS);
+
+        if (i == config.iPeerCount)
+        {
+            // Talks only when the client does, never leaves.
+            pPeer->sName = LOOPBACK_ECHO_PEER_NAME;
+            pPeer->iRoom = 0;
+
+            pEchoPeer = pPeer;
+        }
+        else
+        {
+            pPeer->sName = "peer" + std::to_string(i + 1);
+            pPeer->iRoom = (config.iRoomCount > 0) ? (i % config.iRoomCount) : 0;
+
+
+            // Different tone for each peer.
+
+            double dFrequency = 180.0 + 37.0 * static_cast<double>(i);
+
+            pPeer->vTone.resize(LOOPBACK_FRAME_SAMPLES);
+
+            for (size_t j = 0;  j < LOOPBACK_FRAME_SAMPLES;  j++)
+            {
+                pPeer->vTone[j] = static_cast<short>( 3000.0 * std::sin(2.0 * dPi * dFrequency * static_cast<double>(j) / 19400.0) );
+            }
+
+
+            // Don't start talking all at once.
+
+            std::uniform_int_distribution<unsigned int> uid(1, config.iSilenceMS / LOOPBACK_FRAME_MS + 1);
+            pPeer->iSilenceFramesLeft = uid(rndGen);
+        }
+
+        vUsers.push_back(pPeer);
+    }
+}
+
+bool LoopbackServer::start(std::string& sErrorOut)
+{
+    if (config.iRoomCount == 0)
+    {
+        sErrorOut = "there should be at least one room";
+
+        return true;
+    }
+
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(config.iPort);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+
+
+    // TCP.
+
+    sockListen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+    if (sockListen == INVALID_SOCKET)
+    {
+        sErrorOut = "socket() (TCP) failed and returned: " + std::to_string(getLoopbackError());
+
+        return true;
+    }
+
+    int iReuse = 1;
+    setsockopt(sockListen, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<char*>(&iReuse), sizeof(iReuse));
+
+    if ( (bind(sockListen, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR)
+         || (listen(sockListen, SOMAXCONN) == SOCKET_ERROR) )
+    {
+        sErrorOut = "bind() / listen() (TCP) failed and returned: " + std::to_string(getLoopbackError());
+
+        closeLoopbackSocket(sockListen);
+        sockListen = INVALID_SOCKET;
+
+        return true;
+    }
+
+
+
+    // UDP.
+
+    sockUDP = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+    if ( (sockUDP == INVALID_SOCKET)
+         || (bind(sockUDP, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR)
+         || setLoopbackRecvTimeout(sockUDP, LOOPBACK_UDP_TIMEOUT_MS) )
+    {
+        sErrorOut = "socket() / bind() (UDP) failed and returned: " + std::to_string(getLoopbackError());
+
+        if (sockUDP != INVALID_SOCKET)
+        {
+            closeLoopbackSocket(sockUDP);
+            sockUDP = INVALID_SOCKET;
+        }
+
+        closeLoopbackSocket(sockListen);
+        sockListen = INVALID_SOCKET;
+
+        return true;
+    }
+
+
+
+    startTime     = std::chrono::steady_clock::now();
+    lastPingTime  = startTime;
+    lastChurnTime = startTime;
+
+    bRunning = true;
+
+    acceptThread = std::thread(&LoopbackServer::acceptLoop, this);
+    udpThread    = std::thread(&LoopbackServer::udpLoop, this);
+    tickThread   = std::thread(&LoopbackServer::tickLoop, this);
+
+
+    return false;
+}
+
+void LoopbackServer::stop()
+{
+    if (bRunning == false)
+    {
+        return;
+    }
+
+    bRunning = false;
+
+
+    // accept() returns.
+
+    shutdown(sockListen, LOOPBACK_SHUTDOWN_BOTH);
+    closeLoopbackSocket(sockListen);
+
+    acceptThread.join();
+    tickThread.join();
+    udpThread.join();
+
+
+    // recv() of the connection threads returns.
+
+    mtxUsers.lock();
+
+    for (size_t i = 0;  i < vUsers.size();  i++)
+    {
+        if (vUsers[i]->bSynthetic == false)
+        {
+            shutdown(vUsers[i]->sockTCP, LOOPBACK_SHUTDOWN_BOTH);
+        }
+    }
+
+    mtxUsers.unlock();
+
+
+    std::unique_lock<std::mutex> lock(mtxConnectionThreads);
+
+    cvConnectionThreads.wait(lock, [this]{ return iConnectionThreads == 0; });
+
+    lock.unlock();
+
+
+    closeLoopbackSocket(sockUDP);
+}
+
+LoopbackServerCounters LoopbackServer::getCounters() const
+{
+    std::lock_guard<std::mutex> lock(mtxCounters);
+
+    return counters;
+}
+
+bool LoopbackServer::getStats(LOOPBACK_SERVER_STAT stat, LatencyStats* pStats) const
+{
+    return vStats[stat]->getStats(pStats);
+}
+
+std::string LoopbackServer::format() const
+{
+    LoopbackServerCounters current = getCounters();
+
+    double dSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - startTime ).count();
+
+    if (dSeconds <= 0.0)
+    {
+        dSeconds = 1.0;
+    }
+
+
+    char vLine[256];
+
+    std::string sText = "Loopback server:\n";
+
+    std::snprintf(vLine, sizeof(vLine), "clients: %llu connected, %llu rejected; messages: %llu; room changes: %llu; churn: %llu\n",
+                  current.iConnected, current.iRejected, current.iMessages, current.iRoomChanges, current.iChurnEvents);
+    sText += vLine;
+
+    std::snprintf(vLine, sizeof(vLine), "voice in:  %llu packets (%.1f/s, %.1f kbit/s), %llu rejected\n",
+                  current.iVoicePacketsIn, current.iVoicePacketsIn / dSeconds, current.iVoiceBytesIn * 8 / dSeconds / 1000,
+                  current.iVoiceRejected);
+    sText += vLine;
+
+    std::snprintf(vLine, sizeof(vLine), "voice out: %llu packets (%.1f/s, %.1f kbit/s), %llu lost, %llu reordered, %llu duplicated, %llu corrupted\n",
+                  current.iVoicePacketsOut, current.iVoicePacketsOut / dSeconds, current.iVoiceBytesOut * 8 / dSeconds / 1000,
+                  current.iVoiceLost, current.iVoiceReordered, current.iVoiceDuplicated, current.iVoiceCorrupted);
+    sText += vLine;
+
+
+
+    std::snprintf(vLine, sizeof(vLine), "%-16s %10s %9s %9s %9s %9s %9s %11s\n",
+                  "latency (us)", "count", "min", "p50", "p90", "p99", "max", "mean");
+    sText += vLine;
+
+    for (size_t i = 0;  i < LSS_COUNT;  i++)
+    {
+        LOOPBACK_SERVER_STAT stat = static_cast<LOOPBACK_SERVER_STAT>(i);
+
+        LatencyStats stats;
+
+        if ( getStats(stat, &stats) == false )
+        {
+            std::snprintf(vLine, sizeof(vLine), "%-16s %10d\n", getStatName(stat), 0);
+        }
+        else
+        {
+            std::snprintf(vLine, sizeof(vLine), "%-16s %10llu %9llu %9llu %9llu %9llu %9llu %11.1f\n",
+                          getStatName(stat), stats.iCount, stats.iMinUS, stats.iP50US, stats.iP90US, stats.iP99US,
+                          stats.iMaxUS, stats.dMeanUS);
+        }
+
+        sText += vLine;
+    }
+
+
+    return sText;
+}
+
+const char* LoopbackServer::getStatName(LOOPBACK_SERVER_STAT stat)
+{
+    switch (stat)
+    {
+    case(LSS_CONNECT):   return "connect";
+    case(LSS_PING):      return "udp_ping";
+    case(LSS_KEEPALIVE): return "keepalive";
+    default:             return "unknown";
+    }
+}
+
+void LoopbackServer::acceptLoop()
+{
+    while (bRunning)
+    {
+        LoopbackSocket sock = accept(sockListen, nullptr, nullptr);
+
+        if (sock == INVALID_SOCKET)
+        {
+            continue;
+        }
+
+        if (bRunning == false)
+        {
+            closeLoopbackSocket(sock);
+
+            break;
+        }
+
+
+        mtxConnectionThreads.lock();
+        iConnectionThreads++;
+        mtxConnectionThreads.unlock();
+
+        std::thread connectionThread(&LoopbackServer::connectionLoop, this, sock);
+        connectionThread.detach();
+    }
+}
+
+void LoopbackServer::connectionLoop(LoopbackSocket sock)
+{
+    setLoopbackNoDelay(sock);
+
+    // Don't let stop() wait for a client that connected and went silent.
+    setLoopbackRecvTimeout(sock, LOOPBACK_HANDSHAKE_TIMEOUT_MS);
+
+    LoopbackUser* pUser = acceptUser(sock);
+
+    if (pUser)
+    {
+        // Wait for the messages for as long as needed (stop() shuts the socket down).
+        setLoopbackRecvTimeout(sock, 0);
+
+        while (true)
+        {
+            unsigned char cType = 0;
+
+            if ( recvAll(sock, reinterpret_cast<char*>(&cType), sizeof(cType)) || receiveTCPMessage(pUser, cType) )
+            {
+                break;
+            }
+        }
+
+        removeUser(pUser);
+    }
+
+
+    std::lock_guard<std::mutex> lock(mtxConnectionThreads);
+
+    iConnectionThreads--;
+
+    cvConnectionThreads.notify_all();
+}
+
+void LoopbackServer::udpLoop()
+{
+    char vDatagram[MAX_BUFFER_SIZE + 100];
+
+    while (bRunning)
+    {
+        sockaddr_in addr;
+        LoopbackSockLen iAddrSize = sizeof(addr);
+
+        int iSize = recvfrom(sockUDP, vDatagram, sizeof(vDatagram), 0, reinterpret_cast<sockaddr*>(&addr), &iAddrSize);
+
+        if (iSize <= 0)
+        {
+            // Timeout (to check 'bRunning') or an ICMP error from the disconnected client.
+            continue;
+        }
+
+        receiveUDPDatagram(addr, vDatagram, static_cast<size_t>(iSize));
+    }
+}
+
+void LoopbackServer::tickLoop()
+{
+    std::chrono::steady_clock::time_point nextFrameTime = std::chrono::steady_clock::now();
+
+    while (bRunning)
+    {
+        // Synthetic peers talk with the client's packet rate.
+
+        nextFrameTime += std::chrono::milliseconds(LOOPBACK_FRAME_MS);
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+        if (now - nextFrameTime > std::chrono::seconds(1))
+        {
+            // Way behind (the system was suspended?), don't send a burst.
+            nextFrameTime = now;
+        }
+
+        std::this_thread::sleep_until(nextFrameTime);
+
+
+        std::lock_guard<std::mutex> lock(mtxUsers);
+
+        tickPeers();
+        tickControl();
+        tickChurn();
+    }
+}
+
+LoopbackServer::LoopbackUser* LoopbackServer::acceptUser(LoopbackSocket sock)
+{
+    // Read the connect request: version, user name and password (see NetworkService::setupChatConnection()).
+
+    unsigned char cSize = 0;
+
+    char vVersion[UCHAR_MAX + 1];
+    char vName[UCHAR_MAX + 1];
+    char vPassword[UCHAR_MAX * 2];
+
+    memset(vVersion, 0, sizeof(vVersion));
+    memset(vName, 0, sizeof(vName));
+
+    if ( recvAll(sock, reinterpret_cast<char*>(&cSize), 1) || recvAll(sock, vVersion, cSize)
+         || recvAll(sock, reinterpret_cast<char*>(&cSize), 1) || recvAll(sock, vName, cSize)
+         || recvAll(sock, reinterpret_cast<char*>(&cSize), 1) || recvAll(sock, vPassword, cSize * 2u) )
+    {
+        // The password is ignored (the stand-in has no password).
+
+        closeLoopbackSocket(sock);
+
+        return nullptr;
+    }
+
+    std::string sName = vName;
+
+
+
+    if (std::string(vVersion) != config.sClientVersion)
+    {
+        LoopbackPacket answer;
+        answer.writeU8(CM_WRONG_CLIENT).writeString8(config.sClientVersion);
+
+        rejectUser(sock, answer);
+
+        return nullptr;
+    }
+
+
+    std::unique_lock<std::mutex> lock(mtxUsers);
+
+    size_t iClientCount = 0;
+
+    for (size_t i = 0;  i < vUsers.size();  i++)
+    {
+        if (vUsers[i]->bSynthetic == false)
+        {
+            iClientCount++;
+        }
+    }
+
+    if ( sName.empty() || (sName.size() > MAX_NAME_LENGTH) || findUser(sName) )
+    {
+        lock.unlock();
+
+        LoopbackPacket answer;
+        answer.writeU8(CM_USERNAME_INUSE);
+
+        rejectUser(sock, answer);
+
+        return nullptr;
+    }
+
+    if (iClientCount >= config.iMaxUsers)
+    {
+        lock.unlock();
+
+        LoopbackPacket answer;
+        answer.writeU8(CM_SERVER_FULL);
+
+        rejectUser(sock, answer);
+
+        return nullptr;
+    }
+
+
+
+    // Reserve the name (not shown to the others until the key exchange is finished).
+
+    LoopbackUser* pUser = new LoopbackUser();
+
+    pUser->sName             = sName;
+    pUser->iRoom             = 0;
+    pUser->bSynthetic        = false;
+    pUser->bOnline           = false;
+    pUser->iSpeakerId        = iNextSpeakerId++;
+    pUser->iVoiceSequence    = 0;
+    pUser->sockTCP           = sock;
+    pUser->pAES              = new AES(128);
+    pUser->pVoiceCipher      = new VoiceCipher(VCD_SERVER_TO_CLIENT);
+    pUser->pVoiceCodec       = new VoiceCodec();
+    pUser->cVoiceFeatures    = 0;
+    pUser->bUDPKnown         = false;
+    pUser->bVoiceReady       = false;
+    pUser->acceptTime        = std::chrono::steady_clock::now();
+    pUser->bKeepAlivePending = false;
+    pUser->iTalkFramesLeft   = 0;
+    pUser->iSilenceFramesLeft= 0;
+    pUser->iPing             = 0;
+
+    vUsers.push_back(pUser);
+
+    sendChatInfo(pUser);
+
+    lock.unlock();
+
+
+
+    if (exchangeKeys(pUser))
+    {
+        removeUser(pUser);
+
+        return nullptr;
+    }
+
+
+
+    // Show to the others.
+
+    lock.lock();
+
+    pUser->bOnline           = true;
+    pUser->keepAliveSentTime = std::chrono::steady_clock::now();
+
+    sendToAll(makeNewUser(pUser->sName), pUser);
+    sendSpeakerIdToAll(pUser);
+
+    lock.unlock();
+
+
+    mtxCounters.lock();
+    counters.iConnected++;
+    mtxCounters.unlock();
+
+
+    return pUser;
+}
+
+bool LoopbackServer::exchangeKeys(LoopbackUser* pUser)
+{
+    // See NetworkService::establishSecureConnection().
+
+    mtxUsers.lock();
+
+#if _DEBUG || DEBUG
+    std::uniform_int_distribution<> uid(50, 100); // also in the client
+#else
+    std::uniform_int_distribution<> uid(500, 1000); // also in the client
+#endif
+
+    unsigned long long a = static_cast<unsigned long long>( uid(rndGen) );
+
+    mtxUsers.unlock();
+
+
+    std::string sOpenKeyA = std::to_string( loopbackPowMod(LOOPBACK_KEY_G, a, LOOPBACK_KEY_P) );
+
+    LoopbackPacket keys;
+    keys.writeU32(static_cast<unsigned int>(LOOPBACK_KEY_P))
+        .writeU32(static_cast<unsigned int>(LOOPBACK_KEY_G))
+        .writeU16(static_cast<unsigned short>(sOpenKeyA.size()))
+        .writeBytes(sOpenKeyA.c_str(), sOpenKeyA.size());
+
+    sendTCP(pUser, keys);
+
+
+
+    // Receive the open key B.
+
+    short iStringSize = 0;
+
+    char vOpenKeyB[LOOPBACK_MAX_OPEN_KEY_LENGTH + 1];
+    memset(vOpenKeyB, 0, sizeof(vOpenKeyB));
+
+    if ( recvAll(pUser->sockTCP, reinterpret_cast<char*>(&iStringSize), sizeof(iStringSize))
+         || (iStringSize <= 0) || (iStringSize > LOOPBACK_MAX_OPEN_KEY_LENGTH)
+         || recvAll(pUser->sockTCP, vOpenKeyB, static_cast<size_t>(iStringSize)) )
+    {
+        return true;
+    }
+
+    unsigned long long iOpenKeyB = std::strtoull(vOpenKeyB, nullptr, 10) % LOOPBACK_KEY_P;
+
+
+    unsigned char vKey[LOOPBACK_SESSION_KEY_SIZE];
+    makeLoopbackSessionKey(loopbackPowMod(iOpenKeyB, a, LOOPBACK_KEY_P), vKey);
+
+    pUser->pAES->SetKey(vKey);
+    pUser->pVoiceCipher->deriveKeys(pUser->pAES);
+
+
+
+    // "Finished connecting" from the client and our answer.
+
+    char cMessage = 0;
+
+    if ( recvAll(pUser->sockTCP, &cMessage, sizeof(cMessage)) )
+    {
+        return true;
+    }
+
+    LoopbackPacket answer;
+    answer.writeU8(static_cast<unsigned char>(cMessage));
+
+    if (config.cVoiceFeatures != 0)
+    {
+        // Right after the answer (so it comes before SM_CAN_START_UDP), see NetworkService::receiveVoiceFeatures().
+
+        answer.writeU8(SM_VOICE_FEATURES).writeU8(config.cVoiceFeatures);
+
+        pUser->pVoiceCipher->setEnabled( (config.cVoiceFeatures & VF_AUTHENTICATED_CTR) != 0 );
+    }
+
+    sendTCP(pUser, answer);
+
+
+    return false;
+}
+
+void LoopbackServer::rejectUser(LoopbackSocket sock, const LoopbackPacket& answer)
+{
+    sendAll(sock, answer.getData(), answer.getSize());
+
+
+    // Send FIN and wait for the client's FIN.
+
+    shutdown(sock, LOOPBACK_SHUTDOWN_SEND);
+
+    setLoopbackRecvTimeout(sock, 1000);
+
+    char cByte = 0;
+    recv(sock, &cByte, sizeof(cByte), 0);
+
+    closeLoopbackSocket(sock);
+
+
+    mtxCounters.lock();
+    counters.iRejected++;
+    mtxCounters.unlock();
+}
+
+void LoopbackServer::removeUser(LoopbackUser* pUser)
+{
+    mtxUsers.lock();
+
+    for (size_t i = 0;  i < vUsers.size();  i++)
+    {
+        if (vUsers[i] == pUser)
+        {
+            vUsers.erase(vUsers.begin() + static_cast<long long>(i));
+
+            break;
+        }
+    }
+
+    if (pUser->bOnline)
+    {
+        sendToAll(makeDisconnected(pUser->sName, UDR_DISCONNECT), nullptr);
+    }
+
+    mtxUsers.unlock();
+
+
+    // Answer the client's FIN (it waits for it in NetworkService::disconnect()).
+
+    shutdown(pUser->sockTCP, LOOPBACK_SHUTDOWN_SEND);
+    closeLoopbackSocket(pUser->sockTCP);
+
+    delete pUser->pAES;
+    delete pUser->pVoiceCipher;
+    delete pUser->pVoiceCodec;
+    delete pUser;
+}
+
+bool LoopbackServer::receiveTCPMessage(LoopbackUser* pUser, unsigned char cType)
+{
+    switch (cType)
+    {
+    case(SM_KEEPALIVE):
+    {
+        std::lock_guard<std::mutex> lock(mtxUsers);
+
+        if (pUser->bKeepAlivePending)
+        {
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+            vStats[LSS_KEEPALIVE]->record( static_cast<unsigned long long>(
+                std::chrono::duration_cast<std::chrono::microseconds>(now - pUser->keepAliveSentTime).count() ) );
+
+            pUser->bKeepAlivePending = false;
+            pUser->keepAliveSentTime = now;
+        }
+
+        break;
+    }
+    case(SM_USERMESSAGE):
+    {
+        // [size (2)][ECB encrypted wchar_t string]
+
+        unsigned short iSize = 0;
+
+        if ( recvAll(pUser->sockTCP, reinterpret_cast<char*>(&iSize), sizeof(iSize)) )
+        {
+            return true;
+        }
+
+        std::string sEncrypted(iSize, '\0');
+
+        if ( (iSize > 0) && recvAll(pUser->sockTCP, &sEncrypted[0], iSize) )
+        {
+            return true;
+        }
+
+        if ( (iSize == 0) || (iSize % AES_BLOCK_SIZE != 0) || (iSize > MAX_MESSAGE_LENGTH + AES_BLOCK_SIZE) )
+        {
+            // Damaged.
+            break;
+        }
+
+
+        std::lock_guard<std::mutex> lock(mtxUsers);
+
+        relayUserMessage(pUser, sEncrypted);
+
+        break;
+    }
+    case(RC_ENTER_ROOM):
+    case(RC_ENTER_ROOM_WITH_PASS):
+    {
+        // [name size (1)][name] + [password size (1)][wchar_t password] (with RC_ENTER_ROOM_WITH_PASS, ignored)
+
+        unsigned char cSize = 0;
+
+        char vRoomName[UCHAR_MAX + 1];
+        memset(vRoomName, 0, sizeof(vRoomName));
+
+        char vPassword[UCHAR_MAX * 2];
+
+        if ( recvAll(pUser->sockTCP, reinterpret_cast<char*>(&cSize), 1) || recvAll(pUser->sockTCP, vRoomName, cSize) )
+        {
+            return true;
+        }
+
+        if ( (cType == RC_ENTER_ROOM_WITH_PASS)
+             && ( recvAll(pUser->sockTCP, reinterpret_cast<char*>(&cSize), 1) || recvAll(pUser->sockTCP, vPassword, cSize * 2u) ) )
+        {
+            return true;
+        }
+
+
+        std::lock_guard<std::mutex> lock(mtxUsers);
+
+        moveUserToRoom(pUser, vRoomName);
+
+        break;
+    }
+    case(SM_VOICE_FEATURES):
+    {
+        // Answer to SM_VOICE_FEATURES: the advertised features the client understands.
+
+        unsigned char cFeatures = 0;
+
+        if ( recvAll(pUser->sockTCP, reinterpret_cast<char*>(&cFeatures), sizeof(cFeatures)) )
+        {
+            return true;
+        }
+
+
+        std::lock_guard<std::mutex> lock(mtxUsers);
+
+        cFeatures &= config.cVoiceFeatures;
+
+        if ( (cFeatures & VF_SPEAKER_IDS) && ((pUser->cVoiceFeatures & VF_SPEAKER_IDS) == 0) )
+        {
+            // Before the first voice packet with an id.
+            sendSpeakerIds(pUser);
+        }
+
+        pUser->cVoiceFeatures = cFeatures;
+
+        // The client can decode it too.
+        pUser->pVoiceCodec->setCodec( (cFeatures & VF_ADPCM_CODEC) ? VC_IMA_ADPCM : VC_PCM );
+
+        break;
+    }
+    default:
+    {
+        // Unknown message, its size is unknown too.
+
+        std::printf("LoopbackServer: unknown message (%d) from \"%s\", closing the connection.\n", cType, pUser->sName.c_str());
+
+        return true;
+    }
+    }
+
+
+    return false;
+}
+
+void LoopbackServer::relayUserMessage(LoopbackUser* pUser, std::string sEncrypted)
+{
+    // Decrypt with the sender's key and encrypt with the key of each receiver.
+
+    std::string sPlain(sEncrypted.size(), '\0');
+
+    pUser->pAES->DecryptECBWithSetKey(reinterpret_cast<unsigned char*>(&sEncrypted[0]), static_cast<unsigned int>(sEncrypted.size()),
+                                      reinterpret_cast<unsigned char*>(&sPlain[0]));
+
+
+    // "Hour:Minute. UserName: " (see NetworkService::receiveMessage()).
+
+    time_t now = time(nullptr);
+
+    char vTime[16];
+    std::strftime(vTime, sizeof(vTime), "%H:%M. ", std::localtime(&now));
+
+    std::string sPrefix = std::string(vTime) + pUser->sName + ": ";
+
+
+    for (size_t i = 0;  i < vUsers.size();  i++)
+    {
+        LoopbackUser* pTo = vUsers[i];
+
+        if ( pTo->bSynthetic || (pTo->bOnline == false) )
+        {
+            continue;
+        }
+
+        std::string sOut(sPlain.size(), '\0');
+
+        unsigned int iEncryptedSize = pTo->pAES->EncryptECBWithSetKey(reinterpret_cast<unsigned char*>(&sPlain[0]),
+                                                                      static_cast<unsigned int>(sPlain.size()),
+                                                                      reinterpret_cast<unsigned char*>(&sOut[0]));
+
+        LoopbackPacket packet;
+        packet.writeU8(SM_USERMESSAGE)
+              .writeU16(static_cast<unsigned short>(sPrefix.size() + sizeof(unsigned short) + iEncryptedSize))
+              .writeBytes(sPrefix.c_str(), sPrefix.size())
+              .writeU16(static_cast<unsigned short>(iEncryptedSize))
+              .writeBytes(sOut.c_str(), iEncryptedSize);
+
+        sendTCP(pTo, packet);
+    }
+
+
+    mtxCounters.lock();
+    counters.iMessages++;
+    mtxCounters.unlock();
+}
+
+void LoopbackServer::moveUserToRoom(LoopbackUser* pUser, const std::string& sRoomName)
+{
+    size_t iRoom = config.iRoomCount;
+
+    for (size_t i = 0;  i < config.iRoomCount;  i++)
+    {
+        if (getRoomName(i) == sRoomName)
+        {
+            iRoom = i;
+
+            break;
+        }
+    }
+
+    if (iRoom == config.iRoomCount)
+    {
+        // No such room.
+        return;
+    }
+
+
+    if ( (config.iMaxUsersInRoom != 0) && (iRoom != pUser->iRoom) && (getRoomUserCount(iRoom) >= config.iMaxUsersInRoom) )
+    {
+        LoopbackPacket answer;
+        answer.writeU8(RC_ROOM_IS_FULL);
+
+        sendTCP(pUser, answer);
+
+        return;
+    }
+
+
+    pUser->iRoom = iRoom;
+
+
+    std::string sMessage = toLoopbackWideBytes(config.sRoomMessage);
+
+    LoopbackPacket answer;
+    answer.writeU8(RC_CAN_ENTER_ROOM)
+          .writeString8(sRoomName)
+          .writeU16(static_cast<unsigned short>(sMessage.size()))
+          .writeBytes(sMessage.c_str(), sMessage.size());
+
+    sendTCP(pUser, answer);
+
+    sendToAll(makeEntersRoom(pUser->sName, iRoom), pUser);
+
+
+    mtxCounters.lock();
+    counters.iRoomChanges++;
+    mtxCounters.unlock();
+}
+
+void LoopbackServer::receiveUDPDatagram(const sockaddr_in& addr, char* pDatagram, size_t iSize)
+{
+    std::lock_guard<std::mutex> lock(mtxUsers);
+
+    if (pDatagram[0] == UDP_SM_PREPARE)
+    {
+        // [UDP_SM_PREPARE][name size (1)][name] (see NetworkService::sendVOIPReadyPacket()).
+
+        if ( (iSize < 2) || (iSize < 2u + static_cast<unsigned char>(pDatagram[1])) )
+        {
+            return;
+        }
+
+        LoopbackUser* pUser = findUser( std::string(pDatagram + 2, static_cast<unsigned char>(pDatagram[1])) );
+
+        // (may come before the user is shown to the others: the client sends it right after the key exchange)
+
+        if ( (pUser == nullptr) || pUser->bSynthetic )
+        {
+            return;
+        }
+
+        pUser->addrUDP   = addr;
+        pUser->bUDPKnown = true;
+
+        LoopbackPacket answer;
+        answer.writeU8(SM_CAN_START_UDP);
+
+        sendTCP(pUser, answer);
+
+        return;
+    }
+
+
+    LoopbackUser* pUser = findUserByAddress(addr);
+
+    if (pUser == nullptr)
+    {
+        return;
+    }
+
+
+    if (pDatagram[0] == UDP_SM_USER_READY)
+    {
+        if (pUser->bVoiceReady == false)
+        {
+            pUser->bVoiceReady = true;
+
+            vStats[LSS_CONNECT]->record( static_cast<unsigned long long>(
+                std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - pUser->acceptTime).count() ) );
+
+            sendPing(pUser, UDP_SM_FIRST_PING);
+            sendPingList(pUser);
+        }
+    }
+    else if ( (pDatagram[0] == UDP_SM_PING) || (pDatagram[0] == UDP_SM_FIRST_PING) )
+    {
+        if (iSize != LOOPBACK_PING_SIZE)
+        {
+            return;
+        }
+
+        unsigned long long iSentTime = 0;
+        std::memcpy(&iSentTime, pDatagram + 1, sizeof(iSentTime));
+
+        unsigned long long iNow = static_cast<unsigned long long>(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count() );
+
+        if (iNow >= iSentTime)
+        {
+            vStats[LSS_PING]->record(iNow - iSentTime);
+
+            pUser->iPing = static_cast<unsigned short>( std::min((iNow - iSentTime) / 1000, 65535ULL) );
+        }
+    }
+    else
+    {
+        receiveVoice(pUser, pDatagram, iSize);
+    }
+}
+
+void LoopbackServer::receiveVoice(LoopbackUser* pUser, char* pPacket, size_t iSize)
+{
+    // See NetworkService::sendVoiceMessage().
+
+    unsigned char vDecrypted[VOICE_DATAGRAM_MAX_SIZE];
+
+    VoiceDatagramContent content;
+
+    short vSamples[LOOPBACK_FRAME_SAMPLES];
+    short* pSamples = nullptr;
+
+    bool bRejected = VoiceDatagram::openClientPacket(reinterpret_cast<unsigned char*>(pPacket), iSize, LOOPBACK_FRAME_SAMPLES,
+                                                     pUser->pVoiceCipher, pUser->pAES, vDecrypted, content);
+
+    if ( (bRejected == false) && (content.bLast == false) )
+    {
+        bRejected = ( (content.codec == VC_IMA_ADPCM) && ((config.cVoiceFeatures & VF_ADPCM_CODEC) == 0) )
+                    || VoiceCodec::decode(content.codec, content.pPayload, content.iPayloadSize, vSamples, LOOPBACK_FRAME_SAMPLES);
+
+        pSamples = vSamples;
+    }
+
+    if (bRejected)
+    {
+        // Damaged, forged or replayed: not relayed.
+
+        mtxCounters.lock();
+        counters.iVoiceRejected++;
+        mtxCounters.unlock();
+
+        return;
+    }
+
+
+    mtxCounters.lock();
+    counters.iVoicePacketsIn++;
+    counters.iVoiceBytesIn += iSize;
+    mtxCounters.unlock();
+
+
+
+    // Relay to the room.
+
+    for (size_t i = 0;  i < vUsers.size();  i++)
+    {
+        LoopbackUser* pTo = vUsers[i];
+
+        if ( (pTo != pUser) && (pTo->bSynthetic == false) && pTo->bVoiceReady && (pTo->iRoom == pUser->iRoom) )
+        {
+            sendVoice(pTo, pUser, pSamples);
+        }
+    }
+
+    if (pEchoPeer)
+    {
+        sendVoice(pUser, pEchoPeer, pSamples);
+    }
+
+
+    if (pSamples)
+    {
+        // The last message is not counted (its number is not used).
+
+        pUser->iVoiceSequence++;
+
+        if (pEchoPeer)
+        {
+            pEchoPeer->iVoiceSequence++;
+        }
+    }
+}
+
+void LoopbackServer::sendTCP(LoopbackUser* pTo, const LoopbackPacket& packet)
+{
+    // Errors are found by the connection thread.
+
+    std::lock_guard<std::mutex> lock(pTo->mtxSend);
+
+    sendAll(pTo->sockTCP, packet.getData(), packet.getSize());
+}
+
+void LoopbackServer::sendToAll(const LoopbackPacket& packet, LoopbackUser* pExcept)
+{
+    for (size_t i = 0;  i < vUsers.size();  i++)
+    {
+        if ( (vUsers[i] != pExcept) && (vUsers[i]->bSynthetic == false) && vUsers[i]->bOnline )
+        {
+            sendTCP(vUsers[i], packet);
+        }
+    }
+}
+
+void LoopbackServer::sendChatInfo(LoopbackUser* pTo)
+{
+    // See NetworkService::processChatInfo().
+
+    LoopbackPacket info;
+    info.writeU8(CM_SERVER_INFO).writeU16(0);
+
+    info.writeU8(static_cast<unsigned char>(config.iRoomCount));
+
+    for (size_t iRoom = 0;  iRoom < config.iRoomCount;  iRoom++)
+    {
+        info.writeString8(getRoomName(iRoom))
+            .writeU16(config.iMaxUsersInRoom)
+            .writeU16(static_cast<unsigned short>(getRoomUserCount(iRoom)));
+
+        for (size_t i = 0;  i < vUsers.size();  i++)
+        {
+            if (vUsers[i]->bOnline && (vUsers[i]->iRoom == iRoom))
+            {
+                info.writeString8(vUsers[i]->sName);
+            }
+        }
+    }
+
+    std::string sMessage = toLoopbackWideBytes(config.sRoomMessage);
+
+    info.writeU16(static_cast<unsigned short>(sMessage.size())).writeBytes(sMessage.c_str(), sMessage.size());
+
+    info.patchU16(1, static_cast<unsigned short>(info.getSize() - 3));
+
+
+    sendTCP(pTo, info);
+}
+
+void LoopbackServer::sendPingList(LoopbackUser* pTo)
+{
+    // [name size (1)][name][ping (2)] for everyone.
+
+    LoopbackPacket packet;
+    packet.writeU8(SM_PING).writeU16(0);
+
+    for (size_t i = 0;  i < vUsers.size();  i++)
+    {
+        if (vUsers[i]->bOnline)
+        {
+            packet.writeString8(vUsers[i]->sName).writeU16(vUsers[i]->iPing);
+        }
+    }
+
+    packet.patchU16(1, static_cast<unsigned short>(packet.getSize() - 3));
+
+
+    sendTCP(pTo, packet);
+}
+
+LoopbackPacket LoopbackServer::makeNewUser(const std::string& sName) const
+{
+    // [size (1)][online count (4)][name size (1)][name] (see NetworkService::receiveInfoAboutNewUser()).
+
+    LoopbackPacket packet;
+    packet.writeU8(SM_NEW_USER)
+          .writeU8(static_cast<unsigned char>(4 + 1 + sName.size()))
+          .writeU32(static_cast<unsigned int>(getOnlineCount()))
+          .writeString8(sName);
+
+    return packet;
+}
+
+LoopbackPacket LoopbackServer::makeDisconnected(const std::string& sName, unsigned char cReason) const
+{
+    // [reason (1)][size (1)][online count (4)][name] (see NetworkService::deleteDisconnectedUserFromList()).
+
+    LoopbackPacket packet;
+    packet.writeU8(SM_SOMEONE_DISCONNECTED)
+          .writeU8(cReason)
+          .writeU8(static_cast<unsigned char>(4 + sName.size()))
+          .writeU32(static_cast<unsigned int>(getOnlineCount()))
+          .writeBytes(sName.c_str(), sName.size());
+
+    return packet;
+}
+
+LoopbackPacket LoopbackServer::makeEntersRoom(const std::string& sName, size_t iRoom) const
+{
+    LoopbackPacket packet;
+    packet.writeU8(RC_USER_ENTERS_ROOM).writeString8(sName).writeString8(getRoomName(iRoom));
+
+    return packet;
+}
+
+void LoopbackServer::sendSpeakerIds(LoopbackUser* pTo)
+{
+    // [size (2)] + ([name size (1)][name][speaker id (2)]) for every user (see NetworkService::receiveSpeakerIds()).
+
+    LoopbackPacket packet;
+    packet.writeU8(SM_SPEAKER_IDS).writeU16(0);
+
+    for (size_t i = 0;  i < vUsers.size();  i++)
+    {
+        if ( (vUsers[i] != pTo) && vUsers[i]->bOnline )
+        {
+            packet.writeString8(vUsers[i]->sName).writeU16(vUsers[i]->iSpeakerId);
+        }
+    }
+
+    packet.patchU16(1, static_cast<unsigned short>(packet.getSize() - 3));
+
+
+    sendTCP(pTo, packet);
+}
+
+void LoopbackServer::sendSpeakerIdToAll(LoopbackUser* pOnly)
+{
+    // After SM_NEW_USER (the client only takes the ids of the users it knows).
+
+    LoopbackPacket packet;
+    packet.writeU8(SM_SPEAKER_IDS)
+          .writeU16(static_cast<unsigned short>(1 + pOnly->sName.size() + sizeof(pOnly->iSpeakerId)))
+          .writeString8(pOnly->sName)
+          .writeU16(pOnly->iSpeakerId);
+
+    for (size_t i = 0;  i < vUsers.size();  i++)
+    {
+        if ( (vUsers[i] != pOnly) && (vUsers[i]->bSynthetic == false) && vUsers[i]->bOnline && (vUsers[i]->cVoiceFeatures & VF_SPEAKER_IDS) )
+        {
+            sendTCP(vUsers[i], packet);
+        }
+    }
+}
+
+void LoopbackServer::sendVoice(LoopbackUser* pTo, const LoopbackUser* pFrom, const short* pSamples)
+{
+    // The speaker ([UDP_SM_VOICE_BY_ID][speaker id (2)][speaker sequence (2)] or [name size (1)][name]) + the packet of the client,
+    // sealed or encrypted with the keys of 'pTo' (see VoiceDatagram).
+
+    int iSpeakerId = (pTo->cVoiceFeatures & VF_SPEAKER_IDS) ? pFrom->iSpeakerId : -1;
+
+    unsigned char vDatagram[VOICE_DATAGRAM_MAX_SERVER_SIZE];
+
+    size_t iSize = VoiceDatagram::buildServerPacket(iSpeakerId, pFrom->iVoiceSequence, pFrom->sName,
+                                                    pSamples, LOOPBACK_FRAME_SAMPLES, pSamples == nullptr,
+                                                    pTo->pVoiceCodec, pTo->pVoiceCipher, pTo->pAES, vDatagram);
+
+    sendImpaired(pTo->addrUDP, std::string(reinterpret_cast<char*>(vDatagram), iSize));
+}
+
+void LoopbackServer::sendImpaired(const sockaddr_in& addr, std::string sDatagram)
+{
+    std::uniform_real_distribution<float> urd(0.0f, 100.0f);
+
+    if ( (config.fLossPercent > 0.0f) && (urd(rndGen) < config.fLossPercent) )
+    {
+        mtxCounters.lock();
+        counters.iVoiceLost++;
+        mtxCounters.unlock();
+
+        return;
+    }
+
+
+    unsigned int iDelayMS = 0;
+
+    if (config.iJitterMS > 0)
+    {
+        std::uniform_int_distribution<unsigned int> uid(0, config.iJitterMS);
+        iDelayMS = uid(rndGen);
+    }
+
+    if ( (config.fReorderPercent > 0.0f) && (urd(rndGen) < config.fReorderPercent) )
+    {
+        iDelayMS += LOOPBACK_FRAME_MS;
+
+        mtxCounters.lock();
+        counters.iVoiceReordered++;
+        mtxCounters.unlock();
+    }
+
+
+    if ( (config.fCorruptPercent > 0.0f) && (urd(rndGen) < config.fCorruptPercent) )
+    {
+        std::uniform_int_distribution<size_t> uidByte(0, sDatagram.size() - 1);
+        std::uniform_int_distribution<int>    uidBit(0, 7);
+
+        sDatagram[uidByte(rndGen)] ^= static_cast<char>(1 << uidBit(rndGen));
+
+        mtxCounters.lock();
+        counters.iVoiceCorrupted++;
+        mtxCounters.unlock();
+    }
+
+    size_t iCopies = 1;
+
+    if ( (config.fDuplicatePercent > 0.0f) && (urd(rndGen) < config.fDuplicatePercent) )
+    {
+        iCopies = 2;
+
+        mtxCounters.lock();
+        counters.iVoiceDuplicated++;
+        mtxCounters.unlock();
+    }
+
+
+    for (size_t i = 0;  i < iCopies;  i++)
+    {
+        if (iDelayMS == 0)
+        {
+            sendDatagram(addr, sDatagram);
+        }
+        else
+        {
+            sockaddr_in addrCopy = addr;
+
+            pDelayTimer->schedule(iDelayMS, [this, addrCopy, sDatagram]()
+            {
+                sendDatagram(addrCopy, sDatagram);
+            });
+        }
+    }
+}
+
+void LoopbackServer::sendDatagram(const sockaddr_in& addr, const std::string& sDatagram)
+{
+    if (bRunning == false)
+    {
+        return;
+    }
+
+    int iSize = sendto(sockUDP, sDatagram.c_str(), static_cast<int>(sDatagram.size()), 0,
+                       reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+
+    if (iSize > 0)
+    {
+        std::lock_guard<std::mutex> lock(mtxCounters);
+
+        counters.iVoicePacketsOut++;
+        counters.iVoiceBytesOut += static_cast<unsigned long long>(iSize);
+    }
+}
+
+void LoopbackServer::tickPeers()
+{
+    unsigned int iTalkFrames    = std::max(config.iTalkMS / LOOPBACK_FRAME_MS, 1u);
+    unsigned int iSilenceFrames = config.iSilenceMS / LOOPBACK_FRAME_MS;
+
+    for (size_t i = 0;  i < vUsers.size();  i++)
+    {
+        LoopbackUser* pPeer = vUsers[i];
+
+        if ( (pPeer->bSynthetic == false) || (pPeer->bOnline == false) || pPeer->vTone.empty() )
+        {
+            continue;
+        }
+
+
+        if (pPeer->iTalkFramesLeft == 0)
+        {
+            if (pPeer->iSilenceFramesLeft > 0)
+            {
+                pPeer->iSilenceFramesLeft--;
+            }
+
+            if (pPeer->iSilenceFramesLeft == 0)
+            {
+                pPeer->iTalkFramesLeft = iTalkFrames;
+            }
+
+            continue;
+        }
+
+
+        pPeer->iTalkFramesLeft--;
+
+        bool bLast = (pPeer->iTalkFramesLeft == 0) && (iSilenceFrames > 0);
+
+        for (size_t j = 0;  j < vUsers.size();  j++)
+        {
+            LoopbackUser* pTo = vUsers[j];
+
+            if ( (pTo->bSynthetic == false) && pTo->bVoiceReady && (pTo->iRoom == pPeer->iRoom) )
+            {
+                sendVoice(pTo, pPeer, pPeer->vTone.data());
+
+                if (bLast)
+                {
+                    sendVoice(pTo, pPeer, nullptr);
+                }
+            }
+        }
+
+        pPeer->iVoiceSequence++;
+
+        if (pPeer->iTalkFramesLeft == 0)
+        {
+            pPeer->iSilenceFramesLeft = iSilenceFrames;
+
+            if (iSilenceFrames == 0)
+            {
+                pPeer->iTalkFramesLeft = iTalkFrames;
+            }
+        }
+    }
+}
+
+void LoopbackServer::tickControl()
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+
+    // Keep-alive.
+
+    for (size_t i = 0;  i < vUsers.size();  i++)
+    {
+        LoopbackUser* pUser = vUsers[i];
+
+        if ( pUser->bSynthetic || (pUser->bOnline == false) || pUser->bKeepAlivePending
+             || (now - pUser->keepAliveSentTime < std::chrono::milliseconds(config.iKeepAliveMS)) )
+        {
+            continue;
+        }
+
+        pUser->bKeepAlivePending = true;
+        pUser->keepAliveSentTime = now;
+
+        LoopbackPacket packet;
+        packet.writeU8(SM_KEEPALIVE);
+
+        sendTCP(pUser, packet);
+    }
+
+
+
+    // Ping.
+
+    if (now - lastPingTime < std::chrono::milliseconds(config.iPingMS))
+    {
+        return;
+    }
+
+    lastPingTime = now;
+
+    for (size_t i = 0;  i < vUsers.size();  i++)
+    {
+        if ( (vUsers[i]->bSynthetic == false) && vUsers[i]->bVoiceReady )
+        {
+            // The list has the results of the previous check.
+
+            sendPing(vUsers[i], UDP_SM_PING);
+            sendPingList(vUsers[i]);
+        }
+    }
+}
+
+void LoopbackServer::sendPing(LoopbackUser* pTo, char cType)
+{
+    unsigned long long iNow = static_cast<unsigned long long>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count() );
+
+    char vPing[LOOPBACK_PING_SIZE];
+    vPing[0] = cType;
+    std::memcpy(vPing + 1, &iNow, sizeof(iNow));
+
+    // Not impaired (it's not a voice packet).
+    sendto(sockUDP, vPing, sizeof(vPing), 0, reinterpret_cast<const sockaddr*>(&pTo->addrUDP), sizeof(pTo->addrUDP));
+}
+
+void LoopbackServer::tickChurn()
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    if ( (config.iChurnMS == 0) || (config.iPeerCount == 0) || (now - lastChurnTime < std::chrono::milliseconds(config.iChurnMS)) )
+    {
+        return;
+    }
+
+    lastChurnTime = now;
+
+
+    // Pick a peer (not the echo one).
+
+    std::vector<LoopbackUser*> vPeers;
+
+    for (size_t i = 0;  i < vUsers.size();  i++)
+    {
+        if ( vUsers[i]->bSynthetic && (vUsers[i]->vTone.empty() == false) )
+        {
+            vPeers.push_back(vUsers[i]);
+        }
+    }
+
+    std::uniform_int_distribution<size_t> uidPeer(0, vPeers.size() - 1);
+
+    LoopbackUser* pPeer = vPeers[uidPeer(rndGen)];
+
+
+    if (pPeer->bOnline == false)
+    {
+        // Comes back to the Welcome Room.
+
+        pPeer->bOnline = true;
+        pPeer->iRoom   = 0;
+
+        sendToAll(makeNewUser(pPeer->sName), nullptr);
+        sendSpeakerIdToAll(pPeer);
+    }
+    else
+    {
+        if (pPeer->iTalkFramesLeft > 0)
+        {
+            // Stops talking in the old room.
+
+            for (size_t i = 0;  i < vUsers.size();  i++)
+            {
+                if ( (vUsers[i]->bSynthetic == false) && vUsers[i]->bVoiceReady && (vUsers[i]->iRoom == pPeer->iRoom) )
+                {
+                    sendVoice(vUsers[i], pPeer, nullptr);
+                }
+            }
+
+            pPeer->iTalkFramesLeft    = 0;
+            pPeer->iSilenceFramesLeft = config.iSilenceMS / LOOPBACK_FRAME_MS + 1;
+        }
+
+
+        std::uniform_int_distribution<int> uidAction(0, 2);
+
+        if ( (config.iRoomCount == 1) || (uidAction(rndGen) == 0) )
+        {
+            pPeer->bOnline = false;
+
+            sendToAll(makeDisconnected(pPeer->sName, UDR_DISCONNECT), nullptr);
+        }
+        else
+        {
+            std::uniform_int_distribution<size_t> uidRoom(1, config.iRoomCount - 1);
+
+            pPeer->iRoom = (pPeer->iRoom + uidRoom(rndGen)) % config.iRoomCount;
+
+            sendToAll(makeEntersRoom(pPeer->sName, pPeer->iRoom), nullptr);
+        }
+    }
+
+
+    mtxCounters.lock();
+    counters.iChurnEvents++;
+    mtxCounters.unlock();
+}
+
+LoopbackServer::LoopbackUser* LoopbackServer::findUser(const std::string& sName) const
+{
+    for (size_t i = 0;  i < vUsers.size();  i++)
+    {
+        if (vUsers[i]->sName == sName)
+        {
+            return vUsers[i];
+        }
+    }
+
+    return nullptr;
+}
+
+LoopbackServer::LoopbackUser* LoopbackServer::findUserByAddress(const sockaddr_in& addr) const
+{
+    for (size_t i = 0;  i < vUsers.size();  i++)
+    {
+        if ( vUsers[i]->bUDPKnown
+             && (vUsers[i]->addrUDP.sin_addr.s_addr == addr.sin_addr.s_addr) && (vUsers[i]->addrUDP.sin_port == addr.sin_port) )
+        {
+            return vUsers[i];
+        }
+    }
+
+    return nullptr;
+}
+
+size_t LoopbackServer::getOnlineCount() const
+{
+    size_t iCount = 0;
+
+    for (size_t i = 0;  i < vUsers.size();  i++)
+    {
+        if (vUsers[i]->bOnline)
+        {
+            iCount++;
+        }
+    }
+
+    return iCount;
+}
+
+size_t LoopbackServer::getRoomUserCount(size_t iRoom) const
+{
+    size_t iCount = 0;
+
+    for (size_t i = 0;  i < vUsers.size();  i++)
+    {
+        if (vUsers[i]->bOnline && (vUsers[i]->iRoom == iRoom))
+        {
+            iCount++;
+        }
+    }
+
+    return iCount;
+}
+
+std::string LoopbackServer::getRoomName(size_t iRoom) const
+{
+    if (iRoom == 0)
+    {
+        return "Welcome Room";
+    }
+
+    return "Room " + std::to_string(iRoom);
+}
+
+LoopbackServer::~LoopbackServer()
+{
+    stop();
+
+    delete pDelayTimer;
+
+    for (size_t i = 0;  i < LSS_COUNT;  i++)
+    {
+        delete vStats[i];
+    }
+
+    for (size_t i = 0;  i < vUsers.size();  i++)
+    {
+        delete vUsers[i];
+    }
+}
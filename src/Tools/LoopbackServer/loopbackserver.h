@@ -0,0 +1,310 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+
+// Custom
+#include "Tools/LoopbackServer/loopbacknet.h"
+
+
+class AES;
+class AudioTimer;
+class LatencyHistogram;
+class VoiceCipher;
+class VoiceCodec;
+struct LatencyStats;
+
+
+// The client's audio packet (see AudioService): 679 samples at 19400 Hz.
+#define  LOOPBACK_FRAME_SAMPLES        679
+#define  LOOPBACK_FRAME_MS             35
+
+// Name of the peer that plays the client's own voice back to it.
+#define  LOOPBACK_ECHO_PEER_NAME       "echo"
+
+
+struct LoopbackServerConfig
+{
+    LoopbackServerConfig();
+
+
+    unsigned short  iPort;              // TCP and UDP
+    std::string     sClientVersion;     // others get CM_WRONG_CLIENT
+    size_t          iMaxUsers;          // real clients, others get CM_SERVER_FULL
+
+    size_t          iRoomCount;         // "Welcome Room", "Room 1", ...
+    unsigned short  iMaxUsersInRoom;    // 0 - no limit
+    std::string     sRoomMessage;       // shown when entering a room (ASCII)
+
+
+    // Synthetic peers: talk spurts of 'iTalkMS' (a tone in each client's codec) separated by 'iSilenceMS' ('iSilenceMS' 0 - talk all the time).
+
+    size_t          iPeerCount;
+    unsigned int    iTalkMS;
+    unsigned int    iSilenceMS;
+
+    // Plays the voice of each client back to it from the LOOPBACK_ECHO_PEER_NAME peer.
+    bool            bEcho;
+
+
+    // VOICE_FEATURE flags advertised with SM_VOICE_FEATURES after the key exchange (0 - the message is not sent).
+    unsigned char   cVoiceFeatures;
+
+
+    // Impairments of the voice packets sent to the clients.
+
+    float           fLossPercent;
+    unsigned int    iJitterMS;          // each packet is delayed by [0, iJitterMS]
+    float           fReorderPercent;    // delayed by one more frame so the next packet comes first
+    float           fDuplicatePercent;  // sent twice (a replay for VF_AUTHENTICATED_CTR)
+    float           fCorruptPercent;    // one byte is changed
+
+
+    // Every 'iChurnMS' one peer moves to another room or leaves / comes back (0 - no churn).
+    unsigned int    iChurnMS;
+
+
+    unsigned int    iKeepAliveMS;       // SM_KEEPALIVE to each client (after it answers the previous one)
+    unsigned int    iPingMS;            // UDP ping check and SM_PING
+};
+
+
+struct LoopbackServerCounters
+{
+    unsigned long long  iConnected;
+    unsigned long long  iRejected;
+
+    unsigned long long  iVoicePacketsIn;
+    unsigned long long  iVoiceBytesIn;
+    unsigned long long  iVoiceRejected;  // damaged, forged or replayed (not relayed)
+    unsigned long long  iVoicePacketsOut;
+    unsigned long long  iVoiceBytesOut;
+
+    unsigned long long  iVoiceLost;      // dropped by the impairments
+    unsigned long long  iVoiceReordered;
+    unsigned long long  iVoiceDuplicated;
+    unsigned long long  iVoiceCorrupted;
+
+    unsigned long long  iMessages;       // SM_USERMESSAGE from the clients
+    unsigned long long  iRoomChanges;    // RC_ENTER_ROOM from the clients
+    unsigned long long  iChurnEvents;
+};
+
+
+enum LOOPBACK_SERVER_STAT
+{
+    LSS_CONNECT             = 0,  // accept() -> UDP_SM_USER_READY
+    LSS_PING                = 1,  // UDP ping round trip
+    LSS_KEEPALIVE           = 2,  // SM_KEEPALIVE -> answer (TCP round trip)
+
+    LSS_COUNT               = 3
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Stand-in for the Silent Server to benchmark the client without a real server.
+// Speaks the protocol of NetworkService: the connect request and the key exchange,
+// rooms, text messages, keep-alive, ping and the voice packets (ECB or VF_AUTHENTICATED_CTR if advertised,
+// each relayed packet is opened and sealed again for each listener, see VoiceCipher). With VF_SPEAKER_IDS
+// every user gets a speaker id, the clients that answer with it get SM_SPEAKER_IDS and UDP_SM_VOICE_BY_ID packets,
+// with VF_ADPCM_CODEC the voice is decoded and encoded again for the clients that answer with it.
+// Synthetic peers are shown in the rooms like real users and talk, voice of the real clients is relayed to
+// the clients in the same room (and echoed back), every voice packet to a client goes through the impairments.
+// One thread per client (TCP), one UDP thread, one thread for the synthetic peers and the periodic messages.
+class LoopbackServer
+{
+
+public:
+
+    LoopbackServer(const LoopbackServerConfig& config);
+
+
+    // Binds the TCP and UDP sockets and starts the threads. Returns true if failed ('sErrorOut' has the reason).
+
+        bool         start               (std::string& sErrorOut);
+
+
+    // Closes all connections (without the disconnect messages) and waits for the threads.
+
+        void         stop                ();
+
+
+    // Stats
+
+        LoopbackServerCounters  getCounters  () const;
+
+        // Returns false if nothing was recorded.
+        bool         getStats            (LOOPBACK_SERVER_STAT stat, LatencyStats* pStats) const;
+
+        std::string  format              () const;
+
+        static const char*  getStatName  (LOOPBACK_SERVER_STAT stat);
+
+
+    ~LoopbackServer();
+
+private:
+
+    struct LoopbackUser
+    {
+        std::string     sName;
+        size_t          iRoom;
+
+        bool            bSynthetic;
+        bool            bOnline;        // shown to the others (real clients after the key exchange, synthetic peers go offline on churn)
+        unsigned short  iSpeakerId;     // never reused
+        unsigned short  iVoiceSequence; // of the next voice packet of this speaker (sent in UDP_SM_VOICE_BY_ID packets)
+
+
+        // Real clients.
+
+        LoopbackSocket  sockTCP;
+        std::mutex      mtxSend;        // TCP messages are sent from several threads
+        AES*            pAES;
+        VoiceCipher*    pVoiceCipher;   // enabled if VF_AUTHENTICATED_CTR is advertised
+        VoiceCodec*     pVoiceCodec;    // of the voice sent to this client
+        unsigned char   cVoiceFeatures; // advertised ones the client answered with (SM_VOICE_FEATURES)
+
+        sockaddr_in     addrUDP;
+        bool            bUDPKnown;
+        bool            bVoiceReady;
+
+        std::chrono::steady_clock::time_point  acceptTime;
+        std::chrono::steady_clock::time_point  keepAliveSentTime;  // or the last answer if not pending
+        bool            bKeepAlivePending;
+
+
+        // Synthetic peers.
+
+        std::vector<short>  vTone;
+        unsigned int    iTalkFramesLeft;
+        unsigned int    iSilenceFramesLeft;
+
+
+        unsigned short  iPing;
+    };
+
+
+    // Threads
+
+        void         acceptLoop          ();
+        void         connectionLoop      (LoopbackSocket sock);
+        void         udpLoop             ();
+        void         tickLoop            ();
+
+
+    // Connection. Return nullptr if the client was rejected (the socket is closed then).
+
+        LoopbackUser*  acceptUser        (LoopbackSocket sock);
+        bool         exchangeKeys        (LoopbackUser* pUser);
+        void         rejectUser          (LoopbackSocket sock, const LoopbackPacket& answer);
+        void         removeUser          (LoopbackUser* pUser);
+
+
+    // Client messages. receiveTCPMessage() reads the rest of the message (after the type) and returns true
+    // if the connection is closed, the rest are called under 'mtxUsers'.
+
+        bool         receiveTCPMessage   (LoopbackUser* pUser, unsigned char cType);
+        void         relayUserMessage    (LoopbackUser* pUser, std::string sEncrypted);
+        void         moveUserToRoom      (LoopbackUser* pUser, const std::string& sRoomName);
+        void         receiveUDPDatagram  (const sockaddr_in& addr, char* pDatagram, size_t iSize);
+        void         receiveVoice        (LoopbackUser* pUser, char* pPacket, size_t iSize);
+
+
+    // Server messages (under 'mtxUsers').
+
+        void         sendTCP             (LoopbackUser* pTo, const LoopbackPacket& packet);
+        void         sendToAll           (const LoopbackPacket& packet, LoopbackUser* pExcept);
+        void         sendChatInfo        (LoopbackUser* pTo);
+        void         sendPingList        (LoopbackUser* pTo);
+        LoopbackPacket  makeNewUser      (const std::string& sName) const;
+        LoopbackPacket  makeDisconnected (const std::string& sName, unsigned char cReason) const;
+        LoopbackPacket  makeEntersRoom   (const std::string& sName, size_t iRoom) const;
+
+        // SM_SPEAKER_IDS with all online users (except 'pTo') or with 'pOnly' to every client that uses the ids.
+        void         sendSpeakerIds      (LoopbackUser* pTo);
+        void         sendSpeakerIdToAll  (LoopbackUser* pOnly);
+
+
+    // Voice to the clients (under 'mtxUsers'): 'pSamples' is nullptr for the last message.
+
+        void         sendVoice           (LoopbackUser* pTo, const LoopbackUser* pFrom, const short* pSamples);
+        void         sendImpaired        (const sockaddr_in& addr, std::string sDatagram);
+        void         sendDatagram        (const sockaddr_in& addr, const std::string& sDatagram);
+
+
+    // Periodic (tickLoop()).
+
+        void         tickPeers           ();
+        void         tickControl         ();
+        void         sendPing            (LoopbackUser* pTo, char cType);
+        void         tickChurn           ();
+
+
+    // Under 'mtxUsers'.
+
+        LoopbackUser*  findUser          (const std::string& sName) const;
+        LoopbackUser*  findUserByAddress (const sockaddr_in& addr) const;
+        size_t       getOnlineCount      () const;
+        size_t       getRoomUserCount    (size_t iRoom) const;
+        std::string  getRoomName         (size_t iRoom) const;
+
+
+    LoopbackServerConfig     config;
+
+
+    LoopbackSocket           sockListen;
+    LoopbackSocket           sockUDP;
+
+
+    std::thread              acceptThread;
+    std::thread              udpThread;
+    std::thread              tickThread;
+
+    // Connection threads are detached, stop() waits until there are none.
+    size_t                   iConnectionThreads;
+    std::mutex               mtxConnectionThreads;
+    std::condition_variable  cvConnectionThreads;
+
+
+    // Delays the impaired voice packets.
+    AudioTimer*              pDelayTimer;
+
+
+    std::vector<LoopbackUser*>  vUsers;
+    LoopbackUser*            pEchoPeer;        // nullptr if there is no echo
+    unsigned short           iNextSpeakerId;
+    mutable std::mutex       mtxUsers;
+
+
+    LatencyHistogram*        vStats[LSS_COUNT];
+    LoopbackServerCounters   counters;
+    mutable std::mutex       mtxCounters;
+
+
+    std::mt19937_64          rndGen;
+    std::chrono::steady_clock::time_point  startTime;
+    std::chrono::steady_clock::time_point  lastPingTime;
+    std::chrono::steady_clock::time_point  lastChurnTime;
+
+
+    std::atomic<bool>        bRunning;
+};
@@ -0,0 +1,327 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+
+// STL
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Custom
+#include "Model/net_params.h"
+#include "Model/net_messages.h"
+#include "Tools/LoopbackServer/loopbackcheck.h"
+#include "Tools/LoopbackServer/loopbacknet.h"
+#include "Tools/LoopbackServer/loopbackserver.h"
+#include "Tools/LoopbackServer/loopbackclient.h"
+#include "Tools/ModelChecks/modelchecks.h"
+
+
+static void printUsage()
+{
+    std::printf(
+        "Stand-in Silent server for load and latency benchmarks.\n"
+        "\n"
+        "Usage: SilentLoopbackServer [options]\n"
+        "\n"
+        "Server:\n"
+        "  --port N            TCP and UDP port (51337)\n"
+        "  --rooms N           rooms (3)\n"
+        "  --room-limit N      max users in a room, 0 - no limit (0)\n"
+        "  --peers N           synthetic peers (4)\n"
+        "  --talk MS           talk spurt of a peer (3000)\n"
+        "  --silence MS        pause between the talk spurts, 0 - talk all the time (2000)\n"
+        "  --no-echo           don't play the voice of the clients back from the \"echo\" peer\n"
+        "  --ctr               advertise VF_AUTHENTICATED_CTR (the voice is sealed for each client)\n"
+        "  --speaker-ids       advertise VF_SPEAKER_IDS (the voice has the speaker id instead of the name)\n"
+        "  --adpcm             advertise VF_ADPCM_CODEC (the voice is IMA ADPCM in both directions)\n"
+        "  --loss PERCENT      voice packets to the clients that are dropped (0)\n"
+        "  --jitter MS         voice packets to the clients are delayed by [0, MS] (0)\n"
+        "  --reorder PERCENT   voice packets delayed by one more packet (0)\n"
+        "  --duplicate PERCENT voice packets sent twice (0)\n"
+        "  --corrupt PERCENT   voice packets with one byte changed (0)\n"
+        "  --churn MS          a peer moves to another room or leaves / comes back every MS, 0 - never (0)\n"
+        "  --keepalive MS      keep-alive interval (%d)\n"
+        "  --ping MS           ping check interval (%d)\n"
+        "\n"
+        "Benchmark clients (headless, same protocol as the Silent client):\n"
+        "  --clients N         connect N clients, 0 - only run the server (0)\n"
+        "  --connect ADDRESS   connect the clients to this server instead of starting one\n"
+        "  --messages MS       each client sends a text message every MS, 0 - never (1000)\n"
+        "  --room-hops MS      each client moves between the first two rooms every MS, 0 - never (0)\n"
+        "  --quiet             the clients don't talk\n"
+        "\n"
+        "  --duration S        stop after S seconds, 0 - run until killed (10 with clients, 0 without)\n"
+        "  --report S          print the stats every S seconds, 0 - only at the end (0)\n"
+        "\n"
+        "  --check             run the server with two clients in each voice mode and check the voice path\n"
+        "                      (uses --port, the other options are ignored)\n"
+        "\n"
+        "Exits with 1 if any client failed to connect (or any check failed).\n",
+        INTERVAL_KEEPALIVE_SEC * 1000, PING_CHECK_INTERVAL_SEC * 1000);
+}
+
+// Returns true if the option needs a value and there is none.
+static bool readOption(int argc, char* argv[], int& i, std::string& sValueOut)
+{
+    if (i + 1 >= argc)
+    {
+        std::printf("Option %s needs a value.\n", argv[i]);
+
+        return true;
+    }
+
+    i++;
+    sValueOut = argv[i];
+
+    return false;
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+int main(int argc, char* argv[])
+{
+    LoopbackServerConfig serverConfig;
+    LoopbackClientConfig clientConfig;
+
+    size_t       iClientCount = 0;
+    bool         bStartServer = true;
+    int          iDurationSec = -1;
+    unsigned int iReportSec   = 0;
+    bool         bCheck       = false;
+
+
+    for (int i = 1;  i < argc;  i++)
+    {
+        std::string sOption = argv[i];
+        std::string sValue;
+
+        if ( (sOption == "--help") || (sOption == "-h") )
+        {
+            printUsage();
+
+            return 0;
+        }
+        else if (sOption == "--no-echo")
+        {
+            serverConfig.bEcho = false;
+
+            continue;
+        }
+        else if (sOption == "--quiet")
+        {
+            clientConfig.bTalk = false;
+
+            continue;
+        }
+        else if (sOption == "--ctr")
+        {
+            serverConfig.cVoiceFeatures |= VF_AUTHENTICATED_CTR;
+
+            continue;
+        }
+        else if (sOption == "--speaker-ids")
+        {
+            serverConfig.cVoiceFeatures |= VF_SPEAKER_IDS;
+
+            continue;
+        }
+        else if (sOption == "--adpcm")
+        {
+            serverConfig.cVoiceFeatures |= VF_ADPCM_CODEC;
+
+            continue;
+        }
+        else if (sOption == "--check")
+        {
+            bCheck = true;
+
+            continue;
+        }
+
+        if ( readOption(argc, argv, i, sValue) )
+        {
+            return 2;
+        }
+
+        unsigned long iValue = std::strtoul(sValue.c_str(), nullptr, 10);
+        float         fValue = static_cast<float>( std::atof(sValue.c_str()) );
+
+        if      (sOption == "--port")       { serverConfig.iPort = static_cast<unsigned short>(iValue); clientConfig.iPort = serverConfig.iPort; }
+        else if (sOption == "--rooms")      serverConfig.iRoomCount      = iValue;
+        else if (sOption == "--room-limit") serverConfig.iMaxUsersInRoom = static_cast<unsigned short>(iValue);
+        else if (sOption == "--peers")      serverConfig.iPeerCount      = iValue;
+        else if (sOption == "--talk")       serverConfig.iTalkMS         = static_cast<unsigned int>(iValue);
+        else if (sOption == "--silence")    serverConfig.iSilenceMS      = static_cast<unsigned int>(iValue);
+        else if (sOption == "--loss")       serverConfig.fLossPercent    = fValue;
+        else if (sOption == "--jitter")     serverConfig.iJitterMS       = static_cast<unsigned int>(iValue);
+        else if (sOption == "--reorder")    serverConfig.fReorderPercent = fValue;
+        else if (sOption == "--duplicate")  serverConfig.fDuplicatePercent = fValue;
+        else if (sOption == "--corrupt")    serverConfig.fCorruptPercent = fValue;
+        else if (sOption == "--churn")      serverConfig.iChurnMS        = static_cast<unsigned int>(iValue);
+        else if (sOption == "--keepalive")  serverConfig.iKeepAliveMS    = static_cast<unsigned int>(iValue);
+        else if (sOption == "--ping")       serverConfig.iPingMS         = static_cast<unsigned int>(iValue);
+        else if (sOption == "--clients")    iClientCount                 = iValue;
+        else if (sOption == "--connect")    { clientConfig.sAddress = sValue; bStartServer = false; }
+        else if (sOption == "--messages")   clientConfig.iMessageMS      = static_cast<unsigned int>(iValue);
+        else if (sOption == "--room-hops")  clientConfig.iRoomChangeMS   = static_cast<unsigned int>(iValue);
+        else if (sOption == "--duration")   iDurationSec                 = static_cast<int>(iValue);
+        else if (sOption == "--report")     iReportSec                   = static_cast<unsigned int>(iValue);
+        else
+        {
+            std::printf("Unknown option: %s\n\n", sOption.c_str());
+
+            printUsage();
+
+            return 2;
+        }
+    }
+
+    if (iDurationSec < 0)
+    {
+        iDurationSec = (iClientCount > 0) ? 10 : 0;
+    }
+
+
+    if ( loopbackStartup() )
+    {
+        std::printf("WSAStartup() failed.\n");
+
+        return 2;
+    }
+
+
+    if (bCheck)
+    {
+        std::printf("loopback:\n");
+
+        ModelCheckReport report;
+
+        runLoopbackChecks(report, serverConfig.iPort);
+
+        std::printf("    %zu passed, %zu failed, %zu skipped\n", report.getPassedCount(), report.getFailedCount(), report.getSkippedCount());
+        std::printf( "\n%s\n", (report.getFailedCount() == 0) ? "OK" : "FAILED" );
+
+        loopbackCleanup();
+
+        return (report.getFailedCount() == 0) ? 0 : 1;
+    }
+
+
+
+    // Server.
+
+    LoopbackServer* pServer = nullptr;
+
+    if (bStartServer)
+    {
+        pServer = new LoopbackServer(serverConfig);
+
+        std::string sError;
+
+        if ( pServer->start(sError) )
+        {
+            std::printf("Failed to start the server: %s.\n", sError.c_str());
+
+            delete pServer;
+            loopbackCleanup();
+
+            return 2;
+        }
+
+        std::printf("Listening on port %u (%zu rooms, %zu peers).\n", serverConfig.iPort, serverConfig.iRoomCount, serverConfig.iPeerCount);
+    }
+
+
+
+    // Clients.
+
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    LoopbackClientStats clientStats;
+
+    std::vector<LoopbackClient*> vClients;
+
+    for (size_t i = 0;  i < iClientCount;  i++)
+    {
+        LoopbackClient* pClient = new LoopbackClient(clientConfig, "bench" + std::to_string(i + 1), &clientStats);
+
+        std::string sError;
+
+        if ( pClient->connect(sError) )
+        {
+            std::printf("Client %zu failed to connect: %s.\n", i + 1, sError.c_str());
+        }
+
+        vClients.push_back(pClient);
+    }
+
+
+
+    // Run.
+
+    std::chrono::steady_clock::time_point lastReportTime = std::chrono::steady_clock::now();
+
+    while ( (iDurationSec == 0) || (std::chrono::steady_clock::now() - startTime < std::chrono::seconds(iDurationSec)) )
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        if ( (iReportSec != 0) && (std::chrono::steady_clock::now() - lastReportTime >= std::chrono::seconds(iReportSec)) )
+        {
+            lastReportTime = std::chrono::steady_clock::now();
+
+            double dSeconds = std::chrono::duration<double>(lastReportTime - startTime).count();
+
+            if (pServer)
+            {
+                std::printf("\n%s", pServer->format().c_str());
+            }
+
+            if (vClients.empty() == false)
+            {
+                std::printf("\n%s", clientStats.format(dSeconds).c_str());
+            }
+
+            std::fflush(stdout);
+        }
+    }
+
+    double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+
+
+    // Stop: the clients disconnect like the real one (FIN and wait for the server's FIN).
+
+    for (size_t i = 0;  i < vClients.size();  i++)
+    {
+        delete vClients[i];
+    }
+
+    if (pServer)
+    {
+        std::printf("\n%s", pServer->format().c_str());
+
+        delete pServer;
+    }
+
+    if (iClientCount > 0)
+    {
+        std::printf("\n%s", clientStats.format(dSeconds).c_str());
+    }
+
+    loopbackCleanup();
+
+
+    return (clientStats.iConnected == iClientCount) ? 0 : 1;
+}
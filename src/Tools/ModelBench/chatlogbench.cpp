@@ -0,0 +1,229 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "modelbench.h"
+
+
+// STL
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Custom
+#include "Model/ChatLog/chatlog.h"
+
+
+// Messages inserted in each pass.
+#define  CHAT_LOG_BENCH_MESSAGE_COUNT   100000
+
+// Different users writing (a busy server).
+#define  CHAT_LOG_BENCH_USER_COUNT      200
+
+// Lines of a history load (see MainWindow::slotShowOldText()).
+#define  CHAT_LOG_BENCH_HISTORY_LINES   10
+
+
+// The HTML of the old MainWindow::printUserMessage() (the document of the QPlainTextEdit only grew).
+static const std::wstring sOldTimeStart    = L"<font style=\"color: ";
+static const std::wstring sOldMessageStart = L"<font style=\"color: ";
+static const std::wstring sOldMessageEnd   = L"</font>";
+
+
+struct ChatLogBenchMessage
+{
+    std::string   sUserName;
+    std::wstring  sText;
+};
+
+
+static std::vector<ChatLogBenchMessage> makeMessages()
+{
+    std::vector<ChatLogBenchMessage> vMessages(CHAT_LOG_BENCH_MESSAGE_COUNT);
+
+    for (size_t i = 0;  i < vMessages.size();  i++)
+    {
+        vMessages[i].sUserName = "user" + std::to_string(i % CHAT_LOG_BENCH_USER_COUNT);
+        vMessages[i].sText     = L"message number " + std::to_wstring(i) + L", a few more words of the usual chat length";
+    }
+
+    return vMessages;
+}
+
+// The old printUserMessage() without the Qt layout: replace the spaces, wrap in the font tags, append to the document.
+static void appendOldHTML(std::wstring& sDocument, const ChatLogBenchMessage& message)
+{
+    std::wstring sNameWithMessage = L" " + std::wstring(message.sUserName.begin(), message.sUserName.end()) + L": " + message.sText;
+
+    std::wstring sEscaped;
+
+    for (size_t i = 0;  i < sNameWithMessage.size();  i++)
+    {
+        if (sNameWithMessage[i] == L' ')
+        {
+            sEscaped += L"&nbsp;";
+        }
+        else
+        {
+            sEscaped += sNameWithMessage[i];
+        }
+    }
+
+    sEscaped += L"<br>";
+
+    std::wstring sFinalMessage = sOldTimeStart    + L"white\">" + L"18:58." + sOldMessageEnd;
+    sFinalMessage             += sOldMessageStart + L"white\">" + sEscaped  + sOldMessageEnd;
+
+    sDocument += sFinalMessage;
+}
+
+// Kept entries and the text of the slots (lower bound: the allocator overhead is not counted).
+static size_t getChatLogBytes(const ChatLog& log)
+{
+    size_t iBytes = log.getCapacity() * sizeof(ChatLogEntry);
+
+    for (size_t i = 0;  i < log.getSize();  i++)
+    {
+        iBytes += log.getEntry(i).sText.capacity() * sizeof(wchar_t);
+    }
+
+    for (unsigned int i = 0;  i < log.getNameCount();  i++)
+    {
+        iBytes += sizeof(std::string) + log.getName(i).capacity();
+    }
+
+    return iBytes;
+}
+
+// Runs 'CHAT_LOG_BENCH_MESSAGE_COUNT' inserts per pass until 'dSecondsPerCase', returns ns per message.
+template <typename InsertPass>
+static double timeInserts(const ModelBenchOptions& options, InsertPass insertPass)
+{
+    unsigned long long iMessageCount = 0;
+
+    BenchClock::time_point startTime = BenchClock::now();
+    BenchClock::duration   minTime   = std::chrono::duration_cast<BenchClock::duration>( std::chrono::duration<double>(options.dSecondsPerCase) );
+
+    do
+    {
+        insertPass();
+
+        iMessageCount += CHAT_LOG_BENCH_MESSAGE_COUNT;
+    }
+    while (BenchClock::now() - startTime < minTime);
+
+    return std::chrono::duration<double, std::nano>(BenchClock::now() - startTime).count() / static_cast<double>(iMessageCount);
+}
+
+static double timeOnce(BenchClock::time_point startTime)
+{
+    return std::chrono::duration<double, std::micro>(BenchClock::now() - startTime).count();
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+void runChatLogBench(const ModelBenchOptions& options)
+{
+    std::vector<ChatLogBenchMessage> vMessages = makeMessages();
+
+
+    std::printf("Chat: %d messages of %d users (the Qt layout of the old QPlainTextEdit is not included):\n",
+                CHAT_LOG_BENCH_MESSAGE_COUNT, CHAT_LOG_BENCH_USER_COUNT);
+    std::printf("%-32s %12s %12s %10s %16s\n", "case", "ns/message", "kept", "names", "memory (KB)");
+
+
+    // Old: one HTML document.
+
+    size_t iOldDocumentBytes = 0;
+
+    double dOld = timeInserts(options, [&]()
+    {
+        std::wstring sDocument;
+
+        for (size_t i = 0;  i < vMessages.size();  i++)
+        {
+            appendOldHTML(sDocument, vMessages[i]);
+        }
+
+        iOldDocumentBytes = sDocument.capacity() * sizeof(wchar_t);
+    });
+
+    std::printf("%-32s %12.0f %12d %10s %16zu\n", "old HTML document", dOld, CHAT_LOG_BENCH_MESSAGE_COUNT, "-", iOldDocumentBytes / 1024);
+
+
+    // ChatLog: the default capacity and all messages kept.
+
+    const size_t vCapacities[] = { CHAT_LOG_DEFAULT_CAPACITY, CHAT_LOG_BENCH_MESSAGE_COUNT };
+
+    for (size_t c = 0;  c < sizeof(vCapacities) / sizeof(vCapacities[0]);  c++)
+    {
+        ChatLog log(vCapacities[c]);
+
+        double dChatLog = timeInserts(options, [&]()
+        {
+            for (size_t i = 0;  i < vMessages.size();  i++)
+            {
+                log.addUserMessage("18:58.", vMessages[i].sUserName, vMessages[i].sText, "white", "white");
+            }
+        });
+
+        std::string sCase = "ChatLog, capacity " + std::to_string(vCapacities[c]);
+
+        std::printf("%-32s %12.0f %12zu %10zu %16zu\n", sCase.c_str(), dChatLog, log.getSize(), log.getNameCount(), getChatLogBytes(log) / 1024);
+    }
+
+
+    // History load on a half full chat.
+
+    std::wstring sHistory;
+    std::wstring sDocument;
+
+    for (size_t i = 0;  i < CHAT_LOG_BENCH_HISTORY_LINES;  i++)
+    {
+        sHistory += L"an old message of the room<br>";
+    }
+
+    for (size_t i = 0;  i < vMessages.size() / 2;  i++)
+    {
+        appendOldHTML(sDocument, vMessages[i]);
+    }
+
+    ChatLog log(CHAT_LOG_BENCH_MESSAGE_COUNT);
+
+    for (size_t i = 0;  i < vMessages.size() / 2;  i++)
+    {
+        log.addUserMessage("18:58.", vMessages[i].sUserName, vMessages[i].sText, "white", "white");
+    }
+
+
+    BenchClock::time_point startTime = BenchClock::now();
+
+    // The old slotShowOldText(): the history + the whole document (read twice), then the document is set again.
+    std::wstring sNewText = sHistory;
+    sNewText += sDocument.substr(10); // 10: ".........."
+    sDocument = sNewText;
+
+    double dOldHistory = timeOnce(startTime);
+
+
+    startTime = BenchClock::now();
+
+    for (size_t i = 0;  i < CHAT_LOG_BENCH_HISTORY_LINES;  i++)
+    {
+        log.addOldOutput(L"an old message of the room", "white");
+    }
+
+    double dHistory = timeOnce(startTime);
+
+
+    std::printf("\nHistory load of %d lines with %d messages shown:\n", CHAT_LOG_BENCH_HISTORY_LINES, CHAT_LOG_BENCH_MESSAGE_COUNT / 2);
+    std::printf("%-32s %12s\n", "case", "us");
+    std::printf("%-32s %12.1f\n", "old document rebuild", dOldHistory);
+    std::printf("%-32s %12.1f\n", "ChatLog::addOldOutput()", dHistory);
+}
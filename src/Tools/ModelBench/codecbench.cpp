@@ -0,0 +1,295 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "modelbench.h"
+
+
+// STL
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// Custom
+#include "Model/AudioBackend/fileaudiobackend.h"
+#include "Model/LatencyHistogram/latencyhistogram.h"
+#include "Model/VoiceCipher/voicecipher.h"
+#include "Model/VoiceCodec/voicecodec.h"
+#include "Model/VoiceDatagram/voicedatagram.h"
+
+// External
+#include "AES/AES.h"
+
+
+// The client's voice packet (see AudioService): 679 samples at 19400 Hz, 35 ms.
+#define  CODEC_BENCH_SAMPLE_RATE     19400
+#define  CODEC_BENCH_FRAME_SAMPLES   679
+#define  CODEC_BENCH_FRAME_MS        35
+
+// IPv4 and UDP headers of each voice packet.
+#define  CODEC_BENCH_UDP_OVERHEAD    28
+
+
+struct CodecBenchCase
+{
+    const char*  pName;
+
+    VOICE_CODEC  codec;
+    bool         bAuthenticatedCTR;
+};
+
+
+static const CodecBenchCase vCases[] =
+{
+    { "pcm + ecb",    VC_PCM,        false },
+    { "pcm + ctr",    VC_PCM,        true  },
+    { "adpcm + ecb",  VC_IMA_ADPCM,  false },
+    { "adpcm + ctr",  VC_IMA_ADPCM,  true  },
+};
+
+
+// Captures all frames of the WAV fixture through the FileAudioBackend (without waiting for the clock).
+// Returns true if failed.
+static bool captureFixture(const std::string& sPath, std::vector< std::vector<short int> >& vFramesOut)
+{
+    std::vector<short int> vSamples;
+    std::string sError;
+
+    if ( FileAudioBackend::readWavFile(sPath, CODEC_BENCH_SAMPLE_RATE, vSamples, sError) )
+    {
+        std::printf("%s: %s\n", sPath.c_str(), sError.c_str());
+
+        return true;
+    }
+
+
+    FileAudioBackend backend(sPath, "", 0.0f);
+
+    AudioStreamFormat format;
+    format.iSampleRate   = CODEC_BENCH_SAMPLE_RATE;
+    format.iFrameSamples = CODEC_BENCH_FRAME_SAMPLES;
+
+    AudioCaptureStream* pCapture = backend.openCapture(L"", format, sError);
+
+    if ( (pCapture == nullptr) || pCapture->start() )
+    {
+        std::printf("%s: capture failed: %s\n", sPath.c_str(), pCapture ? pCapture->getLastError().c_str() : sError.c_str());
+
+        delete pCapture;
+
+        return true;
+    }
+
+
+    size_t iFrameCount = (vSamples.size() + CODEC_BENCH_FRAME_SAMPLES - 1) / CODEC_BENCH_FRAME_SAMPLES;
+
+    vFramesOut.assign( (iFrameCount > 0) ? iFrameCount : 1, std::vector<short int>(CODEC_BENCH_FRAME_SAMPLES) );
+
+    bool bFailed = false;
+
+    for (size_t i = 0;  (i < vFramesOut.size()) && (bFailed == false);  i++)
+    {
+        bFailed = pCapture->read(vFramesOut[i].data());
+    }
+
+    if (bFailed)
+    {
+        std::printf("%s: capture failed: %s\n", sPath.c_str(), pCapture->getLastError().c_str());
+    }
+
+    pCapture->stop();
+
+    delete pCapture;
+
+
+    return bFailed;
+}
+
+static unsigned long long getElapsedNS(BenchClock::time_point startTime)
+{
+    return static_cast<unsigned long long>( std::chrono::duration_cast<std::chrono::nanoseconds>(BenchClock::now() - startTime).count() );
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+void runCodecBench(const ModelBenchOptions& options)
+{
+    // Both sides of the voice path: the client's VoiceDatagram::buildClientPacket()
+    // and the server's VoiceDatagram::openClientPacket() + VoiceCodec::decode() with the same session key.
+
+    AES* pAES = new AES(128);
+
+    unsigned char vSessionKey[16];
+
+    for (size_t i = 0;  i < sizeof(vSessionKey);  i++)
+    {
+        vSessionKey[i] = static_cast<unsigned char>(std::rand() % 256);
+    }
+
+    pAES->SetKey(vSessionKey);
+
+
+    VoiceCodec*  pCodec        = new VoiceCodec();
+    VoiceCipher* pSendCipher   = new VoiceCipher(VCD_CLIENT_TO_SERVER);
+    VoiceCipher* pOpenCipher   = new VoiceCipher(VCD_SERVER_TO_CLIENT);
+
+    pSendCipher->deriveKeys(pAES);
+    pOpenCipher->deriveKeys(pAES);
+
+    LatencyHistogram* pSendTimes = new LatencyHistogram();
+    LatencyHistogram* pOpenTimes = new LatencyHistogram();
+
+
+    unsigned char vPacket[VOICE_DATAGRAM_MAX_SIZE];
+    unsigned char vDecrypted[VOICE_DATAGRAM_MAX_SIZE];
+    short int     vDecoded[CODEC_BENCH_FRAME_SAMPLES];
+
+
+    for (size_t iFixture = 0;  iFixture < options.vWavPaths.size();  iFixture++)
+    {
+        std::vector< std::vector<short int> > vFrames;
+
+        if ( captureFixture(options.vWavPaths[iFixture], vFrames) )
+        {
+            continue;
+        }
+
+
+        if (iFixture != 0)
+        {
+            std::printf("\n");
+        }
+
+        std::printf("Voice path, %s: %zu frames of %d samples (%d ms), times in ns per frame:\n",
+                    options.vWavPaths[iFixture].c_str(), vFrames.size(), CODEC_BENCH_FRAME_SAMPLES, CODEC_BENCH_FRAME_MS);
+        std::printf("%-12s %9s %9s %10s %9s %10s %9s %9s\n",
+                    "case", "bytes", "kbit/s", "send", "send p99", "open", "open p99", "SNR dB");
+
+
+        for (size_t iCase = 0;  iCase < sizeof(vCases) / sizeof(vCases[0]);  iCase++)
+        {
+            pCodec->setCodec(vCases[iCase].codec);
+
+            pSendCipher->reset();
+            pOpenCipher->reset();
+            pSendCipher->setEnabled(vCases[iCase].bAuthenticatedCTR);
+            pOpenCipher->setEnabled(vCases[iCase].bAuthenticatedCTR);
+
+            pSendTimes->reset();
+            pOpenTimes->reset();
+
+
+            unsigned long long iPacketCount   = 0;
+            unsigned long long iPacketBytes   = 0;
+            unsigned long long iSendTotalNS   = 0;
+            unsigned long long iOpenTotalNS   = 0;
+            bool               bDamaged       = false;
+
+            double dSignalEnergy = 0.0;
+            double dNoiseEnergy  = 0.0;
+
+            BenchClock::time_point startTime = BenchClock::now();
+            BenchClock::duration   minTime   = std::chrono::duration_cast<BenchClock::duration>( std::chrono::duration<double>(options.dSecondsPerCase) );
+
+            // The whole fixture at least once (for the SNR).
+            while ( (iPacketCount < vFrames.size()) || (BenchClock::now() - startTime < minTime) )
+            {
+                const std::vector<short int>& vFrame = vFrames[iPacketCount % vFrames.size()];
+
+
+                BenchClock::time_point sendTime = BenchClock::now();
+
+                size_t iSize = VoiceDatagram::buildClientPacket(vFrame.data(), CODEC_BENCH_FRAME_SAMPLES, false,
+                                                                pCodec, pSendCipher, pAES, vPacket);
+
+                unsigned long long iSendNS = getElapsedNS(sendTime);
+
+
+                BenchClock::time_point openTime = BenchClock::now();
+
+                VoiceDatagramContent content;
+
+                bool bRejected = VoiceDatagram::openClientPacket(vPacket, iSize, CODEC_BENCH_FRAME_SAMPLES, pOpenCipher, pAES, vDecrypted, content)
+                                 || VoiceCodec::decode(content.codec, content.pPayload, content.iPayloadSize, vDecoded, CODEC_BENCH_FRAME_SAMPLES);
+
+                unsigned long long iOpenNS = getElapsedNS(openTime);
+
+
+                if (bRejected)
+                {
+                    bDamaged = true;
+
+                    break;
+                }
+
+                pSendTimes->record(iSendNS);
+                pOpenTimes->record(iOpenNS);
+
+                iSendTotalNS += iSendNS;
+                iOpenTotalNS += iOpenNS;
+                iPacketBytes += iSize;
+
+                if (iPacketCount < vFrames.size())
+                {
+                    for (size_t i = 0;  i < CODEC_BENCH_FRAME_SAMPLES;  i++)
+                    {
+                        double dError = static_cast<double>(vFrame[i]) - vDecoded[i];
+
+                        dSignalEnergy += static_cast<double>(vFrame[i]) * vFrame[i];
+                        dNoiseEnergy  += dError * dError;
+                    }
+                }
+
+                iPacketCount++;
+            }
+
+
+            if (bDamaged)
+            {
+                std::printf("%-12s the packet was rejected by the receiving side\n", vCases[iCase].pName);
+
+                continue;
+            }
+
+
+            LatencyStats sendStats;
+            LatencyStats openStats;
+            pSendTimes->getStats(&sendStats);
+            pOpenTimes->getStats(&openStats);
+
+            double dBytesPerPacket = static_cast<double>(iPacketBytes) / iPacketCount;
+            double dKbitPerSecond  = (dBytesPerPacket + CODEC_BENCH_UDP_OVERHEAD) * 8 * (1000.0 / CODEC_BENCH_FRAME_MS) / 1000.0;
+
+            char vSNR[32];
+
+            if (dNoiseEnergy == 0.0)
+            {
+                std::snprintf(vSNR, sizeof(vSNR), "lossless");
+            }
+            else
+            {
+                std::snprintf(vSNR, sizeof(vSNR), "%.1f", 10.0 * std::log10( (dSignalEnergy + 1.0) / dNoiseEnergy ));
+            }
+
+            std::printf("%-12s %9.1f %9.1f %10.0f %9llu %10.0f %9llu %9s\n",
+                        vCases[iCase].pName, dBytesPerPacket, dKbitPerSecond,
+                        static_cast<double>(iSendTotalNS) / iPacketCount, sendStats.iP99US,
+                        static_cast<double>(iOpenTotalNS) / iPacketCount, openStats.iP99US, vSNR);
+        }
+    }
+
+
+    delete pOpenTimes;
+    delete pSendTimes;
+    delete pOpenCipher;
+    delete pSendCipher;
+    delete pCodec;
+    delete pAES;
+}
@@ -0,0 +1,251 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "modelbench.h"
+
+
+// STL
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <vector>
+
+// Custom
+#include "Model/AudioDSP/audiodsp.h"
+
+
+// The client's voice packet (see AudioService): 679 samples at 19400 Hz, 35 ms.
+#define  DSP_BENCH_FRAME_SAMPLES   679
+
+// The master volume multiplier of the AudioService (clips the loud samples).
+#define  DSP_BENCH_GAIN            1.45f
+
+// Different frames so the input is not always in the cache line of the last frame.
+#define  DSP_BENCH_FRAME_COUNT     64
+
+
+// Sink for the results of the old loops (so they are not optimized away).
+static volatile double dBenchSink = 0.0;
+
+
+// The loops of the AudioService before AudioDSP.
+
+static void oldGainLoop(short int* pAudio, int iSampleCount, float fInputMult)
+{
+    for (int t = 0;  t < iSampleCount;  t++)
+    {
+        int iNewValue = static_cast <int> (pAudio[t] * fInputMult);
+
+        if      (iNewValue > SHRT_MAX)
+        {
+            pAudio[t] = SHRT_MAX;
+        }
+        else if (iNewValue < SHRT_MIN)
+        {
+            pAudio[t] = SHRT_MIN;
+        }
+        else
+        {
+            pAudio[t] = static_cast <short> (iNewValue);
+        }
+    }
+}
+
+static double oldGainDBFSLoop(short int* pAudio, int iSampleCount, float fMasterVolumeMult)
+{
+    double maxDBFS = -1000.0;
+
+    for (int t = 0;  t < iSampleCount;  t++)
+    {
+        int iNewValue = static_cast <int> (pAudio[t] * fMasterVolumeMult);
+
+        if      (iNewValue > SHRT_MAX)
+        {
+            pAudio[t] = SHRT_MAX;
+        }
+        else if (iNewValue < SHRT_MIN)
+        {
+            pAudio[t] = SHRT_MIN;
+        }
+        else
+        {
+            double sampleInRange = static_cast<double>(iNewValue) / SHRT_MAX;
+
+            double sampleInDBFS = 20 * log10(std::abs(sampleInRange));
+
+            if (sampleInDBFS > maxDBFS)
+            {
+                maxDBFS = sampleInDBFS;
+            }
+        }
+    }
+
+    return maxDBFS;
+}
+
+static void oldMixLoop(int* pMix, const short int* pSamples, int iSampleCount, float fGain)
+{
+    for (int t = 0;  t < iSampleCount;  t++)
+    {
+        pMix[t] += static_cast<int>(pSamples[t] * fGain);
+    }
+}
+
+
+// Returns the nanoseconds per frame of 'frameFunction' (called with the frame index).
+static double timeFrames(const ModelBenchOptions& options, const std::function<void(size_t)>& frameFunction)
+{
+    unsigned long long iFrameCount = 0;
+
+    BenchClock::time_point startTime = BenchClock::now();
+    BenchClock::duration   minTime   = std::chrono::duration_cast<BenchClock::duration>( std::chrono::duration<double>(options.dSecondsPerCase) );
+
+    while (BenchClock::now() - startTime < minTime)
+    {
+        // Check the clock every 256 frames.
+        for (size_t n = 0;  n < 256;  n++)
+        {
+            frameFunction(n % DSP_BENCH_FRAME_COUNT);
+        }
+
+        iFrameCount += 256;
+    }
+
+    return std::chrono::duration<double, std::nano>(BenchClock::now() - startTime).count() / static_cast<double>(iFrameCount);
+}
+
+static void printCase(const char* pCase, const char* pKernel, double dNsPerFrame, double dOldNsPerFrame)
+{
+    std::printf("%-34s %-8s %10.0f %12.2f %10.1f\n", pCase, pKernel, dNsPerFrame,
+                DSP_BENCH_FRAME_SAMPLES / dNsPerFrame, dOldNsPerFrame / dNsPerFrame);
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+void runDSPBench(const ModelBenchOptions& options)
+{
+    // Loud random speech-like frames so the saturation is exercised too.
+
+    std::mt19937 rndGen(40004);
+    std::uniform_int_distribution<int> sampleDistribution(-30000, 30000);
+
+    std::vector< std::vector<short int> > vFrames(DSP_BENCH_FRAME_COUNT, std::vector<short int>(DSP_BENCH_FRAME_SAMPLES));
+
+    for (size_t i = 0;  i < vFrames.size();  i++)
+    {
+        for (size_t k = 0;  k < DSP_BENCH_FRAME_SAMPLES;  k++)
+        {
+            vFrames[i][k] = static_cast<short int>( sampleDistribution(rndGen) );
+        }
+    }
+
+    // The in place cases work on a copy of the frame (the copy is timed in every case, the old loops too).
+    std::vector<short int> vWork(DSP_BENCH_FRAME_SAMPLES);
+    std::vector<int>       vMix(DSP_BENCH_FRAME_SAMPLES);
+
+
+    std::printf("AudioDSP on %d-sample frames, gain x%.2f (the best kernel on this CPU: %s):\n",
+                DSP_BENCH_FRAME_SAMPLES, static_cast<double>(DSP_BENCH_GAIN), AudioDSP::getKernelName( AudioDSP::getBestKernel() ));
+    std::printf("%-34s %-8s %10s %12s %10s\n", "case", "kernel", "ns/frame", "samples/ns", "x old");
+
+
+    // Gain + clip (input volume).
+
+    double dOldGain = timeFrames(options, [&](size_t iFrame)
+    {
+        std::memcpy(vWork.data(), vFrames[iFrame].data(), DSP_BENCH_FRAME_SAMPLES * sizeof(short int));
+
+        oldGainLoop(vWork.data(), DSP_BENCH_FRAME_SAMPLES, DSP_BENCH_GAIN);
+    });
+
+    printCase("old gain, clip loop", "-", dOldGain, dOldGain);
+
+
+    // Gain + clip + peak (the voice start check).
+
+    double dOldGainDBFS = timeFrames(options, [&](size_t iFrame)
+    {
+        std::memcpy(vWork.data(), vFrames[iFrame].data(), DSP_BENCH_FRAME_SAMPLES * sizeof(short int));
+
+        dBenchSink = dBenchSink + oldGainDBFSLoop(vWork.data(), DSP_BENCH_FRAME_SAMPLES, DSP_BENCH_GAIN);
+    });
+
+    printCase("old gain, clip, log10 loop", "-", dOldGainDBFS, dOldGainDBFS);
+
+
+    // Mix + saturate (the mixer, one speaker).
+
+    double dOldMix = timeFrames(options, [&](size_t iFrame)
+    {
+        std::memset(vMix.data(), 0, DSP_BENCH_FRAME_SAMPLES * sizeof(int));
+
+        oldMixLoop(vMix.data(), vFrames[iFrame].data(), DSP_BENCH_FRAME_SAMPLES, DSP_BENCH_GAIN);
+
+        for (size_t i = 0;  i < DSP_BENCH_FRAME_SAMPLES;  i++)
+        {
+            vWork[i] = static_cast<short int>( std::max(SHRT_MIN, std::min(SHRT_MAX, vMix[i])) );
+        }
+    });
+
+    printCase("old mix, saturate loop", "-", dOldMix, dOldMix);
+
+
+    for (size_t k = 0;  k < ADK_COUNT;  k++)
+    {
+        AUDIO_DSP_KERNEL kernel = static_cast<AUDIO_DSP_KERNEL>(k);
+
+        if ( AudioDSP::setKernel(kernel) )
+        {
+            std::printf("%-34s %-8s %10s\n", "(not supported by this CPU)", AudioDSP::getKernelName(kernel), "-");
+
+            continue;
+        }
+
+
+        double dApply = timeFrames(options, [&](size_t iFrame)
+        {
+            std::memcpy(vWork.data(), vFrames[iFrame].data(), DSP_BENCH_FRAME_SAMPLES * sizeof(short int));
+
+            dBenchSink = dBenchSink + AudioDSP::applyGain(vWork.data(), DSP_BENCH_FRAME_SAMPLES, DSP_BENCH_GAIN).iPeak;
+        });
+
+        printCase("applyGain (vs gain, clip)", AudioDSP::getKernelName(kernel), dApply, dOldGain);
+
+
+        double dMeasure = timeFrames(options, [&](size_t iFrame)
+        {
+            std::memcpy(vWork.data(), vFrames[iFrame].data(), DSP_BENCH_FRAME_SAMPLES * sizeof(short int));
+
+            AudioFrameLevel level = AudioDSP::measureWithGain(vWork.data(), DSP_BENCH_FRAME_SAMPLES, DSP_BENCH_GAIN);
+
+            dBenchSink = dBenchSink + AudioDSP::peakToDBFS(level.iPeak);
+        });
+
+        printCase("measureWithGain + dBFS (vs log10)", AudioDSP::getKernelName(kernel), dMeasure, dOldGainDBFS);
+
+
+        double dMix = timeFrames(options, [&](size_t iFrame)
+        {
+            std::memset(vMix.data(), 0, DSP_BENCH_FRAME_SAMPLES * sizeof(int));
+
+            AudioDSP::mixWithGain (vMix.data(), vFrames[iFrame].data(), DSP_BENCH_FRAME_SAMPLES, DSP_BENCH_GAIN);
+            AudioDSP::saturate    (vMix.data(), vWork.data(), DSP_BENCH_FRAME_SAMPLES);
+        });
+
+        printCase("mixWithGain + saturate", AudioDSP::getKernelName(kernel), dMix, dOldMix);
+    }
+
+
+    AudioDSP::setKernel( AudioDSP::getBestKernel() );
+}
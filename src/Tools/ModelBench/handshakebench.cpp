@@ -0,0 +1,127 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "modelbench.h"
+
+
+// STL
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+// External
+#include "integer/integer.h"
+
+
+// Handshakes prepared before the timing (random p, g, A and b like the server and the client make them).
+#define  HANDSHAKE_BENCH_KEYS   64
+
+
+struct HandshakeBenchKeys
+{
+    uint64_t     p;
+    uint64_t     g;
+    uint64_t     b;
+
+    // Open key A as the server sends it (decimal).
+    std::string  sOpenKeyA;
+};
+
+
+// Sink for the keys (so the handshakes are not optimized away).
+static volatile size_t iBenchSink = 0;
+
+
+// The old NetworkService::establishSecureConnection(): the whole g^b and A^b are built, then reduced.
+static void oldHandshake(const HandshakeBenchKeys& keys)
+{
+    integer B = pow(integer(keys.g), keys.b) % keys.p;
+
+    integer A(keys.sOpenKeyA, 10);
+
+    integer secret = pow(integer(A), keys.b) % keys.p;
+
+    iBenchSink = iBenchSink + B.str().size() + secret.str().size();
+}
+
+// The handshake now: powmod() on 64-bit words, A is parsed as the big integer (it may be longer than 64 bits).
+static void newHandshake(const HandshakeBenchKeys& keys)
+{
+    std::string sOpenKeyB = std::to_string( powmod(keys.g, keys.b, keys.p) );
+
+    uint64_t iOpenKeyA = static_cast<uint64_t>( integer(keys.sOpenKeyA, 10) % keys.p );
+
+    std::string sSecret = std::to_string( powmod(iOpenKeyA, keys.b, keys.p) );
+
+    iBenchSink = iBenchSink + sOpenKeyB.size() + sSecret.size();
+}
+
+// Returns the microseconds per handshake.
+static double timeHandshakes(const ModelBenchOptions& options, const std::vector<HandshakeBenchKeys>& vKeys,
+                             const std::function<void(const HandshakeBenchKeys&)>& handshake)
+{
+    unsigned long long iHandshakeCount = 0;
+
+    BenchClock::time_point startTime = BenchClock::now();
+    BenchClock::duration   minTime   = std::chrono::duration_cast<BenchClock::duration>( std::chrono::duration<double>(options.dSecondsPerCase) );
+
+    do
+    {
+        handshake( vKeys[iHandshakeCount % vKeys.size()] );
+
+        iHandshakeCount++;
+    }
+    while (BenchClock::now() - startTime < minTime);
+
+    return std::chrono::duration<double, std::micro>(BenchClock::now() - startTime).count() / static_cast<double>(iHandshakeCount);
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+void runHandshakeBench(const ModelBenchOptions& options)
+{
+    // b as the client makes it in the debug (50 - 100) and the release (500 - 1000) builds.
+
+    const uint64_t vMinExponents[] = { 50,  500 };
+    const uint64_t vMaxExponents[] = { 100, 1000 };
+
+
+    std::printf("Diffie-Hellman handshake of the client (CPU time of the key math, random 31-bit p and g):\n");
+    std::printf("%-12s %16s %16s %10s\n", "b", "old us", "powmod us", "speedup");
+
+
+    for (size_t e = 0;  e < sizeof(vMinExponents) / sizeof(vMinExponents[0]);  e++)
+    {
+        std::mt19937 rndGen(9009);
+        std::uniform_int_distribution<uint64_t> valueDistribution(2, 0x7fffffff);
+        std::uniform_int_distribution<uint64_t> exponentDistribution(vMinExponents[e], vMaxExponents[e]);
+
+        std::vector<HandshakeBenchKeys> vKeys(HANDSHAKE_BENCH_KEYS);
+
+        for (size_t i = 0;  i < vKeys.size();  i++)
+        {
+            vKeys[i].p         = valueDistribution(rndGen);
+            vKeys[i].g         = valueDistribution(rndGen);
+            vKeys[i].b         = exponentDistribution(rndGen);
+            vKeys[i].sOpenKeyA = std::to_string( powmod(vKeys[i].g, exponentDistribution(rndGen), vKeys[i].p) );
+        }
+
+
+        double dOld = timeHandshakes(options, vKeys, oldHandshake);
+        double dNew = timeHandshakes(options, vKeys, newHandshake);
+
+        std::string sCase = std::to_string(vMinExponents[e]) + " - " + std::to_string(vMaxExponents[e]);
+
+        std::printf("%-12s %16.1f %16.2f %10.0f\n", sCase.c_str(), dOld, dNew, dOld / dNew);
+    }
+}
@@ -0,0 +1,113 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "modelbench.h"
+
+
+// STL
+#include <cstdio>
+#include <random>
+#include <string>
+
+// External
+#include "integer/integer.h"
+
+
+#define  INTEGER_BENCH_MIN_BITS      64
+#define  INTEGER_BENCH_MAX_BITS      4096
+
+// The exponent of pow() (the DH handshake uses 64-bit values).
+#define  INTEGER_BENCH_POW_EXPONENT  0xd3c1f5a9e8b72461ULL
+
+
+// Random 'iBits'-bit value (the top bit is set).
+static integer makeOperand(std::mt19937& rndGen, size_t iBits)
+{
+    static const char* pHexDigits = "0123456789abcdef";
+
+    std::string sHex;
+
+    for (size_t i = 0;  i < iBits / 4;  i++)
+    {
+        sHex += pHexDigits[ rndGen() % 16 ];
+    }
+
+    sHex[0] = pHexDigits[ 8 + rndGen() % 8 ];
+
+
+    return integer(sHex, 16);
+}
+
+// Runs 'operation' (returns something to keep) until the time of one case passed.
+// Returns the nanoseconds per operation.
+template <typename Operation>
+static double measure(const ModelBenchOptions& options, const Operation& operation, size_t& iKeepOut)
+{
+    unsigned long long iCount = 0;
+
+    BenchClock::time_point startTime = BenchClock::now();
+    BenchClock::duration   minTime   = std::chrono::duration_cast<BenchClock::duration>( std::chrono::duration<double>(options.dSecondsPerCase) );
+
+    do
+    {
+        iKeepOut += operation();
+
+        iCount++;
+
+    } while (BenchClock::now() - startTime < minTime);
+
+
+    return std::chrono::duration<double, std::nano>(BenchClock::now() - startTime).count() / static_cast<double>(iCount);
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+void runIntegerBench(const ModelBenchOptions& options)
+{
+    std::mt19937 rndGen(51337);
+
+    // So that the results are used.
+    size_t iKeep = 0;
+
+
+    std::printf("integer (%zu-bit digits), ns per operation:\n", sizeof(INTEGER_DIGIT_T) * 8);
+    std::printf("%6s %12s %12s %14s %12s %12s\n", "bits", "a * b", "2n / n", "pow(a, e, m)", "str(10)", "parse(10)");
+
+
+    for (size_t iBits = INTEGER_BENCH_MIN_BITS;  iBits <= INTEGER_BENCH_MAX_BITS;  iBits *= 2)
+    {
+        const integer a       = makeOperand(rndGen, iBits);
+        const integer b       = makeOperand(rndGen, iBits);
+        const integer product = a * b;
+        const integer modulus = makeOperand(rndGen, iBits) | 1;
+
+        const std::string sDecimal = a.str(10);
+
+
+        double dMultiplyNS = measure(options, [&]() { return (a * b).digits(); }, iKeep);
+
+        double dDivModNS   = measure(options, [&]() { return (product / b).digits() + (product % b).digits(); }, iKeep) / 2.0;
+
+        double dPowNS      = measure(options, [&]() { return pow(a, INTEGER_BENCH_POW_EXPONENT, modulus).digits(); }, iKeep);
+
+        double dStrNS      = measure(options, [&]() { return a.str(10).size(); }, iKeep);
+
+        double dParseNS    = measure(options, [&]() { return integer(sDecimal, 10).digits(); }, iKeep);
+
+
+        std::printf("%6zu %12.0f %12.0f %14.0f %12.0f %12.0f\n", iBits, dMultiplyNS, dDivModNS, dPowNS, dStrNS, dParseNS);
+    }
+
+
+    if (iKeep == 0)
+    {
+        std::printf("(no results)\n");
+    }
+}
@@ -0,0 +1,159 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+
+// STL
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Custom
+#include "Tools/ModelBench/modelbench.h"
+
+
+struct ModelBench
+{
+    const char*  pName;
+    const char*  pDescription;
+
+    void       (*pRun)(const ModelBenchOptions& options);
+};
+
+
+static const ModelBench vBenches[] =
+{
+    { "mixer",     "AudioMixer: output frames per second with 1 - 64 speakers",             runMixerBench },
+    { "codec",     "voice codecs and ciphers: bandwidth, CPU time per frame, SNR",          runCodecBench },
+    { "chatlog",   "ChatLog: 100k messages inserted, memory kept, history load",            runChatLogBench },
+    { "dsp",       "AudioDSP: SIMD gain, level and mix kernels against the old loops",      runDSPBench },
+    { "handshake", "Diffie-Hellman key math of the client: old pow() % p against powmod()", runHandshakeBench },
+    { "integer",   "ext/integer: multiply, divide, pow, str / parse of 64 - 4096 bits",     runIntegerBench },
+    { "users",     "UserDirectory: lookup per voice packet, 1 - 1000 users",                runUserDirectoryBench },
+    { "vad",       "voice activation: speech missed, noise sent, time per frame",           runVADBench },
+};
+
+
+static void printUsage()
+{
+    std::printf(
+        "Benchmarks of the Silent model parts that don't need the sockets or the audio devices.\n"
+        "\n"
+        "Usage: SilentModelBench [options] [benchmark...]\n"
+        "\n"
+        "  --seconds S         each case runs at least S seconds (0.5)\n"
+        "  --wav PATH          WAV fixture for the codec benchmark, can be repeated\n"
+        "                      (res/sounds/connect.wav, res/sounds/newmessage.wav, res/sounds/servermessage.wav)\n"
+        "\n"
+        "Benchmarks (all if none are given):\n");
+
+    for (size_t i = 0;  i < sizeof(vBenches) / sizeof(vBenches[0]);  i++)
+    {
+        std::printf("  %-19s %s\n", vBenches[i].pName, vBenches[i].pDescription);
+    }
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+int main(int argc, char* argv[])
+{
+    ModelBenchOptions options;
+    options.dSecondsPerCase = 0.5;
+
+    std::vector<const ModelBench*> vToRun;
+
+
+    for (int i = 1;  i < argc;  i++)
+    {
+        std::string sOption = argv[i];
+
+        if ( (sOption == "--help") || (sOption == "-h") )
+        {
+            printUsage();
+
+            return 0;
+        }
+        else if ( (sOption == "--seconds") || (sOption == "--wav") )
+        {
+            if (i + 1 >= argc)
+            {
+                std::printf("Option %s needs a value.\n", argv[i]);
+
+                return 2;
+            }
+
+            i++;
+
+            if (sOption == "--seconds")
+            {
+                options.dSecondsPerCase = std::atof(argv[i]);
+            }
+            else
+            {
+                options.vWavPaths.push_back(argv[i]);
+            }
+
+            continue;
+        }
+
+
+        const ModelBench* pBench = nullptr;
+
+        for (size_t k = 0;  k < sizeof(vBenches) / sizeof(vBenches[0]);  k++)
+        {
+            if (sOption == vBenches[k].pName)
+            {
+                pBench = &vBenches[k];
+            }
+        }
+
+        if (pBench == nullptr)
+        {
+            std::printf("Unknown benchmark: %s\n\n", sOption.c_str());
+
+            printUsage();
+
+            return 2;
+        }
+
+        vToRun.push_back(pBench);
+    }
+
+
+    if (options.vWavPaths.empty())
+    {
+        options.vWavPaths.push_back("res/sounds/connect.wav");
+        options.vWavPaths.push_back("res/sounds/newmessage.wav");
+        options.vWavPaths.push_back("res/sounds/servermessage.wav");
+    }
+
+    if (vToRun.empty())
+    {
+        for (size_t i = 0;  i < sizeof(vBenches) / sizeof(vBenches[0]);  i++)
+        {
+            vToRun.push_back(&vBenches[i]);
+        }
+    }
+
+
+    for (size_t i = 0;  i < vToRun.size();  i++)
+    {
+        if (i != 0)
+        {
+            std::printf("\n");
+        }
+
+        vToRun[i]->pRun(options);
+    }
+
+
+    return 0;
+}
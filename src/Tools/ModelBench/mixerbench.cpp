@@ -0,0 +1,96 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "modelbench.h"
+
+
+// STL
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Custom
+#include "Model/AudioDSP/audiodsp.h"
+#include "Model/AudioMixer/audiomixer.h"
+
+
+// The client's voice packet (see AudioService): 679 samples at 19400 Hz, 35 ms.
+#define  MIXER_BENCH_FRAME_SAMPLES   679
+#define  MIXER_BENCH_FRAME_US        35000
+
+#define  MIXER_BENCH_MAX_STREAMS     64
+
+// Gain of a speaker (the master volume multiplier of the AudioService).
+#define  MIXER_BENCH_GAIN            1.45f
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+void runMixerBench(const ModelBenchOptions& options)
+{
+    // Loud random speech-like frames so the saturation is exercised too.
+
+    std::mt19937 rndGen(51337);
+    std::uniform_int_distribution<int> sampleDistribution(-12000, 12000);
+
+    std::vector< std::vector<short int> > vFrames(MIXER_BENCH_MAX_STREAMS, std::vector<short int>(MIXER_BENCH_FRAME_SAMPLES));
+
+    for (size_t i = 0;  i < vFrames.size();  i++)
+    {
+        for (size_t k = 0;  k < MIXER_BENCH_FRAME_SAMPLES;  k++)
+        {
+            vFrames[i][k] = static_cast<short int>( sampleDistribution(rndGen) );
+        }
+    }
+
+
+    AudioMixer mixer(MIXER_BENCH_FRAME_SAMPLES);
+
+    std::vector<short int> vOutFrame(MIXER_BENCH_FRAME_SAMPLES);
+
+
+    std::printf("AudioMixer (%s), frames of %d samples:\n", AudioDSP::getKernelName(), MIXER_BENCH_FRAME_SAMPLES);
+    std::printf("%8s %14s %12s %16s\n", "streams", "frames/s", "ns/frame", "realtime x");
+
+
+    for (size_t iStreams = 1;  iStreams <= MIXER_BENCH_MAX_STREAMS;  iStreams *= 2)
+    {
+        unsigned long long iFrameCount = 0;
+
+        BenchClock::time_point startTime = BenchClock::now();
+        BenchClock::duration   minTime   = std::chrono::duration_cast<BenchClock::duration>( std::chrono::duration<double>(options.dSecondsPerCase) );
+
+        while (BenchClock::now() - startTime < minTime)
+        {
+            // Check the clock every 256 frames.
+            for (size_t n = 0;  n < 256;  n++)
+            {
+                mixer.beginFrame();
+
+                for (size_t i = 0;  i < iStreams;  i++)
+                {
+                    mixer.addFrame(vFrames[i].data(), MIXER_BENCH_GAIN);
+                }
+
+                mixer.finishFrame(vOutFrame.data());
+            }
+
+            iFrameCount += 256;
+        }
+
+        double dSeconds       = std::chrono::duration<double>(BenchClock::now() - startTime).count();
+        double dFramesPerSec  = static_cast<double>(iFrameCount) / dSeconds;
+        double dNsPerFrame    = dSeconds * 1e9 / static_cast<double>(iFrameCount);
+
+        // How many times faster than the frames are played.
+        double dRealTime      = MIXER_BENCH_FRAME_US * 1000.0 / dNsPerFrame;
+
+        std::printf("%8zu %14.0f %12.0f %16.0f\n", iStreams, dFramesPerSec, dNsPerFrame, dRealTime);
+    }
+}
@@ -0,0 +1,64 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <chrono>
+#include <string>
+#include <vector>
+
+
+typedef std::chrono::steady_clock  BenchClock;
+
+
+struct ModelBenchOptions
+{
+    // Each case runs at least this long.
+    double  dSecondsPerCase;
+
+    // WAV fixtures (the speech-like input).
+    std::vector<std::string>  vWavPaths;
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Benchmarks of the portable model parts (no sockets, no audio devices), one function per benchmark.
+// Each prints a table (one line per case) to stdout.
+
+// AudioMixer: output frames per second with 1 - 64 speakers.
+void runMixerBench(const ModelBenchOptions& options);
+
+// VoiceCodec + VoiceCipher (VoiceDatagram both ways) for each fixture captured by the FileAudioBackend:
+// bytes per packet and bandwidth, send / open time per frame (mean and p99) and the SNR of the decoded audio.
+void runCodecBench(const ModelBenchOptions& options);
+
+// ChatLog: time per message of 100k user messages at the default capacity and with all kept, names and memory kept,
+// a history load; against the HTML document of the old MainWindow (without the Qt layout).
+void runChatLogBench(const ModelBenchOptions& options);
+
+// AudioDSP: applyGain(), measureWithGain() and mixWithGain() + saturate() of every kernel this CPU supports
+// against the old AudioService / AudioMixer loops on 679-sample frames, ns per frame.
+void runDSPBench(const ModelBenchOptions& options);
+
+// The key math of the client's Diffie-Hellman handshake (open key B, the secret): the old whole pow() reduced at the end
+// against powmod() on 64-bit words, microseconds per handshake for the debug and the release exponents.
+void runHandshakeBench(const ModelBenchOptions& options);
+
+// ext/integer: multiply, divide, modular pow() and decimal str() / parse of 64 - 4096-bit values.
+void runIntegerBench(const ModelBenchOptions& options);
+
+// UserDirectory: time per lookup by name and by speaker id against the old linear scan of the names, 1 - 1000 users.
+void runUserDirectoryBench(const ModelBenchOptions& options);
+
+// Voice activation on the synthetic fixtures (see VoiceFixtures): speech missed and noise sent
+// by the old peak rule and by VoiceActivityDetector without and with the noise gating, time per frame.
+void runVADBench(const ModelBenchOptions& options);
@@ -0,0 +1,122 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "modelbench.h"
+
+
+// STL
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+// Custom
+#include "Model/User.h"
+#include "Model/UserDirectory/userdirectory.h"
+
+
+// Lookups of random existing users prepared before the timing (so the random generator is not timed).
+#define  USER_DIRECTORY_BENCH_LOOKUPS   4096
+
+
+// Sink for the found users (so the lookups are not optimized away).
+static User* volatile pBenchSink = nullptr;
+
+
+// The old lookup: NetworkService::vOtherUsers scanned with std::string compares.
+static User* findLinear(const std::vector<User*>& vUsers, const std::string& sUserName)
+{
+    for (size_t i = 0;  i < vUsers.size();  i++)
+    {
+        if (vUsers[i]->sUserName == sUserName)
+        {
+            return vUsers[i];
+        }
+    }
+
+    return nullptr;
+}
+
+// Returns the nanoseconds per lookup of 'lookup' (called with the index of the prepared lookup).
+static double timeLookups(const ModelBenchOptions& options, const std::function<User*(size_t)>& lookup)
+{
+    unsigned long long iLookupCount = 0;
+
+    BenchClock::time_point startTime = BenchClock::now();
+    BenchClock::duration   minTime   = std::chrono::duration_cast<BenchClock::duration>( std::chrono::duration<double>(options.dSecondsPerCase) );
+
+    while (BenchClock::now() - startTime < minTime)
+    {
+        for (size_t i = 0;  i < USER_DIRECTORY_BENCH_LOOKUPS;  i++)
+        {
+            pBenchSink = lookup(i);
+        }
+
+        iLookupCount += USER_DIRECTORY_BENCH_LOOKUPS;
+    }
+
+    return std::chrono::duration<double, std::nano>(BenchClock::now() - startTime).count() / static_cast<double>(iLookupCount);
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+void runUserDirectoryBench(const ModelBenchOptions& options)
+{
+    const size_t vUserCounts[] = { 1, 10, 50, 100, 250, 500, 1000 };
+
+
+    std::printf("User lookup per voice packet (random existing users, names like on a server):\n");
+    std::printf("%8s %16s %16s %18s\n", "users", "linear ns", "by name ns", "by speaker id ns");
+
+
+    for (size_t c = 0;  c < sizeof(vUserCounts) / sizeof(vUserCounts[0]);  c++)
+    {
+        std::deque<User>   vOwned;
+        std::vector<User*> vLinear;
+
+        UserDirectory directory;
+
+        for (size_t i = 0;  i < vUserCounts[c];  i++)
+        {
+            // Names of the same length with a common prefix: the string compares of the scan are not cut short.
+            std::string sName = std::to_string(100000 + i);
+
+            vOwned.emplace_back("player_" + sName, 0, nullptr);
+
+            vLinear.push_back(&vOwned.back());
+            directory.add(&vOwned.back());
+            directory.setSpeakerId(&vOwned.back(), static_cast<unsigned short>(i));
+        }
+
+
+        std::mt19937 rndGen(13013);
+        std::uniform_int_distribution<size_t> userDistribution(0, vUserCounts[c] - 1);
+
+        std::vector<std::string>    vNames(USER_DIRECTORY_BENCH_LOOKUPS);
+        std::vector<unsigned short> vIds  (USER_DIRECTORY_BENCH_LOOKUPS);
+
+        for (size_t i = 0;  i < USER_DIRECTORY_BENCH_LOOKUPS;  i++)
+        {
+            size_t iUser = userDistribution(rndGen);
+
+            vNames[i] = vLinear[iUser]->sUserName;
+            vIds[i]   = static_cast<unsigned short>(iUser);
+        }
+
+
+        double dLinear = timeLookups(options, [&](size_t i) { return findLinear(vLinear, vNames[i]); });
+        double dByName = timeLookups(options, [&](size_t i) { return directory.find(vNames[i]); });
+        double dById   = timeLookups(options, [&](size_t i) { return directory.findBySpeakerId(vIds[i]); });
+
+        std::printf("%8zu %16.1f %16.1f %18.1f\n", vUserCounts[c], dLinear, dByName, dById);
+    }
+}
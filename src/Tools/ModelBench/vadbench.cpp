@@ -0,0 +1,75 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "modelbench.h"
+
+
+// STL
+#include <cstdio>
+
+// Custom
+#include "Tools/VoiceFixtures/voicefixtures.h"
+
+
+// Length and seeds of the synthetic fixtures.
+#define  VAD_BENCH_FIXTURE_SECONDS   60
+#define  VAD_BENCH_FIRST_SEED        100
+#define  VAD_BENCH_SEED_COUNT        3
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+void runVADBench(const ModelBenchOptions& options)
+{
+    (void)options;
+
+    std::printf("Voice activation at %d dBFS on %d s synthetic fixtures (%d ms frames):\n"
+                "  old   - the peak rule with 4 packets after each loud one (before VoiceActivityDetector),\n"
+                "  peak  - VoiceActivityDetector (default),\n"
+                "  gated - VoiceActivityDetector with the noise gating.\n",
+                VOICE_FIXTURE_START_DBFS, VAD_BENCH_FIXTURE_SECONDS, VOICE_FIXTURE_FRAME_MS);
+    std::printf("%-16s %5s | %7s %7s %7s %7s | %7s %7s %7s %7s\n",
+                "background", "seed", "speech", "old", "peak", "gated", "noise", "old", "peak", "gated");
+    std::printf("%-16s %5s | %7s %23s | %7s %23s\n",
+                "", "", "frames", "missed %", "frames", "sent %");
+
+
+    double dOldNS   = 0.0;
+    double dPeakNS  = 0.0;
+    double dGatedNS = 0.0;
+    size_t iRuns    = 0;
+
+    for (int iNoise = 0;  iNoise < VFN_COUNT;  iNoise++)
+    {
+        for (unsigned int iSeed = VAD_BENCH_FIRST_SEED;  iSeed < VAD_BENCH_FIRST_SEED + VAD_BENCH_SEED_COUNT;  iSeed++)
+        {
+            VOICE_FIXTURE_NOISE noise = static_cast<VOICE_FIXTURE_NOISE>(iNoise);
+
+            VoiceFixture fixture = makeVoiceFixture(noise, iSeed + iNoise, VAD_BENCH_FIXTURE_SECONDS);
+
+            VoiceDetectionScore oldScore   = scoreOldVoiceActivation    (fixture, VOICE_FIXTURE_START_DBFS);
+            VoiceDetectionScore peakScore  = scoreVoiceActivityDetector (fixture, VOICE_FIXTURE_START_DBFS, false);
+            VoiceDetectionScore gatedScore = scoreVoiceActivityDetector (fixture, VOICE_FIXTURE_START_DBFS, true);
+
+            std::printf("%-16s %5u | %7zu %7.1f %7.1f %7.1f | %7zu %7.1f %7.1f %7.1f\n",
+                        getVoiceFixtureName(noise), iSeed + iNoise,
+                        oldScore.iSpeechFrames,
+                        getMissedSpeechPercent(oldScore), getMissedSpeechPercent(peakScore), getMissedSpeechPercent(gatedScore),
+                        oldScore.iNoiseFrames,
+                        getSentNoisePercent(oldScore), getSentNoisePercent(peakScore), getSentNoisePercent(gatedScore));
+
+            dOldNS   += oldScore.dNanosecondsPerFrame;
+            dPeakNS  += peakScore.dNanosecondsPerFrame;
+            dGatedNS += gatedScore.dNanosecondsPerFrame;
+            iRuns++;
+        }
+    }
+
+    std::printf("ns per frame: old %.0f, peak %.0f, gated %.0f\n", dOldNS / iRuns, dPeakNS / iRuns, dGatedNS / iRuns);
+}
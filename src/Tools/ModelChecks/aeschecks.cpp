@@ -0,0 +1,270 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "modelchecks.h"
+
+
+// STL
+#include <cstdlib>
+#include <vector>
+
+// Custom
+#include "AES/AES.h"
+
+
+struct AESKnownAnswer
+{
+    int          iKeyBits;
+
+    const char*  pKeyHex;
+    const char*  pPlainHex;
+
+    // Nulls padded plaintext encrypted in ECB mode.
+    const char*  pCipherHex;
+};
+
+
+// Made by the AES class of the first Silent version (before the SetKey() and the backends),
+// the first three are the FIPS-197 C.1 - C.3 examples, the rest also have the padded last block.
+static const AESKnownAnswer vKnownAnswers[] =
+{
+    {
+        128,
+        "000102030405060708090a0b0c0d0e0f",
+        "00112233445566778899aabbccddeeff",
+        "69c4e0d86a7b0430d8cdb78070b4c55a"
+    },
+    {
+        192,
+        "000102030405060708090a0b0c0d0e0f1011121314151617",
+        "00112233445566778899aabbccddeeff",
+        "dda97ca4864cdfe06eaf70a0ec0d7191"
+    },
+    {
+        256,
+        "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f",
+        "00112233445566778899aabbccddeeff",
+        "8ea2b7ca516745bfeafc49904b496089"
+    },
+    {
+        128,
+        "8394a5b6c7d8e9fa0b1c2d3e4f607182",
+        "0726456483a2c1e0ff1e3d5c7b9ab9d8",
+        "9f0b054977439c6af539d73cba9d2c75"
+    },
+    {
+        128,
+        "8394a5b6c7d8e9fa0b1c2d3e4f607182",
+        "0726456483a2c1e0ff1e3d5c7b9ab9d8f71635547392b1d0ef0e2d4c6b8aa9c8"
+        "e7",
+        "9f0b054977439c6af539d73cba9d2c756fcf25a4a3ae6355f17d44164959940c"
+        "5604b564040e060b01af5579713374c0"
+    },
+    {
+        128,
+        "8394a5b6c7d8e9fa0b1c2d3e4f607182",
+        "0726456483a2c1e0ff1e3d5c7b9ab9d8f71635547392b1d0ef0e2d4c6b8aa9c8"
+        "e70625446382a1c0dffe1d3c5b7a99b8d7f61534537291b0cfee0d2c4b6a89a8"
+        "c7e60524436281a0bfdefd1c3b5a7998b7d6f51433527190afceed0c2b4a6988"
+        "a7c6e504",
+        "9f0b054977439c6af539d73cba9d2c756fcf25a4a3ae6355f17d44164959940c"
+        "df2e562c94c422c85daa7ea9fded3b814b82ba96c66cfa82feb0a0cfbbfae122"
+        "59f1ed41e6bd70a7f1bbe92cbb5a7c9e04cd41709d61dcd3ca85b3529a141ac6"
+        "26fdf0f7c253bc573b5b7f8a294c06fb"
+    },
+    {
+        192,
+        "c3d4e5f60718293a4b5c6d7e8fa0b1c2d3e4f5061728394a",
+        "0726456483a2c1e0ff1e3d5c7b9ab9d8",
+        "b54779df9ab23d3a1bb178b67aa13ad8"
+    },
+    {
+        192,
+        "c3d4e5f60718293a4b5c6d7e8fa0b1c2d3e4f5061728394a",
+        "0726456483a2c1e0ff1e3d5c7b9ab9d8f71635547392b1d0ef0e2d4c6b8aa9c8"
+        "e7",
+        "b54779df9ab23d3a1bb178b67aa13ad805172826e021e204433e990b4e21ebcb"
+        "719aa00434e3e761a1e96c45c2bcae7d"
+    },
+    {
+        192,
+        "c3d4e5f60718293a4b5c6d7e8fa0b1c2d3e4f5061728394a",
+        "0726456483a2c1e0ff1e3d5c7b9ab9d8f71635547392b1d0ef0e2d4c6b8aa9c8"
+        "e70625446382a1c0dffe1d3c5b7a99b8d7f61534537291b0cfee0d2c4b6a89a8"
+        "c7e60524436281a0bfdefd1c3b5a7998b7d6f51433527190afceed0c2b4a6988"
+        "a7c6e504",
+        "b54779df9ab23d3a1bb178b67aa13ad805172826e021e204433e990b4e21ebcb"
+        "add526a3b899ca2e0413c25dd3672b8dabd17a80dbb861c40edd576eed63d85c"
+        "4a3939518fb5e922b41025bb6122c29c34d300300aa5ec51fd6484f16b67e6a4"
+        "553eb64c51644c2894cfc7f623ac722e"
+    },
+    {
+        256,
+        "031425364758697a8b9cadbecfe0f102132435465768798a9bacbdcedff00112",
+        "0726456483a2c1e0ff1e3d5c7b9ab9d8",
+        "f61e836dab38374d10954990637f0d2a"
+    },
+    {
+        256,
+        "031425364758697a8b9cadbecfe0f102132435465768798a9bacbdcedff00112",
+        "0726456483a2c1e0ff1e3d5c7b9ab9d8f71635547392b1d0ef0e2d4c6b8aa9c8"
+        "e7",
+        "f61e836dab38374d10954990637f0d2a82e55d4ab9c3ca695f5a9e5e6930ad4f"
+        "116a1f4da6eec220f8d031eece5aa9de"
+    },
+    {
+        256,
+        "031425364758697a8b9cadbecfe0f102132435465768798a9bacbdcedff00112",
+        "0726456483a2c1e0ff1e3d5c7b9ab9d8f71635547392b1d0ef0e2d4c6b8aa9c8"
+        "e70625446382a1c0dffe1d3c5b7a99b8d7f61534537291b0cfee0d2c4b6a89a8"
+        "c7e60524436281a0bfdefd1c3b5a7998b7d6f51433527190afceed0c2b4a6988"
+        "a7c6e504",
+        "f61e836dab38374d10954990637f0d2a82e55d4ab9c3ca695f5a9e5e6930ad4f"
+        "40c34526b3c55478e0e0c6453f2f0a1be9bdbb437f2634aa3fccfe8533f69fcd"
+        "455643509d3435541b619cd6a2a503af5691f42eedbf45e3432c8cc5d0241a79"
+        "1c20fea8b36360111c7ce22767f3f559"
+    },
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+static std::vector<unsigned char> fromHex(const char* pHex)
+{
+    std::vector<unsigned char> vBytes;
+
+    for (size_t i = 0;  (pHex[i] != 0) && (pHex[i + 1] != 0);  i += 2)
+    {
+        char vByte[3] = { pHex[i], pHex[i + 1], 0 };
+
+        vBytes.push_back( static_cast<unsigned char>( std::strtoul(vByte, nullptr, 16) ) );
+    }
+
+    return vBytes;
+}
+
+static void checkKnownAnswer(ModelCheckReport& report, AESBackend backend, const AESKnownAnswer& answer)
+{
+    std::vector<unsigned char> vKey    = fromHex(answer.pKeyHex);
+    std::vector<unsigned char> vPlain  = fromHex(answer.pPlainHex);
+    std::vector<unsigned char> vCipher = fromHex(answer.pCipherHex);
+
+    // Decryption returns the padding too.
+    std::vector<unsigned char> vPadded = vPlain;
+    vPadded.resize(vCipher.size(), 0);
+
+    unsigned int iPlainSize  = static_cast<unsigned int>(vPlain.size());
+    unsigned int iCipherSize = static_cast<unsigned int>(vCipher.size());
+
+    std::string sCase = std::string(AESGetBackendName(backend)) + ", " + std::to_string(answer.iKeyBits) + " bit key, "
+                        + std::to_string(iPlainSize) + " bytes: ";
+
+
+    AES aes(answer.iKeyBits);
+
+    if ( report.check(aes.SetBackend(backend) == false, sCase + "SetBackend()") )
+    {
+        return;
+    }
+
+    std::vector<unsigned char> vOut(iCipherSize + AES_BLOCK_SIZE);
+
+
+
+    // Key per call.
+
+    unsigned int iOutSize = 0;
+
+    unsigned char* pOut = aes.EncryptECB(vPlain.data(), iPlainSize, vKey.data(), iOutSize);
+
+    if ( report.check(iOutSize == iCipherSize, sCase + "EncryptECB() size") == false )
+    {
+        report.checkBytes(vCipher.data(), pOut, iCipherSize, sCase + "EncryptECB()");
+    }
+
+    delete[] pOut;
+
+
+    iOutSize = aes.EncryptECB(vPlain.data(), iPlainSize, vKey.data(), vOut.data());
+
+    if ( report.check(iOutSize == iCipherSize, sCase + "EncryptECB(out) size") == false )
+    {
+        report.checkBytes(vCipher.data(), vOut.data(), iCipherSize, sCase + "EncryptECB(out)");
+    }
+
+
+    pOut = aes.DecryptECB(vCipher.data(), iCipherSize, vKey.data());
+
+    report.checkBytes(vPadded.data(), pOut, iCipherSize, sCase + "DecryptECB()");
+
+    delete[] pOut;
+
+
+    aes.DecryptECB(vCipher.data(), iCipherSize, vKey.data(), vOut.data());
+
+    report.checkBytes(vPadded.data(), vOut.data(), iCipherSize, sCase + "DecryptECB(out)");
+
+
+
+    // Expanded once (the session key of the NetworkService).
+
+    aes.SetKey(vKey.data());
+
+    for (int iPass = 0;  iPass < 2;  iPass++)
+    {
+        std::string sPass = (iPass == 0) ? "" : " (after a call with another key)";
+
+        iOutSize = aes.EncryptECBWithSetKey(vPlain.data(), iPlainSize, vOut.data());
+
+        if ( report.check(iOutSize == iCipherSize, sCase + "EncryptECBWithSetKey() size" + sPass) == false )
+        {
+            report.checkBytes(vCipher.data(), vOut.data(), iCipherSize, sCase + "EncryptECBWithSetKey()" + sPass);
+        }
+
+
+        aes.DecryptECBWithSetKey(vCipher.data(), iCipherSize, vOut.data());
+
+        report.checkBytes(vPadded.data(), vOut.data(), iCipherSize, sCase + "DecryptECBWithSetKey()" + sPass);
+
+
+        // The key per call should not change the set key.
+
+        std::vector<unsigned char> vOtherKey(vKey.size(), 0x5A);
+
+        aes.EncryptECB(vPlain.data(), iPlainSize, vOtherKey.data(), vOut.data());
+        aes.DecryptECB(vCipher.data(), iCipherSize, vOtherKey.data(), vOut.data());
+    }
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+void runAESChecks(ModelCheckReport& report)
+{
+    const AESBackend vBackends[] = { AES_BACKEND_REFERENCE, AES_BACKEND_TTABLE, AES_BACKEND_AESNI };
+
+    for (size_t i = 0;  i < sizeof(vBackends) / sizeof(vBackends[0]);  i++)
+    {
+        if (AESIsBackendSupported(vBackends[i]) == false)
+        {
+            report.skip( std::string(AESGetBackendName(vBackends[i])) + " (not supported by this CPU)" );
+
+            continue;
+        }
+
+        for (size_t k = 0;  k < sizeof(vKnownAnswers) / sizeof(vKnownAnswers[0]);  k++)
+        {
+            checkKnownAnswer(report, vBackends[i], vKnownAnswers[k]);
+        }
+    }
+}
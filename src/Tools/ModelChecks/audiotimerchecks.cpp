@@ -0,0 +1,283 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "modelchecks.h"
+
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Custom
+#include "Model/AudioTimer/audiotimer.h"
+
+
+// The capture loop of the cadence check: the client's 35 ms frames, a new talk every few frames.
+#define  AUDIO_TIMER_CHECKS_FRAME_MS             35
+#define  AUDIO_TIMER_CHECKS_FRAME_COUNT          60
+#define  AUDIO_TIMER_CHECKS_TALK_FRAMES          4
+
+// Same as AUDIO_LAST_MESSAGE_DELAY_MS in AudioService.
+#define  AUDIO_TIMER_CHECKS_LAST_MESSAGE_MS      10
+
+// Time the (fake) send of the end of talk takes on the timer thread.
+#define  AUDIO_TIMER_CHECKS_SEND_MS              3
+
+// The capture thread's mean work per frame should stay under this (the old sleep_for() at each talk end alone
+// was 10 ms / AUDIO_TIMER_CHECKS_TALK_FRAMES = 2.5 ms) and no frame should take a whole frame period.
+// Not the wake up time of the frames: that is the OS scheduler's jitter (can be 20 ms on a busy VM).
+#define  AUDIO_TIMER_CHECKS_MAX_MEAN_BUSY_MS     1.0
+#define  AUDIO_TIMER_CHECKS_MAX_BUSY_MS          AUDIO_TIMER_CHECKS_FRAME_MS
+
+
+typedef std::chrono::steady_clock  CheckClock;
+
+
+static double getElapsedMS(CheckClock::time_point startTime, CheckClock::time_point endTime)
+{
+    return std::chrono::duration<double, std::milli>(endTime - startTime).count();
+}
+
+static void checkOrder(ModelCheckReport& report)
+{
+    AudioTimer timer;
+
+    std::mutex        mtxOrder;
+    std::vector<int>  vOrder;
+
+    auto makeTask = [&](int iValue)
+    {
+        return [&mtxOrder, &vOrder, iValue]()
+        {
+            std::lock_guard<std::mutex> lock(mtxOrder);
+
+            vOrder.push_back(iValue);
+        };
+    };
+
+    timer.schedule(60, makeTask(3));
+    timer.schedule(20, makeTask(1));
+    timer.schedule(40, makeTask(2));
+
+    unsigned long long iCancelled = timer.schedule(30, makeTask(0));
+
+    report.check( timer.cancel(iCancelled),           "cancel() of a pending task returns true" );
+    report.check( timer.cancel(iCancelled) == false,  "second cancel() returns false" );
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+
+
+    std::lock_guard<std::mutex> lock(mtxOrder);
+
+    report.check( (vOrder.size() == 3) && (vOrder[0] == 1) && (vOrder[1] == 2) && (vOrder[2] == 3),
+                  "tasks run in the order of their deadlines, the cancelled one does not run" );
+}
+
+static void checkRunNow(ModelCheckReport& report)
+{
+    AudioTimer timer;
+
+
+    // Pending: runs on the calling thread.
+
+    std::thread::id runThread;
+
+    unsigned long long iPending = timer.schedule(1000, [&runThread]()
+    {
+        runThread = std::this_thread::get_id();
+    });
+
+    report.check( timer.runNow(iPending),                              "runNow() of a pending task returns true" );
+    report.check( runThread == std::this_thread::get_id(),             "runNow() runs the task on the calling thread" );
+    report.check( timer.runNow(iPending) == false,                     "runNow() of a finished task returns false" );
+    report.check( timer.runNow(AUDIO_TIMER_NO_TASK) == false,          "runNow() of no task returns false" );
+
+
+    // In flight on the timer thread: waits for it.
+
+    std::atomic<bool> bStarted (false);
+    std::atomic<bool> bFinished(false);
+
+    unsigned long long iInFlight = timer.schedule(0, [&bStarted, &bFinished]()
+    {
+        bStarted = true;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        bFinished = true;
+    });
+
+    while (bStarted == false)
+    {
+        std::this_thread::yield();
+    }
+
+    bool bRunByThisCall = timer.runNow(iInFlight);
+
+    report.check( bRunByThisCall == false,  "runNow() of a running task returns false" );
+    report.check( bFinished,                "runNow() of a running task waits until it finishes" );
+
+
+    // From the task itself: does not wait for itself.
+
+    std::atomic<bool> bSelfDone(false);
+    unsigned long long iSelf = AUDIO_TIMER_NO_TASK;
+    std::mutex mtxSelf;
+
+    {
+        std::lock_guard<std::mutex> lock(mtxSelf);
+
+        iSelf = timer.schedule(0, [&timer, &iSelf, &mtxSelf, &bSelfDone]()
+        {
+            unsigned long long iId = AUDIO_TIMER_NO_TASK;
+            {
+                std::lock_guard<std::mutex> lock(mtxSelf);
+
+                iId = iSelf;
+            }
+
+            timer.runNow(iId);
+
+            bSelfDone = true;
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    report.check( bSelfDone, "runNow() of its own id from the task returns" );
+}
+
+static void checkCaptureCadence(ModelCheckReport& report)
+{
+    // The encoder pattern of AudioService: at the end of each talk the end of talk message is scheduled,
+    // at the start of the next talk (the next frame here) it is flushed with runNow() so it goes before the new voice packets.
+    // The end of talk is sent by the timer thread before the next frame, while the next frame comes (runNow() waits)
+    // or by runNow() itself. The capture thread should keep its cadence in all three cases.
+
+    const unsigned int vDelaysMS[] = { AUDIO_TIMER_CHECKS_LAST_MESSAGE_MS, AUDIO_TIMER_CHECKS_FRAME_MS - 1, AUDIO_TIMER_CHECKS_FRAME_MS * 3 };
+
+    AudioTimer timer;
+
+    // >= 0 - voice packet of that talk, < 0 - end of talk (-1 - talk).
+    std::mutex        mtxSent;
+    std::vector<int>  vSent;
+
+    unsigned long long iLastMessageTask = AUDIO_TIMER_NO_TASK;
+
+    double dMaxBusyMS   = 0.0;
+    double dTotalBusyMS = 0.0;
+
+    CheckClock::time_point nextFrame = CheckClock::now();
+
+    for (int iFrame = 0;  iFrame < AUDIO_TIMER_CHECKS_FRAME_COUNT;  iFrame++)
+    {
+        nextFrame += std::chrono::milliseconds(AUDIO_TIMER_CHECKS_FRAME_MS);
+
+        std::this_thread::sleep_until(nextFrame);
+
+
+        CheckClock::time_point startTime = CheckClock::now();
+
+        int iTalk = iFrame / AUDIO_TIMER_CHECKS_TALK_FRAMES;
+
+        if (iLastMessageTask != AUDIO_TIMER_NO_TASK)
+        {
+            timer.runNow(iLastMessageTask);
+
+            iLastMessageTask = AUDIO_TIMER_NO_TASK;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mtxSent);
+
+            vSent.push_back(iTalk);
+        }
+
+        if ( (iFrame + 1) % AUDIO_TIMER_CHECKS_TALK_FRAMES == 0 )
+        {
+            unsigned int iDelayMS = vDelaysMS[ iTalk % (sizeof(vDelaysMS) / sizeof(vDelaysMS[0])) ];
+
+            iLastMessageTask = timer.schedule(iDelayMS, [&mtxSent, &vSent, iTalk]()
+            {
+                // The socket send.
+                std::this_thread::sleep_for(std::chrono::milliseconds(AUDIO_TIMER_CHECKS_SEND_MS));
+
+                std::lock_guard<std::mutex> lock(mtxSent);
+
+                vSent.push_back(-1 - iTalk);
+            });
+        }
+
+        CheckClock::time_point endTime = CheckClock::now();
+
+
+        dMaxBusyMS    = std::max(dMaxBusyMS, getElapsedMS(startTime, endTime));
+        dTotalBusyMS += getElapsedMS(startTime, endTime);
+    }
+
+    if (iLastMessageTask != AUDIO_TIMER_NO_TASK)
+    {
+        timer.runNow(iLastMessageTask);
+    }
+
+
+    char vBuffer[200];
+
+    double dMeanBusyMS = dTotalBusyMS / AUDIO_TIMER_CHECKS_FRAME_COUNT;
+
+    std::snprintf(vBuffer, sizeof(vBuffer), "capture work per frame: mean %.2f ms (limit %.1f ms)", dMeanBusyMS, AUDIO_TIMER_CHECKS_MAX_MEAN_BUSY_MS);
+    report.check( dMeanBusyMS < AUDIO_TIMER_CHECKS_MAX_MEAN_BUSY_MS, vBuffer );
+
+    std::snprintf(vBuffer, sizeof(vBuffer), "capture work per frame: max %.2f ms (limit %d ms)", dMaxBusyMS, AUDIO_TIMER_CHECKS_MAX_BUSY_MS);
+    report.check( dMaxBusyMS < AUDIO_TIMER_CHECKS_MAX_BUSY_MS, vBuffer );
+
+
+    // Each talk: its voice packets, then its end (before the next talk's packets).
+
+    std::lock_guard<std::mutex> lock(mtxSent);
+
+    bool bOrdered  = true;
+    int  iExpected = 0;
+    int  iPackets  = 0;
+
+    for (size_t i = 0;  (i < vSent.size()) && bOrdered;  i++)
+    {
+        if (vSent[i] >= 0)
+        {
+            bOrdered = (vSent[i] == iExpected);
+
+            iPackets++;
+        }
+        else
+        {
+            bOrdered = (vSent[i] == -1 - iExpected) && (iPackets == AUDIO_TIMER_CHECKS_TALK_FRAMES);
+
+            iExpected++;
+            iPackets = 0;
+        }
+    }
+
+    report.check( bOrdered && (iPackets == 0), "each end of talk is sent after its voice packets and before the next talk" );
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+void runAudioTimerChecks(ModelCheckReport& report)
+{
+    checkOrder          (report);
+    checkRunNow         (report);
+    checkCaptureCadence (report);
+}
@@ -0,0 +1,114 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "modelchecks.h"
+
+
+// STL
+#include <string>
+
+// Custom
+#include "Model/ChatLog/chatlog.h"
+
+
+#define  CHAT_LOG_CHECKS_CAPACITY      8
+#define  CHAT_LOG_CHECKS_USER_COUNT    1000
+
+
+static std::string getUserName(size_t iUser)
+{
+    return "user" + std::to_string(iUser);
+}
+
+static void addMessage(ChatLog& log, size_t iUser)
+{
+    log.addUserMessage("18:58.", getUserName(iUser), L"hi", "white", "white");
+}
+
+static bool checkNames(const ChatLog& log, size_t iFirstUser)
+{
+    for (size_t i = 0;  i < log.getSize();  i++)
+    {
+        if (log.getName(log.getEntry(i).iNameId) != getUserName(iFirstUser + i))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void checkNameTable(ModelCheckReport& report)
+{
+    // Each user writes once: all but the last 'CHAT_LOG_CHECKS_CAPACITY' names are dropped with their entries.
+
+    ChatLog log(CHAT_LOG_CHECKS_CAPACITY);
+
+    for (size_t i = 0;  i < CHAT_LOG_CHECKS_USER_COUNT;  i++)
+    {
+        addMessage(log, i);
+    }
+
+    report.check( log.getNameCount() == CHAT_LOG_CHECKS_CAPACITY,
+                  "the names of the overwritten entries are removed (got " + std::to_string(log.getNameCount()) + " names)" );
+    report.check( checkNames(log, CHAT_LOG_CHECKS_USER_COUNT - CHAT_LOG_CHECKS_CAPACITY),
+                  "the kept entries have their names after the ids were reused" );
+
+
+    // A name used by the kept entries stays.
+
+    addMessage(log, 0);
+    addMessage(log, 0);
+
+    report.check( log.getNameCount() == CHAT_LOG_CHECKS_CAPACITY - 1, "a name of two entries is interned once" );
+
+    for (size_t i = 0;  i < CHAT_LOG_CHECKS_CAPACITY - 1;  i++)
+    {
+        log.addOutput(L"info", "white");
+    }
+
+    report.check( (log.getNameCount() == 1) && (log.getName(log.getEntry(0).iNameId) == getUserName(0)),
+                  "a name stays while an entry uses it" );
+
+    log.addOutput(L"info", "white");
+
+    report.check( log.getNameCount() == 0, "the name is removed with its last entry" );
+
+
+    // Smaller capacity.
+
+    for (size_t i = 0;  i < CHAT_LOG_CHECKS_CAPACITY;  i++)
+    {
+        addMessage(log, i);
+    }
+
+    log.setCapacity(CHAT_LOG_CHECKS_CAPACITY / 2);
+
+    report.check( (log.getNameCount() == CHAT_LOG_CHECKS_CAPACITY / 2) && checkNames(log, CHAT_LOG_CHECKS_CAPACITY / 2),
+                  "setCapacity() removes the names of the dropped entries" );
+
+
+    // Clear.
+
+    log.clear();
+
+    report.check( log.getNameCount() == 0, "clear() removes the names" );
+
+    addMessage(log, 1);
+
+    report.check( (log.getEntry(0).iNameId == 0) && checkNames(log, 1), "the name ids start over after clear()" );
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+void runChatLogChecks(ModelCheckReport& report)
+{
+    checkNameTable(report);
+}
@@ -0,0 +1,222 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "modelchecks.h"
+
+
+// STL
+#include <climits>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+// Custom
+#include "Model/AudioDSP/audiodsp.h"
+
+
+// The client's voice packet (see AudioService).
+#define  DSP_CHECKS_FRAME_SAMPLES   679
+
+// The SIMD loops take 8 / 16 samples, all the tails of the scalar loop are checked with this many extra sizes.
+#define  DSP_CHECKS_MAX_TAIL        16
+
+// The RMS is summed up in a different order (float).
+#define  DSP_CHECKS_RMS_TOLERANCE   1e-5
+
+
+// 1.45 is the master volume multiplier of the AudioService (clips the loud input).
+static const float vGains[] = { 0.0f, 0.37f, 0.5f, 1.0f, 1.45f, 1.5f, 2.0f, 4.0f };
+
+
+// The input of one case.
+struct DSPCheckInput
+{
+    std::string             sName;
+    std::vector<short int>  vSamples;
+};
+
+
+// Output of the kernel under check.
+struct DSPCheckOutput
+{
+    std::vector<short int>  vGainSamples;
+    AudioFrameLevel         gainLevel;
+    AudioFrameLevel         measureLevel;
+
+    std::vector<int>        vMix;
+    std::vector<short int>  vSaturated;
+};
+
+
+static std::vector<DSPCheckInput> makeInputs()
+{
+    std::mt19937 rndGen(4004);
+    std::uniform_int_distribution<int> sampleDistribution(SHRT_MIN, SHRT_MAX);
+
+    std::vector<DSPCheckInput> vInputs;
+
+    DSPCheckInput input;
+
+    input.sName = "random";
+    for (size_t i = 0;  i < DSP_CHECKS_FRAME_SAMPLES + DSP_CHECKS_MAX_TAIL;  i++)
+    {
+        input.vSamples.push_back( static_cast<short int>(sampleDistribution(rndGen)) );
+    }
+    vInputs.push_back(input);
+
+    input.sName = "SHRT_MAX";
+    input.vSamples.assign(DSP_CHECKS_FRAME_SAMPLES + DSP_CHECKS_MAX_TAIL, SHRT_MAX);
+    vInputs.push_back(input);
+
+    input.sName = "SHRT_MIN (-32768)";
+    input.vSamples.assign(DSP_CHECKS_FRAME_SAMPLES + DSP_CHECKS_MAX_TAIL, SHRT_MIN);
+    vInputs.push_back(input);
+
+    input.sName = "+-32768 / 32767 alternating";
+    for (size_t i = 0;  i < input.vSamples.size();  i++)
+    {
+        input.vSamples[i] = (i % 2) ? SHRT_MAX : SHRT_MIN;
+    }
+    vInputs.push_back(input);
+
+    input.sName = "small (-3..3)";
+    for (size_t i = 0;  i < input.vSamples.size();  i++)
+    {
+        input.vSamples[i] = static_cast<short int>( static_cast<int>(i % 7) - 3 );
+    }
+    vInputs.push_back(input);
+
+
+    return vInputs;
+}
+
+static DSPCheckOutput runKernel(const std::vector<short int>& vSamples, size_t iSampleCount, float fGain)
+{
+    DSPCheckOutput output;
+
+    output.vGainSamples.assign(vSamples.begin(), vSamples.begin() + static_cast<long>(iSampleCount));
+
+    output.measureLevel = AudioDSP::measureWithGain (vSamples.data(), iSampleCount, fGain);
+    output.gainLevel    = AudioDSP::applyGain       (output.vGainSamples.data(), iSampleCount, fGain);
+
+
+    // The mix with something in it already and the saturation of the sums.
+
+    output.vMix.resize(iSampleCount);
+
+    for (size_t i = 0;  i < iSampleCount;  i++)
+    {
+        output.vMix[i] = static_cast<int>(i * 97) - 30000;
+    }
+
+    AudioDSP::mixWithGain(output.vMix.data(), vSamples.data(), iSampleCount, fGain);
+    AudioDSP::mixWithGain(output.vMix.data(), vSamples.data(), iSampleCount, fGain);
+
+    if (iSampleCount > 0)
+    {
+        output.vMix[0] = INT_MAX;
+        output.vMix[iSampleCount - 1] = INT_MIN;
+    }
+
+    output.vSaturated.resize(iSampleCount);
+
+    AudioDSP::saturate(output.vMix.data(), output.vSaturated.data(), iSampleCount);
+
+
+    return output;
+}
+
+static bool isRMSClose(float fExpected, float fActual)
+{
+    return std::fabs( static_cast<double>(fExpected) - static_cast<double>(fActual) )
+           <= DSP_CHECKS_RMS_TOLERANCE * std::fabs(static_cast<double>(fExpected)) + 1e-6;
+}
+
+static void checkKernel(ModelCheckReport& report, AUDIO_DSP_KERNEL kernel, const std::vector<DSPCheckInput>& vInputs)
+{
+    std::string sKernel = AudioDSP::getKernelName(kernel);
+
+    if ( AudioDSP::isKernelSupported(kernel) == false )
+    {
+        report.skip(sKernel + " is not supported by this CPU");
+
+        return;
+    }
+
+
+    // Each input, gain and size: the frame, the frames shorter than one SIMD step and every tail length.
+
+    std::vector<size_t> vSizes;
+
+    for (size_t i = 0;  i < DSP_CHECKS_MAX_TAIL;  i++)
+    {
+        vSizes.push_back(i);
+        vSizes.push_back(DSP_CHECKS_FRAME_SAMPLES - 7 + i);
+    }
+
+
+    for (size_t iInput = 0;  iInput < vInputs.size();  iInput++)
+    {
+        size_t iFailedCount = 0;
+        std::string sFirstFailed;
+
+        for (size_t iGain = 0;  iGain < sizeof(vGains) / sizeof(vGains[0]);  iGain++)
+        {
+            for (size_t iSize = 0;  iSize < vSizes.size();  iSize++)
+            {
+                const std::vector<short int>& vSamples = vInputs[iInput].vSamples;
+
+                AudioDSP::setKernel(ADK_SCALAR);
+                DSPCheckOutput expected = runKernel(vSamples, vSizes[iSize], vGains[iGain]);
+
+                AudioDSP::setKernel(kernel);
+                DSPCheckOutput actual   = runKernel(vSamples, vSizes[iSize], vGains[iGain]);
+
+                std::string sWhat;
+
+                if      (actual.vGainSamples != expected.vGainSamples)               sWhat = "applyGain() samples";
+                else if (actual.gainLevel.iPeak != expected.gainLevel.iPeak)         sWhat = "applyGain() peak";
+                else if (actual.measureLevel.iPeak != expected.measureLevel.iPeak)   sWhat = "measureWithGain() peak";
+                else if (isRMSClose(expected.gainLevel.fRMS, actual.gainLevel.fRMS) == false)       sWhat = "applyGain() RMS";
+                else if (isRMSClose(expected.measureLevel.fRMS, actual.measureLevel.fRMS) == false) sWhat = "measureWithGain() RMS";
+                else if (actual.vMix != expected.vMix)                               sWhat = "mixWithGain()";
+                else if (actual.vSaturated != expected.vSaturated)                   sWhat = "saturate()";
+
+                if (sWhat.empty() == false)
+                {
+                    if (iFailedCount == 0)
+                    {
+                        sFirstFailed = sWhat + " with the gain " + std::to_string(vGains[iGain]) + " of "
+                                       + std::to_string(vSizes[iSize]) + " samples";
+                    }
+
+                    iFailedCount++;
+                }
+            }
+        }
+
+        report.check( iFailedCount == 0,
+                      sKernel + " = scalar on the " + vInputs[iInput].sName + " input"
+                      + (iFailedCount ? " (" + std::to_string(iFailedCount) + " cases differ, first: " + sFirstFailed + ")" : "") );
+    }
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+void runDSPChecks(ModelCheckReport& report)
+{
+    std::vector<DSPCheckInput> vInputs = makeInputs();
+
+    checkKernel(report, ADK_SSE2, vInputs);
+    checkKernel(report, ADK_AVX2, vInputs);
+
+    AudioDSP::setKernel( AudioDSP::getBestKernel() );
+}
@@ -0,0 +1,348 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "modelchecks.h"
+
+
+// STL
+#include <cstdint>
+#include <random>
+
+// External
+#include "integer/integer.h"
+#include "integer/limb_vector.h"
+
+
+#define  INTEGER_CHECKS_MIN_BITS     64
+#define  INTEGER_CHECKS_MAX_BITS     4096
+
+// Random operands of each size.
+#define  INTEGER_CHECKS_RANDOM_PAIRS 8
+
+// Random p, g, b of powmod().
+#define  INTEGER_CHECKS_POWMOD_COUNT 200
+
+
+struct IntegerDivisionAnswer
+{
+    const char*  pWhat;
+
+    const char*  pDividendHex;
+    const char*  pDivisorHex;
+    const char*  pQuotientHex;
+    const char*  pRemainderHex;
+};
+
+
+// Knuth's Algorithm D with 32-bit digits: the rare steps (the test vectors of divmnu64() from "Hacker's Delight").
+static const IntegerDivisionAnswer vDivisionAnswers[] =
+{
+    {
+        "add back (4 / 3 digits)",
+        "7fffffff800000000000000000000000",
+        "800000000000000000000001",
+        "fffffffe",
+        "7fffffffffffffff00000002"
+    },
+    {
+        "add back (3 / 3 digits)",
+        "800000000000000000000003",
+        "200000000000000000000001",
+        "3",
+        "200000000000000000000000"
+    },
+    {
+        "add back (4 / 3 digits, unnormalized)",
+        "7fff000080000000000000000000",
+        "80000000000000000001",
+        "fffe0000",
+        "7fffffffffff00020000"
+    },
+    {
+        "quotient digit estimate corrected",
+        "80000000fffe00000000",
+        "80000000ffff",
+        "ffffffff",
+        "7fff0000ffff"
+    },
+    {
+        "single digit divisor",
+        "1000000000000000000000000000000005",
+        "7",
+        "249249249249249249249249249249249",
+        "6"
+    },
+};
+
+
+struct IntegerDecimalAnswer
+{
+    const char*  pWhat;
+
+    const char*  pHex;
+    const char*  pDecimal;
+};
+
+
+static const IntegerDecimalAnswer vDecimalAnswers[] =
+{
+    { "2^64 - 1",  "ffffffffffffffff",                          "18446744073709551615" },
+    { "2^128",     "100000000000000000000000000000000",         "340282366920938463463374607431768211456" },
+    { "3^100",     "5a4653ca673768565b41f775d6947d55cf3813d1",  "515377520732011331036461129765621272702107522001" },
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Random 'iBits'-bit value (the top bit is set).
+static integer makeOperand(std::mt19937& rndGen, size_t iBits)
+{
+    static const char* pHexDigits = "0123456789abcdef";
+
+    std::string sHex;
+
+    for (size_t i = 0;  i < iBits / 4;  i++)
+    {
+        sHex += pHexDigits[ rndGen() % 16 ];
+    }
+
+    sHex[0] = pHexDigits[ 8 + rndGen() % 8 ];
+
+
+    return integer(sHex, 16);
+}
+
+static void checkLimbVector(ModelCheckReport& report)
+{
+    // Both ends, through the inline storage (8 digits) to the heap.
+
+    limb_vector<uint32_t> vDigits;
+
+    for (uint32_t i = 0;  i < 20;  i++)
+    {
+        vDigits.push_back(100 + i);
+        vDigits.push_front(99 - i);
+    }
+
+    bool bInOrder = (vDigits.size() == 40);
+
+    for (size_t i = 0;  bInOrder && (i < vDigits.size());  i++)
+    {
+        bInOrder = (vDigits[i] == 80 + i);
+    }
+
+    report.check(bInOrder, "limb_vector: push_front() and push_back() past the inline storage");
+
+
+    limb_vector<uint32_t> vCopy(vDigits);
+    vCopy.pop_front();
+    vCopy.pop_back();
+
+    report.check( (vCopy.size() == 38) && (vCopy.front() == 81) && (vCopy.back() == 118) && (vDigits.size() == 40),
+                  "limb_vector: the copy is separate, pop_front() and pop_back()" );
+
+
+    limb_vector<uint32_t> vMoved(std::move(vCopy));
+
+    report.check( (vMoved.size() == 38) && vCopy.empty() && (vMoved[0] == 81), "limb_vector: move of a heap buffer" );
+
+
+    limb_vector<uint32_t> vSmall(3, 7);
+    limb_vector<uint32_t> vSmallMoved(std::move(vSmall));
+
+    report.check( (vSmallMoved.size() == 3) && (vSmallMoved[2] == 7) && vSmall.empty(), "limb_vector: move of the inline storage" );
+
+
+    vSmallMoved.insert(vSmallMoved.begin(), 2, 1);
+    vSmallMoved.resize(7, 9);
+
+    const uint32_t vExpected[] = { 1, 1, 7, 7, 7, 9, 9 };
+
+    bool bEqual = (vSmallMoved.size() == 7);
+
+    for (size_t i = 0;  bEqual && (i < vSmallMoved.size());  i++)
+    {
+        bEqual = (vSmallMoved[i] == vExpected[i]);
+    }
+
+    report.check(bEqual, "limb_vector: insert() at the front and resize()");
+
+
+    vMoved = vSmallMoved;
+
+    report.check(vMoved == vSmallMoved, "limb_vector: assignment and operator==");
+}
+
+static void checkMultiply(ModelCheckReport& report, std::mt19937& rndGen)
+{
+    report.check( (integer("ffffffffffffffff", 16) * integer("ffffffffffffffff", 16)).str(16) == "fffffffffffffffe0000000000000001",
+                  "multiply: (2^64 - 1)^2" );
+
+
+    for (size_t iBits = INTEGER_CHECKS_MIN_BITS;  iBits <= INTEGER_CHECKS_MAX_BITS;  iBits *= 2)
+    {
+        std::string sBits = std::to_string(iBits) + " bits: ";
+
+
+        // All digits 0xffffffff: the carry goes through every digit.
+        // (2^n - 1)^2 = 2^2n - 2^(n + 1) + 1
+
+        integer ones = (integer(1) << iBits) - 1;
+
+        report.check( ones * ones == (integer(1) << (2 * iBits)) - (integer(1) << (iBits + 1)) + 1, "multiply, " + sBits + "(2^n - 1)^2" );
+
+
+        bool bPassed = true;
+
+        for (size_t i = 0;  bPassed && (i < INTEGER_CHECKS_RANDOM_PAIRS);  i++)
+        {
+            integer a = makeOperand(rndGen, iBits);
+            integer b = makeOperand(rndGen, iBits / 2 + 32 * i);
+
+            integer product = a * b;
+
+            bPassed = (product == b * a) && (product / b == a) && (product % a == 0)
+                      && ((a + 1) * b == product + b) && ((-a) * b == -product) && (a * integer(0) == 0);
+        }
+
+        report.check(bPassed, "multiply, " + sBits + "random operands (a * b / b, a * b % a, (a + 1) * b, signs)");
+    }
+}
+
+static void checkDivide(ModelCheckReport& report, std::mt19937& rndGen)
+{
+    for (size_t i = 0;  i < sizeof(vDivisionAnswers) / sizeof(vDivisionAnswers[0]);  i++)
+    {
+        const IntegerDivisionAnswer& answer = vDivisionAnswers[i];
+
+        integer dividend(answer.pDividendHex, 16);
+        integer divisor (answer.pDivisorHex,  16);
+
+        report.check( (dividend / divisor).str(16) == answer.pQuotientHex,  std::string("divide, ") + answer.pWhat + ": quotient" );
+        report.check( (dividend % divisor).str(16) == answer.pRemainderHex, std::string("divide, ") + answer.pWhat + ": remainder" );
+    }
+
+
+    for (size_t iBits = INTEGER_CHECKS_MIN_BITS;  iBits <= INTEGER_CHECKS_MAX_BITS;  iBits *= 2)
+    {
+        std::string sBits = std::to_string(iBits) + " bits: ";
+
+        bool bPassed = true;
+
+        for (size_t i = 0;  bPassed && (i < INTEGER_CHECKS_RANDOM_PAIRS);  i++)
+        {
+            // Different shifts of the normalization (0 - the top bit of the divisor is already set).
+
+            integer dividend = makeOperand(rndGen, 2 * iBits);
+            integer divisor  = makeOperand(rndGen, iBits) >> i;
+
+            integer quotient  = dividend / divisor;
+            integer remainder = dividend % divisor;
+
+            bPassed = (quotient * divisor + remainder == dividend) && (remainder < divisor) && (remainder >= 0);
+        }
+
+        report.check(bPassed, "divide, " + sBits + "random 2n / n (q * b + r == a, 0 <= r < b)");
+    }
+}
+
+static void checkStrings(ModelCheckReport& report, std::mt19937& rndGen)
+{
+    for (size_t i = 0;  i < sizeof(vDecimalAnswers) / sizeof(vDecimalAnswers[0]);  i++)
+    {
+        const IntegerDecimalAnswer& answer = vDecimalAnswers[i];
+
+        report.check( integer(answer.pHex, 16).str(10) == answer.pDecimal, std::string("str(10), ") + answer.pWhat );
+        report.check( integer(answer.pDecimal, 10).str(16) == answer.pHex, std::string("parse(10), ") + answer.pWhat );
+    }
+
+    report.check( pow(integer(3), 100).str(10) == vDecimalAnswers[2].pDecimal, "pow(3, 100)" );
+
+
+    for (size_t iBits = INTEGER_CHECKS_MIN_BITS;  iBits <= INTEGER_CHECKS_MAX_BITS;  iBits *= 2)
+    {
+        bool bPassed = true;
+
+        for (size_t i = 0;  bPassed && (i < INTEGER_CHECKS_RANDOM_PAIRS);  i++)
+        {
+            integer value = makeOperand(rndGen, iBits);
+
+            bPassed = (integer(value.str(10), 10) == value) && (integer(value.str(16), 16) == value) && (integer(value.str(7), 7) == value);
+        }
+
+        report.check(bPassed, "str() / parse, " + std::to_string(iBits) + " bits: random values in bases 10, 16 and 7");
+    }
+}
+
+
+static void checkPowMod(ModelCheckReport& report, std::mt19937& rndGen)
+{
+    // The handshake exponents (500 - 1000) against the whole power reduced at the end (the old handshake),
+    // random 32-bit exponents against pow() of the integers with the modulus.
+
+    std::uniform_int_distribution<uint32_t> valueDistribution(0, 0xffffffffu);
+    std::uniform_int_distribution<uint32_t> handshakeDistribution(500, 1000);
+
+    bool bPassedHandshake = true;
+    bool bPassedRandom    = true;
+
+    for (size_t i = 0;  i < INTEGER_CHECKS_POWMOD_COUNT;  i++)
+    {
+        uint64_t p = valueDistribution(rndGen) | 1;
+        uint64_t g = valueDistribution(rndGen);
+        uint64_t b = handshakeDistribution(rndGen);
+
+        if ( integer(powmod(g, b, p)) != (pow(integer(g), b) % integer(p)) )
+        {
+            bPassedHandshake = false;
+        }
+
+        b = valueDistribution(rndGen);
+
+        if ( integer(powmod(g, b, p)) != pow(integer(g), b, p) )
+        {
+            bPassedRandom = false;
+        }
+    }
+
+    report.check(bPassedHandshake, "powmod(): random 32-bit p, g and b of 500 - 1000 against pow(g, b) % p");
+    report.check(bPassedRandom,    "powmod(): random 32-bit p, g and b against pow(g, b, p)");
+
+
+    // Edge cases: modulus 1, exponent 0, base 0 and larger than the modulus, the largest 32-bit modulus,
+    // a modulus above 32 bits (the integer fallback).
+
+    bool bPassedEdges =
+        (powmod(5, 3, 1)                        == 0)                  &&
+        (powmod(5, 0, 7)                        == 1)                  &&
+        (powmod(0, 9, 7)                        == 0)                  &&
+        (powmod(0xffffffffffffffffULL, 2, 10)   == 5)                  &&
+        (powmod(0xfffffffeULL, 3, 0xffffffffULL) == 0xfffffffeULL)     &&
+        (integer(powmod(0x123456789ULL, 77, 0x1000000000000ULL)) == pow(integer(0x123456789ULL), 77, 0x1000000000000ULL));
+
+    report.check(bPassedEdges, "powmod(): modulus 1, exponent 0, base 0, base above the modulus, 32 and 48-bit moduli");
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+void runIntegerChecks(ModelCheckReport& report)
+{
+    std::mt19937 rndGen(51337);
+
+    checkLimbVector (report);
+    checkMultiply   (report, rndGen);
+    checkDivide     (report, rndGen);
+    checkStrings    (report, rndGen);
+    checkPowMod     (report, rndGen);
+}
@@ -0,0 +1,311 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "modelchecks.h"
+
+
+// STL
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Custom
+#include "Model/JitterBuffer/jitterbuffer.h"
+#include "Model/VoicePacketQueue/voicepacketqueue.h"
+
+
+// Same as the AudioService's voice packets (35 ms).
+#define  JITTER_BUFFER_CHECKS_SAMPLE_COUNT   679
+#define  JITTER_BUFFER_CHECKS_SAMPLE_RATE    19400
+#define  JITTER_BUFFER_CHECKS_FRAME_MS       35
+
+
+// The packets of one speaker: each frame is filled with its 'sequence + 1' to find it in the playout.
+class JitterBufferCheckSpeaker
+{
+
+public:
+
+    JitterBufferCheckSpeaker(bool bSequenceFromServer)
+        : buffer(JITTER_BUFFER_CHECKS_SAMPLE_COUNT, JITTER_BUFFER_CHECKS_SAMPLE_RATE)
+    {
+        this->bSequenceFromServer = bSequenceFromServer;
+
+        startTime        = std::chrono::steady_clock::now();
+        iConcealedFrames = 0;
+    }
+
+
+    // Arrives at 'iTick' * frame duration.
+    void send(unsigned int iSequence, unsigned int iTick)
+    {
+        VoicePacket packet;
+        packet.pAudio              = new short int[JITTER_BUFFER_CHECKS_SAMPLE_COUNT];
+        packet.arrivalTime         = startTime + std::chrono::milliseconds(iTick * JITTER_BUFFER_CHECKS_FRAME_MS);
+        packet.iSequence           = iSequence;
+        packet.bSequenceFromServer = bSequenceFromServer;
+        packet.bLast               = false;
+
+        for (size_t i = 0;  i < JITTER_BUFFER_CHECKS_SAMPLE_COUNT;  i++)
+        {
+            packet.pAudio[i] = static_cast<short int>(iSequence + 1);
+        }
+
+        buffer.insert(packet);
+    }
+
+    void sendLast(unsigned int iTick)
+    {
+        VoicePacket packet;
+        packet.pAudio              = nullptr;
+        packet.arrivalTime         = startTime + std::chrono::milliseconds(iTick * JITTER_BUFFER_CHECKS_FRAME_MS);
+        packet.iSequence           = 0;
+        packet.bSequenceFromServer = bSequenceFromServer;
+        packet.bLast               = true;
+
+        buffer.insert(packet);
+    }
+
+    // Starts the playout if the buffer is ready (as AudioService::updateUserPlayback()).
+    void update()
+    {
+        if ( (buffer.isPlaying() == false) && buffer.isReadyToPlay() )
+        {
+            buffer.startPlayout();
+        }
+    }
+
+    // Returns 'sequence + 1' of the played frame, 0 for a concealed (or silent) one or -1 if the playout stopped.
+    int play()
+    {
+        short int* pFrame = buffer.getNextFrame();
+
+        if (pFrame == nullptr)
+        {
+            return -1;
+        }
+
+
+        // The concealed frames are the last frame made quieter: not the number of a sent frame.
+
+        int iValue = pFrame[0];
+
+        bool bConcealed = buffer.getStats().iConcealedFrames != iConcealedFrames;
+
+        iConcealedFrames = buffer.getStats().iConcealedFrames;
+
+        delete[] pFrame;
+
+
+        return bConcealed ? 0 : iValue;
+    }
+
+
+    JitterBuffer        buffer;
+
+private:
+
+    std::chrono::steady_clock::time_point  startTime;
+    unsigned long long  iConcealedFrames;
+    bool                bSequenceFromServer;
+};
+
+
+static std::string formatPlayout(const std::vector<int>& vPlayed)
+{
+    std::string sText;
+
+    for (size_t i = 0;  i < vPlayed.size();  i++)
+    {
+        sText += (i == 0 ? "" : " ") + std::to_string(vPlayed[i]);
+    }
+
+    return sText;
+}
+
+static void checkReorder(ModelCheckReport& report)
+{
+    JitterBufferCheckSpeaker speaker(true);
+
+    speaker.send(10, 0);
+    speaker.send(12, 1);
+    speaker.send(11, 2);
+    speaker.update();
+
+    std::vector<int> vPlayed;
+
+    for (size_t i = 0;  i < 3;  i++)
+    {
+        vPlayed.push_back( speaker.play() );
+    }
+
+    JitterBufferStats stats = speaker.buffer.getStats();
+
+    report.check( formatPlayout(vPlayed) == "11 12 13",
+                  "reordered packets are played in order (played: " + formatPlayout(vPlayed) + ")" );
+    report.check( (stats.iLatePackets == 0) && (stats.iLostPackets == 0) && (stats.iConcealedFrames == 0),
+                  "reordered packets are not late or lost" );
+}
+
+static void checkLoss(ModelCheckReport& report)
+{
+    // The packet 2 is lost: the packet 3 is here when its turn comes.
+
+    JitterBufferCheckSpeaker speaker(true);
+
+    std::vector<int> vPlayed;
+
+    speaker.send(0, 0);
+    speaker.update();
+    vPlayed.push_back( speaker.play() );
+
+    speaker.send(1, 1);
+    vPlayed.push_back( speaker.play() );
+
+    speaker.send(3, 3);
+    vPlayed.push_back( speaker.play() );
+    vPlayed.push_back( speaker.play() );
+
+    speaker.send(4, 4);
+    vPlayed.push_back( speaker.play() );
+
+    JitterBufferStats stats = speaker.buffer.getStats();
+
+    report.check( formatPlayout(vPlayed) == "1 2 0 4 5",
+                  "a lost packet is concealed in its place (played: " + formatPlayout(vPlayed) + ")" );
+    report.check( (stats.iLostPackets == 1) && (stats.iConcealedFrames == 1) && (stats.iLatePackets == 0),
+                  "a lost packet is counted as lost (lost " + std::to_string(stats.iLostPackets) + ")" );
+}
+
+static void checkLate(ModelCheckReport& report)
+{
+    // Underrun: the packet 1 did not come in time, it's concealed and discarded when it comes.
+
+    JitterBufferCheckSpeaker speaker(true);
+
+    speaker.send(0, 0);
+    speaker.update();
+
+    std::vector<int> vPlayed;
+
+    vPlayed.push_back( speaker.play() );
+    vPlayed.push_back( speaker.play() );
+
+    speaker.send(1, 2);
+    speaker.send(2, 2);
+
+    vPlayed.push_back( speaker.play() );
+
+    JitterBufferStats stats = speaker.buffer.getStats();
+
+    report.check( formatPlayout(vPlayed) == "1 0 3",
+                  "a packet after its concealed frame is not played (played: " + formatPlayout(vPlayed) + ")" );
+    report.check( (stats.iLatePackets == 1) && (stats.iLostPackets == 0) && (stats.iConcealedFrames == 1),
+                  "a packet after its concealed frame is counted as late (late " + std::to_string(stats.iLatePackets) + ")" );
+}
+
+static void checkUnderrun(ModelCheckReport& report)
+{
+    // Without the sequence of the server the packets are numbered as they come:
+    // the packet after an underrun is the one after the concealed frame, not a late one.
+
+    JitterBufferCheckSpeaker speaker(false);
+
+    speaker.send(0, 0);
+    speaker.update();
+
+    std::vector<int> vPlayed;
+
+    vPlayed.push_back( speaker.play() );
+    vPlayed.push_back( speaker.play() );
+
+    speaker.send(1, 2);
+
+    vPlayed.push_back( speaker.play() );
+
+    JitterBufferStats stats = speaker.buffer.getStats();
+
+    report.check( formatPlayout(vPlayed) == "1 0 2",
+                  "the packet after an underrun is played (played: " + formatPlayout(vPlayed) + ")" );
+    report.check( stats.iLatePackets == 0, "the packet after an underrun is not late" );
+
+
+    // Underruns in a row stop the playout.
+
+    vPlayed.clear();
+
+    for (size_t i = 0;  i < JITTER_BUFFER_MAX_CONCEALED_FRAMES + 1;  i++)
+    {
+        vPlayed.push_back( speaker.play() );
+    }
+
+    report.check( (vPlayed.back() == -1) && (speaker.buffer.isPlaying() == false),
+                  "the playout stops after " + std::to_string(JITTER_BUFFER_MAX_CONCEALED_FRAMES) + " concealed frames in a row"
+                  " (played: " + formatPlayout(vPlayed) + ")" );
+
+
+    // The end of the talk: the short talk is played at once and then stops.
+
+    speaker.send(2, 10);
+    speaker.sendLast(10);
+    speaker.update();
+
+    bool bStarted = speaker.buffer.isPlaying();
+
+    vPlayed.clear();
+    vPlayed.push_back( speaker.play() );
+    vPlayed.push_back( speaker.play() );
+
+    report.check( bStarted && (formatPlayout(vPlayed) == "3 -1"),
+                  "the last packet starts the playout and stops it (played: " + formatPlayout(vPlayed) + ")" );
+}
+
+static void checkSequenceWrap(ModelCheckReport& report)
+{
+    report.check( (JitterBuffer::extendSequence(5, 3) == 5) && (JitterBuffer::extendSequence(1, 3) == 1),
+                  "extendSequence() near the expected one" );
+    report.check( JitterBuffer::extendSequence(2, 0xFFFEu) == 0x10002u,
+                  "extendSequence() after the 16-bit wrap" );
+    report.check( JitterBuffer::extendSequence(0xFFFEu, 0x10002u) == 0xFFFEu,
+                  "extendSequence() of a reordered packet before the 16-bit wrap" );
+    report.check( JitterBuffer::extendSequence(40000, 0) == 0u - (65536u - 40000u),
+                  "extendSequence() of the first packet far from the expected one keeps the offsets" );
+
+
+    // The 32-bit wrap in the buffer.
+
+    JitterBufferCheckSpeaker speaker(true);
+
+    speaker.send(0xFFFFFFFFu, 0);
+    speaker.send(1, 1);
+    speaker.send(0, 2);
+    speaker.update();
+
+    std::vector<int> vPlayed;
+
+    for (size_t i = 0;  i < 3;  i++)
+    {
+        vPlayed.push_back( speaker.play() );
+    }
+
+    report.check( formatPlayout(vPlayed) == "0 1 2",
+                  "packets around the 32-bit wrap are played in order (played: " + formatPlayout(vPlayed) + ")" );
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+void runJitterBufferChecks(ModelCheckReport& report)
+{
+    checkReorder      (report);
+    checkLoss         (report);
+    checkLate         (report);
+    checkUnderrun     (report);
+    checkSequenceWrap (report);
+}
@@ -0,0 +1,131 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+
+// STL
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Custom
+#include "Tools/ModelChecks/modelchecks.h"
+
+
+struct ModelCheckGroup
+{
+    const char*  pName;
+    const char*  pDescription;
+
+    void       (*pRun)(ModelCheckReport& report);
+};
+
+
+static const ModelCheckGroup vGroups[] =
+{
+    { "aes",      "AES: baseline known answers, ECB and SetKey() paths of every backend",          runAESChecks },
+    { "chatlog",  "ChatLog: the name table stays as big as the kept entries need",                 runChatLogChecks },
+    { "dsp",      "AudioDSP: SSE2 / AVX2 kernels against the scalar one, clipping, the tails",     runDSPChecks },
+    { "integer",  "ext/integer: limb_vector, multiply, divide, str() / parse, powmod()",           runIntegerChecks },
+    { "jitter",   "JitterBuffer: reorder, loss, late packets, the underrun, the sequence wrap",    runJitterBufferChecks },
+    { "tcpframe", "TCPFrameReader: cursor bounds, every message layout, the ring wrap",            runTCPFrameChecks },
+    { "timer",    "AudioTimer: deadline order, cancel, runNow, the capture cadence",               runAudioTimerChecks },
+    { "users",    "UserDirectory: add, remove, find, duplicates, 300 users against a map",         runUserDirectoryChecks },
+    { "vad",      "VoiceActivityDetector: speech missed and noise sent on the synthetic fixtures", runVADChecks },
+};
+
+
+static void printUsage()
+{
+    std::printf(
+        "Regression checks of the Silent model parts that don't need the sockets or the audio devices.\n"
+        "\n"
+        "Usage: SilentModelChecks [check...]\n"
+        "\n"
+        "Exit code: 0 - all passed, 1 - some failed, 2 - wrong arguments.\n"
+        "\n"
+        "Checks (all if none are given):\n");
+
+    for (size_t i = 0;  i < sizeof(vGroups) / sizeof(vGroups[0]);  i++)
+    {
+        std::printf("  %-19s %s\n", vGroups[i].pName, vGroups[i].pDescription);
+    }
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+int main(int argc, char* argv[])
+{
+    std::vector<const ModelCheckGroup*> vToRun;
+
+
+    for (int i = 1;  i < argc;  i++)
+    {
+        std::string sOption = argv[i];
+
+        if ( (sOption == "--help") || (sOption == "-h") )
+        {
+            printUsage();
+
+            return 0;
+        }
+
+
+        const ModelCheckGroup* pGroup = nullptr;
+
+        for (size_t k = 0;  k < sizeof(vGroups) / sizeof(vGroups[0]);  k++)
+        {
+            if (sOption == vGroups[k].pName)
+            {
+                pGroup = &vGroups[k];
+            }
+        }
+
+        if (pGroup == nullptr)
+        {
+            std::printf("Unknown check: %s\n\n", sOption.c_str());
+
+            printUsage();
+
+            return 2;
+        }
+
+        vToRun.push_back(pGroup);
+    }
+
+
+    if (vToRun.empty())
+    {
+        for (size_t i = 0;  i < sizeof(vGroups) / sizeof(vGroups[0]);  i++)
+        {
+            vToRun.push_back(&vGroups[i]);
+        }
+    }
+
+
+    size_t iFailedCount = 0;
+
+    for (size_t i = 0;  i < vToRun.size();  i++)
+    {
+        std::printf("%s:\n", vToRun[i]->pName);
+
+        ModelCheckReport report;
+
+        vToRun[i]->pRun(report);
+
+        std::printf("    %zu passed, %zu failed, %zu skipped\n", report.getPassedCount(), report.getFailedCount(), report.getSkippedCount());
+
+        iFailedCount += report.getFailedCount();
+    }
+
+
+    std::printf( "\n%s\n", (iFailedCount == 0) ? "OK" : "FAILED" );
+
+    return (iFailedCount == 0) ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "modelchecks.h"
+
+
+// STL
+#include <cstdio>
+#include <cstring>
+
+
+static void printHex(const char* pName, const unsigned char* pBytes, size_t iSize)
+{
+    std::printf("      %s: ", pName);
+
+    for (size_t i = 0;  i < iSize;  i++)
+    {
+        std::printf("%02x", pBytes[i]);
+    }
+
+    std::printf("\n");
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+ModelCheckReport::ModelCheckReport()
+{
+    iPassedCount  = 0;
+    iFailedCount  = 0;
+    iSkippedCount = 0;
+}
+
+bool ModelCheckReport::check(bool bPassed, const std::string& sWhat)
+{
+    if (bPassed)
+    {
+        iPassedCount++;
+
+        return false;
+    }
+
+
+    iFailedCount++;
+
+    std::printf("    FAILED: %s\n", sWhat.c_str());
+
+    return true;
+}
+
+bool ModelCheckReport::checkBytes(const unsigned char* pExpected, const unsigned char* pActual, size_t iSize, const std::string& sWhat)
+{
+    if ( check(std::memcmp(pExpected, pActual, iSize) == 0, sWhat) )
+    {
+        printHex("expected", pExpected, iSize);
+        printHex("actual  ", pActual,   iSize);
+
+        return true;
+    }
+
+    return false;
+}
+
+void ModelCheckReport::skip(const std::string& sWhat)
+{
+    iSkippedCount++;
+
+    std::printf("    skipped: %s\n", sWhat.c_str());
+}
+
+size_t ModelCheckReport::getPassedCount() const
+{
+    return iPassedCount;
+}
+
+size_t ModelCheckReport::getFailedCount() const
+{
+    return iFailedCount;
+}
+
+size_t ModelCheckReport::getSkippedCount() const
+{
+    return iSkippedCount;
+}
@@ -0,0 +1,89 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <string>
+#include <cstddef>
+
+
+// Counts the checks of one group and prints the failed ones.
+class ModelCheckReport
+{
+
+public:
+
+    ModelCheckReport();
+
+
+    // Returns true if the check failed ('bPassed' is false), 'sWhat' is printed then.
+
+        bool    check            (bool bPassed, const std::string& sWhat);
+
+
+    // Same as check() for the byte buffers (the hex of both is printed if they differ).
+
+        bool    checkBytes       (const unsigned char* pExpected, const unsigned char* pActual, size_t iSize, const std::string& sWhat);
+
+
+    // A check that can't run here (not supported by the CPU and such), printed but not failed.
+
+        void    skip             (const std::string& sWhat);
+
+
+    // GET functions
+
+        size_t  getPassedCount   () const;
+        size_t  getFailedCount   () const;
+        size_t  getSkippedCount  () const;
+
+private:
+
+    size_t  iPassedCount;
+    size_t  iFailedCount;
+    size_t  iSkippedCount;
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Regression checks of the portable model parts (no sockets, no audio devices), one function per group.
+
+// AES: known answers of the baseline class for the ECB and the SetKey() paths of every backend.
+void runAESChecks(ModelCheckReport& report);
+
+// AudioTimer: deadline order, cancel(), runNow() of pending / running tasks, the capture cadence across the talk ends.
+void runAudioTimerChecks(ModelCheckReport& report);
+
+// ChatLog: the names of the dropped entries are removed (overwrite, setCapacity(), clear()), the kept entries keep theirs.
+void runChatLogChecks(ModelCheckReport& report);
+
+// AudioDSP: the SSE2 / AVX2 kernels give the samples and the peaks of the scalar one (the RMS within the float rounding)
+// on random, clipped and +-32768 input, gains 0 - 4, every tail length.
+void runDSPChecks(ModelCheckReport& report);
+
+// ext/integer: limb_vector, schoolbook multiply, Knuth's division (with the add back step), str() / parse of 64 - 4096 bits,
+// powmod() against pow() on random 32-bit values.
+void runIntegerChecks(ModelCheckReport& report);
+
+// JitterBuffer: reordered, lost and late packets, the underrun with and without the sequence of the server, the sequence wrap.
+void runJitterBufferChecks(ModelCheckReport& report);
+
+// TCPFrameReader: TCPFrameCursor bounds, getFrameSize() of every message layout (whole and partial), messages wrapped around the ring.
+void runTCPFrameChecks(ModelCheckReport& report);
+
+// UserDirectory: add() / remove() / find() / findBySpeakerId(), a duplicate name is refused,
+// random steps on 300 users agree with a map.
+void runUserDirectoryChecks(ModelCheckReport& report);
+
+// VoiceActivityDetector on the synthetic fixtures (see VoiceFixtures): misses no more of the speech than the old peak rule,
+// with the noise gating does not send the steady noise and most of the keyboard clicks.
+void runVADChecks(ModelCheckReport& report);
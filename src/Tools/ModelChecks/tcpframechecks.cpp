@@ -0,0 +1,319 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "modelchecks.h"
+
+
+// STL
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Custom
+#include "Model/TCPFrameReader/tcpframereader.h"
+#include "Model/net_messages.h"
+
+
+// Messages in the stream of the ring check and the largest sized field in it.
+#define  TCP_FRAME_CHECKS_STREAM_MESSAGES   3000
+#define  TCP_FRAME_CHECKS_LARGE_PERCENT     3
+
+
+struct TCPFrameLayout
+{
+    const char*    pName;
+    unsigned char  cType;
+
+    // Fields after the type: 'n' - 1 byte size + data, 'N' - 2 byte size + data, '1' / '4' - 1 / 4 bytes.
+    const char*    pFields;
+};
+
+
+static const TCPFrameLayout vLayouts[] =
+{
+    { "SM_NEW_USER",              SM_NEW_USER,              "n"   },
+    { "SM_SOMEONE_DISCONNECTED",  SM_SOMEONE_DISCONNECTED,  "1n"  },
+    { "SM_CAN_START_UDP",         SM_CAN_START_UDP,         ""    },
+    { "SM_SPAM_NOTICE",           SM_SPAM_NOTICE,           ""    },
+    { "SM_PING",                  SM_PING,                  "N"   },
+    { "SM_KEEPALIVE",             SM_KEEPALIVE,             ""    },
+    { "SM_USERMESSAGE",           SM_USERMESSAGE,           "N"   },
+    { "SM_KICKED",                SM_KICKED,                ""    },
+    { "SM_WRONG_PASSWORD_WAIT",   SM_WRONG_PASSWORD_WAIT,   ""    },
+    { "SM_GLOBAL_MESSAGE",        SM_GLOBAL_MESSAGE,        "N"   },
+    { "SM_VOICE_FEATURES",        SM_VOICE_FEATURES,        "1"   },
+    { "SM_SPEAKER_IDS",           SM_SPEAKER_IDS,           "N"   },
+    { "RC_CAN_ENTER_ROOM",        RC_CAN_ENTER_ROOM,        "nN"  },
+    { "RC_ROOM_IS_FULL",          RC_ROOM_IS_FULL,          ""    },
+    { "RC_PASSWORD_REQ",          RC_PASSWORD_REQ,          "n"   },
+    { "RC_WRONG_PASSWORD",        RC_WRONG_PASSWORD,        ""    },
+    { "RC_USER_ENTERS_ROOM",      RC_USER_ENTERS_ROOM,      "nn"  },
+    { "RC_SERVER_MOVED_ROOM",     RC_SERVER_MOVED_ROOM,     "n1"  },
+    { "RC_SERVER_DELETES_ROOM",   RC_SERVER_DELETES_ROOM,   "n"   },
+    { "RC_SERVER_CREATES_ROOM",   RC_SERVER_CREATES_ROOM,   "n4"  },
+    { "RC_SERVER_CHANGES_ROOM",   RC_SERVER_CHANGES_ROOM,   "nn4" },
+};
+
+
+// Sizes of the sized fields in a message.
+enum TCP_FRAME_FIELD_SIZES
+{
+    TFFS_EMPTY      = 0,
+    TFFS_SMALL      = 1,
+    TFFS_LARGEST    = 2,
+    TFFS_RANDOM     = 3
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+static std::vector<char> buildMessage(const TCPFrameLayout& layout, TCP_FRAME_FIELD_SIZES sizes, std::mt19937& rndGen)
+{
+    std::vector<char> vMessage;
+    vMessage.push_back( static_cast<char>(layout.cType) );
+
+    for (size_t i = 0;  layout.pFields[i] != 0;  i++)
+    {
+        char cField = layout.pFields[i];
+
+        if ( (cField == '1') || (cField == '4') )
+        {
+            for (int k = 0;  k < cField - '0';  k++)
+            {
+                vMessage.push_back( static_cast<char>(rndGen()) );
+            }
+
+            continue;
+        }
+
+
+        size_t iMaxSize = (cField == 'n') ? 255 : 65535;
+        size_t iSize    = 0;
+
+        switch (sizes)
+        {
+        case(TFFS_EMPTY):   iSize = 0;                                  break;
+        case(TFFS_SMALL):   iSize = 1;                                  break;
+        case(TFFS_LARGEST): iSize = iMaxSize;                           break;
+        case(TFFS_RANDOM):  iSize = rndGen() % ( std::min(iMaxSize, static_cast<size_t>(2000)) + 1 ); break;
+        }
+
+        if (cField == 'n')
+        {
+            vMessage.push_back( static_cast<char>(iSize) );
+        }
+        else
+        {
+            unsigned short iSize16 = static_cast<unsigned short>(iSize);
+
+            char vSize[sizeof(iSize16)];
+            std::memcpy(vSize, &iSize16, sizeof(iSize16));
+
+            vMessage.insert(vMessage.end(), vSize, vSize + sizeof(vSize));
+        }
+
+        for (size_t k = 0;  k < iSize;  k++)
+        {
+            vMessage.push_back( static_cast<char>(rndGen()) );
+        }
+    }
+
+
+    return vMessage;
+}
+
+static void checkCursor(ModelCheckReport& report)
+{
+    const char vData[] = { 1, 2, 0, 3, 0, 0, 0, 'a', 'b', 'c' };
+
+    TCPFrameCursor cursor(vData, sizeof(vData));
+
+    unsigned char  cValue  = 0;
+    unsigned short iValue  = 0;
+    unsigned int   iValue4 = 0;
+
+    report.check( (cursor.readU8(cValue) == false) && (cValue == 1), "TCPFrameCursor: readU8()" );
+    report.check( (cursor.readU16(iValue) == false) && (iValue == 2), "TCPFrameCursor: readU16()" );
+    report.check( (cursor.readU32(iValue4) == false) && (iValue4 == 3), "TCPFrameCursor: readU32()" );
+
+
+    char vString[3] = { 'x', 'x', 'x' };
+
+    report.check( (cursor.readString(vString, sizeof(vString), 3) == false) && (std::strcmp(vString, "ab") == 0) && (cursor.getRemaining() == 0),
+                  "TCPFrameCursor: readString() cuts to the output size and skips the rest" );
+
+
+    iValue4 = 7;
+
+    report.check( cursor.readU32(iValue4) && (iValue4 == 7), "TCPFrameCursor: read past the end fails and keeps the output" );
+    report.check( (cursor.readSpan(0) != nullptr) && (cursor.readSpan(1) == nullptr) && cursor.skip(1), "TCPFrameCursor: readSpan() and skip() at the end" );
+
+
+    TCPFrameCursor shortCursor(vData, 3);
+
+    report.check( shortCursor.skip(1) == false && shortCursor.readU32(iValue4) && (shortCursor.getRemaining() == 2),
+                  "TCPFrameCursor: a failed read does not move the position" );
+
+    report.check( shortCursor.skip(static_cast<size_t>(-1)) && (shortCursor.getRemaining() == 2), "TCPFrameCursor: a huge count does not overflow" );
+}
+
+static void checkLayouts(ModelCheckReport& report, std::mt19937& rndGen)
+{
+    for (size_t i = 0;  i < sizeof(vLayouts) / sizeof(vLayouts[0]);  i++)
+    {
+        const TCPFrameLayout& layout = vLayouts[i];
+
+        const TCP_FRAME_FIELD_SIZES vSizes[] = { TFFS_EMPTY, TFFS_SMALL, TFFS_LARGEST, TFFS_RANDOM };
+
+        bool bWhole    = true;
+        bool bTrailing = true;
+        bool bPartial  = true;
+
+        for (size_t k = 0;  k < sizeof(vSizes) / sizeof(vSizes[0]);  k++)
+        {
+            std::vector<char> vMessage = buildMessage(layout, vSizes[k], rndGen);
+
+            bWhole = bWhole && (TCPFrameReader::getFrameSize(vMessage.data(), vMessage.size()) == vMessage.size());
+
+
+            // The next message starts right after it.
+
+            std::vector<char> vStream = vMessage;
+            vStream.push_back(SM_KEEPALIVE);
+            vStream.push_back(SM_PING);
+
+            bTrailing = bTrailing && (TCPFrameReader::getFrameSize(vStream.data(), vStream.size()) == vMessage.size());
+
+
+            for (size_t iSize = 0;  bPartial && (iSize < vMessage.size());  iSize++)
+            {
+                bPartial = (TCPFrameReader::getFrameSize(vMessage.data(), iSize) == 0);
+            }
+        }
+
+        std::string sName = std::string("getFrameSize(), ") + layout.pName;
+
+        report.check(bWhole,    sName + ": whole message");
+        report.check(bTrailing, sName + ": followed by the next message");
+        report.check(bPartial,  sName + ": every partial message needs more data");
+    }
+
+
+    // RC_CAN_ENTER_ROOM with the longest name and message is the largest possible one.
+
+    std::vector<char> vLargest = buildMessage(vLayouts[12], TFFS_LARGEST, rndGen);
+
+    report.check( (vLargest.size() == TCP_FRAME_MAX_SIZE) && (TCPFrameReader::getFrameSize(vLargest.data(), vLargest.size()) == TCP_FRAME_MAX_SIZE),
+                  "getFrameSize(), the largest message is TCP_FRAME_MAX_SIZE" );
+}
+
+static void checkRing(ModelCheckReport& report, std::mt19937& rndGen)
+{
+    // A long stream of messages (some as large as possible) received in random chunks:
+    // each message should come out whole even if it wraps around the end of the ring.
+
+    std::vector<char>   vStream;
+    std::vector<size_t> vMessageEnds;
+
+    for (size_t i = 0;  i < TCP_FRAME_CHECKS_STREAM_MESSAGES;  i++)
+    {
+        const TCPFrameLayout& layout = vLayouts[ rndGen() % (sizeof(vLayouts) / sizeof(vLayouts[0])) ];
+
+        TCP_FRAME_FIELD_SIZES sizes = (rndGen() % 100 < TCP_FRAME_CHECKS_LARGE_PERCENT) ? TFFS_LARGEST : TFFS_RANDOM;
+
+        std::vector<char> vMessage = buildMessage(layout, sizes, rndGen);
+
+        vStream.insert(vStream.end(), vMessage.begin(), vMessage.end());
+        vMessageEnds.push_back(vStream.size());
+    }
+
+
+    TCPFrameReader* pReader = new TCPFrameReader();
+
+    size_t iSent         = 0;
+    size_t iMessageCount = 0;
+    size_t iMessageStart = 0;
+    size_t iRingStart    = 0;   // stream offset of the ring position 0 (the ring starts over when it's empty)
+    size_t iWrapCount    = 0;
+    bool   bMatches      = true;
+
+    while ( bMatches && (iMessageCount < vMessageEnds.size()) )
+    {
+        char*  pFirst      = nullptr;
+        char*  pSecond     = nullptr;
+        size_t iFirstSize  = 0;
+        size_t iSecondSize = 0;
+
+        pReader->getFreeSpace(pFirst, iFirstSize, pSecond, iSecondSize);
+
+
+        // Like a recv() of any size.
+
+        size_t iChunk = std::min( static_cast<size_t>(1 + rndGen() % 70000), std::min(iFirstSize + iSecondSize, vStream.size() - iSent) );
+
+        size_t iToFirst  = std::min(iChunk, iFirstSize);
+
+        std::memcpy(pFirst, vStream.data() + iSent, iToFirst);
+        std::memcpy(pSecond, vStream.data() + iSent + iToFirst, iChunk - iToFirst);
+
+        pReader->commitReceived(iChunk);
+
+        iSent += iChunk;
+
+
+        TCPFrameCursor frame;
+
+        while ( bMatches && pReader->getFrame(frame) )
+        {
+            size_t iSize = vMessageEnds[iMessageCount] - iMessageStart;
+
+            const char* pFrame = frame.readSpan(frame.getRemaining());
+
+            bMatches = (pFrame != nullptr) && (vMessageEnds[iMessageCount] <= iSent)
+                       && (std::memcmp(pFrame, vStream.data() + iMessageStart, iSize) == 0) && (frame.getRemaining() == 0);
+
+            if ( ((iMessageStart - iRingStart) % TCP_FRAME_READER_CAPACITY) + iSize > TCP_FRAME_READER_CAPACITY )
+            {
+                iWrapCount++;
+            }
+
+            pReader->popFrame();
+
+            iMessageStart = vMessageEnds[iMessageCount];
+            iMessageCount++;
+
+            if (iMessageStart == iSent)
+            {
+                iRingStart = iSent;
+            }
+        }
+    }
+
+    delete pReader;
+
+
+    report.check( bMatches && (iMessageCount == vMessageEnds.size()), "TCPFrameReader: a stream in random chunks comes out as the same messages" );
+    report.check( iWrapCount > 0, "TCPFrameReader: some of them wrapped around the end of the ring (mirrored tail), " + std::to_string(iWrapCount) + " messages" );
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+void runTCPFrameChecks(ModelCheckReport& report)
+{
+    std::mt19937 rndGen(51337);
+
+    checkCursor  (report);
+    checkLayouts (report, rndGen);
+    checkRing    (report, rndGen);
+}
@@ -0,0 +1,197 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "modelchecks.h"
+
+
+// STL
+#include <deque>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+// Custom
+#include "Model/User.h"
+#include "Model/UserDirectory/userdirectory.h"
+
+
+// Users of the consistency check (and the random add / remove steps on them).
+#define  USER_DIRECTORY_CHECKS_USER_COUNT   300
+#define  USER_DIRECTORY_CHECKS_STEP_COUNT   20000
+
+
+static std::string getUserName(size_t iUser)
+{
+    return "user" + std::to_string(iUser);
+}
+
+// Every user is found by its name and by its speaker id, the list has no other users.
+static bool isConsistent(const UserDirectory& directory, const std::map<std::string, User*>& mapExpected)
+{
+    if (directory.size() != mapExpected.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0;  i < directory.size();  i++)
+    {
+        User* pUser = directory.get(i);
+
+        auto it = mapExpected.find(pUser->sUserName);
+
+        if ( (it == mapExpected.end()) || (it->second != pUser) || (directory.find(pUser->sUserName) != pUser) )
+        {
+            return false;
+        }
+
+        if ( (pUser->iSpeakerId >= 0) && (directory.findBySpeakerId( static_cast<unsigned short>(pUser->iSpeakerId) ) != pUser) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void checkAddFindRemove(ModelCheckReport& report)
+{
+    UserDirectory directory;
+
+    User first (getUserName(0), 0, nullptr);
+    User second(getUserName(1), 0, nullptr);
+    User third (getUserName(2), 0, nullptr);
+
+    report.check( directory.add(&first) && directory.add(&second) && directory.add(&third) && (directory.size() == 3),
+                  "add() of new names" );
+    report.check( (directory.find(getUserName(1)) == &second) && (directory.find("nobody") == nullptr),
+                  "find() of an added name and of a missing name" );
+
+    report.check( (directory.remove(getUserName(0)) == &first) && (directory.size() == 2) && (directory.find(getUserName(0)) == nullptr),
+                  "remove() returns the user" );
+    report.check( (directory.find(getUserName(1)) == &second) && (directory.find(getUserName(2)) == &third),
+                  "the user moved to the freed place is still found" );
+    report.check( directory.remove(getUserName(0)) == nullptr, "remove() of a missing name" );
+
+
+    // Duplicate.
+
+    User duplicate(getUserName(1), 0, nullptr);
+
+    report.check( (directory.add(&duplicate) == false) && (directory.size() == 2) && (directory.find(getUserName(1)) == &second),
+                  "add() of a name that is already there is refused" );
+
+    directory.remove(getUserName(1));
+    directory.remove(getUserName(2));
+
+    report.check( directory.size() == 0, "no user is left after the refused duplicate is removed" );
+
+
+    // Speaker ids.
+
+    directory.add(&first);
+    directory.add(&second);
+
+    directory.setSpeakerId(&first, 7);
+
+    report.check( (directory.findBySpeakerId(7) == &first) && (directory.findBySpeakerId(6) == nullptr) && (directory.findBySpeakerId(1000) == nullptr),
+                  "findBySpeakerId() of an assigned, a free and a too large id" );
+
+    directory.setSpeakerId(&second, 7);
+
+    report.check( (directory.findBySpeakerId(7) == &second) && (first.iSpeakerId == -1), "the previous user of a reassigned id loses it" );
+
+    directory.remove(getUserName(1));
+
+    report.check( directory.findBySpeakerId(7) == nullptr, "remove() frees the speaker id" );
+}
+
+static void checkConsistency(ModelCheckReport& report)
+{
+    // Random add / remove / setSpeakerId of 300 users against a map.
+
+    std::deque<User> vUsers;
+
+    for (size_t i = 0;  i < USER_DIRECTORY_CHECKS_USER_COUNT;  i++)
+    {
+        vUsers.emplace_back(getUserName(i), 0, nullptr);
+    }
+
+    UserDirectory directory;
+    std::map<std::string, User*> mapExpected;
+
+    std::mt19937 rndGen(13013);
+    std::uniform_int_distribution<size_t> userDistribution(0, USER_DIRECTORY_CHECKS_USER_COUNT - 1);
+    std::uniform_int_distribution<int>    stepDistribution(0, 3);
+
+    bool bConsistent = true;
+
+    for (size_t iStep = 0;  (iStep < USER_DIRECTORY_CHECKS_STEP_COUNT) && bConsistent;  iStep++)
+    {
+        User* pUser = &vUsers[ userDistribution(rndGen) ];
+
+        bool  bIn   = mapExpected.count(pUser->sUserName) != 0;
+
+        switch (stepDistribution(rndGen))
+        {
+        case 0:
+        case 1:
+        {
+            if (directory.add(pUser) == bIn)
+            {
+                bConsistent = false;
+            }
+
+            mapExpected[pUser->sUserName] = pUser;
+
+            break;
+        }
+        case 2:
+        {
+            if (directory.remove(pUser->sUserName) != (bIn ? pUser : nullptr))
+            {
+                bConsistent = false;
+            }
+
+            if (bIn)
+            {
+                // Not in the directory - no speaker id (like a new User).
+                pUser->iSpeakerId = -1;
+            }
+
+            mapExpected.erase(pUser->sUserName);
+
+            break;
+        }
+        default:
+        {
+            if (bIn)
+            {
+                directory.setSpeakerId( pUser, static_cast<unsigned short>(userDistribution(rndGen)) );
+            }
+
+            break;
+        }
+        }
+
+        bConsistent = bConsistent && isConsistent(directory, mapExpected);
+    }
+
+    report.check( bConsistent, "add() / remove() / find() / setSpeakerId() of " + std::to_string(USER_DIRECTORY_CHECKS_USER_COUNT)
+                               + " users agree with a map after every random step" );
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+void runUserDirectoryChecks(ModelCheckReport& report)
+{
+    checkAddFindRemove (report);
+    checkConsistency   (report);
+}
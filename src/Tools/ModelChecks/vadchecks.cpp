@@ -0,0 +1,95 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "modelchecks.h"
+
+
+// STL
+#include <cstdio>
+#include <string>
+
+// Custom
+#include "Tools/VoiceFixtures/voicefixtures.h"
+
+
+// Length and seeds of the synthetic fixtures (other than the ones of SilentModelBench).
+#define  VAD_CHECKS_FIXTURE_SECONDS        60
+#define  VAD_CHECKS_FIRST_SEED             200
+#define  VAD_CHECKS_SEED_COUNT             5
+
+// The noise gating may miss this much more of the speech than the old rule (percentage points, quiet word onsets in loud noise).
+#define  VAD_CHECKS_GATED_MISSED_MARGIN    2.5
+
+// Steady noise sent with the noise gating (percents).
+#define  VAD_CHECKS_GATED_MAX_STEADY_NOISE 1.0
+
+
+
+static std::string describe(VOICE_FIXTURE_NOISE noise, unsigned int iSeed, const char* pWhat, double dActual, double dLimit)
+{
+    char vBuffer[200];
+
+    std::snprintf(vBuffer, sizeof(vBuffer), "%s (seed %u): %s %.1f%% (limit %.1f%%)", getVoiceFixtureName(noise), iSeed, pWhat, dActual, dLimit);
+
+    return vBuffer;
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+void runVADChecks(ModelCheckReport& report)
+{
+    for (int iNoise = 0;  iNoise < VFN_COUNT;  iNoise++)
+    {
+        for (unsigned int iSeed = VAD_CHECKS_FIRST_SEED;  iSeed < VAD_CHECKS_FIRST_SEED + VAD_CHECKS_SEED_COUNT;  iSeed++)
+        {
+            VOICE_FIXTURE_NOISE noise = static_cast<VOICE_FIXTURE_NOISE>(iNoise);
+
+            VoiceFixture fixture = makeVoiceFixture(noise, iSeed, VAD_CHECKS_FIXTURE_SECONDS);
+
+            VoiceDetectionScore oldScore   = scoreOldVoiceActivation    (fixture, VOICE_FIXTURE_START_DBFS);
+            VoiceDetectionScore peakScore  = scoreVoiceActivityDetector (fixture, VOICE_FIXTURE_START_DBFS, false);
+            VoiceDetectionScore gatedScore = scoreVoiceActivityDetector (fixture, VOICE_FIXTURE_START_DBFS, true);
+
+            double dOldMissed   = getMissedSpeechPercent(oldScore);
+            double dPeakMissed  = getMissedSpeechPercent(peakScore);
+            double dGatedMissed = getMissedSpeechPercent(gatedScore);
+
+            double dOldSent     = getSentNoisePercent(oldScore);
+            double dGatedSent   = getSentNoisePercent(gatedScore);
+
+
+            // The default never misses more of the speech than the old rule.
+
+            report.check( dPeakMissed <= dOldMissed, describe(noise, iSeed, "speech missed by default", dPeakMissed, dOldMissed) );
+
+
+            // The noise gating: a bit more of the speech may be missed, the noise should go.
+
+            report.check( dGatedMissed <= dOldMissed + VAD_CHECKS_GATED_MISSED_MARGIN,
+                          describe(noise, iSeed, "speech missed with the noise gating", dGatedMissed, dOldMissed + VAD_CHECKS_GATED_MISSED_MARGIN) );
+
+            if ( (noise == VFN_FAN) || (noise == VFN_MAINS_HUM) )
+            {
+                report.check( dGatedSent <= VAD_CHECKS_GATED_MAX_STEADY_NOISE,
+                              describe(noise, iSeed, "noise sent with the noise gating", dGatedSent, VAD_CHECKS_GATED_MAX_STEADY_NOISE) );
+            }
+            else if (noise == VFN_KEYBOARD)
+            {
+                report.check( dGatedSent <= dOldSent / 2,
+                              describe(noise, iSeed, "clicks sent with the noise gating", dGatedSent, dOldSent / 2) );
+            }
+            else
+            {
+                report.check( dGatedSent <= dOldSent,
+                              describe(noise, iSeed, "noise sent with the noise gating", dGatedSent, dOldSent) );
+            }
+        }
+    }
+}
@@ -0,0 +1,148 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+
+// STL
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+// Custom
+#include "Model/TCPFrameReader/tcpframereader.h"
+
+
+// libFuzzer entry point for the TCP message framing (ide/SilentTCPFrameFuzz.pro, clang with -fsanitize=fuzzer,address).
+// The input is what the server sent: the first 2 bytes seed the sizes of the recv() chunks, the rest is the TCP stream.
+// Aborts if a frame is not what getFrameSize() promised or if the reader stalls with a full ring.
+
+
+// Picks the next recv() size like the sizes of the real TCP segments: mostly small, sometimes the whole free space.
+static size_t getNextChunkSize(uint32_t& iState, size_t iFree)
+{
+    iState = iState * 1664525u + 1013904223u;
+
+    size_t iSize = ( (iState >> 28) == 0 ) ? iFree : 1 + (iState >> 8) % 1500;
+
+    return std::min(iSize, iFree);
+}
+
+// Same checks for any message start.
+static void checkFrameSize(const char* pData, size_t iAvailable)
+{
+    size_t iSize = TCPFrameReader::getFrameSize(pData, iAvailable);
+
+    if (iSize == 0)
+    {
+        if (iAvailable >= TCP_FRAME_MAX_SIZE)
+        {
+            // Any message fits into TCP_FRAME_MAX_SIZE.
+            std::abort();
+        }
+
+        return;
+    }
+
+    if ( (iSize > iAvailable) || (iSize > TCP_FRAME_MAX_SIZE)
+         || (TCPFrameReader::getFrameSize(pData, iSize) != iSize)
+         || (TCPFrameReader::getFrameSize(pData, iSize - 1) != 0) )
+    {
+        std::abort();
+    }
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* pData, size_t iSize)
+{
+    if (iSize < 2)
+    {
+        return 0;
+    }
+
+    uint32_t iChunkState = static_cast<uint32_t>(pData[0]) | (static_cast<uint32_t>(pData[1]) << 8);
+
+    const char* pStream     = reinterpret_cast<const char*>(pData + 2);
+    size_t      iStreamSize = iSize - 2;
+
+
+    // One reader for all inputs (like the one of the NetworkService for all connections).
+    static TCPFrameReader* pReader = new TCPFrameReader();
+
+    pReader->reset();
+
+
+    size_t iSent     = 0;
+    size_t iReceived = 0;   // in whole frames
+
+    while (iSent < iStreamSize)
+    {
+        char*  pFirst      = nullptr;
+        char*  pSecond     = nullptr;
+        size_t iFirstSize  = 0;
+        size_t iSecondSize = 0;
+
+        pReader->getFreeSpace(pFirst, iFirstSize, pSecond, iSecondSize);
+
+        if (iFirstSize + iSecondSize == 0)
+        {
+            // The ring is full of one incomplete message.
+            std::abort();
+        }
+
+
+        size_t iChunk   = std::min( getNextChunkSize(iChunkState, iFirstSize + iSecondSize), iStreamSize - iSent );
+        size_t iToFirst = std::min(iChunk, iFirstSize);
+
+        std::memcpy(pFirst, pStream + iSent, iToFirst);
+        std::memcpy(pSecond, pStream + iSent + iToFirst, iChunk - iToFirst);
+
+        pReader->commitReceived(iChunk);
+
+        iSent += iChunk;
+
+
+        TCPFrameCursor frame;
+
+        while ( pReader->getFrame(frame) )
+        {
+            size_t      iFrameSize = frame.getRemaining();
+            const char* pFrame     = frame.readSpan(iFrameSize);
+
+            // The frame is contiguous (even if it wrapped around the ring) and is the stream as sent.
+            if ( (pFrame == nullptr) || (iReceived + iFrameSize > iSent) || (std::memcmp(pFrame, pStream + iReceived, iFrameSize) != 0) )
+            {
+                std::abort();
+            }
+
+            checkFrameSize(pFrame, iFrameSize);
+
+            iReceived += iFrameSize;
+
+            pReader->popFrame();
+        }
+    }
+
+
+    // Whatever is left is one incomplete message.
+
+    if (iReceived < iStreamSize)
+    {
+        checkFrameSize(pStream + iReceived, iStreamSize - iReceived);
+
+        if ( TCPFrameReader::getFrameSize(pStream + iReceived, iStreamSize - iReceived) != 0 )
+        {
+            std::abort();
+        }
+    }
+
+
+    return 0;
+}
@@ -0,0 +1,329 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "voicefixtures.h"
+
+
+// STL
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+// Custom
+#include "Model/AudioDSP/audiodsp.h"
+#include "Model/VoiceActivityDetector/voiceactivitydetector.h"
+
+
+// Peak of the words (the loudest word, others are 40 - 100% of it).
+#define  VOICE_FIXTURE_SPEECH_DBFS     -4.0f
+
+// A frame is speech if more than 1 / VOICE_FIXTURE_SPEECH_PART of it is.
+#define  VOICE_FIXTURE_SPEECH_PART     5
+
+// Frames after the speech that are neither speech nor noise (the hangover may send them).
+#define  VOICE_FIXTURE_AFTER_SPEECH    9
+
+
+static const double dPi = 3.14159265358979;
+
+
+static float dbToAmplitude(float fDBFS)
+{
+    return std::pow(10.0f, fDBFS / 20.0f) * 32767.0f;
+}
+
+// Phrases of 2 - 7 words with 1 - 3.5 s pauses, from the first second to 3 seconds before the end.
+static void addSpeech(std::vector<float>& vSignal, std::vector<char>& vSpeech, std::mt19937& rndGen)
+{
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    std::normal_distribution<float>       gauss(0.0f, 1.0f);
+
+    const size_t iRate      = VOICE_FIXTURE_SAMPLE_RATE;
+    const float  fAmplitude = dbToAmplitude(VOICE_FIXTURE_SPEECH_DBFS) / 1.6f;
+
+    size_t iTime = iRate;
+
+    while (iTime + iRate * 3 < vSignal.size())
+    {
+        unsigned int iWords = 2 + rndGen() % 6;
+
+        for (unsigned int iWord = 0;  iWord < iWords;  iWord++)
+        {
+            size_t iVoicedLength = static_cast<size_t>( iRate * (0.25f + uniform(rndGen) * 0.9f) );
+            float  fPitch        = 100.0f + uniform(rndGen) * 120.0f;
+            float  fLevel        = fAmplitude * (0.4f + 0.6f * uniform(rndGen));
+
+            // 40% of the words start with 70 ms of a fricative (high-passed noise).
+            size_t iFricativeLength = (uniform(rndGen) < 0.4f) ? static_cast<size_t>(iRate * 0.07) : 0;
+
+            float  fPhase        = 0.0f;
+            float  fHighPass     = 0.0f;
+            float  fPrevNoise    = 0.0f;
+
+            for (size_t i = 0;  (i < iFricativeLength + iVoicedLength) && (iTime + i < vSignal.size());  i++)
+            {
+                float fValue = 0.0f;
+
+                if (i < iFricativeLength)
+                {
+                    float fNoise = gauss(rndGen);
+
+                    fHighPass  = 0.6f * (fHighPass + fNoise - fPrevNoise);
+                    fPrevNoise = fNoise;
+
+                    fValue = fHighPass * fLevel * 0.25f;
+                }
+                else
+                {
+                    // 12 harmonics, the word envelope and 4.5 Hz syllables, a bit of the pitch glide.
+                    size_t k = i - iFricativeLength;
+
+                    float fEnvelope = static_cast<float>( std::sin(dPi * k / iVoicedLength) );
+                    fEnvelope *= 0.55f + 0.45f * static_cast<float>( std::sin(2 * dPi * 4.5 * k / iRate) );
+
+                    float fFrequency = fPitch * ( 1.0f + 0.1f * static_cast<float>(std::sin(2 * dPi * k / iVoicedLength)) );
+                    fPhase += static_cast<float>(2 * dPi * fFrequency / iRate);
+
+                    if (fPhase > 2 * dPi)
+                    {
+                        fPhase -= static_cast<float>(2 * dPi);
+                    }
+
+                    for (int iHarmonic = 1;  iHarmonic <= 12;  iHarmonic++)
+                    {
+                        fValue += std::sin(fPhase * iHarmonic) / iHarmonic;
+                    }
+
+                    fValue *= fEnvelope * fLevel;
+                }
+
+                vSignal[iTime + i] += fValue;
+                vSpeech[iTime + i]  = 1;
+            }
+
+            iTime += iFricativeLength + iVoicedLength + static_cast<size_t>( iRate * (0.05f + uniform(rndGen) * 0.25f) );
+        }
+
+        iTime += static_cast<size_t>( iRate * (1.0f + uniform(rndGen) * 2.5f) );
+    }
+}
+
+// Fills 'score' from the decisions of 'detect' (called for each frame, returns true if the frame is sent).
+template <typename Detect>
+static VoiceDetectionScore score(const VoiceFixture& fixture, Detect& detect)
+{
+    VoiceDetectionScore result;
+    result.iSpeechFrames        = 0;
+    result.iMissedSpeechFrames  = 0;
+    result.iNoiseFrames         = 0;
+    result.iSentNoiseFrames     = 0;
+    result.dNanosecondsPerFrame = 0.0;
+
+    std::chrono::steady_clock::duration time(0);
+
+    for (size_t iFrame = 0;  iFrame < fixture.vSpeechFrames.size();  iFrame++)
+    {
+        const short int* pFrame = &fixture.vSamples[iFrame * VOICE_FIXTURE_FRAME_SAMPLES];
+
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+        bool bSent = detect(pFrame);
+
+        time += std::chrono::steady_clock::now() - startTime;
+
+
+        if (fixture.vSpeechFrames[iFrame])
+        {
+            result.iSpeechFrames++;
+            result.iMissedSpeechFrames += (bSent == false);
+        }
+        else if (fixture.vNoiseFrames[iFrame])
+        {
+            result.iNoiseFrames++;
+            result.iSentNoiseFrames += bSent;
+        }
+    }
+
+    if (fixture.vSpeechFrames.empty() == false)
+    {
+        result.dNanosecondsPerFrame = std::chrono::duration<double, std::nano>(time).count() / fixture.vSpeechFrames.size();
+    }
+
+
+    return result;
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+const char* getVoiceFixtureName(VOICE_FIXTURE_NOISE noise)
+{
+    switch (noise)
+    {
+    case VFN_QUIET_ROOM: return "quiet room";
+    case VFN_FAN:        return "fan";
+    case VFN_MAINS_HUM:  return "mains hum";
+    case VFN_KEYBOARD:   return "keyboard clicks";
+    default:             return "unknown";
+    }
+}
+
+VoiceFixture makeVoiceFixture(VOICE_FIXTURE_NOISE noise, unsigned int iSeed, unsigned int iSeconds)
+{
+    const size_t iRate         = VOICE_FIXTURE_SAMPLE_RATE;
+    const size_t iSampleCount  = iRate * iSeconds;
+
+    std::mt19937 rndGen(iSeed);
+    std::normal_distribution<float>       gauss(0.0f, 1.0f);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+    std::vector<float> vSignal(iSampleCount, 0.0f);
+    std::vector<char>  vSpeech(iSampleCount, 0);
+
+
+    // Background.
+
+    for (size_t i = 0;  i < iSampleCount;  i++)
+    {
+        switch (noise)
+        {
+        case VFN_FAN:
+            vSignal[i] = gauss(rndGen) * dbToAmplitude(-42.0f);
+            break;
+        case VFN_MAINS_HUM:
+        {
+            double dTime = static_cast<double>(i) / iRate;
+
+            vSignal[i] = dbToAmplitude(-36.0f) * static_cast<float>( std::sin(2 * dPi * 50 * dTime)
+                                                                     + 0.5 * std::sin(2 * dPi * 150 * dTime)
+                                                                     + 0.3 * std::sin(2 * dPi * 250 * dTime) )
+                         + gauss(rndGen) * dbToAmplitude(-65.0f);
+            break;
+        }
+        default:
+            vSignal[i] = gauss(rndGen) * dbToAmplitude(-62.0f);
+            break;
+        }
+    }
+
+    if (noise == VFN_KEYBOARD)
+    {
+        // A click every 125 - 375 ms: 300 samples of a decaying alternating burst.
+
+        for (size_t iTime = iRate / 2;  iTime + 400 < iSampleCount;  iTime += iRate / 8 + rndGen() % (iRate / 4))
+        {
+            float fAmplitude = dbToAmplitude(-12.0f + uniform(rndGen) * 6.0f);
+
+            for (size_t k = 0;  k < 300;  k++)
+            {
+                vSignal[iTime + k] += fAmplitude * std::exp(-static_cast<float>(k) / 40.0f) * ((k % 2) ? 1.0f : -1.0f) * (0.5f + uniform(rndGen));
+            }
+        }
+    }
+
+    addSpeech(vSignal, vSpeech, rndGen);
+
+
+    // PCM16 and the labels.
+
+    VoiceFixture fixture;
+    fixture.vSamples.resize(iSampleCount);
+
+    for (size_t i = 0;  i < iSampleCount;  i++)
+    {
+        fixture.vSamples[i] = static_cast<short int>( std::max(-32768.0f, std::min(32767.0f, vSignal[i])) );
+    }
+
+    size_t iFrameCount = iSampleCount / VOICE_FIXTURE_FRAME_SAMPLES;
+
+    fixture.vSpeechFrames.assign(iFrameCount, 0);
+    fixture.vNoiseFrames .assign(iFrameCount, 0);
+
+    for (size_t iFrame = 0;  iFrame < iFrameCount;  iFrame++)
+    {
+        size_t iSpeechSamples = 0;
+
+        for (size_t i = 0;  i < VOICE_FIXTURE_FRAME_SAMPLES;  i++)
+        {
+            iSpeechSamples += static_cast<size_t>( vSpeech[iFrame * VOICE_FIXTURE_FRAME_SAMPLES + i] );
+        }
+
+        fixture.vSpeechFrames[iFrame] = (iSpeechSamples > VOICE_FIXTURE_FRAME_SAMPLES / VOICE_FIXTURE_SPEECH_PART);
+    }
+
+    for (size_t iFrame = 0;  iFrame < iFrameCount;  iFrame++)
+    {
+        bool bNearSpeech = false;
+
+        for (size_t iBack = 0;  (iBack <= VOICE_FIXTURE_AFTER_SPEECH) && (iBack <= iFrame);  iBack++)
+        {
+            bNearSpeech = bNearSpeech || fixture.vSpeechFrames[iFrame - iBack];
+        }
+
+        fixture.vNoiseFrames[iFrame] = (bNearSpeech == false);
+    }
+
+
+    return fixture;
+}
+
+VoiceDetectionScore scoreOldVoiceActivation(const VoiceFixture& fixture, int iStartDBFS)
+{
+    int iPacketsNeedToRecordLeft = 4;
+
+    auto detect = [&](const short int* pFrame)
+    {
+        AudioFrameLevel level = AudioDSP::measureWithGain(pFrame, VOICE_FIXTURE_FRAME_SAMPLES, 1.0f);
+
+        double maxDBFS = AudioDSP::peakToDBFS(level.iPeak);
+
+        if (iPacketsNeedToRecordLeft == 0)
+        {
+            iPacketsNeedToRecordLeft = 4;
+        }
+
+        if ( (iPacketsNeedToRecordLeft != 4) || (static_cast<int>(maxDBFS) >= iStartDBFS) )
+        {
+            iPacketsNeedToRecordLeft--;
+
+            return true;
+        }
+
+        return false;
+    };
+
+
+    return score(fixture, detect);
+}
+
+VoiceDetectionScore scoreVoiceActivityDetector(const VoiceFixture& fixture, int iStartDBFS, bool bNoiseGating)
+{
+    VoiceActivityDetector detector(VOICE_FIXTURE_FRAME_MS);
+    detector.setStartLevel(iStartDBFS);
+    detector.setNoiseGating(bNoiseGating);
+
+    auto detect = [&](const short int* pFrame)
+    {
+        return detector.process(pFrame, VOICE_FIXTURE_FRAME_SAMPLES);
+    };
+
+
+    return score(fixture, detect);
+}
+
+double getMissedSpeechPercent(const VoiceDetectionScore& score)
+{
+    return (score.iSpeechFrames == 0) ? 0.0 : 100.0 * score.iMissedSpeechFrames / score.iSpeechFrames;
+}
+
+double getSentNoisePercent(const VoiceDetectionScore& score)
+{
+    return (score.iNoiseFrames == 0) ? 0.0 : 100.0 * score.iSentNoiseFrames / score.iNoiseFrames;
+}
@@ -0,0 +1,81 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <cstddef>
+#include <vector>
+
+
+// The client's voice packet (see AudioService): 679 samples at 19400 Hz, 35 ms.
+#define  VOICE_FIXTURE_SAMPLE_RATE     19400
+#define  VOICE_FIXTURE_FRAME_SAMPLES   679
+#define  VOICE_FIXTURE_FRAME_MS        35
+
+// The start level of the voice activation in the new settings.
+#define  VOICE_FIXTURE_START_DBFS      -30
+
+
+enum VOICE_FIXTURE_NOISE
+{
+    VFN_QUIET_ROOM      = 0,   // -62 dBFS hiss
+    VFN_FAN             = 1,   // -42 dBFS white noise
+    VFN_MAINS_HUM       = 2,   // -36 dBFS 50 Hz + harmonics
+    VFN_KEYBOARD        = 3,   // -62 dBFS hiss and -12..-6 dBFS clicks
+
+    VFN_COUNT           = 4
+};
+
+
+// Synthetic microphone input: speech-like words (harmonics with the syllable rate, some start with a fricative)
+// over a noise background. Same seed - same samples (for one standard library).
+struct VoiceFixture
+{
+    std::vector<short int>  vSamples;
+
+    // Per frame (VOICE_FIXTURE_FRAME_SAMPLES): 1 if more than a fifth of the frame is speech.
+    std::vector<char>       vSpeechFrames;
+
+    // Per frame: 1 if there was no speech in this frame and in 9 frames before it (the hangover can't explain sending it).
+    std::vector<char>       vNoiseFrames;
+};
+
+
+// How much of the speech was not sent and how much of the noise was.
+struct VoiceDetectionScore
+{
+    size_t  iSpeechFrames;
+    size_t  iMissedSpeechFrames;
+
+    size_t  iNoiseFrames;
+    size_t  iSentNoiseFrames;
+
+    double  dNanosecondsPerFrame;
+};
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+const char*          getVoiceFixtureName       (VOICE_FIXTURE_NOISE noise);
+
+VoiceFixture         makeVoiceFixture          (VOICE_FIXTURE_NOISE noise, unsigned int iSeed, unsigned int iSeconds);
+
+
+// The voice activation before VoiceActivityDetector (per-sample log10 of the peak against the start level,
+// 4 packets sent after each loud one).
+VoiceDetectionScore  scoreOldVoiceActivation   (const VoiceFixture& fixture, int iStartDBFS);
+
+// VoiceActivityDetector with the default attack and hangover.
+VoiceDetectionScore  scoreVoiceActivityDetector(const VoiceFixture& fixture, int iStartDBFS, bool bNoiseGating);
+
+// Percents.
+double               getMissedSpeechPercent    (const VoiceDetectionScore& score);
+double               getSentNoisePercent       (const VoiceDetectionScore& score);
@@ -0,0 +1,682 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "chatlogview.h"
+
+// Qt
+#include <QApplication>
+#include <QClipboard>
+#include <QContextMenuEvent>
+#include <QKeyEvent>
+#include <QMenu>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QTextLayout>
+#include <QTimer>
+#include <QtMath>
+
+// STL
+#include <cstdio>
+#include <utility>
+
+// Custom
+#include "Model/ChatLog/chatlog.h"
+
+
+// Space around the text and between the entries (in pixels).
+#define  CHAT_LOG_VIEW_MARGIN       6
+#define  CHAT_LOG_VIEW_SPACING      4
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+ChatLogView::ChatLogView(QWidget *parent) : QAbstractScrollArea(parent)
+{
+    pChatLog        = nullptr;
+    iTopSequence    = 0;
+
+    bStickToEnd     = true;
+    bRefreshPending = false;
+    bSettingRange   = false;
+
+    iSelectionAnchorSequence = 0;
+    iSelectionAnchorPos      = 0;
+    iSelectionEndSequence    = 0;
+    iSelectionEndPos         = 0;
+    bSelecting               = false;
+
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    verticalScrollBar()->setSingleStep(1);
+
+    viewport()->setCursor(Qt::IBeamCursor);
+}
+
+void ChatLogView::setChatLog(ChatLog* pChatLog)
+{
+    this->pChatLog = pChatLog;
+
+    vColors.clear();
+
+    iTopSequence = pChatLog ? pChatLog->getFirstSequence() : 0;
+    bStickToEnd  = true;
+
+    // No selection.
+    iSelectionAnchorSequence = iTopSequence;
+    iSelectionAnchorPos      = 0;
+    iSelectionEndSequence    = iTopSequence;
+    iSelectionEndPos         = 0;
+    bSelecting               = false;
+
+    updateLog();
+}
+
+void ChatLogView::updateLog()
+{
+    if (bRefreshPending)
+    {
+        return;
+    }
+
+    bRefreshPending = true;
+
+    QTimer::singleShot(0, this, &ChatLogView::slotRefresh);
+}
+
+void ChatLogView::paintEvent(QPaintEvent* event)
+{
+    Q_UNUSED(event)
+
+    if ( (pChatLog == nullptr) || (pChatLog->getSize() == 0) )
+    {
+        return;
+    }
+
+
+    QPainter painter(viewport());
+
+    long long iTop = iTopSequence - pChatLog->getFirstSequence();
+
+    if (iTop < 0)
+    {
+        iTop = 0;
+    }
+
+
+    long long iStartSequence = 0;
+    int       iStartPos      = 0;
+    long long iEndSequence   = 0;
+    int       iEndPos        = 0;
+
+    bool bSelection = getSelection(iStartSequence, iStartPos, iEndSequence, iEndPos);
+
+
+    // Only the visible entries.
+
+    int iY = CHAT_LOG_VIEW_MARGIN;
+
+    for (size_t i = static_cast<size_t>(iTop);  (i < pChatLog->getSize()) && (iY < viewport()->height());  i++)
+    {
+        QTextLayout layout;
+
+        int iHeight = layoutEntry(i, layout);
+
+
+        QVector<QTextLayout::FormatRange> vSelections;
+
+        long long iSequence = pChatLog->getFirstSequence() + static_cast<long long>(i);
+
+        if ( bSelection && (iSequence >= iStartSequence) && (iSequence <= iEndSequence) )
+        {
+            QTextLayout::FormatRange selection;
+            selection.start  = (iSequence == iStartSequence) ? iStartPos : 0;
+            selection.length = ( (iSequence == iEndSequence) ? iEndPos : layout.text().size() ) - selection.start;
+            selection.format.setBackground( palette().brush(QPalette::Highlight) );
+            selection.format.setForeground( palette().brush(QPalette::HighlightedText) );
+
+            vSelections.push_back(selection);
+        }
+
+        layout.draw(&painter, QPointF(CHAT_LOG_VIEW_MARGIN, iY), vSelections);
+
+        iY += iHeight + CHAT_LOG_VIEW_SPACING;
+    }
+}
+
+void ChatLogView::resizeEvent(QResizeEvent* event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+
+    // The entries wrap differently now.
+    updateScrollRange();
+}
+
+void ChatLogView::scrollContentsBy(int dx, int dy)
+{
+    Q_UNUSED(dx)
+    Q_UNUSED(dy)
+
+    if (bSettingRange || (pChatLog == nullptr))
+    {
+        return;
+    }
+
+    iTopSequence = pChatLog->getFirstSequence() + verticalScrollBar()->value();
+    bStickToEnd  = verticalScrollBar()->value() == verticalScrollBar()->maximum();
+
+    viewport()->update();
+}
+
+void ChatLogView::contextMenuEvent(QContextMenuEvent* event)
+{
+    if (pChatLog == nullptr)
+    {
+        return;
+    }
+
+
+    size_t iEntry      = 0;
+    bool   bEntryFound = getEntryAt(event->pos().y(), iEntry);
+
+    long long iStartSequence = 0;
+    int       iStartPos      = 0;
+    long long iEndSequence   = 0;
+    int       iEndPos        = 0;
+
+    bool bSelection = getSelection(iStartSequence, iStartPos, iEndSequence, iEndPos);
+
+    QMenu menu(this);
+
+    QAction* pActionCopy    = menu.addAction("Copy");
+    QAction* pActionCopyAll = menu.addAction("Copy All");
+
+    pActionCopy->setEnabled(bSelection || bEntryFound);
+    pActionCopyAll->setEnabled(pChatLog->getSize() != 0);
+
+
+    QAction* pSelected = menu.exec(event->globalPos());
+
+    if (pSelected == pActionCopy)
+    {
+        // The selection or the entry under the mouse.
+        QApplication::clipboard()->setText( bSelection ? getSelectedText() : getEntryText(iEntry) );
+    }
+    else if (pSelected == pActionCopyAll)
+    {
+        QString sText;
+
+        for (size_t i = 0;  i < pChatLog->getSize();  i++)
+        {
+            sText += getEntryText(i);
+            sText += "\n";
+        }
+
+        QApplication::clipboard()->setText(sText);
+    }
+}
+
+void ChatLogView::mousePressEvent(QMouseEvent* event)
+{
+    if ( (pChatLog == nullptr) || (event->button() != Qt::LeftButton) )
+    {
+        QAbstractScrollArea::mousePressEvent(event);
+
+        return;
+    }
+
+
+    long long iSequence = 0;
+    int       iPos      = 0;
+
+    if (hitTest(event->pos(), iSequence, iPos) == false)
+    {
+        return;
+    }
+
+    // Starts a new selection (an empty one).
+    iSelectionAnchorSequence = iSequence;
+    iSelectionAnchorPos      = iPos;
+    iSelectionEndSequence    = iSequence;
+    iSelectionEndPos         = iPos;
+    bSelecting               = true;
+
+    viewport()->update();
+}
+
+void ChatLogView::mouseMoveEvent(QMouseEvent* event)
+{
+    if ( (pChatLog == nullptr) || (bSelecting == false) )
+    {
+        QAbstractScrollArea::mouseMoveEvent(event);
+
+        return;
+    }
+
+
+    // Dragged out of the viewport: scroll by one entry.
+
+    if (event->pos().y() < 0)
+    {
+        verticalScrollBar()->setValue( verticalScrollBar()->value() - 1 );
+    }
+    else if (event->pos().y() >= viewport()->height())
+    {
+        verticalScrollBar()->setValue( verticalScrollBar()->value() + 1 );
+    }
+
+
+    long long iSequence = 0;
+    int       iPos      = 0;
+
+    if (hitTest(event->pos(), iSequence, iPos))
+    {
+        iSelectionEndSequence = iSequence;
+        iSelectionEndPos      = iPos;
+
+        viewport()->update();
+    }
+}
+
+void ChatLogView::mouseReleaseEvent(QMouseEvent* event)
+{
+    if (event->button() == Qt::LeftButton)
+    {
+        bSelecting = false;
+    }
+
+    QAbstractScrollArea::mouseReleaseEvent(event);
+}
+
+void ChatLogView::keyPressEvent(QKeyEvent* event)
+{
+    if ( (pChatLog != nullptr) && event->matches(QKeySequence::Copy) )
+    {
+        QString sText = getSelectedText();
+
+        if (sText.isEmpty() == false)
+        {
+            QApplication::clipboard()->setText(sText);
+        }
+
+        return;
+    }
+
+    QAbstractScrollArea::keyPressEvent(event);
+}
+
+void ChatLogView::slotRefresh()
+{
+    bRefreshPending = false;
+
+    updateScrollRange();
+
+    viewport()->update();
+}
+
+int ChatLogView::layoutEntry(size_t iEntry, QTextLayout& layout)
+{
+    const ChatLogEntry& entry = pChatLog->getEntry(iEntry);
+
+    QString sText = getEntryText(iEntry);
+
+    // QTextLayout does not break the lines on '\n'.
+    sText.replace('\n', QChar::LineSeparator);
+
+
+    // Colors: the time and the rest.
+
+    QVector<QTextLayout::FormatRange> vFormats;
+
+    QTextLayout::FormatRange format;
+    format.start  = 0;
+    format.length = 0;
+
+    if (entry.type == CLET_USER_MESSAGE)
+    {
+        format.length = static_cast<int>(entry.sTime.size());
+        format.format.setForeground( getColor(entry.iTimeColorId) );
+
+        vFormats.push_back(format);
+    }
+
+    format.start  = format.length;
+    format.length = sText.size() - format.start;
+    format.format.setForeground( getColor(entry.iTextColorId) );
+
+    vFormats.push_back(format);
+
+
+    QTextOption option;
+    option.setWrapMode(QTextOption::WrapAtWordBoundaryOrAnywhere);
+
+    layout.setFont       (font());
+    layout.setText       (sText);
+    layout.setTextOption (option);
+    layout.setFormats    (vFormats);
+
+
+    int   iWidth  = viewport()->width() - 2 * CHAT_LOG_VIEW_MARGIN;
+    qreal fHeight = 0;
+
+    layout.beginLayout();
+
+    while (true)
+    {
+        QTextLine line = layout.createLine();
+
+        if (line.isValid() == false)
+        {
+            break;
+        }
+
+        line.setLineWidth( (iWidth > 1) ? iWidth : 1 );
+        line.setPosition(QPointF(0, fHeight));
+
+        fHeight += line.height();
+    }
+
+    layout.endLayout();
+
+
+    return qCeil(fHeight);
+}
+
+void ChatLogView::updateScrollRange()
+{
+    size_t iSize = pChatLog ? pChatLog->getSize() : 0;
+
+
+    // The first entry of the last page: lay out the entries from the end until the viewport is full.
+
+    size_t iMaxTop          = iSize;
+    int    iViewportHeight  = viewport()->height() - CHAT_LOG_VIEW_MARGIN;
+    int    iUsedHeight      = 0;
+
+    while (iMaxTop > 0)
+    {
+        QTextLayout layout;
+
+        int iHeight = layoutEntry(iMaxTop - 1, layout);
+
+        if ( (iUsedHeight > 0) && (iUsedHeight + iHeight > iViewportHeight) )
+        {
+            break;
+        }
+
+        iUsedHeight += iHeight + CHAT_LOG_VIEW_SPACING;
+        iMaxTop--;
+    }
+
+
+    // Keep the shown entry (it moves up when the oldest entries are dropped) or the end.
+
+    long long iTop = static_cast<long long>(iMaxTop);
+
+    if ( (bStickToEnd == false) && pChatLog )
+    {
+        iTop = iTopSequence - pChatLog->getFirstSequence();
+
+        if (iTop < 0)
+        {
+            iTop = 0;
+        }
+        else if (iTop > static_cast<long long>(iMaxTop))
+        {
+            iTop = static_cast<long long>(iMaxTop);
+        }
+    }
+
+
+    bSettingRange = true;
+
+    verticalScrollBar()->setRange    (0, static_cast<int>(iMaxTop));
+    verticalScrollBar()->setPageStep (static_cast<int>(iSize - iMaxTop));
+    verticalScrollBar()->setValue    (static_cast<int>(iTop));
+
+    bSettingRange = false;
+
+
+    iTopSequence = (pChatLog ? pChatLog->getFirstSequence() : 0) + iTop;
+    bStickToEnd  = (iTop == static_cast<long long>(iMaxTop));
+}
+
+bool ChatLogView::getEntryAt(int iY, size_t& iEntryOut)
+{
+    long long iTop = iTopSequence - pChatLog->getFirstSequence();
+
+    if (iTop < 0)
+    {
+        iTop = 0;
+    }
+
+
+    int iEntryY = CHAT_LOG_VIEW_MARGIN;
+
+    for (size_t i = static_cast<size_t>(iTop);  (i < pChatLog->getSize()) && (iEntryY < viewport()->height());  i++)
+    {
+        QTextLayout layout;
+
+        int iHeight = layoutEntry(i, layout);
+
+        if ( (iY >= iEntryY) && (iY < iEntryY + iHeight + CHAT_LOG_VIEW_SPACING) )
+        {
+            iEntryOut = i;
+
+            return true;
+        }
+
+        iEntryY += iHeight + CHAT_LOG_VIEW_SPACING;
+    }
+
+
+    return false;
+}
+
+bool ChatLogView::hitTest(const QPoint& pos, long long& iSequenceOut, int& iPosOut)
+{
+    if (pChatLog->getSize() == 0)
+    {
+        return false;
+    }
+
+
+    long long iTop = iTopSequence - pChatLog->getFirstSequence();
+
+    if (iTop < 0)
+    {
+        iTop = 0;
+    }
+    else if (iTop >= static_cast<long long>(pChatLog->getSize()))
+    {
+        iTop = static_cast<long long>(pChatLog->getSize()) - 1;
+    }
+
+
+    int iEntryY = CHAT_LOG_VIEW_MARGIN;
+
+    if (pos.y() < iEntryY)
+    {
+        // Above the entries: the start of the first shown one.
+        iSequenceOut = pChatLog->getFirstSequence() + iTop;
+        iPosOut      = 0;
+
+        return true;
+    }
+
+
+    for (size_t i = static_cast<size_t>(iTop);  i < pChatLog->getSize();  i++)
+    {
+        QTextLayout layout;
+
+        int iHeight = layoutEntry(i, layout);
+
+        iSequenceOut = pChatLog->getFirstSequence() + static_cast<long long>(i);
+        iPosOut      = layout.text().size();
+
+        if ( (pos.y() < iEntryY + iHeight + CHAT_LOG_VIEW_SPACING) && (layout.lineCount() > 0) )
+        {
+            // The line at 'pos' (the last one if 'pos' is in the spacing after the entry).
+
+            qreal fY = pos.y() - iEntryY;
+
+            QTextLine line = layout.lineAt(layout.lineCount() - 1);
+
+            for (int k = 0;  k < layout.lineCount();  k++)
+            {
+                if (fY < layout.lineAt(k).y() + layout.lineAt(k).height())
+                {
+                    line = layout.lineAt(k);
+
+                    break;
+                }
+            }
+
+            iPosOut = line.xToCursor(pos.x() - CHAT_LOG_VIEW_MARGIN);
+
+            return true;
+        }
+
+        iEntryY += iHeight + CHAT_LOG_VIEW_SPACING;
+
+        if (iEntryY >= viewport()->height())
+        {
+            // Below the viewport: the end of the last shown entry.
+            return true;
+        }
+    }
+
+
+    // Below the entries: the end of the newest one.
+    return true;
+}
+
+bool ChatLogView::getSelection(long long& iStartSequenceOut, int& iStartPosOut, long long& iEndSequenceOut, int& iEndPosOut) const
+{
+    if (pChatLog == nullptr)
+    {
+        return false;
+    }
+
+
+    iStartSequenceOut = iSelectionAnchorSequence;
+    iStartPosOut      = iSelectionAnchorPos;
+    iEndSequenceOut   = iSelectionEndSequence;
+    iEndPosOut        = iSelectionEndPos;
+
+    if ( (iEndSequenceOut < iStartSequenceOut) || ( (iEndSequenceOut == iStartSequenceOut) && (iEndPosOut < iStartPosOut) ) )
+    {
+        std::swap(iStartSequenceOut, iEndSequenceOut);
+        std::swap(iStartPosOut,      iEndPosOut);
+    }
+
+
+    // The dropped entries are not selected.
+
+    long long iFirstSequence = pChatLog->getFirstSequence();
+    long long iLastSequence  = iFirstSequence + static_cast<long long>(pChatLog->getSize()) - 1;
+
+    if ( (iEndSequenceOut < iFirstSequence) || (iStartSequenceOut > iLastSequence) )
+    {
+        return false;
+    }
+
+    if (iStartSequenceOut < iFirstSequence)
+    {
+        iStartSequenceOut = iFirstSequence;
+        iStartPosOut      = 0;
+    }
+
+
+    return (iStartSequenceOut != iEndSequenceOut) || (iStartPosOut != iEndPosOut);
+}
+
+QString ChatLogView::getSelectedText() const
+{
+    long long iStartSequence = 0;
+    int       iStartPos      = 0;
+    long long iEndSequence   = 0;
+    int       iEndPos        = 0;
+
+    if (getSelection(iStartSequence, iStartPos, iEndSequence, iEndPos) == false)
+    {
+        return "";
+    }
+
+
+    // The positions are in the laid out text: same length as getEntryText() ('\n' was replaced by one character).
+
+    QString sText;
+
+    for (long long iSequence = iStartSequence;  iSequence <= iEndSequence;  iSequence++)
+    {
+        QString sEntryText = getEntryText( static_cast<size_t>(iSequence - pChatLog->getFirstSequence()) );
+
+        int iStart = (iSequence == iStartSequence) ? iStartPos : 0;
+        int iEnd   = (iSequence == iEndSequence)   ? iEndPos   : sEntryText.size();
+
+        if (iSequence != iStartSequence)
+        {
+            sText += "\n";
+        }
+
+        sText += sEntryText.mid(iStart, iEnd - iStart);
+    }
+
+
+    return sText;
+}
+
+QString ChatLogView::getEntryText(size_t iEntry) const
+{
+    const ChatLogEntry& entry = pChatLog->getEntry(iEntry);
+
+    if (entry.type == CLET_USER_MESSAGE)
+    {
+        return QString::fromStdString(entry.sTime) + " " + QString::fromStdString( pChatLog->getName(entry.iNameId) )
+               + ": " + QString::fromStdWString(entry.sText);
+    }
+    else
+    {
+        return QString::fromStdWString(entry.sText);
+    }
+}
+
+QColor ChatLogView::getColor(unsigned char iColorId)
+{
+    // Parse the new colors of the log once.
+
+    while (vColors.size() < pChatLog->getColorCount())
+    {
+        const std::string& sColor = pChatLog->getColor( static_cast<unsigned char>(vColors.size()) );
+
+        int iRed   = 0;
+        int iGreen = 0;
+        int iBlue  = 0;
+
+        if ( std::sscanf(sColor.c_str(), "rgb(%d,%d,%d)", &iRed, &iGreen, &iBlue) == 3 )
+        {
+            vColors.push_back( QColor(iRed, iGreen, iBlue) );
+        }
+        else
+        {
+            // Names ("white", "red") and "#rrggbb", invalid - the theme's text color.
+            vColors.push_back( QColor(QString::fromStdString(sColor)) );
+        }
+    }
+
+
+    if ( (iColorId < vColors.size()) && vColors[iColorId].isValid() )
+    {
+        return vColors[iColorId];
+    }
+    else
+    {
+        return palette().color(QPalette::Text);
+    }
+}
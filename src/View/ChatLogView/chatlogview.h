@@ -0,0 +1,111 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+// Qt
+#include <QAbstractScrollArea>
+#include <QColor>
+
+// STL
+#include <vector>
+
+
+class ChatLog;
+class QTextLayout;
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Shows a ChatLog. Only the visible entries are laid out (on each paint): the scroll bar goes over the entries
+// (one step - one entry) so the height of the whole log is never needed, the last page is found by laying out
+// the entries from the end until the viewport is full. Keeps showing the newest entries if scrolled to the end.
+// The text is selected with the mouse: the ends of the selection are (entry sequence, position in the entry text)
+// so the selection stays on its entries while the log scrolls and the oldest entries are dropped.
+class ChatLogView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+
+    explicit ChatLogView(QWidget *parent = nullptr);
+
+
+    // Does not take the ownership.
+    void     setChatLog       (ChatLog* pChatLog);
+
+    // Call after the log was changed. Many calls in a row are handled once (when the control returns to the event loop).
+    void     updateLog        ();
+
+
+protected:
+
+    void     paintEvent       (QPaintEvent* event) override;
+    void     resizeEvent      (QResizeEvent* event) override;
+    void     scrollContentsBy (int dx, int dy) override;
+    void     contextMenuEvent (QContextMenuEvent* event) override;
+    void     mousePressEvent  (QMouseEvent* event) override;
+    void     mouseMoveEvent   (QMouseEvent* event) override;
+    void     mouseReleaseEvent(QMouseEvent* event) override;
+    void     keyPressEvent    (QKeyEvent* event) override;
+
+
+private slots:
+
+    void     slotRefresh      ();
+
+
+private:
+
+    // Returns the height of the entry.
+    int      layoutEntry      (size_t iEntry, QTextLayout& layout);
+
+    // Sets the scroll bar range and keeps the shown entry (or the end).
+    void     updateScrollRange();
+
+    // Returns the entry at 'iY' in the viewport or false if there is none.
+    bool     getEntryAt       (int iY, size_t& iEntryOut);
+
+    // Returns the entry sequence and the position in its text at 'pos' in the viewport (the nearest one if 'pos'
+    // is above or below the entries) or false if the log is empty.
+    bool     hitTest          (const QPoint& pos, long long& iSequenceOut, int& iPosOut);
+
+    // Returns the ordered ends of the selection (without the dropped entries) or false if nothing is selected.
+    bool     getSelection     (long long& iStartSequenceOut, int& iStartPosOut, long long& iEndSequenceOut, int& iEndPosOut) const;
+
+    QString  getSelectedText  () const;
+
+    QString  getEntryText     (size_t iEntry) const;
+    QColor   getColor         (unsigned char iColorId);
+
+
+    // ---------------------------------------
+
+
+    ChatLog*            pChatLog;
+
+    // Sequence number of the first shown entry (see ChatLog::getFirstSequence()).
+    long long           iTopSequence;
+
+    bool                bStickToEnd;
+    bool                bRefreshPending;
+    bool                bSettingRange;
+
+
+    // Selection: from the anchor (where the mouse was pressed) to the end (where it is now).
+    long long           iSelectionAnchorSequence;
+    int                 iSelectionAnchorPos;
+    long long           iSelectionEndSequence;
+    int                 iSelectionEndPos;
+
+    bool                bSelecting;
+
+
+    // Parsed colors of the ChatLog (by the color id).
+    std::vector<QColor> vColors;
+};
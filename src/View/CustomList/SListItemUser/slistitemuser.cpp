@@ -47,6 +47,30 @@ void SListItemUser::setUserTalking(bool bTalking)
     setColor();
 }
 
+void SListItemUser::applyState()
+{
+    int  iPing    = 0;
+    bool bTalking = false;
+
+    bool bPingChanged    = false;
+    bool bTalkingChanged = false;
+
+    if ( stateSlot.take(iPing, bTalking, bPingChanged, bTalkingChanged) == false )
+    {
+        return;
+    }
+
+    if (bPingChanged)
+    {
+        setPing(iPing);
+    }
+
+    if (bTalkingChanged)
+    {
+        setUserTalking(bTalking);
+    }
+}
+
 SListItemRoom *SListItemUser::getRoom()
 {
     return pRoom;
@@ -57,6 +81,11 @@ QString SListItemUser::getName()
     return sName;
 }
 
+UserStateSlot *SListItemUser::getStateSlot()
+{
+    return &stateSlot;
+}
+
 SListItemUser::~SListItemUser()
 {
 }
@@ -6,6 +6,7 @@
 #pragma once
 
 #include "View/CustomList/SListItem/slistitem.h"
+#include "View/UserStateSnapshot/userstatesnapshot.h"
 
 class SListItemRoom;
 
@@ -21,8 +22,12 @@ public:
     void setPing(int iPing);
     void setUserTalking(bool bTalking);
 
+    // Applies the changed fields of the state slot (GUI thread, see UserStateSnapshot).
+    void applyState();
+
     SListItemRoom* getRoom();
     QString        getName();
+    UserStateSlot* getStateSlot();
 
 
     ~SListItemUser() override;
@@ -33,6 +38,8 @@ private:
 
     SListItemRoom* pRoom;
 
+    UserStateSlot stateSlot;
+
     QString sName;
 
     int iCurrentPing;
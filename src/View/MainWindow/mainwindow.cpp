@@ -16,9 +16,6 @@
 #include <QTimer>
 #include <QSystemTrayIcon>
 #include <QFile>
-#include <QTextBlock>
-#include <QScrollBar>
-#include <QTextDocument>
 
 // STL
 #include <thread>
@@ -32,9 +29,11 @@
 #include "View/StyleAndInfoPaths.h"
 #include "Model/SettingsManager/SettingsFile.h"
 #include "Model/SettingsManager/settingsmanager.h"
+#include "Model/ChatLog/chatlog.h"
 #include "View/CustomQPlainTextEdit/customqplaintextedit.h"
 #include "View/CustomList/SListItemUser/slistitemuser.h"
 #include "View/CustomList/SListItemRoom/slistitemroom.h"
+#include "View/UserStateSnapshot/userstatesnapshot.h"
 #include "View/RoomPassInputWindow/roompassinputwindow.h"
 #include "View/WindowControlWidget/windowcontrolwidget.h"
 #include "View/GlobalMessageWindow/globalmessagewindow.h"
@@ -57,7 +56,7 @@ MainWindow::MainWindow(QWidget *parent) :
     ui->label_chatRoom         ->setProperty("cssClass", "mainwindowLabel");
     ui->label_connectedCount   ->setProperty("cssClass", "mainwindowLabel");
     ui->plainTextEdit_input    ->setProperty("cssClass", "userInput");
-    ui->plainTextEdit          ->setProperty("cssClass", "chatOutput");
+    ui->chatLogView            ->setProperty("cssClass", "chatOutput");
 
     WindowControlWidget* pControlWindowWidget = new WindowControlWidget(this);
     connect(pControlWindowWidget, &WindowControlWidget::signalClose,    this, &MainWindow::close);
@@ -73,6 +72,17 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(this, &MainWindow::signalAddNewUserToList,   this, &MainWindow::slotAddNewUserToList);
 
     ui->menuBar->setCornerWidget(pControlWindowWidget, Qt::Corner::TopRightCorner);
+
+
+    pChatLog = new ChatLog(CHAT_LOG_DEFAULT_CAPACITY);
+    ui->chatLogView->setChatLog(pChatLog);
+
+    pUserStateSnapshot = new UserStateSnapshot();
+
+    pUserStateTimer = new QTimer();
+    pUserStateTimer->setInterval(USER_STATE_REFRESH_MS);
+    connect(pUserStateTimer, &QTimer::timeout, this, &MainWindow::slotRefreshUserStates);
+    pUserStateTimer->start();
 }
 
 
@@ -125,6 +135,11 @@ void MainWindow::slotApplyVoiceStartValue(int iValue)
     pController->applyVoiceStartValue(iValue);
 }
 
+void MainWindow::slotApplyVoiceNoiseGating(bool bEnable)
+{
+    pController->applyVoiceNoiseGating(bEnable);
+}
+
 void MainWindow::slotApplyShouldHearTestVoice(bool bHear)
 {
     pController->applyShouldHearTestVoice(bHear);
@@ -132,24 +147,19 @@ void MainWindow::slotApplyShouldHearTestVoice(bool bHear)
 
 
 
-void MainWindow::typeSomeOnScreen(QString text, SilentMessage messageColor, bool bUserMessage)
+void MainWindow::typeSomeOnScreen(QString text, SilentMessage messageColor)
 {
-    mtxPrintOutput.lock();
+    pChatLog->addOutput(text.toStdWString(), messageColor.sMessage);
 
-    if (bUserMessage)
-    {
-        ui->plainTextEdit->appendHtml ( text );
-    }
-    else
-    {
-        text.replace("\n", "<br>");
-        QString color = QString::fromStdString(messageColor.sMessage);
-
-        ui->plainTextEdit->appendHtml ( outputHTMLmessageStart + color + "\">" + text + outputHTMLmessageEnd );
-    }
+    ui->chatLogView->updateLog();
+}
 
+void MainWindow::slotPrintUserMessage(QString sTime, QString sName, QString sMessage, SilentMessage messageColor)
+{
+    pChatLog->addUserMessage(sTime.toStdString(), sName.toStdString(), sMessage.toStdWString(),
+                             messageColor.sTime, messageColor.sMessage);
 
-    mtxPrintOutput.unlock();
+    ui->chatLogView->updateLog();
 }
 
 void MainWindow::slotEnableInteractiveElements(bool bMenu, bool bTypeAndSend)
@@ -194,6 +204,29 @@ void MainWindow::slotCreateRoom(QString sName, QString sPassword, size_t iMaxUse
     resultPromise->set_value(false);
 }
 
+void MainWindow::slotRefreshUserStates()
+{
+    if ( pUserStateSnapshot->beginRefresh() == false )
+    {
+        return;
+    }
+
+
+    // The list is only changed in this (GUI) thread so the items are alive.
+
+    std::vector<SListItemRoom*> vRooms = ui->listWidget_users->getRooms();
+
+    for (size_t i = 0;  i < vRooms.size();  i++)
+    {
+        std::vector<SListItemUser*> vUsers = vRooms[i]->getUsers();
+
+        for (size_t j = 0;  j < vUsers.size();  j++)
+        {
+            vUsers[j]->applyState();
+        }
+    }
+}
+
 void MainWindow::slotTrayIconActivated()
 {
     pTrayIcon->hide();
@@ -205,69 +238,47 @@ void MainWindow::slotTrayIconActivated()
 
 void MainWindow::slotShowUserDisconnectNotice(std::string name, SilentMessage messageColor, char cUserLost)
 {
-    mtxPrintOutput.lock   ();
-
-
-
-    QString message = "";
+    std::string message = "";
 
     if (cUserLost == 2)
     {
-        message = "The server has kicked the user " + QString::fromStdString(name) + ".<br>";
+        message = "The server has kicked the user " + name + ".";
     }
     else if (cUserLost == 1)
     {
-        message = "The server has lost connection with " + QString::fromStdString(name) + ".<br>";
+        message = "The server has lost connection with " + name + ".";
     }
     else if (cUserLost == 0)
     {
-        message = QString::fromStdString(name) + " disconnected.<br>";
+        message = name + " disconnected.";
     }
 
-    QString color = QString::fromStdString(messageColor.sTime);
+    pChatLog->addOutput(QString::fromStdString(message).toStdWString(), messageColor.sTime, CLET_NOTICE);
 
-    ui->plainTextEdit->appendHtml ( "<font style=\"color: " + color + "\">" + message + outputHTMLmessageEnd );
-
-
-
-    mtxPrintOutput.unlock ();
+    ui->chatLogView->updateLog();
 }
 
 void MainWindow::slotShowUserConnectNotice(std::string name, SilentMessage messageColor)
 {
-    mtxPrintOutput.lock   ();
+    std::string message = name + " just connected to the chat.";
 
-    QString message = QString::fromStdString(name) + " just connected to the chat.<br>";
+    pChatLog->addOutput(QString::fromStdString(message).toStdWString(), messageColor.sTime, CLET_NOTICE);
 
-    QString color = QString::fromStdString(messageColor.sTime);
-
-    ui->plainTextEdit->appendHtml ( "<font style=\"color: " + color + "\">" + message + outputHTMLmessageEnd );
-
-    mtxPrintOutput.unlock ();
+    ui->chatLogView->updateLog();
 }
 
 void MainWindow::slotShowOldText(wchar_t *pText)
 {
-    mtxPrintOutput.lock();
-
-
     std::wstring sText(pText);
 
     delete[] pText;
 
 
-    QString sNewText = "";
-    sNewText += QString::fromStdWString(sText);
-
-    sNewText += ui->plainTextEdit->toPlainText().right( ui->plainTextEdit->toPlainText().size() - 10 ); // 10: ".........."
-
-
-    ui->plainTextEdit->clear();
-
-    ui->plainTextEdit->appendHtml(sNewText);
-
+    // No color: the theme's text color.
+    // Dropped if the log is full (the history is older than everything kept).
+    pChatLog->addOldOutput(sText, "");
 
-    mtxPrintOutput.unlock();
+    ui->chatLogView->updateLog();
 }
 
 void MainWindow::slotClearTextEdit()
@@ -277,7 +288,9 @@ void MainWindow::slotClearTextEdit()
 
 void MainWindow::slotClearTextChatOutput()
 {
-    ui->plainTextEdit->clear();
+    pChatLog->clear();
+
+    ui->chatLogView->updateLog();
 }
 
 void MainWindow::slotApplyTheme()
@@ -381,7 +394,7 @@ void MainWindow::slotMoveUserToRoom(SListItemUser *pUser, QString sRoomName, std
 
     promiseResult->set_value(false);
 
-    ui->plainTextEdit->clear();
+    slotClearTextChatOutput();
 }
 
 void MainWindow::slotMoveRoom(QString sRoomName, bool bMoveUp, std::promise<bool> *promiseResult)
@@ -463,128 +476,62 @@ void MainWindow::slotHideWindow()
 
 void MainWindow::connectTo(std::string adress, std::string port, std::string userName, std::wstring sPass)
 {
-    ui->plainTextEdit->clear();
+    slotClearTextChatOutput();
 
     pController->connectTo(adress, port, userName, sPass);
 }
 
 void MainWindow::printOutput(std::string text, SilentMessage messageColor, bool bEmitSignal)
 {
-    if (bEmitSignal)
-    {
-        emit signalTypeOnScreen(QString::fromStdString(text), messageColor);
-    }
-    else
-    {
-        mtxPrintOutput.lock   ();
-
-        QString message = QString::fromStdString(text);
-        message.replace("\n", "<br>");
-        QString color = QString::fromStdString(messageColor.sMessage);
+    Q_UNUSED(bEmitSignal)
 
-        ui->plainTextEdit->appendHtml ( outputHTMLmessageStart + color + "\">" + message + outputHTMLmessageEnd );
-
-        mtxPrintOutput.unlock ();
-    }
+    // Direct call if we are in the GUI thread, queued otherwise (the ChatLog is used only from the GUI thread).
+    emit signalTypeOnScreen(QString::fromStdString(text), messageColor);
 }
 
 void MainWindow::printOutputW(std::wstring text, SilentMessage messageColor, bool bEmitSignal)
 {
-    if (bEmitSignal)
-    {
-        emit signalTypeOnScreen(QString::fromStdWString(text), messageColor);
-    }
-    else
-    {
-        mtxPrintOutput.lock   ();
-
-        QString message = QString::fromStdWString(text);
-        message.replace("\n", "<br>");
-        QString color = QString::fromStdString(messageColor.sMessage);
+    Q_UNUSED(bEmitSignal)
 
-        ui->plainTextEdit->appendHtml ( outputHTMLmessageStart + color + "\">" + message + outputHTMLmessageEnd );
-
-        mtxPrintOutput.unlock ();
-    }
+    emit signalTypeOnScreen(QString::fromStdWString(text), messageColor);
 }
 
 void MainWindow::printUserMessage(std::string timeInfo, std::wstring message, SilentMessage messageColor, bool bEmitSignal)
 {
+    Q_UNUSED(bEmitSignal)
+
     // 'timeInfo' example: "18:58. Flone: "
 
 
     // Get position in string where the name begins.
 
-    QString sTime    = "";
-    size_t  iNameStartPos = 0;
+    size_t iNameStartPos = timeInfo.find(' ');
 
-    for (size_t i = 0;   i < timeInfo.size();   i++)
+    if (iNameStartPos == std::string::npos)
     {
-        if (timeInfo[i] == ' ')
-        {
-            iNameStartPos = i;
-
-            break;
-        }
-        else
-        {
-            sTime += timeInfo[i];
-        }
+        iNameStartPos = timeInfo.size();
     }
 
 
+    // Read userName from 'timeInfo' (without ": " in the end).
 
+    size_t iNameEndPos = timeInfo.size();
 
-    // Read userName from 'timeInfo'.
-
-    QString sNameWithMessage = "";
-
-    for (size_t i = iNameStartPos;   i < timeInfo.size();   i++)
+    if ( (iNameEndPos >= iNameStartPos + 2) && (timeInfo.compare(iNameEndPos - 2, 2, ": ") == 0) )
     {
-        sNameWithMessage += timeInfo[i];
+        iNameEndPos -= 2;
     }
 
-    sNameWithMessage += QString::fromStdWString(message);
-
-
-    // Replace any '\n' to '<br>' because we will use "appendHtml()" function.
-    sNameWithMessage.replace("\n", "<br>");
-    // Replace any ' ' to '&nbsp;'
-    sNameWithMessage.replace(" ", "&nbsp;");
-
-
-    // Add <br> in the end of the message.
-    sNameWithMessage += "<br>";
-
-
-
+    std::string sName = "";
 
-    // Prepare colors.
-
-    QString sMessageColor = QString::fromStdString(messageColor.sMessage);
-    QString sTimeColor    = QString::fromStdString(messageColor.sTime);
-
-
-
-
-    // Create final output string.
-
-    QString sFinalMessage = outputHTMLtimeStart     + sTimeColor    + "\">" + sTime            + outputHTMLmessageEnd;
-    sFinalMessage        += outputHTMLmessageStart  + sMessageColor + "\">" + sNameWithMessage + outputHTMLmessageEnd;
-
-
-
-
-    // Print on screen.
-
-    if (bEmitSignal)
+    if (iNameEndPos > iNameStartPos)
     {
-        emit signalTypeOnScreen( sFinalMessage, messageColor, true);
-    }
-    else
-    {
-        ui->plainTextEdit->appendHtml ( sFinalMessage );
+        sName = timeInfo.substr(iNameStartPos + 1, iNameEndPos - iNameStartPos - 1);
     }
+
+
+    emit signalPrintUserMessage(QString::fromStdString( timeInfo.substr(0, iNameStartPos) ), QString::fromStdString(sName),
+                                QString::fromStdWString(message), messageColor);
 }
 
 void MainWindow::enableInteractiveElements(bool bMenu, bool bTypeAndSend)
@@ -604,8 +551,10 @@ void MainWindow::setConnectDisconnectButton(bool bConnect)
 
 void MainWindow::setPingAndTalkingToUser(SListItemUser* pListWidgetItem, int iPing, bool bTalking)
 {
-    pListWidgetItem->setPing(iPing);
-    pListWidgetItem->setUserTalking(bTalking);
+    // Called from the audio and network threads for every talk start / stop and every ping of every user:
+    // only store the state, slotRefreshUserStates() shows the changes once per frame.
+
+    pUserStateSnapshot->write(pListWidgetItem->getStateSlot(), iPing, bTalking);
 }
 
 
@@ -868,6 +817,7 @@ void MainWindow::showSettingsWindow()
     connect(pSettingsWindow, &SettingsWindow::closedSettingsWindow, this, &MainWindow::slotSettingsWindowClosed);
     connect(pSettingsWindow, &SettingsWindow::signalSetAudioInputVolume, this, &MainWindow::slotApplyAudioInputVolume);
     connect(pSettingsWindow, &SettingsWindow::signalSetVoiceStartValue, this, &MainWindow::slotApplyVoiceStartValue);
+    connect(pSettingsWindow, &SettingsWindow::signalSetVoiceNoiseGating, this, &MainWindow::slotApplyVoiceNoiseGating);
     connect(pSettingsWindow, &SettingsWindow::signalSetShouldHearTestVoice, this, &MainWindow::slotApplyShouldHearTestVoice);
     connect(pSettingsWindow, &SettingsWindow::signalRegisterMuteMicButton, this, &MainWindow::slotRegisterMuteMicButton);
 
@@ -940,6 +890,7 @@ void MainWindow::on_actionSettings_triggered()
     connect(pSettingsWindow, &SettingsWindow::closedSettingsWindow, this, &MainWindow::slotSettingsWindowClosed);
     connect(pSettingsWindow, &SettingsWindow::signalSetAudioInputVolume, this, &MainWindow::slotApplyAudioInputVolume);
     connect(pSettingsWindow, &SettingsWindow::signalSetVoiceStartValue, this, &MainWindow::slotApplyVoiceStartValue);
+    connect(pSettingsWindow, &SettingsWindow::signalSetVoiceNoiseGating, this, &MainWindow::slotApplyVoiceNoiseGating);
     connect(pSettingsWindow, &SettingsWindow::signalSetShouldHearTestVoice, this, &MainWindow::slotApplyShouldHearTestVoice);
     connect(pSettingsWindow, &SettingsWindow::signalRegisterMuteMicButton, this, &MainWindow::slotRegisterMuteMicButton);
     pController->unpauseTestRecording();
@@ -966,16 +917,10 @@ void MainWindow::onExecCalled()
 
 
 
-    // Output HTML
-
-    outputHTMLtimeStart    = "<font style=\"color: ";
-    outputHTMLmessageStart = "<font color=\"";
-    outputHTMLmessageEnd   = "</font>";
-
-
     // This to this connects
 
     connect(this, &MainWindow::signalTypeOnScreen,                 this, &MainWindow::typeSomeOnScreen);
+    connect(this, &MainWindow::signalPrintUserMessage,             this, &MainWindow::slotPrintUserMessage);
     connect(this, &MainWindow::signalEnableInteractiveElements,    this, &MainWindow::slotEnableInteractiveElements);
     connect(this, &MainWindow::signalShowMessageBox,               this, &MainWindow::slotShowMessageBox);
     connect(this, &MainWindow::signalShowUserDisconnectNotice,     this, &MainWindow::slotShowUserDisconnectNotice);
@@ -1014,7 +959,6 @@ void MainWindow::onExecCalled()
 
     qRegisterMetaType <SilentMessage>        ("SilentMessage");
     qRegisterMetaType <std::string>          ("std::string");
-    qRegisterMetaType <QTextBlock>           ("QTextBlock");
     qRegisterMetaType <QVector<int>>         ("QVector<int>");
     qRegisterMetaType <size_t>               ("size_t");
     qRegisterMetaType <std::vector<QString>> ("std::vector<QString>");
@@ -1074,7 +1018,7 @@ void MainWindow::slotEnterRoom()
         {
             SListItemRoom* pRoom = dynamic_cast<SListItemRoom*>(pItem);
 
-            if (pRoom == pController->getCurrentUserRoom())
+            if (pRoom->getRoomName().toStdString() == pController->getCurrentUserRoomName())
             {
                 ui->listWidget_users->clearSelection();
             }
@@ -1101,7 +1045,7 @@ void MainWindow::on_listWidget_users_customContextMenuRequested(const QPoint &po
 
             SListItemRoom* pRoom = dynamic_cast<SListItemRoom*>(pListItem);
 
-            if (pRoom != pController->getCurrentUserRoom())
+            if (pRoom->getRoomName().toStdString() != pController->getCurrentUserRoomName())
             {
                 QPoint globalPos = ui->listWidget_users->mapToGlobal(pos);
 
@@ -1214,7 +1158,7 @@ void MainWindow::on_listWidget_users_itemDoubleClicked(QListWidgetItem *item)
         {
             SListItemRoom* pRoom = dynamic_cast<SListItemRoom*>(pItem);
 
-            if (pRoom == pController->getCurrentUserRoom())
+            if (pRoom->getRoomName().toStdString() == pController->getCurrentUserRoomName())
             {
                 ui->listWidget_users->clearSelection();
             }
@@ -1370,6 +1314,11 @@ void MainWindow::on_actionAbout_Qt_triggered()
     pAboutQtWindow->show();
 }
 
+void MainWindow::on_actionVoice_Latency_triggered()
+{
+    pController->saveVoiceLatencyStats();
+}
+
 MainWindow::~MainWindow()
 {
     delete pActionChangeVolume;
@@ -1380,7 +1329,13 @@ MainWindow::~MainWindow()
     {
         delete pTimer;
     }
+
+    pUserStateTimer->stop();
+
     delete pController;
+    delete pUserStateTimer;
+    delete pUserStateSnapshot;
+    delete pChatLog;
     delete pConnectWindow;
 
     delete pTrayIcon;
@@ -16,7 +16,7 @@
 #include <future>
 
 // Custom
-#include "Model/OutputTextType.h"
+#include "Model/ModelEventSink/modeleventsink.h"
 
 
 
@@ -30,6 +30,8 @@ class QSystemTrayIcon;
 class QListWidgetItem;
 class SettingsFile;
 class SListItemUser;
+class UserStateSnapshot;
+class ChatLog;
 
 namespace Ui
 {
@@ -44,7 +46,7 @@ namespace Ui
 #define MAX_NEW_LINE_COUNT_IN_MESSAGE 10
 
 
-class MainWindow : public QMainWindow
+class MainWindow : public QMainWindow, public ModelEventSink
 {
     Q_OBJECT
 
@@ -55,53 +57,54 @@ public:
 
     // Print on Chat Room QPlainTextEdit
 
-        void              printUserMessage           (std::string timeInfo,  std::wstring message,             SilentMessage messageColor, bool bEmitSignal = false);
-        void              printOutput                (std::string text,      SilentMessage messageColor,  bool bEmitSignal = false);
-        void              printOutputW               (std::wstring text,     SilentMessage messageColor,  bool bEmitSignal = false);
-        void              showUserDisconnectNotice   (std::string name,      SilentMessage messageColor,  char cUserLost);
-        void              showUserConnectNotice      (std::string name,      SilentMessage messageColor);
+        void              printUserMessage           (std::string timeInfo,  std::wstring message,             SilentMessage messageColor, bool bEmitSignal = false) override;
+        void              printOutput                (std::string text,      SilentMessage messageColor,  bool bEmitSignal = false) override;
+        void              printOutputW               (std::wstring text,     SilentMessage messageColor,  bool bEmitSignal = false) override;
+        void              showUserDisconnectNotice   (std::string name,      SilentMessage messageColor,  char cUserLost) override;
+        void              showUserConnectNotice      (std::string name,      SilentMessage messageColor) override;
         void              showOldText                (wchar_t* pText);
 
 
     // Update UI elements
 
-        void              setPingAndTalkingToUser    (SListItemUser* pListWidgetItem, int iPing, bool bTalking);
-        void              deleteUserFromList         (SListItemUser* pListWidgetItem,  bool bDeleteAll = false);
-        void              enableInteractiveElements  (bool bMenu, bool bTypeAndSend);
-        void              setOnlineUsersCount        (int onlineCount);
-        void              setConnectDisconnectButton (bool bConnect);
-        SListItemUser*    addNewUserToList           (std::string name);
-        void              addRoom                    (std::string sRoomName, std::wstring sPassword = L"", size_t iMaxUsers = 0, bool bFirstRoom = false);
+        void              setPingAndTalkingToUser    (SListItemUser* pListWidgetItem, int iPing, bool bTalking) override;
+        void              deleteUserFromList         (SListItemUser* pListWidgetItem,  bool bDeleteAll = false) override;
+        void              enableInteractiveElements  (bool bMenu, bool bTypeAndSend) override;
+        void              setOnlineUsersCount        (int onlineCount) override;
+        void              setConnectDisconnectButton (bool bConnect) override;
+        SListItemUser*    addNewUserToList           (std::string name) override;
+        void              addRoom                    (std::string sRoomName, std::wstring sPassword = L"", size_t iMaxUsers = 0, bool bFirstRoom = false) override;
         size_t            getRoomCount               ();
-        SListItemUser*    addUserToRoomIndex         (std::string sName, size_t iRoomIndex);
-        void              moveUserToRoom             (SListItemUser* pUser, std::string sRoomName);
-        void              moveRoom                   (std::string sRoomName, bool bMoveUp);
-        void              deleteRoom                 (std::string sRoomName);
-        void              createRoom                 (std::string sName, std::u16string sPassword, size_t iMaxUsers);
-        void              changeRoomSettings         (std::string sOldName, std::string sNewName, size_t iMaxUsers);
+        SListItemUser*    addUserToRoomIndex         (std::string sName, size_t iRoomIndex) override;
+        void              moveUserToRoom             (SListItemUser* pUser, std::string sRoomName) override;
+        void              moveRoom                   (std::string sRoomName, bool bMoveUp) override;
+        void              deleteRoom                 (std::string sRoomName) override;
+        void              createRoom                 (std::string sName, std::u16string sPassword, size_t iMaxUsers) override;
+        void              changeRoomSettings         (std::string sOldName, std::string sNewName, size_t iMaxUsers) override;
 
 
     // Input message QPlainTextEdit
 
-        void              clearTextEdit              ();
+        void              clearTextEdit              () override;
 
 
     // Other
 
-        void              showVoiceVolumeValueInSettings(int iVolume);
-        void              showMessageBox             (bool bWarningBox, std::string message);
-        void              showPasswordInputWindow    (std::string sRoomName);
-        void              showServerMessage          (std::string sMessage);
-        void              applyTheme                 ();
+        void              showVoiceVolumeValueInSettings(int iVolume) override;
+        void              showMessageBox             (bool bWarningBox, std::string message) override;
+        void              showPasswordInputWindow    (std::string sRoomName) override;
+        void              showServerMessage          (std::string sMessage) override;
+        void              applyTheme                 () override;
 
     ~MainWindow();
 
 
 signals:
 
-    // Print on Chat Room QPlainTextEdit
+    // Print on Chat Room ChatLogView
 
-        void signalTypeOnScreen                      (QString text,     SilentMessage messageColor, bool bUserMessage = false);
+        void signalTypeOnScreen                      (QString text,     SilentMessage messageColor);
+        void signalPrintUserMessage                  (QString sTime,    QString sName, QString sMessage, SilentMessage messageColor);
         void signalShowUserDisconnectNotice          (std::string name, SilentMessage messageColor, char cUserLost);
         void signalShowUserConnectNotice             (std::string name, SilentMessage messageColor);
         void signalShowOldText                       (wchar_t* pText);
@@ -170,11 +173,13 @@ private slots:
         void  slotEnableInteractiveElements     (bool bMenu,                       bool bTypeAndSend);
         void  slotSetConnectDisconnectButton    (bool bConnect);
         void  slotCreateRoom                    (QString sName, QString sPassword, size_t iMaxUsers, std::promise<bool>* resultPromise);
+        void  slotRefreshUserStates             ();
 
 
-    // Print on Chat Room QPlainTextEdit
+    // Print on Chat Room ChatLogView
 
-        void  typeSomeOnScreen                  (QString text,     SilentMessage messageColor, bool bUserMessage = false);
+        void  typeSomeOnScreen                  (QString text,     SilentMessage messageColor);
+        void  slotPrintUserMessage              (QString sTime,    QString sName, QString sMessage, SilentMessage messageColor);
         void  slotShowUserDisconnectNotice      (std::string name, SilentMessage messageColor, char cUserLost);
         void  slotShowUserConnectNotice         (std::string name, SilentMessage messageColor);
         void  slotShowOldText                   (wchar_t* pText);
@@ -193,6 +198,7 @@ private slots:
         void  on_actionConnect_triggered        ();
         void  on_actionSettings_triggered       ();
         void  on_actionAbout_Qt_triggered       ();
+        void  on_actionVoice_Latency_triggered  ();
 
         void  slotOnMenuClose                   ();
 
@@ -205,6 +211,7 @@ private slots:
         void  slotEnterRoomWithPassword         (QString sRoomName, QString sPassword);
         void  slotApplyAudioInputVolume         (int iVolume);
         void  slotApplyVoiceStartValue          (int iValue);
+        void  slotApplyVoiceNoiseGating         (bool bEnable);
         void  slotApplyShouldHearTestVoice      (bool bHear);
         void  slotApplyTheme                    ();
         void  slotApplyMasterVolume             ();
@@ -254,16 +261,19 @@ private:
     QTimer*          pTimer;
 
 
+    // Ping and talking of the users, applied by 'pUserStateTimer' (see setPingAndTalkingToUser()).
+    UserStateSnapshot* pUserStateSnapshot;
+    QTimer*          pUserStateTimer;
+
+
     QSystemTrayIcon* pTrayIcon;
 
 
-    std::mutex       mtxPrintOutput;
-    std::mutex       mtxList;
+    // Messages of the chat room (shown by ui->chatLogView).
+    ChatLog*         pChatLog;
 
 
-    QString          outputHTMLtimeStart;
-    QString          outputHTMLmessageStart;
-    QString          outputHTMLmessageEnd;
+    std::mutex       mtxList;
 
 
     QPoint           dragPosition;
@@ -288,11 +288,14 @@ void SettingsWindow::on_pushButton_apply_clicked()
     pSettingsFile->bPlayTextMessageSound = ui->checkBox_textMessageSound->isChecked();
     pSettingsFile->bPlayConnectDisconnectSound = ui->checkBox_connectDisconnectSound->isChecked();
     pSettingsFile->bShowConnectDisconnectMessage = ui->checkBox_connectDisconnectMessage->isChecked();
+    pSettingsFile->bVoiceNoiseGating = ui->checkBox_noise_gating->isChecked();
 
     pSettingsManager->saveCurrentSettings();
 
     emit applyNewMasterVolume();
 
+    emit signalSetVoiceNoiseGating(pSettingsFile->bVoiceNoiseGating);
+
     emit signalRegisterMuteMicButton(iMuteMicButton);
 
     close();
@@ -361,6 +364,8 @@ void SettingsWindow::updateUIToSettings(std::vector<QString> vInputDevices)
 
     ui->checkBox_hear_voice->setChecked(pSettingsFile->bHearVoiceInSettings);
 
+    ui->checkBox_noise_gating->setChecked(pSettingsFile->bVoiceNoiseGating);
+
     ui->checkBox_textMessageSound->setChecked(pSettingsFile->bPlayTextMessageSound);
 
     ui->checkBox_connectDisconnectSound->setChecked(pSettingsFile->bPlayConnectDisconnectSound);
@@ -41,6 +41,7 @@ signals:
     void  closedSettingsWindow                     ();
     void  signalSetAudioInputVolume                (int iVolume);
     void  signalSetVoiceStartValue                 (int iValue);
+    void  signalSetVoiceNoiseGating                (bool bEnable);
     void  signalSetShouldHearTestVoice             (bool bHear);
     void  signalRegisterMuteMicButton              (int iButton);
 
@@ -0,0 +1,98 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#include "userstatesnapshot.h"
+
+
+// Value of the slot before the first store() (and of the taken state before the first take()).
+#define  USER_STATE_NONE  (~0ULL)
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+UserStateSlot::UserStateSlot()
+{
+    iState      = USER_STATE_NONE;
+    iTakenState = USER_STATE_NONE;
+}
+
+bool UserStateSlot::store(int iPing, bool bTalking)
+{
+    unsigned long long iNewState = pack(iPing, bTalking);
+
+    return iState.exchange(iNewState, std::memory_order_release) != iNewState;
+}
+
+bool UserStateSlot::take(int& iPingOut, bool& bTalkingOut, bool& bPingChangedOut, bool& bTalkingChangedOut)
+{
+    unsigned long long iNewState = iState.load(std::memory_order_acquire);
+
+    if ( (iNewState == iTakenState) || (iNewState == USER_STATE_NONE) )
+    {
+        return false;
+    }
+
+
+    iPingOut    = static_cast<int>( static_cast<unsigned int>(iNewState >> 1) );
+    bTalkingOut = (iNewState & 1) != 0;
+
+    if (iTakenState == USER_STATE_NONE)
+    {
+        bPingChangedOut    = true;
+        bTalkingChangedOut = true;
+    }
+    else
+    {
+        bPingChangedOut    = (iNewState >> 1) != (iTakenState >> 1);
+        bTalkingChangedOut = (iNewState & 1)  != (iTakenState & 1);
+    }
+
+    iTakenState = iNewState;
+
+
+    return true;
+}
+
+unsigned long long UserStateSlot::pack(int iPing, bool bTalking)
+{
+    return (static_cast<unsigned long long>( static_cast<unsigned int>(iPing) ) << 1) | (bTalking ? 1 : 0);
+}
+
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+UserStateSnapshot::UserStateSnapshot()
+{
+    bDirty = false;
+}
+
+void UserStateSnapshot::write(UserStateSlot* pSlot, int iPing, bool bTalking)
+{
+    // Store the slot first: the GUI thread that sees the flag must see the state.
+
+    if ( pSlot->store(iPing, bTalking) )
+    {
+        bDirty.store(true, std::memory_order_release);
+    }
+}
+
+bool UserStateSnapshot::beginRefresh()
+{
+    if ( bDirty.load(std::memory_order_relaxed) == false )
+    {
+        return false;
+    }
+
+    return bDirty.exchange(false, std::memory_order_acq_rel);
+}
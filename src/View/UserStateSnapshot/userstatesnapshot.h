@@ -0,0 +1,91 @@
+﻿// This file is part of the Silent.
+// Copyright Aleksandr "Flone" Tretyakov (github.com/Flone-dnb).
+// Licensed under the ZLib license.
+// Refer to the LICENSE file included.
+
+#pragma once
+
+
+// STL
+#include <atomic>
+
+
+// How often the GUI thread applies the written user states (~30 Hz).
+#define  USER_STATE_REFRESH_MS  33
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Ping and talking state of one user in the list (each SListItemUser has one).
+// Written from any thread without locks, taken by the GUI thread.
+// Only the last written state is kept: a state that is overwritten before the GUI thread takes it is never shown.
+class UserStateSlot
+{
+
+public:
+
+    UserStateSlot();
+
+
+    // Any thread. Returns false if the state is the same as the last written one.
+
+        bool         store               (int iPing, bool bTalking);
+
+
+    // GUI thread. Returns false if nothing changed since the last take()
+    // (otherwise the changed fields are marked in 'bPingChangedOut' and 'bTalkingChangedOut').
+
+        bool         take                (int& iPingOut, bool& bTalkingOut, bool& bPingChangedOut, bool& bTalkingChangedOut);
+
+private:
+
+    static unsigned long long  pack      (int iPing, bool bTalking);
+
+
+    // ---------------------------------------
+
+
+    // Ping in the high bits, talking in the lowest bit (one atomic so the pair is never torn).
+    std::atomic<unsigned long long>  iState;
+
+    // Last state taken by the GUI thread.
+    unsigned long long               iTakenState;
+};
+
+
+
+
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------
+
+
+// Coalesces the user state updates of the model (talking indicators and ping) into UI frames:
+// write() stores the state in the user's slot and marks the snapshot dirty, the GUI thread calls beginRefresh()
+// every USER_STATE_REFRESH_MS and if it returns true takes the slots and applies only the changed fields.
+// So a busy room costs at most one list update per frame instead of a queued signal and a repaint per update.
+class UserStateSnapshot
+{
+
+public:
+
+    UserStateSnapshot();
+
+
+    // Any thread.
+
+        void         write               (UserStateSlot* pSlot, int iPing, bool bTalking);
+
+
+    // GUI thread. Returns true if something was written since the last call.
+
+        bool         beginRefresh        ();
+
+private:
+
+    std::atomic<bool>  bDirty;
+};